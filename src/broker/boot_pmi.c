@@ -20,6 +20,7 @@
 #include "src/common/libutil/cleanup.h"
 #include "src/common/libutil/ipaddr.h"
 #include "src/common/libutil/kary.h"
+#include "src/common/libutil/monotime.h"
 #include "src/common/libpmi/pmi.h"
 #include "src/common/libpmi/pmi_strerror.h"
 
@@ -30,6 +31,11 @@
 /* Generally accepted max, although some go higher (IE is 2083) */
 #define ENDPOINT_MAX 2048
 
+/* With boot.pmi-barrier=0, give up waiting for the parent's URI
+ * after this many seconds.
+ */
+static double parent_uri_timeout = 60.;
+
 /* Given a string with possible format specifiers, return string that is
  * fully expanded.
  *
@@ -140,6 +146,45 @@ done:
     return rc;
 }
 
+/* Get 'key' from the PMI KVS, retrying with backoff while it has not
+ * been put yet, for up to 'timeout' seconds.  This is only valid if the
+ * PMI server makes committed puts visible without a barrier.
+ */
+static int kvs_get_retry (const char *kvsname, const char *key,
+                          char *val, int len, double timeout)
+{
+    struct timespec t0;
+    useconds_t delay = 1000;
+    int e;
+
+    monotime (&t0);
+    while ((e = PMI_KVS_Get (kvsname, key, val, len)) == PMI_ERR_INVALID_KEY
+                        && monotime_since (t0) < timeout * 1000) {
+        usleep (delay);
+        if (delay < 100000)
+            delay *= 2;
+    }
+    return e;
+}
+
+/* Read boot.pmi-barrier attribute (default 1), making it immutable.
+ */
+static int get_use_barrier (attr_t *attrs, bool *use_barrier)
+{
+    const char *s;
+
+    if (attr_get (attrs, "boot.pmi-barrier", &s, NULL) < 0) {
+        s = "1";
+        if (attr_add (attrs, "boot.pmi-barrier", s, 0) < 0)
+            return -1;
+    }
+    if (attr_set_flags (attrs, "boot.pmi-barrier",
+                        FLUX_ATTRFLAG_IMMUTABLE) < 0)
+        return -1;
+    *use_barrier = strtol (s, NULL, 10) != 0;
+    return 0;
+}
+
 int boot_pmi (overlay_t *overlay, attr_t *attrs, int tbon_k)
 {
     int spawned;
@@ -157,7 +202,12 @@ int boot_pmi (overlay_t *overlay, attr_t *attrs, int tbon_k)
     int e;
     int rc = -1;
     const char *tbonendpoint = NULL;
+    bool use_barrier;
 
+    if (get_use_barrier (attrs, &use_barrier) < 0) {
+        log_err ("boot.pmi-barrier");
+        goto done;
+    }
     if ((e = PMI_Init (&spawned)) != PMI_SUCCESS) {
         log_msg ("PMI_Init: %s", pmi_strerror (e));
         goto done;
@@ -243,12 +293,14 @@ int boot_pmi (overlay_t *overlay, attr_t *attrs, int tbon_k)
     }
 
     /* Puts are complete, now we synchronize and begin our gets.
+     * Without the barrier, the get is retried until the parent's put
+     * is visible, so each broker waits only for its parent.
      */
     if ((e = PMI_KVS_Commit (kvsname)) != PMI_SUCCESS) {
         log_msg ("PMI_KVS_Commit: %s", pmi_strerror (e));
         goto done;
     }
-    if ((e = PMI_Barrier ()) != PMI_SUCCESS) {
+    if (use_barrier && (e = PMI_Barrier ()) != PMI_SUCCESS) {
         log_msg ("PMI_Barrier: %s", pmi_strerror (e));
         goto done;
     }
@@ -261,14 +313,18 @@ int boot_pmi (overlay_t *overlay, attr_t *attrs, int tbon_k)
             log_msg ("pmi key string overflow");
             goto done;
         }
-        if ((e = PMI_KVS_Get (kvsname, key, val, val_len)) != PMI_SUCCESS) {
+        if (use_barrier)
+            e = PMI_KVS_Get (kvsname, key, val, val_len);
+        else
+            e = kvs_get_retry (kvsname, key, val, val_len, parent_uri_timeout);
+        if (e != PMI_SUCCESS) {
             log_msg ("pmi_kvs_get: %s", pmi_strerror (e));
             goto done;
         }
         overlay_set_parent (overlay, "%s", val);
     }
 
-    if ((e = PMI_Barrier ()) != PMI_SUCCESS) {
+    if (use_barrier && (e = PMI_Barrier ()) != PMI_SUCCESS) {
         log_msg ("PMI_Barrier: %s", pmi_strerror (e));
         goto done;
     }
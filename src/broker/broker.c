@@ -73,6 +73,7 @@
 #include "boot_config.h"
 #include "boot_pmi.h"
 #include "publisher.h"
+#include "msgstats.h"
 
 /* Generally accepted max, although some go higher (IE is 2083) */
 #define ENDPOINT_MAX 2048
@@ -116,6 +117,7 @@ typedef struct {
     zlist_t *subscriptions;     /* subscripts for internal services */
     content_cache_t *cache;
     struct publisher *publisher;
+    struct msgstats *msgstats;
     int tbon_k;
     /* Bootstrap
      */
@@ -161,6 +163,8 @@ static int create_persistdir (attr_t *attrs, uint32_t rank);
 static int create_rundir (attr_t *attrs);
 static void create_broker_rundir (overlay_t *ov, void *arg);
 static int create_dummyattrs (flux_t *h, uint32_t rank, uint32_t size);
+static int set_time_attr (attr_t *attrs, const char *name, double t);
+static int init_module_transport (attr_t *attrs, modhash_t *mh);
 
 static int handle_event (broker_ctx_t *ctx, const flux_msg_t *msg);
 
@@ -315,6 +319,8 @@ int main (int argc, char *argv[])
         oom ();
     if (!(ctx.publisher = publisher_create ()))
         oom ();
+    if (!(ctx.msgstats = msgstats_create (MSGSTATS_MAX_TOPICS)))
+        oom ();
 
     init_attrs (ctx.attrs, getpid());
 
@@ -427,6 +433,8 @@ int main (int argc, char *argv[])
             log_msg_exit ("bootstrap failed");
         elapsed_sec = monotime_since (start_time) / 1000;
         flux_log (ctx.h, LOG_INFO, "pmi: bootstrap time %.1fs", elapsed_sec);
+        if (set_time_attr (ctx.attrs, "boot.pmi-time", elapsed_sec) < 0)
+            log_err_exit ("setattr boot.pmi-time");
 
     }
     else
@@ -580,6 +588,8 @@ int main (int argc, char *argv[])
     modhash_set_rank (ctx.modhash, rank);
     modhash_set_flux (ctx.modhash, ctx.h);
     modhash_set_heartbeat (ctx.modhash, ctx.heartbeat);
+    if (init_module_transport (ctx.attrs, ctx.modhash) < 0)
+        log_err_exit ("broker.module-transport");
     /* Load the local connector module.
      * Other modules will be loaded in rc1 using flux module,
      * which uses the local connector.
@@ -661,6 +671,7 @@ int main (int argc, char *argv[])
     shutdown_destroy (ctx.shutdown);
     broker_remove_services (handlers);
     publisher_destroy (ctx.publisher);
+    msgstats_destroy (ctx.msgstats);
     flux_close (ctx.h);
     flux_reactor_destroy (ctx.reactor);
     if (ctx.subscriptions) {
@@ -737,6 +748,33 @@ static void init_attrs (attr_t *attrs, pid_t pid)
         log_err_exit ("attr_add version");
 }
 
+/* Select broker <-> module message transport, "queue" by default.
+ */
+static int init_module_transport (attr_t *attrs, modhash_t *mh)
+{
+    const char *val;
+
+    if (attr_get (attrs, "broker.module-transport", &val, NULL) < 0) {
+        val = "queue";
+        if (attr_add (attrs, "broker.module-transport", val, 0) < 0)
+            return -1;
+    }
+    if (modhash_set_transport (mh, val) < 0)
+        return -1;
+    return attr_set_flags (attrs, "broker.module-transport",
+                           FLUX_ATTRFLAG_IMMUTABLE);
+}
+
+/* Record a boot phase duration in seconds as an immutable attribute.
+ */
+static int set_time_attr (attr_t *attrs, const char *name, double t)
+{
+    char num[32];
+
+    snprintf (num, sizeof (num), "%.3f", t);
+    return attr_add (attrs, name, num, FLUX_ATTRFLAG_IMMUTABLE);
+}
+
 static void hello_update_cb (hello_t *hello, void *arg)
 {
     broker_ctx_t *ctx = arg;
@@ -745,6 +783,9 @@ static void hello_update_cb (hello_t *hello, void *arg)
         flux_log (ctx->h, LOG_INFO, "wireup: %d/%d (complete) %.1fs",
                   hello_get_count (hello), overlay_get_size(ctx->overlay),
                   hello_get_time (hello));
+        if (set_time_attr (ctx->attrs, "boot.wireup-time",
+                           hello_get_time (hello)) < 0)
+            log_err ("setattr boot.wireup-time");
         flux_log (ctx->h, LOG_INFO, "Run level %d starting", 1);
         overlay_set_idle_warning (ctx->overlay, 3);
         if (runlevel_set_level (ctx->runlevel, 1) < 0)
@@ -1268,6 +1309,130 @@ static void cmb_lspeer_cb (flux_t *h, flux_msg_handler_t *mh,
     free (out);
 }
 
+static void cmb_stats_cb (flux_t *h, flux_msg_handler_t *mh,
+                          const flux_msg_t *msg, void *arg)
+{
+    broker_ctx_t *ctx = arg;
+    json_t *o = NULL;
+
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+    if (!(o = msgstats_encode (ctx->msgstats)))
+        goto error;
+    if (flux_respond_pack (h, msg, "O", o) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    json_decref (o);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+}
+
+static void cmb_trace_sample_cb (flux_t *h, flux_msg_handler_t *mh,
+                                 const flux_msg_t *msg, void *arg)
+{
+    int sample;
+
+    if (flux_request_unpack (msg, NULL, "{s:i}", "sample", &sample) < 0)
+        goto error;
+    if (flux_trace_set_sample (sample) < 0)
+        goto error;
+    if (flux_respond (h, msg, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+}
+
+static json_int_t clock_ns (clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime (clock, &ts);
+    return (json_int_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Encode records as arrays to keep the response compact:
+ *   [timestamp, topic_hash, id, nodeid, size, ring, type, direction]
+ * along with a dictionary of the topics they refer to, and the current
+ * monotonic and real time so the caller can line up records from
+ * different brokers.
+ */
+static json_t *trace_encode (uint32_t rank, int lost,
+                             struct flux_trace_record *recs, int count)
+{
+    json_t *records;
+    json_t *topics;
+    int i;
+
+    if (!(records = json_array ()) || !(topics = json_object ()))
+        goto nomem;
+    for (i = 0; i < count; i++) {
+        struct flux_trace_record *r = &recs[i];
+        const char *topic = flux_trace_topic_lookup (r->topic_hash);
+        char key[16];
+        json_t *o;
+
+        if (!(o = json_pack ("[I I I I I i i i]",
+                             (json_int_t)r->timestamp,
+                             (json_int_t)r->topic_hash,
+                             (json_int_t)r->id,
+                             (json_int_t)r->nodeid,
+                             (json_int_t)r->size,
+                             r->ring,
+                             r->type,
+                             r->direction))
+            || json_array_append_new (records, o) < 0)
+            goto nomem;
+        snprintf (key, sizeof (key), "%"PRIu32, r->topic_hash);
+        if (topic && !json_object_get (topics, key)) {
+            if (!(o = json_string (topic))
+                || json_object_set_new (topics, key, o) < 0)
+                goto nomem;
+        }
+    }
+    return json_pack ("{s:i s:i s:I s:I s:o s:o}",
+                      "rank", rank,
+                      "lost", lost,
+                      "monotime", clock_ns (CLOCK_MONOTONIC),
+                      "realtime", clock_ns (CLOCK_REALTIME),
+                      "topics", topics,
+                      "records", records);
+nomem:
+    json_decref (records);
+    json_decref (topics);
+    errno = ENOMEM;
+    return NULL;
+}
+
+static void cmb_trace_drain_cb (flux_t *h, flux_msg_handler_t *mh,
+                                const flux_msg_t *msg, void *arg)
+{
+    broker_ctx_t *ctx = arg;
+    struct flux_trace_record *recs = NULL;
+    json_t *o = NULL;
+    int count;
+    int lost;
+
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+    if ((count = flux_trace_drain (&recs, &lost)) < 0)
+        goto error;
+    if (!(o = trace_encode (overlay_get_rank (ctx->overlay), lost,
+                            recs, count)))
+        goto error;
+    if (flux_respond_pack (h, msg, "O", o) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    json_decref (o);
+    free (recs);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+    free (recs);
+}
+
 #if CODE_COVERAGE_ENABLED
 void __gcov_flush (void);
 #endif
@@ -1435,6 +1600,9 @@ static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "cmb.insmod",     cmb_insmod_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "cmb.lsmod",      cmb_lsmod_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "cmb.lspeer",     cmb_lspeer_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "cmb.stats",      cmb_stats_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "cmb.trace.sample", cmb_trace_sample_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "cmb.trace.drain", cmb_trace_drain_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "cmb.panic",      cmb_panic_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "cmb.disconnect", cmb_disconnect_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "cmb.sub",        cmb_sub_cb, 0 },
@@ -1511,6 +1679,7 @@ static void child_cb (overlay_t *ov, void *sock, void *arg)
     if (flux_msg_get_route_last (msg, &uuid) < 0)
         goto done;
     overlay_checkin_child (ctx->overlay, uuid);
+    (void)msgstats_count (ctx->msgstats, msg, MSGSTATS_SOURCE_CHILD, NULL);
     switch (type) {
         case FLUX_MSGTYPE_KEEPALIVE:
             break;
@@ -1603,6 +1772,7 @@ static void parent_cb (overlay_t *ov, void *sock, void *arg)
         goto done;
     if (flux_msg_get_type (msg, &type) < 0)
         goto done;
+    (void)msgstats_count (ctx->msgstats, msg, MSGSTATS_SOURCE_PARENT, NULL);
     switch (type) {
         case FLUX_MSGTYPE_RESPONSE:
             if (broker_response_sendmsg (ctx, msg) < 0)
@@ -1633,7 +1803,8 @@ done:
 static void module_cb (module_t *p, void *arg)
 {
     broker_ctx_t *ctx = arg;
-    flux_msg_t *msg = module_recvmsg (p);
+    struct timespec t_queued;
+    flux_msg_t *msg = module_recvmsg (p, &t_queued);
     int type;
     int ka_errnum, ka_status;
 
@@ -1641,6 +1812,8 @@ static void module_cb (module_t *p, void *arg)
         goto done;
     if (flux_msg_get_type (msg, &type) < 0)
         goto done;
+    (void)msgstats_count (ctx->msgstats, msg, MSGSTATS_SOURCE_MODULE,
+                          &t_queued);
     switch (type) {
         case FLUX_MSGTYPE_RESPONSE:
             (void)broker_response_sendmsg (ctx, msg);
@@ -1935,6 +2108,7 @@ static int broker_send (void *impl, const flux_msg_t *msg, int flags)
         goto done;
     if (flux_msg_set_rolemask (cpy, rolemask) < 0)
         goto done;
+    (void)msgstats_count (ctx->msgstats, cpy, MSGSTATS_SOURCE_BROKER, NULL);
 
     switch (type) {
         case FLUX_MSGTYPE_REQUEST:
@@ -20,6 +20,8 @@
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/iterators.h"
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/hist.h"
 
 #include "attr.h"
 #include "content-cache.h"
@@ -52,6 +54,8 @@ struct cache_entry {
     zlist_t *load_requests;
     zlist_t *store_requests;
     int lastused;
+    struct timespec load_start;     /* for latency of pending load/store */
+    struct timespec store_start;
 };
 
 struct content_cache {
@@ -77,6 +81,9 @@ struct content_cache {
     uint32_t acct_size;             /* total size of all cache entries */
     uint32_t acct_valid;            /* count of valid cache entries */
     uint32_t acct_dirty;            /* count of dirty cache entries */
+
+    struct hist *load_latency;      /* usec per upstream/backing load */
+    struct hist *store_latency;     /* usec per upstream/backing store */
 };
 
 static void flush_respond (content_cache_t *cache);
@@ -275,6 +282,7 @@ static void cache_load_continuation (flux_future_t *f, void *arg)
     int len = 0;
 
     e->load_pending = 0;
+    (void)hist_record_since (cache->load_latency, e->load_start);
     if (flux_content_load_get (f, &data, &len) < 0) {
         if (errno == ENOSYS && cache->rank == 0)
             errno = ENOENT;
@@ -312,6 +320,7 @@ static int cache_load (content_cache_t *cache, struct cache_entry *e)
         return 0;
     if (cache->rank == 0)
         flags = CONTENT_FLAG_CACHE_BYPASS;
+    monotime (&e->load_start);
     if (!(f = flux_content_load (cache->h, e->blobref, flags))) {
         if (errno == ENOSYS && cache->rank == 0)
             errno = ENOENT;
@@ -428,6 +437,7 @@ static void cache_store_continuation (flux_future_t *f, void *arg)
     const char *blobref;
 
     e->store_pending = 0;
+    (void)hist_record_since (cache->store_latency, e->store_start);
     assert (cache->flush_batch_count > 0);
     cache->flush_batch_count--;
     if (flux_content_store_get (f, &blobref) < 0) {
@@ -474,6 +484,7 @@ static int cache_store (content_cache_t *cache, struct cache_entry *e)
             return 0;
         flags = CONTENT_FLAG_CACHE_BYPASS;
     }
+    monotime (&e->store_start);
     if (!(f = flux_content_store (cache->h, e->data, e->len, flags))) {
         saved_errno = errno;
         flux_log_error (cache->h, "content store");
@@ -691,7 +702,8 @@ error:
     zlist_destroy (&keys);
 }
 
-/* Return stats about the cache.
+/* Return stats about the cache, including the latency of loads and
+ * stores sent upstream or, on rank 0, to the backing store.
  */
 
 static void content_stats_request (flux_t *h, flux_msg_handler_t *mh,
@@ -701,11 +713,15 @@ static void content_stats_request (flux_t *h, flux_msg_handler_t *mh,
 
     if (flux_request_decode (msg, NULL, NULL) < 0)
         goto error;
-    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i}",
+    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:o s:o }",
                            "count", zhash_size (cache->entries),
                            "valid", cache->acct_valid,
                            "dirty", cache->acct_dirty,
-                           "size", cache->acct_size) < 0)
+                           "size", cache->acct_size,
+                           "load (us)",
+                           hist_encode (cache->load_latency),
+                           "store (us)",
+                           hist_encode (cache->store_latency)) < 0)
         flux_log_error (h, "content stats");
     return;
 error:
@@ -950,6 +966,8 @@ void content_cache_destroy (content_cache_t *cache)
             free (cache->backing_name);
         zhash_destroy (&cache->entries);
         message_list_destroy (&cache->flush_requests);
+        hist_destroy (cache->load_latency);
+        hist_destroy (cache->store_latency);
         free (cache);
     }
 }
@@ -961,7 +979,9 @@ content_cache_t *content_cache_create (void)
         errno = ENOMEM;
         return NULL;
     }
-    if (!(cache->entries = zhash_new ())) {
+    if (!(cache->entries = zhash_new ())
+        || !(cache->load_latency = hist_create ())
+        || !(cache->store_latency = hist_create ())) {
         content_cache_destroy (cache);
         errno = ENOMEM;
         return NULL;
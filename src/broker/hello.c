@@ -17,6 +17,7 @@
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/fsd.h"
+#include "src/common/libidset/idset.h"
 
 #include "hello.h"
 #include "reduce.h"
@@ -32,7 +33,7 @@ struct hello_struct {
     flux_msg_handler_t **handlers;
     uint32_t rank;
     uint32_t size;
-    uint32_t count;
+    struct idset *ranks;    /* rank 0: ranks accounted for */
 
     double start;
 
@@ -49,10 +50,11 @@ static void r_reduce (flux_reduce_t *r, int batch, void *arg);
 static void r_sink (flux_reduce_t *r, int batch, void *arg);
 static void r_forward (flux_reduce_t *r, int batch, void *arg);
 static int r_itemweight (void *item);
+static void r_destroy (void *item);
 
 
 struct flux_reduce_ops reduce_ops = {
-    .destroy = NULL,
+    .destroy = r_destroy,
     .reduce = r_reduce,
     .sink = r_sink,
     .forward = r_forward,
@@ -71,6 +73,7 @@ void hello_destroy (hello_t *hello)
     if (hello) {
         flux_reduce_destroy (hello->reduce);
         flux_msg_handler_delvec (hello->handlers);
+        idset_destroy (hello->ranks);
         free (hello);
     }
 }
@@ -134,7 +137,7 @@ double hello_get_time (hello_t *hello)
 
 int hello_get_count (hello_t *hello)
 {
-    return hello->count;
+    return hello->ranks ? idset_count (hello->ranks) : 0;
 }
 
 void hello_set_callback (hello_t *hello, hello_cb_f cb, void *arg)
@@ -145,7 +148,7 @@ void hello_set_callback (hello_t *hello, hello_cb_f cb, void *arg)
 
 bool hello_complete (hello_t *hello)
 {
-    return (hello->size == hello->count);
+    return (hello->size == hello_get_count (hello));
 }
 
 int hello_start (hello_t *hello)
@@ -155,12 +158,17 @@ int hello_start (hello_t *hello)
     int hwm = 1;
     double timeout = 0.;
     const char *s;
+    struct idset *self;
 
     if (flux_get_rank (hello->h, &hello->rank) < 0
                         || flux_get_size (hello->h, &hello->size) < 0) {
         log_err ("hello: error getting rank/size");
         goto done;
     }
+    if (hello->rank == 0 && !(hello->ranks = idset_create (hello->size, 0))) {
+        log_err ("hello: creating idset");
+        goto done;
+    }
     if (flux_msg_handler_addvec (hello->h, htab, hello,
                                  &hello->handlers) < 0) {
         log_err ("hello: adding message handlers");
@@ -197,8 +205,13 @@ int hello_start (hello_t *hello)
     flux_reactor_t *r = flux_get_reactor (hello->h);
     flux_reactor_now_update (r);
     hello->start = flux_reactor_now (r);
-    if (flux_reduce_append (hello->reduce, (void *)(uintptr_t)1, 0) < 0)
+    if (!(self = idset_create (hello->size, 0)))
+        goto done;
+    if (idset_set (self, hello->rank) < 0
+                || flux_reduce_append (hello->reduce, self, 0) < 0) {
+        idset_destroy (self);
         goto done;
+    }
     rc = 0;
 done:
     return rc;
@@ -210,59 +223,71 @@ static void join_request (flux_t *h, flux_msg_handler_t *mh,
                           const flux_msg_t *msg, void *arg)
 {
     hello_t *hello = arg;
-    int count, batch;
+    const char *s;
+    struct idset *ranks;
+    int batch;
 
-    if (flux_request_unpack (msg, NULL, "{ s:i s:i }",
-                             "count", &count,
+    if (flux_request_unpack (msg, NULL, "{ s:s s:i }",
+                             "ranks", &s,
                              "batch", &batch) < 0)
         log_err_exit ("hello: flux_request_unpack");
-    if (batch != 0 || count <= 0)
+    if (batch != 0 || !(ranks = idset_decode (s))
+                   || idset_count (ranks) == 0
+                   || idset_last (ranks) >= hello->size)
         log_msg_exit ("hello: error decoding join request");
-    if (flux_reduce_append (hello->reduce, (void *)(uintptr_t)count, batch) < 0)
+    if (flux_reduce_append (hello->reduce, ranks, batch) < 0)
         log_err_exit ("hello: flux_reduce_append");
 }
 
 /* Reduction ops
- * N.B. since we are reducing integers, we cheat and avoid memory
- * allocation by stuffing the int inside the pointer value.
+ * Items are idsets of ranks that have checked in.
  */
 
-/* Pop one or more counts, push their sum
+/* Pop one or more idsets, push their union
  */
 static void r_reduce (flux_reduce_t *r, int batch, void *arg)
 {
-    int i, count = 0;
+    struct idset *ranks, *item;
 
     assert (batch == 0);
 
-    while ((i = (uintptr_t)flux_reduce_pop (r)) > 0)
-        count += i;
-    if (count > 0 && flux_reduce_push (r, (void *)(uintptr_t)count) < 0)
+    if (!(ranks = flux_reduce_pop (r)))
+        return;
+    while ((item = flux_reduce_pop (r))) {
+        if (idset_union (ranks, item) < 0)
+            log_err_exit ("hello: idset_union");
+        idset_destroy (item);
+    }
+    if (flux_reduce_push (r, ranks) < 0)
         log_err_exit ("hello: flux_reduce_push");
     /* Invariant for r_sink and r_forward:
      * after reduce, handle contains exactly one item.
      */
 }
 
-/* (called on rank 0 only) Pop exactly one count, update global count,
- * call the registered callback.
+/* (called on rank 0 only) Pop exactly one idset, add it to the global
+ * idset, call the registered callback if any new ranks were added.
+ * Duplicate joins add nothing, so completion is reported only once.
  * This may be called once the total hwm is reached on rank 0,
  * or after the timeout, as new messages arrive (after r_reduce).
  */
 static void r_sink (flux_reduce_t *r, int batch, void *arg)
 {
     hello_t *hello = arg;
-    int count = (uintptr_t)flux_reduce_pop (r);
+    struct idset *ranks = flux_reduce_pop (r);
+    int count = hello_get_count (hello);
 
     assert (batch == 0);
-    assert (count > 0);
+    assert (ranks != NULL);
 
-    hello->count += count;
-    if (hello->cb)
+    if (idset_union (hello->ranks, ranks) < 0)
+        log_err_exit ("hello: idset_union");
+    idset_destroy (ranks);
+    if (hello->cb && hello_get_count (hello) > count)
         hello->cb (hello, hello->cb_arg);
 }
 
-/* (called on rank > 0 only) Pop exactly one count, forward upstream.
+/* (called on rank > 0 only) Pop exactly one idset, forward upstream.
  * This may be called once the hwm is reached on this rank (based on topo),
  * or after the timeout, as new messages arrive (after r_reduce).
  */
@@ -270,25 +295,35 @@ static void r_forward (flux_reduce_t *r, int batch, void *arg)
 {
     flux_future_t *f;
     hello_t *hello = arg;
-    int count = (uintptr_t)flux_reduce_pop (r);
+    struct idset *ranks = flux_reduce_pop (r);
+    char *s;
 
     assert (batch == 0);
-    assert (count > 0);
+    assert (ranks != NULL);
 
+    if (!(s = idset_encode (ranks, IDSET_FLAG_RANGE)))
+        log_err_exit ("hello: idset_encode");
     if (!(f = flux_rpc_pack (hello->h, "hello.join", FLUX_NODEID_UPSTREAM,
-                             FLUX_RPC_NORESPONSE, "{ s:i s:i }",
-                             "count", count,
+                             FLUX_RPC_NORESPONSE, "{ s:s s:i }",
+                             "ranks", s,
                              "batch", batch)))
         log_err_exit ("hello: flux_rpc_pack");
     flux_future_destroy (f);
+    free (s);
+    idset_destroy (ranks);
 }
 
 /* How many original items does this item represent after reduction?
- * In this simple case it is just the value of the item (the count).
+ * Each rank in the idset is one original item.
  */
 static int r_itemweight (void *item)
 {
-    return (uintptr_t)item;
+    return idset_count (item);
+}
+
+static void r_destroy (void *item)
+{
+    idset_destroy (item);
 }
 
 /*
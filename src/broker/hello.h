@@ -33,6 +33,8 @@ void hello_set_flux (hello_t *hello, flux_t *h);
 int hello_register_attrs (hello_t *hello, attr_t *attrs);
 
 /* Register callback for completion/progress.
+ * It is called each time ranks are added, so it is called once with
+ * hello_complete() true.
  */
 void hello_set_callback (hello_t *hello, hello_cb_f cb, void *arg);
 
@@ -20,14 +20,23 @@
 #include "src/common/libutil/stdlog.h"
 
 #include "log.h"
+#include "logring.h"
 
 /* See descriptions in flux-broker-attributes(7) */
 static const int default_ring_size = 1024;
 static const int default_forward_level = LOG_DEBUG;
+static const int default_forward_rate = 1000;
 static const int default_critical_level = LOG_CRIT;
 static const int default_stderr_level = LOG_ERR;
 static const int default_level = LOG_DEBUG;
 
+/* Entries forwarded upstream are sent in batches of up to this many
+ * entries or bytes, or after this many seconds, whichever comes first.
+ */
+static const int forward_batch_count = 64;
+static const int forward_batch_bytes = 32768;
+static const double forward_batch_delay = 0.01;
+
 #define LOGBUF_MAGIC 0xe1e2e3e4
 typedef struct {
     int magic;
@@ -40,153 +49,50 @@ typedef struct {
     int critical_level;
     int stderr_level;
     int level;
-    zlist_t *buf;
-    int ring_size;
-    int seq;
-    zlist_t *sleepers;
+    struct logring *ring;
+    zlist_t *followers;         /* streaming log.dmesg requests */
+
+    /* Entries awaiting forwarding, each terminated by a NUL */
+    char *fwd_buf;
+    int fwd_len;
+    int fwd_count;
+    flux_watcher_t *fwd_timer;
+    bool fwd_timer_active;
+
+    /* Rate limit on entries forwarded upstream (token bucket) */
+    int forward_rate;           /* entries per second, 0 = unlimited */
+    double fwd_tokens;
+    double fwd_t;
+
+    /* Entries not forwarded because of the rate limit */
+    unsigned long fwd_dropped[LOG_DEBUG + 1];   /* since last report */
+    unsigned long fwd_dropped_total;
 } logbuf_t;
 
-struct logbuf_entry {
-    char *buf;
-    int len;
-    int seq;
-};
-
-#define SLEEPER_MAGIC 0xe4e3e2e1
-struct sleeper {
-    int magic;
-    flux_t *h;
-    flux_msg_handler_t *mh;
-    flux_msg_handler_f fun;
-    flux_msg_t *msg;
-    void *arg;
-};
-
-static void sleeper_destroy (struct sleeper *s)
-{
-    if (s) {
-        assert (s->magic == SLEEPER_MAGIC);
-        flux_msg_destroy (s->msg);
-        s->magic =~ SLEEPER_MAGIC;
-        free (s);
-    }
-}
-
-static struct sleeper *sleeper_create (flux_msg_handler_f fun,
-                                       flux_t *h, flux_msg_handler_t *mh,
-                                       const flux_msg_t *msg, void *arg)
-{
-    struct sleeper *s = calloc (1, sizeof (*s));
-    if (!s)
-        return NULL;
-    s->magic = SLEEPER_MAGIC;
-    s->h = h;
-    s->mh = mh;
-    s->fun = fun;
-    s->arg = arg;
-    if (!(s->msg = flux_msg_copy (msg, true))) {
-        sleeper_destroy (s);
-        return NULL;
-    }
-    return s;
-}
-
-static void logbuf_entry_destroy (struct logbuf_entry *e)
-{
-    if (e) {
-        if (e->buf)
-            free (e->buf);
-        free (e);
-    }
-}
+static void logbuf_forward_flush (logbuf_t *logbuf);
 
-static struct logbuf_entry *logbuf_entry_create (const char *buf, int len)
+static int dmesg_respond (flux_t *h, const flux_msg_t *msg,
+                          int seq, const char *buf, int len)
 {
-    struct logbuf_entry *e = xzmalloc (sizeof (*e));
-    e->buf = xzmalloc (len);
-    memcpy (e->buf, buf, len);
-    e->len = len;
-    return e;
-}
-
-static void logbuf_trim (logbuf_t *logbuf, int size)
-{
-    assert (logbuf->magic == LOGBUF_MAGIC);
-    struct logbuf_entry *e;
-    while (zlist_size (logbuf->buf) > size) {
-        e = zlist_pop (logbuf->buf);
-        logbuf_entry_destroy (e);
-    }
-}
-
-static void logbuf_clear (logbuf_t *logbuf, int seq_index)
-{
-    struct logbuf_entry *e;
-
-    if (seq_index == -1)
-        logbuf_trim (logbuf, 0);
-    else {
-        while ((e = zlist_first (logbuf->buf)) && e->seq <= seq_index) {
-            e = zlist_pop (logbuf->buf);
-            logbuf_entry_destroy (e);
-        }
-    }
-}
-
-static int logbuf_get (logbuf_t *logbuf, int seq_index, int *seq,
-                       const char **buf, int *len)
-{
-    struct logbuf_entry *e = zlist_first (logbuf->buf);
-
-    while (e && e->seq <= seq_index)
-        e = zlist_next (logbuf->buf);
-    if (!e) {
-        errno = ENOENT;
-        return -1;
-    }
-    if (seq)
-        *seq = e->seq;
-    if (buf)
-        *buf = e->buf;
-    if (len)
-        *len = e->len;
-    return 0;
-}
-
-static int logbuf_sleepon (logbuf_t *logbuf, flux_msg_handler_f fun, flux_t *h,
-                           flux_msg_handler_t *mh, const flux_msg_t *msg,
-                           void *arg)
-{
-    assert (logbuf->magic == LOGBUF_MAGIC);
-    struct sleeper *s = sleeper_create (fun, h, mh, msg, arg);
-    if (!s)
-        return -1;
-    if (zlist_append (logbuf->sleepers, s) < 0) {
-        sleeper_destroy (s);
-        errno = ENOMEM;
-        return -1;
-    }
-    return 0;
+    return flux_respond_pack (h, msg, "{ s:i s:s# }",
+                                      "seq", seq,
+                                      "buf", buf, len);
 }
 
 static int append_new_entry (logbuf_t *logbuf, const char *buf, int len)
 {
     assert (logbuf->magic == LOGBUF_MAGIC);
-    struct logbuf_entry *e;
-    struct sleeper *s;
-
-    if (logbuf->ring_size > 0) {
-        logbuf_trim (logbuf, logbuf->ring_size - 1);
-        e = logbuf_entry_create (buf, len);
-        e->seq = logbuf->seq++;
-        if (zlist_append (logbuf->buf, e) < 0) {
-            logbuf_entry_destroy (e);
-            errno = ENOMEM;
+    flux_msg_t *msg;
+    int seq;
+
+    if (logring_size (logbuf->ring) > 0) {
+        if ((seq = logring_append (logbuf->ring, buf, len)) < 0)
             return -1;
-        }
-        while ((s = zlist_pop (logbuf->sleepers))) {
-            s->fun (s->h, s->mh, s->msg, s->arg);
-            sleeper_destroy (s);
+        msg = zlist_first (logbuf->followers);
+        while (msg) {
+            if (dmesg_respond (logbuf->h, msg, seq, buf, len) < 0)
+                log_err ("%s: error responding to log.dmesg", __FUNCTION__);
+            msg = zlist_next (logbuf->followers);
         }
     }
     return 0;
@@ -200,11 +106,13 @@ static logbuf_t *logbuf_create (void)
     logbuf->critical_level = default_critical_level;
     logbuf->stderr_level = default_stderr_level;
     logbuf->level = default_level;
-    logbuf->ring_size = default_ring_size;
-    if (!(logbuf->buf = zlist_new ()))
+    logbuf->forward_rate = default_forward_rate;
+    logbuf->fwd_tokens = default_forward_rate;
+    if (!(logbuf->ring = logring_create (default_ring_size)))
         oom();
-    if (!(logbuf->sleepers = zlist_new ()))
+    if (!(logbuf->followers = zlist_new ()))
         oom();
+    logbuf->fwd_buf = xzmalloc (forward_batch_bytes);
     return logbuf;
 }
 
@@ -212,16 +120,15 @@ void logbuf_destroy (logbuf_t *logbuf)
 {
     if (logbuf) {
         assert (logbuf->magic == LOGBUF_MAGIC);
-        if (logbuf->buf) {
-            logbuf_trim (logbuf, 0);
-            zlist_destroy (&logbuf->buf);
-        }
-        if (logbuf->sleepers) {
-            struct sleeper *s;
-            while ((s = zlist_pop (logbuf->sleepers)))
-                sleeper_destroy (s);
-            zlist_destroy (&logbuf->sleepers);
+        logring_destroy (logbuf->ring);
+        if (logbuf->followers) {
+            flux_msg_t *msg;
+            while ((msg = zlist_pop (logbuf->followers)))
+                flux_msg_destroy (msg);
+            zlist_destroy (&logbuf->followers);
         }
+        flux_watcher_destroy (logbuf->fwd_timer);
+        free (logbuf->fwd_buf);
         if (logbuf->f)
             (void)fclose (logbuf->f);
         if (logbuf->filename)
@@ -274,12 +181,17 @@ static int logbuf_set_level (logbuf_t *logbuf, int level)
 
 static int logbuf_set_ring_size (logbuf_t *logbuf, int size)
 {
-    if (size < 0) {
+    return logring_resize (logbuf->ring, size);
+}
+
+static int logbuf_set_forward_rate (logbuf_t *logbuf, int rate)
+{
+    if (rate < 0) {
         errno = EINVAL;
         return -1;
     }
-    logbuf_trim (logbuf, size);
-    logbuf->ring_size = size;
+    logbuf->forward_rate = rate;
+    logbuf->fwd_tokens = rate;
     return 0;
 }
 
@@ -321,16 +233,24 @@ static int attr_get_log (const char *name, const char **val, void *arg)
         n = snprintf (s, sizeof (s), "%d", logbuf->stderr_level);
         assert (n < sizeof (s));
         *val = s;
+    } else if (!strcmp (name, "log-forward-rate")) {
+        n = snprintf (s, sizeof (s), "%d", logbuf->forward_rate);
+        assert (n < sizeof (s));
+        *val = s;
+    } else if (!strcmp (name, "log-forward-dropped")) {
+        n = snprintf (s, sizeof (s), "%lu", logbuf->fwd_dropped_total);
+        assert (n < sizeof (s));
+        *val = s;
     } else if (!strcmp (name, "log-ring-size")) {
-        n = snprintf (s, sizeof (s), "%d", logbuf->ring_size);
+        n = snprintf (s, sizeof (s), "%d", logring_size (logbuf->ring));
         assert (n < sizeof (s));
         *val = s;
     } else if (!strcmp (name, "log-ring-used")) {
-        n = snprintf (s, sizeof (s), "%zd", zlist_size (logbuf->buf));
+        n = snprintf (s, sizeof (s), "%d", logring_count (logbuf->ring));
         assert (n < sizeof (s));
         *val = s;
     } else if (!strcmp (name, "log-count")) {
-        n = snprintf (s, sizeof (s), "%d", logbuf->seq);
+        n = snprintf (s, sizeof (s), "%d", logring_seq (logbuf->ring));
         assert (n < sizeof (s));
         *val = s;
     } else if (!strcmp (name, "log-filename")) {
@@ -357,6 +277,10 @@ static int attr_set_log (const char *name, const char *val, void *arg)
         int level = strtol (val, NULL, 10);
         if (logbuf_set_forward_level (logbuf, level) < 0)
             goto done;
+    } else if (!strcmp (name, "log-forward-rate")) {
+        int rate = strtol (val, NULL, 10);
+        if (logbuf_set_forward_rate (logbuf, rate) < 0)
+            goto done;
     } else if (!strcmp (name, "log-critical-level")) {
         int level = strtol (val, NULL, 10);
         if (logbuf_set_critical_level (logbuf, level) < 0)
@@ -428,6 +352,12 @@ static int logbuf_register_attrs (logbuf_t *logbuf, attr_t *attrs)
     if (attr_add_active (attrs, "log-forward-level", 0,
                          attr_get_log, attr_set_log, logbuf) < 0)
         goto done;
+    if (attr_add_active (attrs, "log-forward-rate", 0,
+                         attr_get_log, attr_set_log, logbuf) < 0)
+        goto done;
+    if (attr_add_active (attrs, "log-forward-dropped", 0,
+                         attr_get_log, NULL, logbuf) < 0)
+        goto done;
     if (attr_add_active (attrs, "log-critical-level", 0,
                          attr_get_log, attr_set_log, logbuf) < 0)
         goto done;
@@ -445,16 +375,164 @@ done:
     return rc;
 }
 
-static int logbuf_forward (logbuf_t *logbuf, const char *buf, int len)
+/* Add an entry to the forwarding batch.
+ * Returns -1 if there is no room for it.
+ */
+static int forward_batch_add (logbuf_t *logbuf, const char *buf, int len)
 {
-    assert (logbuf->magic == LOGBUF_MAGIC);
+    if (logbuf->fwd_len + len + 1 > forward_batch_bytes)
+        return -1;
+    memcpy (logbuf->fwd_buf + logbuf->fwd_len, buf, len);
+    logbuf->fwd_len += len;
+    logbuf->fwd_buf[logbuf->fwd_len++] = '\0';
+    logbuf->fwd_count++;
+    return 0;
+}
 
+/* Send the forwarding batch upstream in one log.append request.
+ */
+static void forward_batch_send (logbuf_t *logbuf)
+{
     flux_future_t *f;
-    if (!(f = flux_rpc_raw (logbuf->h, "log.append", buf, len,
-                              FLUX_NODEID_UPSTREAM, FLUX_RPC_NORESPONSE)))
-        return -1;
+
+    if (logbuf->fwd_count == 0)
+        return;
+    if (!(f = flux_rpc_raw (logbuf->h, "log.append",
+                            logbuf->fwd_buf, logbuf->fwd_len,
+                            FLUX_NODEID_UPSTREAM, FLUX_RPC_NORESPONSE)))
+        log_err ("%s: error forwarding log entries", __FUNCTION__);
     flux_future_destroy (f);
-    return 0;
+    logbuf->fwd_len = 0;
+    logbuf->fwd_count = 0;
+}
+
+/* Log (locally and upstream) how many entries were dropped by the
+ * forwarding rate limit since the last report, by severity.
+ */
+static void forward_report_dropped (logbuf_t *logbuf)
+{
+    struct stdlog_header hdr;
+    char timestamp[WALLCLOCK_MAXLEN];
+    char hostname[16];
+    char levels[256] = "";
+    char buf[FLUX_MAX_LOGBUF];
+    unsigned long total = 0;
+    int n = 0;
+    int len;
+    int i;
+
+    for (i = 0; i <= LOG_DEBUG; i++) {
+        if (logbuf->fwd_dropped[i] > 0) {
+            n += snprintf (levels + n, sizeof (levels) - n, " %s=%lu",
+                           stdlog_severity_to_string (i),
+                           logbuf->fwd_dropped[i]);
+            total += logbuf->fwd_dropped[i];
+            logbuf->fwd_dropped[i] = 0;
+        }
+    }
+    if (total == 0)
+        return;
+    stdlog_init (&hdr);
+    hdr.pri = STDLOG_PRI (LOG_WARNING, LOG_USER);
+    if (wallclock_get_zulu (timestamp, sizeof (timestamp)) >= 0)
+        hdr.timestamp = timestamp;
+    snprintf (hostname, sizeof (hostname), "%u", logbuf->rank);
+    hdr.hostname = hostname;
+    hdr.appname = "broker";
+    len = stdlog_encodef (buf, sizeof (buf), &hdr, STDLOG_NILVALUE,
+                          "log-forward-rate exceeded,"
+                          " dropped %lu entries:%s", total, levels);
+    if (len >= sizeof (buf))
+        len = sizeof (buf);
+    if (LOG_WARNING <= logbuf->level)
+        (void)append_new_entry (logbuf, buf, len);
+    if (forward_batch_add (logbuf, buf, len) < 0) {
+        forward_batch_send (logbuf);
+        (void)forward_batch_add (logbuf, buf, len);
+    }
+}
+
+static void logbuf_forward_flush (logbuf_t *logbuf)
+{
+    if (logbuf->fwd_timer_active) {
+        flux_watcher_stop (logbuf->fwd_timer);
+        logbuf->fwd_timer_active = false;
+    }
+    forward_report_dropped (logbuf);
+    forward_batch_send (logbuf);
+}
+
+static void forward_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
+                              int revents, void *arg)
+{
+    logbuf_t *logbuf = arg;
+
+    logbuf->fwd_timer_active = false;
+    logbuf_forward_flush (logbuf);
+}
+
+/* Arrange for the forwarding batch to be flushed after
+ * forward_batch_delay, unless it fills up first.
+ */
+static void forward_timer_start (logbuf_t *logbuf)
+{
+    if (!logbuf->fwd_timer) {
+        logbuf_forward_flush (logbuf);
+        return;
+    }
+    if (!logbuf->fwd_timer_active) {
+        flux_timer_watcher_reset (logbuf->fwd_timer, forward_batch_delay, 0.);
+        flux_watcher_start (logbuf->fwd_timer);
+        logbuf->fwd_timer_active = true;
+    }
+}
+
+/* Take a token from the forwarding rate limit bucket, which refills
+ * at forward_rate tokens per second up to a burst of forward_rate.
+ * Returns false if the bucket is empty.
+ */
+static bool forward_permit (logbuf_t *logbuf)
+{
+    double now;
+
+    if (logbuf->forward_rate == 0)
+        return true;
+    now = flux_reactor_now (flux_get_reactor (logbuf->h));
+    logbuf->fwd_tokens += (now - logbuf->fwd_t) * logbuf->forward_rate;
+    if (logbuf->fwd_tokens > logbuf->forward_rate)
+        logbuf->fwd_tokens = logbuf->forward_rate;
+    logbuf->fwd_t = now;
+    if (logbuf->fwd_tokens < 1.)
+        return false;
+    logbuf->fwd_tokens -= 1.;
+    return true;
+}
+
+/* Queue an entry for forwarding upstream.  Entries above critical_level
+ * are subject to the rate limit; those dropped are counted and reported
+ * with the next batch.
+ */
+static void logbuf_forward (logbuf_t *logbuf, int severity,
+                            const char *buf, int len)
+{
+    assert (logbuf->magic == LOGBUF_MAGIC);
+
+    if (severity > logbuf->critical_level && !forward_permit (logbuf)) {
+        logbuf->fwd_dropped[severity]++;
+        logbuf->fwd_dropped_total++;
+        forward_timer_start (logbuf);
+        return;
+    }
+    if (len >= forward_batch_bytes)
+        len = forward_batch_bytes - 1;
+    if (forward_batch_add (logbuf, buf, len) < 0) {
+        forward_batch_send (logbuf);
+        (void)forward_batch_add (logbuf, buf, len);
+    }
+    if (logbuf->fwd_count >= forward_batch_count)
+        logbuf_forward_flush (logbuf);
+    else
+        forward_timer_start (logbuf);
 }
 
 static int logbuf_append (logbuf_t *logbuf, const char *buf, int len)
@@ -483,12 +561,10 @@ static int logbuf_append (logbuf_t *logbuf, const char *buf, int len)
         }
     }
     if (severity <= logbuf->forward_level) {
-        if (logbuf->rank == 0) {
+        if (logbuf->rank == 0)
             flux_log_fprint (buf, len, logbuf->f);
-        } else {
-            if (logbuf_forward (logbuf, buf, len) < 0)
-                rc = -1;
-        }
+        else
+            logbuf_forward (logbuf, severity, buf, len);
     }
     if (!logged_stderr && severity <= logbuf->stderr_level && logbuf->rank == 0)
         flux_log_fprint (buf, len, stderr);
@@ -506,6 +582,7 @@ static void logbuf_append_redirect (const char *buf, int len, void *arg)
 }
 
 /* N.B. log requests have no response.
+ * A request may carry a batch of entries, each terminated by a NUL.
  */
 static void append_request_cb (flux_t *h, flux_msg_handler_t *mh,
                                const flux_msg_t *msg, void *arg)
@@ -521,8 +598,16 @@ static void append_request_cb (flux_t *h, flux_msg_handler_t *mh,
     }
     if (flux_request_decode_raw (msg, NULL, (const void **)&buf, &len) < 0)
         goto error;
-    if (logbuf_append (logbuf, buf, len) < 0)
-        goto error;
+    while (len > 0) {
+        const char *end = memchr (buf, '\0', len);
+        int n = end ? end - buf : len;
+        if (n > 0 && logbuf_append (logbuf, buf, n) < 0)
+            goto error;
+        if (end)
+            n++;
+        buf += n;
+        len -= n;
+    }
     if (matchtag != FLUX_MATCHTAG_NONE) {
         if (flux_respond (h, msg, NULL) < 0)
             log_err ("%s: error responding to log request", __FUNCTION__);
@@ -543,13 +628,17 @@ static void clear_request_cb (flux_t *h, flux_msg_handler_t *mh,
 
     if (flux_request_unpack (msg, NULL, "{ s:i }", "seq", &seq) < 0)
         goto error;
-    logbuf_clear (logbuf, seq);
+    logring_clear (logbuf->ring, seq);
     flux_respond (h, msg, NULL);
     return;
 error:
     flux_respond_error (h, msg, errno, NULL);
 }
 
+/* Respond with each entry after 'seq', then either end the stream with
+ * ENODATA, or if 'follow' is set, keep the request to respond with new
+ * entries as they are appended.  Requests must set FLUX_RPC_STREAMING.
+ */
 static void dmesg_request_cb (flux_t *h, flux_msg_handler_t *mh,
                               const flux_msg_t *msg, void *arg)
 {
@@ -557,29 +646,39 @@ static void dmesg_request_cb (flux_t *h, flux_msg_handler_t *mh,
     const char *buf;
     int len;
     int seq, follow;
+    flux_msg_t *cpy;
 
     if (flux_request_unpack (msg, NULL, "{ s:i s:b }",
                              "seq", &seq,
                              "follow", &follow) < 0)
         goto error;
-    if (logbuf_get (logbuf, seq, &seq, &buf, &len) < 0) {
-        if (follow && errno == ENOENT) {
-            if (logbuf_sleepon (logbuf, dmesg_request_cb, h, mh, msg, arg) < 0)
-                goto error;
-            return; /* no reply */
-        }
+    if (!flux_msg_is_streaming (msg)) {
+        errno = EPROTO;
         goto error;
     }
-    flux_respond_pack (h, msg, "{ s:i s:s# }",
-                               "seq", seq,
-                               "buf", buf, len);
-    return;
-
+    while (logring_next (logbuf->ring, seq, &seq, &buf, &len) == 0) {
+        if (dmesg_respond (h, msg, seq, buf, len) < 0) {
+            log_err ("%s: error responding to log.dmesg", __FUNCTION__);
+            return;
+        }
+    }
+    if (follow) {
+        if (!(cpy = flux_msg_copy (msg, false)))
+            goto error;
+        if (zlist_append (logbuf->followers, cpy) < 0) {
+            flux_msg_destroy (cpy);
+            errno = ENOMEM;
+            goto error;
+        }
+        return; /* no reply until new entries are appended */
+    }
+    errno = ENODATA;
 error:
-    flux_respond_error (h, msg, errno, NULL);
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        log_err ("%s: error responding to log.dmesg", __FUNCTION__);
 }
 
-static int cmp_sender (flux_msg_t *msg, const char *uuid)
+static int cmp_sender (const flux_msg_t *msg, const char *uuid)
 {
     char *sender = NULL;
     int rc = 0;
@@ -599,27 +698,26 @@ static void disconnect_request_cb (flux_t *h, flux_msg_handler_t *mh,
 {
     logbuf_t *logbuf = arg;
     char *sender = NULL;
-    struct sleeper *s;
+    flux_msg_t *req;
     zlist_t *tmp = NULL;
 
     assert (logbuf->magic == LOGBUF_MAGIC);
     if (flux_msg_get_route_first (msg, &sender) < 0 || !sender)
         goto done;
-    s = zlist_first (logbuf->sleepers);
-    while (s) {
-        assert (s->magic == SLEEPER_MAGIC);
-        if (cmp_sender (s->msg, sender)) {
+    req = zlist_first (logbuf->followers);
+    while (req) {
+        if (cmp_sender (req, sender)) {
             if (!tmp && !(tmp = zlist_new ()))
                 goto done;
-            if (zlist_append (tmp, s) < 0)
+            if (zlist_append (tmp, req) < 0)
                 goto done;
         }
-        s = zlist_next (logbuf->sleepers);
+        req = zlist_next (logbuf->followers);
     }
     if (tmp) {
-        while ((s = zlist_pop (tmp))) {
-            zlist_remove (logbuf->sleepers, s);
-            sleeper_destroy (s);
+        while ((req = zlist_pop (tmp))) {
+            zlist_remove (logbuf->followers, req);
+            flux_msg_destroy (req);
         }
     }
 done:
@@ -639,6 +737,8 @@ static const struct flux_msg_handler_spec htab[] = {
 static void logbuf_finalize (void *arg)
 {
     logbuf_t *logbuf = arg;
+    if (logbuf->rank > 0)
+        logbuf_forward_flush (logbuf);
     flux_msg_handler_delvec (logbuf->handlers);
     logbuf_destroy (logbuf);
     /* FIXME: need logbuf_unregister_attrs() */
@@ -662,6 +762,12 @@ int logbuf_initialize (flux_t *h, uint32_t rank, attr_t *attrs)
         goto error;
     if (flux_msg_handler_addvec (h, htab, logbuf, &logbuf->handlers) < 0)
         goto error;
+    if (!(logbuf->fwd_timer = flux_timer_watcher_create (flux_get_reactor (h),
+                                                         forward_batch_delay,
+                                                         0.,
+                                                         forward_timer_cb,
+                                                         logbuf)))
+        goto error;
     flux_log_set_appname (h, "broker");
     flux_log_set_redirect (h, logbuf_append_redirect, logbuf);
     logbuf->h = h;
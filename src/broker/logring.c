@@ -0,0 +1,232 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* logring.c - fixed-size ring of log records
+ *
+ * Stored records occupy the buffer from the offset of the oldest ('tail')
+ * up to 'head', possibly wrapping once past the end.  A record that does
+ * not fit between 'head' and the end of the buffer is written at offset
+ * zero instead, leaving the end unused until the records before it are
+ * dropped.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <flux/core.h>
+
+#include "logring.h"
+
+struct entry {
+    size_t offset;
+    int len;
+};
+
+struct logring {
+    int max_entries;
+    struct entry *index;    /* entry for seq is index[seq % max_entries] */
+    int first;              /* seq of oldest record */
+    int next;               /* seq of next record */
+    char *buf;
+    size_t size;
+    size_t head;            /* offset following newest record */
+};
+
+static size_t buffer_size (int max_entries)
+{
+    size_t size = (size_t)max_entries * LOGRING_ENTRY_BYTES;
+
+    /* Always room for two records of the maximum size flux_log() creates.
+     */
+    if (size < 2 * FLUX_MAX_LOGBUF)
+        size = 2 * FLUX_MAX_LOGBUF;
+    return size;
+}
+
+void logring_destroy (struct logring *r)
+{
+    if (r) {
+        int saved_errno = errno;
+        free (r->index);
+        free (r->buf);
+        free (r);
+        errno = saved_errno;
+    }
+}
+
+struct logring *logring_create (int max_entries)
+{
+    struct logring *r;
+
+    if (max_entries < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(r = calloc (1, sizeof (*r))))
+        return NULL;
+    r->max_entries = max_entries;
+    r->size = buffer_size (max_entries);
+    if (!(r->buf = malloc (r->size)))
+        goto error;
+    if (max_entries > 0
+        && !(r->index = calloc (max_entries, sizeof (r->index[0]))))
+        goto error;
+    return r;
+error:
+    logring_destroy (r);
+    errno = ENOMEM;
+    return NULL;
+}
+
+static struct entry *entry_get (struct logring *r, int seq)
+{
+    return &r->index[seq % r->max_entries];
+}
+
+static void drop_oldest (struct logring *r)
+{
+    if (++r->first == r->next)
+        r->head = 0;
+}
+
+/* Find the offset where a record of 'len' bytes can be written without
+ * overwriting stored records, or return -1 if there is none.
+ */
+static long find_space (struct logring *r, int len)
+{
+    size_t tail;
+
+    if (r->first == r->next)
+        return 0;
+    tail = entry_get (r, r->first)->offset;
+    if (tail < r->head) {
+        if (len <= r->size - r->head)
+            return r->head;
+        if (len <= tail)
+            return 0;
+    }
+    else if (tail > r->head && len <= tail - r->head)
+        return r->head;
+    return -1;
+}
+
+int logring_append (struct logring *r, const char *buf, int len)
+{
+    struct entry *e;
+    long offset;
+
+    if (!r || !buf || len < 1 || r->max_entries == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (len > r->size) {
+        errno = E2BIG;
+        return -1;
+    }
+    if (r->next - r->first == r->max_entries)
+        drop_oldest (r);
+    while ((offset = find_space (r, len)) < 0)
+        drop_oldest (r);
+    memcpy (r->buf + offset, buf, len);
+    e = entry_get (r, r->next);
+    e->offset = offset;
+    e->len = len;
+    r->head = offset + len;
+    return r->next++;
+}
+
+int logring_next (struct logring *r, int seq, int *next,
+                  const char **buf, int *len)
+{
+    struct entry *e;
+
+    if (!r) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (++seq < r->first)
+        seq = r->first;
+    if (seq >= r->next) {
+        errno = ENOENT;
+        return -1;
+    }
+    e = entry_get (r, seq);
+    if (next)
+        *next = seq;
+    if (buf)
+        *buf = r->buf + e->offset;
+    if (len)
+        *len = e->len;
+    return 0;
+}
+
+void logring_clear (struct logring *r, int seq)
+{
+    if (r) {
+        if (seq < 0 || seq >= r->next)
+            seq = r->next - 1;
+        if (seq >= r->first) {
+            r->first = seq + 1;
+            if (r->first == r->next)
+                r->head = 0;
+        }
+    }
+}
+
+int logring_resize (struct logring *r, int max_entries)
+{
+    struct logring *new;
+    int seq;
+
+    if (!r || max_entries < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(new = logring_create (max_entries)))
+        return -1;
+    seq = r->next - max_entries;
+    if (seq < r->first)
+        seq = r->first;
+    new->first = new->next = seq;
+    for (; seq < r->next; seq++) {
+        struct entry *e = entry_get (r, seq);
+        if (logring_append (new, r->buf + e->offset, e->len) < 0) {
+            new->first = new->next = seq + 1; // too big for the new buffer
+            new->head = 0;
+        }
+    }
+    free (r->index);
+    free (r->buf);
+    *r = *new;
+    free (new);
+    return 0;
+}
+
+int logring_size (struct logring *r)
+{
+    return r ? r->max_entries : 0;
+}
+
+int logring_count (struct logring *r)
+{
+    return r ? r->next - r->first : 0;
+}
+
+int logring_seq (struct logring *r)
+{
+    return r ? r->next : 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,64 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _BROKER_LOGRING_H
+#define _BROKER_LOGRING_H
+
+/* Fixed-size ring of log records (RFC 5424 strings, see stdlog.h).
+ *
+ * Records are stored back to back in one contiguous buffer, never split
+ * across its end, and indexed by sequence number, so finding a record is
+ * O(1) and it can be read in place.  The buffer holds LOGRING_ENTRY_BYTES
+ * per entry on average; when either the entries or the buffer are used
+ * up, the oldest records are dropped.
+ *
+ * Sequence numbers start at zero and count every record appended.
+ */
+
+#define LOGRING_ENTRY_BYTES     512
+
+struct logring;
+
+struct logring *logring_create (int max_entries);
+void logring_destroy (struct logring *r);
+
+/* Append a record, dropping the oldest records to make room.
+ * Returns its sequence number, or -1 on error (EINVAL, E2BIG if the
+ * record is larger than the buffer).
+ */
+int logring_append (struct logring *r, const char *buf, int len);
+
+/* Find the oldest record with a sequence number greater than 'seq',
+ * setting '*next' to its sequence number and 'buf', 'len' to the record,
+ * which is valid until the next logring_append() or logring_resize().
+ * Returns -1 on error (ENOENT if there is no such record), 0 on success.
+ */
+int logring_next (struct logring *r, int seq, int *next,
+                  const char **buf, int *len);
+
+/* Drop records with sequence number up to and including 'seq',
+ * or all records if 'seq' is -1.
+ */
+void logring_clear (struct logring *r, int seq);
+
+/* Change the maximum number of entries, keeping the newest records
+ * that fit.  Returns -1 on error (EINVAL, ENOMEM), 0 on success.
+ */
+int logring_resize (struct logring *r, int max_entries);
+
+int logring_size (struct logring *r);   /* maximum entries */
+int logring_count (struct logring *r);  /* entries stored */
+int logring_seq (struct logring *r);    /* entries ever appended */
+
+#endif /* !_BROKER_LOGRING_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,294 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* modpipe.c - zero-copy broker <-> module message channel
+ *
+ * Replaces the inproc:// PAIR socket used by the shmem connector.
+ * That path encodes each message into zmq frames on send and decodes it
+ * again on receive; here the flux_msg_t itself is handed over.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/mpscq.h"
+#include "src/common/libutil/monotime.h"
+
+#include "modpipe.h"
+
+#define MODPIPE_MAGIC   0xfeefbe03
+
+struct modpipe {
+    mpscq_t *to_module;
+    mpscq_t *to_broker;
+};
+
+struct modpipe_handle {
+    int magic;
+    struct modpipe *mp;
+    flux_t *h;
+};
+
+/* Messages to the broker carry the time they were queued.
+ */
+struct queued {
+    flux_msg_t *msg;
+    struct timespec t;
+};
+
+static const struct flux_handle_ops handle_ops;
+
+static void msg_destroy (void *item)
+{
+    flux_msg_destroy (item);
+}
+
+static void queued_destroy (void *item)
+{
+    struct queued *q = item;
+
+    if (q) {
+        int saved_errno = errno;
+        flux_msg_destroy (q->msg);
+        free (q);
+        errno = saved_errno;
+    }
+}
+
+static int pollevents (mpscq_t *q)
+{
+    int e;
+    int revents = 0;
+
+    if ((e = mpscq_pollevents (q)) < 0)
+        return FLUX_POLLERR;
+    if (e & POLLIN)
+        revents |= FLUX_POLLIN;
+    if (e & POLLOUT)
+        revents |= FLUX_POLLOUT;
+    return revents;
+}
+
+/* Broker end
+ */
+
+int modpipe_send (struct modpipe *mp, flux_msg_t *msg)
+{
+    if (mpscq_push (mp->to_module, msg) < 0) {
+        flux_msg_destroy (msg);
+        return -1;
+    }
+    return 0;
+}
+
+flux_msg_t *modpipe_recv (struct modpipe *mp, struct timespec *t_queued)
+{
+    struct queued *q;
+    flux_msg_t *msg;
+
+    if (!(q = mpscq_pop (mp->to_broker))) {
+        errno = EWOULDBLOCK;
+        return NULL;
+    }
+    msg = q->msg;
+    if (t_queued)
+        *t_queued = q->t;
+    free (q);
+    return msg;
+}
+
+int modpipe_pollevents (struct modpipe *mp)
+{
+    return pollevents (mp->to_broker);
+}
+
+int modpipe_pollfd (struct modpipe *mp)
+{
+    return mpscq_pollfd (mp->to_broker);
+}
+
+void modpipe_destroy (struct modpipe *mp)
+{
+    if (mp) {
+        int saved_errno = errno;
+        mpscq_destroy (mp->to_module);
+        mpscq_destroy (mp->to_broker);
+        free (mp);
+        errno = saved_errno;
+    }
+}
+
+struct modpipe *modpipe_create (void)
+{
+    struct modpipe *mp;
+
+    if (!(mp = calloc (1, sizeof (*mp))))
+        return NULL;
+    if (!(mp->to_module = mpscq_create (msg_destroy)))
+        goto error;
+    if (!(mp->to_broker = mpscq_create (queued_destroy)))
+        goto error;
+    return mp;
+error:
+    modpipe_destroy (mp);
+    return NULL;
+}
+
+/* Module end (connector)
+ */
+
+static int op_pollevents (void *impl)
+{
+    struct modpipe_handle *ctx = impl;
+    assert (ctx->magic == MODPIPE_MAGIC);
+
+    return pollevents (ctx->mp->to_module);
+}
+
+static int op_pollfd (void *impl)
+{
+    struct modpipe_handle *ctx = impl;
+    assert (ctx->magic == MODPIPE_MAGIC);
+
+    return mpscq_pollfd (ctx->mp->to_module);
+}
+
+static int op_send (void *impl, const flux_msg_t *msg, int flags)
+{
+    struct modpipe_handle *ctx = impl;
+    assert (ctx->magic == MODPIPE_MAGIC);
+    struct queued *q;
+
+    if (!(q = calloc (1, sizeof (*q))))
+        return -1;
+    if (!(q->msg = flux_msg_copy (msg, true)))
+        goto error;
+    monotime (&q->t);
+    if (mpscq_push (ctx->mp->to_broker, q) < 0)
+        goto error;
+    return 0;
+error:
+    queued_destroy (q);
+    return -1;
+}
+
+static flux_msg_t *op_recv (void *impl, int flags)
+{
+    struct modpipe_handle *ctx = impl;
+    assert (ctx->magic == MODPIPE_MAGIC);
+    mpscq_t *q = ctx->mp->to_module;
+    flux_msg_t *msg;
+
+    while (!(msg = mpscq_pop (q))) {
+        struct pollfd pfd = {
+            .fd = mpscq_pollfd (q),
+            .events = POLLIN,
+            .revents = 0,
+        };
+        int e;
+
+        if ((e = mpscq_pollevents (q)) < 0)
+            return NULL;
+        if ((e & POLLIN))
+            continue;
+        if ((flags & FLUX_O_NONBLOCK)) {
+            errno = EWOULDBLOCK;
+            return NULL;
+        }
+        if (poll (&pfd, 1, -1) < 0 && errno != EINTR)
+            return NULL;
+    }
+    return msg;
+}
+
+static int op_event_subscribe (void *impl, const char *topic)
+{
+    struct modpipe_handle *ctx = impl;
+    assert (ctx->magic == MODPIPE_MAGIC);
+    flux_future_t *f;
+    int rc = -1;
+
+    if (!(f = flux_rpc_pack (ctx->h, "cmb.sub", FLUX_NODEID_ANY, 0,
+                             "{ s:s }", "topic", topic)))
+        goto done;
+    if (flux_future_get (f, NULL) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    return rc;
+}
+
+static int op_event_unsubscribe (void *impl, const char *topic)
+{
+    struct modpipe_handle *ctx = impl;
+    assert (ctx->magic == MODPIPE_MAGIC);
+    flux_future_t *f;
+    int rc = -1;
+
+    if (!(f = flux_rpc_pack (ctx->h, "cmb.unsub", FLUX_NODEID_ANY, 0,
+                             "{ s:s }", "topic", topic)))
+        goto done;
+    if (flux_future_get (f, NULL) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    return rc;
+}
+
+static void op_fini (void *impl)
+{
+    struct modpipe_handle *ctx = impl;
+    assert (ctx->magic == MODPIPE_MAGIC);
+    ctx->magic = ~MODPIPE_MAGIC;
+    free (ctx);
+}
+
+flux_t *modpipe_open (struct modpipe *mp, int flags)
+{
+    struct modpipe_handle *ctx;
+
+    if (!mp) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(ctx = calloc (1, sizeof (*ctx))))
+        return NULL;
+    ctx->magic = MODPIPE_MAGIC;
+    ctx->mp = mp;
+    if (!(ctx->h = flux_handle_create (ctx, &handle_ops, flags))) {
+        op_fini (ctx);
+        return NULL;
+    }
+    return ctx->h;
+}
+
+static const struct flux_handle_ops handle_ops = {
+    .pollfd = op_pollfd,
+    .pollevents = op_pollevents,
+    .send = op_send,
+    .recv = op_recv,
+    .getopt = NULL,
+    .setopt = NULL,
+    .event_subscribe = op_event_subscribe,
+    .event_unsubscribe = op_event_unsubscribe,
+    .impl_destroy = op_fini,
+};
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
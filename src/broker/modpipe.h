@@ -0,0 +1,51 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _BROKER_MODPIPE_H
+#define _BROKER_MODPIPE_H
+
+#include <time.h>
+#include <flux/core.h>
+
+/* In-process message channel between the broker and a module thread.
+ * Messages pass by pointer through a pair of lock-free queues, and
+ * ownership moves with them, so nothing is serialized or copied
+ * except where the flux_t send API demands a const message.
+ */
+
+struct modpipe;
+
+struct modpipe *modpipe_create (void);
+void modpipe_destroy (struct modpipe *mp);
+
+/* Open the module end of 'mp' as a flux_t handle (module thread).
+ * Event subscriptions are forwarded to the broker with cmb.sub/cmb.unsub,
+ * as for the shmem connector.  'mp' must outlive the handle.
+ */
+flux_t *modpipe_open (struct modpipe *mp, int flags);
+
+/* Broker end of 'mp' (broker thread).
+ * modpipe_send() takes ownership of 'msg', even on failure.
+ * modpipe_recv() returns NULL with errno = EWOULDBLOCK if empty.
+ * If 't_queued' is non-NULL, it is set to the monotonic time at which
+ * the module sent the message, for measuring queueing delay.
+ * modpipe_pollevents() returns a FLUX_POLL* mask, and modpipe_pollfd()
+ * becomes readable when FLUX_POLLIN is raised, as for a flux_t handle.
+ */
+int modpipe_send (struct modpipe *mp, flux_msg_t *msg);
+flux_msg_t *modpipe_recv (struct modpipe *mp, struct timespec *t_queued);
+int modpipe_pollevents (struct modpipe *mp);
+int modpipe_pollfd (struct modpipe *mp);
+
+#endif /* !_BROKER_MODPIPE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -31,6 +31,8 @@
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/oom.h"
 #include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/hist.h"
+#include "src/common/libflux/rpc_private.h"
 
 #include "module.h"
 #include "modservice.h"
@@ -72,14 +74,36 @@ static modservice_ctx_t *getctx (flux_t *h, module_t *p)
     return ctx;
 }
 
+/* Encode the module's RPC round trip histogram, or an empty one if it
+ * has not sent any RPCs yet.
+ */
+static json_t *rpc_latency_encode (flux_t *h)
+{
+    struct hist *hist = rpc_latency_hist (h);
+    struct hist *empty = NULL;
+    json_t *o;
+
+    if (!hist && !(hist = empty = hist_create ()))
+        return NULL;
+    o = hist_encode (hist);
+    hist_destroy (empty);
+    return o;
+}
+
 static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
                           const flux_msg_t *msg, void *arg)
 {
     flux_msgcounters_t mcs;
+    json_t *rpc;
 
     flux_get_msgcounters (h, &mcs);
 
-    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:i s:i s:i s:i }",
+    if (!(rpc = rpc_latency_encode (h))) {
+        if (flux_respond_error (h, msg, errno, NULL) < 0)
+            FLUX_LOG_ERROR (h);
+        return;
+    }
+    if (flux_respond_pack (h, msg, "{ s:i s:i s:i s:i s:i s:i s:i s:i s:o }",
                            "#request (tx)", mcs.request_tx,
                            "#request (rx)", mcs.request_rx,
                            "#response (tx)", mcs.response_tx,
@@ -87,7 +111,8 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
                            "#event (tx)", mcs.event_tx,
                            "#event (rx)", mcs.event_rx,
                            "#keepalive (tx)", mcs.keepalive_tx,
-                           "#keepalive (rx)", mcs.keepalive_rx) < 0)
+                           "#keepalive (rx)", mcs.keepalive_rx,
+                           "rpc latency (us)", rpc) < 0)
       FLUX_LOG_ERROR (h);
 }
 
@@ -95,12 +120,14 @@ static void stats_clear_event_cb (flux_t *h, flux_msg_handler_t *mh,
                                   const flux_msg_t *msg, void *arg)
 {
     flux_clr_msgcounters (h);
+    hist_clear (rpc_latency_hist (h));
 }
 
 static void stats_clear_request_cb (flux_t *h, flux_msg_handler_t *mh,
                                     const flux_msg_t *msg, void *arg)
 {
     flux_clr_msgcounters (h);
+    hist_clear (rpc_latency_hist (h));
     if (flux_respond (h, msg, NULL) < 0)
         FLUX_LOG_ERROR (h);
 }
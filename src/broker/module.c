@@ -42,6 +42,12 @@
 #include "heartbeat.h"
 #include "module.h"
 #include "modservice.h"
+#include "modpipe.h"
+
+/* Max messages handled per module_cb() invocation, so that a busy module
+ * cannot starve the rest of the broker reactor.
+ */
+static const int module_cb_batch = 64;
 
 
 #define MODULE_MAGIC    0xfeefbe01
@@ -51,10 +57,12 @@ struct module_struct {
     uint32_t rank;
     flux_t *broker_h;
     flux_watcher_t *broker_w;
+    bool *cb_alive;         /* cleared if destroyed within module_cb() */
 
     int lastseen;
     heartbeat_t *heartbeat;
 
+    struct modpipe *pipe;   /* message queues, or NULL for PAIR socket */
     zsock_t *sock;          /* broker end of PAIR socket */
     uint32_t userid;        /* creds of connection */
     uint32_t rolemask;
@@ -89,6 +97,7 @@ struct modhash_struct {
     uint32_t rank;
     flux_t *broker_h;
     heartbeat_t *heartbeat;
+    bool use_inproc;
 };
 
 static int setup_module_profiling (module_t *p)
@@ -119,7 +128,11 @@ static void *module_thread (void *arg)
 
     /* Connect to broker socket, enable logging, register built-in services
      */
-    if (!(p->h = flux_open (uri, 0)))
+    if (p->pipe) {
+        if (!(p->h = modpipe_open (p->pipe, 0)))
+            log_err_exit ("%s: modpipe_open", p->name);
+    }
+    else if (!(p->h = flux_open (uri, 0)))
         log_err_exit ("flux_open %s", uri);
     rankstr = xasprintf ("%"PRIu32, p->rank);
     if (flux_attr_set_cacheonly (p->h, "rank", rankstr) < 0) {
@@ -191,7 +204,7 @@ static int module_get_idle (module_t *p)
     return heartbeat_get_epoch (p->heartbeat) - p->lastseen;
 }
 
-flux_msg_t *module_recvmsg (module_t *p)
+flux_msg_t *module_recvmsg (module_t *p, struct timespec *t_queued)
 {
     flux_msg_t *msg = NULL;
     int type;
@@ -199,7 +212,14 @@ flux_msg_t *module_recvmsg (module_t *p)
 
     assert (p->magic == MODULE_MAGIC);
 
-    if (!(msg = flux_msg_recvzsock (p->sock)))
+    if (p->pipe)
+        msg = modpipe_recv (p->pipe, t_queued);
+    else {
+        msg = flux_msg_recvzsock (p->sock);
+        if (t_queued)
+            memset (t_queued, 0, sizeof (*t_queued));
+    }
+    if (!msg)
         goto error;
     if (flux_msg_get_type (msg, &type) < 0)
         goto error;
@@ -241,7 +261,7 @@ error:
     return NULL;
 }
 
-int module_sendmsg (module_t *p, const flux_msg_t *msg)
+static int module_sendmsg_sock (module_t *p, const flux_msg_t *msg)
 {
     flux_msg_t *cpy = NULL;
     int type;
@@ -283,6 +303,49 @@ done:
     return rc;
 }
 
+/* Requests and responses need a copy anyway to fix up the route stack,
+ * so hand that copy straight to the module.  Only events are copied
+ * just to transfer ownership.
+ */
+static int module_sendmsg_pipe (module_t *p, const flux_msg_t *msg)
+{
+    flux_msg_t *cpy;
+    int type;
+
+    if (flux_msg_get_type (msg, &type) < 0)
+        return -1;
+    if (!(cpy = flux_msg_copy (msg, true)))
+        return -1;
+    switch (type) {
+        case FLUX_MSGTYPE_REQUEST: { /* simulate DEALER socket */
+            char uuid[16];
+            snprintf (uuid, sizeof (uuid), "%"PRIu32, p->rank);
+            if (flux_msg_push_route (cpy, uuid) < 0)
+                goto error;
+            break;
+        }
+        case FLUX_MSGTYPE_RESPONSE: /* simulate ROUTER socket */
+            if (flux_msg_pop_route (cpy, NULL) < 0)
+                goto error;
+            break;
+        default:
+            break;
+    }
+    return modpipe_send (p->pipe, cpy);
+error:
+    flux_msg_destroy (cpy);
+    return -1;
+}
+
+int module_sendmsg (module_t *p, const flux_msg_t *msg)
+{
+    if (!msg)
+        return 0;
+    if (p->pipe)
+        return module_sendmsg_pipe (p, msg);
+    return module_sendmsg_sock (p, msg);
+}
+
 int module_response_sendmsg (modhash_t *mh, const flux_msg_t *msg)
 {
     char *uuid = NULL;
@@ -323,9 +386,13 @@ static void module_destroy (module_t *p)
 
     flux_close (p->h); // in case thread was canceled
 
+    if (p->cb_alive)
+        *p->cb_alive = false;
+
     flux_watcher_stop (p->broker_w);
     flux_watcher_destroy (p->broker_w);
     zsock_destroy (&p->sock);
+    modpipe_destroy (p->pipe);
 
     dlclose (p->dso);
     zuuid_destroy (&p->uuid);
@@ -373,9 +440,29 @@ static void module_cb (flux_reactor_t *r, flux_watcher_t *w,
 {
     module_t *p = arg;
     assert (p->magic == MODULE_MAGIC);
+    bool alive = true;
+    int n;
+
     p->lastseen = heartbeat_get_epoch (p->heartbeat);
-    if (p->poller_cb)
+    if (!p->poller_cb)
+        return;
+    if (!p->pipe) {
         p->poller_cb (p, p->poller_arg);
+        return;
+    }
+    /* The pipe's pollfd stays readable while messages are queued,
+     * so stopping after a batch is safe.  The poller callback may remove
+     * the module once it has exited, so watch for that.
+     */
+    p->cb_alive = &alive;
+    for (n = 0; n < module_cb_batch; n++) {
+        if (!(modpipe_pollevents (p->pipe) & FLUX_POLLIN))
+            break;
+        p->poller_cb (p, p->poller_arg);
+        if (!alive)
+            return;
+    }
+    p->cb_alive = NULL;
 }
 
 int module_start (module_t *p)
@@ -541,16 +628,30 @@ module_t *module_add (modhash_t *mh, const char *path)
     p->broker_h = mh->broker_h;
     p->heartbeat = mh->heartbeat;
 
-    /* Broker end of PAIR socket is opened here.
+    /* Broker end of message queues, or PAIR socket if configured,
+     * is opened here.
      */
-    if (!(p->sock = zsock_new_pair (NULL)))
-        log_err_exit ("zsock_new_pair");
-    if (zsock_bind (p->sock, "inproc://%s", module_get_uuid (p)) < 0)
-        log_err_exit ("zsock_bind inproc://%s", module_get_uuid (p));
-    if (!(p->broker_w = flux_zmq_watcher_create (flux_get_reactor (p->broker_h),
-                                                 p->sock, FLUX_POLLIN,
-                                                 module_cb, p)))
-        log_err_exit ("flux_zmq_watcher_create");
+    if (!mh->use_inproc) {
+        if (!(p->pipe = modpipe_create ()))
+            log_err_exit ("modpipe_create");
+        if (!(p->broker_w = flux_fd_watcher_create (
+                                            flux_get_reactor (p->broker_h),
+                                            modpipe_pollfd (p->pipe),
+                                            FLUX_POLLIN,
+                                            module_cb, p)))
+            log_err_exit ("flux_fd_watcher_create");
+    }
+    else {
+        if (!(p->sock = zsock_new_pair (NULL)))
+            log_err_exit ("zsock_new_pair");
+        if (zsock_bind (p->sock, "inproc://%s", module_get_uuid (p)) < 0)
+            log_err_exit ("zsock_bind inproc://%s", module_get_uuid (p));
+        if (!(p->broker_w = flux_zmq_watcher_create (
+                                            flux_get_reactor (p->broker_h),
+                                            p->sock, FLUX_POLLIN,
+                                            module_cb, p)))
+            log_err_exit ("flux_zmq_watcher_create");
+    }
     /* Set creds for connection.
      * Since this is a point to point connection between broker threads,
      * credentials are always those of the instance owner.
@@ -614,6 +715,19 @@ void modhash_set_heartbeat (modhash_t *mh, heartbeat_t *hb)
     mh->heartbeat = hb;
 }
 
+int modhash_set_transport (modhash_t *mh, const char *name)
+{
+    if (!strcmp (name, "queue"))
+        mh->use_inproc = false;
+    else if (!strcmp (name, "inproc"))
+        mh->use_inproc = true;
+    else {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
 json_t *module_get_modlist (modhash_t *mh, struct service_switch *sw)
 {
     json_t *mods = NULL;
@@ -11,6 +11,7 @@
 #ifndef _BROKER_MODULE_H
 #define _BROKER_MODULE_H
 
+#include <time.h>
 #include <jansson.h>
 
 #include "heartbeat.h"
@@ -30,6 +31,12 @@ void modhash_set_rank (modhash_t *mh, uint32_t rank);
 void modhash_set_flux (modhash_t *mh, flux_t *h);
 void modhash_set_heartbeat (modhash_t *mh, heartbeat_t *hb);
 
+/* Select how modules subsequently added exchange messages with the broker:
+ * "queue" (default) passes message pointers through lock-free queues,
+ * "inproc" encodes them over a zeromq inproc:// PAIR socket.
+ */
+int modhash_set_transport (modhash_t *mh, const char *name);
+
 /* Prepare module at 'path' for starting.
  */
 module_t *module_add (modhash_t *mh, const char *path);
@@ -54,8 +61,10 @@ const char *module_get_uuid (module_t *p);
 void module_set_poller_cb (module_t *p, modpoller_cb_f cb, void *arg);
 
 /* Send/recv a message for to/from a specific module.
+ * If 't_queued' is non-NULL, module_recvmsg() sets it to the time the
+ * module queued the message, or clears it if that is unknown.
  */
-flux_msg_t *module_recvmsg (module_t *p);
+flux_msg_t *module_recvmsg (module_t *p, struct timespec *t_queued);
 int module_sendmsg (module_t *p, const flux_msg_t *msg);
 
 /* Send an event message to all modules that have matching subscription.
@@ -0,0 +1,280 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* msgstats.c - per-topic message accounting
+ *
+ * Called once for every message entering the broker's routing logic,
+ * so the common case (topic already known) is one hash lookup and a few
+ * increments.  Topics are not normalized, so the cap on table size is
+ * what protects against topics with embedded identifiers, e.g.
+ * "kvs.setroot-<namespace>".
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/hist.h"
+
+#include "msgstats.h"
+
+enum {
+    TYPE_REQUEST,
+    TYPE_RESPONSE,
+    TYPE_EVENT,
+    TYPE_COUNT,
+};
+
+#define SOURCE_COUNT (MSGSTATS_SOURCE_BROKER + 1)
+
+struct topicstat {
+    uint64_t count[TYPE_COUNT];
+    uint64_t bytes;
+    struct hist *queue;     /* created on first queueing delay sample */
+};
+
+struct msgstats {
+    zhashx_t *topics;
+    int max_topics;
+    struct topicstat *other;
+    uint64_t source[SOURCE_COUNT];
+};
+
+static const char *source_name[SOURCE_COUNT] = {
+    "module", "child", "parent", "broker",
+};
+
+static void topicstat_destroy (void **item)
+{
+    if (item) {
+        struct topicstat *ts = *item;
+        if (ts) {
+            hist_destroy (ts->queue);
+            free (ts);
+        }
+        *item = NULL;
+    }
+}
+
+static struct topicstat *topicstat_create (void)
+{
+    struct topicstat *ts;
+
+    if (!(ts = calloc (1, sizeof (*ts)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return ts;
+}
+
+/* Look up 'topic', adding it if there is room, or returning the
+ * overflow entry if not.
+ */
+static struct topicstat *topicstat_get (struct msgstats *ms,
+                                        const char *topic)
+{
+    struct topicstat *ts;
+
+    if ((ts = zhashx_lookup (ms->topics, topic)))
+        return ts;
+    if (zhashx_size (ms->topics) >= (size_t)ms->max_topics)
+        return ms->other;
+    if (!(ts = topicstat_create ()))
+        return NULL;
+    (void)zhashx_insert (ms->topics, topic, ts);
+    return ts;
+}
+
+static int type_index (int type)
+{
+    switch (type) {
+        case FLUX_MSGTYPE_REQUEST:
+            return TYPE_REQUEST;
+        case FLUX_MSGTYPE_RESPONSE:
+            return TYPE_RESPONSE;
+        case FLUX_MSGTYPE_EVENT:
+            return TYPE_EVENT;
+    }
+    return -1;
+}
+
+int msgstats_count (struct msgstats *ms,
+                    const flux_msg_t *msg,
+                    enum msgstats_source source,
+                    const struct timespec *t_queued)
+{
+    struct topicstat *ts;
+    const char *topic;
+    int type;
+    int index;
+
+    if (!ms || !msg || source < 0 || source >= SOURCE_COUNT) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (flux_msg_get_type (msg, &type) < 0)
+        return -1;
+    if ((index = type_index (type)) < 0)
+        return 0; // keepalives are not accounted
+    if (flux_msg_get_topic (msg, &topic) < 0)
+        return -1;
+    if (!(ts = topicstat_get (ms, topic)))
+        return -1;
+    ms->source[source]++;
+    ts->count[index]++;
+    ts->bytes += flux_msg_encode_size (msg);
+    if (t_queued && monotime_isset (*t_queued)) {
+        if (!ts->queue && !(ts->queue = hist_create ()))
+            return -1;
+        if (hist_record_since (ts->queue, *t_queued) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static json_t *topicstat_encode (struct topicstat *ts)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{s:I s:I s:I s:I}",
+                         "request", (json_int_t)ts->count[TYPE_REQUEST],
+                         "response", (json_int_t)ts->count[TYPE_RESPONSE],
+                         "event", (json_int_t)ts->count[TYPE_EVENT],
+                         "bytes", (json_int_t)ts->bytes)))
+        goto nomem;
+    if (ts->queue) {
+        json_t *hist;
+        if (!(hist = hist_encode (ts->queue))
+            || json_object_set_new (o, "queue (us)", hist) < 0) {
+            json_decref (o);
+            goto nomem;
+        }
+    }
+    return o;
+nomem:
+    errno = ENOMEM;
+    return NULL;
+}
+
+static bool topicstat_empty (struct topicstat *ts)
+{
+    int i;
+
+    for (i = 0; i < TYPE_COUNT; i++) {
+        if (ts->count[i] > 0)
+            return false;
+    }
+    return true;
+}
+
+static int topics_add (json_t *topics, const char *topic,
+                       struct topicstat *ts)
+{
+    json_t *o;
+
+    if (!(o = topicstat_encode (ts)))
+        return -1;
+    if (json_object_set_new (topics, topic, o) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+json_t *msgstats_encode (struct msgstats *ms)
+{
+    json_t *topics = NULL;
+    json_t *sources = NULL;
+    json_t *o;
+    struct topicstat *ts;
+    int i;
+
+    if (!ms) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(topics = json_object ()) || !(sources = json_object ()))
+        goto nomem;
+    for (i = 0; i < SOURCE_COUNT; i++) {
+        json_t *n = json_integer (ms->source[i]);
+        if (!n || json_object_set_new (sources, source_name[i], n) < 0)
+            goto nomem;
+    }
+    ts = zhashx_first (ms->topics);
+    while (ts) {
+        if (topics_add (topics, zhashx_cursor (ms->topics), ts) < 0)
+            goto error;
+        ts = zhashx_next (ms->topics);
+    }
+    if (!topicstat_empty (ms->other)
+        && topics_add (topics, MSGSTATS_OTHER, ms->other) < 0)
+        goto error;
+    if (!(o = json_pack ("{s:i s:O s:O}",
+                         "max-topics", ms->max_topics,
+                         "sources", sources,
+                         "topics", topics)))
+        goto nomem;
+    json_decref (sources);
+    json_decref (topics);
+    return o;
+nomem:
+    errno = ENOMEM;
+error:
+    json_decref (sources);
+    json_decref (topics);
+    return NULL;
+}
+
+void msgstats_destroy (struct msgstats *ms)
+{
+    if (ms) {
+        int saved_errno = errno;
+        zhashx_destroy (&ms->topics);
+        topicstat_destroy ((void **)&ms->other);
+        free (ms);
+        errno = saved_errno;
+    }
+}
+
+struct msgstats *msgstats_create (int max_topics)
+{
+    struct msgstats *ms;
+
+    if (max_topics < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(ms = calloc (1, sizeof (*ms))))
+        goto nomem;
+    ms->max_topics = max_topics;
+    if (!(ms->topics = zhashx_new ()))
+        goto nomem;
+    zhashx_set_destructor (ms->topics, topicstat_destroy);
+    if (!(ms->other = topicstat_create ()))
+        goto error;
+    return ms;
+nomem:
+    errno = ENOMEM;
+error:
+    msgstats_destroy (ms);
+    return NULL;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
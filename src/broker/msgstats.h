@@ -0,0 +1,65 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _BROKER_MSGSTATS_H
+#define _BROKER_MSGSTATS_H
+
+#include <time.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+/* Per-topic accounting of messages entering the broker's routing logic.
+ * For each topic, messages are counted by type along with their encoded
+ * size, and for messages from modules, the time spent queued between
+ * the module and the broker.
+ *
+ * The number of topics tracked is bounded by 'max_topics'.  Once that
+ * many distinct topics have been seen, messages with new topics are
+ * accounted under MSGSTATS_OTHER.
+ */
+
+#define MSGSTATS_OTHER          "(other)"
+#define MSGSTATS_MAX_TOPICS     1024
+
+enum msgstats_source {
+    MSGSTATS_SOURCE_MODULE,     /* comms module */
+    MSGSTATS_SOURCE_CHILD,      /* TBON child */
+    MSGSTATS_SOURCE_PARENT,     /* TBON parent */
+    MSGSTATS_SOURCE_BROKER,     /* broker-resident service */
+};
+
+struct msgstats;
+
+struct msgstats *msgstats_create (int max_topics);
+void msgstats_destroy (struct msgstats *ms);
+
+/* Account for 'msg' received from 'source'.  If 't_queued' is non-NULL
+ * and set (see monotime_isset()), the time elapsed since then is recorded
+ * as queueing delay.  Returns -1 on error (EPROTO, ENOMEM), 0 on success.
+ */
+int msgstats_count (struct msgstats *ms,
+                    const flux_msg_t *msg,
+                    enum msgstats_source source,
+                    const struct timespec *t_queued);
+
+/* Encode as a JSON object:
+ *   {"max-topics":i,
+ *    "sources":{"module":I, "child":I, "parent":I, "broker":I},
+ *    "topics":{TOPIC:{"request":I, "response":I, "event":I, "bytes":I
+ *                     ?"queue (us)":HIST}, ...}}
+ * where HIST is a histogram encoded with hist_encode().
+ */
+json_t *msgstats_encode (struct msgstats *ms);
+
+#endif /* !_BROKER_MSGSTATS_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
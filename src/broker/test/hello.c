@@ -29,6 +29,18 @@ void hello_cb (hello_t *hello, void *arg)
     (*ip)++;
 }
 
+void send_join (flux_t *h, const char *ranks)
+{
+    flux_future_t *f;
+
+    if (!(f = flux_rpc_pack (h, "hello.join", FLUX_NODEID_ANY,
+                             FLUX_RPC_NORESPONSE, "{s:s s:i}",
+                             "ranks", ranks,
+                             "batch", 0)))
+        BAIL_OUT ("flux_rpc_pack hello.join failed");
+    flux_future_destroy (f);
+}
+
 int main (int argc, char **argv)
 {
     hello_t *hello;
@@ -101,6 +113,26 @@ int main (int argc, char **argv)
         "hello_get_count returned 1");
     ok (hello_complete (hello) == 0,
         "hello_complete returned false");
+
+    /* Join the other two ranks, then one of them again.
+     * Readiness is tracked by rank so the duplicate is not counted.
+     */
+    send_join (h, "1-2");
+    ok (flux_reactor_run (flux_get_reactor (h), FLUX_REACTOR_NOWAIT) >= 0,
+        "reactor processed join request");
+    ok (cb_counter == 2,
+        "callback was called for join");
+    ok (hello_get_count (hello) == 3,
+        "hello_get_count returned 3");
+    ok (hello_complete (hello) != 0,
+        "hello_complete returned true");
+    send_join (h, "2");
+    ok (flux_reactor_run (flux_get_reactor (h), FLUX_REACTOR_NOWAIT) >= 0,
+        "reactor processed duplicate join request");
+    ok (hello_get_count (hello) == 3,
+        "hello_get_count still returned 3");
+    ok (cb_counter == 2,
+        "callback was not called for duplicate join");
     hello_destroy (hello);
 
     flux_close (h);
@@ -0,0 +1,219 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <flux/core.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/broker/logring.h"
+
+static int append (struct logring *r, int i, int len)
+{
+    char buf[FLUX_MAX_LOGBUF];
+
+    memset (buf, 'x', len);
+    snprintf (buf, len, "%d", i);
+    return logring_append (r, buf, len);
+}
+
+/* Return true if the record with sequence number 'seq' is the one
+ * created by append() with 'i'.
+ */
+static bool check (struct logring *r, int seq, int i)
+{
+    const char *buf;
+    int len, next;
+    char s[16];
+
+    if (logring_next (r, seq - 1, &next, &buf, &len) < 0 || next != seq)
+        return false;
+    snprintf (s, sizeof (s), "%d", i);
+    return len > strlen (s) && !strncmp (buf, s, strlen (s));
+}
+
+void basic (void)
+{
+    struct logring *r;
+    const char *buf;
+    int len, seq;
+
+    ok ((r = logring_create (4)) != NULL,
+        "logring_create max_entries=4 works");
+    ok (logring_size (r) == 4 && logring_count (r) == 0
+        && logring_seq (r) == 0,
+        "ring is empty");
+    errno = 0;
+    ok (logring_next (r, -1, &seq, &buf, &len) < 0 && errno == ENOENT,
+        "logring_next on empty ring fails with ENOENT");
+
+    ok (logring_append (r, "hello", 5) == 0,
+        "logring_append returns seq 0");
+    ok (logring_append (r, "world", 5) == 1,
+        "logring_append returns seq 1");
+    ok (logring_next (r, -1, &seq, &buf, &len) == 0
+        && seq == 0 && len == 5 && !strncmp (buf, "hello", 5),
+        "logring_next seq=-1 returns first record");
+    ok (logring_next (r, 0, &seq, &buf, &len) == 0
+        && seq == 1 && len == 5 && !strncmp (buf, "world", 5),
+        "logring_next seq=0 returns second record");
+    errno = 0;
+    ok (logring_next (r, 1, &seq, &buf, &len) < 0 && errno == ENOENT,
+        "logring_next seq=1 fails with ENOENT");
+
+    ok (append (r, 2, 10) == 2 && append (r, 3, 10) == 3
+        && append (r, 4, 10) == 4,
+        "appended three more records");
+    ok (logring_count (r) == 4 && logring_seq (r) == 5,
+        "oldest record was dropped when entries ran out");
+    ok (logring_next (r, -1, &seq, NULL, NULL) == 0 && seq == 1,
+        "logring_next skips to the oldest record");
+    ok (check (r, 4, 4),
+        "newest record is intact");
+
+    errno = 0;
+    ok (logring_append (r, "", 0) < 0 && errno == EINVAL,
+        "logring_append len=0 fails with EINVAL");
+    errno = 0;
+    ok (logring_create (-1) == NULL && errno == EINVAL,
+        "logring_create max_entries=-1 fails with EINVAL");
+
+    logring_destroy (r);
+}
+
+void clear (void)
+{
+    struct logring *r;
+    int i, seq;
+
+    if (!(r = logring_create (16)))
+        BAIL_OUT ("logring_create failed");
+    for (i = 0; i < 10; i++)
+        append (r, i, 20);
+    logring_clear (r, 4);
+    ok (logring_count (r) == 5
+        && logring_next (r, -1, &seq, NULL, NULL) == 0 && seq == 5,
+        "logring_clear seq=4 drops records 0-4");
+    logring_clear (r, 2);
+    ok (logring_count (r) == 5,
+        "logring_clear of already dropped records does nothing");
+    logring_clear (r, -1);
+    ok (logring_count (r) == 0 && logring_seq (r) == 10,
+        "logring_clear seq=-1 drops all records but keeps seq");
+    ok (append (r, 10, 20) == 10 && check (r, 10, 10),
+        "records can be appended after clear");
+    logring_destroy (r);
+}
+
+/* With 4 entries, the buffer is the minimum size of 2 * FLUX_MAX_LOGBUF,
+ * so large records run out of buffer before entries, and each new record
+ * must wrap around over the oldest.
+ */
+void wrap (void)
+{
+    struct logring *r;
+    int len = FLUX_MAX_LOGBUF * 2 / 3;
+    bool intact = true;
+    bool bounded = true;
+    int i;
+
+    if (!(r = logring_create (4)))
+        BAIL_OUT ("logring_create failed");
+    for (i = 0; i < 100; i++) {
+        if (append (r, i, len + i % 7) != i)
+            BAIL_OUT ("append failed");
+        if (!check (r, i, i))
+            intact = false;
+        if (logring_count (r) > 2)
+            bounded = false;
+    }
+    ok (bounded,
+        "oldest records were dropped when the buffer ran out");
+    ok (intact,
+        "each new record was intact after wrapping");
+    ok (logring_count (r) == 2 && check (r, 98, 98) && check (r, 99, 99),
+        "the newest records that fit are kept");
+
+    errno = 0;
+    ok (append (r, 0, 1) == 100 && logring_append (r, "x", 1) == 101,
+        "small records fit after wraparound");
+    logring_destroy (r);
+
+    if (!(r = logring_create (1024)))
+        BAIL_OUT ("logring_create failed");
+    for (i = 0; i < 5000; i++) {
+        if (append (r, i, 50 + i % 300) != i)
+            BAIL_OUT ("append failed");
+    }
+    ok (logring_count (r) == 1024,
+        "records of average size are limited by entries, not buffer");
+    for (i = 5000 - 1024; i < 5000; i++) {
+        if (!check (r, i, i))
+            break;
+    }
+    ok (i == 5000,
+        "all stored records are intact");
+    logring_destroy (r);
+}
+
+void resize (void)
+{
+    struct logring *r;
+    int i, seq;
+
+    if (!(r = logring_create (8)))
+        BAIL_OUT ("logring_create failed");
+    for (i = 0; i < 8; i++)
+        append (r, i, 30);
+    ok (logring_resize (r, 3) == 0 && logring_size (r) == 3,
+        "logring_resize to 3 entries works");
+    ok (logring_count (r) == 3 && logring_seq (r) == 8
+        && check (r, 5, 5) && check (r, 6, 6) && check (r, 7, 7),
+        "the newest records were kept with their sequence numbers");
+    ok (append (r, 8, 30) == 8 && check (r, 8, 8) && logring_count (r) == 3,
+        "appending after shrinking works");
+
+    ok (logring_resize (r, 16) == 0 && logring_count (r) == 3,
+        "logring_resize to 16 entries keeps records");
+    for (i = 9; i < 20; i++)
+        append (r, i, 30);
+    ok (logring_count (r) == 14
+        && logring_next (r, -1, &seq, NULL, NULL) == 0 && seq == 6,
+        "growing the ring keeps more records");
+
+    ok (logring_resize (r, 0) == 0 && logring_count (r) == 0
+        && logring_seq (r) == 20,
+        "logring_resize to 0 drops all records");
+    errno = 0;
+    ok (logring_append (r, "x", 1) < 0 && errno == EINVAL,
+        "logring_append fails with EINVAL on 0-entry ring");
+    errno = 0;
+    ok (logring_resize (r, -1) < 0 && errno == EINVAL,
+        "logring_resize to -1 fails with EINVAL");
+    logring_destroy (r);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    basic ();
+    clear ();
+    wrap ();
+    resize ();
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
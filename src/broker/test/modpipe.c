@@ -0,0 +1,167 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <poll.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/monotime.h"
+#include "src/common/libtap/tap.h"
+#include "src/broker/modpipe.h"
+
+#define STREAM_COUNT 100000
+
+static flux_msg_t *broker_recv (struct modpipe *mp)
+{
+    struct pollfd pfd = {
+        .fd = modpipe_pollfd (mp),
+        .events = POLLIN,
+        .revents = 0,
+    };
+    flux_msg_t *msg;
+
+    while (!(msg = modpipe_recv (mp, NULL))) {
+        if (errno != EWOULDBLOCK)
+            return NULL;
+        if (!(modpipe_pollevents (mp) & FLUX_POLLIN)) {
+            if (poll (&pfd, 1, 5000) != 1)
+                return NULL;
+        }
+    }
+    return msg;
+}
+
+static void *stream_thread (void *arg)
+{
+    flux_t *h = arg;
+    flux_msg_t *msg;
+    int i;
+
+    if (!(msg = flux_request_encode ("test.stream", NULL)))
+        return NULL;
+    for (i = 0; i < STREAM_COUNT; i++) {
+        if (flux_msg_set_matchtag (msg, i) < 0 || flux_send (h, msg, 0) < 0)
+            break;
+    }
+    flux_msg_destroy (msg);
+    return NULL;
+}
+
+/* Stream requests from a "module" thread to the broker end,
+ * checking order, and report the message rate.
+ */
+static void test_stream (void)
+{
+    struct modpipe *mp;
+    flux_t *h;
+    pthread_t t;
+    struct timespec t0;
+    flux_msg_t *msg;
+    uint32_t matchtag;
+    int count = 0;
+    int errors = 0;
+    double elapsed;
+    int e;
+
+    if (!(mp = modpipe_create ()) || !(h = modpipe_open (mp, 0)))
+        BAIL_OUT ("modpipe_create/open failed");
+    monotime (&t0);
+    if ((e = pthread_create (&t, NULL, stream_thread, h)))
+        BAIL_OUT ("pthread_create: %s", strerror (e));
+    while (count < STREAM_COUNT && (msg = broker_recv (mp))) {
+        if (flux_msg_get_matchtag (msg, &matchtag) < 0 || matchtag != count)
+            errors++;
+        flux_msg_destroy (msg);
+        count++;
+    }
+    pthread_join (t, NULL);
+    elapsed = monotime_since (t0) / 1000;
+    ok (count == STREAM_COUNT && errors == 0,
+        "streamed %d requests in order", count);
+    diag ("%.0f msg/s", elapsed > 0 ? count / elapsed : 0);
+    flux_close (h);
+    modpipe_destroy (mp);
+}
+
+int main (int argc, char *argv[])
+{
+    struct modpipe *mp;
+    flux_t *h;
+    flux_msg_t *msg;
+    const char *topic;
+    int type;
+    struct timespec t_queued;
+
+    plan (NO_PLAN);
+
+    ok ((mp = modpipe_create ()) != NULL,
+        "modpipe_create works");
+    ok ((h = modpipe_open (mp, 0)) != NULL,
+        "modpipe_open works");
+    if (!mp || !h)
+        BAIL_OUT ("can't continue without modpipe");
+
+    ok (modpipe_pollevents (mp) == FLUX_POLLOUT,
+        "broker end pollevents is FLUX_POLLOUT when empty");
+    errno = 0;
+    ok (modpipe_recv (mp, NULL) == NULL && errno == EWOULDBLOCK,
+        "broker end recv fails with EWOULDBLOCK when empty");
+    errno = 0;
+    ok (flux_recv (h, FLUX_MATCH_ANY, FLUX_O_NONBLOCK) == NULL
+        && errno == EWOULDBLOCK,
+        "module end nonblocking recv fails with EWOULDBLOCK when empty");
+
+    if (!(msg = flux_request_encode ("test.hello", NULL)))
+        BAIL_OUT ("flux_request_encode failed");
+    ok (modpipe_send (mp, msg) == 0,
+        "broker end sent request");
+    ok ((msg = flux_recv (h, FLUX_MATCH_ANY, 0)) != NULL,
+        "module end received request");
+    ok (flux_msg_get_type (msg, &type) == 0 && type == FLUX_MSGTYPE_REQUEST
+        && flux_msg_get_topic (msg, &topic) == 0
+        && !strcmp (topic, "test.hello"),
+        "message is correct type and topic");
+    flux_msg_destroy (msg);
+
+    if (!(msg = flux_msg_create (FLUX_MSGTYPE_RESPONSE)))
+        BAIL_OUT ("flux_msg_create failed");
+    ok (flux_send (h, msg, 0) == 0,
+        "module end sent response");
+    flux_msg_destroy (msg);
+    ok (modpipe_pollevents (mp) == (FLUX_POLLIN | FLUX_POLLOUT),
+        "broker end pollevents is FLUX_POLLIN | FLUX_POLLOUT");
+    ok ((msg = modpipe_recv (mp, &t_queued)) != NULL,
+        "broker end received response");
+    ok (monotime_isset (t_queued) && monotime_since (t_queued) >= 0.,
+        "response was stamped with the time it was queued");
+    ok (flux_msg_get_type (msg, &type) == 0 && type == FLUX_MSGTYPE_RESPONSE,
+        "message is correct type");
+    flux_msg_destroy (msg);
+
+    if (!(msg = flux_msg_create (FLUX_MSGTYPE_EVENT)))
+        BAIL_OUT ("flux_msg_create failed");
+    ok (modpipe_send (mp, msg) == 0,
+        "broker end sent event that is never received");
+
+    flux_close (h);
+    modpipe_destroy (mp);
+    pass ("modpipe_destroy freed the queued event");
+
+    test_stream ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
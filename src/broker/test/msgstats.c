@@ -0,0 +1,140 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/monotime.h"
+#include "src/common/libtap/tap.h"
+#include "src/broker/msgstats.h"
+
+static json_t *get_topic (json_t *o, const char *topic)
+{
+    json_t *topics;
+
+    if (json_unpack (o, "{s:o}", "topics", &topics) < 0)
+        return NULL;
+    return json_object_get (topics, topic);
+}
+
+static json_int_t get_int (json_t *o, const char *topic, const char *key)
+{
+    json_t *t;
+    json_int_t n;
+
+    if (!(t = get_topic (o, topic)) || json_unpack (t, "{s:I}", key, &n) < 0)
+        return -1;
+    return n;
+}
+
+void count (void)
+{
+    struct msgstats *ms;
+    flux_msg_t *req, *rsp, *ev;
+    struct timespec t0;
+    json_t *o;
+    json_int_t module, broker, qcount;
+
+    ok ((ms = msgstats_create (MSGSTATS_MAX_TOPICS)) != NULL,
+        "msgstats_create works");
+    if (!(req = flux_request_encode ("a.foo", "{}"))
+        || !(rsp = flux_response_encode ("a.foo", NULL))
+        || !(ev = flux_event_encode ("b.bar", NULL)))
+        BAIL_OUT ("failed to create messages");
+
+    monotime (&t0);
+    ok (msgstats_count (ms, req, MSGSTATS_SOURCE_MODULE, &t0) == 0
+        && msgstats_count (ms, req, MSGSTATS_SOURCE_MODULE, &t0) == 0
+        && msgstats_count (ms, rsp, MSGSTATS_SOURCE_BROKER, NULL) == 0
+        && msgstats_count (ms, ev, MSGSTATS_SOURCE_PARENT, NULL) == 0,
+        "msgstats_count works");
+
+    ok ((o = msgstats_encode (ms)) != NULL,
+        "msgstats_encode works");
+    ok (get_int (o, "a.foo", "request") == 2
+        && get_int (o, "a.foo", "response") == 1
+        && get_int (o, "a.foo", "event") == 0,
+        "a.foo has 2 requests and 1 response");
+    ok (get_int (o, "b.bar", "event") == 1,
+        "b.bar has 1 event");
+    ok (get_int (o, "a.foo", "bytes") ==
+            (json_int_t)(2 * flux_msg_encode_size (req)
+                         + flux_msg_encode_size (rsp)),
+        "a.foo bytes is the sum of encoded message sizes");
+    ok (json_unpack (get_topic (o, "a.foo"), "{s:{s:I}}",
+                     "queue (us)", "count", &qcount) == 0
+        && qcount == 2,
+        "a.foo has 2 queueing delay samples");
+    ok (json_object_get (get_topic (o, "b.bar"), "queue (us)") == NULL,
+        "b.bar has no queueing delay samples");
+    ok (json_unpack (o, "{s:{s:I s:I}}",
+                     "sources", "module", &module, "broker", &broker) == 0
+        && module == 2 && broker == 1,
+        "messages are counted by source");
+    json_decref (o);
+
+    errno = 0;
+    ok (msgstats_count (NULL, req, MSGSTATS_SOURCE_MODULE, NULL) < 0
+        && errno == EINVAL,
+        "msgstats_count ms=NULL fails with EINVAL");
+
+    flux_msg_destroy (req);
+    flux_msg_destroy (rsp);
+    flux_msg_destroy (ev);
+    msgstats_destroy (ms);
+}
+
+void bounded (void)
+{
+    struct msgstats *ms;
+    json_t *o;
+    int i;
+
+    if (!(ms = msgstats_create (4)))
+        BAIL_OUT ("msgstats_create failed");
+    for (i = 0; i < 10; i++) {
+        char topic[32];
+        flux_msg_t *msg;
+
+        snprintf (topic, sizeof (topic), "t.%d", i);
+        if (!(msg = flux_event_encode (topic, NULL))
+            || msgstats_count (ms, msg, MSGSTATS_SOURCE_CHILD, NULL) < 0)
+            BAIL_OUT ("msgstats_count failed");
+        flux_msg_destroy (msg);
+    }
+    if (!(o = msgstats_encode (ms)))
+        BAIL_OUT ("msgstats_encode failed");
+    ok (json_object_size (json_object_get (o, "topics")) == 5,
+        "only max_topics topics plus overflow are tracked");
+    ok (get_int (o, "t.3", "event") == 1 && get_topic (o, "t.4") == NULL,
+        "first max_topics topics are tracked individually");
+    ok (get_int (o, MSGSTATS_OTHER, "event") == 6,
+        "remaining messages are counted under %s", MSGSTATS_OTHER);
+    json_decref (o);
+    msgstats_destroy (ms);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    count ();
+    bounded ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
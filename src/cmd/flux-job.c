@@ -59,6 +59,12 @@ static struct optparse_option list_opts[] =  {
     { .name = "suppress-header", .key = 's', .has_arg = 0,
       .usage = "Suppress printing of header line",
     },
+    { .name = "states", .key = 'S', .has_arg = 1, .arginfo = "STATE,...",
+      .usage = "List only jobs in the specified states",
+    },
+    { .name = "user", .key = 'u', .has_arg = 1, .arginfo = "UID",
+      .usage = "List only jobs owned by UID",
+    },
     OPTPARSE_TABLE_END
 };
 
@@ -419,16 +425,36 @@ static int iso_timestr (double timestamp, char *buf, size_t size)
     return 0;
 }
 
+/* Parse comma-separated list of job state names to a state mask.
+ */
+static int parse_states (const char *arg)
+{
+    char *cpy = xstrdup (arg);
+    char *saveptr = NULL;
+    char *s;
+    int states = 0;
+
+    s = strtok_r (cpy, ",", &saveptr);
+    while (s) {
+        flux_job_state_t state;
+        if (flux_job_strtostate (s, &state) < 0)
+            log_msg_exit ("invalid job state: %s", s);
+        states |= state;
+        s = strtok_r (NULL, ",", &saveptr);
+    }
+    free (cpy);
+    return states;
+}
+
 int cmd_list (optparse_t *p, int argc, char **argv)
 {
     int optindex = optparse_option_index (p);
     int max_entries = optparse_get_int (p, "count", 0);
-    char *attrs = "[\"id\",\"userid\",\"priority\",\"t_submit\",\"state\"]";
+    const char *states_arg = optparse_get_str (p, "states", NULL);
+    int userid = optparse_get_int (p, "user", (int)FLUX_USERID_UNKNOWN);
     flux_t *h;
     flux_future_t *f;
-    json_t *jobs;
-    size_t index;
-    json_t *value;
+    json_t *job;
 
     if (optindex != argc) {
         optparse_print_usage (p);
@@ -437,14 +463,23 @@ int cmd_list (optparse_t *p, int argc, char **argv)
     if (!(h = flux_open (NULL, 0)))
         log_err_exit ("flux_open");
 
-    if (!(f = flux_job_list (h, max_entries, attrs)))
-        log_err_exit ("flux_job_list");
-    if (flux_rpc_get_unpack (f, "{s:o}", "jobs", &jobs) < 0)
-        log_err_exit ("flux_job_list");
+    /* Request one response per job, so that a long queue is not
+     * serialized into a single large message.
+     */
+    if (!(f = flux_rpc_pack (h, "job-manager.list", FLUX_NODEID_ANY,
+                             FLUX_RPC_STREAMING,
+                             "{s:i s:[s,s,s,s,s] s:i s:i}",
+                             "max_entries", max_entries,
+                             "attrs", "id", "userid", "priority",
+                                      "t_submit", "state",
+                             "states",
+                             states_arg ? parse_states (states_arg) : 0,
+                             "userid", userid)))
+        log_err_exit ("flux_rpc_pack");
     if (!optparse_hasopt (p, "suppress-header"))
         printf ("%s\t\t%s\t%s\t%s\t%s\n",
                 "JOBID", "STATE", "USERID", "PRI", "T_SUBMIT");
-    json_array_foreach (jobs, index, value) {
+    for (;;) {
         flux_jobid_t id;
         int priority;
         uint32_t userid;
@@ -452,12 +487,22 @@ int cmd_list (optparse_t *p, int argc, char **argv)
         char timestr[80];
         flux_job_state_t state;
 
-        if (json_unpack (value, "{s:I s:i s:i s:f s:i}",
-                                "id", &id,
-                                "priority", &priority,
-                                "userid", &userid,
-                                "t_submit", &t_submit,
-                                "state", &state) < 0)
+        job = NULL;
+        if (flux_rpc_get_unpack (f, "{s?:o}", "job", &job) < 0) {
+            if (errno == ENODATA)
+                break;
+            log_msg_exit ("flux_job_list: %s", flux_future_error_string (f));
+        }
+        if (!job) { // cursor response - no more jobs follow
+            flux_future_reset (f);
+            continue;
+        }
+        if (json_unpack (job, "{s:I s:i s:i s:f s:i}",
+                              "id", &id,
+                              "priority", &priority,
+                              "userid", &userid,
+                              "t_submit", &t_submit,
+                              "state", &state) < 0)
             log_msg_exit ("error parsing job data");
         if (iso_timestr (t_submit, timestr, sizeof (timestr)) < 0)
             log_err_exit ("time conversion error");
@@ -466,6 +511,7 @@ int cmd_list (optparse_t *p, int argc, char **argv)
                                        (unsigned long)userid,
                                        priority,
                                        timestr);
+        flux_future_reset (f);
     }
     flux_future_destroy (f);
     flux_close (h);
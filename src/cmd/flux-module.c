@@ -27,6 +27,7 @@
 #include "src/common/libutil/read_all.h"
 #include "src/common/libidset/idset.h"
 #include "src/common/libutil/iterators.h"
+#include "src/common/libutil/hist.h"
 
 const int max_idle = 99;
 
@@ -88,6 +89,9 @@ static struct optparse_option stats_opts[] =  {
     { .name = "clear-all", .key = 'C', .has_arg = 0,
       .usage = "Clear stats on all ranks",
     },
+    { .name = "all", .key = 'a', .has_arg = 0,
+      .usage = "Merge stats from all ranks",
+    },
     OPTPARSE_TABLE_END
 };
 static struct optparse_option debug_opts[] = {
@@ -742,6 +746,91 @@ done:
     return (0);
 }
 
+static bool is_hist (json_t *o)
+{
+    return json_is_object (o) && json_object_get (o, "buckets") != NULL;
+}
+
+/* Merge stats object 'src' from one rank into 'dst': histograms are
+ * merged, integer counters are summed, and other numbers are averaged
+ * over 'n', the number of objects merged into 'dst' so far.
+ */
+static void stats_merge (json_t *dst, json_t *src, int n)
+{
+    const char *key;
+    json_t *s;
+
+    json_object_foreach (src, key, s) {
+        json_t *d = json_object_get (dst, key);
+        json_t *o = NULL;
+
+        if (!d)
+            o = json_deep_copy (s);
+        else if (is_hist (d) && is_hist (s)) {
+            struct hist *hd, *hs;
+            if (!(hd = hist_decode (d)) || !(hs = hist_decode (s))
+                                        || hist_merge (hd, hs) < 0)
+                log_err_exit ("error merging histogram '%s'", key);
+            o = hist_encode (hd);
+            hist_destroy (hd);
+            hist_destroy (hs);
+        }
+        else if (json_is_object (d) && json_is_object (s))
+            stats_merge (d, s, n);
+        else if (json_is_integer (d) && json_is_integer (s))
+            o = json_integer (json_integer_value (d)
+                              + json_integer_value (s));
+        else if (json_is_number (d) && json_is_number (s))
+            o = json_real ((json_number_value (d) * n
+                            + json_number_value (s)) / (n + 1));
+        if (o && json_object_set_new (dst, key, o) < 0)
+            oom ();
+    }
+}
+
+/* Send 'topic' to all ranks and merge the responses.
+ */
+static char *stats_get_all (flux_t *h, const char *topic)
+{
+    flux_mrpc_t *r;
+    json_t *merged = NULL;
+    char *s;
+    int n = 0;
+
+    if (!(r = flux_mrpc (h, topic, NULL, "all", 0)))
+        log_err_exit ("%s", topic);
+    do {
+        const char *json_str;
+        json_t *o;
+        uint32_t nodeid = FLUX_NODEID_ANY;
+
+        if (flux_mrpc_get_nodeid (r, &nodeid) < 0
+            || flux_mrpc_get (r, &json_str) < 0
+            || !json_str
+            || !(o = json_loads (json_str, 0, NULL))) {
+            if (nodeid != FLUX_NODEID_ANY)
+                log_err ("%s[%" PRIu32 "]", topic, nodeid);
+            else
+                log_err ("%s", topic);
+            continue;
+        }
+        if (!merged)
+            merged = o;
+        else {
+            stats_merge (merged, o, n);
+            json_decref (o);
+        }
+        n++;
+    } while (flux_mrpc_next (r) == 0);
+    flux_mrpc_destroy (r);
+    if (!merged)
+        log_msg_exit ("%s: no responses", topic);
+    if (!(s = json_dumps (merged, JSON_COMPACT)))
+        oom ();
+    json_decref (merged);
+    return s;
+}
+
 static void parse_json (optparse_t *p, const char *json_str)
 {
     json_t *obj, *o;
@@ -830,6 +919,12 @@ int cmd_stats (optparse_t *p, int argc, char **argv)
         if (!json_str)
             log_errn_exit (EPROTO, "%s", topic);
         parse_json (p, json_str);
+    } else if (optparse_hasopt (p, "all")) {
+        char *s;
+        topic = xasprintf ("%s.stats.get", service);
+        s = stats_get_all (h, topic);
+        parse_json (p, s);
+        free (s);
     } else {
         topic = xasprintf ("%s.stats.get", service);
         if (!(f = flux_rpc (h, topic, NULL, nodeid, 0)))
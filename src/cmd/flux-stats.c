@@ -0,0 +1,350 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* flux-stats.c - display broker per-topic message statistics */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <inttypes.h>
+#include <jansson.h>
+#include <flux/core.h>
+#include <flux/optparse.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/hist.h"
+#include "src/common/libutil/statsmerge.h"
+
+#define QUEUE_KEY "queue (us)"
+
+enum {
+    COMBINE_ADD,
+    COMBINE_SUBTRACT,
+};
+
+struct row {
+    const char *topic;
+    json_int_t request;
+    json_int_t response;
+    json_int_t event;
+    json_int_t bytes;
+    struct hist *queue;
+};
+
+static struct optparse_option cmdopts[] = {
+    { .name = "rank",     .key = 'r', .has_arg = 1, .arginfo = "N",
+      .usage = "Get statistics from broker rank N (default: local)",
+    },
+    { .name = "all",      .key = 'a', .has_arg = 0,
+      .usage = "Sum statistics over all broker ranks",
+    },
+    { .name = "diff",     .key = 'd', .has_arg = 1, .arginfo = "FILE",
+      .usage = "Subtract a snapshot saved earlier with --json",
+    },
+    { .name = "json",     .key = 'j', .has_arg = 0,
+      .usage = "Print statistics as JSON, e.g. to save a snapshot",
+    },
+    { .name = "sort",     .key = 's', .has_arg = 1, .arginfo = "KEY",
+      .usage = "Sort by KEY: count (default), bytes, queue, or topic",
+    },
+    { .name = "limit",    .key = 'n', .has_arg = 1, .arginfo = "N",
+      .usage = "Display at most N topics",
+    },
+    OPTPARSE_TABLE_END
+};
+
+/* Add or subtract counters and histograms in 'src' to/from 'dst'.
+ * Combine only the counters, not per-broker settings like max-topics.
+ * 'counts' is passed to statsmerge_add() when adding (see statsmerge.h).
+ */
+static void combine_stats (json_t *dst, json_t *src, json_t *counts, int op)
+{
+    const char *keys[] = { "sources", "topics", NULL };
+    int i;
+
+    for (i = 0; keys[i] != NULL; i++) {
+        json_t *d = json_object_get (dst, keys[i]);
+        json_t *s = json_object_get (src, keys[i]);
+        int rc;
+        if (!json_is_object (d) || !json_is_object (s))
+            log_msg_exit ("malformed statistics: missing %s", keys[i]);
+        if (op == COMBINE_ADD) {
+            json_t *c;
+            if (!(c = json_object_get (counts, keys[i]))) {
+                if (!(c = json_object ())
+                    || json_object_set_new (counts, keys[i], c) < 0)
+                    oom ();
+            }
+            rc = statsmerge_add (d, s, c);
+        }
+        else
+            rc = statsmerge_subtract (d, s);
+        if (rc < 0) {
+            if (errno == EINVAL)
+                log_msg_exit ("snapshot is newer than current statistics");
+            log_err_exit ("error combining statistics");
+        }
+    }
+}
+
+static json_t *stats_get (flux_t *h, uint32_t nodeid)
+{
+    flux_future_t *f;
+    const char *json_str;
+    json_t *o;
+
+    if (!(f = flux_rpc (h, "cmb.stats", NULL, nodeid, 0))
+        || flux_rpc_get (f, &json_str) < 0)
+        log_err_exit ("cmb.stats");
+    if (!json_str || !(o = json_loads (json_str, 0, NULL)))
+        log_errn_exit (EPROTO, "cmb.stats");
+    flux_future_destroy (f);
+    return o;
+}
+
+struct stats_sum {
+    json_t *stats;
+    json_t *counts;
+};
+
+static void stats_all_cb (uint32_t nodeid, const char *json_str, int errnum,
+                          void *arg)
+{
+    struct stats_sum *sum = arg;
+    json_t *o = NULL;
+
+    if (errnum == 0 && (!json_str || !(o = json_loads (json_str, 0, NULL))))
+        errnum = EPROTO;
+    if (errnum != 0) {
+        if (nodeid != FLUX_NODEID_ANY)
+            log_errn (errnum, "cmb.stats[%" PRIu32 "]", nodeid);
+        else
+            log_errn (errnum, "cmb.stats");
+        return;
+    }
+    if (!sum->stats)
+        sum->stats = o;
+    else {
+        combine_stats (sum->stats, o, sum->counts, COMBINE_ADD);
+        json_decref (o);
+    }
+}
+
+/* Send cmb.stats to all ranks and sum the responses.
+ */
+static json_t *stats_get_all (flux_t *h)
+{
+    flux_mrpc_t *r;
+    struct stats_sum sum = { .stats = NULL };
+
+    if (!(sum.counts = json_object ()))
+        oom ();
+    if (!(r = flux_mrpc (h, "cmb.stats", NULL, "all", 0))
+        || flux_mrpc_foreach (r, stats_all_cb, &sum) < 0)
+        log_err_exit ("cmb.stats");
+    flux_mrpc_destroy (r);
+    json_decref (sum.counts);
+    if (!sum.stats)
+        log_msg_exit ("cmb.stats: no responses");
+    return sum.stats;
+}
+
+/* Drop topics with no messages, e.g. after subtracting a snapshot.
+ */
+static void drop_idle (json_t *stats)
+{
+    json_t *topics = json_object_get (stats, "topics");
+    json_t *active;
+    const char *topic;
+    json_t *o;
+
+    if (!(active = json_object ()))
+        oom ();
+    json_object_foreach (topics, topic, o) {
+        json_int_t req = 0, rsp = 0, ev = 0;
+        (void)json_unpack (o, "{s?I s?I s?I}",
+                           "request", &req,
+                           "response", &rsp,
+                           "event", &ev);
+        if (req + rsp + ev > 0 && json_object_set (active, topic, o) < 0)
+            oom ();
+    }
+    if (json_object_set_new (stats, "topics", active) < 0)
+        oom ();
+}
+
+static json_int_t row_count (const struct row *r)
+{
+    return r->request + r->response + r->event;
+}
+
+static uint64_t row_queue (const struct row *r)
+{
+    return r->queue ? hist_percentile (r->queue, 99.) : 0;
+}
+
+static int cmp_count (const void *a, const void *b)
+{
+    json_int_t x = row_count (a);
+    json_int_t y = row_count (b);
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int cmp_bytes (const void *a, const void *b)
+{
+    json_int_t x = ((const struct row *)a)->bytes;
+    json_int_t y = ((const struct row *)b)->bytes;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int cmp_queue (const void *a, const void *b)
+{
+    uint64_t x = row_queue (a);
+    uint64_t y = row_queue (b);
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int cmp_topic (const void *a, const void *b)
+{
+    return strcmp (((const struct row *)a)->topic,
+                   ((const struct row *)b)->topic);
+}
+
+static void print_table (json_t *stats, const char *sortkey, int limit)
+{
+    json_t *topics = json_object_get (stats, "topics");
+    int (*cmp)(const void *a, const void *b);
+    struct row *rows;
+    const char *topic;
+    json_t *o;
+    int count = 0;
+    int i;
+
+    if (!strcmp (sortkey, "count"))
+        cmp = cmp_count;
+    else if (!strcmp (sortkey, "bytes"))
+        cmp = cmp_bytes;
+    else if (!strcmp (sortkey, "queue"))
+        cmp = cmp_queue;
+    else if (!strcmp (sortkey, "topic"))
+        cmp = cmp_topic;
+    else
+        log_msg_exit ("unknown sort key: %s", sortkey);
+
+    if (!(rows = calloc (json_object_size (topics) + 1, sizeof (rows[0]))))
+        oom ();
+    json_object_foreach (topics, topic, o) {
+        struct row *r = &rows[count++];
+        json_t *queue = NULL;
+
+        r->topic = topic;
+        if (json_unpack (o, "{s:I s:I s:I s:I s?o}",
+                         "request", &r->request,
+                         "response", &r->response,
+                         "event", &r->event,
+                         "bytes", &r->bytes,
+                         QUEUE_KEY, &queue) < 0)
+            log_msg_exit ("malformed statistics for %s", topic);
+        if (queue && !(r->queue = hist_decode (queue)))
+            log_err_exit ("error decoding %s queue histogram", topic);
+    }
+    qsort (rows, count, sizeof (rows[0]), cmp);
+
+    printf ("%-32s %10s %10s %10s %12s %8s %8s\n",
+            "TOPIC", "REQUEST", "RESPONSE", "EVENT", "BYTES",
+            "Q-P50", "Q-P99");
+    for (i = 0; i < count && (limit == 0 || i < limit); i++) {
+        struct row *r = &rows[i];
+        printf ("%-32s %10jd %10jd %10jd %12jd",
+                r->topic,
+                (intmax_t)r->request,
+                (intmax_t)r->response,
+                (intmax_t)r->event,
+                (intmax_t)r->bytes);
+        if (r->queue && hist_count (r->queue) > 0)
+            printf (" %8" PRIu64 " %8" PRIu64 "\n",
+                    hist_percentile (r->queue, 50.),
+                    hist_percentile (r->queue, 99.));
+        else
+            printf (" %8s %8s\n", "-", "-");
+    }
+    for (i = 0; i < count; i++)
+        hist_destroy (rows[i].queue);
+    free (rows);
+}
+
+int main (int argc, char *argv[])
+{
+    optparse_t *opts;
+    int optindex;
+    flux_t *h;
+    json_t *stats;
+    const char *diff;
+    int rank;
+    int limit;
+
+    log_init ("flux-stats");
+
+    opts = optparse_create ("flux-stats");
+    if (optparse_add_option_table (opts, cmdopts) != OPTPARSE_SUCCESS)
+        log_msg_exit ("optparse_add_option_table");
+    if ((optindex = optparse_parse_args (opts, argc, argv)) < 0)
+        exit (1);
+    if (optindex != argc) {
+        optparse_print_usage (opts);
+        exit (1);
+    }
+    rank = optparse_get_int (opts, "rank", -1);
+    if (optparse_hasopt (opts, "all") && rank >= 0)
+        log_msg_exit ("--rank and --all are mutually exclusive");
+    if ((limit = optparse_get_int (opts, "limit", 0)) < 0)
+        log_msg_exit ("limit must be >= 0");
+
+    if (!(h = flux_open (NULL, 0)))
+        log_err_exit ("flux_open");
+    if (optparse_hasopt (opts, "all"))
+        stats = stats_get_all (h);
+    else
+        stats = stats_get (h, rank >= 0 ? rank : FLUX_NODEID_ANY);
+
+    if ((diff = optparse_get_str (opts, "diff", NULL))) {
+        json_error_t error;
+        json_t *snapshot;
+
+        if (!(snapshot = json_load_file (diff, 0, &error)))
+            log_msg_exit ("%s:%d: %s", diff, error.line, error.text);
+        combine_stats (stats, snapshot, NULL, COMBINE_SUBTRACT);
+        drop_idle (stats);
+        json_decref (snapshot);
+    }
+
+    if (optparse_hasopt (opts, "json")) {
+        if (json_dumpf (stats, stdout, JSON_COMPACT) < 0)
+            log_msg_exit ("error writing JSON");
+        printf ("\n");
+    }
+    else
+        print_table (stats, optparse_get_str (opts, "sort", "count"), limit);
+
+    json_decref (stats);
+    flux_close (h);
+    optparse_destroy (opts);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
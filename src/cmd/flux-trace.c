@@ -0,0 +1,445 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* flux-trace.c - control the message tracer and display RPC spans */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+#include <flux/optparse.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/oom.h"
+
+struct rec {
+    double t;               /* seconds, realtime of the recording broker */
+    uint32_t rank;
+    int ring;
+    int type;
+    int direction;
+    uint32_t hash;
+    uint32_t id;
+    uint32_t nodeid;
+    uint32_t size;
+};
+
+/* An RPC, seen from the client (request sent, response received),
+ * the server (request received, response sent), or both.
+ * Times are negative if not seen.
+ */
+struct span {
+    uint32_t hash;
+    uint32_t id;
+    int client_rank;
+    int client_ring;
+    int server_rank;
+    int server_ring;
+    double t_start;
+    double t_request_sent;
+    double t_request_recv;
+    double t_response_sent;
+    double t_response_recv;
+    int responses;
+};
+
+struct trace {
+    struct rec *recs;
+    int count;
+    int size;
+    int lost;
+    zhashx_t *topics;       /* hash (decimal string) => topic */
+};
+
+static struct optparse_option cmdopts[] = {
+    { .name = "sample",   .key = 'S', .has_arg = 1, .arginfo = "N",
+      .usage = "Trace 1 in N messages, or none if N is 0, and exit",
+    },
+    { .name = "rank",     .key = 'r', .has_arg = 1, .arginfo = "N",
+      .usage = "Only broker rank N (default: all ranks)",
+    },
+    { .name = "raw",      .key = 'R', .has_arg = 0,
+      .usage = "Print trace records instead of RPC spans",
+    },
+    OPTPARSE_TABLE_END
+};
+
+static const char *topic_name (struct trace *tr, uint32_t hash)
+{
+    char key[16];
+    const char *name;
+
+    snprintf (key, sizeof (key), "%" PRIu32, hash);
+    if (!(name = zhashx_lookup (tr->topics, key)))
+        name = "?";
+    return name;
+}
+
+static void trace_append (struct trace *tr, struct rec *rec)
+{
+    if (tr->count == tr->size) {
+        tr->size = tr->size ? tr->size * 2 : 1024;
+        if (!(tr->recs = realloc (tr->recs, tr->size * sizeof (tr->recs[0]))))
+            oom ();
+    }
+    tr->recs[tr->count++] = *rec;
+}
+
+/* Add records from one broker's cmb.trace.drain response, converting
+ * monotonic timestamps to the broker's real time.
+ */
+static void trace_add (struct trace *tr, const char *json_str)
+{
+    json_t *o;
+    json_t *topics, *records, *entry;
+    json_int_t monotime, realtime;
+    const char *key;
+    size_t index;
+    int rank, lost;
+
+    if (!(o = json_loads (json_str, 0, NULL))
+        || json_unpack (o, "{s:i s:i s:I s:I s:o s:o}",
+                        "rank", &rank,
+                        "lost", &lost,
+                        "monotime", &monotime,
+                        "realtime", &realtime,
+                        "topics", &topics,
+                        "records", &records) < 0)
+        log_msg_exit ("error decoding cmb.trace.drain response");
+    tr->lost += lost;
+    json_object_foreach (topics, key, entry) {
+        const char *name = json_string_value (entry);
+        if (name && !zhashx_lookup (tr->topics, key))
+            (void)zhashx_insert (tr->topics, key, (void *)name);
+    }
+    json_array_foreach (records, index, entry) {
+        json_int_t t, hash, id, nodeid, size;
+        struct rec rec = { .rank = rank };
+
+        if (json_unpack (entry, "[I I I I I i i i]",
+                         &t, &hash, &id, &nodeid, &size,
+                         &rec.ring, &rec.type, &rec.direction) < 0)
+            log_msg_exit ("error decoding trace record");
+        rec.t = (t - monotime + realtime) * 1E-9;
+        rec.hash = hash;
+        rec.id = id;
+        rec.nodeid = nodeid;
+        rec.size = size;
+        trace_append (tr, &rec);
+    }
+    json_decref (o);
+}
+
+static void trace_get_cb (uint32_t nodeid, const char *json_str, int errnum,
+                          void *arg)
+{
+    if (errnum == 0 && !json_str)
+        errnum = EPROTO;
+    if (errnum != 0) {
+        if (nodeid != FLUX_NODEID_ANY)
+            log_errn (errnum, "cmb.trace.drain[%" PRIu32 "]", nodeid);
+        else
+            log_errn (errnum, "cmb.trace.drain");
+        return;
+    }
+    trace_add (arg, json_str);
+}
+
+static void trace_get (struct trace *tr, flux_t *h, const char *nodeset)
+{
+    flux_mrpc_t *r;
+
+    if (!(r = flux_mrpc (h, "cmb.trace.drain", NULL, nodeset, 0))
+        || flux_mrpc_foreach (r, trace_get_cb, tr) < 0)
+        log_err_exit ("cmb.trace.drain");
+    flux_mrpc_destroy (r);
+}
+
+static void set_sample (flux_t *h, const char *nodeset, int n)
+{
+    flux_mrpc_t *r;
+
+    if (!(r = flux_mrpc_pack (h, "cmb.trace.sample", nodeset, 0,
+                              "{s:i}", "sample", n)))
+        log_err_exit ("cmb.trace.sample");
+    do {
+        uint32_t nodeid = FLUX_NODEID_ANY;
+
+        if (flux_mrpc_get_nodeid (r, &nodeid) < 0
+            || flux_mrpc_get (r, NULL) < 0)
+            log_err_exit ("cmb.trace.sample[%" PRIu32 "]", nodeid);
+    } while (flux_mrpc_next (r) == 0);
+    flux_mrpc_destroy (r);
+}
+
+static int rec_cmp (const void *a, const void *b)
+{
+    const struct rec *x = a;
+    const struct rec *y = b;
+
+    return x->t < y->t ? -1 : x->t > y->t ? 1 : 0;
+}
+
+static void print_raw (struct trace *tr)
+{
+    double t0 = tr->count > 0 ? tr->recs[0].t : 0.;
+    int i;
+
+    printf ("%-12s %-10s %-4s %-8s %-32s %10s %10s %8s\n",
+            "TIME", "RANK.RING", "DIR", "TYPE", "TOPIC", "ID",
+            "NODEID", "SIZE");
+    for (i = 0; i < tr->count; i++) {
+        struct rec *r = &tr->recs[i];
+        char where[32];
+        char nodeid[16] = "any";
+
+        snprintf (where, sizeof (where), "%" PRIu32 ".%d", r->rank, r->ring);
+        if (r->nodeid != FLUX_NODEID_ANY)
+            snprintf (nodeid, sizeof (nodeid), "%" PRIu32, r->nodeid);
+        printf ("%12.6f %-10s %-4s %-8s %-32s %10" PRIu32 " %10s %8"
+                PRIu32 "\n",
+                r->t - t0,
+                where,
+                r->direction == FLUX_TRACE_SEND ? "send" : "recv",
+                flux_msg_typestr (r->type),
+                topic_name (tr, r->hash),
+                r->id,
+                nodeid,
+                r->size);
+    }
+}
+
+static void span_key (char *buf, size_t size, const struct rec *r,
+                      bool local)
+{
+    if (local)
+        snprintf (buf, size, "%" PRIu32 ".%d.%" PRIu32 ".%" PRIu32,
+                  r->rank, r->ring, r->hash, r->id);
+    else
+        snprintf (buf, size, "%" PRIu32 ".%" PRIu32, r->hash, r->id);
+}
+
+static struct span *span_create (zlistx_t *spans, const struct rec *r)
+{
+    struct span *s;
+
+    if (!(s = calloc (1, sizeof (*s))))
+        oom ();
+    s->hash = r->hash;
+    s->id = r->id;
+    s->client_rank = s->client_ring = -1;
+    s->server_rank = s->server_ring = -1;
+    s->t_start = r->t;
+    s->t_request_sent = s->t_request_recv = -1.;
+    s->t_response_sent = s->t_response_recv = -1.;
+    if (!zlistx_add_end (spans, s))
+        oom ();
+    return s;
+}
+
+/* Walk records in time order, pairing each request with its response
+ * on the client and on the server, then pairing client and server by
+ * topic and matchtag.  Matchtags are only unique per handle, so the
+ * most recent unanswered request with the same topic and matchtag,
+ * addressed to the receiving rank, is assumed to be the one received.
+ */
+static void span_build (struct trace *tr, zlistx_t *spans)
+{
+    zhashx_t *client;       /* rank.ring.hash.id => span */
+    zhashx_t *server;       /* rank.ring.hash.id => span */
+    zhashx_t *pending;      /* hash.id => span awaiting server */
+    int i;
+
+    if (!(client = zhashx_new ())
+        || !(server = zhashx_new ())
+        || !(pending = zhashx_new ()))
+        oom ();
+    for (i = 0; i < tr->count; i++) {
+        struct rec *r = &tr->recs[i];
+        char key[64];
+        char pkey[32];
+        struct span *s;
+
+        span_key (key, sizeof (key), r, true);
+        span_key (pkey, sizeof (pkey), r, false);
+        if (r->type == FLUX_MSGTYPE_REQUEST) {
+            if (r->direction == FLUX_TRACE_SEND) {
+                s = span_create (spans, r);
+                s->client_rank = r->rank;
+                s->client_ring = r->ring;
+                s->t_request_sent = r->t;
+                zhashx_update (client, key, s);
+                zhashx_update (pending, pkey, s);
+            }
+            else {
+                s = zhashx_lookup (pending, pkey);
+                if (s && s->server_rank < 0
+                      && (r->nodeid == FLUX_NODEID_ANY
+                          || r->nodeid == r->rank))
+                    zhashx_delete (pending, pkey);
+                else
+                    s = span_create (spans, r);
+                s->server_rank = r->rank;
+                s->server_ring = r->ring;
+                s->t_request_recv = r->t;
+                zhashx_update (server, key, s);
+            }
+        }
+        else if (r->type == FLUX_MSGTYPE_RESPONSE) {
+            if (r->direction == FLUX_TRACE_SEND) {
+                if ((s = zhashx_lookup (server, key))
+                    && s->t_response_sent < 0)
+                    s->t_response_sent = r->t;
+            }
+            else {
+                if ((s = zhashx_lookup (client, key))) {
+                    if (s->t_response_recv < 0)
+                        s->t_response_recv = r->t;
+                    s->responses++;
+                }
+            }
+        }
+    }
+    zhashx_destroy (&client);
+    zhashx_destroy (&server);
+    zhashx_destroy (&pending);
+}
+
+static const char *fmt_where (char *buf, size_t size, int rank, int ring)
+{
+    if (rank < 0)
+        return "-";
+    snprintf (buf, size, "%d.%d", rank, ring);
+    return buf;
+}
+
+static const char *fmt_interval (char *buf, size_t size, double t1, double t2)
+{
+    if (t1 < 0 || t2 < 0)
+        return "-";
+    snprintf (buf, size, "%.1f", (t2 - t1) * 1E6);
+    return buf;
+}
+
+static void span_destroy (void **item)
+{
+    if (item) {
+        free (*item);
+        *item = NULL;
+    }
+}
+
+static void print_spans (struct trace *tr)
+{
+    zlistx_t *spans;
+    struct span *s;
+    double t0 = tr->count > 0 ? tr->recs[0].t : 0.;
+
+    if (!(spans = zlistx_new ()))
+        oom ();
+    zlistx_set_destructor (spans, span_destroy);
+    span_build (tr, spans);
+
+    printf ("%-12s %-32s %-10s %-10s %10s %12s\n",
+            "TIME", "TOPIC", "CLIENT", "SERVER", "RTT(us)", "SERVICE(us)");
+    s = zlistx_first (spans);
+    while (s) {
+        char client[32], server[32], rtt[32], service[32];
+
+        printf ("%12.6f %-32s %-10s %-10s %10s %12s\n",
+                s->t_start - t0,
+                topic_name (tr, s->hash),
+                fmt_where (client, sizeof (client),
+                           s->client_rank, s->client_ring),
+                fmt_where (server, sizeof (server),
+                           s->server_rank, s->server_ring),
+                fmt_interval (rtt, sizeof (rtt),
+                              s->t_request_sent, s->t_response_recv),
+                fmt_interval (service, sizeof (service),
+                              s->t_request_recv, s->t_response_sent));
+        s = zlistx_next (spans);
+    }
+    zlistx_destroy (&spans);
+}
+
+int main (int argc, char *argv[])
+{
+    optparse_t *opts;
+    int optindex;
+    flux_t *h;
+    char *nodeset;
+    struct trace tr;
+
+    log_init ("flux-trace");
+
+    opts = optparse_create ("flux-trace");
+    if (optparse_add_option_table (opts, cmdopts) != OPTPARSE_SUCCESS)
+        log_msg_exit ("optparse_add_option_table");
+    if ((optindex = optparse_parse_args (opts, argc, argv)) < 0)
+        exit (1);
+    if (optindex != argc) {
+        optparse_print_usage (opts);
+        exit (1);
+    }
+    if (optparse_hasopt (opts, "rank")) {
+        int rank = optparse_get_int (opts, "rank", -1);
+        if (rank < 0)
+            log_msg_exit ("rank must be >= 0");
+        if (asprintf (&nodeset, "[%d]", rank) < 0)
+            oom ();
+    }
+    else if (!(nodeset = strdup ("all")))
+        oom ();
+
+    if (!(h = flux_open (NULL, 0)))
+        log_err_exit ("flux_open");
+
+    if (optparse_hasopt (opts, "sample")) {
+        int n = optparse_get_int (opts, "sample", -1);
+        if (n < 0)
+            log_msg_exit ("sample must be >= 0");
+        set_sample (h, nodeset, n);
+        goto done;
+    }
+
+    memset (&tr, 0, sizeof (tr));
+    if (!(tr.topics = zhashx_new ()))
+        oom ();
+    /* Topic strings point into JSON responses, so duplicate them.
+     */
+    zhashx_set_duplicator (tr.topics, (zhashx_duplicator_fn *)strdup);
+    zhashx_set_destructor (tr.topics, (zhashx_destructor_fn *)zstr_free);
+    trace_get (&tr, h, nodeset);
+    qsort (tr.recs, tr.count, sizeof (tr.recs[0]), rec_cmp);
+    if (optparse_hasopt (opts, "raw"))
+        print_raw (&tr);
+    else
+        print_spans (&tr);
+    if (tr.lost > 0)
+        log_msg ("%d records were lost to ring overflow", tr.lost);
+    zhashx_destroy (&tr.topics);
+    free (tr.recs);
+done:
+    free (nodeset);
+    flux_close (h);
+    optparse_destroy (opts);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
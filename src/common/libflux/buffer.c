@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <sys/param.h>
 
 #include "buffer.h"
 #include "buffer_private.h"
@@ -25,6 +26,11 @@
 
 #define FLUX_BUFFER_MAGIC 0xeb4feb4f
 
+/* Initial allocation for buffer storage and user reads.  Both grow on
+ * demand up to the buffer size, and are trimmed back once drained.
+ */
+#define FLUX_BUFFER_MINALLOC 4096
+
 enum {
     FLUX_BUFFER_CB_TYPE_NONE,
     FLUX_BUFFER_CB_TYPE_READ,
@@ -63,19 +69,16 @@ flux_buffer_t *flux_buffer_create (int size)
     fb->size = size;
     fb->readonly = false;
 
-    if (!(fb->cbuf = cbuf_create (fb->size, fb->size)))
+    if (!(fb->cbuf = cbuf_create (MIN (fb->size, FLUX_BUFFER_MINALLOC),
+                                  fb->size)))
         goto cleanup;
 
     if (cbuf_opt_set (fb->cbuf, CBUF_OPT_OVERWRITE, CBUF_NO_DROP) < 0)
         goto cleanup;
 
-    /* +1 for possible NUL on line reads */
-    fb->buflen = size + 1;
-
-    if (!(fb->buf = malloc (fb->buflen))) {
-        errno = ENOMEM;
-        goto cleanup;
-    }
+    /* user read buffer is allocated on first read */
+    fb->buf = NULL;
+    fb->buflen = 0;
 
     fb->cb_type = FLUX_BUFFER_CB_TYPE_NONE;
 
@@ -127,6 +130,39 @@ int flux_buffer_space (flux_buffer_t *fb)
     return cbuf_free (fb->cbuf);
 }
 
+int flux_buffer_memsize (flux_buffer_t *fb)
+{
+    if (!fb || fb->magic != FLUX_BUFFER_MAGIC) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return cbuf_capacity (fb->cbuf) + fb->buflen;
+}
+
+/* Ensure the user read buffer can hold [len] bytes plus a NUL.  The
+ * buffer tracks the size of recent reads rather than the buffer size,
+ * so it is shrunk when it is much larger than needed.
+ */
+static int reserve_buf (flux_buffer_t *fb, int len)
+{
+    int want = len + 1;
+
+    if (want > fb->buflen
+        || (fb->buflen > FLUX_BUFFER_MINALLOC && want < fb->buflen / 4)) {
+        int n = MIN (MAX (want, FLUX_BUFFER_MINALLOC), fb->size + 1);
+        char *buf;
+
+        if (!(buf = realloc (fb->buf, n))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        fb->buf = buf;
+        fb->buflen = n;
+    }
+    return 0;
+}
+
 int flux_buffer_readonly (flux_buffer_t *fb)
 {
     if (!fb || fb->magic != FLUX_BUFFER_MAGIC) {
@@ -318,11 +354,11 @@ const void *flux_buffer_peek (flux_buffer_t *fb, int len, int *lenp)
         return NULL;
     }
 
-    if (len < 0)
+    if (len < 0 || len > cbuf_used (fb->cbuf))
         len = cbuf_used (fb->cbuf);
 
-    if (len > fb->buflen)
-        len = fb->buflen;
+    if (reserve_buf (fb, len) < 0)
+        return NULL;
 
     if ((ret = cbuf_peek (fb->cbuf, fb->buf, len)) < 0)
         return NULL;
@@ -343,11 +379,11 @@ const void *flux_buffer_read (flux_buffer_t *fb, int len, int *lenp)
         return NULL;
     }
 
-    if (len < 0)
+    if (len < 0 || len > cbuf_used (fb->cbuf))
         len = cbuf_used (fb->cbuf);
 
-    if (len > fb->buflen)
-        len = fb->buflen;
+    if (reserve_buf (fb, len) < 0)
+        return NULL;
 
     if ((ret = cbuf_read (fb->cbuf, fb->buf, len)) < 0)
         return NULL;
@@ -405,7 +441,7 @@ int flux_buffer_drop_line (flux_buffer_t *fb)
         return -1;
     }
 
-    if ((ret = cbuf_drop_line (fb->cbuf, fb->buflen, 1)) < 0)
+    if ((ret = cbuf_drop_line (fb->cbuf, fb->size + 1, 1)) < 0)
         return -1;
 
     check_write_cb (fb);
@@ -422,6 +458,9 @@ const void *flux_buffer_peek_line (flux_buffer_t *fb, int *lenp)
         return NULL;
     }
 
+    if (reserve_buf (fb, cbuf_used (fb->cbuf)) < 0)
+        return NULL;
+
     if ((ret = cbuf_peek_line (fb->cbuf, fb->buf, fb->buflen, 1)) < 0)
         return NULL;
 
@@ -459,6 +498,9 @@ const void *flux_buffer_read_line (flux_buffer_t *fb, int *lenp)
         return NULL;
     }
 
+    if (reserve_buf (fb, cbuf_used (fb->cbuf)) < 0)
+        return NULL;
+
     if ((ret = cbuf_read_line (fb->cbuf, fb->buf, fb->buflen, 1)) < 0)
         return NULL;
 
@@ -543,6 +585,8 @@ int flux_buffer_read_to_fd (flux_buffer_t *fb, int fd, int len)
 int flux_buffer_write_from_fd (flux_buffer_t *fb, int fd, int len)
 {
     int ret;
+    int capacity;
+    int avail;
 
     if (!fb || fb->magic != FLUX_BUFFER_MAGIC) {
         errno = EINVAL;
@@ -554,6 +598,18 @@ int flux_buffer_write_from_fd (flux_buffer_t *fb, int fd, int len)
         return -1;
     }
 
+    /* cbuf grows to fit [len] before reading, so limit the read to the
+     * space already allocated, or if that is exhausted, to doubling it.
+     * Callers passing the full buffer space then only grow the buffer
+     * as data arrives.
+     */
+    capacity = cbuf_capacity (fb->cbuf);
+    avail = capacity - cbuf_used (fb->cbuf);
+    if (avail == 0)
+        avail = capacity;
+    if (len > avail)
+        len = avail;
+
     if ((ret = cbuf_write_from_fd (fb->cbuf, fd, len, NULL)) < 0)
         return -1;
 
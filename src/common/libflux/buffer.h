@@ -13,7 +13,9 @@
 
 typedef struct flux_buffer flux_buffer_t;
 
-/* Create buffer.
+/* Create buffer.  [size] is the maximum number of bytes the buffer
+ * may hold.  Memory is allocated on demand as data is written, up to
+ * [size], and released again once the buffer has been drained.
  */
 flux_buffer_t *flux_buffer_create (int size);
 
@@ -28,6 +30,10 @@ int flux_buffer_bytes (flux_buffer_t *fb);
 /* Returns the number of bytes of space available in flux_buffer */
 int flux_buffer_space (flux_buffer_t *fb);
 
+/* Returns the number of bytes of memory currently allocated for
+ * storage and reads by flux_buffer */
+int flux_buffer_memsize (flux_buffer_t *fb);
+
 /* Manage "readonly" status
  * - flux_buffer_readonly() makes it so writes are no longer allowed
  *   to the buffer.  Reads are allowed until the buffer is empty.
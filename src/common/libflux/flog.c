@@ -234,7 +234,7 @@ done:
 
 static flux_future_t *dmesg_rpc (flux_t *h, int seq, bool follow)
 {
-    return flux_rpc_pack (h, "log.dmesg", FLUX_NODEID_ANY, 0,
+    return flux_rpc_pack (h, "log.dmesg", FLUX_NODEID_ANY, FLUX_RPC_STREAMING,
                           "{s:i s:b}", "seq", seq, "follow", follow);
 }
 
@@ -251,29 +251,28 @@ done:
     return rc;
 }
 
+/* The broker responds once per entry, ending the stream with ENODATA
+ * unless following.
+ */
 int flux_dmesg (flux_t *h, int flags, flux_log_f fun, void *arg)
 {
     int rc = -1;
     int seq = -1;
-    bool eof = false;
     bool follow = false;
 
     if (flags & FLUX_DMESG_FOLLOW)
         follow = true;
     if (fun) {
-        while (!eof) {
-            flux_future_t *f;
-            if (!(f = dmesg_rpc (h, seq, follow)))
-                goto done;
-            if (dmesg_rpc_get (f, &seq, fun, arg) < 0) {
-                if (errno != ENOENT) {
-                    flux_future_destroy (f);
-                    goto done;
-                }
-                eof = true;
-            }
+        flux_future_t *f;
+        if (!(f = dmesg_rpc (h, seq, follow)))
+            goto done;
+        while (dmesg_rpc_get (f, &seq, fun, arg) == 0)
+            flux_future_reset (f);
+        if (errno != ENODATA) {
             flux_future_destroy (f);
+            goto done;
         }
+        flux_future_destroy (f);
     }
     if ((flags & FLUX_DMESG_CLEAR)) {
         if (dmesg_clear (h, seq) < 0)
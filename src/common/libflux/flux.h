@@ -34,6 +34,7 @@
 #include "barrier.h"
 #include "buffer.h"
 #include "service.h"
+#include "trace.h"
 #include "version.h"
 
 #endif /* !_FLUX_CORE_FLUX_H */
@@ -32,6 +32,7 @@
 #include "msg_handler.h" // for flux_sleep_on ()
 #include "flog.h"
 #include "conf.h"
+#include "trace_private.h"
 
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/msglist.h"
@@ -603,6 +604,7 @@ int flux_send (flux_t *h, const flux_msg_t *msg, int flags)
     }
     flags |= h->flags;
     update_tx_stats (h, msg);
+    trace_msg (msg, FLUX_TRACE_SEND);
     if (flags & FLUX_O_TRACE)
         flux_msg_fprint (stderr, msg);
     if (h->ops->send (h->impl, msg, flags) < 0)
@@ -691,6 +693,7 @@ flux_msg_t *flux_recv (flux_t *h, struct flux_match match, int flags)
         }
     } while (!msg);
     update_rx_stats (h, msg);
+    trace_msg (msg, FLUX_TRACE_RECV);
     if ((flags & FLUX_O_TRACE))
         flux_msg_fprint (stderr, msg);
     if (defer_requeue (&l, h) < 0)
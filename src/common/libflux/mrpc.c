@@ -371,6 +371,30 @@ int flux_mrpc_next (flux_mrpc_t *mrpc)
     return 0;
 }
 
+int flux_mrpc_foreach (flux_mrpc_t *mrpc, flux_mrpc_foreach_f cb, void *arg)
+{
+    if (!mrpc || !cb) {
+        errno = EINVAL;
+        return -1;
+    }
+    assert (mrpc->magic == MRPC_MAGIC);
+    if (mrpc->rx_expected == 0)
+        return 0;
+    do {
+        uint32_t nodeid = FLUX_NODEID_ANY;
+        const char *s = NULL;
+        int errnum = 0;
+
+        if (flux_mrpc_get_nodeid (mrpc, &nodeid) < 0
+            || flux_mrpc_get (mrpc, &s) < 0) {
+            errnum = errno;
+            s = NULL;
+        }
+        cb (nodeid, s, errnum, arg);
+    } while (flux_mrpc_next (mrpc) == 0);
+    return 0;
+}
+
 static flux_mrpc_t *mrpc_request (flux_t *h,
                                   uint32_t nodeid,
                                   int flags,
@@ -22,6 +22,8 @@ extern "C" {
 
 typedef struct flux_mrpc_struct flux_mrpc_t;
 typedef void (*flux_mrpc_continuation_f)(flux_mrpc_t *mrpc, void *arg);
+typedef void (*flux_mrpc_foreach_f)(uint32_t nodeid, const char *s,
+                                    int errnum, void *arg);
 
 /* Send an RPC request to 'nodeset' and return a flux_mrpc_t object to
  * allow responses to be handled.  "all" is a valid shorthand for all
@@ -89,6 +91,15 @@ int flux_mrpc_then (flux_mrpc_t *mrpc, flux_mrpc_continuation_f cb, void *arg);
  */
 int flux_mrpc_next (flux_mrpc_t *mrpc);
 
+/* Wait for each remaining response in turn and call 'cb' with the nodeid
+ * it came from and its payload 's' (NULL if none), or if the response
+ * is an error, with 's' NULL and 'errnum' set.  'nodeid' is
+ * FLUX_NODEID_ANY if it could not be determined.  This replaces the
+ * flux_mrpc_get()/flux_mrpc_next() loop for synchronous users.
+ * Returns 0 once all responses have been handled, -1 on error (EINVAL).
+ */
+int flux_mrpc_foreach (flux_mrpc_t *mrpc, flux_mrpc_foreach_f cb, void *arg);
+
 /* Helper functions for extending flux_mrpc_t.
  */
 void *flux_mrpc_aux_get (flux_mrpc_t *mrpc, const char *name);
@@ -31,6 +31,10 @@
 #include "reactor.h"
 #include "msg_handler.h"
 #include "flog.h"
+#include "rpc_private.h"
+
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/hist.h"
 
 struct flux_rpc {
     flux_t *h;
@@ -38,6 +42,8 @@ struct flux_rpc {
     int flags;
     flux_future_t *f;
     bool sent;
+    struct timespec t_sent;
+    struct hist *latency;   /* NULL once the first response is recorded */
 };
 
 static void log_matchtag_leak (flux_t *h, const char *msg, int matchtag)
@@ -90,6 +96,25 @@ static void rpc_destroy (struct flux_rpc *rpc)
     }
 }
 
+/* Get the handle's RPC latency histogram, creating it on first use.
+ * Latency is not recorded if it cannot be created.
+ */
+static struct hist *latency_hist (flux_t *h)
+{
+    struct hist *hist = rpc_latency_hist (h);
+
+    if (!hist) {
+        if (!(hist = hist_create ()))
+            return NULL;
+        if (flux_aux_set (h, RPC_LATENCY_AUX_KEY, hist,
+                          (flux_free_f)hist_destroy) < 0) {
+            hist_destroy (hist);
+            return NULL;
+        }
+    }
+    return hist;
+}
+
 static struct flux_rpc *rpc_create (flux_t *h, flux_future_t *f, int flags)
 {
     struct flux_rpc *rpc;
@@ -178,6 +203,7 @@ static void response_cb (flux_t *h, flux_msg_handler_t *mh,
                          const flux_msg_t *msg, void *arg)
 {
     flux_future_t *f = arg;
+    struct flux_rpc *rpc = flux_future_aux_get (f, "flux::rpc");
     flux_msg_t *cpy;
     int saved_errno;
     const char *errstr;
@@ -188,6 +214,10 @@ static void response_cb (flux_t *h, flux_msg_handler_t *mh,
 #if HAVE_CALIPER
     cali_end_byname ("flux.message.rpc");
 #endif
+    if (rpc && rpc->latency) {
+        (void)hist_record_since (rpc->latency, rpc->t_sent);
+        rpc->latency = NULL;
+    }
     if (flux_response_decode (msg, NULL, NULL) < 0)
         goto error;
     if (!(cpy = flux_msg_copy (msg, true)))
@@ -279,6 +309,10 @@ static flux_future_t *flux_rpc_message_nocopy (flux_t *h,
     if (rc < 0)
         goto error;
     rpc->sent = true;
+    if (!(flags & FLUX_RPC_NORESPONSE)) {
+        rpc->latency = latency_hist (h);
+        monotime (&rpc->t_sent);
+    }
     /* Fulfill future now if one-way
      */
     if ((flags & FLUX_RPC_NORESPONSE))
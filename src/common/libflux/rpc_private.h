@@ -0,0 +1,34 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_CORE_RPC_PRIVATE_H
+#define _FLUX_CORE_RPC_PRIVATE_H
+
+#include "handle.h"
+
+#define RPC_LATENCY_AUX_KEY "flux::rpc_latency"
+
+struct hist;
+
+/* Histogram of RPC round trip times on 'h' in microseconds, from
+ * sending the request to receiving the first response, or NULL if no
+ * RPC expecting a response has been sent yet.  Inline so it can be
+ * used outside of libflux (e.g. by the broker's module services).
+ */
+static inline struct hist *rpc_latency_hist (flux_t *h)
+{
+    return flux_aux_get (h, RPC_LATENCY_AUX_KEY);
+}
+
+#endif /* !_FLUX_CORE_RPC_PRIVATE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -1196,6 +1196,80 @@ void readonly_buffer (void)
     close (pipefds[1]);
 }
 
+void lazy_buffer (void)
+{
+    flux_buffer_t *fb;
+    char *data;
+    const char *ptr;
+    int size = 1024*1024;
+    int initial;
+    int drained;
+    int lenp;
+    int pipefds[2];
+
+    if (!(data = malloc (size)))
+        BAIL_OUT ("malloc failed");
+    memset (data, 'a', size);
+
+    ok ((fb = flux_buffer_create (size)) != NULL,
+        "flux_buffer_create works");
+
+    initial = flux_buffer_memsize (fb);
+    ok (initial > 0 && initial < size / 16,
+        "flux_buffer_memsize is small on creation");
+
+    ok (flux_buffer_space (fb) == size,
+        "flux_buffer_space returns full size on creation");
+
+    ok (flux_buffer_write (fb, data, size) == size,
+        "flux_buffer_write of full size works");
+
+    ok (flux_buffer_memsize (fb) >= size,
+        "flux_buffer_memsize grows to hold data");
+
+    ok (flux_buffer_space (fb) == 0,
+        "flux_buffer_space returns 0 when full");
+
+    ptr = flux_buffer_read (fb, -1, &lenp);
+    ok (ptr != NULL && lenp == size && ptr[0] == 'a' && ptr[size - 1] == 'a',
+        "flux_buffer_read of full size works");
+
+    ok (flux_buffer_write (fb, "foo", 3) == 3,
+        "flux_buffer_write works");
+
+    ptr = flux_buffer_read (fb, -1, &lenp);
+    ok (ptr != NULL && lenp == 3 && !strcmp (ptr, "foo"),
+        "flux_buffer_read works");
+
+    ok ((drained = flux_buffer_memsize (fb)) < size / 16,
+        "flux_buffer_memsize shrinks back once drained");
+
+    ok (pipe (pipefds) == 0,
+        "pipe succeeded");
+
+    ok (write (pipefds[1], "bar", 3) == 3,
+        "write to pipe works");
+
+    ok (flux_buffer_write_from_fd (fb, pipefds[0], flux_buffer_space (fb)) == 3,
+        "flux_buffer_write_from_fd works");
+
+    ok (flux_buffer_memsize (fb) == drained,
+        "flux_buffer_write_from_fd of full space does not grow buffer");
+
+    ptr = flux_buffer_read (fb, -1, &lenp);
+    ok (ptr != NULL && lenp == 3 && !strcmp (ptr, "bar"),
+        "flux_buffer_read works");
+
+    errno = 0;
+    ok (flux_buffer_memsize (NULL) < 0 && errno == EINVAL,
+        "flux_buffer_memsize fails on bad input");
+
+    flux_buffer_destroy (fb);
+    close (pipefds[0]);
+    close (pipefds[1]);
+    free (data);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -1207,6 +1281,7 @@ int main (int argc, char *argv[])
     corner_case ();
     full_buffer ();
     readonly_buffer ();
+    lazy_buffer ();
 
     done_testing();
 
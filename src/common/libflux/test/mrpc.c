@@ -226,6 +226,29 @@ void test_mrpc_matchtag_leak (flux_t *h)
         "matchag reclaim did not prematurely retire orphaned group matchtag");
 }
 
+/* foreach test - count responses, and record the last error */
+struct foreach_ctx {
+    int count;
+    int payloads;
+    int errors;
+    uint32_t error_nodeid;
+    int error_errnum;
+};
+static void foreach_cb (uint32_t nodeid, const char *s, int errnum,
+                        void *arg)
+{
+    struct foreach_ctx *ctx = arg;
+
+    ctx->count++;
+    if (errnum != 0) {
+        ctx->errors++;
+        ctx->error_nodeid = nodeid;
+        ctx->error_errnum = errnum;
+    }
+    else if (s != NULL)
+        ctx->payloads++;
+}
+
 void test_mrpc (flux_t *h)
 {
     uint32_t nodeid;
@@ -387,6 +410,24 @@ void test_mrpc (flux_t *h)
         "flux_mrpc_get correctly reports single error");
     flux_mrpc_destroy (r);
 
+    /* same with flux_mrpc_foreach () */
+    errno = 0;
+    ok (flux_mrpc_foreach (NULL, foreach_cb, NULL) < 0 && errno == EINVAL,
+        "flux_mrpc_foreach mrpc=NULL fails with EINVAL");
+    nodeid_fake_error = 20;
+    ok ((r = flux_mrpc (h, "rpctest.nodeid", NULL, "[0-63]", 0)) != NULL,
+        "flux_mrpc [0-%d] ok",
+        64 - 1);
+    struct foreach_ctx ctx = { 0 };
+    ok (flux_mrpc_foreach (r, foreach_cb, &ctx) == 0,
+        "flux_mrpc_foreach works");
+    ok (ctx.count == 64 && ctx.payloads == 63,
+        "flux_mrpc_foreach passed 63 payloads");
+    ok (ctx.errors == 1 && ctx.error_nodeid == 20
+        && ctx.error_errnum == EPERM,
+        "flux_mrpc_foreach passed single error with its nodeid");
+    flux_mrpc_destroy (r);
+
     /* test that a fatal handle error causes flux_mrpc_next () to fail */
     flux_fatal_set (h, NULL, NULL); /* reset handler and flag */
     ok (flux_fatality (h) == false,
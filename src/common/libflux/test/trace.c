@@ -0,0 +1,215 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <flux/core.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libflux/test/util.h"
+
+#define THREAD_COUNT 4
+#define THREAD_MSGS 100
+
+/* Send a request with 'matchtag' on loopback handle 'h' and receive it.
+ */
+static void send_recv (flux_t *h, const char *topic, uint32_t matchtag)
+{
+    flux_msg_t *msg;
+
+    if (!(msg = flux_request_encode (topic, NULL))
+        || flux_msg_set_matchtag (msg, matchtag) < 0
+        || flux_msg_set_nodeid (msg, 3) < 0
+        || flux_send (h, msg, 0) < 0)
+        BAIL_OUT ("error sending %s", topic);
+    flux_msg_destroy (msg);
+    if (!(msg = flux_recv (h, FLUX_MATCH_ANY, 0)))
+        BAIL_OUT ("error receiving %s", topic);
+    flux_msg_destroy (msg);
+}
+
+static int drain (struct flux_trace_record **recs, int *lost)
+{
+    int n;
+
+    if ((n = flux_trace_drain (recs, lost)) < 0)
+        BAIL_OUT ("flux_trace_drain failed");
+    return n;
+}
+
+void basic (flux_t *h)
+{
+    struct flux_trace_record *recs;
+    flux_msg_t *msg;
+    uint32_t hash = flux_trace_topic_hash ("trace.basic");
+    int lost;
+
+    ok (flux_trace_get_sample () == 0,
+        "tracing is disabled by default");
+    send_recv (h, "trace.basic", 1);
+    ok (drain (&recs, &lost) == 0 && lost == 0,
+        "nothing is recorded when disabled");
+    free (recs);
+
+    errno = 0;
+    ok (flux_trace_set_sample (-1) < 0 && errno == EINVAL,
+        "flux_trace_set_sample n=-1 fails with EINVAL");
+    ok (flux_trace_set_sample (1) == 0 && flux_trace_get_sample () == 1,
+        "flux_trace_set_sample n=1 works");
+
+    send_recv (h, "trace.basic", 42);
+    ok (drain (&recs, &lost) == 2 && lost == 0,
+        "send and receive were recorded");
+    if (!(msg = flux_request_encode ("trace.basic", NULL))
+        || flux_msg_set_matchtag (msg, 42) < 0
+        || flux_msg_set_nodeid (msg, 3) < 0)
+        BAIL_OUT ("flux_request_encode failed");
+    ok (recs[0].direction == FLUX_TRACE_SEND
+        && recs[1].direction == FLUX_TRACE_RECV,
+        "records are in order");
+    ok (recs[0].type == FLUX_MSGTYPE_REQUEST
+        && recs[0].topic_hash == hash
+        && recs[0].id == 42
+        && recs[0].nodeid == 3
+        && recs[0].size == flux_msg_encode_size (msg),
+        "record has type, topic hash, matchtag, nodeid, and size");
+    ok (recs[1].timestamp >= recs[0].timestamp
+        && recs[1].ring == recs[0].ring,
+        "records are from the same ring and timestamps increase");
+    flux_msg_destroy (msg);
+    free (recs);
+
+    ok (flux_trace_topic_lookup (hash) != NULL
+        && !strcmp (flux_trace_topic_lookup (hash), "trace.basic"),
+        "flux_trace_topic_lookup finds recorded topic");
+    ok (flux_trace_topic_lookup (flux_trace_topic_hash ("nope")) == NULL,
+        "flux_trace_topic_lookup returns NULL for unknown topic");
+
+    ok (drain (&recs, &lost) == 0,
+        "drain removed the records");
+    free (recs);
+}
+
+void sampling (flux_t *h)
+{
+    struct flux_trace_record *recs;
+    int sent = 0, received = 0;
+    int n, i;
+    uint32_t tag;
+
+    ok (flux_trace_set_sample (10) == 0,
+        "flux_trace_set_sample n=10 works");
+    for (tag = 1; tag <= 1000; tag++)
+        send_recv (h, "trace.sample", tag);
+    n = drain (&recs, NULL);
+    for (i = 0; i < n; i++) {
+        if (recs[i].direction == FLUX_TRACE_SEND)
+            sent++;
+        else if (i > 0 && recs[i - 1].id == recs[i].id)
+            received++;
+    }
+    ok (sent > 50 && sent < 200,
+        "about 1 in 10 messages were sampled (%d)", sent);
+    ok (received == sent,
+        "the same messages were sampled on send and receive");
+    free (recs);
+}
+
+void overflow (flux_t *h)
+{
+    struct flux_trace_record *recs;
+    int n, lost;
+    uint32_t tag;
+
+    flux_trace_set_sample (1);
+    for (tag = 1; tag <= 5000; tag++)
+        send_recv (h, "trace.overflow", tag);
+    n = drain (&recs, &lost);
+    ok (n > 0 && n < 10000 && n + lost == 10000,
+        "ring overflow loses the oldest records (kept %d, lost %d)",
+        n, lost);
+    ok (recs[n - 1].id == 5000,
+        "the newest record was kept");
+    free (recs);
+}
+
+static void *thread (void *arg)
+{
+    flux_t *h;
+    int i;
+
+    if (!(h = loopback_create (0)))
+        return NULL;
+    for (i = 0; i < THREAD_MSGS; i++)
+        send_recv (h, "trace.thread", i);
+    flux_close (h);
+    return NULL;
+}
+
+void threads (void)
+{
+    pthread_t t[THREAD_COUNT];
+    struct flux_trace_record *recs;
+    int rings[THREAD_COUNT];
+    int nrings = 0;
+    int n, i, j;
+
+    flux_trace_set_sample (1);
+    for (i = 0; i < THREAD_COUNT; i++) {
+        if (pthread_create (&t[i], NULL, thread, NULL) != 0)
+            BAIL_OUT ("pthread_create failed");
+    }
+    for (i = 0; i < THREAD_COUNT; i++)
+        pthread_join (t[i], NULL);
+    n = drain (&recs, NULL);
+    ok (n == THREAD_COUNT * THREAD_MSGS * 2,
+        "all messages sent by %d threads were recorded", THREAD_COUNT);
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < nrings; j++) {
+            if (rings[j] == recs[i].ring)
+                break;
+        }
+        if (j == nrings && nrings < THREAD_COUNT)
+            rings[nrings++] = recs[i].ring;
+    }
+    ok (nrings == THREAD_COUNT,
+        "each thread recorded to its own ring");
+    free (recs);
+}
+
+int main (int argc, char *argv[])
+{
+    flux_t *h;
+
+    plan (NO_PLAN);
+
+    if (!(h = loopback_create (0)))
+        BAIL_OUT ("loopback_create failed");
+
+    basic (h);
+    sampling (h);
+    overflow (h);
+    threads ();
+
+    flux_trace_set_sample (0);
+    flux_close (h);
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
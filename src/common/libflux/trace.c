@@ -0,0 +1,298 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* trace.c - sampling message tracer
+ *
+ * Each thread that records a message gets its own ring, which only that
+ * thread writes.  Every slot carries a sequence number (index + 1, or 0
+ * while the slot is being written), so flux_trace_drain() can copy
+ * records out from another thread without stopping the writer, and
+ * detect slots that were overwritten while it was copying them.
+ *
+ * The global lock protects the list of rings and the topic table.
+ * It is taken by a recording thread only when it first records, and
+ * when it records a topic it has not recorded before.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "message.h"
+#include "trace.h"
+#include "trace_private.h"
+
+#define RING_SIZE           4096        /* records per thread, power of 2 */
+#define RING_MASK           (RING_SIZE - 1)
+
+#define TOPIC_CACHE_SIZE    64          /* per ring, power of 2 */
+#define TOPIC_MAX           4096        /* distinct topics kept for lookup */
+#define TOPIC_SLOTS         (2 * TOPIC_MAX)
+
+struct slot {
+    uint64_t seq;
+    struct flux_trace_record rec;
+};
+
+struct ring {
+    uint64_t head;          /* next index to write (owner only) */
+    uint64_t tail;          /* next index to drain (under lock) */
+    int dead;               /* owner thread has exited */
+    uint16_t id;
+    uint32_t topic_cache[TOPIC_CACHE_SIZE]; /* hashes known to table */
+    struct ring *next;
+    struct slot slots[RING_SIZE];
+};
+
+struct topic {
+    uint32_t hash;
+    char *name;
+};
+
+int trace_sample_interval = 0;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ring *rings;
+static uint16_t ring_next_id;
+static struct topic topics[TOPIC_SLOTS];
+static int topic_count;
+
+/* Thread exit: the ring is freed by the next drain.
+ */
+static void ring_orphan (void *arg)
+{
+    struct ring *r = arg;
+
+    __atomic_store_n (&r->dead, 1, __ATOMIC_RELEASE);
+}
+
+static void key_create (void)
+{
+    (void)pthread_key_create (&ring_key, ring_orphan);
+}
+
+static struct ring *ring_get (void)
+{
+    struct ring *r;
+
+    (void)pthread_once (&key_once, key_create);
+    if ((r = pthread_getspecific (ring_key)))
+        return r;
+    if (!(r = calloc (1, sizeof (*r))))
+        return NULL;
+    pthread_mutex_lock (&lock);
+    r->id = ring_next_id++;
+    r->next = rings;
+    rings = r;
+    pthread_mutex_unlock (&lock);
+    (void)pthread_setspecific (ring_key, r);
+    return r;
+}
+
+static struct topic *topic_find (uint32_t hash)
+{
+    int i = hash % TOPIC_SLOTS;
+
+    while (topics[i].name && topics[i].hash != hash)
+        i = (i + 1) % TOPIC_SLOTS;
+    return &topics[i];
+}
+
+static void topic_add (struct ring *r, uint32_t hash, const char *name)
+{
+    uint32_t *cached = &r->topic_cache[hash & (TOPIC_CACHE_SIZE - 1)];
+    struct topic *t;
+
+    if (*cached == hash)
+        return;
+    pthread_mutex_lock (&lock);
+    t = topic_find (hash);
+    if (!t->name && topic_count < TOPIC_MAX && (t->name = strdup (name))) {
+        t->hash = hash;
+        topic_count++;
+    }
+    pthread_mutex_unlock (&lock);
+    *cached = hash;
+}
+
+/* FNV-1a
+ */
+uint32_t flux_trace_topic_hash (const char *topic)
+{
+    uint32_t hash = 2166136261u;
+
+    while (topic && *topic) {
+        hash ^= (unsigned char)*topic++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+const char *flux_trace_topic_lookup (uint32_t hash)
+{
+    const char *name;
+
+    pthread_mutex_lock (&lock);
+    name = topic_find (hash)->name;
+    pthread_mutex_unlock (&lock);
+    return name;
+}
+
+int flux_trace_set_sample (int n)
+{
+    if (n < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    __atomic_store_n (&trace_sample_interval, n, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int flux_trace_get_sample (void)
+{
+    return __atomic_load_n (&trace_sample_interval, __ATOMIC_RELAXED);
+}
+
+static uint64_t now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void trace_msg_record (const flux_msg_t *msg, int direction)
+{
+    int n = __atomic_load_n (&trace_sample_interval, __ATOMIC_RELAXED);
+    int type;
+    const char *topic;
+    uint32_t id = 0;
+    uint32_t nodeid = FLUX_NODEID_ANY;
+    uint32_t hash;
+    struct ring *r;
+    struct slot *slot;
+    uint64_t index;
+
+    if (n == 0
+        || flux_msg_get_type (msg, &type) < 0
+        || type == FLUX_MSGTYPE_KEEPALIVE
+        || flux_msg_get_topic (msg, &topic) < 0)
+        return;
+    if (type == FLUX_MSGTYPE_EVENT)
+        (void)flux_msg_get_seq (msg, &id);
+    else
+        (void)flux_msg_get_matchtag (msg, &id);
+    hash = flux_trace_topic_hash (topic);
+    if (n > 1 && (hash ^ (id * 2654435761u)) % n != 0)
+        return;
+    if (type == FLUX_MSGTYPE_REQUEST)
+        (void)flux_msg_get_nodeid (msg, &nodeid);
+    if (!(r = ring_get ()))
+        return;
+    topic_add (r, hash, topic);
+
+    index = r->head;
+    slot = &r->slots[index & RING_MASK];
+    __atomic_store_n (&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+    slot->rec.timestamp = now_ns ();
+    slot->rec.topic_hash = hash;
+    slot->rec.id = id;
+    slot->rec.nodeid = nodeid;
+    slot->rec.size = flux_msg_encode_size (msg);
+    slot->rec.ring = r->id;
+    slot->rec.type = type;
+    slot->rec.direction = direction;
+    __atomic_store_n (&slot->seq, index + 1, __ATOMIC_RELEASE);
+    __atomic_store_n (&r->head, index + 1, __ATOMIC_RELEASE);
+}
+
+/* Copy records [r->tail, head) to 'out', returning the number copied.
+ * Records that were overwritten before they could be copied are
+ * added to 'lost'.
+ */
+static int ring_drain (struct ring *r, struct flux_trace_record *out,
+                       uint64_t head, int *lost)
+{
+    uint64_t i;
+    int count = 0;
+
+    if (head - r->tail > RING_SIZE) {
+        *lost += head - r->tail - RING_SIZE;
+        r->tail = head - RING_SIZE;
+    }
+    for (i = r->tail; i < head; i++) {
+        struct slot *slot = &r->slots[i & RING_MASK];
+        uint64_t seq1, seq2;
+
+        seq1 = __atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE);
+        out[count] = slot->rec;
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n (&slot->seq, __ATOMIC_RELAXED);
+        if (seq1 == i + 1 && seq2 == i + 1)
+            count++;
+        else
+            (*lost)++;
+    }
+    r->tail = head;
+    return count;
+}
+
+int flux_trace_drain (struct flux_trace_record **records, int *lost)
+{
+    struct flux_trace_record *out;
+    struct ring **rp;
+    size_t size = 1;
+    int count = 0;
+    int lost_count = 0;
+
+    if (!records) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_mutex_lock (&lock);
+    for (rp = &rings; *rp != NULL; rp = &(*rp)->next)
+        size += RING_SIZE;
+    if (!(out = calloc (size, sizeof (out[0])))) {
+        pthread_mutex_unlock (&lock);
+        errno = ENOMEM;
+        return -1;
+    }
+    rp = &rings;
+    while (*rp) {
+        struct ring *r = *rp;
+        int dead = __atomic_load_n (&r->dead, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n (&r->head, __ATOMIC_ACQUIRE);
+
+        count += ring_drain (r, out + count, head, &lost_count);
+        if (dead) {
+            *rp = r->next;
+            free (r);
+        }
+        else
+            rp = &r->next;
+    }
+    pthread_mutex_unlock (&lock);
+    *records = out;
+    if (lost)
+        *lost = lost_count;
+    return count;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,81 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_CORE_TRACE_H
+#define _FLUX_CORE_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sampling message tracer.
+ *
+ * When enabled, flux_send() and flux_recv() append a fixed-size record
+ * for sampled messages to a ring buffer owned by the calling thread.
+ * Rings are written without locks and have a fixed capacity, so old
+ * records are overwritten (and counted as lost) if not drained in time.
+ * When disabled, the cost on the message path is a single branch.
+ *
+ * Sampling is by message, not by call: 1 in N (topic, matchtag) pairs
+ * is traced, so the request and response(s) of a sampled RPC are traced
+ * everywhere they are sent or received, in every process, as long as
+ * all use the same N.
+ */
+
+enum {
+    FLUX_TRACE_SEND = 1,
+    FLUX_TRACE_RECV = 2,
+};
+
+struct flux_trace_record {
+    uint64_t timestamp;     /* CLOCK_MONOTONIC, in nanoseconds */
+    uint32_t topic_hash;    /* see flux_trace_topic_hash() */
+    uint32_t id;            /* matchtag, or sequence number for events */
+    uint32_t nodeid;        /* request nodeid, else FLUX_NODEID_ANY */
+    uint32_t size;          /* encoded message size in bytes */
+    uint16_t ring;          /* per-thread ring that recorded it */
+    uint8_t type;           /* FLUX_MSGTYPE_* */
+    uint8_t direction;      /* FLUX_TRACE_SEND or FLUX_TRACE_RECV */
+};
+
+/* Trace 1 in 'n' messages sent or received by this process, or none
+ * if 'n' is 0 (the default).  Returns -1 on error (EINVAL), 0 on success.
+ */
+int flux_trace_set_sample (int n);
+int flux_trace_get_sample (void);
+
+/* Hash a topic string as it appears in trace records.
+ */
+uint32_t flux_trace_topic_hash (const char *topic);
+
+/* Return the topic string for a hash seen in a trace record of this
+ * process, or NULL if unknown.
+ */
+const char *flux_trace_topic_lookup (uint32_t hash);
+
+/* Remove all records from the rings of all threads in this process,
+ * oldest first within each ring.  On success, '*records' is set to an
+ * array that the caller must free, and the number of records is
+ * returned.  If 'lost' is non-NULL, it is set to the number of records
+ * overwritten since the last drain.  Returns -1 on error (ENOMEM).
+ */
+int flux_trace_drain (struct flux_trace_record **records, int *lost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_FLUX_CORE_TRACE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
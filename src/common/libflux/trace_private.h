@@ -0,0 +1,37 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_CORE_TRACE_PRIVATE_H
+#define _FLUX_CORE_TRACE_PRIVATE_H
+
+#include "message.h"
+#include "trace.h"
+
+/* Sampling interval set by flux_trace_set_sample(), 0 if disabled.
+ */
+extern int trace_sample_interval;
+
+void trace_msg_record (const flux_msg_t *msg, int direction);
+
+/* Called on every message sent or received, so the disabled case
+ * must stay a single load and predictable branch.
+ */
+static inline void trace_msg (const flux_msg_t *msg, int direction)
+{
+    if (__builtin_expect (__atomic_load_n (&trace_sample_interval,
+                                           __ATOMIC_RELAXED) != 0, 0))
+        trace_msg_record (msg, direction);
+}
+
+#endif /* !_FLUX_CORE_TRACE_PRIVATE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
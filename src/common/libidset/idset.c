@@ -18,10 +18,17 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "idset.h"
 #include "idset_private.h"
 
+/* Sets of at most this many ranges are always stored as ranges.
+ */
+#define IDSET_MIN_BITMAP_RANGES 16
+
+#define WORD_BITS 64
+
 int validate_idset_flags (int flags, int allowed)
 {
     if ((flags & allowed) != flags) {
@@ -31,6 +38,337 @@ int validate_idset_flags (int flags, int allowed)
     return 0;
 }
 
+static bool valid_id (unsigned int id)
+{
+    if (id == UINT_MAX || id == IDSET_INVALID_ID)
+        return false;
+    return true;
+}
+
+static void normalize_range (unsigned int *lo, unsigned int *hi)
+{
+    if (*hi < *lo) {
+        unsigned int tmp = *hi;
+        *hi = *lo;
+        *lo = tmp;
+    }
+}
+
+/* Bitmap representation
+ */
+
+static size_t bitmap_words (size_t size)
+{
+    return (size + WORD_BITS - 1) / WORD_BITS;
+}
+
+/* Return true if 'nranges' ranges take more memory than a bitmap of
+ * 'size' bits.
+ */
+static bool prefer_bitmap (size_t nranges, size_t size)
+{
+    return nranges > IDSET_MIN_BITMAP_RANGES
+        && nranges * sizeof (struct idset_range)
+           > bitmap_words (size) * sizeof (uint64_t);
+}
+
+/* Return mask of bits lo through hi of a word.
+ */
+static uint64_t word_mask (unsigned int lo, unsigned int hi)
+{
+    uint64_t mask = hi == WORD_BITS - 1 ? ~0ULL : (1ULL << (hi + 1)) - 1;
+    return mask & ~((1ULL << lo) - 1);
+}
+
+/* Set or clear bits lo through hi a word at a time.
+ * Return the number of bits that changed.
+ */
+static size_t bitmap_update (uint64_t *words, unsigned int lo, unsigned int hi,
+                             bool set)
+{
+    size_t first = lo / WORD_BITS;
+    size_t last = hi / WORD_BITS;
+    size_t changed = 0;
+    size_t w;
+
+    for (w = first; w <= last; w++) {
+        unsigned int l = w == first ? lo % WORD_BITS : 0;
+        unsigned int h = w == last ? hi % WORD_BITS : WORD_BITS - 1;
+        uint64_t mask = word_mask (l, h);
+        uint64_t old = words[w];
+
+        words[w] = set ? old | mask : old & ~mask;
+        changed += __builtin_popcountll (old ^ words[w]);
+    }
+    return changed;
+}
+
+/* Return the first bit at or after 'start' that is set (or clear, if
+ * set == false), or 'size' if there is none.
+ */
+static size_t bitmap_find (const uint64_t *words, size_t size, size_t start,
+                           bool set)
+{
+    size_t nwords = bitmap_words (size);
+    size_t w;
+    uint64_t word;
+
+    if (start >= size)
+        return size;
+    w = start / WORD_BITS;
+    word = (set ? words[w] : ~words[w]) & (~0ULL << (start % WORD_BITS));
+    while (word == 0) {
+        if (++w == nwords)
+            return size;
+        word = set ? words[w] : ~words[w];
+    }
+    start = w * WORD_BITS + __builtin_ctzll (word);
+    return start < size ? start : size;
+}
+
+/* Return the last set bit, or 'size' if there is none.
+ */
+static size_t bitmap_last (const uint64_t *words, size_t size)
+{
+    size_t w = bitmap_words (size);
+
+    while (w-- > 0) {
+        if (words[w])
+            return w * WORD_BITS + WORD_BITS - 1 - __builtin_clzll (words[w]);
+    }
+    return size;
+}
+
+/* Return the number of runs of consecutive set bits.
+ */
+static size_t bitmap_runs (const uint64_t *words, size_t size)
+{
+    size_t nwords = bitmap_words (size);
+    size_t runs = 0;
+    uint64_t carry = 0;
+    size_t w;
+
+    for (w = 0; w < nwords; w++) {
+        runs += __builtin_popcountll (words[w] & ~((words[w] << 1) | carry));
+        carry = words[w] >> (WORD_BITS - 1);
+    }
+    return runs;
+}
+
+/* Range representation
+ */
+
+/* Return the index of the first range with hi >= id, or nranges.
+ */
+static size_t range_search (const struct idset *idset, unsigned int id)
+{
+    size_t lo = 0;
+    size_t hi = idset->nranges;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idset->ranges[mid].hi < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int range_reserve (struct idset_range **ranges, size_t *maxranges,
+                          size_t n)
+{
+    if (n > *maxranges) {
+        size_t max = *maxranges ? *maxranges : 4;
+        struct idset_range *new;
+
+        while (max < n)
+            max *= 2;
+        if (!(new = realloc (*ranges, max * sizeof (new[0])))) {
+            errno = ENOMEM;
+            return -1;
+        }
+        *ranges = new;
+        *maxranges = max;
+    }
+    return 0;
+}
+
+/* Replace ranges [i,j) with 'n' ranges from 'new'.
+ */
+static int range_splice (struct idset *idset, size_t i, size_t j,
+                         const struct idset_range *new, size_t n)
+{
+    size_t nranges = idset->nranges - (j - i) + n;
+
+    if (range_reserve (&idset->ranges, &idset->maxranges, nranges) < 0)
+        return -1;
+    memmove (&idset->ranges[i + n], &idset->ranges[j],
+             (idset->nranges - j) * sizeof (idset->ranges[0]));
+    memcpy (&idset->ranges[i], new, n * sizeof (new[0]));
+    idset->nranges = nranges;
+    return 0;
+}
+
+/* Append [lo-hi] to a range array under construction, merging it with
+ * the last range if they overlap or are adjacent.  Ranges must be
+ * appended in order of 'lo'.
+ */
+static int range_append (struct idset_range **ranges, size_t *nranges,
+                         size_t *maxranges, unsigned int lo, unsigned int hi)
+{
+    if (*nranges > 0 && (*ranges)[*nranges - 1].hi + 1 >= lo) {
+        if ((*ranges)[*nranges - 1].hi < hi)
+            (*ranges)[*nranges - 1].hi = hi;
+        return 0;
+    }
+    if (range_reserve (ranges, maxranges, *nranges + 1) < 0)
+        return -1;
+    (*ranges)[*nranges].lo = lo;
+    (*ranges)[*nranges].hi = hi;
+    (*nranges)++;
+    return 0;
+}
+
+static size_t range_count (const struct idset_range *ranges, size_t nranges)
+{
+    size_t count = 0;
+    size_t i;
+
+    for (i = 0; i < nranges; i++)
+        count += (size_t)ranges[i].hi - ranges[i].lo + 1;
+    return count;
+}
+
+/* Switching representations.  On failure, the idset is left unchanged.
+ */
+
+static int to_bitmap (struct idset *idset)
+{
+    uint64_t *words;
+    size_t i;
+
+    if (!(words = calloc (bitmap_words (idset->size), sizeof (words[0])))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (i = 0; i < idset->nranges; i++)
+        bitmap_update (words, idset->ranges[i].lo, idset->ranges[i].hi, true);
+    free (idset->ranges);
+    idset->ranges = NULL;
+    idset->nranges = idset->maxranges = 0;
+    idset->words = words;
+    return 0;
+}
+
+static int to_ranges (struct idset *idset)
+{
+    struct idset_range *ranges = NULL;
+    size_t nranges = 0;
+    size_t maxranges = 0;
+    size_t lo, hi;
+
+    lo = bitmap_find (idset->words, idset->size, 0, true);
+    while (lo < idset->size) {
+        hi = bitmap_find (idset->words, idset->size, lo, false);
+        if (range_append (&ranges, &nranges, &maxranges, lo, hi - 1) < 0) {
+            free (ranges);
+            return -1;
+        }
+        lo = bitmap_find (idset->words, idset->size, hi, true);
+    }
+    free (idset->words);
+    idset->words = NULL;
+    idset->ranges = ranges;
+    idset->nranges = nranges;
+    idset->maxranges = maxranges;
+    return 0;
+}
+
+/* Switch to whichever representation takes less memory.
+ * This is O(size) for a bitmap, so is only called where that cost is
+ * already being paid.  Failure to switch is not an error.
+ */
+static void idset_rebalance (struct idset *idset)
+{
+    if (idset->words) {
+        if (idset->count == 0
+            || !prefer_bitmap (bitmap_runs (idset->words, idset->size),
+                               idset->size))
+            (void)to_ranges (idset);
+    }
+    else if (prefer_bitmap (idset->nranges, idset->size))
+        (void)to_bitmap (idset);
+}
+
+/* Add or remove ids [lo-hi], which must be valid and < size.
+ */
+static int idset_update (struct idset *idset, unsigned int lo, unsigned int hi,
+                         bool set)
+{
+    if (idset->words) {
+        size_t changed = bitmap_update (idset->words, lo, hi, set);
+        if (set)
+            idset->count += changed;
+        else if ((idset->count -= changed) == 0)
+            idset_rebalance (idset);
+        return 0;
+    }
+    if (set) {
+        struct idset_range r = { .lo = lo, .hi = hi };
+        size_t i = range_search (idset, lo > 0 ? lo - 1 : 0);
+        size_t j = i;
+        size_t removed = 0;
+
+        /* Merge [lo-hi] with the ranges it overlaps or adjoins.
+         */
+        while (j < idset->nranges && idset->ranges[j].lo <= hi + 1) {
+            if (idset->ranges[j].lo < r.lo)
+                r.lo = idset->ranges[j].lo;
+            if (idset->ranges[j].hi > r.hi)
+                r.hi = idset->ranges[j].hi;
+            removed += (size_t)idset->ranges[j].hi - idset->ranges[j].lo + 1;
+            j++;
+        }
+        if (range_splice (idset, i, j, &r, 1) < 0)
+            return -1;
+        idset->count += (size_t)r.hi - r.lo + 1 - removed;
+    }
+    else {
+        struct idset_range keep[2];
+        size_t i = range_search (idset, lo);
+        size_t j = i;
+        size_t n = 0;
+        size_t removed = 0;
+
+        /* Only the first and last ranges cleared can extend outside of
+         * [lo-hi], so at most two pieces are kept.
+         */
+        while (j < idset->nranges && idset->ranges[j].lo <= hi) {
+            struct idset_range *r = &idset->ranges[j++];
+            if (r->lo < lo) {
+                keep[n].lo = r->lo;
+                keep[n++].hi = lo - 1;
+                removed -= lo - r->lo;
+            }
+            if (r->hi > hi) {
+                keep[n].lo = hi + 1;
+                keep[n++].hi = r->hi;
+                removed -= r->hi - hi;
+            }
+            removed += (size_t)r->hi - r->lo + 1;
+        }
+        if (i == j)
+            return 0;
+        if (range_splice (idset, i, j, keep, n) < 0)
+            return -1;
+        idset->count -= removed;
+    }
+    if (prefer_bitmap (idset->nranges, idset->size))
+        (void)to_bitmap (idset);
+    return 0;
+}
+
 struct idset *idset_create (size_t size, int flags)
 {
     struct idset *idset;
@@ -39,16 +377,12 @@ struct idset *idset_create (size_t size, int flags)
         return NULL;
     if (size == 0)
         size = IDSET_DEFAULT_SIZE;
-    if (!(idset = malloc (sizeof (*idset))))
-        return NULL;
-    idset->T = vebnew (size, 0);
-    if (!idset->T.D) {
-        free (idset);
+    if (!(idset = calloc (1, sizeof (*idset)))) {
         errno = ENOMEM;
         return NULL;
     }
+    idset->size = size;
     idset->flags = flags;
-    idset->count = 0;
     return idset;
 }
 
@@ -56,24 +390,13 @@ void idset_destroy (struct idset *idset)
 {
     if (idset) {
         int saved_errno = errno;
-        free (idset->T.D);
+        free (idset->ranges);
+        free (idset->words);
         free (idset);
         errno = saved_errno;
     }
 }
 
-static Veb vebdup (Veb T)
-{
-    size_t size = vebsize (T.M);
-    Veb cpy;
-
-    cpy.k = T.k;
-    cpy.M = T.M;
-    if ((cpy.D = malloc (size)))
-        memcpy (cpy.D, T.D, size);
-    return cpy;
-}
-
 struct idset *idset_copy (const struct idset *idset)
 {
     struct idset *cpy;
@@ -82,110 +405,93 @@ struct idset *idset_copy (const struct idset *idset)
         errno = EINVAL;
         return NULL;
     }
-    if (!(cpy = malloc (sizeof (*idset))))
-        return NULL;
-    cpy->flags = idset->flags;
-    cpy->T = vebdup (idset->T);
-    if (!cpy->T.D) {
-        idset_destroy (cpy);
+    if (!(cpy = idset_create (idset->size, idset->flags)))
         return NULL;
+    if (idset->words) {
+        size_t len = bitmap_words (idset->size) * sizeof (idset->words[0]);
+        if (!(cpy->words = malloc (len)))
+            goto nomem;
+        memcpy (cpy->words, idset->words, len);
+    }
+    else if (idset->nranges > 0) {
+        size_t len = idset->nranges * sizeof (idset->ranges[0]);
+        if (!(cpy->ranges = malloc (len)))
+            goto nomem;
+        memcpy (cpy->ranges, idset->ranges, len);
+        cpy->nranges = cpy->maxranges = idset->nranges;
     }
     cpy->count = idset->count;
+    if (cpy->words)
+        idset_rebalance (cpy);
     return cpy;
-}
-
-static bool valid_id (unsigned int id)
-{
-    if (id == UINT_MAX || id == IDSET_INVALID_ID)
-        return false;
-    return true;
+nomem:
+    idset_destroy (cpy);
+    errno = ENOMEM;
+    return NULL;
 }
 
 /* Double idset size until it has at least 'size' slots.
- * Return 0 on success, -1 on failure with errno == ENOMEM.
+ * Return 0 on success, -1 on failure with errno set.
  */
 static int idset_grow (struct idset *idset, size_t size)
 {
-    size_t newsize = idset->T.M;
-    Veb T;
-    unsigned int id;
+    size_t newsize = idset->size;
 
     while (newsize < size)
         newsize <<= 1;
 
-    if (newsize > idset->T.M) {
+    if (newsize > idset->size) {
         if (!(idset->flags & IDSET_FLAG_AUTOGROW)) {
             errno = EINVAL;
             return -1;
         }
-        T = vebnew (newsize, 0);
-        if (!T.D)
-            return -1;
-
-        id = vebsucc (idset->T, 0);
-        while (id < idset->T.M) {
-            vebput (T, id);
-            id = vebsucc (idset->T, id + 1);
+        if (idset->words) {
+            size_t old = bitmap_words (idset->size);
+            size_t new = bitmap_words (newsize);
+            uint64_t *words;
+
+            /* A larger bitmap may no longer be the smaller representation.
+             */
+            if (!prefer_bitmap (bitmap_runs (idset->words, idset->size),
+                                newsize)) {
+                if (to_ranges (idset) < 0)
+                    return -1;
+            }
+            else {
+                if (!(words = realloc (idset->words, new * sizeof (words[0])))) {
+                    errno = ENOMEM;
+                    return -1;
+                }
+                memset (words + old, 0, (new - old) * sizeof (words[0]));
+                idset->words = words;
+            }
         }
-        free (idset->T.D);
-        idset->T = T;
+        idset->size = newsize;
     }
     return 0;
 }
 
-/* Wrapper for vebput() which increments idset count if needed
- */
-static void idset_put (struct idset *idset, unsigned int id)
-{
-    if (!idset_test (idset, id))
-        idset->count++;
-    vebput (idset->T, id);
-}
-
-/* Wrapper for vebdel() which decrements idset count if needed
- */
-static void idset_del (struct idset *idset, unsigned int id)
-{
-    if (idset_test (idset, id))
-        idset->count--;
-    vebdel (idset->T, id);
-}
-
 int idset_set (struct idset *idset, unsigned int id)
 {
     if (!idset || !valid_id (id)) {
         errno = EINVAL;
         return -1;
     }
-    if (idset_grow (idset, id + 1) < 0)
+    if (idset_grow (idset, (size_t)id + 1) < 0)
         return -1;
-    idset_put (idset, id);
-    return 0;
-}
-
-static void normalize_range (unsigned int *lo, unsigned int *hi)
-{
-    if (*hi < *lo) {
-        unsigned int tmp = *hi;
-        *hi = *lo;
-        *lo = tmp;
-    }
+    return idset_update (idset, id, id, true);
 }
 
 int idset_range_set (struct idset *idset, unsigned int lo, unsigned int hi)
 {
-    unsigned int id;
-
     if (!idset || !valid_id (lo) || !valid_id (hi)) {
         errno = EINVAL;
         return -1;
     }
     normalize_range (&lo, &hi);
-    if (idset_grow (idset, hi + 1) < 0)
+    if (idset_grow (idset, (size_t)hi + 1) < 0)
         return -1;
-    for (id = lo; id <= hi; id++)
-        idset_put (idset, id);
-    return 0;
+    return idset_update (idset, lo, hi, true);
 }
 
 int idset_clear (struct idset *idset, unsigned int id)
@@ -194,66 +500,83 @@ int idset_clear (struct idset *idset, unsigned int id)
         errno = EINVAL;
         return -1;
     }
-    idset_del (idset, id);
-    return 0;
+    if (id >= idset->size)
+        return 0;
+    return idset_update (idset, id, id, false);
 }
 
 int idset_range_clear (struct idset *idset, unsigned int lo, unsigned int hi)
 {
-    unsigned int id;
-
     if (!idset || !valid_id (lo) || !valid_id (hi)) {
         errno = EINVAL;
         return -1;
     }
     normalize_range (&lo, &hi);
-    for (id = lo; id <= hi && id < idset->T.M; id++)
-        idset_del (idset, id);
-    return 0;
+    if (lo >= idset->size)
+        return 0;
+    if (hi >= idset->size)
+        hi = idset->size - 1;
+    return idset_update (idset, lo, hi, false);
 }
 
 bool idset_test (const struct idset *idset, unsigned int id)
 {
-    if (!idset || !valid_id (id) || id >= idset->T.M)
+    size_t i;
+
+    if (!idset || !valid_id (id) || id >= idset->size)
         return false;
-    return (vebsucc (idset->T, id) == id);
+    if (idset->words)
+        return (idset->words[id / WORD_BITS] >> (id % WORD_BITS)) & 1;
+    i = range_search (idset, id);
+    return i < idset->nranges && idset->ranges[i].lo <= id;
 }
 
-unsigned int idset_first (const struct idset *idset)
+int idset_next_run (const struct idset *idset, unsigned int start,
+                    unsigned int *lo, unsigned int *hi)
 {
-    unsigned int next = IDSET_INVALID_ID;
-
-    if (idset) {
-        next = vebsucc (idset->T, 0);
-        if (next == idset->T.M)
-            next = IDSET_INVALID_ID;
+    if (idset->words) {
+        size_t l = bitmap_find (idset->words, idset->size, start, true);
+        if (l == idset->size)
+            return -1;
+        *lo = l;
+        *hi = bitmap_find (idset->words, idset->size, l, false) - 1;
     }
-    return next;
+    else {
+        size_t i = range_search (idset, start);
+        if (i == idset->nranges)
+            return -1;
+        *lo = idset->ranges[i].lo > start ? idset->ranges[i].lo : start;
+        *hi = idset->ranges[i].hi;
+    }
+    return 0;
 }
 
+unsigned int idset_first (const struct idset *idset)
+{
+    unsigned int lo, hi;
+
+    if (!idset || idset_next_run (idset, 0, &lo, &hi) < 0)
+        return IDSET_INVALID_ID;
+    return lo;
+}
 
 unsigned int idset_next (const struct idset *idset, unsigned int prev)
 {
-    unsigned int next = IDSET_INVALID_ID;
+    unsigned int lo, hi;
 
-    if (idset) {
-        next = vebsucc (idset->T, prev + 1);
-        if (next == idset->T.M)
-            next = IDSET_INVALID_ID;
-    }
-    return next;
+    if (!idset || !valid_id (prev)
+        || idset_next_run (idset, prev + 1, &lo, &hi) < 0)
+        return IDSET_INVALID_ID;
+    return lo;
 }
 
 unsigned int idset_last (const struct idset *idset)
 {
-    unsigned int last = IDSET_INVALID_ID;
-
-    if (idset) {
-        last = vebpred (idset->T, idset->T.M - 1);
-        if (last == idset->T.M)
-            last = IDSET_INVALID_ID;
-    }
-    return last;
+    if (!idset || idset->count == 0)
+        return IDSET_INVALID_ID;
+    if (idset->words)
+        return bitmap_last (idset->words, idset->size);
+    return idset->ranges[idset->nranges - 1].hi;
 }
 
 size_t idset_count (const struct idset *idset)
@@ -266,28 +589,389 @@ size_t idset_count (const struct idset *idset)
 bool idset_equal (const struct idset *idset1,
                   const struct idset *idset2)
 {
-    unsigned int id;
+    unsigned int lo1, hi1, lo2, hi2;
+    unsigned int id = 0;
 
     if (!idset1 || !idset2)
         return false;
     if (idset_count (idset1) != idset_count (idset2))
         return false;
+    if (!idset1->words && !idset2->words) {
+        return idset1->nranges == idset2->nranges
+            && !memcmp (idset1->ranges, idset2->ranges,
+                        idset1->nranges * sizeof (idset1->ranges[0]));
+    }
+    /* Runs are maximal in either representation, so equal sets have
+     * identical runs.  Since counts are equal, idset2 has no more.
+     */
+    while (idset_next_run (idset1, id, &lo1, &hi1) == 0) {
+        if (idset_next_run (idset2, id, &lo2, &hi2) < 0
+            || lo1 != lo2 || hi1 != hi2)
+            return false;
+        id = hi1 + 1;
+    }
+    return true;
+}
 
-    id = vebsucc (idset1->T, 0);
-    while (id < idset1->T.M) {
-        if (vebsucc (idset2->T, id) != id)
-            return false; // id in idset1 not set in idset2
-        id = vebsucc (idset1->T, id + 1);
+/* Return the number of set bits in [lo-hi], which must be < size.
+ */
+static size_t bitmap_count (const uint64_t *words, unsigned int lo,
+                            unsigned int hi)
+{
+    size_t first = lo / WORD_BITS;
+    size_t last = hi / WORD_BITS;
+    size_t count = 0;
+    size_t w;
+
+    for (w = first; w <= last; w++) {
+        unsigned int l = w == first ? lo % WORD_BITS : 0;
+        unsigned int h = w == last ? hi % WORD_BITS : WORD_BITS - 1;
+        count += __builtin_popcountll (words[w] & word_mask (l, h));
     }
-    id = vebsucc (idset2->T, 0);
-    while (id < idset2->T.M) {
-        if (vebsucc (idset1->T, id) != id)
-            return false; // id in idset2 not set in idset1
-        id = vebsucc (idset2->T, id + 1);
+    return count;
+}
+
+size_t idset_count_range (const struct idset *idset,
+                          unsigned int lo, unsigned int hi)
+{
+    size_t count = 0;
+    size_t i;
+
+    if (!idset || !valid_id (lo) || !valid_id (hi))
+        return 0;
+    normalize_range (&lo, &hi);
+    if (lo >= idset->size)
+        return 0;
+    if (hi >= idset->size)
+        hi = idset->size - 1;
+    if (idset->words)
+        return bitmap_count (idset->words, lo, hi);
+    for (i = range_search (idset, lo);
+         i < idset->nranges && idset->ranges[i].lo <= hi; i++) {
+        unsigned int l = idset->ranges[i].lo > lo ? idset->ranges[i].lo : lo;
+        unsigned int h = idset->ranges[i].hi < hi ? idset->ranges[i].hi : hi;
+        count += (size_t)h - l + 1;
+    }
+    return count;
+}
+
+bool idset_is_subset (const struct idset *idset1, const struct idset *idset2)
+{
+    unsigned int lo, hi;
+    unsigned int id = 0;
+
+    if (!idset1 || !idset2)
+        return false;
+    if (idset_count (idset1) > idset_count (idset2))
+        return false;
+    while (idset_next_run (idset1, id, &lo, &hi) == 0) {
+        if (idset_count_range (idset2, lo, hi) != (size_t)hi - lo + 1)
+            return false;
+        id = hi + 1;
     }
     return true;
 }
 
+bool idset_has_intersection (const struct idset *idset1,
+                             const struct idset *idset2)
+{
+    unsigned int lo, hi;
+    unsigned int id = 0;
+
+    if (!idset1 || !idset2)
+        return false;
+    while (idset_next_run (idset1, id, &lo, &hi) == 0) {
+        if (idset_count_range (idset2, lo, hi) > 0)
+            return true;
+        id = hi + 1;
+    }
+    return false;
+}
+
+/* Move the 'n' lowest ids of bitmap 'idset' to empty idset 'ids',
+ * which has the same size, a word at a time.
+ */
+static int bitmap_take_first_n (struct idset *ids, struct idset *idset,
+                                size_t n)
+{
+    uint64_t *words;
+    size_t w;
+
+    if (!(words = calloc (bitmap_words (idset->size), sizeof (words[0])))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    ids->words = words;
+    ids->count = n;
+    idset->count -= n;
+    for (w = 0; n > 0; w++) {
+        uint64_t word = idset->words[w];
+        size_t bits = __builtin_popcountll (word);
+
+        if (bits > n) {
+            while (n-- > 0) {
+                uint64_t low = word & -word;
+                words[w] |= low;
+                word &= ~low;
+            }
+            idset->words[w] = word;
+            break;
+        }
+        words[w] = word;
+        idset->words[w] = 0;
+        n -= bits;
+    }
+    idset_rebalance (ids);
+    idset_rebalance (idset);
+    return 0;
+}
+
+struct idset *idset_alloc_first_n (struct idset *idset, size_t n)
+{
+    struct idset *ids;
+    unsigned int lo, hi;
+    unsigned int first = 0;
+    unsigned int id = 0;
+
+    if (!idset) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (idset_count (idset) < n) {
+        errno = ENOSPC;
+        return NULL;
+    }
+    if (!(ids = idset_create (idset->size, idset->flags)))
+        return NULL;
+    if (idset->words && n > 0) {
+        if (bitmap_take_first_n (ids, idset, n) < 0)
+            goto error;
+        return ids;
+    }
+    while (n > 0 && idset_next_run (idset, id, &lo, &hi) == 0) {
+        if ((size_t)hi - lo + 1 > n)
+            hi = lo + n - 1;
+        if (idset_update (ids, lo, hi, true) < 0)
+            goto error;
+        if (id == 0)
+            first = lo;
+        n -= (size_t)hi - lo + 1;
+        id = hi + 1;
+    }
+    /* Every member of 'idset' from 'first' up to the last id taken
+     * is now in 'ids', so they can be cleared as one range.
+     */
+    if (idset_count (ids) > 0 && idset_update (idset, first, id - 1, false) < 0)
+        goto error;
+    return ids;
+error:
+    idset_destroy (ids);
+    return NULL;
+}
+
+/* Set algebra, in place on 'idset1'.
+ */
+enum {
+    OP_UNION,
+    OP_SUBTRACT,
+    OP_INTERSECT,
+};
+
+/* Combine two bitmaps a word at a time.  Union has already grown
+ * idset1 to hold every id in idset2.
+ */
+static void bitmap_merge (struct idset *idset1, const struct idset *idset2,
+                          int op)
+{
+    uint64_t *a = idset1->words;
+    const uint64_t *b = idset2->words;
+    size_t na = bitmap_words (idset1->size);
+    size_t nb = bitmap_words (idset2->size);
+    size_t n = na < nb ? na : nb;
+    size_t count = 0;
+    size_t w;
+
+    switch (op) {
+        case OP_UNION:
+            for (w = 0; w < n; w++)
+                a[w] |= b[w];
+            break;
+        case OP_SUBTRACT:
+            for (w = 0; w < n; w++)
+                a[w] &= ~b[w];
+            break;
+        case OP_INTERSECT:
+            for (w = 0; w < n; w++)
+                a[w] &= b[w];
+            for (; w < na; w++)
+                a[w] = 0;
+            break;
+    }
+    for (w = 0; w < na; w++)
+        count += __builtin_popcountll (a[w]);
+    idset1->count = count;
+    idset_rebalance (idset1);
+}
+
+/* Merge two range arrays in one pass.
+ */
+
+static int range_merge (struct idset *idset1, const struct idset *idset2,
+                        int op)
+{
+    const struct idset_range *a = idset1->ranges;
+    const struct idset_range *b = idset2->ranges;
+    size_t na = idset1->nranges;
+    size_t nb = idset2->nranges;
+    struct idset_range *r = NULL;
+    size_t n = 0;
+    size_t max = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    switch (op) {
+        case OP_UNION:
+            while (i < na || j < nb) {
+                const struct idset_range *next;
+                if (j == nb || (i < na && a[i].lo <= b[j].lo))
+                    next = &a[i++];
+                else
+                    next = &b[j++];
+                if (range_append (&r, &n, &max, next->lo, next->hi) < 0)
+                    goto error;
+            }
+            break;
+        case OP_INTERSECT:
+            while (i < na && j < nb) {
+                unsigned int lo = a[i].lo > b[j].lo ? a[i].lo : b[j].lo;
+                unsigned int hi = a[i].hi < b[j].hi ? a[i].hi : b[j].hi;
+                if (lo <= hi && range_append (&r, &n, &max, lo, hi) < 0)
+                    goto error;
+                if (a[i].hi < b[j].hi)
+                    i++;
+                else
+                    j++;
+            }
+            break;
+        case OP_SUBTRACT:
+            for (i = 0; i < na; i++) {
+                unsigned int lo = a[i].lo;
+                bool done = false;
+
+                while (j < nb && b[j].hi < lo)
+                    j++;
+                while (j < nb && b[j].lo <= a[i].hi) {
+                    if (b[j].lo > lo
+                        && range_append (&r, &n, &max, lo, b[j].lo - 1) < 0)
+                        goto error;
+                    if (b[j].hi >= a[i].hi) {
+                        done = true;
+                        break;
+                    }
+                    lo = b[j++].hi + 1;
+                }
+                if (!done && range_append (&r, &n, &max, lo, a[i].hi) < 0)
+                    goto error;
+            }
+            break;
+    }
+    free (idset1->ranges);
+    idset1->ranges = r;
+    idset1->nranges = n;
+    idset1->maxranges = max;
+    idset1->count = range_count (r, n);
+    if (prefer_bitmap (idset1->nranges, idset1->size))
+        (void)to_bitmap (idset1);
+    return 0;
+error:
+    free (r);
+    return -1;
+}
+
+int idset_union (struct idset *idset1, const struct idset *idset2)
+{
+    unsigned int lo, hi;
+    unsigned int id = 0;
+
+    if (!idset1 || !idset2) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (idset_count (idset2) == 0)
+        return 0;
+    if (idset_grow (idset1, (size_t)idset_last (idset2) + 1) < 0)
+        return -1;
+    if (!idset1->words && !idset2->words)
+        return range_merge (idset1, idset2, OP_UNION);
+    if (idset1->words && idset2->words) {
+        bitmap_merge (idset1, idset2, OP_UNION);
+        return 0;
+    }
+    while (idset_next_run (idset2, id, &lo, &hi) == 0) {
+        if (idset_update (idset1, lo, hi, true) < 0)
+            return -1;
+        id = hi + 1;
+    }
+    return 0;
+}
+
+int idset_subtract (struct idset *idset1, const struct idset *idset2)
+{
+    unsigned int lo, hi;
+    unsigned int id = 0;
+
+    if (!idset1 || !idset2) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!idset1->words && !idset2->words)
+        return range_merge (idset1, idset2, OP_SUBTRACT);
+    if (idset1->words && idset2->words) {
+        bitmap_merge (idset1, idset2, OP_SUBTRACT);
+        return 0;
+    }
+    while (idset_next_run (idset2, id, &lo, &hi) == 0 && lo < idset1->size) {
+        if (hi >= idset1->size)
+            hi = idset1->size - 1;
+        if (idset_update (idset1, lo, hi, false) < 0)
+            return -1;
+        id = hi + 1;
+    }
+    return 0;
+}
+
+int idset_intersect (struct idset *idset1, const struct idset *idset2)
+{
+    unsigned int lo, hi;
+    unsigned int id = 0;
+
+    if (!idset1 || !idset2) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!idset1->words && !idset2->words)
+        return range_merge (idset1, idset2, OP_INTERSECT);
+    if (idset1->words && idset2->words) {
+        bitmap_merge (idset1, idset2, OP_INTERSECT);
+        return 0;
+    }
+    /* Clear the gaps between runs of idset2.
+     */
+    while (id < idset1->size && idset1->count > 0) {
+        size_t end;
+        if (idset_next_run (idset2, id, &lo, &hi) < 0)
+            end = idset1->size;
+        else
+            end = lo < idset1->size ? lo : idset1->size;
+        if (end > id && idset_update (idset1, id, end - 1, false) < 0)
+            return -1;
+        if (end == idset1->size)
+            break;
+        id = hi + 1;
+    }
+    return 0;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
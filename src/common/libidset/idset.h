@@ -95,6 +95,38 @@ size_t idset_count (const struct idset *idset);
  */
 bool idset_equal (const struct idset *set1, const struct idset *set2);
 
+/* Set algebra: modify 'set1' in place to be its union with, difference
+ * from, or intersection with 'set2'.  Union fails with EINVAL if 'set1'
+ * would need to grow and it was created without IDSET_FLAG_AUTOGROW.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+int idset_union (struct idset *set1, const struct idset *set2);
+int idset_subtract (struct idset *set1, const struct idset *set2);
+int idset_intersect (struct idset *set1, const struct idset *set2);
+
+/* Return true if every id in 'set1' is also in 'set2'.
+ */
+bool idset_is_subset (const struct idset *set1, const struct idset *set2);
+
+/* Return true if 'set1' and 'set2' have at least one id in common.
+ */
+bool idset_has_intersection (const struct idset *set1,
+                             const struct idset *set2);
+
+/* Return the number of ids in the range [lo-hi] that are in idset.
+ * If idset or lo/hi are invalid, return 0.
+ */
+size_t idset_count_range (const struct idset *idset,
+                          unsigned int lo, unsigned int hi);
+
+/* Remove the 'n' lowest ids from idset and return them in a new idset,
+ * which the caller must destroy.
+ * Returns the new idset holding the removed ids on success, or NULL on
+ * failure with errno set.  If idset has fewer than 'n' ids, fail with
+ * ENOSPC.
+ */
+struct idset *idset_alloc_first_n (struct idset *idset, size_t n);
+
 #endif /* !FLUX_IDSET_H */
 
 /*
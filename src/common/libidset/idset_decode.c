@@ -79,17 +79,11 @@ struct idset *idset_decode (const char *str)
     a1 = trim_brackets (cpy);
     saveptr = NULL;
     while ((tok = strtok_r (a1, ",", &saveptr))) {
-        unsigned int hi, lo, i;
+        unsigned int hi, lo;
         if (parse_range (tok, &hi, &lo) < 0)
             goto inval;
-        /* Count backwards so that idset_set() can grow the
-         * idset to the maximum size on the first access,
-         * rather than possibly doing it multiple times.
-         */
-        for (i = hi; i >= lo && i != UINT_MAX; i--) {
-            if (idset_set (idset, i) < 0)
-                goto error;
-        }
+        if (idset_range_set (idset, lo, hi) < 0)
+            goto error;
         a1 = NULL;
     }
     free (cpy);
@@ -25,7 +25,8 @@
 /* Format a string like printf, then append it to *s.
  * The allocated size of '*s' is '*sz'.
  * The current string length of '*s' is '*len'.
- * Grow *s by IDSET_ENCODE_CHUNK to allow new string to be appended.
+ * Grow *s, starting with IDSET_ENCODE_CHUNK and doubling, to allow new
+ * string to be appended.
  * Returns 0 on success, -1 on failure with errno = ENOMEM.
  */
 static int __attribute__ ((format (printf, 4, 5)))
@@ -44,16 +45,14 @@ catprintf (char **s, size_t *sz, size_t *len, const char *fmt, ...)
     nlen = strlen (ns);
 
     while (*len + nlen + 1 > *sz) {
-        size_t nsz = *sz + IDSET_ENCODE_CHUNK;
+        size_t nsz = *sz ? *sz * 2 : IDSET_ENCODE_CHUNK;
         char *p;
         if (!(p = realloc (*s, nsz)))
             goto error;
-        if (*s == NULL)
-            *p = '\0';
         *s = p;
         *sz = nsz;
     }
-    strcat (*s, ns);
+    memcpy (*s + *len, ns, nlen + 1);
     *len += nlen;
     free (ns);
     return 0;
@@ -64,13 +63,13 @@ error:
 }
 
 static int catrange (char **s, size_t *sz, size_t *len,
-                     unsigned int lo, unsigned int hi, const char *sep)
+                     const char *sep, unsigned int lo, unsigned int hi)
 {
     int rc;
     if (lo == hi)
-        rc = catprintf (s, sz, len, "%u%s", lo, sep);
+        rc = catprintf (s, sz, len, "%s%u", sep, lo);
     else
-        rc = catprintf (s, sz, len, "%u-%u%s", lo, hi, sep);
+        rc = catprintf (s, sz, len, "%s%u-%u", sep, lo, hi);
     return rc;
 }
 
@@ -80,35 +79,17 @@ static int catrange (char **s, size_t *sz, size_t *len,
 static int encode_ranged (const struct idset *idset,
                           char **s, size_t *sz, size_t *len)
 {
-    int count = 0;
-    unsigned int id;
-    unsigned int lo = 0;
-    unsigned int hi = 0;
-    bool first = true;
+    unsigned int lo, hi;
+    unsigned int id = 0;
+    const char *sep = "";
 
-    lo = hi = id = vebsucc (idset->T, 0);
-    while (id < idset->T.M) {
-        unsigned int next = vebsucc (idset->T, id + 1);;
-        bool last = (next == idset->T.M);
-
-        if (first)                  // first iteration
-            first = false;
-        else if (id == hi + 1)      // id is in range
-            hi++;
-        else {                      // id is NOT in range
-            if (catrange (s, sz, len, lo, hi, ",") < 0)
-                return -1;
-            lo = hi = id;
-        }
-        if (last) {                 // last iteration
-            if (catrange (s, sz, len, lo, hi, last ? "" : ",") < 0)
-                return -1;
-        }
-        if (count < INT_MAX)
-            count++;
-        id = next;
+    while (idset_next_run (idset, id, &lo, &hi) == 0) {
+        if (catrange (s, sz, len, sep, lo, hi) < 0)
+            return -1;
+        sep = ",";
+        id = hi + 1;
     }
-    return count;
+    return idset->count < INT_MAX ? idset->count : INT_MAX;
 }
 
 /* Return value: count of id's in set, or -1 on failure.
@@ -117,20 +98,19 @@ static int encode_ranged (const struct idset *idset,
 static int encode_simple (const struct idset *idset,
                           char **s, size_t *sz, size_t *len)
 {
-    int count = 0;
-    unsigned int id;
+    unsigned int lo, hi, i;
+    unsigned int id = 0;
+    const char *sep = "";
 
-    id = vebsucc (idset->T, 0);
-    while (id != idset->T.M) {
-        int next = vebsucc (idset->T, id + 1);
-        char *sep = next == idset->T.M ? "" : ",";
-        if (catprintf (s, sz, len, "%d%s", id, sep) < 0)
-            return -1;
-        if (count < INT_MAX)
-            count++;
-        id = next;
+    while (idset_next_run (idset, id, &lo, &hi) == 0) {
+        for (i = lo; i <= hi; i++) {
+            if (catprintf (s, sz, len, "%s%u", sep, i) < 0)
+                return -1;
+            sep = ",";
+        }
+        id = hi + 1;
     }
-    return count;
+    return idset->count < INT_MAX ? idset->count : INT_MAX;
 }
 
 char *idset_encode (const struct idset *idset, int flags)
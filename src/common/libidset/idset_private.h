@@ -8,18 +8,36 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
-/* Implemented as a Van Emde Boas tree using code.google.com/p/libveb.
- * T.D is data; T.M is size
- * All ops are O(log m), for key bitsize m: 2^m == T.M.
+/* An idset is stored in one of two ways, chosen by density:
+ *
+ * - as a sorted array of disjoint, non-adjacent ranges [lo-hi], so that
+ *   large contiguous sets like 0-65535 take constant space, or
+ * - as a plain bitmap of 'size' bits, used once the range array would
+ *   take more memory than the bitmap, i.e. for fragmented sets.
+ *
+ * An idset starts out as ranges and switches to a bitmap when it becomes
+ * fragmented.  Operations that must visit the whole bitmap anyway (copy,
+ * growth, clearing the last id) switch it back if ranges are now smaller.
  */
 
-#include "src/common/libutil/veb.h"
+#include <stdint.h>
 #include "idset.h"
 
+struct idset_range {
+    unsigned int lo;
+    unsigned int hi;
+};
+
 struct idset {
     size_t count;
-    Veb T;
+    size_t size;                // ids must be < size unless AUTOGROW
     int flags;
+
+    struct idset_range *ranges; // range array, if words == NULL
+    size_t nranges;
+    size_t maxranges;
+
+    uint64_t *words;            // bitmap of size bits, or NULL
 };
 
 #define IDSET_ENCODE_CHUNK 1024
@@ -27,6 +45,12 @@ struct idset {
 
 int validate_idset_flags (int flags, int allowed);
 
+/* Find the first run of consecutive ids in idset at or after 'start'.
+ * Return 0 and set [lo-hi] on success, or -1 if there are none.
+ */
+int idset_next_run (const struct idset *idset, unsigned int start,
+                    unsigned int *lo, unsigned int *hi);
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -495,7 +495,7 @@ void test_autogrow (void)
     idset = idset_create (1, 0);
     ok (idset != NULL,
         "idset_create size=1 flags=0 works");
-    ok (idset->T.M == 1,
+    ok (idset->size == 1,
         "idset internal size is 1");
     ok (idset_set (idset, 0) == 0,
         "idset_set 0 works");
@@ -507,13 +507,13 @@ void test_autogrow (void)
     idset = idset_create (1, IDSET_FLAG_AUTOGROW);
     ok (idset != NULL,
         "idset_create size=1 flags=AUTOGROW works");
-    ok (idset->T.M == 1,
+    ok (idset->size == 1,
         "idset internal size is 1");
     ok (idset_set (idset, 0) == 0,
         "idset_set 0 works");
     ok (idset_set (idset, 2) == 0,
         "idset_set 2 works");
-    ok (idset->T.M > 1,
+    ok (idset->size > 1,
         "idset internal size grew");
     ok (   idset_test (idset, 0)
         && !idset_test (idset, 1)
@@ -535,6 +535,312 @@ void issue_1974(void)
     idset_destroy (idset);
 }
 
+/* Check 'idset' against a reference array of 'n' flags, using every
+ * access method.
+ */
+static bool check_members (struct idset *idset, const bool *ref, int n)
+{
+    unsigned int id;
+    size_t count = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (idset_test (idset, i) != ref[i])
+            return false;
+        if (ref[i])
+            count++;
+    }
+    if (idset_count (idset) != count)
+        return false;
+    i = 0;
+    id = idset_first (idset);
+    while (id != IDSET_INVALID_ID) {
+        while (i < n && !ref[i])
+            i++;
+        if (i == n || id != i)
+            return false;
+        i++;
+        id = idset_next (idset, id);
+    }
+    while (i < n && !ref[i])
+        i++;
+    return i == n;
+}
+
+void test_representation (void)
+{
+    struct idset *idset;
+    struct idset *cpy;
+    bool ref[4096] = { false };
+    char *s;
+    int i;
+
+    if (!(idset = idset_create (4096, 0)))
+        BAIL_OUT ("idset_create failed");
+    ok (idset_range_set (idset, 0, 4095) == 0
+        && idset_count (idset) == 4096
+        && idset->words == NULL && idset->nranges == 1,
+        "contiguous set is stored as one range");
+    ok (idset_clear (idset, 100) == 0
+        && idset->words == NULL && idset->nranges == 2,
+        "clearing one id splits the range");
+    ok (idset_range_clear (idset, 0, 4095) == 0 && idset_count (idset) == 0
+        && idset->nranges == 0,
+        "idset_range_clear removes all ranges");
+
+    for (i = 0; i < 4096; i += 2) {
+        if (idset_set (idset, i) < 0)
+            BAIL_OUT ("idset_set failed");
+        ref[i] = true;
+    }
+    ok (idset->words != NULL && check_members (idset, ref, 4096),
+        "fragmented set switched to a bitmap");
+    ok (idset_range_set (idset, 1000, 1999) == 0
+        && idset_test (idset, 1001) && idset_count (idset) == 2548,
+        "idset_range_set works on bitmap");
+    for (i = 1000; i < 2000; i++)
+        ref[i] = true;
+    ok (check_members (idset, ref, 4096),
+        "bitmap contains expected ids");
+
+    ok ((cpy = idset_copy (idset)) != NULL && cpy->words != NULL
+        && idset_equal (idset, cpy),
+        "idset_copy of bitmap works");
+    ok (idset_range_clear (cpy, 0, 999) == 0
+        && idset_range_clear (cpy, 2000, 4095) == 0
+        && idset_count (cpy) == 1000,
+        "cleared all but one run on copy");
+    idset_destroy (cpy);
+    ok ((cpy = idset_copy (idset)) != NULL
+        && idset_range_clear (cpy, 0, 999) == 0
+        && idset_range_clear (cpy, 2000, 4095) == 0,
+        "made another copy with one run");
+    idset_destroy (idset);
+    ok ((idset = idset_copy (cpy)) != NULL && idset->words == NULL
+        && idset->nranges == 1,
+        "copy of bitmap with one run is stored as a range");
+    ok (idset_equal (idset, cpy) && idset_equal (cpy, idset),
+        "idset_equal works on range and bitmap representations");
+    ok (idset_clear (cpy, 1500) == 0 && !idset_equal (idset, cpy),
+        "idset_equal detects difference between representations");
+    ok (idset_range_clear (cpy, 0, 4095) == 0 && cpy->words == NULL,
+        "bitmap switched back to ranges when emptied");
+    idset_destroy (cpy);
+    idset_destroy (idset);
+
+    ok ((idset = idset_decode ("0-4000000000")) != NULL
+        && idset_count (idset) == 4000000001
+        && idset_last (idset) == 4000000000,
+        "idset_decode of huge range works");
+    ok ((s = idset_encode (idset, IDSET_FLAG_RANGE)) != NULL
+        && !strcmp (s, "0-4000000000"),
+        "idset_encode of huge range works");
+    free (s);
+    ok (idset_clear (idset, 2000000000) == 0
+        && idset_next (idset, 1999999999) == 2000000001,
+        "idset_next skips cleared id in huge range");
+    idset_destroy (idset);
+}
+
+/* Apply op to random sets in both representations and compare with
+ * the result computed from reference arrays.
+ */
+void test_algebra (void)
+{
+    const char *names[] = { "union", "subtract", "intersect" };
+    int (*ops[])(struct idset *, const struct idset *) = {
+        idset_union, idset_subtract, idset_intersect,
+    };
+    int density[] = { 2, 50, 1000 }; // average run length
+    bool ok_op[3] = { true, true, true };
+    int n = 3000;
+    bool a[3000], b[3000], r[3000];
+    int op, da, db, trial, i;
+
+    srand (42);
+    for (op = 0; op < 3; op++) {
+        for (trial = 0; trial < 9 * 4; trial++) {
+            struct idset *s1, *s2;
+            bool on;
+
+            da = density[trial % 3];
+            db = density[(trial / 3) % 3];
+            if (!(s1 = idset_create (0, IDSET_FLAG_AUTOGROW))
+                || !(s2 = idset_create (0, IDSET_FLAG_AUTOGROW)))
+                BAIL_OUT ("idset_create failed");
+            for (on = false, i = 0; i < n; i++) {
+                if (rand () % da == 0)
+                    on = !on;
+                if ((a[i] = on) && idset_set (s1, i) < 0)
+                    BAIL_OUT ("idset_set failed");
+            }
+            for (on = false, i = trial % 500; i < n; i++) {
+                if (rand () % db == 0)
+                    on = !on;
+                if ((b[i] = on) && idset_set (s2, i) < 0)
+                    BAIL_OUT ("idset_set failed");
+            }
+            for (i = 0; i < trial % 500; i++)
+                b[i] = false;
+            for (i = 0; i < n; i++) {
+                r[i] = op == 0 ? a[i] || b[i]
+                     : op == 1 ? a[i] && !b[i]
+                     : a[i] && b[i];
+            }
+            if (ops[op] (s1, s2) < 0 || !check_members (s1, r, n)
+                || !check_members (s2, b, n))
+                ok_op[op] = false;
+            idset_destroy (s1);
+            idset_destroy (s2);
+        }
+        ok (ok_op[op],
+            "idset_%s works on sets of varying density", names[op]);
+    }
+}
+
+void test_algebra_edge (void)
+{
+    struct idset *a;
+    struct idset *b;
+
+    if (!(a = idset_decode ("0-9")) || !(b = idset_decode ("100-199")))
+        BAIL_OUT ("idset_decode failed");
+    ok (idset_intersect (a, b) == 0 && idset_count (a) == 0,
+        "idset_intersect of disjoint sets is empty");
+    ok (idset_union (a, b) == 0 && idset_equal (a, b),
+        "idset_union with empty set works");
+    ok (idset_subtract (a, a) == 0 && idset_count (a) == 0,
+        "idset_subtract of set from itself is empty");
+    idset_destroy (a);
+
+    if (!(a = idset_create (16, 0)))
+        BAIL_OUT ("idset_create failed");
+    errno = 0;
+    ok (idset_union (a, b) < 0 && errno == EINVAL,
+        "idset_union fails with EINVAL if set cannot grow");
+    ok (idset_subtract (a, b) == 0 && idset_intersect (a, b) == 0,
+        "idset_subtract/intersect with ids beyond size work");
+    errno = 0;
+    ok (idset_union (NULL, b) < 0 && errno == EINVAL,
+        "idset_union set1=NULL fails with EINVAL");
+    errno = 0;
+    ok (idset_subtract (a, NULL) < 0 && errno == EINVAL,
+        "idset_subtract set2=NULL fails with EINVAL");
+    errno = 0;
+    ok (idset_intersect (NULL, NULL) < 0 && errno == EINVAL,
+        "idset_intersect set1=NULL set2=NULL fails with EINVAL");
+    idset_destroy (a);
+    idset_destroy (b);
+}
+
+void test_count_range (void)
+{
+    struct idset *idset;
+    unsigned int i;
+
+    if (!(idset = idset_decode ("1-3,10-19,100-199")))
+        BAIL_OUT ("idset_decode failed");
+    ok (idset_count_range (idset, 0, 1000) == 113,
+        "idset_count_range 0-1000 counts all ids");
+    ok (idset_count_range (idset, 2, 150) == 2 + 10 + 51,
+        "idset_count_range 2-150 counts partial ranges");
+    ok (idset_count_range (idset, 150, 2) == 63,
+        "idset_count_range hi < lo is normalized");
+    ok (idset_count_range (idset, 4, 9) == 0,
+        "idset_count_range of gap is 0");
+    ok (idset_count_range (idset, 5000, 6000) == 0,
+        "idset_count_range beyond size is 0");
+    ok (idset_count_range (NULL, 0, 1) == 0
+        && idset_count_range (idset, 0, UINT_MAX) == 0,
+        "idset_count_range with invalid args returns 0");
+    idset_destroy (idset);
+
+    if (!(idset = idset_create (1000, 0)))
+        BAIL_OUT ("idset_create failed");
+    for (i = 0; i < 1000; i += 3)
+        idset_set (idset, i);
+    ok (idset->words != NULL
+        && idset_count_range (idset, 0, 999) == 334
+        && idset_count_range (idset, 1, 63) == 21
+        && idset_count_range (idset, 63, 129) == 23,
+        "idset_count_range works on bitmap");
+    idset_destroy (idset);
+}
+
+void test_subset (void)
+{
+    struct idset *a;
+    struct idset *b;
+    struct idset *c;
+
+    if (!(a = idset_decode ("2-5,9"))
+        || !(b = idset_decode ("0-10"))
+        || !(c = idset_decode ("6-8,11")))
+        BAIL_OUT ("idset_decode failed");
+    ok (idset_is_subset (a, b) && !idset_is_subset (b, a),
+        "idset_is_subset works");
+    ok (idset_is_subset (a, a),
+        "set is a subset of itself");
+    ok (!idset_has_intersection (a, c) && !idset_has_intersection (c, a),
+        "idset_has_intersection of disjoint sets is false");
+    ok (idset_has_intersection (b, c) && idset_has_intersection (c, b),
+        "idset_has_intersection of overlapping sets is true");
+    ok (!idset_is_subset (NULL, a) && !idset_has_intersection (a, NULL),
+        "idset_is_subset and idset_has_intersection fail on NULL args");
+    idset_destroy (a);
+    idset_destroy (b);
+    idset_destroy (c);
+}
+
+void test_alloc_first_n (void)
+{
+    struct idset *idset;
+    struct idset *ids;
+    char *s = NULL;
+    unsigned int i;
+
+    if (!(idset = idset_decode ("0-3,8-11,20")))
+        BAIL_OUT ("idset_decode failed");
+    ok ((ids = idset_alloc_first_n (idset, 6)) != NULL
+        && (s = idset_encode (ids, IDSET_FLAG_RANGE)) != NULL
+        && !strcmp (s, "0-3,8-9"),
+        "idset_alloc_first_n 6 returned 0-3,8-9");
+    free (s);
+    s = NULL;
+    ok ((s = idset_encode (idset, IDSET_FLAG_RANGE)) != NULL
+        && !strcmp (s, "10-11,20"),
+        "ids were removed from idset");
+    free (s);
+    idset_destroy (ids);
+    ok ((ids = idset_alloc_first_n (idset, 0)) != NULL
+        && idset_count (ids) == 0 && idset_count (idset) == 3,
+        "idset_alloc_first_n 0 returns empty set");
+    idset_destroy (ids);
+    errno = 0;
+    ok (idset_alloc_first_n (idset, 4) == NULL && errno == ENOSPC
+        && idset_count (idset) == 3,
+        "idset_alloc_first_n 4 fails with ENOSPC and idset is unchanged");
+    ok ((ids = idset_alloc_first_n (idset, 3)) != NULL
+        && idset_count (ids) == 3 && idset_count (idset) == 0,
+        "idset_alloc_first_n all ids works");
+    idset_destroy (ids);
+    errno = 0;
+    ok (idset_alloc_first_n (NULL, 1) == NULL && errno == EINVAL,
+        "idset_alloc_first_n idset=NULL fails with EINVAL");
+    idset_destroy (idset);
+
+    if (!(idset = idset_create (4096, 0)))
+        BAIL_OUT ("idset_create failed");
+    for (i = 0; i < 4096; i += 2)
+        idset_set (idset, i);
+    ok ((ids = idset_alloc_first_n (idset, 1000)) != NULL
+        && idset_count (ids) == 1000 && idset_last (ids) == 1998
+        && idset_first (idset) == 2000 && idset_count (idset) == 1048,
+        "idset_alloc_first_n works on bitmap");
+    idset_destroy (ids);
+    idset_destroy (idset);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -552,6 +858,12 @@ int main (int argc, char *argv[])
     test_copy ();
     test_autogrow ();
     issue_1974 ();
+    test_representation ();
+    test_algebra ();
+    test_algebra_edge ();
+    test_count_range ();
+    test_subset ();
+    test_alloc_first_n ();
 
     done_testing ();
 }
@@ -0,0 +1,270 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* idset_bench - compare bulk idset operations with per-id loops
+ *
+ * Usage: idset_bench [-n COUNT] [-s SIZE,SIZE,...]
+ *
+ * For each idset size and each fill pattern (contiguous, every other id,
+ * random), time COUNT repetitions of each operation, both with the bulk
+ * call and with the equivalent idset_first()/idset_next() loop, reporting
+ * the mean time per repetition in microseconds.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "src/common/libidset/idset.h"
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+
+enum {
+    FILL_CONTIGUOUS,
+    FILL_STRIDE,
+    FILL_RANDOM,
+};
+
+static const char *fill_names[] = { "contig", "stride", "random" };
+
+static struct idset *create_filled (size_t size, int fill, unsigned int seed)
+{
+    struct idset *idset;
+    unsigned int i;
+
+    if (!(idset = idset_create (size, 0)))
+        log_err_exit ("idset_create");
+    srand (seed);
+    for (i = 0; i < size; i++) {
+        if ((fill == FILL_CONTIGUOUS && i < size / 2)
+            || (fill == FILL_STRIDE && i % 2 == 0)
+            || (fill == FILL_RANDOM && rand () % 2 == 0)) {
+            if (idset_set (idset, i) < 0)
+                log_err_exit ("idset_set");
+        }
+    }
+    return idset;
+}
+
+static struct idset *copy (const struct idset *idset)
+{
+    struct idset *cpy;
+    if (!(cpy = idset_copy (idset)))
+        log_err_exit ("idset_copy");
+    return cpy;
+}
+
+/* Operations.  Each modifies 'a' (a fresh copy) using 'b'.
+ */
+
+static void union_loop (struct idset *a, struct idset *b)
+{
+    unsigned int i = idset_first (b);
+    while (i != IDSET_INVALID_ID) {
+        if (idset_set (a, i) < 0)
+            log_err_exit ("idset_set");
+        i = idset_next (b, i);
+    }
+}
+
+static void union_bulk (struct idset *a, struct idset *b)
+{
+    if (idset_union (a, b) < 0)
+        log_err_exit ("idset_union");
+}
+
+static void subtract_loop (struct idset *a, struct idset *b)
+{
+    unsigned int i = idset_first (b);
+    while (i != IDSET_INVALID_ID) {
+        if (idset_clear (a, i) < 0)
+            log_err_exit ("idset_clear");
+        i = idset_next (b, i);
+    }
+}
+
+static void subtract_bulk (struct idset *a, struct idset *b)
+{
+    if (idset_subtract (a, b) < 0)
+        log_err_exit ("idset_subtract");
+}
+
+static void intersect_loop (struct idset *a, struct idset *b)
+{
+    unsigned int i = idset_first (a);
+    while (i != IDSET_INVALID_ID) {
+        if (!idset_test (b, i) && idset_clear (a, i) < 0)
+            log_err_exit ("idset_clear");
+        i = idset_next (a, i);
+    }
+}
+
+static void intersect_bulk (struct idset *a, struct idset *b)
+{
+    if (idset_intersect (a, b) < 0)
+        log_err_exit ("idset_intersect");
+}
+
+static void alloc_loop (struct idset *a, struct idset *b)
+{
+    size_t n = idset_count (a) / 2;
+    struct idset *ids;
+    unsigned int i;
+
+    if (!(ids = idset_create (0, IDSET_FLAG_AUTOGROW)))
+        log_err_exit ("idset_create");
+    i = idset_first (a);
+    while (n--) {
+        idset_set (ids, i);
+        idset_clear (a, i);
+        i = idset_next (a, i);
+    }
+    idset_destroy (ids);
+}
+
+static void alloc_bulk (struct idset *a, struct idset *b)
+{
+    struct idset *ids;
+
+    if (!(ids = idset_alloc_first_n (a, idset_count (a) / 2)))
+        log_err_exit ("idset_alloc_first_n");
+    idset_destroy (ids);
+}
+
+static void count_loop (struct idset *a, struct idset *b)
+{
+    unsigned int hi = idset_last (a);
+    unsigned int i = idset_first (a);
+    size_t count = 0;
+
+    while (i != IDSET_INVALID_ID && i <= hi / 2) {
+        count++;
+        i = idset_next (a, i);
+    }
+    if (count > idset_count (a))
+        log_msg_exit ("bad count");
+}
+
+static void count_bulk (struct idset *a, struct idset *b)
+{
+    if (idset_count_range (a, 0, idset_last (a) / 2) > idset_count (a))
+        log_msg_exit ("bad count");
+}
+
+struct op {
+    const char *name;
+    void (*loop)(struct idset *a, struct idset *b);
+    void (*bulk)(struct idset *a, struct idset *b);
+};
+
+static struct op ops[] = {
+    { "union",      union_loop,     union_bulk },
+    { "subtract",   subtract_loop,  subtract_bulk },
+    { "intersect",  intersect_loop, intersect_bulk },
+    { "alloc_n",    alloc_loop,     alloc_bulk },
+    { "count_rng",  count_loop,     count_bulk },
+    { NULL, NULL, NULL },
+};
+
+/* Return mean microseconds per call of fn on a fresh copy of 'a'.
+ * Only the operation is timed, not the copy.
+ */
+static double time_op (void (*fn)(struct idset *, struct idset *),
+                       struct idset *a, struct idset *b, int count)
+{
+    struct timespec t0;
+    double total = 0.;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        struct idset *cpy = copy (a);
+        monotime (&t0);
+        fn (cpy, b);
+        total += monotime_since (t0);
+        idset_destroy (cpy);
+    }
+    return total * 1000. / count;
+}
+
+static void usage (void)
+{
+    fprintf (stderr, "Usage: idset_bench [-n COUNT] [-s SIZE,...]\n");
+    exit (1);
+}
+
+int main (int argc, char *argv[])
+{
+    char default_sizes[] = "1024,65536,1048576";
+    char *sizes = default_sizes;
+    char *size, *saveptr = NULL;
+    int count = 10;
+    int ch;
+
+    log_init ("idset_bench");
+
+    while ((ch = getopt (argc, argv, "n:s:h")) != -1) {
+        switch (ch) {
+            case 'n':
+                if ((count = strtol (optarg, NULL, 10)) <= 0)
+                    usage ();
+                break;
+            case 's':
+                sizes = optarg;
+                break;
+            default:
+                usage ();
+        }
+    }
+    if (optind < argc)
+        usage ();
+
+    printf ("%8s %7s %10s %12s %12s %8s\n",
+            "SIZE", "FILL", "OP", "LOOP(us)", "BULK(us)", "SPEEDUP");
+    for (size = strtok_r (sizes, ",", &saveptr); size != NULL;
+         size = strtok_r (NULL, ",", &saveptr)) {
+        size_t n = strtoul (size, NULL, 10);
+        int fill, o;
+
+        if (n == 0)
+            usage ();
+        for (fill = FILL_CONTIGUOUS; fill <= FILL_RANDOM; fill++) {
+            struct idset *a = create_filled (n, fill, 1);
+            struct idset *b = create_filled (n, fill, 2);
+
+            /* Offset 'b' so that contiguous sets overlap by half.
+             */
+            if (fill == FILL_CONTIGUOUS) {
+                idset_range_clear (b, 0, n / 4);
+                idset_range_set (b, n / 4, n * 3 / 4 - 1);
+            }
+            for (o = 0; ops[o].name != NULL; o++) {
+                double loop = time_op (ops[o].loop, a, b, count);
+                double bulk = time_op (ops[o].bulk, a, b, count);
+
+                printf ("%8zu %7s %10s %12.2f %12.2f %7.1fx\n",
+                        n, fill_names[fill], ops[o].name, loop, bulk,
+                        bulk > 0. ? loop / bulk : 0.);
+            }
+            idset_destroy (a);
+            idset_destroy (b);
+        }
+    }
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -117,7 +117,9 @@ static int payload_decode (const void *src, int srclen,
     size_t dstlen = BASE64_DECODE_SIZE (srclen);
     void *dst;
 
-    if (!(dst = calloc (1, dstlen)))
+    /* Allocate an extra byte, so the payload is always \0 terminated.
+     */
+    if (!(dst = calloc (1, dstlen + 1)))
         return -1;
     if (sodium_base642bin ((unsigned char *)dst, dstlen, src, srclen,
                            NULL, &dstlen, NULL,
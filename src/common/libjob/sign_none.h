@@ -21,6 +21,10 @@
 char *sign_none_wrap (const void *payload, int payloadsz,
                       uint32_t userid);
 
+/* Decode 'input', returning its payload, which must be freed, and the
+ * signing userid.  The payload is followed by a \0 byte that is not
+ * counted in 'payloadsz'.
+ */
 int sign_none_unwrap (const char *input,
                       void **payload, int *payloadsz,
                       uint32_t *userid);
@@ -92,6 +92,8 @@ void decode_good (void)
     ok (rc == 0 && userid == 1000
         && payloadsz == 4 && memcmp (payload, "foo", 4) == 0,
         "dummy encode 1 decodes as expected");
+    ok (((char *)payload)[payloadsz] == '\0',
+        "decoded payload is followed by \\0");
 
     userid = 0;
     payload = NULL;
@@ -17,6 +17,7 @@
 #include <flux/core.h>
 
 #include "kvs_util_private.h"
+#include "kvs_cache_private.h"
 
 flux_future_t *flux_kvs_namespace_create (flux_t *h, const char *ns,
                                           uint32_t owner, int flags)
@@ -86,6 +87,7 @@ int flux_kvs_wait_version (flux_t *h, const char *ns, int version)
      */
     if (flux_future_get (f, NULL) < 0)
         goto done;
+    kvs_cache_wait_version (h, ns, version);
     ret = 0;
 done:
     flux_future_destroy (f);
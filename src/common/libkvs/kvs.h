@@ -19,6 +19,7 @@
 #include "kvs_txn.h"
 #include "kvs_commit.h"
 #include "kvs_copy.h"
+#include "kvs_cache.h"
 
 #ifdef __cplusplus
 extern "C" {
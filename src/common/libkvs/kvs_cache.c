@@ -0,0 +1,433 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* kvs_cache.c - client-side cache of kvs.lookup results
+ *
+ * Results are keyed by (flags, namespace or fixed root, key).  Each
+ * result at the current root of a namespace remembers the sequence
+ * number of the root it was looked up at.  A kvs.setroot event for
+ * the next sequence number carries the result forward unless the
+ * event lists a conflicting key, otherwise the result is dropped.
+ * Results looked up at older roots than the last event seen are
+ * never inserted.
+ *
+ * Events are only seen as the handle's reactor dispatches them to
+ * the message handlers below.  The cache never calls flux_recv() itself,
+ * since that would take events away from other consumers on the handle.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "kvs_cache.h"
+#include "kvs_cache_private.h"
+#include "kvs_util_private.h"
+
+struct cache_ns {
+    char *name;
+    int seq;                    /* last setroot seq seen, -1 if none */
+    int min_seq;                /* results bypassed until seq >= min_seq */
+};
+
+struct cache_entry {
+    char *hkey;
+    struct cache_ns *ns;        /* NULL if looked up at a fixed root */
+    char *path;                 /* normalized key */
+    int rootseq;
+    json_t *treeobj;
+    void *handle;               /* position in kvs_cache->lru */
+};
+
+struct kvs_cache {
+    flux_t *h;
+    int max_entries;
+    int flags;
+    zhashx_t *entries;          /* hkey => struct cache_entry */
+    zlistx_t *lru;              /* entries, least recently used first */
+    zhashx_t *namespaces;       /* name => struct cache_ns */
+    flux_msg_handler_t **handlers;
+    int hits;
+    int misses;
+};
+
+static const char *auxkey = "flux::kvs_cache";
+
+static void cache_entry_destroy (void **item)
+{
+    if (item) {
+        struct cache_entry *e = *item;
+        if (e) {
+            free (e->hkey);
+            free (e->path);
+            json_decref (e->treeobj);
+            free (e);
+        }
+        *item = NULL;
+    }
+}
+
+static void cache_ns_destroy (void **item)
+{
+    if (item) {
+        struct cache_ns *ns = *item;
+        if (ns) {
+            free (ns->name);
+            free (ns);
+        }
+        *item = NULL;
+    }
+}
+
+static void cache_entry_remove (struct kvs_cache *cache,
+                                struct cache_entry *e)
+{
+    zlistx_delete (cache->lru, e->handle);
+    zhashx_delete (cache->entries, e->hkey);
+}
+
+static void cache_purge (struct kvs_cache *cache)
+{
+    zlistx_purge (cache->lru);
+    zhashx_purge (cache->entries);
+}
+
+static void cache_setroot (struct kvs_cache *cache, const flux_msg_t *msg)
+{
+    const char *name;
+    int rootseq;
+    json_t *keys = NULL;
+    json_t *link_keys = NULL;
+    struct cache_ns *ns;
+    struct cache_entry *e;
+
+    if (flux_event_unpack (msg, NULL, "{s:s s:i s?o s?o}",
+                           "namespace", &name,
+                           "rootseq", &rootseq,
+                           "keys", &keys,
+                           "link-keys", &link_keys) < 0)
+        return;
+    if (!(ns = zhashx_lookup (cache->namespaces, name))
+        || rootseq <= ns->seq)
+        return;
+    ns->seq = rootseq;
+    e = zlistx_first (cache->lru);
+    while (e) {
+        struct cache_entry *next = zlistx_next (cache->lru);
+        if (e->ns == ns && e->rootseq < rootseq) {
+            if (e->rootseq == rootseq - 1
+                && keys && link_keys
+                && !kvs_util_keys_conflict (e->path, keys)
+                && !kvs_util_keys_conflict (e->path, link_keys))
+                e->rootseq = rootseq;
+            else
+                cache_entry_remove (cache, e);
+        }
+        e = next;
+    }
+}
+
+static void cache_namespace_removed (struct kvs_cache *cache,
+                                     const flux_msg_t *msg)
+{
+    const char *name;
+    struct cache_ns *ns;
+    struct cache_entry *e;
+
+    if (flux_event_unpack (msg, NULL, "{s:s}", "namespace", &name) < 0
+        || !(ns = zhashx_lookup (cache->namespaces, name)))
+        return;
+    e = zlistx_first (cache->lru);
+    while (e) {
+        struct cache_entry *next = zlistx_next (cache->lru);
+        if (e->ns == ns)
+            cache_entry_remove (cache, e);
+        e = next;
+    }
+    /* stay subscribed, the namespace may be created again */
+    ns->seq = -1;
+    ns->min_seq = 0;
+}
+
+static void setroot_cb (flux_t *h, flux_msg_handler_t *mh,
+                        const flux_msg_t *msg, void *arg)
+{
+    cache_setroot (arg, msg);
+}
+
+static void namespace_removed_cb (flux_t *h, flux_msg_handler_t *mh,
+                                  const flux_msg_t *msg, void *arg)
+{
+    cache_namespace_removed (arg, msg);
+}
+
+static const struct flux_msg_handler_spec htab[] = {
+    { FLUX_MSGTYPE_EVENT, "kvs.setroot-*", setroot_cb, 0 },
+    { FLUX_MSGTYPE_EVENT, "kvs.namespace-removed-*",
+                          namespace_removed_cb, 0 },
+    FLUX_MSGHANDLER_TABLE_END,
+};
+
+static void kvs_cache_destroy (struct kvs_cache *cache)
+{
+    if (cache) {
+        int saved_errno = errno;
+        flux_msg_handler_delvec (cache->handlers);
+        zlistx_destroy (&cache->lru);
+        zhashx_destroy (&cache->entries);
+        zhashx_destroy (&cache->namespaces);
+        free (cache);
+        errno = saved_errno;
+    }
+}
+
+static struct kvs_cache *kvs_cache_create (flux_t *h)
+{
+    struct kvs_cache *cache;
+
+    if (!(cache = calloc (1, sizeof (*cache))))
+        return NULL;
+    cache->h = h;
+    if (!(cache->entries = zhashx_new ())
+        || !(cache->lru = zlistx_new ())
+        || !(cache->namespaces = zhashx_new ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    /* entries own their hash key */
+    zhashx_set_key_duplicator (cache->entries, NULL);
+    zhashx_set_key_destructor (cache->entries, NULL);
+    zhashx_set_destructor (cache->entries, cache_entry_destroy);
+    zhashx_set_destructor (cache->namespaces, cache_ns_destroy);
+    if (flux_msg_handler_addvec (h, htab, cache, &cache->handlers) < 0)
+        goto error;
+    return cache;
+error:
+    kvs_cache_destroy (cache);
+    return NULL;
+}
+
+/* Look up namespace 'name', subscribing to its events on first use.
+ */
+static struct cache_ns *cache_ns_get (struct kvs_cache *cache,
+                                      const char *name)
+{
+    struct cache_ns *ns;
+    char *topic = NULL;
+
+    if ((ns = zhashx_lookup (cache->namespaces, name)))
+        return ns;
+    if (!(ns = calloc (1, sizeof (*ns))))
+        return NULL;
+    ns->seq = -1;
+    if (!(ns->name = strdup (name))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (asprintf (&topic, "kvs.setroot-%s", name) < 0) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (flux_event_subscribe (cache->h, topic) < 0)
+        goto error;
+    free (topic);
+    if (asprintf (&topic, "kvs.namespace-removed-%s", name) < 0) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (flux_event_subscribe (cache->h, topic) < 0)
+        goto error;
+    free (topic);
+    (void)zhashx_insert (cache->namespaces, name, ns);
+    return ns;
+error:
+    free (topic);
+    cache_ns_destroy ((void **)&ns);
+    return NULL;
+}
+
+static char *cache_hkey (const char *ns, const char *atref, int flags,
+                         const char *key)
+{
+    char *hkey;
+
+    if (asprintf (&hkey, "%d\n%s%s\n%s",
+                  flags,
+                  atref ? "@" : "",
+                  atref ? atref : ns,
+                  key) < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return hkey;
+}
+
+bool kvs_cache_eligible (flux_t *h, const char *ns, const char *atref,
+                         int flags)
+{
+    struct kvs_cache *cache;
+
+    if (!(cache = flux_aux_get (h, auxkey))
+        || (flags & FLUX_KVS_WATCH)
+        || (flags & FLUX_KVS_WAITCREATE))
+        return false;
+    if (!atref) {
+        if ((cache->flags & FLUX_KVS_CACHE_FIXED_ROOT)
+            || !cache_ns_get (cache, ns))
+            return false;
+    }
+    return true;
+}
+
+flux_future_t *kvs_cache_lookup (flux_t *h, const char *ns,
+                                 const char *atref, int flags,
+                                 const char *key)
+{
+    struct kvs_cache *cache;
+    struct cache_entry *e = NULL;
+    flux_future_t *f = NULL;
+    flux_msg_t *msg = NULL;
+    char *hkey;
+    char *s = NULL;
+    char *payload = NULL;
+
+    if (!(cache = flux_aux_get (h, auxkey)))
+        return NULL;
+    if ((hkey = cache_hkey (ns, atref, flags, key))) {
+        e = zhashx_lookup (cache->entries, hkey);
+        free (hkey);
+    }
+    if (!e || (e->ns && e->ns->seq < e->ns->min_seq))
+        goto miss;
+    if (!(s = json_dumps (e->treeobj, JSON_COMPACT))
+        || asprintf (&payload, "{\"val\":%s}", s) < 0
+        || !(msg = flux_response_encode ("kvs.lookup", payload))
+        || !(f = flux_future_create (NULL, NULL)))
+        goto miss;
+    flux_future_set_flux (f, h);
+    flux_future_fulfill (f, msg, (flux_free_f)flux_msg_destroy);
+    zlistx_move_end (cache->lru, e->handle);
+    cache->hits++;
+    free (payload);
+    free (s);
+    return f;
+miss:
+    flux_msg_destroy (msg);
+    free (payload);
+    free (s);
+    cache->misses++;
+    return NULL;
+}
+
+void kvs_cache_insert (flux_t *h, const char *ns, const char *atref,
+                       int flags, const char *key, int rootseq,
+                       json_t *treeobj)
+{
+    struct kvs_cache *cache;
+    struct cache_ns *cns = NULL;
+    struct cache_entry *e, *old;
+
+    if (!(cache = flux_aux_get (h, auxkey))
+        || cache->max_entries == 0
+        || !treeobj)
+        return;
+    if (!atref) {
+        if (!(cns = zhashx_lookup (cache->namespaces, ns))
+            || rootseq < 0
+            || rootseq < cns->seq
+            || rootseq < cns->min_seq)
+            return;
+    }
+    if (!(e = calloc (1, sizeof (*e))))
+        return;
+    e->ns = cns;
+    e->rootseq = rootseq;
+    e->treeobj = json_incref (treeobj);
+    if (!(e->hkey = cache_hkey (ns, atref, flags, key))
+        || !(e->path = kvs_util_normalize_key (key, NULL)))
+        goto error;
+    if ((old = zhashx_lookup (cache->entries, e->hkey)))
+        cache_entry_remove (cache, old);
+    while (zhashx_size (cache->entries) >= cache->max_entries)
+        cache_entry_remove (cache, zlistx_first (cache->lru));
+    if (!(e->handle = zlistx_add_end (cache->lru, e)))
+        goto error;
+    if (zhashx_insert (cache->entries, e->hkey, e) < 0) {
+        zlistx_delete (cache->lru, e->handle);
+        goto error;
+    }
+    return;
+error:
+    cache_entry_destroy ((void **)&e);
+}
+
+void kvs_cache_wait_version (flux_t *h, const char *ns, int rootseq)
+{
+    struct kvs_cache *cache;
+    struct cache_ns *cns;
+
+    if (!(cache = flux_aux_get (h, auxkey))
+        || !(cns = zhashx_lookup (cache->namespaces, ns)))
+        return;
+    if (cns->min_seq < rootseq)
+        cns->min_seq = rootseq;
+}
+
+int flux_kvs_cache_enable (flux_t *h, int max_entries, int flags)
+{
+    struct kvs_cache *cache;
+
+    if (!h || max_entries < 0 || (flags & ~FLUX_KVS_CACHE_FIXED_ROOT)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(cache = flux_aux_get (h, auxkey))) {
+        if (!(cache = kvs_cache_create (h)))
+            return -1;
+        if (flux_aux_set (h, auxkey, cache,
+                          (flux_free_f)kvs_cache_destroy) < 0) {
+            kvs_cache_destroy (cache);
+            return -1;
+        }
+    }
+    else
+        cache_purge (cache);
+    cache->max_entries = max_entries;
+    cache->flags = flags;
+    return 0;
+}
+
+int flux_kvs_cache_get_stats (flux_t *h, int *entries, int *hits,
+                              int *misses)
+{
+    struct kvs_cache *cache;
+
+    if (!h || !(cache = flux_aux_get (h, auxkey))) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (entries)
+        *entries = zhashx_size (cache->entries);
+    if (hits)
+        *hits = cache->hits;
+    if (misses)
+        *misses = cache->misses;
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
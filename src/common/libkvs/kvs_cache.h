@@ -0,0 +1,61 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_CORE_KVS_CACHE_H
+#define _FLUX_CORE_KVS_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum kvs_cache_flags {
+    FLUX_KVS_CACHE_FIXED_ROOT = 1, /* only cache flux_kvs_lookupat() */
+};
+
+/* Client-side lookup cache
+ * - once enabled, results of flux_kvs_lookup() and flux_kvs_lookupat()
+ *   are kept on the handle, up to 'max_entries' results, least recently
+ *   used first out.  Lookups that hit the cache return a future that
+ *   is already fulfilled.
+ * - lookups at a fixed root (flux_kvs_lookupat()) are cached until
+ *   evicted, since the content they refer to cannot change.
+ * - lookups at the current root are cached until a kvs.setroot event
+ *   lists the key, or a parent or child of it, as changed.  Those
+ *   events are private, so connections without the instance owner
+ *   role must set FLUX_KVS_CACHE_FIXED_ROOT.  Events are handled only
+ *   when the handle's reactor runs, so a handle that is used without
+ *   running its reactor should set FLUX_KVS_CACHE_FIXED_ROOT too.
+ *   Once a commit made through the handle completes, or after
+ *   flux_kvs_wait_version(), cached results in the namespace are
+ *   bypassed until the corresponding setroot event is seen.
+ * - results that were resolved through a symlink are not cached, nor
+ *   are FLUX_KVS_WATCH or FLUX_KVS_WAITCREATE lookups.
+ * - the cache consumes kvs.setroot and kvs.namespace-removed events of
+ *   namespaces it has looked up keys in.
+ * Returns -1 on error (errno set), 0 on success.  Calling it again
+ * changes 'max_entries' and 'flags' and drops all cached results.
+ */
+int flux_kvs_cache_enable (flux_t *h, int max_entries, int flags);
+
+/* Get cache statistics.  Hits and misses count lookups that were
+ * eligible for caching.  Fails with EINVAL if the cache is not enabled.
+ */
+int flux_kvs_cache_get_stats (flux_t *h, int *entries, int *hits,
+                              int *misses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_FLUX_CORE_KVS_CACHE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,49 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _KVS_CACHE_PRIVATE_H
+#define _KVS_CACHE_PRIVATE_H
+
+#include <stdbool.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+/* Return true if a lookup at 'atref' (NULL for the current root of
+ * 'ns') with 'flags' should go through the lookup cache of 'h'.
+ */
+bool kvs_cache_eligible (flux_t *h, const char *ns, const char *atref,
+                         int flags);
+
+/* Return a fulfilled kvs.lookup future for a cached result, or NULL if
+ * there is none.
+ */
+flux_future_t *kvs_cache_lookup (flux_t *h, const char *ns,
+                                 const char *atref, int flags,
+                                 const char *key);
+
+/* Cache the result of a lookup, taken from the kvs.lookup response.
+ * 'rootseq' is the sequence number of the root it was looked up at,
+ * and is ignored if 'atref' is set.
+ */
+void kvs_cache_insert (flux_t *h, const char *ns, const char *atref,
+                       int flags, const char *key, int rootseq,
+                       json_t *treeobj);
+
+/* Bypass cached results of 'ns' until a setroot event with a sequence
+ * number of at least 'rootseq' is seen.  Called with the sequence number
+ * of a commit response, and on flux_kvs_wait_version().
+ */
+void kvs_cache_wait_version (flux_t *h, const char *ns, int rootseq);
+
+#endif /* !_KVS_CACHE_PRIVATE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
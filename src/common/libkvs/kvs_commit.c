@@ -18,11 +18,15 @@
 #include "treeobj.h"
 #include "kvs_txn_private.h"
 #include "kvs_util_private.h"
+#include "kvs_cache_private.h"
 #include "src/common/libutil/blobref.h"
+#include "src/common/libutil/monotime.h"
 
 static const char *auxkey = "flux::commit_ctx";
 
 struct commit_ctx {
+    flux_t *h;
+    char *ns;
     char *treeobj;      /* cached treeobj */
 };
 
@@ -30,26 +34,95 @@ static void free_ctx (struct commit_ctx *ctx)
 {
     if (ctx) {
         int saved_errno = errno;
+        free (ctx->ns);
         free (ctx->treeobj);
         free (ctx);
         errno = saved_errno;
     }
 }
 
-static struct commit_ctx *alloc_ctx (void)
+static struct commit_ctx *alloc_ctx (flux_t *h, const char *ns)
 {
     struct commit_ctx *ctx;
     if (!(ctx = calloc (1, sizeof (*ctx))))
         return NULL;
+    ctx->h = h;
+    if (!(ctx->ns = strdup (ns))) {
+        free_ctx (ctx);
+        errno = ENOMEM;
+        return NULL;
+    }
     return ctx;
 }
 
+/* Record the rootseq of a successful commit response so that cached
+ * lookups of the namespace are bypassed until its setroot event is seen,
+ * then fulfill the caller's future with the response.
+ */
+static void commit_continuation (flux_future_t *rpc, void *arg)
+{
+    flux_future_t *f = arg;
+    struct commit_ctx *ctx = flux_future_aux_get (f, auxkey);
+    int rootseq;
+
+    if (flux_rpc_get_unpack (rpc, "{s:i}", "rootseq", &rootseq) == 0)
+        kvs_cache_wait_version (ctx->h, ctx->ns, rootseq);
+    if (flux_future_fulfill_with (f, rpc) < 0)
+        flux_future_fatal_error (f, errno, NULL);
+}
+
+/* Called when the caller first waits on its future.  Run the RPC in
+ * the same reactor context (the handle's reactor in a "then" context,
+ * a temporary one for flux_future_get() or flux_future_wait_for()).
+ */
+static void commit_init (flux_future_t *f, void *arg)
+{
+    flux_future_t *rpc = arg;
+
+    flux_future_set_reactor (rpc, flux_future_get_reactor (f));
+    flux_future_set_flux (rpc, flux_future_get_flux (f));
+    if (flux_future_then (rpc, -1., commit_continuation, f) < 0)
+        flux_future_fulfill_error (f, errno, NULL);
+}
+
+/* Wrap a kvs.commit or kvs.fence RPC future, so the commit's rootseq
+ * is recorded when the response arrives, whether or not the caller
+ * decodes it.  The RPC future is destroyed with the returned future,
+ * or on error.
+ */
+static flux_future_t *commit_future_create (flux_t *h, const char *ns,
+                                            flux_future_t *rpc)
+{
+    flux_future_t *f;
+    struct commit_ctx *ctx;
+
+    if (!(f = flux_future_create (commit_init, rpc))) {
+        flux_future_destroy (rpc);
+        return NULL;
+    }
+    if (flux_future_aux_set (f, NULL, rpc,
+                             (flux_free_f)flux_future_destroy) < 0) {
+        flux_future_destroy (rpc);
+        goto error;
+    }
+    flux_future_set_flux (f, h);
+    if (!(ctx = alloc_ctx (h, ns)))
+        goto error;
+    if (flux_future_aux_set (f, auxkey, ctx, (flux_free_f)free_ctx) < 0) {
+        free_ctx (ctx);
+        goto error;
+    }
+    return f;
+error:
+    flux_future_destroy (f);
+    return NULL;
+}
+
 flux_future_t *flux_kvs_fence (flux_t *h, const char *ns, int flags,
                                const char *name, int nprocs,
                                flux_kvs_txn_t *txn)
 {
     flux_future_t *f;
-    struct commit_ctx *ctx = NULL;
     json_t *ops;
 
     if (!name || nprocs <= 0 || !txn) {
@@ -67,9 +140,6 @@ flux_future_t *flux_kvs_fence (flux_t *h, const char *ns, int flags,
         return NULL;
     }
 
-    if (!(ctx = alloc_ctx ()))
-        return NULL;
-
     if (!(f = flux_rpc_pack (h, "kvs.fence", FLUX_NODEID_ANY, 0,
                              "{s:s s:i s:s s:i s:O}",
                              "name", name,
@@ -77,25 +147,15 @@ flux_future_t *flux_kvs_fence (flux_t *h, const char *ns, int flags,
                              "namespace", ns,
                              "flags", flags,
                              "ops", ops)))
-        goto error;
-
-    if (flux_future_aux_set (f, auxkey, ctx, (flux_free_f)free_ctx) < 0)
-        goto error_future;
-
-    return f;
+        return NULL;
 
-error_future:
-    flux_future_destroy (f);
-error:
-    free_ctx (ctx);
-    return NULL;
+    return commit_future_create (h, ns, f);
 }
 
 flux_future_t *flux_kvs_commit (flux_t *h, const char *ns, int flags,
                                 flux_kvs_txn_t *txn)
 {
     flux_future_t *f;
-    struct commit_ctx *ctx = NULL;
     json_t *ops;
 
     if (!txn) {
@@ -113,26 +173,14 @@ flux_future_t *flux_kvs_commit (flux_t *h, const char *ns, int flags,
         return NULL;
     }
 
-    if (!(ctx = alloc_ctx ()))
-        return NULL;
-
     if (!(f = flux_rpc_pack (h, "kvs.commit", FLUX_NODEID_ANY, 0,
                              "{s:s s:i s:O}",
                              "namespace", ns,
                              "flags", flags,
                              "ops", ops)))
-        goto error;
-
-    if (flux_future_aux_set (f, auxkey, ctx, (flux_free_f)free_ctx) < 0)
-        goto error_future;
-
-    return f;
+        return NULL;
 
-error_future:
-    flux_future_destroy (f);
-error:
-    free_ctx (ctx);
-    return NULL;
+    return commit_future_create (h, ns, f);
 }
 
 static int decode_response (flux_future_t *f, const char **rootrefp,
@@ -192,6 +240,475 @@ int flux_kvs_commit_get_treeobj (flux_future_t *f, const char **treeobj)
     return 0;
 }
 
+/* Group commit.
+ *
+ * Transactions passed to flux_kvs_commit_batched() are queued on a
+ * per-handle, per-namespace batch and sent as one kvs.commit request
+ * when the batch window expires.  The window tracks a smoothed average
+ * of observed commit latency, so under light load commits go out almost
+ * immediately, and under heavy load more transactions share a commit.
+ * Each caller gets its own future, fulfilled with a copy of the merged
+ * commit response.  If the merged commit fails, each transaction is
+ * retried on its own so that callers see their own result.
+ *
+ * Only one commit per batch is in flight at a time, and retries are
+ * sent one at a time in their original order before any later
+ * transactions, so that transactions on the same key (e.g. eventlog
+ * appends) are applied in the order they were submitted.
+ */
+
+static const char *waiter_auxkey = "flux::commit_waiter";
+
+static const double batch_window_min = 0.0005;
+static const double batch_window_max = 0.01;
+static const double batch_latency_init = 0.002;
+
+struct commit_batch;
+struct commit_flush;
+
+struct commit_waiter {
+    flux_future_t *f;           /* caller's future (batch holds a ref) */
+    json_t *ops;
+    struct commit_batch *batch; /* NULL once fulfilled */
+    struct commit_flush *flush; /* merged commit in flight, if any */
+    flux_future_t *retry;       /* individual commit in flight, if any */
+};
+
+struct commit_flush {
+    struct commit_batch *batch;
+    flux_future_t *f;
+    zlist_t *waiters;
+    struct timespec t_start;
+};
+
+struct commit_batch {
+    flux_t *h;
+    char *ns;
+    int flags;
+    flux_watcher_t *timer;
+    bool timer_armed;
+    zlist_t *pending;           /* waiters not yet sent */
+    struct commit_flush *flush; /* merged commit in flight, if any */
+    zlist_t *retries;           /* waiters to retry, head in flight */
+    double latency;             /* smoothed commit latency (seconds) */
+};
+
+static void waiter_destroy (struct commit_waiter *w)
+{
+    if (w) {
+        int saved_errno = errno;
+        json_decref (w->ops);
+        free (w);
+        errno = saved_errno;
+    }
+}
+
+/* Fulfill caller's future with a copy of 'msg', or with an error
+ * if 'msg' is NULL.  Drop the batch's reference on the future, which
+ * may destroy 'w', so the caller must not reference 'w' afterwards.
+ */
+static void waiter_fulfill (struct commit_waiter *w,
+                            const flux_msg_t *msg,
+                            int errnum,
+                            const char *errstr)
+{
+    flux_msg_t *cpy;
+
+    w->batch = NULL;
+    w->flush = NULL;
+    w->retry = NULL;
+    if (msg) {
+        if (!(cpy = flux_msg_copy (msg, true)))
+            flux_future_fulfill_error (w->f, errno, NULL);
+        else
+            flux_future_fulfill (w->f, cpy, (flux_free_f)flux_msg_destroy);
+    }
+    else
+        flux_future_fulfill_error (w->f, errnum, errstr);
+    flux_future_decref (w->f);
+}
+
+static void flush_destroy (struct commit_flush *fl)
+{
+    if (fl) {
+        int saved_errno = errno;
+        flux_future_destroy (fl->f);
+        zlist_destroy (&fl->waiters);
+        free (fl);
+        errno = saved_errno;
+    }
+}
+
+static flux_future_t *commit_ops (struct commit_batch *batch, json_t *ops)
+{
+    return flux_rpc_pack (batch->h, "kvs.commit", FLUX_NODEID_ANY, 0,
+                          "{s:s s:i s:O}",
+                          "namespace", batch->ns,
+                          "flags", batch->flags,
+                          "ops", ops);
+}
+
+/* Bypass cached lookups of the namespace until the setroot event for
+ * a successful commit response 'msg' is seen.
+ */
+static void batch_wait_version (struct commit_batch *batch,
+                                const flux_msg_t *msg)
+{
+    int rootseq;
+
+    if (flux_msg_unpack (msg, "{s:i}", "rootseq", &rootseq) == 0)
+        kvs_cache_wait_version (batch->h, batch->ns, rootseq);
+}
+
+static void batch_next (struct commit_batch *batch);
+
+static void retry_complete (flux_future_t *f, struct commit_waiter *w)
+{
+    struct commit_batch *batch = w->batch;
+    const flux_msg_t *msg;
+
+    zlist_remove (batch->retries, w);
+    if (flux_future_get (f, (const void **)&msg) < 0)
+        waiter_fulfill (w, NULL, errno, flux_future_error_string (f));
+    else {
+        batch_wait_version (batch, msg);
+        waiter_fulfill (w, msg, 0, NULL);
+    }
+    flux_future_destroy (f);
+    batch_next (batch);
+}
+
+static void retry_continuation (flux_future_t *f, void *arg)
+{
+    retry_complete (f, arg);
+}
+
+/* Resend a single transaction after the merged commit it was part of
+ * failed.
+ */
+static int waiter_retry (struct commit_batch *batch, struct commit_waiter *w)
+{
+    flux_future_t *f;
+
+    if (!(f = commit_ops (batch, w->ops))
+        || flux_future_then (f, -1., retry_continuation, w) < 0) {
+        flux_future_destroy (f);
+        return -1;
+    }
+    w->retry = f;
+    return 0;
+}
+
+/* Fold the latency of a completed commit into the smoothed average
+ * (gain 1/8, as for TCP SRTT).
+ */
+static void batch_update_latency (struct commit_batch *batch, double t)
+{
+    batch->latency += (t - batch->latency) / 8.;
+}
+
+static double batch_window (struct commit_batch *batch)
+{
+    double window = batch->latency / 2.;
+
+    if (window < batch_window_min)
+        window = batch_window_min;
+    if (window > batch_window_max)
+        window = batch_window_max;
+    return window;
+}
+
+static void flush_complete (struct commit_flush *fl)
+{
+    struct commit_batch *batch = fl->batch;
+    const flux_msg_t *msg;
+    struct commit_waiter *w;
+
+    batch_update_latency (batch, monotime_since (fl->t_start) * 1E-3);
+    batch->flush = NULL;
+    if (flux_future_get (fl->f, (const void **)&msg) == 0) {
+        batch_wait_version (batch, msg);
+        while ((w = zlist_pop (fl->waiters)))
+            waiter_fulfill (w, msg, 0, NULL);
+    }
+    else if (zlist_size (fl->waiters) == 1) {
+        int errnum = errno;
+        w = zlist_pop (fl->waiters);
+        waiter_fulfill (w, NULL, errnum, flux_future_error_string (fl->f));
+    }
+    else {
+        while ((w = zlist_pop (fl->waiters))) {
+            w->flush = NULL;
+            if (zlist_append (batch->retries, w) < 0)
+                waiter_fulfill (w, NULL, ENOMEM, NULL);
+        }
+    }
+    flush_destroy (fl);
+    batch_next (batch);
+}
+
+static void flush_continuation (flux_future_t *f, void *arg)
+{
+    flush_complete (arg);
+}
+
+/* Send all pending transactions as one kvs.commit.
+ */
+static void batch_flush (struct commit_batch *batch)
+{
+    struct commit_flush *fl;
+    struct commit_waiter *w;
+    json_t *ops = NULL;
+
+    flux_watcher_stop (batch->timer);
+    batch->timer_armed = false;
+    if (zlist_size (batch->pending) == 0)
+        return;
+    if (!(fl = calloc (1, sizeof (*fl))))
+        goto error;
+    fl->batch = batch;
+    if (!(fl->waiters = zlist_new ()) || !(ops = json_array ()))
+        goto nomem;
+    w = zlist_first (batch->pending);
+    while (w) {
+        if (json_array_extend (ops, w->ops) < 0)
+            goto nomem;
+        w = zlist_next (batch->pending);
+    }
+    monotime (&fl->t_start);
+    if (!(fl->f = commit_ops (batch, ops)))
+        goto error;
+    if (flux_future_then (fl->f, -1., flush_continuation, fl) < 0)
+        goto error;
+    batch->flush = fl;
+    json_decref (ops);
+    while ((w = zlist_pop (batch->pending))) {
+        w->flush = fl;
+        if (zlist_append (fl->waiters, w) < 0) {
+            w->flush = NULL;
+            waiter_fulfill (w, NULL, ENOMEM, NULL);
+        }
+    }
+    return;
+nomem:
+    errno = ENOMEM;
+error:
+    json_decref (ops);
+    flush_destroy (fl);
+    while ((w = zlist_pop (batch->pending)))
+        waiter_fulfill (w, NULL, errno, NULL);
+}
+
+/* Send the next commit after the previous one completes.  Failed
+ * transactions are retried first, one at a time and in order.  Then
+ * pending transactions are sent if their window has already expired.
+ */
+static void batch_next (struct commit_batch *batch)
+{
+    struct commit_waiter *w;
+
+    if (batch->flush)
+        return;
+    while ((w = zlist_first (batch->retries))) {
+        if (w->retry || waiter_retry (batch, w) == 0)
+            return;
+        zlist_remove (batch->retries, w);
+        waiter_fulfill (w, NULL, errno, NULL);
+    }
+    if (!batch->timer_armed)
+        batch_flush (batch);
+}
+
+static void batch_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
+                            int revents, void *arg)
+{
+    struct commit_batch *batch = arg;
+
+    batch->timer_armed = false;
+    batch_next (batch);
+}
+
+/* Handle is being closed: fail any outstanding commits.
+ */
+static void batch_destroy (struct commit_batch *batch)
+{
+    if (batch) {
+        int saved_errno = errno;
+        struct commit_flush *fl;
+        struct commit_waiter *w;
+
+        while ((w = zlist_pop (batch->pending)))
+            waiter_fulfill (w, NULL, ECANCELED, NULL);
+        if ((fl = batch->flush)) {
+            while ((w = zlist_pop (fl->waiters)))
+                waiter_fulfill (w, NULL, ECANCELED, NULL);
+            flush_destroy (fl);
+        }
+        while ((w = zlist_pop (batch->retries))) {
+            flux_future_destroy (w->retry);
+            waiter_fulfill (w, NULL, ECANCELED, NULL);
+        }
+        zlist_destroy (&batch->pending);
+        zlist_destroy (&batch->retries);
+        flux_watcher_destroy (batch->timer);
+        free (batch->ns);
+        free (batch);
+        errno = saved_errno;
+    }
+}
+
+static struct commit_batch *batch_create (flux_t *h, const char *ns, int flags)
+{
+    struct commit_batch *batch;
+
+    if (!(batch = calloc (1, sizeof (*batch))))
+        return NULL;
+    batch->h = h;
+    batch->flags = flags;
+    batch->latency = batch_latency_init;
+    if (!(batch->ns = strdup (ns))
+        || !(batch->pending = zlist_new ())
+        || !(batch->retries = zlist_new ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if (!(batch->timer = flux_timer_watcher_create (flux_get_reactor (h),
+                                                    0.,
+                                                    0.,
+                                                    batch_timer_cb,
+                                                    batch)))
+        goto error;
+    return batch;
+error:
+    batch_destroy (batch);
+    return NULL;
+}
+
+/* Look up the batch for (ns, flags) on handle, creating it on first use.
+ */
+static struct commit_batch *batch_get (flux_t *h, const char *ns, int flags)
+{
+    struct commit_batch *batch;
+    char *key;
+
+    if (asprintf (&key, "flux::commit_batch::%d::%s", flags, ns) < 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!(batch = flux_aux_get (h, key))) {
+        if (!(batch = batch_create (h, ns, flags)))
+            goto done;
+        if (flux_aux_set (h, key, batch, (flux_free_f)batch_destroy) < 0) {
+            batch_destroy (batch);
+            batch = NULL;
+            goto done;
+        }
+    }
+done:
+    free (key);
+    return batch;
+}
+
+/* Called when the caller first waits on its future.  In a "then" context
+ * the batch timer and commit continuations run in the handle's reactor.
+ * In a "now" context (flux_future_get(), flux_future_wait_for()) that
+ * reactor is not running, so drive the batch directly, completing any
+ * commits ahead of this one in order, until this one is fulfilled.
+ */
+static void waiter_init (flux_future_t *f, void *arg)
+{
+    struct commit_waiter *w = flux_future_aux_get (f, waiter_auxkey);
+    struct commit_batch *batch;
+    struct commit_waiter *rw;
+
+    if (!w || !w->batch)
+        return;
+    batch = w->batch;
+    if (flux_future_get_reactor (f) == flux_get_reactor (batch->h))
+        return;
+    while (w->batch) {
+        if (batch->flush) {
+            struct commit_flush *fl = batch->flush;
+            (void)flux_future_wait_for (fl->f, -1.);
+            flush_complete (fl);
+        }
+        else if ((rw = zlist_first (batch->retries)) && rw->retry) {
+            flux_future_t *retry = rw->retry;
+            (void)flux_future_wait_for (retry, -1.);
+            retry_complete (retry, rw);
+        }
+        else {
+            flux_watcher_stop (batch->timer);
+            batch->timer_armed = false;
+            batch_next (batch);
+        }
+    }
+}
+
+flux_future_t *flux_kvs_commit_batched (flux_t *h, const char *ns, int flags,
+                                        flux_kvs_txn_t *txn)
+{
+    struct commit_batch *batch;
+    struct commit_waiter *w = NULL;
+    struct commit_ctx *ctx = NULL;
+    flux_future_t *f;
+    json_t *ops;
+
+    if (!h || !txn) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((flags & FLUX_KVS_NO_MERGE))
+        return flux_kvs_commit (h, ns, flags, txn);
+    if (!ns) {
+        if (!(ns = kvs_get_namespace ()))
+            return NULL;
+    }
+    if (!(ops = txn_get_ops (txn))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(batch = batch_get (h, ns, flags)))
+        return NULL;
+    if (!(f = flux_future_create (waiter_init, NULL)))
+        return NULL;
+    flux_future_set_flux (f, h);
+    if (!(ctx = alloc_ctx (h, ns)))
+        goto error;
+    if (flux_future_aux_set (f, auxkey, ctx, (flux_free_f)free_ctx) < 0) {
+        free_ctx (ctx);
+        goto error;
+    }
+    if (!(w = calloc (1, sizeof (*w))))
+        goto error;
+    if (!(w->ops = json_copy (ops))) {
+        waiter_destroy (w);
+        errno = ENOMEM;
+        goto error;
+    }
+    if (flux_future_aux_set (f, waiter_auxkey, w,
+                             (flux_free_f)waiter_destroy) < 0) {
+        waiter_destroy (w);
+        goto error;
+    }
+    if (zlist_append (batch->pending, w) < 0) {
+        errno = ENOMEM;
+        goto error;
+    }
+    w->f = f;
+    w->batch = batch;
+    flux_future_incref (f);
+    if (zlist_size (batch->pending) == 1) {
+        flux_timer_watcher_reset (batch->timer, batch_window (batch), 0.);
+        flux_watcher_start (batch->timer);
+        batch->timer_armed = true;
+    }
+    return f;
+error:
+    flux_future_destroy (f);
+    return NULL;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
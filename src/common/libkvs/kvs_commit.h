@@ -26,6 +26,16 @@ flux_future_t *flux_kvs_fence (flux_t *h, const char *ns, int flags,
                                const char *name, int nprocs,
                                flux_kvs_txn_t *txn);
 
+/* Like flux_kvs_commit(), but the transaction may be merged with others
+ * committed through the same handle and namespace within a short window,
+ * sized from observed commit latency, and sent as a single kvs.commit.
+ * The returned future is fulfilled with the result of the merged commit,
+ * or if that fails, with the result of committing 'txn' on its own.
+ * FLUX_KVS_NO_MERGE bypasses batching.
+ */
+flux_future_t *flux_kvs_commit_batched (flux_t *h, const char *ns, int flags,
+                                        flux_kvs_txn_t *txn);
+
 /* accessors can be used for commit or fence futures */
 int flux_kvs_commit_get_treeobj (flux_future_t *f, const char **treeobj);
 int flux_kvs_commit_get_sequence (flux_future_t *f, int *rootseq);
@@ -20,6 +20,7 @@
 
 #include "kvs_dir_private.h"
 #include "kvs_lookup.h"
+#include "kvs_cache_private.h"
 #include "kvs_util_private.h"
 #include "treeobj.h"
 
@@ -27,7 +28,9 @@ struct lookup_ctx {
     flux_t *h;
     char *key;
     char *atref;
+    char *ns;
     int flags;
+    bool cache_insert;  // add response to lookup cache on first parse
 
     json_t *treeobj;
     char *treeobj_str; // json_dumps of tree object returned from lookup
@@ -49,6 +52,7 @@ static void free_ctx (struct lookup_ctx *ctx)
     if (ctx) {
         free (ctx->key);
         free (ctx->atref);
+        free (ctx->ns);
         json_decref (ctx->treeobj);
         free (ctx->treeobj_str);
         free (ctx->val_data);
@@ -112,7 +116,7 @@ flux_future_t *flux_kvs_lookup (flux_t *h,
                                 const char *key)
 {
     struct lookup_ctx *ctx;
-    flux_future_t *f;
+    flux_future_t *f = NULL;
     const char *topic = "kvs.lookup";
     int rpc_flags = 0;
 
@@ -132,11 +136,20 @@ flux_future_t *flux_kvs_lookup (flux_t *h,
         topic = "kvs-watch.lookup"; // redirect to kvs-watch module
     if ((flags & FLUX_KVS_WATCH))
         rpc_flags |= FLUX_RPC_STREAMING;
-    if (!(f = flux_rpc_pack (h, topic, FLUX_NODEID_ANY, rpc_flags,
-                             "{s:s s:s s:i}",
-                             "key", key,
-                             "namespace", ns,
-                             "flags", flags))) {
+    if (kvs_cache_eligible (h, ns, NULL, flags)) {
+        if (!(ctx->ns = strdup (ns))) {
+            free_ctx (ctx);
+            errno = ENOMEM;
+            return NULL;
+        }
+        if (!(f = kvs_cache_lookup (h, ns, NULL, flags, key)))
+            ctx->cache_insert = true;
+    }
+    if (!f && !(f = flux_rpc_pack (h, topic, FLUX_NODEID_ANY, rpc_flags,
+                                   "{s:s s:s s:i}",
+                                   "key", key,
+                                   "namespace", ns,
+                                   "flags", flags))) {
         free_ctx (ctx);
         return NULL;
     }
@@ -151,7 +164,7 @@ flux_future_t *flux_kvs_lookup (flux_t *h,
 flux_future_t *flux_kvs_lookupat (flux_t *h, int flags, const char *key,
                                   const char *treeobj)
 {
-    flux_future_t *f;
+    flux_future_t *f = NULL;
     json_t *obj = NULL;
     struct lookup_ctx *ctx;
 
@@ -170,11 +183,15 @@ flux_future_t *flux_kvs_lookupat (flux_t *h, int flags, const char *key,
         errno = EINVAL;
         return NULL;
     }
-    if (!(f = flux_rpc_pack (h, "kvs.lookup", FLUX_NODEID_ANY, 0,
-                             "{s:s s:i s:O}",
-                             "key", key,
-                             "flags", flags,
-                             "rootdir", obj))) {
+    if (kvs_cache_eligible (h, NULL, treeobj, flags)) {
+        if (!(f = kvs_cache_lookup (h, NULL, treeobj, flags, key)))
+            ctx->cache_insert = true;
+    }
+    if (!f && !(f = flux_rpc_pack (h, "kvs.lookup", FLUX_NODEID_ANY, 0,
+                                   "{s:s s:i s:O}",
+                                   "key", key,
+                                   "flags", flags,
+                                   "rootdir", obj))) {
         free_ctx (ctx);
         json_decref (obj);
         return NULL;
@@ -189,16 +206,31 @@ flux_future_t *flux_kvs_lookupat (flux_t *h, int flags, const char *key,
     return f;
 }
 
-static int decode_treeobj (flux_future_t *f, json_t **treeobj)
+/* A kvs.lookup response includes the root sequence number and whether
+ * the lookup went through a symlink.  The lookup cache needs both.
+ */
+static int decode_treeobj (flux_future_t *f, struct lookup_ctx *ctx,
+                           json_t **treeobj)
 {
     json_t *obj;
+    int rootseq = -1;
+    int symlink = -1;
 
-    if (flux_rpc_get_unpack (f, "{s:o}", "val", &obj) < 0)
+    if (flux_rpc_get_unpack (f, "{s:o s?i s?b}",
+                             "val", &obj,
+                             "rootseq", &rootseq,
+                             "symlink", &symlink) < 0)
         return -1;
     if (treeobj_validate (obj) < 0) {
         errno = EPROTO;
         return -1;
     }
+    if (ctx->cache_insert) {
+        if (symlink == 0)
+            kvs_cache_insert (ctx->h, ctx->ns, ctx->atref, ctx->flags,
+                              ctx->key, rootseq, obj);
+        ctx->cache_insert = false;
+    }
     *treeobj = obj;
     return 0;
 }
@@ -223,7 +255,7 @@ static int parse_response (flux_future_t *f, struct lookup_ctx *ctx)
 {
     json_t *treeobj2;
 
-    if (decode_treeobj (f, &treeobj2) < 0)
+    if (decode_treeobj (f, ctx, &treeobj2) < 0)
         return -1;
     if (!ctx->treeobj || !json_equal (ctx->treeobj, treeobj2)) {
         json_decref (ctx->treeobj);
@@ -16,8 +16,10 @@
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <jansson.h>
 
 #include "kvs.h"
+#include "kvs_util_private.h"
 
 char *kvs_util_normalize_key (const char *key, bool *want_directory)
 {
@@ -58,6 +60,33 @@ char *kvs_util_normalize_key (const char *key, bool *want_directory)
     return cpy;
 }
 
+bool kvs_util_key_conflict (const char *key, const char *changed)
+{
+    size_t klen = strlen (key);
+    size_t clen = strlen (changed);
+
+    if (!strcmp (changed, "."))
+        return true;
+    if (klen == clen)
+        return !strcmp (key, changed);
+    if (klen > clen)
+        return !strncmp (key, changed, clen) && key[clen] == '.';
+    return !strncmp (changed, key, klen) && changed[klen] == '.';
+}
+
+bool kvs_util_keys_conflict (const char *key, json_t *keys)
+{
+    size_t index;
+    json_t *value;
+
+    json_array_foreach (keys, index, value) {
+        const char *s = json_string_value (value);
+        if (!s || kvs_util_key_conflict (key, s))
+            return true;
+    }
+    return false;
+}
+
 const char *kvs_get_namespace (void)
 {
     const char *ns;
@@ -11,6 +11,9 @@
 #ifndef _FLUX_KVS_UTIL_H
 #define _FLUX_KVS_UTIL_H
 
+#include <stdbool.h>
+#include <jansson.h>
+
 /* Normalize a KVS key
  * Returns new key string (caller must free), or NULL with errno set.
  * On success, 'want_directory' is set to true if key had a trailing
@@ -18,6 +21,17 @@
  */
 char *kvs_util_normalize_key (const char *key, bool *want_directory);
 
+/* Return true if a change to normalized key 'changed' may alter the
+ * lookup of normalized key 'key', i.e. if either is a path prefix of
+ * the other.  A change to the root directory "." conflicts with all keys.
+ */
+bool kvs_util_key_conflict (const char *key, const char *changed);
+
+/* Return true if any key in JSON array 'keys' conflicts with 'key',
+ * or if the array contains a non-string.
+ */
+bool kvs_util_keys_conflict (const char *key, json_t *keys);
+
 /* Get kvs namespace from FLUX_KVS_NAMESPACE environment variable, or
  * if not set, return default */
 const char *kvs_get_namespace (void);
@@ -0,0 +1,306 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <jansson.h>
+
+#include "src/common/libflux/flux.h"
+#include "kvs.h"
+#include "treeobj.h"
+#include "src/common/libtap/tap.h"
+#include "src/common/libflux/test/util.h"
+
+static const char *rootref = "sha1-0000000000000000000000000000000000000000";
+static const char *rootdir =
+    "{\"data\":[\"sha1-0000000000000000000000000000000000000000\"],"
+    "\"type\":\"dirref\",\"ver\":1}";
+
+/* Fake kvs.lookup service on the loopback handle.  The value of every
+ * key is "<key>@<seq>", so a stale result can be told from a fresh one.
+ * Keys starting with "link" are reported as resolved through a symlink.
+ */
+struct lookup_server {
+    int requests;
+    int seq;
+    int setroots;               /* setroot events seen by the test */
+};
+
+void lookup_cb (flux_t *h, flux_msg_handler_t *mh,
+                const flux_msg_t *msg, void *arg)
+{
+    struct lookup_server *srv = arg;
+    const char *key;
+    char *s;
+    json_t *val;
+
+    if (flux_request_unpack (msg, NULL, "{s:s}", "key", &key) < 0)
+        BAIL_OUT ("could not decode lookup request");
+    srv->requests++;
+    if (asprintf (&s, "%s@%d", key, srv->seq) < 0
+        || !(val = treeobj_create_val (s, strlen (s) + 1)))
+        BAIL_OUT ("could not create value");
+    if (flux_respond_pack (h, msg, "{s:o s:i s:b}",
+                           "val", val,
+                           "rootseq", srv->seq,
+                           "symlink", !strncmp (key, "link", 4)) < 0)
+        BAIL_OUT ("flux_respond_pack failed");
+    free (s);
+}
+
+/* Fake kvs.commit service.  The commit is reported at the next
+ * sequence number.
+ */
+void commit_cb (flux_t *h, flux_msg_handler_t *mh,
+                const flux_msg_t *msg, void *arg)
+{
+    struct lookup_server *srv = arg;
+
+    if (flux_respond_pack (h, msg, "{s:s s:i}",
+                           "rootref", rootref,
+                           "rootseq", srv->seq + 1) < 0)
+        BAIL_OUT ("flux_respond_pack failed");
+}
+
+void sync_cb (flux_t *h, flux_msg_handler_t *mh,
+              const flux_msg_t *msg, void *arg)
+{
+    if (flux_respond (h, msg, NULL) < 0)
+        BAIL_OUT ("flux_respond failed");
+}
+
+/* Count setroot events, to check that the cache leaves them to other
+ * handlers on the handle.
+ */
+void setroot_cb (flux_t *h, flux_msg_handler_t *mh,
+                 const flux_msg_t *msg, void *arg)
+{
+    struct lookup_server *srv = arg;
+    srv->setroots++;
+}
+
+static void stop_cb (flux_future_t *f, void *arg)
+{
+    flux_reactor_stop (flux_get_reactor (flux_future_get_flux (f)));
+}
+
+/* Look up 'key' in the current root, or at 'rootdir' if 'at' is true,
+ * and check that the result is "<key>@<seq>".
+ */
+static bool lookup_is (flux_t *h, bool at, const char *key, int seq)
+{
+    flux_future_t *f;
+    const char *value;
+    char *expected;
+    bool match;
+
+    if (at)
+        f = flux_kvs_lookupat (h, 0, key, rootdir);
+    else
+        f = flux_kvs_lookup (h, "primary", 0, key);
+    if (!f
+        || flux_future_then (f, -1., stop_cb, NULL) < 0
+        || flux_reactor_run (flux_get_reactor (h), 0) < 0
+        || flux_kvs_lookup_get (f, &value) < 0)
+        BAIL_OUT ("lookup of %s failed", key);
+    if (asprintf (&expected, "%s@%d", key, seq) < 0)
+        BAIL_OUT ("asprintf failed");
+    match = !strcmp (value, expected);
+    if (!match)
+        diag ("%s: expected %s, got %s", key, expected, value);
+    free (expected);
+    flux_future_destroy (f);
+    return match;
+}
+
+/* Send a setroot event, and run the reactor until it has been
+ * dispatched.  Messages are dispatched in order, so a request sent
+ * after the event is answered after the event is handled.
+ */
+static void send_setroot (flux_t *h, int seq, const char *key)
+{
+    flux_msg_t *msg;
+    flux_future_t *f;
+
+    if (!(msg = flux_event_pack ("kvs.setroot-primary",
+                                 "{s:s s:i s:[s] s:[]}",
+                                 "namespace", "primary",
+                                 "rootseq", seq,
+                                 "keys", key,
+                                 "link-keys"))
+        || flux_send (h, msg, 0) < 0)
+        BAIL_OUT ("could not send setroot event");
+    flux_msg_destroy (msg);
+    if (!(f = flux_rpc (h, "test.sync", NULL, FLUX_NODEID_ANY, 0))
+        || flux_future_then (f, -1., stop_cb, NULL) < 0
+        || flux_reactor_run (flux_get_reactor (h), 0) < 0
+        || flux_future_get (f, NULL) < 0)
+        BAIL_OUT ("could not sync after setroot event");
+    flux_future_destroy (f);
+}
+
+static void stats_is (flux_t *h, int entries, int hits, int misses,
+                      const char *msg)
+{
+    int e, hi, m;
+
+    if (flux_kvs_cache_get_stats (h, &e, &hi, &m) < 0)
+        BAIL_OUT ("flux_kvs_cache_get_stats failed");
+    ok (e == entries && hi == hits && m == misses,
+        "%s: entries=%d hits=%d misses=%d", msg, e, hi, m);
+}
+
+void errors (void)
+{
+    flux_t *h;
+
+    if (!(h = loopback_create (0)))
+        BAIL_OUT ("could not create loopback handle");
+    errno = 0;
+    ok (flux_kvs_cache_enable (NULL, 1, 0) < 0 && errno == EINVAL,
+        "flux_kvs_cache_enable h=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_kvs_cache_enable (h, -1, 0) < 0 && errno == EINVAL,
+        "flux_kvs_cache_enable max_entries=-1 fails with EINVAL");
+    errno = 0;
+    ok (flux_kvs_cache_enable (h, 1, 0x100) < 0 && errno == EINVAL,
+        "flux_kvs_cache_enable with unknown flags fails with EINVAL");
+    errno = 0;
+    ok (flux_kvs_cache_get_stats (h, NULL, NULL, NULL) < 0
+        && errno == EINVAL,
+        "flux_kvs_cache_get_stats fails with EINVAL if not enabled");
+    flux_close (h);
+}
+
+void cache (void)
+{
+    flux_t *h;
+    flux_msg_handler_t **handlers;
+    struct lookup_server srv = { 0 };
+    flux_kvs_txn_t *txn;
+    flux_future_t *f;
+    int seq;
+    const struct flux_msg_handler_spec htab[] = {
+        { FLUX_MSGTYPE_REQUEST, "kvs.lookup", lookup_cb, 0 },
+        { FLUX_MSGTYPE_REQUEST, "kvs.commit", commit_cb, 0 },
+        { FLUX_MSGTYPE_REQUEST, "test.sync", sync_cb, 0 },
+        { FLUX_MSGTYPE_EVENT, "kvs.setroot-*", setroot_cb, 0 },
+        FLUX_MSGHANDLER_TABLE_END,
+    };
+
+    if (!(h = loopback_create (0)))
+        BAIL_OUT ("could not create loopback handle");
+    if (flux_msg_handler_addvec (h, htab, &srv, &handlers) < 0)
+        BAIL_OUT ("flux_msg_handler_addvec failed");
+
+    ok (lookup_is (h, false, "a", 0) && srv.requests == 1,
+        "lookup without cache sends a request");
+    ok (flux_kvs_cache_enable (h, 100, 0) == 0,
+        "flux_kvs_cache_enable works");
+    stats_is (h, 0, 0, 0, "new cache is empty");
+
+    /* current root */
+    srv.requests = 0;
+    ok (lookup_is (h, false, "a", 0) && lookup_is (h, false, "a", 0)
+        && srv.requests == 1,
+        "repeated lookup of a is answered from the cache");
+    ok (lookup_is (h, false, "link.a", 0)
+        && lookup_is (h, false, "link.a", 0)
+        && srv.requests == 3,
+        "lookup resolved through a symlink is not cached");
+    stats_is (h, 1, 1, 3, "stats count hits and misses");
+
+    srv.seq = 1;
+    send_setroot (h, 1, "b");
+    ok (lookup_is (h, false, "a", 0) && srv.requests == 3,
+        "a is carried forward by setroot changing b");
+    srv.seq = 2;
+    send_setroot (h, 2, "a.x");
+    ok (lookup_is (h, false, "a", 2) && srv.requests == 4,
+        "a is dropped by setroot changing a.x");
+    srv.seq = 5;
+    send_setroot (h, 5, "b");
+    ok (lookup_is (h, false, "a", 5) && srv.requests == 5,
+        "a is dropped by setroot that skips a sequence number");
+    ok (srv.setroots == 3,
+        "setroot events are still delivered to other handlers");
+
+    if (!(txn = flux_kvs_txn_create ())
+        || flux_kvs_txn_put (txn, 0, "b", "42") < 0
+        || !(f = flux_kvs_commit (h, "primary", 0, txn))
+        || flux_future_then (f, -1., stop_cb, NULL) < 0
+        || flux_reactor_run (flux_get_reactor (h), 0) < 0)
+        BAIL_OUT ("flux_kvs_commit failed");
+    ok (flux_future_get (f, NULL) == 0,
+        "flux_kvs_commit works");
+    ok (lookup_is (h, false, "a", 5) && srv.requests == 6,
+        "cached a is bypassed after a commit");
+    ok (flux_kvs_commit_get_sequence (f, &seq) == 0 && seq == 6,
+        "flux_kvs_commit_get_sequence returns 6");
+    flux_future_destroy (f);
+    flux_kvs_txn_destroy (txn);
+    srv.seq = 6;
+    send_setroot (h, 6, "b");
+    ok (lookup_is (h, false, "a", 5) && srv.requests == 6,
+        "and is used again once the commit's setroot is seen");
+
+    /* fixed root */
+    srv.requests = 0;
+    ok (lookup_is (h, true, "a", 6) && lookup_is (h, true, "a", 6)
+        && srv.requests == 1,
+        "repeated lookupat of a is answered from the cache");
+    srv.seq = 7;
+    send_setroot (h, 7, "a");
+    ok (lookup_is (h, true, "a", 6) && srv.requests == 1,
+        "lookupat result is not affected by setroot");
+
+    /* limits */
+    ok (flux_kvs_cache_enable (h, 2, 0) == 0,
+        "flux_kvs_cache_enable max_entries=2 works");
+    stats_is (h, 0, 5, 7, "cache was emptied");
+    srv.requests = 0;
+    ok (lookup_is (h, false, "a", 7) && lookup_is (h, false, "b", 7)
+        && lookup_is (h, false, "a", 7) && lookup_is (h, false, "c", 7)
+        && srv.requests == 3,
+        "lookups of a, b, a, c send 3 requests");
+    ok (lookup_is (h, false, "a", 7) && srv.requests == 3,
+        "a was used recently and is still cached");
+    ok (lookup_is (h, false, "b", 7) && srv.requests == 4,
+        "b was least recently used and was evicted");
+
+    ok (flux_kvs_cache_enable (h, 2, FLUX_KVS_CACHE_FIXED_ROOT) == 0,
+        "flux_kvs_cache_enable FLUX_KVS_CACHE_FIXED_ROOT works");
+    srv.requests = 0;
+    ok (lookup_is (h, false, "a", 7) && lookup_is (h, false, "a", 7)
+        && srv.requests == 2,
+        "lookups at current root are not cached");
+
+    flux_msg_handler_delvec (handlers);
+    flux_close (h);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    errors ();
+    cache ();
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
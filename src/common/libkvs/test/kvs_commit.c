@@ -14,11 +14,13 @@
 
 #include <string.h>
 #include <errno.h>
+#include <jansson.h>
 
 #include "src/common/libflux/flux.h"
 #include "kvs_commit.h"
 #include "kvs_txn.h"
 #include "src/common/libtap/tap.h"
+#include "src/common/libflux/test/util.h"
 
 void errors (void)
 {
@@ -58,15 +60,171 @@ void errors (void)
         && errno == EINVAL,
         "flux_kvs_commit_get_sequence fails on bad input");
 
+    errno = 0;
+    ok (flux_kvs_commit_batched (NULL, NULL, 0, txn) == NULL
+        && errno == EINVAL,
+        "flux_kvs_commit_batched fails on bad handle");
+
     flux_kvs_txn_destroy (txn);
 }
 
+/* Fake kvs.commit service on the loopback handle.  Counts requests and
+ * ops, logs the keys of successful commits in order, and fails any
+ * commit containing the key "bad".  If 'late' is set, a commit of that
+ * key is submitted when the first failure is returned.
+ */
+static const char *rootref = "sha1-0000000000000000000000000000000000000000";
+
+struct batch_result;
+
+struct commit_server {
+    int requests;
+    int ops;
+    int seq;
+    char log[64];
+    const char *late;
+    struct batch_result *late_res;
+};
+
+void commit_one (flux_t *h, const char *key, struct batch_result *res);
+
+void commit_cb (flux_t *h, flux_msg_handler_t *mh,
+                const flux_msg_t *msg, void *arg)
+{
+    struct commit_server *srv = arg;
+    json_t *ops;
+    json_t *op;
+    size_t index;
+    const char *key;
+
+    if (flux_request_unpack (msg, NULL, "{s:o}", "ops", &ops) < 0)
+        BAIL_OUT ("could not decode commit request");
+    srv->requests++;
+    json_array_foreach (ops, index, op) {
+        if (json_unpack (op, "{s:s}", "key", &key) < 0)
+            BAIL_OUT ("could not decode commit op");
+        if (!strcmp (key, "bad")) {
+            if (flux_respond_error (h, msg, EPERM, NULL) < 0)
+                BAIL_OUT ("flux_respond_error failed");
+            if (srv->late) {
+                commit_one (h, srv->late, srv->late_res);
+                srv->late = NULL;
+            }
+            return;
+        }
+    }
+    json_array_foreach (ops, index, op) {
+        (void)json_unpack (op, "{s:s}", "key", &key);
+        strncat (srv->log, key, sizeof (srv->log) - strlen (srv->log) - 1);
+    }
+    srv->ops += json_array_size (ops);
+    if (flux_respond_pack (h, msg, "{s:s s:i}",
+                           "rootref", rootref,
+                           "rootseq", ++srv->seq) < 0)
+        BAIL_OUT ("flux_respond_pack failed");
+}
+
+struct batch_result {
+    int count;
+    int expected;
+    int errors;
+    int seq[8];
+};
+
+void batch_continuation (flux_future_t *f, void *arg)
+{
+    struct batch_result *res = arg;
+    int seq = -1;
+
+    if (flux_kvs_commit_get_sequence (f, &seq) < 0)
+        res->errors++;
+    res->seq[res->count++] = seq;
+    if (res->count == res->expected)
+        flux_reactor_stop (flux_get_reactor (flux_future_get_flux (f)));
+    flux_future_destroy (f);
+}
+
+void commit_one (flux_t *h, const char *key, struct batch_result *res)
+{
+    flux_kvs_txn_t *txn;
+    flux_future_t *f;
+
+    if (!(txn = flux_kvs_txn_create ())
+        || flux_kvs_txn_put (txn, 0, key, "42") < 0)
+        BAIL_OUT ("could not create txn");
+    if (!(f = flux_kvs_commit_batched (h, "primary", 0, txn)))
+        BAIL_OUT ("flux_kvs_commit_batched failed");
+    if (flux_future_then (f, -1., batch_continuation, res) < 0)
+        BAIL_OUT ("flux_future_then failed");
+    flux_kvs_txn_destroy (txn);
+    res->expected++;
+}
+
+void commit_batch (flux_t *h, const char **keys, int count,
+                   struct batch_result *res)
+{
+    int i;
+
+    memset (res, 0, sizeof (*res));
+    for (i = 0; i < count; i++)
+        commit_one (h, keys[i], res);
+    if (flux_reactor_run (flux_get_reactor (h), 0) < 0)
+        BAIL_OUT ("flux_reactor_run failed");
+}
+
+void batched (void)
+{
+    flux_t *h;
+    flux_msg_handler_t *mh;
+    struct flux_match match = FLUX_MATCH_REQUEST;
+    struct commit_server srv = { 0 };
+    struct batch_result res;
+    const char *keys[] = { "a", "b", "c", "d" };
+    const char *badkeys[] = { "a", "bad", "c" };
+
+    if (!(h = loopback_create (0)))
+        BAIL_OUT ("could not create loopback handle");
+    match.topic_glob = "kvs.commit";
+    if (!(mh = flux_msg_handler_create (h, match, commit_cb, &srv)))
+        BAIL_OUT ("flux_msg_handler_create failed");
+    flux_msg_handler_start (mh);
+
+    commit_batch (h, keys, 4, &res);
+    ok (res.count == 4 && res.errors == 0,
+        "flux_kvs_commit_batched fulfilled 4 futures");
+    ok (srv.requests == 1 && srv.ops == 4,
+        "4 transactions were merged into one kvs.commit");
+    ok (res.seq[0] == 1 && res.seq[3] == 1,
+        "each caller got the merged commit sequence");
+
+    srv.requests = srv.ops = 0;
+    commit_batch (h, badkeys, 3, &res);
+    ok (res.count == 3 && res.errors == 1,
+        "failed merged commit is reported only to the failing caller");
+    ok (srv.requests == 4 && srv.ops == 2,
+        "transactions were retried individually after merged commit failed");
+
+    srv.requests = srv.ops = 0;
+    srv.log[0] = '\0';
+    srv.late = "d";
+    srv.late_res = &res;
+    commit_batch (h, badkeys, 3, &res);
+    ok (res.count == 4 && res.errors == 1,
+        "commit submitted during a failed merged commit was fulfilled");
+    ok (!strcmp (srv.log, "acd"),
+        "retried transactions were committed in order before later ones");
+
+    flux_msg_handler_destroy (mh);
+    flux_close (h);
+}
+
 int main (int argc, char *argv[])
 {
 
     plan (NO_PLAN);
 
     errors ();
+    batched ();
 
     done_testing();
     return (0);
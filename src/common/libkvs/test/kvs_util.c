@@ -14,6 +14,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <jansson.h>
 
 #include "src/common/libtap/tap.h"
 #include "src/common/libkvs/kvs_util_private.h"
@@ -64,12 +65,48 @@ void kvs_util_normalize_key_path_tests (void)
     free (s);
 }
 
+void kvs_util_key_conflict_tests (void)
+{
+    json_t *keys;
+
+    ok (kvs_util_key_conflict ("a.b", "a.b") == true,
+        "kvs_util_key_conflict is true for the same key");
+    ok (kvs_util_key_conflict ("a.b.c", "a.b") == true,
+        "kvs_util_key_conflict is true for a changed parent");
+    ok (kvs_util_key_conflict ("a", "a.b") == true,
+        "kvs_util_key_conflict is true for a changed child");
+    ok (kvs_util_key_conflict ("a.b", ".") == true,
+        "kvs_util_key_conflict is true for a changed root");
+    ok (kvs_util_key_conflict ("a.bc", "a.b") == false
+        && kvs_util_key_conflict ("a.b", "a.bc") == false,
+        "kvs_util_key_conflict is false for a shared string prefix");
+    ok (kvs_util_key_conflict ("a.b", "a.c") == false,
+        "kvs_util_key_conflict is false for a sibling");
+
+    if (!(keys = json_pack ("[s s]", "x", "a.c")))
+        BAIL_OUT ("json_pack failed");
+    ok (kvs_util_keys_conflict ("a.b", keys) == false,
+        "kvs_util_keys_conflict is false if no key conflicts");
+    if (json_array_append_new (keys, json_string ("a")) < 0)
+        BAIL_OUT ("json_array_append_new failed");
+    ok (kvs_util_keys_conflict ("a.b", keys) == true,
+        "kvs_util_keys_conflict is true if one key conflicts");
+    json_decref (keys);
+
+    if (!(keys = json_pack ("[i]", 42)))
+        BAIL_OUT ("json_pack failed");
+    ok (kvs_util_keys_conflict ("a.b", keys) == true,
+        "kvs_util_keys_conflict is true for a non-string key");
+    json_decref (keys);
+}
+
 int main (int argc, char *argv[])
 {
 
     plan (NO_PLAN);
 
     kvs_util_normalize_key_path_tests ();
+    kvs_util_key_conflict_tests ();
 
     done_testing ();
     return (0);
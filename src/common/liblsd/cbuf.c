@@ -325,6 +325,20 @@ cbuf_size (cbuf_t cb)
 }
 
 
+int
+cbuf_capacity (cbuf_t cb)
+{
+    int size;
+
+    assert (cb != NULL);
+    cbuf_mutex_lock (cb);
+    assert (cbuf_is_valid (cb));
+    size = cb->size;
+    cbuf_mutex_unlock (cb);
+    return (size);
+}
+
+
 int
 cbuf_free (cbuf_t cb)
 {
@@ -1719,8 +1733,15 @@ cbuf_grow (cbuf_t cb, int n)
 static int
 cbuf_shrink (cbuf_t cb)
 {
-/*  XXX: DOCUMENT ME.
+/*  Attempts to shrink the circular buffer [cb] back to its minimum size.
+ *  This is only done once all unread data has been consumed, so no data
+ *    needs to be moved; any replay data is discarded.
+ *  Returns the number of bytes by which the buffer has shrunk.
  */
+    unsigned char *data;
+    int size_old, size_meta;
+    int m;
+
     assert (cb != NULL);
     assert (cbuf_mutex_is_locked (cb));
     assert (cbuf_is_valid (cb));
@@ -1731,10 +1752,38 @@ cbuf_shrink (cbuf_t cb)
     if (cb->size - cb->used <= CBUF_CHUNK) {
         return (0);
     }
-    /*  FIXME: NOT IMPLEMENTED.
+    if (cb->used > 0) {
+        return (0);
+    }
+    size_old = cb->size;
+    size_meta = cb->alloc - cb->size;   /* size of sentinel & magic cookies */
+    assert (size_meta > 0);
+    m = cb->minsize + size_meta;
+
+    data = cb->data;
+#ifndef NDEBUG
+    data -= CBUF_MAGIC_LEN;             /* jump back to what malloc returned */
+#endif /* !NDEBUG */
+
+    if (!(data = realloc (data, m))) {
+        return (0);                     /* keep the larger buffer */
+    }
+    cb->data = data;
+    cb->alloc = m;
+    cb->size = cb->minsize;
+
+#ifndef NDEBUG
+    /*  The overflow cookie must be rebaked at the new end of the buffer.
      */
+    cb->data += CBUF_MAGIC_LEN;         /* jump forward past underflow magic */
+    memcpy (cb->data + cb->size + 1, (void *) &cb->magic, CBUF_MAGIC_LEN);
+#endif /* !NDEBUG */
+
+    cb->got_wrap = 0;
+    cb->i_in = cb->i_out = cb->i_rep = 0;
+
     assert (cbuf_is_valid (cb));
-    return (0);
+    return (size_old - cb->size);
 }
 
 
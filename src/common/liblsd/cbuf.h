@@ -101,6 +101,13 @@ int cbuf_size (cbuf_t cb);
  *    (ie, the number of bytes it can currently hold).
  */
 
+int cbuf_capacity (cbuf_t cb);
+/*
+ *  Returns the number of bytes [cb] can hold without growing, which is
+ *    between its minimum and maximum size.  A cbuf that has grown shrinks
+ *    back to its minimum size once all unread data has been consumed.
+ */
+
 int cbuf_free (cbuf_t cb);
 /*
  *  Returns the number of bytes in [cb] available for writing before unread
@@ -35,6 +35,11 @@ struct pmi_simple_client {
     unsigned int vallen_max;
     char *buf;
     int buflen;
+    int putv;           /* server supports mcmd=putv */
+    char *putv_buf;     /* pending puts, not yet sent */
+    int putv_len;
+    int putv_size;
+    int putv_pending;   /* putv results not yet read */
 };
 
 static int pmi_simple_client_init (void *impl, int *spawned)
@@ -75,6 +80,8 @@ static int pmi_simple_client_init (void *impl, int *spawned)
             || keyval_parse_uint (buf, "keylen_max", &pmi->keylen_max) < 0
             || keyval_parse_uint (buf, "vallen_max", &pmi->vallen_max) < 0)
         goto done;
+    if (keyval_parse_uint (buf, "putv", &vers) == 0 && vers == 1)
+        pmi->putv = 1;
     pmi->buflen = pmi->keylen_max + pmi->vallen_max + pmi->kvsname_max
                                   + SIMPLE_MAX_PROTO_OVERHEAD;
     if (!(pmi->buf = calloc (1, pmi->buflen))) {
@@ -96,12 +103,92 @@ static int pmi_simple_client_initialized (void *impl, int *initialized)
     return PMI_SUCCESS;
 }
 
+/* Append a put to the pending batch.
+ * Lengths are checked here so errors are reported by put as before.
+ */
+static int putv_append (struct pmi_simple_client *pmi, const char *kvsname,
+                        const char *key, const char *value)
+{
+    int len;
+
+    if (strlen (kvsname) >= pmi->kvsname_max)
+        return PMI_ERR_INVALID_LENGTH;
+    if (strlen (key) >= pmi->keylen_max)
+        return PMI_ERR_INVALID_KEY_LENGTH;
+    if (strlen (value) >= pmi->vallen_max)
+        return PMI_ERR_INVALID_VAL_LENGTH;
+    len = snprintf (pmi->buf, pmi->buflen, "kvsname=%s key=%s value=%s\n",
+                    kvsname, key, value);
+    if (len >= pmi->buflen)
+        return PMI_ERR_INVALID_LENGTH;
+    if (pmi->putv_len + len + 1 > pmi->putv_size) {
+        int size = MAX (pmi->putv_size * 2, pmi->putv_len + len + 1);
+        char *new;
+        if (!(new = realloc (pmi->putv_buf, size)))
+            return PMI_ERR_NOMEM;
+        pmi->putv_buf = new;
+        pmi->putv_size = size;
+    }
+    memcpy (pmi->putv_buf + pmi->putv_len, pmi->buf, len + 1);
+    pmi->putv_len += len;
+    return PMI_SUCCESS;
+}
+
+/* Send pending puts as one mcmd=putv without waiting for the result,
+ * so that it may be pipelined with the next request.
+ */
+static int putv_send (struct pmi_simple_client *pmi)
+{
+    int len = pmi->putv_len;
+
+    if (len == 0)
+        return PMI_SUCCESS;
+    pmi->putv_len = 0;
+    if (dprintf (pmi->fd, "mcmd=putv\n%sendcmd\n", pmi->putv_buf) < 0)
+        return PMI_FAIL;
+    pmi->putv_pending++;
+    return PMI_SUCCESS;
+}
+
+/* Read results of sent putv commands, returning the first failure.
+ * Any request that reads a response must call this first.
+ */
+static int putv_wait (struct pmi_simple_client *pmi)
+{
+    int result = PMI_SUCCESS;
+    int rc;
+
+    while (pmi->putv_pending > 0) {
+        pmi->putv_pending--;
+        if (dgetline (pmi->fd, pmi->buf, pmi->buflen) < 0
+            || keyval_parse_isword (pmi->buf, "cmd", "putv_result") < 0)
+            return PMI_FAIL;
+        if (keyval_parse_int (pmi->buf, "rc", &rc) == 0 && rc != 0
+                                                && result == PMI_SUCCESS)
+            result = rc;
+    }
+    return result;
+}
+
+static int putv_flush (struct pmi_simple_client *pmi)
+{
+    int rc;
+
+    if ((rc = putv_send (pmi)) != PMI_SUCCESS)
+        return rc;
+    return putv_wait (pmi);
+}
+
 static int pmi_simple_client_finalize (void *impl)
 {
     struct pmi_simple_client *pmi = impl;
     int result = PMI_FAIL;
     int rc;
 
+    if ((rc = putv_flush (pmi)) != PMI_SUCCESS) {
+        result = rc;
+        goto done;
+    }
     if (dprintf (pmi->fd, "cmd=finalize\n") < 0)
         goto done;
     if (dgetline (pmi->fd, pmi->buf, pmi->buflen) < 0)
@@ -143,6 +230,10 @@ static int pmi_simple_client_get_appnum (void *impl, int *appnum)
 
     if (!pmi->initialized)
         goto done;
+    if ((rc = putv_wait (pmi)) != PMI_SUCCESS) {
+        result = rc;
+        goto done;
+    }
     if (dprintf (pmi->fd, "cmd=get_appnum\n") < 0)
         goto done;
     if (dgetline (pmi->fd, pmi->buf, pmi->buflen) < 0)
@@ -168,6 +259,10 @@ static int pmi_simple_client_get_universe_size (void *impl, int *universe_size)
 
     if (!pmi->initialized)
         goto done;
+    if ((rc = putv_wait (pmi)) != PMI_SUCCESS) {
+        result = rc;
+        goto done;
+    }
     if (dprintf (pmi->fd, "cmd=get_universe_size\n") < 0)
         goto done;
     if (dgetline (pmi->fd, pmi->buf, pmi->buflen) < 0)
@@ -204,16 +299,24 @@ static int pmi_simple_client_lookup_name (void *impl,
     return PMI_FAIL;
 }
 
+/* Pending puts are sent ahead of barrier_in without waiting.
+ * If the puts fail, the barrier response must still be consumed.
+ */
 static int pmi_simple_client_barrier (void *impl)
 {
     struct pmi_simple_client *pmi = impl;
     int result = PMI_FAIL;
+    int putv_result;
     int rc;
 
     if (!pmi->initialized)
         goto done;
+    if (putv_send (pmi) != PMI_SUCCESS)
+        goto done;
     if (dprintf (pmi->fd, "cmd=barrier_in\n") < 0)
         goto done;
+    if ((putv_result = putv_wait (pmi)) == PMI_FAIL)
+        goto done;
     if (dgetline (pmi->fd, pmi->buf, pmi->buflen) < 0)
         goto done;
     if (keyval_parse_isword (pmi->buf, "cmd", "barrier_out") < 0)
@@ -222,7 +325,7 @@ static int pmi_simple_client_barrier (void *impl)
         result = rc;
         goto done;
     }
-    result = PMI_SUCCESS;
+    result = putv_result;
 done:
     return result;
 }
@@ -245,6 +348,10 @@ static int pmi_simple_client_kvs_get_my_name (void *impl,
 
     if (!pmi->initialized)
         goto done;
+    if ((rc = putv_wait (pmi)) != PMI_SUCCESS) {
+        result = rc;
+        goto done;
+    }
     if (dprintf (pmi->fd, "cmd=get_my_kvsname\n") < 0)
         goto done;
     if (dgetline (pmi->fd, pmi->buf, pmi->buflen) < 0)
@@ -299,6 +406,10 @@ static int pmi_simple_client_kvs_put (void *impl,
 
     if (!pmi->initialized)
         goto done;
+    if (pmi->putv) {
+        result = putv_append (pmi, kvsname, key, value);
+        goto done;
+    }
     if (dprintf (pmi->fd, "cmd=put kvsname=%s key=%s value=%s\n",
                  kvsname, key, value) < 0)
         goto done;
@@ -315,9 +426,14 @@ done:
     return result;
 }
 
+/* Send batched puts, but leave the result to be read by the next
+ * request so that put, commit, barrier still costs one round trip.
+ */
 static int pmi_simple_client_kvs_commit (void *impl, const char *kvsname)
 {
-    return PMI_SUCCESS; /* a no-op here */
+    struct pmi_simple_client *pmi = impl;
+
+    return putv_send (pmi);
 }
 
 static int pmi_simple_client_kvs_get (void *impl,
@@ -330,6 +446,10 @@ static int pmi_simple_client_kvs_get (void *impl,
 
     if (!pmi->initialized)
         goto done;
+    if ((rc = putv_flush (pmi)) != PMI_SUCCESS) {
+        result = rc;
+        goto done;
+    }
     if (dprintf (pmi->fd, "cmd=get kvsname=%s key=%s\n", kvsname, key) < 0)
         goto done;
     if (dgetline (pmi->fd, pmi->buf, pmi->buflen) < 0)
@@ -369,6 +489,7 @@ static void pmi_simple_client_destroy (void *impl)
             (void)close (pmi->fd);
         if (pmi->buf)
             free (pmi->buf);
+        free (pmi->putv_buf);
         free (pmi);
     }
 }
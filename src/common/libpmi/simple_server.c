@@ -124,6 +124,62 @@ static void client_destroy (void *arg)
     }
 }
 
+/* Parse and store one kvs put, returning a PMI result code
+ * (PMI_SUCCESS on success), or -1 with errno = EPROTO on protocol error.
+ */
+static int kvs_put (struct pmi_simple_server *pmi, const char *buf)
+{
+    char name[SIMPLE_KVS_NAME_MAX];
+    char key[SIMPLE_KVS_KEY_MAX];
+    char val[SIMPLE_KVS_VAL_MAX];
+    int result;
+
+    if ((result = keyval_parse_word (buf, "kvsname", name,
+                                     sizeof (name))) < 0) {
+        if (result == EKV_VAL_LEN)
+            return PMI_ERR_INVALID_LENGTH;
+        goto proto;
+    }
+    if ((result = keyval_parse_word (buf, "key", key, sizeof (key))) < 0) {
+        if (result == EKV_VAL_LEN)
+            return PMI_ERR_INVALID_KEY_LENGTH;
+        goto proto;
+    }
+    if ((result = keyval_parse_string (buf, "value", val, sizeof (val))) < 0) {
+        if (result == EKV_VAL_LEN)
+            return PMI_ERR_INVALID_VAL_LENGTH;
+        goto proto;
+    }
+    if (pmi->ops.kvs_put (pmi->arg, name, key, val) < 0)
+        return PMI_ERR_INVALID_KEY;
+    return PMI_SUCCESS;
+proto:
+    errno = EPROTO;
+    return -1;
+}
+
+/* Execute a batch of puts (flux extension advertised in get_maxes).
+ * Each line between mcmd=putv and endcmd is formatted like a put request.
+ * All puts are attempted;  the result is that of the first failure.
+ */
+static int putv_execute (struct pmi_simple_server *pmi, struct client *c,
+                         int *result)
+{
+    char *buf;
+    int rc;
+
+    *result = PMI_SUCCESS;
+    buf = zlist_next (c->mcmd);
+    while (buf && strcmp (buf, "endcmd\n") != 0) {
+        if ((rc = kvs_put (pmi, buf)) < 0)
+            return -1;
+        if (rc != PMI_SUCCESS && *result == PMI_SUCCESS)
+            *result = rc;
+        buf = zlist_next (c->mcmd);
+    }
+    return 0;
+}
+
 static int mcmd_execute (struct pmi_simple_server *pmi, void *client,
                          struct client *c)
 {
@@ -136,6 +192,12 @@ static int mcmd_execute (struct pmi_simple_server *pmi, void *client,
         /* FIXME - spawn not implemented */
         snprintf (resp, sizeof (resp), "cmd=spawn_result rc=-1\n");
     }
+    else if (keyval_parse_isword (buf, "mcmd", "putv") == 0) {
+        int result;
+        if (putv_execute (pmi, c, &result) < 0)
+            return -1;
+        snprintf (resp, sizeof (resp), "cmd=putv_result rc=%d\n", result);
+    }
     /* unknown mcmd */
     else {
         errno = EPROTO;
@@ -285,7 +347,7 @@ int pmi_simple_server_request (struct pmi_simple_server *pmi,
     /* maxes */
     else if (keyval_parse_isword (buf, "cmd", "get_maxes") == 0) {
         snprintf (resp, sizeof (resp), "cmd=maxes rc=0 "
-                  "kvsname_max=%d keylen_max=%d vallen_max=%d\n",
+                  "kvsname_max=%d keylen_max=%d vallen_max=%d putv=1\n",
                   SIMPLE_KVS_NAME_MAX, SIMPLE_KVS_KEY_MAX, SIMPLE_KVS_VAL_MAX);
     }
     /* abort */
@@ -315,36 +377,9 @@ int pmi_simple_server_request (struct pmi_simple_server *pmi,
     }
     /* put */
     else if (keyval_parse_isword (buf, "cmd", "put") == 0) {
-        char name[SIMPLE_KVS_NAME_MAX];
-        char key[SIMPLE_KVS_KEY_MAX];
-        char val[SIMPLE_KVS_VAL_MAX];
-        int result = keyval_parse_word (buf, "kvsname", name, sizeof (name));
-        if (result < 0) {
-            if (result == EKV_VAL_LEN) {
-                result = PMI_ERR_INVALID_LENGTH;
-                goto put_respond;
-            }
-            goto proto;
-        }
-        result = keyval_parse_word (buf, "key", key, sizeof (key));
-        if (result < 0) {
-            if (result == EKV_VAL_LEN) {
-                result = PMI_ERR_INVALID_KEY_LENGTH;
-                goto put_respond;
-            }
-            goto proto;
-        }
-        result = keyval_parse_string (buf, "value", val, sizeof (val));
-        if (result < 0) {
-            if (result == EKV_VAL_LEN) {
-                result = PMI_ERR_INVALID_VAL_LENGTH;
-                goto put_respond;
-            }
-            goto proto;
-        }
-        if (pmi->ops.kvs_put (pmi->arg, name, key, val) < 0)
-            result = PMI_ERR_INVALID_KEY;
-put_respond:
+        int result = kvs_put (pmi, buf);
+        if (result < 0)
+            return -1;
         snprintf (resp, sizeof (resp), "cmd=put_result rc=%d\n", result);
     }
     /* get */
@@ -409,6 +444,10 @@ get_respond:
     else if (keyval_parse_isword (buf, "mcmd", "spawn") == 0) {
         rc = mcmd_begin (pmi, client, buf);
     }
+    /* putv */
+    else if (keyval_parse_isword (buf, "mcmd", "putv") == 0) {
+        rc = mcmd_begin (pmi, client, buf);
+    }
     /* unknown command */
     else
         goto proto;
@@ -54,6 +54,10 @@ void pmi_simple_server_destroy (struct pmi_simple_server *pmi);
 
 /* Put null-terminated request with sending client reference to protocol
  * engine.  The request should end with a newline.
+ * In addition to PMI-1 commands, the engine accepts "mcmd=putv", a batch
+ * of put lines terminated by "endcmd", advertised as putv=1 in the
+ * get_maxes response.  Clients may send it ahead of barrier_in so that
+ * a kvs fence costs one round trip.
  * Returns 1 indicating finalized / close fd, 0 on success, -1 on failure.
  */
 int pmi_simple_server_request (struct pmi_simple_server *pmi,
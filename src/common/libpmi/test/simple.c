@@ -16,6 +16,7 @@
 #include "src/common/libutil/oom.h"
 #include "src/common/libutil/xzmalloc.h"
 #include "src/common/libutil/setenvf.h"
+#include "src/common/libutil/monotime.h"
 #include "src/common/libpmi/simple_server.h"
 #include "src/common/libpmi/simple_client.h"
 #include "src/common/libpmi/dgetline.h"
@@ -126,6 +127,186 @@ done:
     return NULL;
 }
 
+/* Scaling benchmark: 'size' clients, each in its own thread, perform
+ * the broker bootstrap exchange against one server:  put own URI,
+ * barrier, get parent URI (k=2 tree), barrier, finalize.
+ */
+struct bench;
+
+struct bench_client {
+    struct bench *b;
+    int fds[2];
+    int rank;
+    pthread_t t;
+    void *cli;
+    struct pmi_operations *ops;
+    int rc;
+};
+
+struct bench {
+    zhash_t *kvs;
+    struct pmi_simple_server *pmi;
+    int size;
+    struct bench_client *clients;
+    char buf[SIMPLE_MAX_PROTO_LINE];
+};
+
+static int b_kvs_put (void *arg, const char *kvsname, const char *key,
+                      const char *val)
+{
+    struct bench *b = arg;
+    zhash_update (b->kvs, key, xstrdup (val));
+    zhash_freefn (b->kvs, key, (zhash_free_fn *)free);
+    return 0;
+}
+
+static int b_kvs_get (void *arg, void *client,
+                      const char *kvsname, const char *key)
+{
+    struct bench *b = arg;
+    return pmi_simple_server_kvs_get_complete (b->pmi, client,
+                                               zhash_lookup (b->kvs, key));
+}
+
+static int b_send_response (void *client, const char *buf)
+{
+    struct bench_client *bc = client;
+    return dputline (bc->fds[1], buf);
+}
+
+static void b_io_cb (flux_reactor_t *r, flux_watcher_t *w,
+                     int revents, void *arg)
+{
+    struct bench_client *bc = arg;
+    struct bench *b = bc->b;
+    int rc;
+
+    if (dgetline (bc->fds[1], b->buf, sizeof (b->buf)) < 0
+        || (rc = pmi_simple_server_request (b->pmi, b->buf, bc)) < 0) {
+        flux_reactor_stop_error (r);
+        return;
+    }
+    if (rc == 1)
+        flux_watcher_stop (w);
+}
+
+static void *bench_server_thread (void *arg)
+{
+    struct bench *b = arg;
+    flux_reactor_t *r;
+    flux_watcher_t **w;
+    int i;
+
+    if (!(r = flux_reactor_create (0)))
+        BAIL_OUT ("flux_reactor_create failed");
+    w = xzmalloc (sizeof (w[0]) * b->size);
+    for (i = 0; i < b->size; i++) {
+        if (!(w[i] = flux_fd_watcher_create (r, b->clients[i].fds[1],
+                                             FLUX_POLLIN, b_io_cb,
+                                             &b->clients[i])))
+            BAIL_OUT ("flux_fd_watcher_create failed");
+        flux_watcher_start (w[i]);
+    }
+    if (flux_reactor_run (r, 0) < 0)
+        diag ("bench server reactor: %s", strerror (errno));
+    for (i = 0; i < b->size; i++)
+        flux_watcher_destroy (w[i]);
+    free (w);
+    flux_reactor_destroy (r);
+    return NULL;
+}
+
+static void *bench_client_thread (void *arg)
+{
+    struct bench_client *bc = arg;
+    struct pmi_operations *ops = bc->ops;
+    char name[SIMPLE_KVS_NAME_MAX];
+    char key[SIMPLE_KVS_KEY_MAX];
+    char val[SIMPLE_KVS_VAL_MAX];
+
+    bc->rc = -1;
+    if (ops->init (bc->cli, NULL) != PMI_SUCCESS
+        || ops->kvs_get_my_name (bc->cli, name, sizeof (name)) != PMI_SUCCESS)
+        return NULL;
+    snprintf (key, sizeof (key), "cmbd.%d.uri", bc->rank);
+    snprintf (val, sizeof (val), "ipc:///tmp/bench/%d", bc->rank);
+    if (ops->kvs_put (bc->cli, name, key, val) != PMI_SUCCESS
+        || ops->kvs_commit (bc->cli, name) != PMI_SUCCESS
+        || ops->barrier (bc->cli) != PMI_SUCCESS)
+        return NULL;
+    if (bc->rank > 0) {
+        snprintf (key, sizeof (key), "cmbd.%d.uri", (bc->rank - 1) / 2);
+        if (ops->kvs_get (bc->cli, name, key, val, sizeof (val))
+                                                        != PMI_SUCCESS)
+            return NULL;
+    }
+    if (ops->barrier (bc->cli) != PMI_SUCCESS
+        || ops->finalize (bc->cli) != PMI_SUCCESS)
+        return NULL;
+    bc->rc = 0;
+    return NULL;
+}
+
+void bench_bootstrap (int size)
+{
+    struct pmi_simple_ops ops = {
+        .kvs_put = b_kvs_put,
+        .kvs_get = b_kvs_get,
+        .response_send = b_send_response,
+    };
+    struct bench b;
+    pthread_t t;
+    struct timespec t0;
+    int errors = 0;
+    int i;
+
+    memset (&b, 0, sizeof (b));
+    b.size = size;
+    if (!(b.kvs = zhash_new ()))
+        oom ();
+    if (!(b.pmi = pmi_simple_server_create (ops, 42, size, size,
+                                            "bench", 0, &b)))
+        BAIL_OUT ("pmi_simple_server_create failed");
+    b.clients = xzmalloc (sizeof (b.clients[0]) * size);
+    for (i = 0; i < size; i++) {
+        struct bench_client *bc = &b.clients[i];
+        if (socketpair (PF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC, 0, bc->fds) < 0)
+            BAIL_OUT ("socketpair failed");
+        bc->b = &b;
+        bc->rank = i;
+        setenvf ("PMI_FD", 1, "%d", bc->fds[0]);
+        setenvf ("PMI_RANK", 1, "%d", i);
+        setenvf ("PMI_SIZE", 1, "%d", size);
+        if (!(bc->cli = pmi_simple_client_create (&bc->ops)))
+            BAIL_OUT ("pmi_simple_client_create failed");
+    }
+    monotime (&t0);
+    if (pthread_create (&t, NULL, bench_server_thread, &b) != 0)
+        BAIL_OUT ("pthread_create failed");
+    for (i = 0; i < size; i++) {
+        if (pthread_create (&b.clients[i].t, NULL, bench_client_thread,
+                            &b.clients[i]) != 0)
+            BAIL_OUT ("pthread_create failed");
+    }
+    for (i = 0; i < size; i++) {
+        pthread_join (b.clients[i].t, NULL);
+        if (b.clients[i].rc < 0)
+            errors++;
+    }
+    pthread_join (t, NULL);
+    ok (errors == 0 && zhash_size (b.kvs) == size,
+        "bootstrap exchange with %d clients works", size);
+    diag ("size=%d: %.3f ms", size, monotime_since (t0));
+
+    for (i = 0; i < size; i++) {
+        b.clients[i].ops->destroy (b.clients[i].cli);
+        close (b.clients[i].fds[1]);
+    }
+    free (b.clients);
+    pmi_simple_server_destroy (b.pmi);
+    zhash_destroy (&b.kvs);
+}
+
 int main (int argc, char *argv[])
 {
     struct context ctx;
@@ -305,6 +486,17 @@ int main (int argc, char *argv[])
     close (ctx.fds[1]);
     zhash_destroy (&ctx.kvs);
 
+    /* Run with a size argument, e.g. test_simple.t 1000, to benchmark
+     * a larger instance.  Mind the open file limit.
+     */
+    if (argc > 1)
+        bench_bootstrap (strtol (argv[1], NULL, 10));
+    else {
+        bench_bootstrap (1);
+        bench_bootstrap (16);
+        bench_bootstrap (128);
+    }
+
     done_testing ();
     return 0;
 }
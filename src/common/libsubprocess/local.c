@@ -13,9 +13,16 @@
 #endif
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <wait.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <limits.h>
 
 #include <czmq.h>
 
@@ -31,7 +38,7 @@
 #include "local.h"
 #include "util.h"
 
-static void local_channel_flush (struct subprocess_channel *c)
+void local_channel_flush (struct subprocess_channel *c)
 {
     /* This is a full channel with read and write, a close on the
      * write side needs to "generate" an EOF on the read side
@@ -48,8 +55,14 @@ static void local_channel_flush (struct subprocess_channel *c)
             return;
         }
 
-        while ((len = flux_buffer_bytes (fb)) > 0)
+        c->flush_pending = false;
+        while ((len = flux_buffer_bytes (fb)) > 0) {
             c->output_f (c->p, c->name);
+            if (flux_buffer_bytes (fb) == len) {
+                c->flush_pending = true;
+                return;
+            }
+        }
 
         /* eof call */
         c->output_f (c->p, c->name);
@@ -586,6 +599,22 @@ static void child_watch_cb (flux_reactor_t *r, flux_watcher_t *w,
         subprocess_check_completed (p);
 }
 
+static int local_start_child_watcher (flux_subprocess_t *p)
+{
+    /* no-op if reactor is !FLUX_REACTOR_SIGCHLD */
+    if (!(p->child_w = flux_child_watcher_create (p->reactor,
+                                                  p->pid,
+                                                  true,
+                                                  child_watch_cb,
+                                                  p))) {
+        flux_log_error (p->h, "flux_child_watcher_create");
+        return -1;
+    }
+
+    flux_watcher_start (p->child_w);
+    return 0;
+}
+
 static int local_fork (flux_subprocess_t *p)
 {
     if ((p->pid = fork ()) < 0)
@@ -598,17 +627,8 @@ static int local_fork (flux_subprocess_t *p)
 
     close_child_fds (p);
 
-    /* no-op if reactor is !FLUX_REACTOR_SIGCHLD */
-    if (!(p->child_w = flux_child_watcher_create (p->reactor,
-                                                  p->pid,
-                                                  true,
-                                                  child_watch_cb,
-                                                  p))) {
-        flux_log_error (p->h, "flux_child_watcher_create");
+    if (local_start_child_watcher (p) < 0)
         return -1;
-    }
-
-    flux_watcher_start (p->child_w);
 
     if (subprocess_parent_wait_on_child (p) < 0)
         return -1;
@@ -669,6 +689,367 @@ static int local_exec (flux_subprocess_t *p)
     return 0;
 }
 
+#ifdef HAVE_CLONE
+/*  Spawn via clone(CLONE_VM|CLONE_VFORK).
+ *
+ *  The child shares the parent's address space until exec(2), so there is
+ *  no page table copy and no overcommit charge, no matter how large the
+ *  parent is.  The parent is suspended until the child execs or exits.
+ *  Other threads of the parent are not, so the child may only make
+ *  async-signal-safe calls: everything that allocates (argv, environment,
+ *  PATH search, fd lists) is computed beforehand in the parent, and exec
+ *  failure is reported by writing errno to shared memory.
+ */
+
+#define SPAWN_STACK_SIZE (64*1024)
+
+struct spawn_ctx {
+    const char *path;           /* resolved executable */
+    char **argv;
+    char **sh_argv;             /* for ENOEXEC: /bin/sh path argv[1]... */
+    char **envp;
+    const char *cwd;
+    int stdio[3];               /* fd to dup2 onto 0-2, -1 leave, -2 close */
+    int *keep;                  /* sorted channel fds to keep across exec */
+    int keep_count;
+    bool setpgrp;
+    volatile int errnum;        /* set by child on failure */
+};
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/*  Parse a decimal fd from a /proc/self/fd entry, or return -1.
+ *   (strtol(3) is not guaranteed to be async-signal-safe.)
+ */
+static int spawn_parse_fd (const char *s)
+{
+    int fd = 0;
+
+    if (*s == '\0')
+        return -1;
+    for (; *s != '\0'; s++) {
+        if (*s < '0' || *s > '9')
+            return -1;
+        fd = fd * 10 + (*s - '0');
+    }
+    return fd;
+}
+
+static bool spawn_keep_fd (struct spawn_ctx *s, int fd)
+{
+    int i;
+    for (i = 0; i < s->keep_count; i++)
+        if (s->keep[i] == fd)
+            return true;
+    return false;
+}
+
+/*  Close fds >= 3 not in s->keep by walking /proc/self/fd with
+ *   getdents64(2) into a stack buffer (opendir(3) would allocate).
+ *   Closing while reading may cause entries to be skipped, so repeat
+ *   until a pass closes nothing.
+ */
+static int spawn_close_fds_walk (struct spawn_ctx *s)
+{
+    char buf[1024];
+    int closed;
+
+    do {
+        int dirfd;
+        long n;
+
+        if ((dirfd = open ("/proc/self/fd",
+                           O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+            return -1;
+        closed = 0;
+        while ((n = syscall (SYS_getdents64, dirfd, buf, sizeof (buf))) > 0) {
+            long off = 0;
+            while (off < n) {
+                struct linux_dirent64 *d = (void *)(buf + off);
+                int fd = spawn_parse_fd (d->d_name);
+
+                if (fd >= 3 && fd != dirfd && !spawn_keep_fd (s, fd)) {
+                    close (fd);
+                    closed++;
+                }
+                off += d->d_reclen;
+            }
+        }
+        close (dirfd);
+        if (n < 0)
+            return -1;
+    } while (closed > 0);
+    return 0;
+}
+
+/*  Close fds >= 3 not in s->keep with close_range(2) over the gaps
+ *   between kept fds, or fall back to walking /proc/self/fd.
+ */
+static int spawn_close_fds (struct spawn_ctx *s)
+{
+#ifdef SYS_close_range
+    unsigned int lo = 3;
+    int i;
+
+    for (i = 0; i < s->keep_count; i++) {
+        unsigned int fd = s->keep[i];
+        if (fd < lo)
+            continue;
+        if (fd > lo && syscall (SYS_close_range, lo, fd - 1, 0) < 0)
+            goto walk;
+        lo = fd + 1;
+    }
+    if (syscall (SYS_close_range, lo, ~0U, 0) < 0)
+        goto walk;
+    return 0;
+walk:
+#endif
+    return spawn_close_fds_walk (s);
+}
+
+static int spawn_child (void *arg)
+{
+    struct spawn_ctx *s = arg;
+    struct sigaction sa;
+    sigset_t mask;
+    int i;
+
+    /*  All signals were blocked by the parent before clone().  Reset
+     *   caught signals to default before unblocking so that no parent
+     *   handler can run on the shared address space.
+     */
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_handler = SIG_DFL;
+    for (i = 1; i < NSIG; i++) {
+        struct sigaction old;
+        if (sigaction (i, NULL, &old) == 0
+            && old.sa_handler != SIG_IGN
+            && old.sa_handler != SIG_DFL)
+            (void) sigaction (i, &sa, NULL);
+    }
+
+    for (i = 0; i < 3; i++) {
+        if (s->stdio[i] == -2)
+            close (i);
+        else if (s->stdio[i] >= 0 && dup2 (s->stdio[i], i) < 0)
+            goto fail;
+    }
+    if (s->cwd && chdir (s->cwd) < 0 && chdir ("/tmp") < 0)
+        goto fail;
+    for (i = 0; i < s->keep_count; i++) {
+        int flags = fcntl (s->keep[i], F_GETFD);
+        if (flags < 0 || fcntl (s->keep[i], F_SETFD, flags & ~FD_CLOEXEC) < 0)
+            goto fail;
+    }
+    if (spawn_close_fds (s) < 0)
+        goto fail;
+    if (s->setpgrp && setpgrp () < 0)
+        goto fail;
+
+    sigemptyset (&mask);
+    sigprocmask (SIG_SETMASK, &mask, NULL);
+
+    execve (s->path, s->argv, s->envp);
+    if (errno == ENOEXEC)
+        execve (s->sh_argv[0], s->sh_argv, s->envp);
+fail:
+    s->errnum = errno;
+    _exit (127);
+}
+
+/*  Search PATH from the command's environment as execvp(3) would.
+ *   If no executable is found, fail with EACCES if a matching file
+ *   was found that could not be executed, otherwise ENOENT.
+ */
+static char *spawn_resolve_path (flux_subprocess_t *p, const char *file)
+{
+    const char *path;
+    const char *dir;
+    bool denied = false;
+
+    if (strchr (file, '/'))
+        return strdup (file);
+    if (!(path = flux_cmd_getenv (p->cmd, "PATH")))
+        path = "/bin:/usr/bin";
+    dir = path;
+    while (dir) {
+        const char *end = strchr (dir, ':');
+        int len = end ? end - dir : strlen (dir);
+        char candidate[PATH_MAX];
+        struct stat sb;
+        int n;
+
+        if (len == 0)
+            n = snprintf (candidate, sizeof (candidate), "%s", file);
+        else
+            n = snprintf (candidate, sizeof (candidate), "%.*s/%s",
+                          len, dir, file);
+        if (n >= 0 && n < (int)sizeof (candidate)
+            && stat (candidate, &sb) == 0) {
+            if (S_ISREG (sb.st_mode) && access (candidate, X_OK) == 0)
+                return strdup (candidate);
+            denied = true;
+        }
+        dir = end ? end + 1 : NULL;
+    }
+    errno = denied ? EACCES : ENOENT;
+    return NULL;
+}
+
+static int intcmp (const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static int spawn_ctx_init (flux_subprocess_t *p, struct spawn_ctx *s)
+{
+    struct subprocess_channel *c;
+    const char *stdio_names[] = { "STDIN", "STDOUT", "STDERR" };
+    int argc;
+    int i;
+
+    memset (s, 0, sizeof (*s));
+    if (!(s->argv = flux_cmd_argv_expand (p->cmd))
+        || !(s->envp = flux_cmd_env_expand (p->cmd)))
+        return -1;
+    /* report a failed PATH search as exec(2) failure, as execvp(3) would */
+    if (!(s->path = spawn_resolve_path (p, s->argv[0]))) {
+        p->exec_failed_errno = errno;
+        return -1;
+    }
+
+    /* as execvp(3), run files lacking a #! line with /bin/sh */
+    argc = flux_cmd_argc (p->cmd);
+    if (!(s->sh_argv = calloc (argc + 2, sizeof (char *))))
+        return -1;
+    s->sh_argv[0] = "/bin/sh";
+    s->sh_argv[1] = (char *)s->path;
+    for (i = 1; i < argc; i++)
+        s->sh_argv[i + 1] = s->argv[i];
+
+    s->cwd = flux_cmd_getcwd (p->cmd);
+    s->setpgrp = (p->flags & FLUX_SUBPROCESS_FLAGS_SETPGRP) ? true : false;
+
+    for (i = 0; i < 3; i++) {
+        s->stdio[i] = -1;
+        if (p->flags & FLUX_SUBPROCESS_FLAGS_STDIO_FALLTHROUGH)
+            continue;
+        if ((c = zhash_lookup (p->channels, stdio_names[i])))
+            s->stdio[i] = c->child_fd;
+        else if (i > 0)
+            s->stdio[i] = -2;
+    }
+
+    if (!(s->keep = calloc (zhash_size (p->channels) + 1, sizeof (int))))
+        return -1;
+    c = zhash_first (p->channels);
+    while (c) {
+        if ((c->flags & CHANNEL_FD) && c->child_fd >= 3)
+            s->keep[s->keep_count++] = c->child_fd;
+        c = zhash_next (p->channels);
+    }
+    qsort (s->keep, s->keep_count, sizeof (int), intcmp);
+    return 0;
+}
+
+static void spawn_ctx_cleanup (struct spawn_ctx *s)
+{
+    int saved_errno = errno;
+    free (s->argv);
+    free (s->envp);
+    free ((char *)s->path);
+    free (s->sh_argv);
+    free (s->keep);
+    errno = saved_errno;
+}
+
+static int local_spawn (flux_subprocess_t *p)
+{
+    struct spawn_ctx s;
+    sigset_t all, saved;
+    void *stack = MAP_FAILED;
+    int rc = -1;
+
+    if (spawn_ctx_init (p, &s) < 0) {
+        if (!p->exec_failed_errno)
+            flux_log_error (p->h, "local_spawn");
+        goto out;
+    }
+    if ((stack = mmap (NULL, SPAWN_STACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                       -1, 0)) == MAP_FAILED)
+        goto out;
+
+    sigfillset (&all);
+    sigprocmask (SIG_SETMASK, &all, &saved);
+    p->pid = clone (spawn_child, (char *)stack + SPAWN_STACK_SIZE,
+                    CLONE_VM | CLONE_VFORK | SIGCHLD, &s);
+    if (p->pid > 0 && s.errnum != 0) {
+        /*  Reap immediately, before SIGCHLD is unblocked.  Expectation
+         *   from caller is that failure to exec will not require
+         *   subsequent reaping of child.
+         */
+        int status;
+        if (waitpid (p->pid, &status, 0) == p->pid)
+            p->status = status;
+    }
+    sigprocmask (SIG_SETMASK, &saved, NULL);
+
+    if (p->pid < 0)
+        goto out;
+    if (s.errnum != 0) {
+        p->exec_failed_errno = s.errnum;
+        errno = s.errnum;
+        goto out;
+    }
+
+    p->pid_set = true;
+    close_child_fds (p);
+    close_pair_fds (p->sync_fds);
+    init_pair_fds (p->sync_fds);
+
+    if (local_start_child_watcher (p) < 0)
+        goto out;
+
+    /* STARTED is implied, the child has already exec'd */
+    p->state = FLUX_SUBPROCESS_RUNNING;
+    rc = 0;
+out:
+    if (stack != MAP_FAILED)
+        (void) munmap (stack, SPAWN_STACK_SIZE);
+    spawn_ctx_cleanup (&s);
+    return rc;
+}
+#endif /* HAVE_CLONE */
+
+/*  Use fork(2) unless spawn is available and the caller did not ask
+ *   for fork via the SPAWN_METHOD command option.
+ */
+static int local_use_fork (flux_subprocess_t *p, bool *use_fork)
+{
+    const char *method = flux_cmd_getopt (p->cmd, "SPAWN_METHOD");
+
+    if (method && strcmp (method, "fork") != 0
+                && strcmp (method, "vfork") != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+#ifdef HAVE_CLONE
+    *use_fork = (method && !strcmp (method, "fork"));
+#else
+    *use_fork = true;
+#endif
+    return 0;
+}
+
 static void start_local_watchers (flux_subprocess_t *p)
 {
     struct subprocess_channel *c;
@@ -683,14 +1064,24 @@ static void start_local_watchers (flux_subprocess_t *p)
 
 int subprocess_local_setup (flux_subprocess_t *p)
 {
+    bool use_fork;
+
     if (local_setup_stdio (p) < 0)
         return -1;
     if (local_setup_channels (p) < 0)
         return -1;
-    if (local_fork (p) < 0)
+    if (local_use_fork (p, &use_fork) < 0)
         return -1;
-    if (local_exec (p) < 0)
+    if (use_fork) {
+        if (local_fork (p) < 0)
+            return -1;
+        if (local_exec (p) < 0)
+            return -1;
+    }
+#ifdef HAVE_CLONE
+    else if (local_spawn (p) < 0)
         return -1;
+#endif
     start_local_watchers (p);
     return 0;
 }
@@ -13,6 +13,16 @@
 
 #include "subprocess.h"
 
+struct subprocess_channel;
+
 int subprocess_local_setup (flux_subprocess_t *p);
 
+/* Pass remaining buffered output of a channel whose parent fd has been
+ * closed to its output callback, then EOF.  If the callback leaves the
+ * output unread, e.g. while the remote client has no credit, the flush
+ * stops with c->flush_pending set, and must be called again once the
+ * callback can make progress.
+ */
+void local_channel_flush (struct subprocess_channel *c);
+
 #endif /* !_SUBPROCESS_LOCAL_H */
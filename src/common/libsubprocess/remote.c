@@ -254,6 +254,34 @@ static void remote_out_prep_cb (flux_reactor_t *r,
         flux_watcher_start (c->out_idle_w);
 }
 
+/* Return credit to the server for output consumed from the read
+ * buffer, once at least half the buffer has been consumed.
+ */
+static int remote_credit (struct subprocess_channel *c)
+{
+    flux_future_t *f;
+    int window = flux_buffer_size (c->read_buffer);
+    int n = window - c->read_credit - flux_buffer_bytes (c->read_buffer);
+
+    if (n <= 0 || n < window / 2)
+        return 0;
+
+    if (!(f = flux_rpc_pack (c->p->h, "cmb.rexec.credit", c->p->rank,
+                             FLUX_RPC_NORESPONSE,
+                             "{ s:i s:s s:i }",
+                             "pid", c->p->pid,
+                             "stream", c->name,
+                             "credit", n))) {
+        flux_log_error (c->p->h, "flux_rpc_pack");
+        return -1;
+    }
+    c->read_credit += n;
+
+    /* no response */
+    flux_future_destroy (f);
+    return 0;
+}
+
 static void remote_out_check_cb (flux_reactor_t *r,
                                  flux_watcher_t *w,
                                  int revents,
@@ -267,6 +295,9 @@ static void remote_out_check_cb (flux_reactor_t *r,
         c->output_f (c->p, c->name);
     }
 
+    if (!c->read_eof_received)
+        remote_credit (c);
+
     if (!flux_buffer_bytes (c->read_buffer)
         && c->read_eof_received
         && !c->eof_sent_to_caller) {
@@ -340,10 +371,14 @@ static int remote_channel_setup (flux_subprocess_t *p,
     }
 
     if (channel_flags & CHANNEL_READ) {
+        if (cmd_option_coalesce (p, name) < 0)
+            goto error;
+
         if (!(c->read_buffer = flux_buffer_create (buffer_size))) {
             flux_log_error (p->h, "flux_buffer_create");
             goto error;
         }
+        c->read_credit = buffer_size;
         p->channels_eof_expected++;
 
         if (!(c->out_prep_w = flux_prepare_watcher_create (p->reactor,
@@ -486,37 +521,67 @@ int subprocess_remote_setup (flux_subprocess_t *p)
     return 0;
 }
 
-static int remote_state (flux_subprocess_t *p, flux_future_t *f,
-                         int rank)
+/* Responses are JSON objects, except for output data, which is sent
+ * as a NUL terminated JSON header followed by the raw data.  Decode
+ * either kind, returning any data in 'data' and 'len'.
+ */
+static json_t *remote_response_decode (flux_future_t *f,
+                                       const char **data, int *len)
+{
+    const char *buf;
+    const char *end;
+    int size;
+    json_t *o;
+
+    if (flux_rpc_get_raw (f, (const void **)&buf, &size) < 0)
+        return NULL;
+    if (!buf || size == 0 || !(end = memchr (buf, '\0', size))) {
+        errno = EPROTO;
+        return NULL;
+    }
+    if (!(o = json_loadb (buf, end - buf, 0, NULL))) {
+        errno = EPROTO;
+        return NULL;
+    }
+    *data = end + 1;
+    *len = size - (end - buf) - 1;
+    return o;
+}
+
+static int remote_state (flux_subprocess_t *p, json_t *o, int rank)
 {
     flux_subprocess_state_t state;
     pid_t pid = -1;
     int errnum = 0;
     int status = 0;
 
-    if (flux_rpc_get_unpack (f, "{ s:i }", "state", &state) < 0) {
-        flux_log_error (p->h, "%s: flux_rpc_get_unpack", __FUNCTION__);
+    if (json_unpack (o, "{ s:i }", "state", &state) < 0) {
+        errno = EPROTO;
+        flux_log_error (p->h, "%s: json_unpack", __FUNCTION__);
         return -1;
     }
 
     if (state == FLUX_SUBPROCESS_STARTED) {
-        if (flux_rpc_get_unpack (f, "{ s:i }", "pid", &pid) < 0) {
-            flux_log_error (p->h, "%s: flux_rpc_get_unpack", __FUNCTION__);
+        if (json_unpack (o, "{ s:i }", "pid", &pid) < 0) {
+            errno = EPROTO;
+            flux_log_error (p->h, "%s: json_unpack", __FUNCTION__);
             return -1;
         }
     }
 
     if (state == FLUX_SUBPROCESS_EXEC_FAILED
         || state == FLUX_SUBPROCESS_FAILED) {
-        if (flux_rpc_get_unpack (f, "{ s:i }", "errno", &errnum) < 0) {
-            flux_log_error (p->h, "%s: flux_rpc_get_unpack", __FUNCTION__);
+        if (json_unpack (o, "{ s:i }", "errno", &errnum) < 0) {
+            errno = EPROTO;
+            flux_log_error (p->h, "%s: json_unpack", __FUNCTION__);
             return -1;
         }
     }
 
     if (state == FLUX_SUBPROCESS_EXITED) {
-        if (flux_rpc_get_unpack (f, "{ s:i }", "status", &status) < 0) {
-            flux_log_error (p->h, "%s: flux_rpc_get_unpack", __FUNCTION__);
+        if (json_unpack (o, "{ s:i }", "status", &status) < 0) {
+            errno = EPROTO;
+            flux_log_error (p->h, "%s: json_unpack", __FUNCTION__);
             return -1;
         }
     }
@@ -526,19 +591,19 @@ static int remote_state (flux_subprocess_t *p, flux_future_t *f,
     return 0;
 }
 
-static int remote_output (flux_subprocess_t *p, flux_future_t *f,
+static int remote_output (flux_subprocess_t *p, json_t *o,
+                          const char *data, int len,
                           int rank, pid_t pid)
 {
     struct subprocess_channel *c;
-    const char *s_data;
-    char *data = NULL;
-    size_t s_len, len, tmp;
     const char *stream;
+    int tmp;
     int eof;
     int rv = -1;
 
-    if (flux_rpc_get_unpack (f, "{ s:s }", "stream", &stream)) {
-        flux_log_error (p->h, "flux_rpc_get_unpack EPROTO stream");
+    if (json_unpack (o, "{ s:s }", "stream", &stream)) {
+        errno = EPROTO;
+        flux_log_error (p->h, "json_unpack EPROTO stream");
         goto cleanup;
     }
 
@@ -549,44 +614,28 @@ static int remote_output (flux_subprocess_t *p, flux_future_t *f,
         goto cleanup;
     }
 
-    if (!flux_rpc_get_unpack (f, "{ s:s }", "data", &s_data)) {
-
-        s_len = strlen (s_data);
-        len = BASE64_DECODE_SIZE (s_len);
-
-        if (!(data = calloc (1, len))) {
-            flux_log_error (p->h, "calloc");
-            goto cleanup;
-        }
-
-        if (sodium_base642bin ((unsigned char *)data, len, s_data, s_len,
-                               NULL, &len, NULL,
-                               sodium_base64_VARIANT_ORIGINAL) < 0) {
-            flux_log_error (p->h, "sodium_base642bin");
-            goto cleanup;
-        }
-
+    if (len > 0) {
         if ((tmp = flux_buffer_write (c->read_buffer, data, len)) < 0) {
             flux_log_error (p->h, "flux_buffer_write");
             goto cleanup;
         }
 
-        /* add list of msgs if there is overflow? */
+        /* server does not send more than the credit we granted */
 
         if (tmp != len) {
-            flux_log_error (p->h, "channel buffer error: rank = %d pid = %d, stream = %s, len = %zu",
+            flux_log_error (p->h, "channel buffer error: rank = %d pid = %d, stream = %s, len = %d",
                      rank, pid, stream, len);
             errno = EOVERFLOW;
             goto cleanup;
         }
+        c->read_credit -= len;
     }
-    else if (!flux_rpc_get_unpack (f, "{ s:i }", "eof", &eof)) {
+    else if (!json_unpack (o, "{ s:i }", "eof", &eof)) {
         c->read_eof_received = true;
     }
 
     rv = 0;
 cleanup:
-    free (data);
     return rv;
 }
 
@@ -602,19 +651,27 @@ static void remote_completion (flux_subprocess_t *p)
 static void remote_exec_cb (flux_future_t *f, void *arg)
 {
     flux_subprocess_t *p = arg;
+    json_t *o = NULL;
+    const char *data;
+    int len;
     const char *type;
     int rank;
     pid_t pid;
 
-    if (flux_rpc_get_unpack (f, "{ s:s s:i }",
-                             "type", &type,
-                             "rank", &rank) < 0) {
-        flux_log_error (p->h, "%s: flux_rpc_get_unpack", __FUNCTION__);
+    if (!(o = remote_response_decode (f, &data, &len))) {
+        flux_log_error (p->h, "%s: remote_response_decode", __FUNCTION__);
+        goto error;
+    }
+    if (json_unpack (o, "{ s:s s:i }",
+                     "type", &type,
+                     "rank", &rank) < 0) {
+        errno = EPROTO;
+        flux_log_error (p->h, "%s: json_unpack", __FUNCTION__);
         goto error;
     }
 
     if (!strcmp (type, "state")) {
-        if (remote_state (p, f, rank) < 0)
+        if (remote_state (p, o, rank) < 0)
             goto error;
         if (p->state == FLUX_SUBPROCESS_EXEC_FAILED
             || p->state == FLUX_SUBPROCESS_FAILED) {
@@ -625,11 +682,12 @@ static void remote_exec_cb (flux_future_t *f, void *arg)
             flux_future_reset (f);
     }
     else if (!strcmp (type, "output")) {
-        if (flux_rpc_get_unpack (f, "{ s:i }", "pid", &pid) < 0) {
-            flux_log_error (p->h, "%s: flux_rpc_get_unpack", __FUNCTION__);
+        if (json_unpack (o, "{ s:i }", "pid", &pid) < 0) {
+            errno = EPROTO;
+            flux_log_error (p->h, "%s: json_unpack", __FUNCTION__);
             goto error;
         }
-        if (remote_output (p, f, rank, pid) < 0)
+        if (remote_output (p, o, data, len, rank, pid) < 0)
             goto error;
         flux_future_reset (f);
     }
@@ -644,6 +702,7 @@ static void remote_exec_cb (flux_future_t *f, void *arg)
         goto error;
     }
 
+    json_decref (o);
     return;
 
 error:
@@ -658,6 +717,7 @@ error:
                        p->rank, -1, errno, 0);
     flux_future_destroy (f);
     p->f = NULL;
+    json_decref (o);
 }
 
 static void remote_continuation_cb (flux_future_t *f, void *arg)
@@ -717,11 +777,12 @@ int remote_exec (flux_subprocess_t *p)
      * don't care if user doesn't want it.
      */
     if (!(f = flux_rpc_pack (p->h, "cmb.rexec", p->rank, 0,
-                             "{s:s s:i s:i s:i}",
+                             "{s:s s:i s:i s:i s:i}",
                              "cmd", cmd_str,
                              "on_channel_out", p->ops.on_channel_out ? 1 : 0,
                              "on_stdout", p->ops.on_stdout ? 1 : 0,
-                             "on_stderr", p->ops.on_stderr ? 1 : 0))) {
+                             "on_stderr", p->ops.on_stderr ? 1 : 0,
+                             "flow", 1))) {
         flux_log_error (p->h, "flux_rpc");
         goto error;
     }
@@ -30,6 +30,7 @@
 #include "subprocess_private.h"
 #include "command.h"
 #include "remote.h"
+#include "local.h"
 #include "server.h"
 #include "util.h"
 
@@ -103,6 +104,169 @@ cleanup:
     return p;
 }
 
+/* Output of each stream is sent only while the client has granted
+ * credit for it (if the client requested flow control), and optionally
+ * coalesced into batches of whole lines.  While output must wait, the
+ * subprocess channel's read watcher is stopped, so unsent output stays
+ * in the channel buffer and eventually blocks the subprocess on write.
+ */
+struct rexec_output {
+    struct subprocess_channel *c;
+    flux_watcher_t *w;          /* subprocess channel read watcher */
+    flux_watcher_t *timer;      /* coalesce delay timer */
+    int credit;                 /* bytes client will accept, -1 = no limit */
+    double coalesce;            /* batch delay in seconds, 0 = no batching */
+    bool batch_pending;         /* coalesce timer is running */
+    bool batch_ready;           /* coalesce delay has expired */
+    bool paused;                /* read watcher stopped by us */
+};
+
+static void output_pause (struct rexec_output *o)
+{
+    if (!o->paused) {
+        flux_watcher_stop (o->w);
+        o->paused = true;
+    }
+}
+
+/* If output stopped in the middle of a forced flush of the channel,
+ * e.g. after the client closed a bidirectional channel, continue the
+ * flush rather than restart the read watcher.
+ */
+static void output_resume (struct rexec_output *o)
+{
+    if (o->paused) {
+        o->paused = false;
+        if (o->c->flush_pending)
+            local_channel_flush (o->c);
+        else
+            flux_watcher_start (o->w);
+    }
+}
+
+static void output_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
+                             int revents, void *arg)
+{
+    struct rexec_output *o = arg;
+
+    o->batch_pending = false;
+    o->batch_ready = true;
+    output_resume (o);
+}
+
+static void output_destroy (void *arg)
+{
+    struct rexec_output *o = arg;
+
+    if (o) {
+        int save_errno = errno;
+        flux_watcher_destroy (o->timer);
+        free (o);
+        errno = save_errno;
+    }
+}
+
+static struct rexec_output *output_create (flux_subprocess_server_t *s,
+                                           flux_subprocess_t *p,
+                                           struct subprocess_channel *c,
+                                           bool flow)
+{
+    struct rexec_output *o;
+
+    if (!(o = calloc (1, sizeof (*o))))
+        return NULL;
+    o->c = c;
+    o->w = c->buffer_read_w;
+    o->credit = -1;
+    if (flow && (o->credit = cmd_option_bufsize (p, c->name)) < 0)
+        goto error;
+    if ((o->coalesce = cmd_option_coalesce (p, c->name)) < 0.)
+        goto error;
+    if (o->coalesce > 0.) {
+        if (!(o->timer = flux_timer_watcher_create (s->r,
+                                                    o->coalesce,
+                                                    0.,
+                                                    output_timer_cb,
+                                                    o)))
+            goto error;
+    }
+    return o;
+error:
+    output_destroy (o);
+    return NULL;
+}
+
+static void outputs_destroy (void *arg)
+{
+    zhash_t *outputs = arg;
+    zhash_destroy (&outputs);
+}
+
+/* Create output state for each stream of 'p' that is read.
+ */
+static int outputs_setup (flux_subprocess_server_t *s, flux_subprocess_t *p,
+                          bool flow)
+{
+    zhash_t *outputs;
+    struct subprocess_channel *c;
+
+    if (!(outputs = zhash_new ())) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (flux_subprocess_aux_set (p, "outputs", outputs, outputs_destroy) < 0) {
+        outputs_destroy (outputs);
+        return -1;
+    }
+    c = zhash_first (p->channels);
+    while (c) {
+        if ((c->flags & CHANNEL_READ) && c->buffer_read_w) {
+            struct rexec_output *o;
+            if (!(o = output_create (s, p, c, flow)))
+                return -1;
+            if (zhash_insert (outputs, c->name, o) < 0) {
+                output_destroy (o);
+                errno = EEXIST;
+                return -1;
+            }
+            zhash_freefn (outputs, c->name, output_destroy);
+        }
+        c = zhash_next (p->channels);
+    }
+    return 0;
+}
+
+static struct rexec_output *output_lookup (flux_subprocess_t *p,
+                                           const char *stream)
+{
+    zhash_t *outputs = flux_subprocess_aux_get (p, "outputs");
+
+    if (!outputs)
+        return NULL;
+    return zhash_lookup (outputs, stream);
+}
+
+/* Stop throttling output of 'p', e.g. because the client is gone and
+ * buffered output must not keep the subprocess from completing.
+ */
+static void outputs_unthrottle (flux_subprocess_t *p)
+{
+    zhash_t *outputs = flux_subprocess_aux_get (p, "outputs");
+    struct rexec_output *o;
+
+    if (!outputs)
+        return;
+    o = zhash_first (outputs);
+    while (o) {
+        o->credit = -1;
+        o->coalesce = 0.;
+        if (o->timer)
+            flux_watcher_stop (o->timer);
+        output_resume (o);
+        o = zhash_next (outputs);
+    }
+}
+
 static void subprocess_cleanup (flux_subprocess_t *p)
 {
     flux_subprocess_server_t *s = flux_subprocess_aux_get (p, "server_ctx");
@@ -208,39 +372,50 @@ error:
     internal_fatal (s, p);
 }
 
+/* Output data is sent as a raw payload: a NUL terminated JSON header
+ * followed by the data itself.
+ */
 static int rexec_output_data (flux_subprocess_t *p, const char *stream,
                               flux_subprocess_server_t *s, flux_msg_t *msg,
                               const char *data, int len)
 {
-    char *s_data = NULL;
-    int s_len;
+    json_t *o = NULL;
+    char *hdr = NULL;
+    char *buf = NULL;
+    int hdrlen;
     int rv = -1;
 
     assert (len);
 
-    s_len = sodium_base64_encoded_len (len, sodium_base64_VARIANT_ORIGINAL);
-
-    if (!(s_data = calloc (1, s_len))) {
-        flux_log_error (s->h, "%s: calloc", __FUNCTION__);
+    if (!(o = json_pack ("{s:s s:i s:i s:s}",
+                         "type", "output",
+                         "rank", s->rank,
+                         "pid", flux_subprocess_pid (p),
+                         "stream", stream))
+        || !(hdr = json_dumps (o, JSON_COMPACT))) {
+        errno = ENOMEM;
+        flux_log_error (s->h, "%s: json_pack", __FUNCTION__);
         goto error;
     }
+    hdrlen = strlen (hdr) + 1;
 
-    sodium_bin2base64 (s_data, s_len, (unsigned char *)data, len,
-                       sodium_base64_VARIANT_ORIGINAL);
+    if (!(buf = malloc (hdrlen + len))) {
+        flux_log_error (s->h, "%s: malloc", __FUNCTION__);
+        goto error;
+    }
+    memcpy (buf, hdr, hdrlen);
+    memcpy (buf + hdrlen, data, len);
 
-    if (flux_respond_pack (s->h, msg, "{s:s s:i s:i s:s s:s}",
-                           "type", "output",
-                           "rank", s->rank,
-                           "pid", flux_subprocess_pid (p),
-                           "stream", stream,
-                           "data", s_data) < 0) {
-        flux_log_error (s->h, "%s: flux_respond_pack", __FUNCTION__);
+    if (flux_respond_raw (s->h, msg, buf, hdrlen + len) < 0) {
+        flux_log_error (s->h, "%s: flux_respond_raw", __FUNCTION__);
         goto error;
     }
 
     rv = 0;
 error:
-    free (s_data);
+    json_decref (o);
+    free (hdr);
+    free (buf);
     return rv;
 }
 
@@ -260,16 +435,60 @@ static int rexec_output_eof (flux_subprocess_t *p, const char *stream,
     return 0;
 }
 
+/* Return the number of bytes of buffered output that may be sent now,
+ * -1 for all of it, or 0 if output must wait, in which case the read
+ * watcher is paused until it may continue.
+ */
+static int output_sendable (struct rexec_output *o)
+{
+    flux_buffer_t *fb;
+    const char *data;
+    const char *nl;
+    int len;
+
+    if (!(fb = flux_buffer_read_watcher_get_buffer (o->w))
+        || (len = flux_buffer_bytes (fb)) <= 0)
+        return -1;
+
+    if (o->coalesce > 0. && !o->batch_ready) {
+        if (!o->batch_pending) {
+            flux_timer_watcher_reset (o->timer, o->coalesce, 0.);
+            flux_watcher_start (o->timer);
+            o->batch_pending = true;
+        }
+        output_pause (o);
+        return 0;
+    }
+    if (o->credit >= 0 && len > o->credit)
+        len = o->credit;
+    if (len == 0) {
+        output_pause (o);
+        return 0;
+    }
+    if (o->coalesce > 0.) {
+        if ((data = flux_buffer_peek (fb, len, NULL))
+            && (nl = memrchr (data, '\n', len)))
+            len = nl - data + 1;
+        o->batch_ready = false;
+    }
+    return len;
+}
+
 static void rexec_output_cb (flux_subprocess_t *p, const char *stream)
 {
     flux_subprocess_server_t *s = flux_subprocess_aux_get (p, "server_ctx");
     flux_msg_t *msg = (flux_msg_t *) flux_subprocess_aux_get (p, "msg");
+    struct rexec_output *o = output_lookup (p, stream);
     const char *ptr;
+    int len = -1;
     int lenp;
 
     assert (s && msg);
 
-    if (!(ptr = flux_subprocess_read (p, stream, -1, &lenp))) {
+    if (o && (len = output_sendable (o)) == 0)
+        return;
+
+    if (!(ptr = flux_subprocess_read (p, stream, len, &lenp))) {
         flux_log_error (s->h, "%s: flux_subprocess_read", __FUNCTION__);
         goto error;
     }
@@ -277,6 +496,8 @@ static void rexec_output_cb (flux_subprocess_t *p, const char *stream)
     if (lenp) {
         if (rexec_output_data (p, stream, s, msg, ptr, lenp) < 0)
             goto error;
+        if (o && o->credit >= 0)
+            o->credit = lenp < o->credit ? o->credit - lenp : 0;
     }
     else {
         if (rexec_output_eof (p, stream, s, msg) < 0)
@@ -311,13 +532,15 @@ static void server_exec_cb (flux_t *h, flux_msg_handler_t *mh,
         .on_stderr = rexec_output_cb,
     };
     int on_channel_out, on_stdout, on_stderr;
+    int flow = 0;
     char **env = NULL;
 
-    if (flux_request_unpack (msg, NULL, "{s:s s:i s:i s:i}",
+    if (flux_request_unpack (msg, NULL, "{s:s s:i s:i s:i s?i}",
                              "cmd", &cmd_str,
                              "on_channel_out", &on_channel_out,
                              "on_stdout", &on_stdout,
-                             "on_stderr", &on_stderr))
+                             "on_stderr", &on_stderr,
+                             "flow", &flow))
         goto error;
 
     if (!on_channel_out)
@@ -381,6 +604,8 @@ static void server_exec_cb (flux_t *h, flux_msg_handler_t *mh,
     copy = NULL;                /* owned by 'p' now */
     if (flux_subprocess_aux_set (p, "server_ctx", s, NULL) < 0)
         goto error;
+    if (outputs_setup (s, p, flow ? true : false) < 0)
+        goto error;
 
     flux_cmd_destroy (cmd);
     free (env);
@@ -514,6 +739,42 @@ error:
     internal_fatal (s, p);
 }
 
+static void server_credit_cb (flux_t *h, flux_msg_handler_t *mh,
+                              const flux_msg_t *msg, void *arg)
+{
+    flux_subprocess_server_t *s = arg;
+    flux_subprocess_t *p;
+    struct rexec_output *o;
+    const char *stream;
+    pid_t pid;
+    int credit;
+
+    if (flux_request_unpack (msg, NULL, "{ s:i s:s s:i }",
+                             "pid", &pid,
+                             "stream", &stream,
+                             "credit", &credit) < 0
+        || credit <= 0) {
+        /* no response to send errors to */
+        flux_log_error (s->h, "%s: flux_request_unpack", __FUNCTION__);
+        return;
+    }
+
+    /* process may have already completed */
+    if (!(p = lookup_pid (s, pid)))
+        return;
+
+    if (!(o = output_lookup (p, stream))) {
+        flux_log (s->h, LOG_ERR, "%s: unknown stream %s",
+                  __FUNCTION__, stream);
+        return;
+    }
+
+    if (o->credit >= 0) {
+        o->credit += credit;
+        output_resume (o);
+    }
+}
+
 static void server_signal_cb (flux_t *h, flux_msg_handler_t *mh,
                               const flux_msg_t *msg, void *arg)
 {
@@ -577,9 +838,10 @@ static json_t *process_info (flux_subprocess_t *p)
     }
 
     /* very limited returned, just for testing */
-    if (!(info = json_pack ("{s:i s:s}",
+    if (!(info = json_pack ("{s:i s:s s:i}",
                             "pid", flux_subprocess_pid (p),
-                            "sender", sender))) {
+                            "sender", sender,
+                            "memsize", subprocess_memsize (p)))) {
         errno = ENOMEM;
         goto cleanup;
     }
@@ -596,6 +858,7 @@ static void server_processes_cb (flux_t *h, flux_msg_handler_t *mh,
     flux_subprocess_server_t *s = arg;
     flux_subprocess_t *p;
     json_t *procs = NULL;
+    int memsize = 0;
 
     if (!(procs = json_array ())) {
         errno = ENOMEM;
@@ -611,10 +874,12 @@ static void server_processes_cb (flux_t *h, flux_msg_handler_t *mh,
             errno = ENOMEM;
             goto error;
         }
+        memsize += subprocess_memsize (p);
         p = zhash_next (s->subprocesses);
     }
 
-    if (flux_respond_pack (h, msg, "{s:i s:o}", "rank", s->rank,
+    if (flux_respond_pack (h, msg, "{s:i s:i s:o}", "rank", s->rank,
+                           "memsize", memsize,
                            "procs", procs) < 0)
         flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
     return;
@@ -633,9 +898,10 @@ int server_start (flux_subprocess_server_t *s, const char *prefix)
         { FLUX_MSGTYPE_REQUEST, "rexec.write",  server_write_cb, 0 },
         { FLUX_MSGTYPE_REQUEST, "rexec.signal", server_signal_cb, 0 },
         { FLUX_MSGTYPE_REQUEST, "rexec.processes", server_processes_cb, 0 },
+        { FLUX_MSGTYPE_REQUEST, "rexec.credit", server_credit_cb, 0 },
         FLUX_MSGHANDLER_TABLE_END,
     };
-    char *topic_globs[4] = {NULL, NULL, NULL, NULL};
+    char *topic_globs[5] = {NULL, NULL, NULL, NULL, NULL};
     int rv = -1;
 
     assert (prefix);
@@ -648,11 +914,14 @@ int server_start (flux_subprocess_server_t *s, const char *prefix)
         goto cleanup;
     if (asprintf (&topic_globs[3], "%s.rexec.processes", prefix) < 0)
         goto cleanup;
+    if (asprintf (&topic_globs[4], "%s.rexec.credit", prefix) < 0)
+        goto cleanup;
 
     htab[0].topic_glob = (const char *)topic_globs[0];
     htab[1].topic_glob = (const char *)topic_globs[1];
     htab[2].topic_glob = (const char *)topic_globs[2];
     htab[3].topic_glob = (const char *)topic_globs[3];
+    htab[4].topic_glob = (const char *)topic_globs[4];
 
     if (flux_msg_handler_addvec (s->h, htab, s, &s->handlers) < 0)
         goto cleanup;
@@ -663,6 +932,7 @@ cleanup:
     free (topic_globs[1]);
     free (topic_globs[2]);
     free (topic_globs[3]);
+    free (topic_globs[4]);
     return rv;
 }
 
@@ -674,6 +944,8 @@ void server_stop (flux_subprocess_server_t *s)
 static void terminate (flux_subprocess_t *p)
 {
     flux_future_t *f;
+
+    outputs_unthrottle (p);
     if (!(f = flux_subprocess_kill (p, SIGKILL))) {
         flux_subprocess_server_t *s;
         s = flux_subprocess_aux_get (p, "server_ctx");
@@ -249,6 +249,43 @@ int subprocess_status (flux_subprocess_t *p)
     return p->status;
 }
 
+static int buffer_memsize (flux_buffer_t *fb)
+{
+    int n;
+
+    if (!fb || (n = flux_buffer_memsize (fb)) < 0)
+        return 0;
+    return n;
+}
+
+int subprocess_memsize (flux_subprocess_t *p)
+{
+    struct subprocess_channel *c;
+    int total = 0;
+
+    assert (p);
+    c = zhash_first (p->channels);
+    while (c) {
+        if (p->local) {
+            flux_buffer_t *fb;
+            if (c->buffer_write_w) {
+                fb = flux_buffer_write_watcher_get_buffer (c->buffer_write_w);
+                total += buffer_memsize (fb);
+            }
+            if (c->buffer_read_w) {
+                fb = flux_buffer_read_watcher_get_buffer (c->buffer_read_w);
+                total += buffer_memsize (fb);
+            }
+        }
+        else {
+            total += buffer_memsize (c->write_buffer);
+            total += buffer_memsize (c->read_buffer);
+        }
+        c = zhash_next (p->channels);
+    }
+    return total;
+}
+
 /*
  *  General support:
  */
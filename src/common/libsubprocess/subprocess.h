@@ -216,8 +216,29 @@ int flux_cmd_add_channel (flux_cmd_t *cmd, const char *name);
  *  STDOUT_BUFSIZE = buffer size
  *  STDERR_BUFSIZE = buffer size
  *
- *  By default, stdio and channels use an internal buffer of 1 meg.
- *  The buffer size can be adjusted with this option.
+ *  By default, stdio and channels use an internal buffer of up to 1 meg.
+ *  The buffer size can be adjusted with this option.  Buffer memory is
+ *  allocated as data arrives, up to this size, and released once the
+ *  buffer has been drained.
+ *
+ *  name + "_COALESCE" = delay
+ *  STDOUT_COALESCE = delay
+ *  STDERR_COALESCE = delay
+ *
+ *  For remote subprocesses, output is sent to the caller in batches
+ *  of whole lines, collected for up to 'delay' seconds (floating
+ *  point), so that many small writes are delivered as one message.
+ *  A line longer than a batch is sent once the delay expires again.
+ *  By default output is sent as soon as it is read.  Remote output
+ *  is also flow controlled: the server sends no more than the
+ *  caller's buffer size (see _BUFSIZE) of output that the caller
+ *  has not yet consumed.
+ *
+ *  SPAWN_METHOD = "vfork" or "fork"
+ *
+ *  Local subprocesses are created with clone(CLONE_VM|CLONE_VFORK)
+ *  where available, so spawn cost does not grow with the size of the
+ *  parent.  Set "fork" to force fork(2).
  */
 int flux_cmd_setopt (flux_cmd_t *cmd, const char *var, const char *val);
 const char *flux_cmd_getopt (flux_cmd_t *cmd, const char *var);
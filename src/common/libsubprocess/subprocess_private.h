@@ -42,10 +42,12 @@ struct subprocess_channel {
     int child_fd;
     flux_watcher_t *buffer_write_w;
     flux_watcher_t *buffer_read_w;
+    bool flush_pending;            /* flush waits for output_f to read */
 
     /* remote */
     flux_buffer_t *write_buffer;
     flux_buffer_t *read_buffer;
+    int read_credit;               /* bytes server may send w/o more credit */
     bool write_eof_sent;
     bool read_eof_received;
     flux_watcher_t *in_prep_w;
@@ -118,6 +120,9 @@ struct flux_subprocess_server {
 
 void subprocess_check_completed (flux_subprocess_t *p);
 
+/* Bytes of memory currently allocated for channel buffers of 'p' */
+int subprocess_memsize (flux_subprocess_t *p);
+
 void state_change_start (flux_subprocess_t *p);
 
 void channel_destroy (void *arg);
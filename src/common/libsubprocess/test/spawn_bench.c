@@ -0,0 +1,183 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* spawn_bench - measure subprocess spawn latency vs parent RSS
+ *
+ * Usage: spawn_bench [-n COUNT] [-s MB,MB,...] [CMD ...]
+ *
+ * For each RSS size, grow the parent to that many MB of touched memory,
+ * then spawn CMD (default /bin/true) COUNT times with each SPAWN_METHOD,
+ * reporting the latency of flux_local_exec() (time until the child has
+ * exec'd) and of a full run to completion, in milliseconds.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+
+extern char **environ;
+
+struct stats {
+    double min;
+    double max;
+    double sum;
+    int n;
+};
+
+static void stats_add (struct stats *s, double x)
+{
+    if (s->n == 0 || x < s->min)
+        s->min = x;
+    if (s->n == 0 || x > s->max)
+        s->max = x;
+    s->sum += x;
+    s->n++;
+}
+
+static double stats_mean (struct stats *s)
+{
+    return s->n > 0 ? s->sum / s->n : 0.;
+}
+
+static long rss_mb (void)
+{
+    FILE *f;
+    long pages = 0;
+    long rss = 0;
+
+    if ((f = fopen ("/proc/self/statm", "r"))) {
+        if (fscanf (f, "%ld %ld", &pages, &rss) != 2)
+            rss = 0;
+        fclose (f);
+    }
+    return rss * sysconf (_SC_PAGESIZE) / (1024*1024);
+}
+
+/* Grow touched heap to 'mb' megabytes.  Memory is intentionally leaked.
+ */
+static void grow_rss (long mb)
+{
+    long have = rss_mb ();
+
+    while (have < mb) {
+        size_t size = 64*1024*1024;
+        char *p;
+        if (!(p = malloc (size)))
+            log_err_exit ("malloc");
+        memset (p, 1, size);
+        have += 64;
+    }
+}
+
+static void completion_cb (flux_subprocess_t *p)
+{
+    flux_subprocess_destroy (p);
+}
+
+static void run_one (flux_reactor_t *r, flux_cmd_t *cmd,
+                     struct stats *spawn, struct stats *total)
+{
+    flux_subprocess_ops_t ops = { .on_completion = completion_cb };
+    struct timespec t0;
+
+    monotime (&t0);
+    if (!flux_local_exec (r, 0, cmd, &ops))
+        log_err_exit ("flux_local_exec");
+    stats_add (spawn, monotime_since (t0));
+    if (flux_reactor_run (r, 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    stats_add (total, monotime_since (t0));
+}
+
+static void usage (void)
+{
+    fprintf (stderr, "Usage: spawn_bench [-n COUNT] [-s MB,...] [CMD ...]\n");
+    exit (1);
+}
+
+int main (int argc, char *argv[])
+{
+    const char *methods[] = { "vfork", "fork", NULL };
+    char *default_av[] = { "/bin/true", NULL };
+    char default_sizes[] = "0,256,1024,4096";
+    char *sizes = default_sizes;
+    char *size, *saveptr = NULL;
+    int count = 100;
+    flux_reactor_t *r;
+    flux_cmd_t *cmd;
+    char cwd[1024];
+    int ch;
+
+    log_init ("spawn_bench");
+
+    while ((ch = getopt (argc, argv, "+n:s:h")) != -1) {
+        switch (ch) {
+            case 'n':
+                if ((count = strtol (optarg, NULL, 10)) <= 0)
+                    usage ();
+                break;
+            case 's':
+                sizes = optarg;
+                break;
+            default:
+                usage ();
+        }
+    }
+    if (optind < argc)
+        cmd = flux_cmd_create (argc - optind, argv + optind, environ);
+    else
+        cmd = flux_cmd_create (1, default_av, environ);
+    if (!cmd)
+        log_err_exit ("flux_cmd_create");
+    if (!getcwd (cwd, sizeof (cwd)) || flux_cmd_setcwd (cmd, cwd) < 0)
+        log_err_exit ("flux_cmd_setcwd");
+    if (!(r = flux_reactor_create (FLUX_REACTOR_SIGCHLD)))
+        log_err_exit ("flux_reactor_create");
+
+    printf ("%8s %8s %10s %10s %10s %10s\n",
+            "RSS(MB)", "METHOD", "SPAWN(ms)", "MIN", "MAX", "TOTAL(ms)");
+    for (size = strtok_r (sizes, ",", &saveptr); size != NULL;
+         size = strtok_r (NULL, ",", &saveptr)) {
+        int m, i;
+
+        grow_rss (strtol (size, NULL, 10));
+        for (m = 0; methods[m] != NULL; m++) {
+            struct stats spawn = { 0 };
+            struct stats total = { 0 };
+
+            if (flux_cmd_setopt (cmd, "SPAWN_METHOD", methods[m]) < 0)
+                log_err_exit ("flux_cmd_setopt");
+            for (i = 0; i < count; i++)
+                run_one (r, cmd, &spawn, &total);
+            printf ("%8ld %8s %10.3f %10.3f %10.3f %10.3f\n",
+                    rss_mb (), methods[m],
+                    stats_mean (&spawn), spawn.min, spawn.max,
+                    stats_mean (&total));
+        }
+    }
+
+    flux_reactor_destroy (r);
+    flux_cmd_destroy (cmd);
+    log_fini ();
+    return 0;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
@@ -15,6 +15,7 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "src/common/libtap/tap.h"
 #include "src/common/libsubprocess/subprocess.h"
@@ -1691,6 +1692,122 @@ void test_bufsize_error (flux_reactor_t *r)
     flux_cmd_destroy (cmd);
 }
 
+void test_spawn_method (flux_reactor_t *r)
+{
+    char *av[] = { "/bin/true", NULL };
+    flux_cmd_t *cmd;
+    flux_subprocess_t *p = NULL;
+    flux_subprocess_ops_t ops = {
+        .on_completion = completion_cb
+    };
+    int rc;
+
+    ok ((cmd = flux_cmd_create (1, av, NULL)) != NULL, "flux_cmd_create");
+
+    ok (flux_cmd_setopt (cmd, "SPAWN_METHOD", "fork") == 0,
+        "flux_cmd_setopt set SPAWN_METHOD=fork success");
+    completion_cb_count = 0;
+    p = flux_local_exec (r, 0, cmd, &ops);
+    ok (p != NULL
+        && flux_subprocess_state (p) == FLUX_SUBPROCESS_RUNNING,
+        "flux_local_exec with SPAWN_METHOD=fork works");
+    rc = flux_reactor_run (r, 0);
+    ok (rc == 0 && completion_cb_count == 1,
+        "completion callback called 1 time");
+    flux_subprocess_destroy (p);
+
+    ok (flux_cmd_setopt (cmd, "SPAWN_METHOD", "vfork") == 0,
+        "flux_cmd_setopt set SPAWN_METHOD=vfork success");
+    completion_cb_count = 0;
+    p = flux_local_exec (r, 0, cmd, &ops);
+    ok (p != NULL
+        && flux_subprocess_state (p) == FLUX_SUBPROCESS_RUNNING,
+        "flux_local_exec with SPAWN_METHOD=vfork works");
+    rc = flux_reactor_run (r, 0);
+    ok (rc == 0 && completion_cb_count == 1,
+        "completion callback called 1 time");
+    flux_subprocess_destroy (p);
+
+    ok (flux_cmd_setopt (cmd, "SPAWN_METHOD", "foo") == 0,
+        "flux_cmd_setopt set SPAWN_METHOD=foo success");
+    p = flux_local_exec (r, 0, cmd, &ops);
+    ok (p == NULL && errno == EINVAL,
+        "flux_local_exec fails with EINVAL due to bad SPAWN_METHOD");
+
+    flux_cmd_destroy (cmd);
+}
+
+void completion_exit3_cb (flux_subprocess_t *p)
+{
+    ok (flux_subprocess_exit_code (p) == 3,
+        "subprocess exit code is 3");
+    completion_cb_count++;
+}
+
+void test_exec_noshebang (flux_reactor_t *r)
+{
+    char path[] = "/tmp/subprocess-test.XXXXXX";
+    char *av[] = { path, NULL };
+    char *env[] = { "PATH=/bin:/usr/bin", NULL };
+    flux_cmd_t *cmd;
+    flux_subprocess_t *p = NULL;
+    flux_subprocess_ops_t ops = {
+        .on_completion = completion_exit3_cb
+    };
+    int fd;
+
+    if ((fd = mkstemp (path)) < 0
+        || write (fd, "exit 3\n", 7) != 7
+        || fchmod (fd, 0700) < 0
+        || close (fd) < 0)
+        BAIL_OUT ("could not create test script");
+
+    ok ((cmd = flux_cmd_create (1, av, env)) != NULL, "flux_cmd_create");
+    completion_cb_count = 0;
+    p = flux_local_exec (r, 0, cmd, &ops);
+    ok (p != NULL, "flux_local_exec of script without #! works");
+    ok (flux_reactor_run (r, 0) == 0 && completion_cb_count == 1,
+        "completion callback called 1 time");
+    flux_subprocess_destroy (p);
+    flux_cmd_destroy (cmd);
+    (void) unlink (path);
+}
+
+void test_exec_path_fail (flux_reactor_t *r)
+{
+    char dir[] = "/tmp/subprocess-test.XXXXXX";
+    char path[64];
+    char pathenv[64];
+    char *av[] = { "noexec", NULL };
+    char *env[] = { pathenv, NULL };
+    flux_cmd_t *cmd;
+    flux_subprocess_t *p;
+    int fd;
+
+    if (!mkdtemp (dir)
+        || snprintf (path, sizeof (path), "%s/noexec", dir) < 0
+        || snprintf (pathenv, sizeof (pathenv), "PATH=%s", dir) < 0
+        || (fd = open (path, O_CREAT | O_WRONLY, 0600)) < 0
+        || close (fd) < 0)
+        BAIL_OUT ("could not create test file");
+
+    ok ((cmd = flux_cmd_create (1, av, env)) != NULL, "flux_cmd_create");
+    p = flux_local_exec (r, 0, cmd, NULL);
+    ok (p == NULL && errno == EACCES,
+        "flux_local_exec of non-executable file in PATH fails with EACCES");
+    flux_cmd_destroy (cmd);
+
+    av[0] = "nosuchcommand";
+    ok ((cmd = flux_cmd_create (1, av, env)) != NULL, "flux_cmd_create");
+    p = flux_local_exec (r, 0, cmd, NULL);
+    ok (p == NULL && errno == ENOENT,
+        "flux_local_exec of command not in PATH fails with ENOENT");
+    flux_cmd_destroy (cmd);
+
+    (void) unlink (path);
+    (void) rmdir (dir);
+}
+
 int main (int argc, char *argv[])
 {
     flux_reactor_t *r;
@@ -1770,6 +1887,12 @@ int main (int argc, char *argv[])
     test_bufsize (r);
     diag ("bufsize_error");
     test_bufsize_error (r);
+    diag ("spawn_method");
+    test_spawn_method (r);
+    diag ("exec_noshebang");
+    test_exec_noshebang (r);
+    diag ("exec_path_fail");
+    test_exec_path_fail (r);
 
     end_fdcount = fdcount ();
 
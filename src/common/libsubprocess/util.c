@@ -75,6 +75,38 @@ cleanup:
     return rv;
 }
 
+double cmd_option_coalesce (flux_subprocess_t *p, const char *name)
+{
+    char *var;
+    const char *val;
+    double rv = -1.;
+
+    if (asprintf (&var, "%s_COALESCE", name) < 0) {
+        log_err ("asprintf");
+        goto cleanup;
+    }
+
+    if ((val = flux_cmd_getopt (p->cmd, var))) {
+        char *endptr;
+        errno = 0;
+        rv = strtod (val, &endptr);
+        if (errno
+            || endptr == val
+            || endptr[0] != '\0'
+            || rv < 0.) {
+            rv = -1.;
+            errno = EINVAL;
+            goto cleanup;
+        }
+    }
+    else
+        rv = 0.;
+
+cleanup:
+    free (var);
+    return rv;
+}
+
 /*
  * vi: ts=4 sw=4 expandtab
  */
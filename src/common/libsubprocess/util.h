@@ -19,4 +19,9 @@ void close_pair_fds (int *fds);
 
 int cmd_option_bufsize (flux_subprocess_t *p, const char *name);
 
+/* Returns the output coalescing delay for channel 'name' in seconds,
+ * 0 if not set, or -1 with errno = EINVAL if the option is invalid.
+ */
+double cmd_option_coalesce (flux_subprocess_t *p, const char *name);
+
 #endif /* !_SUBPROCESS_UTIL_H */
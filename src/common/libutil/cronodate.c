@@ -359,93 +359,118 @@ static int *tm_item (struct tm *t, tm_unit_t item)
     return (NULL);
 }
 
-static void tm_incr (struct tm *tm, tm_unit_t item)
+bool cronodate_match (cronodate_t *d, struct tm *tm)
+{
+    int i;
+    for (i = 0; i < TM_MAX_ITEM; i++) {
+        struct idset *n = d->item [i].set;
+        int *ti = tm_item (tm, i);
+        if (!idset_test (n, *ti)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_leap_year (int year)
 {
-    int *ti = tm_item (tm, item);
-    (*ti)++;
+    year += 1900;
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
 }
 
-static void tm_set (struct tm *tm, tm_unit_t item, int val)
+static int days_in_month (int year, int mon)
 {
-    int *ti = tm_item (tm, item);
-    *ti = val;
+    static const int days [] = {31,28,31,30,31,30,31,31,30,31,30,31};
+    if (mon == 1 && is_leap_year (year))
+        return 29;
+    return days [mon];
 }
 
-/*
- *  Starting at item-1 reset all values of tm struct `tm`
- *   to their minimum values.
+/*  Day of the week (0 = Sunday) of a date in the Gregorian calendar
+ *   (Sakamoto's method).
  */
-static void tm_reset (struct tm *tm, tm_unit_t item)
+static int day_of_week (int year, int mon, int mday)
 {
-    int i;
-    for (i = item-1; i >= TM_SEC; i--)
-        tm_set (tm, i, tm_unit_min (i));
+    static const int t [] = {0,3,2,5,0,3,5,1,4,6,2,4};
+    int y = year + 1900;
+    if (mon < 2)
+        y--;
+    return (y + y/4 - y/100 + y/400 + t [mon] + mday) % 7;
 }
 
-/* advance time unit `item` in tm struct `tm` to new value `val`.
- *  if value is less than current value for the unit (e.g. for
- *  hours tm.tm_hour is 20 and we "advance" to 2), then increment
- *  the upper unit (e.g. mday), and reset all lower units to
- *  zero (e.g. minutes, seconds).
+/*  Return the smallest member of time unit `u` in `d` that is >= val
+ *   and <= max, or -1 if there is none.
  */
-static int tm_advance (struct tm *tm, tm_unit_t item, int val)
+static int next_member (cronodate_t *d, tm_unit_t u, int val, int max)
 {
-    int *ti;
+    struct idset *n = d->item [u].set;
+    unsigned int id;
 
-    switch (item) {
-    case TM_SEC:
-    case TM_MIN:
-    case TM_HOUR:
-    case TM_MDAY:
-    case TM_MON:
-        ti = tm_item (tm, item);
-        /* If current value is greater than new value, then roll over
-         *  to the next higher time unit (e.g. for seconds add one to minutes)
-         *  and set this unit to the new "val" value.
-         */
-        if (*ti > val)
-            tm_incr (tm, item+1);
-        *ti = val;
-        tm_reset (tm, item);
-        break;
-    /* Year is special. It doesn't overflow
-     */
-    case TM_YEAR:
-        tm->tm_year = val;
-        tm_reset (tm, TM_YEAR);
-        break; 
-        
-    /* day of week is special */
-    case TM_WDAY:
-        if (tm->tm_wday > val) // into next week
-            tm->tm_mday += (7 - tm->tm_wday) + val;
-        else
-            tm->tm_mday = val - tm->tm_wday;
-        tm_reset (tm, TM_MDAY);
-        break;
-    default:
-        return (-1);
+    if (val > max)
+        return -1;
+    if (idset_test (n, val))
+        return val;
+    if ((id = idset_next (n, val)) == IDSET_INVALID_ID || id > max)
+        return -1;
+    return id;
+}
+
+/*  Return the first day of the month in tm, on or after tm->tm_mday,
+ *   that matches both the mday and weekday sets, or -1 if there is none.
+ */
+static int next_day (cronodate_t *d, struct tm *tm)
+{
+    int max = days_in_month (tm->tm_year, tm->tm_mon);
+    int mday = tm->tm_mday;
+
+    while ((mday = next_member (d, TM_MDAY, mday, max)) > 0) {
+        int wday = day_of_week (tm->tm_year, tm->tm_mon, mday);
+        if (idset_test (d->item [TM_WDAY].set, wday))
+            return mday;
+        mday++;
     }
-    return (0);
+    return -1;
 }
 
-bool cronodate_match (cronodate_t *d, struct tm *tm)
+/*  Set time unit `item` in `tm` and reset all lower units to their
+ *   minimum values.
+ */
+static void tm_advance (struct tm *tm, tm_unit_t item, int val)
 {
-    int i;
-    for (i = 0; i < TM_MAX_ITEM; i++) {
-        struct idset *n = d->item [i].set;
-        int *ti = tm_item (tm, i);
-        if (!idset_test (n, *ti)) {
-            return false;
-        }
+    *tm_item (tm, item) = val;
+    switch (item) {
+        case TM_YEAR:
+            tm->tm_mon = 0;
+            /* fallthrough */
+        case TM_MON:
+            tm->tm_mday = 1;
+            /* fallthrough */
+        case TM_MDAY:
+            tm->tm_hour = 0;
+            /* fallthrough */
+        case TM_HOUR:
+            tm->tm_min = 0;
+            /* fallthrough */
+        case TM_MIN:
+            tm->tm_sec = 0;
+            /* fallthrough */
+        default:
+            break;
     }
-    return true;
 }
 
+/*  Find the next matching date-time directly from the per-unit sets,
+ *   from the largest unit to the smallest.  When no value of a unit
+ *   matches within the next larger unit (e.g. no matching hour left
+ *   today), that unit is advanced and the search starts over from it.
+ *   Only the final result is normalized with mktime(3).
+ */
 int cronodate_next (cronodate_t *d, struct tm *tm)
 {
-    int i;
     time_t t, now;
+    int max_year;
+    int val;
+
     if (tm == NULL || d == NULL) {
         errno = EINVAL;
         return (-1);
@@ -455,37 +480,72 @@ int cronodate_next (cronodate_t *d, struct tm *tm)
      *  and do not match "now".
      */
     tm->tm_sec++;
-    now = mktime (tm);
+    tm->tm_isdst = -1;
+    if ((now = mktime (tm)) == (time_t) -1)
+        return (-1);
 
-again:
-    /* Loop through configured date-time units to see if
-     *  they all fall within per-unit nodesets of `d`.
-     *  for each that does not match, advance the time by
-     *  one unit and try again.
-     *
-     * If time is advanced, check to sure we don't go more
-     *  than a year into the future. This could be fixed up
-     *  later, but for now is sufficient.
+    /* Don't search more than 2 years into the future.
      */
-    for (i = TM_SEC; i < TM_MAX_ITEM; i++) {
-        struct idset *n = d->item [i].set;
-        int *ti = tm_item (tm, i);
+    max_year = tm->tm_year + 2;
+again:
+    while (tm->tm_year <= max_year) {
+        if ((val = next_member (d, TM_YEAR, tm->tm_year, max_year)) < 0)
+            break;
+        if (val > tm->tm_year)
+            tm_advance (tm, TM_YEAR, val);
 
-        if (!idset_test (n, *ti)) {
-            unsigned int next;
-            if ((next = idset_next (n, *ti)) == IDSET_INVALID_ID)
-                next = idset_first (n);
-            tm_advance (tm, i, next);
-            // Call mktime to fix up any overflow, and check that
-            //  don't iterate more than 2 years in the future
-            if (((t = mktime (tm)) - now) > 2*60*60*24*365) {
-                errno = EOVERFLOW;
-                return -1;
-            }
-            goto again;
+        if ((val = next_member (d, TM_MON, tm->tm_mon, 11)) < 0) {
+            tm_advance (tm, TM_YEAR, tm->tm_year + 1);
+            continue;
+        }
+        if (val > tm->tm_mon)
+            tm_advance (tm, TM_MON, val);
+
+        if ((val = next_day (d, tm)) < 0) {
+            if (tm->tm_mon == 11)
+                tm_advance (tm, TM_YEAR, tm->tm_year + 1);
+            else
+                tm_advance (tm, TM_MON, tm->tm_mon + 1);
+            continue;
+        }
+        if (val > tm->tm_mday)
+            tm_advance (tm, TM_MDAY, val);
+
+        if ((val = next_member (d, TM_HOUR, tm->tm_hour, 23)) < 0) {
+            tm_advance (tm, TM_MDAY, tm->tm_mday + 1);
+            continue;
+        }
+        if (val > tm->tm_hour)
+            tm_advance (tm, TM_HOUR, val);
+
+        if ((val = next_member (d, TM_MIN, tm->tm_min, 59)) < 0) {
+            tm_advance (tm, TM_HOUR, tm->tm_hour + 1);
+            continue;
+        }
+        if (val > tm->tm_min)
+            tm_advance (tm, TM_MIN, val);
+
+        if ((val = next_member (d, TM_SEC, tm->tm_sec, 59)) < 0) {
+            tm_advance (tm, TM_MIN, tm->tm_min + 1);
+            continue;
         }
+        tm->tm_sec = val;
+
+        /* Normalize, and fill in tm_wday.  A time that does not exist
+         *  (skipped by a DST change) is moved forward, and may no longer
+         *  match, in which case search again from there.
+         */
+        tm->tm_isdst = -1;
+        if ((t = mktime (tm)) == (time_t) -1)
+            return (-1);
+        if (!cronodate_match (d, tm))
+            goto again;
+        if (t - now > 2*60*60*24*365)
+            break;
+        return (0);
     }
-    return 0;
+    errno = EOVERFLOW;
+    return (-1);
 }
 
 double cronodate_remaining (cronodate_t *d, double now)
@@ -0,0 +1,370 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* hist.c - log-linear histogram
+ *
+ * Bucket index of value v:
+ *   v < 64:  v
+ *   else:    k * 32 + (v >> k), where k = msb(v) - 5
+ * so that (v >> k) keeps the 6 most significant bits of v, and each
+ * power of two from 64 up is covered by 32 buckets of width 2^k.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <jansson.h>
+
+#include "hist.h"
+#include "monotime.h"
+
+#define SUB_BITS    5
+#define SUB_COUNT   (1 << SUB_BITS)
+/* Values below 2 * SUB_COUNT have a bucket each (two rows), then each
+ * power of two from 2^(SUB_BITS+1) through 2^63 has a row of SUB_COUNT.
+ */
+#define NBUCKETS    ((64 - SUB_BITS + 1) * SUB_COUNT)
+
+struct hist {
+    uint64_t *buckets;
+    int size;               /* allocated buckets */
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+};
+
+static inline int bucket_index (uint64_t v)
+{
+    int k;
+
+    if (v < 2 * SUB_COUNT)
+        return v;
+    k = (63 - __builtin_clzll (v)) - SUB_BITS;
+    return k * SUB_COUNT + (v >> k);
+}
+
+/* Smallest value that falls in bucket 'i'.
+ */
+static uint64_t bucket_low (int i)
+{
+    int k;
+
+    if (i < 2 * SUB_COUNT)
+        return i;
+    k = i / SUB_COUNT - 1;
+    return (uint64_t)(i - k * SUB_COUNT) << k;
+}
+
+/* Largest value that falls in bucket 'i'.
+ */
+static uint64_t bucket_high (int i)
+{
+    int k;
+    uint64_t m;
+
+    if (i < 2 * SUB_COUNT)
+        return i;
+    k = i / SUB_COUNT - 1;
+    m = i - k * SUB_COUNT;
+    return ((m + 1) << k) - 1;
+}
+
+static int grow (struct hist *h, int index)
+{
+    int size = h->size ? h->size : 2 * SUB_COUNT;
+    uint64_t *new;
+
+    while (size <= index)
+        size *= 2;
+    if (size > NBUCKETS)
+        size = NBUCKETS;
+    if (!(new = realloc (h->buckets, size * sizeof (new[0])))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset (new + h->size, 0, (size - h->size) * sizeof (new[0]));
+    h->buckets = new;
+    h->size = size;
+    return 0;
+}
+
+struct hist *hist_create (void)
+{
+    struct hist *h;
+
+    if (!(h = calloc (1, sizeof (*h)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return h;
+}
+
+void hist_destroy (struct hist *h)
+{
+    if (h) {
+        int saved_errno = errno;
+        free (h->buckets);
+        free (h);
+        errno = saved_errno;
+    }
+}
+
+void hist_clear (struct hist *h)
+{
+    if (h) {
+        if (h->buckets)
+            memset (h->buckets, 0, h->size * sizeof (h->buckets[0]));
+        h->count = h->min = h->max = h->sum = 0;
+    }
+}
+
+static int record_n (struct hist *h, int index, uint64_t n,
+                     uint64_t min, uint64_t max, uint64_t sum)
+{
+    if (index >= h->size && grow (h, index) < 0)
+        return -1;
+    h->buckets[index] += n;
+    if (h->count == 0 || min < h->min)
+        h->min = min;
+    if (h->count == 0 || max > h->max)
+        h->max = max;
+    h->count += n;
+    h->sum += sum;
+    return 0;
+}
+
+int hist_record (struct hist *h, uint64_t value)
+{
+    if (!h) {
+        errno = EINVAL;
+        return -1;
+    }
+    return record_n (h, bucket_index (value), 1, value, value, value);
+}
+
+int hist_record_since (struct hist *h, struct timespec t0)
+{
+    double usec = monotime_since (t0) * 1000.;
+
+    return hist_record (h, usec > 0. ? (uint64_t)usec : 0);
+}
+
+int hist_merge (struct hist *dst, const struct hist *src)
+{
+    int i;
+
+    if (!dst || !src) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (src->count == 0)
+        return 0;
+    if (src->size > dst->size && grow (dst, src->size - 1) < 0)
+        return -1;
+    for (i = 0; i < src->size; i++)
+        dst->buckets[i] += src->buckets[i];
+    if (dst->count == 0 || src->min < dst->min)
+        dst->min = src->min;
+    if (dst->count == 0 || src->max > dst->max)
+        dst->max = src->max;
+    dst->count += src->count;
+    dst->sum += src->sum;
+    return 0;
+}
+
+int hist_subtract (struct hist *dst, const struct hist *src)
+{
+    int first = -1;
+    int last = -1;
+    int i;
+
+    if (!dst || !src || src->count > dst->count || src->sum > dst->sum)
+        goto inval;
+    for (i = 0; i < src->size; i++) {
+        if (src->buckets[i] > 0
+            && (i >= dst->size || src->buckets[i] > dst->buckets[i]))
+            goto inval;
+    }
+    for (i = 0; i < dst->size; i++) {
+        if (i < src->size)
+            dst->buckets[i] -= src->buckets[i];
+        if (dst->buckets[i] > 0) {
+            if (first < 0)
+                first = i;
+            last = i;
+        }
+    }
+    dst->count -= src->count;
+    dst->sum -= src->sum;
+    if (dst->count == 0)
+        dst->min = dst->max = 0;
+    else {
+        uint64_t low = bucket_low (first);
+        uint64_t high = bucket_high (last);
+        if (low > dst->min)
+            dst->min = low;
+        if (high < dst->max)
+            dst->max = high;
+    }
+    return 0;
+inval:
+    errno = EINVAL;
+    return -1;
+}
+
+uint64_t hist_count (const struct hist *h)
+{
+    return h ? h->count : 0;
+}
+
+uint64_t hist_min (const struct hist *h)
+{
+    return h ? h->min : 0;
+}
+
+uint64_t hist_max (const struct hist *h)
+{
+    return h ? h->max : 0;
+}
+
+double hist_mean (const struct hist *h)
+{
+    if (!h || h->count == 0)
+        return 0.;
+    return (double)h->sum / h->count;
+}
+
+uint64_t hist_percentile (const struct hist *h, double pct)
+{
+    uint64_t rank;
+    uint64_t total = 0;
+    uint64_t v = 0;
+    int i;
+
+    if (!h || h->count == 0)
+        return 0;
+    if (pct <= 0.)
+        return h->min;
+    if (pct >= 100.)
+        return h->max;
+    rank = ceil (pct / 100. * h->count);
+    if (rank == 0)
+        rank = 1;
+    for (i = 0; i < h->size; i++) {
+        total += h->buckets[i];
+        if (total >= rank) {
+            v = bucket_high (i);
+            break;
+        }
+    }
+    if (v > h->max)
+        v = h->max;
+    if (v < h->min)
+        v = h->min;
+    return v;
+}
+
+json_t *hist_encode (const struct hist *h)
+{
+    json_t *buckets;
+    json_t *o;
+    int i;
+
+    if (!h) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(buckets = json_array ()))
+        goto nomem;
+    for (i = 0; i < h->size; i++) {
+        json_t *b;
+        if (h->buckets[i] == 0)
+            continue;
+        if (!(b = json_pack ("[i I]", i, (json_int_t)h->buckets[i]))
+            || json_array_append_new (buckets, b) < 0) {
+            json_decref (b);
+            json_decref (buckets);
+            goto nomem;
+        }
+    }
+    if (!(o = json_pack ("{s:I s:I s:f s:I s:I s:I s:I s:I s:I s:o}",
+                         "count", (json_int_t)h->count,
+                         "min", (json_int_t)h->min,
+                         "mean", hist_mean (h),
+                         "max", (json_int_t)h->max,
+                         "sum", (json_int_t)h->sum,
+                         "p50", (json_int_t)hist_percentile (h, 50.),
+                         "p90", (json_int_t)hist_percentile (h, 90.),
+                         "p99", (json_int_t)hist_percentile (h, 99.),
+                         "p99.9", (json_int_t)hist_percentile (h, 99.9),
+                         "buckets", buckets)))
+        goto nomem;
+    return o;
+nomem:
+    errno = ENOMEM;
+    return NULL;
+}
+
+struct hist *hist_decode (json_t *o)
+{
+    struct hist *h;
+    json_int_t count, min, max, sum;
+    json_t *buckets;
+    json_t *b;
+    size_t index;
+    uint64_t total = 0;
+
+    if (!o || json_unpack (o, "{s:I s:I s:I s:I s:o}",
+                           "count", &count,
+                           "min", &min,
+                           "max", &max,
+                           "sum", &sum,
+                           "buckets", &buckets) < 0
+           || !json_is_array (buckets)) {
+        errno = EPROTO;
+        return NULL;
+    }
+    if (!(h = hist_create ()))
+        return NULL;
+    json_array_foreach (buckets, index, b) {
+        int i;
+        json_int_t n;
+        if (json_unpack (b, "[i I]", &i, &n) < 0
+            || i < 0 || i >= NBUCKETS || n < 0) {
+            errno = EPROTO;
+            goto error;
+        }
+        if (i >= h->size && grow (h, i) < 0)
+            goto error;
+        h->buckets[i] += n;
+        total += n;
+    }
+    if (total != count) {
+        errno = EPROTO;
+        goto error;
+    }
+    h->count = count;
+    h->min = min;
+    h->max = max;
+    h->sum = sum;
+    return h;
+error:
+    hist_destroy (h);
+    return NULL;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
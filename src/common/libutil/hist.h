@@ -0,0 +1,81 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_HIST_H
+#define _UTIL_HIST_H
+
+#include <stdint.h>
+#include <time.h>
+#include <jansson.h>
+
+/* Log-linear (HDR style) histogram of unsigned integer values,
+ * e.g. latencies in microseconds.
+ * - values below 64 are counted exactly.  Above that, each power of two
+ *   is split into 32 buckets, so a reported percentile is within 1/32
+ *   (about 3%) of the true value.
+ * - hist_record() is O(1): a bit scan and an increment.  Bucket storage
+ *   grows on demand up to the largest value seen.
+ * - histograms can be merged, and hist_encode() output can be decoded
+ *   and merged elsewhere, e.g. to combine stats from several ranks.
+ */
+struct hist;
+
+struct hist *hist_create (void);
+void hist_destroy (struct hist *h);
+
+/* Drop all recorded values.
+ */
+void hist_clear (struct hist *h);
+
+/* Record a value.  Returns -1 on error (ENOMEM), 0 on success.
+ */
+int hist_record (struct hist *h, uint64_t value);
+
+/* Record the microseconds elapsed since monotonic time 't0'.
+ */
+int hist_record_since (struct hist *h, struct timespec t0);
+
+/* Add the values recorded in 'src' to 'dst'.
+ * Returns -1 on error (ENOMEM), 0 on success.
+ */
+int hist_merge (struct hist *dst, const struct hist *src);
+
+/* Remove the values recorded in 'src' from 'dst', where 'src' is an
+ * earlier snapshot of 'dst', leaving the values recorded in between.
+ * min and max become bucket bounds, so they are only as exact as
+ * percentiles.  Returns -1 on error (EINVAL if 'src' has values that
+ * 'dst' does not), 0 on success.
+ */
+int hist_subtract (struct hist *dst, const struct hist *src);
+
+uint64_t hist_count (const struct hist *h);
+uint64_t hist_min (const struct hist *h);
+uint64_t hist_max (const struct hist *h);
+double hist_mean (const struct hist *h);
+
+/* Return the value below which 'pct' percent (0 to 100) of the recorded
+ * values fall, or 0 if no values were recorded.
+ */
+uint64_t hist_percentile (const struct hist *h, double pct);
+
+/* Encode as a JSON object with count, min, mean, max and p50, p90, p99,
+ * p99.9 for display, plus the non-empty buckets for hist_decode().
+ */
+json_t *hist_encode (const struct hist *h);
+
+/* Decode an object created by hist_encode().
+ * Returns NULL on error (EPROTO if 'o' is not an encoded histogram).
+ */
+struct hist *hist_decode (json_t *o);
+
+#endif /* !_UTIL_HIST_H */
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
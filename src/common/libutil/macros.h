@@ -24,4 +24,9 @@
  */
 #define BASE64_DECODE_SIZE(x) ((((x) + 3) / 4) * 3)
 
+/* Compare numbers 'a' and 'b', returning -1, 0, or 1 as for qsort(3)
+ * and zlist/zhashx comparators.
+ */
+#define NUMCMP(a,b) ((a)==(b)?0:((a)<(b)?-1:1))
+
 #endif
@@ -0,0 +1,183 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* Non-intrusive variant of Dmitry Vyukov's MPSC queue.
+ *
+ * Producers atomically swap 'head' for their new node, then link the
+ * previous head to it.  The consumer owns 'tail', a dummy node whose
+ * successor holds the next item.  Between the swap and the link, the
+ * queue looks empty from 'tail', but 'head' has moved, so the consumer
+ * spins briefly rather than report an empty queue.
+ *
+ * 'pending' counts pushes less pops.  A producer that moves it from
+ * zero signals the eventfd.  The consumer drains the eventfd only after
+ * finding the queue empty, and then checks again, so a push can't slip
+ * between the check and the drain unnoticed.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+
+#include "mpscq.h"
+
+struct node {
+    struct node *next;
+    void *item;
+};
+
+struct mpscq_struct {
+    struct node *head;          /* producers */
+    struct node *tail;          /* consumer */
+    int pending;
+    int pollfd;
+    mpscq_free_f destructor;
+};
+
+static int raise_event (mpscq_t *q)
+{
+    uint64_t val = 1;
+
+    if (write (q->pollfd, &val, sizeof (val)) < 0)
+        return -1;
+    return 0;
+}
+
+static int clear_event (mpscq_t *q)
+{
+    uint64_t val;
+
+    if (read (q->pollfd, &val, sizeof (val)) < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+        errno = 0;
+    }
+    return 0;
+}
+
+static bool is_empty (mpscq_t *q)
+{
+    return (__atomic_load_n (&q->tail->next, __ATOMIC_ACQUIRE) == NULL
+            && __atomic_load_n (&q->head, __ATOMIC_ACQUIRE) == q->tail);
+}
+
+void mpscq_destroy (mpscq_t *q)
+{
+    if (q) {
+        int saved_errno = errno;
+        if (q->tail) {
+            void *item;
+            while ((item = mpscq_pop (q)))
+                if (q->destructor)
+                    q->destructor (item);
+            free (q->tail);
+        }
+        if (q->pollfd >= 0)
+            close (q->pollfd);
+        free (q);
+        errno = saved_errno;
+    }
+}
+
+mpscq_t *mpscq_create (mpscq_free_f fun)
+{
+    mpscq_t *q;
+
+    if (!(q = calloc (1, sizeof (*q))))
+        return NULL;
+    q->destructor = fun;
+    q->pollfd = -1;
+    if (!(q->tail = calloc (1, sizeof (*q->tail))))
+        goto error;
+    q->head = q->tail;
+    if ((q->pollfd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        goto error;
+    return q;
+error:
+    mpscq_destroy (q);
+    return NULL;
+}
+
+int mpscq_push (mpscq_t *q, void *item)
+{
+    struct node *n;
+    struct node *prev;
+
+    if (!item) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(n = malloc (sizeof (*n))))
+        return -1;
+    n->next = NULL;
+    n->item = item;
+    prev = __atomic_exchange_n (&q->head, n, __ATOMIC_ACQ_REL);
+    __atomic_store_n (&prev->next, n, __ATOMIC_RELEASE);
+    /* The item is queued now, so report success even if the wakeup
+     * fails.  Writing 1 to the eventfd can only fail if its counter
+     * would overflow, which cannot happen since the consumer reads it.
+     */
+    if (__atomic_fetch_add (&q->pending, 1, __ATOMIC_ACQ_REL) == 0)
+        (void)raise_event (q);
+    return 0;
+}
+
+void *mpscq_pop (mpscq_t *q)
+{
+    struct node *tail = q->tail;
+    struct node *next;
+    void *item;
+
+    if (!(next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE))) {
+        if (__atomic_load_n (&q->head, __ATOMIC_ACQUIRE) == tail)
+            return NULL;
+        while (!(next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE)))
+            sched_yield ();
+    }
+    q->tail = next;
+    item = next->item;
+    next->item = NULL;
+    free (tail);
+    __atomic_fetch_sub (&q->pending, 1, __ATOMIC_ACQ_REL);
+    return item;
+}
+
+int mpscq_pollfd (mpscq_t *q)
+{
+    return q->pollfd;
+}
+
+int mpscq_pollevents (mpscq_t *q)
+{
+    if (is_empty (q)) {
+        if (clear_event (q) < 0)
+            return -1;
+        if (is_empty (q))
+            return POLLOUT;
+        /* A push raced with clear_event(), and its signal may have been
+         * consumed.  Re-arm so the pollfd stays readable while non-empty.
+         */
+        if (raise_event (q) < 0)
+            return -1;
+    }
+    return POLLIN | POLLOUT;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
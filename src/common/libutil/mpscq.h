@@ -0,0 +1,63 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_MPSCQ_H
+#define _UTIL_MPSCQ_H
+
+#include <poll.h>
+
+/* Lock-free multiple-producer, single-consumer queue of pointers,
+ * with an eventfd for integration into the consumer's event loop.
+ * Any thread may push; only one thread may pop or call mpscq_pollevents().
+ */
+
+typedef struct mpscq_struct mpscq_t;
+
+typedef void (*mpscq_free_f)(void *item);
+
+/* Create/destroy queue.
+ * If 'fun' is non-NULL, mpscq_destroy () will use it to destroy any
+ * items on the queue at that time.
+ * Returns queue on success, NULL on error with errno set.
+ */
+mpscq_t *mpscq_create (mpscq_free_f fun);
+void mpscq_destroy (mpscq_t *q);
+
+/* Append 'item' to the queue (any thread).
+ * Returns 0 on success, -1 on error with errno set.  On error, 'item'
+ * was not queued and the caller still owns it.
+ */
+int mpscq_push (mpscq_t *q, void *item);
+
+/* Remove item from the head of the queue (consumer thread).
+ * Returns NULL if the queue is empty.
+ */
+void *mpscq_pop (mpscq_t *q);
+
+/* Get the queue 'pollevents' bitmask (consumer thread).
+ * POLLIN = items can be removed with mpscq_pop()
+ * POLLOUT = items can be added with mpscq_push() (always set)
+ * Returns pollevents on success, -1 on error with errno set.
+ */
+int mpscq_pollevents (mpscq_t *q);
+
+/* Obtain a file descriptor that becomes readable when POLLIN is raised.
+ * It is cleared only by mpscq_pollevents() on an empty queue, so
+ * it remains readable while items are queued.  This file descriptor
+ * belongs to mpscq_t and should not be operated on except to integrate
+ * mpscq_t into a poll/event loop.
+ */
+int mpscq_pollfd (mpscq_t *q);
+
+#endif /* !_UTIL_MPSCQ_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
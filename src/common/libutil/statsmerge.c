@@ -0,0 +1,194 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <jansson.h>
+
+#include "hist.h"
+#include "statsmerge.h"
+
+enum {
+    OP_ADD,
+    OP_SUBTRACT,
+};
+
+bool statsmerge_is_hist (json_t *o)
+{
+    return json_is_object (o) && json_object_get (o, "buckets") != NULL;
+}
+
+static json_t *combine_hist (json_t *dst, json_t *src, int op)
+{
+    struct hist *hd = NULL;
+    struct hist *hs = NULL;
+    json_t *o = NULL;
+    int rc;
+
+    if (!(hd = hist_decode (dst)) || !(hs = hist_decode (src)))
+        goto done;
+    if (op == OP_ADD)
+        rc = hist_merge (hd, hs);
+    else
+        rc = hist_subtract (hd, hs);
+    if (rc < 0)
+        goto done;
+    if (!(o = hist_encode (hd)))
+        errno = ENOMEM;
+done:
+    hist_destroy (hd);
+    hist_destroy (hs);
+    return o;
+}
+
+/* Return true if 'key' names a minimum (or maximum if 'max' is true),
+ * i.e. is "min", or has "min" as a '-' or '_' separated prefix or suffix.
+ */
+static bool is_extremum (const char *key, bool max)
+{
+    const char *word = max ? "max" : "min";
+    size_t len = strlen (key);
+
+    if (len < 3)
+        return false;
+    if (!strncmp (key, word, 3) && strchr ("-_", key[3]))
+        return true; // N.B. strchr() matches the terminating NUL
+    if (len > 3 && !strcmp (key + len - 3, word)
+        && strchr ("-_", key[len - 4]))
+        return true;
+    return false;
+}
+
+/* Return true if 's' is a new minimum (or maximum if 'max' is true).
+ */
+static bool is_new_extremum (json_t *d, json_t *s, bool max)
+{
+    double dv = json_number_value (d);
+    double sv = json_number_value (s);
+
+    return max ? sv > dv : sv < dv;
+}
+
+/* Average number 's' into 'd'.  'd' is the average of n values, where
+ * n is recorded under 'key' in 'counts', or 1 if not recorded yet.
+ */
+static json_t *combine_average (json_t *d, json_t *s,
+                                json_t *counts, const char *key)
+{
+    json_int_t n = 1;
+    json_t *c;
+
+    if ((c = json_object_get (counts, key)) && json_is_integer (c))
+        n = json_integer_value (c);
+    if (!(c = json_integer (n + 1))
+        || json_object_set_new (counts, key, c) < 0)
+        return NULL;
+    return json_real ((json_number_value (d) * n + json_number_value (s))
+                      / (n + 1));
+}
+
+/* Return the object of 'counts' for member 'key', creating it if needed.
+ */
+static json_t *counts_get_object (json_t *counts, const char *key)
+{
+    json_t *o;
+
+    if (!counts)
+        return NULL;
+    if (!(o = json_object_get (counts, key)) || !json_is_object (o)) {
+        if (!(o = json_object ())
+            || json_object_set_new (counts, key, o) < 0)
+            return NULL;
+    }
+    return o;
+}
+
+static int combine (json_t *dst, json_t *src, json_t *counts, int op)
+{
+    const char *key;
+    json_t *s;
+
+    json_object_foreach (src, key, s) {
+        json_t *d = json_object_get (dst, key);
+        json_t *o = NULL;
+
+        if (!d) {
+            if (op == OP_ADD && !(o = json_deep_copy (s)))
+                goto nomem;
+        }
+        else if (statsmerge_is_hist (d) && statsmerge_is_hist (s)) {
+            if (!(o = combine_hist (d, s, op)))
+                return -1;
+        }
+        else if (json_is_object (d) && json_is_object (s)) {
+            json_t *c = NULL;
+            if (op == OP_ADD && !(c = counts_get_object (counts, key)))
+                goto nomem;
+            if (combine (d, s, c, op) < 0)
+                return -1;
+        }
+        else if (json_is_number (d) && json_is_number (s)
+                 && (is_extremum (key, false) || is_extremum (key, true))) {
+            if (op == OP_ADD
+                && is_new_extremum (d, s, is_extremum (key, true))
+                && !(o = json_deep_copy (s)))
+                goto nomem;
+        }
+        else if (json_is_integer (d) && json_is_integer (s)) {
+            json_int_t i = json_integer_value (s);
+            if (op == OP_SUBTRACT) {
+                if (i > json_integer_value (d)) {
+                    errno = EINVAL;
+                    return -1;
+                }
+                i = -i;
+            }
+            if (!(o = json_integer (json_integer_value (d) + i)))
+                goto nomem;
+        }
+        else if (json_is_number (d) && json_is_number (s)) {
+            if (op == OP_ADD && !(o = combine_average (d, s, counts, key)))
+                goto nomem;
+        }
+        if (o && json_object_set_new (dst, key, o) < 0)
+            goto nomem;
+    }
+    return 0;
+nomem:
+    errno = ENOMEM;
+    return -1;
+}
+
+int statsmerge_add (json_t *dst, json_t *src, json_t *counts)
+{
+    if (!json_is_object (dst) || !json_is_object (src)
+        || !json_is_object (counts)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return combine (dst, src, counts, OP_ADD);
+}
+
+int statsmerge_subtract (json_t *dst, json_t *src)
+{
+    if (!json_is_object (dst) || !json_is_object (src)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return combine (dst, src, NULL, OP_SUBTRACT);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
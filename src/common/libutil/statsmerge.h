@@ -0,0 +1,49 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_STATSMERGE_H
+#define _UTIL_STATSMERGE_H
+
+#include <stdbool.h>
+#include <jansson.h>
+
+/* Combine JSON statistics objects, e.g. the responses of a stats
+ * service on several ranks, or current statistics and a snapshot.
+ * Objects are combined member by member, recursively.  Histograms
+ * (objects encoded by hist_encode()) are combined as histograms.
+ */
+
+/* Return true if 'o' is a histogram encoded by hist_encode().
+ */
+bool statsmerge_is_hist (json_t *o);
+
+/* Merge 'src' into 'dst': histograms are merged, members named "min"
+ * or "max" (or with a "min"/"max" prefix or suffix separated by '-' or
+ * '_') keep the minimum or maximum, other integers are summed, and other
+ * numbers are averaged.  Members of 'src' missing in 'dst' are copied.
+ * 'counts' is an object, initially empty, passed with every merge into
+ * the same 'dst'.  It records how many values each averaged member
+ * holds, so a member first seen in a later 'src' is weighted correctly.
+ * Returns -1 on error (ENOMEM, EPROTO, EINVAL), 0 on success.
+ */
+int statsmerge_add (json_t *dst, json_t *src, json_t *counts);
+
+/* Subtract 'src', an earlier snapshot of 'dst', from 'dst', leaving
+ * the histogram values and integer counts recorded in between.
+ * Members of 'src' missing in 'dst' are ignored, and minima, maxima and
+ * other numbers are left as they are.  Returns -1 on error (ENOMEM, EPROTO, or EINVAL if
+ * 'src' has counts that 'dst' does not), 0 on success.
+ */
+int statsmerge_subtract (json_t *dst, json_t *src);
+
+#endif /* !_UTIL_STATSMERGE_H */
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -31,8 +31,10 @@ static bool string_to_tv (char *s, struct timeval *tvp)
 {
     time_t t;
     struct tm tm;
-    char *p = strptime (s, "%Y-%m-%d %H:%M:%S", &tm);
+    char *p;
 
+    memset (&tm, 0, sizeof (tm));
+    p = strptime (s, "%Y-%m-%d %H:%M:%S", &tm);
     if ((t = mktime (&tm)) == (time_t) -1)
         return (false);
 
@@ -275,6 +277,68 @@ int main (int argc, char *argv[])
     rc = cronodate_next (d, &tm);
     ok (rc < 0, "cronodate_next() fails when now is >= matching date");
 
+    cronodate_fillset (d);
+    // Leap day, within 2 years
+    ok (cronodate_set (d, TM_SEC, "0") >= 0, "date glob set, sec = 0");
+    ok (cronodate_set (d, TM_MIN, "0") >= 0, "date glob set, min = 0");
+    ok (cronodate_set (d, TM_HOUR, "0") >= 0, "date glob set, hour = 0");
+    ok (cronodate_set (d, TM_MON, "1") >= 0, "date glob set, mon = 1 (Feb)");
+    ok (cronodate_set (d, TM_MDAY, "29") >= 0, "date glob set, mday = 29");
+    ok (cronodate_check_next (d, "2019-03-01 00:00:00", "2020-02-29 00:00:00"),
+        "cronodate_next found next leap day");
+    memset (&tm, 0, sizeof (tm));
+    ok (string_to_tm ("2020-03-01 00:00:00", &tm), "string_to_tm");
+    errno = 0;
+    ok (cronodate_next (d, &tm) < 0 && errno == EOVERFLOW,
+        "cronodate_next fails with EOVERFLOW beyond 2 years");
+
+    cronodate_fillset (d);
+    // Last day of long months only
+    ok (cronodate_set (d, TM_SEC, "0") >= 0, "date glob set, sec = 0");
+    ok (cronodate_set (d, TM_MIN, "30") >= 0, "date glob set, min = 30");
+    ok (cronodate_set (d, TM_HOUR, "23") >= 0, "date glob set, hour = 23");
+    ok (cronodate_set (d, TM_MDAY, "31") >= 0, "date glob set, mday = 31");
+    ok (cronodate_check_next (d, "2016-03-31 23:30:00", "2016-05-31 23:30:00"),
+        "cronodate_next skips months without the day");
+    ok (cronodate_check_next (d, "2016-12-31 23:29:59", "2016-12-31 23:30:00"),
+        "cronodate_next finds a match 1s away");
+
+    cronodate_fillset (d);
+    // Compare with a brute force search for a mix of sets
+    ok (cronodate_set (d, TM_SEC, "0") >= 0, "date glob set, sec = 0");
+    ok (cronodate_set (d, TM_MIN, "*/15") >= 0, "date glob set, min = */15");
+    ok (cronodate_set (d, TM_HOUR, "1-3,22") >= 0,
+        "date glob set, hour = 1-3,22");
+    ok (cronodate_set (d, TM_MDAY, "1-10,28-31") >= 0,
+        "date glob set, mday = 1-10,28-31");
+    ok (cronodate_set (d, TM_WDAY, "Mon,Fri,Sat") >= 0,
+        "date glob set, wday = Mon,Fri,Sat");
+    ok (string_to_tv ("2016-01-01 00:00:00", &tv), "string_to_tv");
+    {
+        time_t t = tv.tv_sec;
+        bool same = true;
+        for (i = 0; i < 500 && same; i++) {
+            struct tm next;
+            time_t expected = t;
+            if (!localtime_r (&t, &next) || cronodate_next (d, &next) < 0) {
+                same = false;
+                break;
+            }
+            do {
+                struct tm tmp;
+                expected += 15*60;
+                localtime_r (&expected, &tmp);
+                if (cronodate_match (d, &tmp))
+                    break;
+            } while (expected - t < 60*60*24*365);
+            if (mktime (&next) != expected)
+                same = false;
+            t = expected;
+        }
+        ok (same,
+            "cronodate_next agrees with brute force search");
+    }
+
     cronodate_fillset (d);
     // test cronodate_remaining ()
     ok (cronodate_set (d, TM_SEC, "0") >= 0, "date glob set, sec = 0");
@@ -0,0 +1,205 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <jansson.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/hist.h"
+
+/* Check that 'v' is within the relative error bound of 'expected'.
+ */
+static bool close_to (uint64_t v, uint64_t expected)
+{
+    uint64_t diff = v > expected ? v - expected : expected - v;
+    return diff <= expected / 32;
+}
+
+void basic (void)
+{
+    struct hist *h;
+
+    ok ((h = hist_create ()) != NULL,
+        "hist_create works");
+    ok (hist_count (h) == 0 && hist_min (h) == 0 && hist_max (h) == 0
+        && hist_mean (h) == 0. && hist_percentile (h, 50.) == 0,
+        "empty histogram reports zeroes");
+
+    ok (hist_record (h, 10) == 0 && hist_record (h, 20) == 0
+        && hist_record (h, 30) == 0,
+        "hist_record works");
+    ok (hist_count (h) == 3 && hist_min (h) == 10 && hist_max (h) == 30
+        && hist_mean (h) == 20.,
+        "count, min, max and mean are exact");
+    ok (hist_percentile (h, 50.) == 20,
+        "small values are counted exactly");
+    ok (hist_percentile (h, 0.) == 10 && hist_percentile (h, 100.) == 30,
+        "p0 is min and p100 is max");
+
+    hist_clear (h);
+    ok (hist_count (h) == 0 && hist_percentile (h, 50.) == 0,
+        "hist_clear works");
+
+    errno = 0;
+    ok (hist_record (NULL, 1) < 0 && errno == EINVAL,
+        "hist_record h=NULL fails with EINVAL");
+    hist_destroy (h);
+    hist_destroy (NULL);
+}
+
+void percentiles (void)
+{
+    struct hist *h;
+    uint64_t i;
+
+    if (!(h = hist_create ()))
+        BAIL_OUT ("hist_create failed");
+    for (i = 1; i <= 100000; i++)
+        hist_record (h, i);
+    ok (close_to (hist_percentile (h, 50.), 50000),
+        "p50 of 1..100000 is close to 50000");
+    ok (close_to (hist_percentile (h, 99.), 99000),
+        "p99 of 1..100000 is close to 99000");
+    ok (close_to (hist_percentile (h, 99.9), 99900),
+        "p99.9 of 1..100000 is close to 99900");
+    ok (hist_percentile (h, 99.999) <= 100000,
+        "percentiles do not exceed max");
+
+    hist_clear (h);
+    hist_record (h, UINT64_MAX);
+    hist_record (h, 1ULL << 40);
+    ok (hist_max (h) == UINT64_MAX
+        && hist_percentile (h, 100.) == UINT64_MAX
+        && close_to (hist_percentile (h, 50.), 1ULL << 40),
+        "large values are handled");
+    hist_destroy (h);
+}
+
+void merge (void)
+{
+    struct hist *a, *b;
+    int i;
+
+    if (!(a = hist_create ()) || !(b = hist_create ()))
+        BAIL_OUT ("hist_create failed");
+    for (i = 0; i < 99; i++)
+        hist_record (a, 100);
+    hist_record (b, 5);
+    hist_record (b, 1000000);
+    ok (hist_merge (a, b) == 0,
+        "hist_merge works");
+    ok (hist_count (a) == 101 && hist_min (a) == 5
+        && hist_max (a) == 1000000,
+        "merged count, min and max are correct");
+    ok (close_to (hist_percentile (a, 50.), 100)
+        && hist_percentile (a, 99.9) == 1000000,
+        "merged percentiles are correct");
+    hist_clear (b);
+    ok (hist_merge (a, b) == 0 && hist_count (a) == 101,
+        "merging an empty histogram is a no-op");
+    errno = 0;
+    ok (hist_merge (a, NULL) < 0 && errno == EINVAL,
+        "hist_merge src=NULL fails with EINVAL");
+    hist_destroy (a);
+    hist_destroy (b);
+}
+
+void subtract (void)
+{
+    struct hist *a, *b;
+    int i;
+
+    if (!(a = hist_create ()) || !(b = hist_create ()))
+        BAIL_OUT ("hist_create failed");
+    for (i = 0; i < 10; i++)
+        hist_record (a, 5);
+    hist_merge (b, a);
+    for (i = 0; i < 10; i++)
+        hist_record (b, 1000);
+    ok (hist_subtract (b, a) == 0,
+        "hist_subtract works");
+    ok (hist_count (b) == 10 && hist_mean (b) == 1000.
+        && close_to (hist_min (b), 1000) && hist_max (b) == 1000
+        && close_to (hist_percentile (b, 50.), 1000),
+        "difference contains only the values recorded in between");
+    ok (hist_subtract (b, b) == 0 && hist_count (b) == 0
+        && hist_min (b) == 0 && hist_max (b) == 0,
+        "subtracting a histogram from itself leaves it empty");
+    errno = 0;
+    ok (hist_subtract (b, a) < 0 && errno == EINVAL,
+        "hist_subtract fails with EINVAL if src is not a snapshot of dst");
+    hist_destroy (a);
+    hist_destroy (b);
+}
+
+void codec (void)
+{
+    struct hist *h, *h2;
+    json_t *o, *bad;
+    json_int_t p99;
+    int i;
+
+    if (!(h = hist_create ()))
+        BAIL_OUT ("hist_create failed");
+    for (i = 1; i <= 1000; i++)
+        hist_record (h, i * 10);
+    ok ((o = hist_encode (h)) != NULL,
+        "hist_encode works");
+    ok (json_unpack (o, "{s:I}", "p99", &p99) == 0
+        && p99 == (json_int_t)hist_percentile (h, 99.),
+        "encoded object includes percentiles");
+    ok ((h2 = hist_decode (o)) != NULL,
+        "hist_decode works");
+    ok (hist_count (h2) == hist_count (h)
+        && hist_min (h2) == hist_min (h)
+        && hist_max (h2) == hist_max (h)
+        && hist_mean (h2) == hist_mean (h)
+        && hist_percentile (h2, 99.9) == hist_percentile (h, 99.9),
+        "decoded histogram matches the original");
+    hist_destroy (h2);
+
+    bad = json_deep_copy (o);
+    json_object_set_new (bad, "count", json_integer (1));
+    errno = 0;
+    ok (hist_decode (bad) == NULL && errno == EPROTO,
+        "hist_decode fails with EPROTO on inconsistent count");
+    json_decref (bad);
+    bad = json_pack ("{s:i}", "count", 0);
+    errno = 0;
+    ok (hist_decode (bad) == NULL && errno == EPROTO,
+        "hist_decode fails with EPROTO on missing buckets");
+    json_decref (bad);
+
+    json_decref (o);
+    hist_destroy (h);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    basic ();
+    percentiles ();
+    merge ();
+    subtract ();
+    codec ();
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,174 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <poll.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/mpscq.h"
+#include "src/common/libutil/xzmalloc.h"
+
+#define NTHREADS    4
+#define NITEMS      10000
+
+struct producer {
+    mpscq_t *q;
+    int id;
+    pthread_t t;
+    int errors;
+};
+
+static void *producer_thread (void *arg)
+{
+    struct producer *p = arg;
+    int i;
+
+    for (i = 0; i < NITEMS; i++) {
+        int *item = xzmalloc (sizeof (*item) * 2);
+        item[0] = p->id;
+        item[1] = i;
+        if (mpscq_push (p->q, item) < 0)
+            p->errors++;
+    }
+    return NULL;
+}
+
+static int poll_readable (mpscq_t *q, int timeout)
+{
+    struct pollfd pfd = {
+        .fd = mpscq_pollfd (q),
+        .events = POLLIN,
+        .revents = 0,
+    };
+    return poll (&pfd, 1, timeout);
+}
+
+/* Consume from NTHREADS producers, waiting on the pollfd as a reactor
+ * would, and check that each producer's items arrive in order.
+ */
+static void test_threads (void)
+{
+    mpscq_t *q;
+    struct producer p[NTHREADS];
+    int next[NTHREADS];
+    int count = 0;
+    int errors = 0;
+    int order_errors = 0;
+    int i, e;
+
+    if (!(q = mpscq_create (free)))
+        BAIL_OUT ("mpscq_create failed");
+    for (i = 0; i < NTHREADS; i++) {
+        p[i].q = q;
+        p[i].id = i;
+        p[i].errors = 0;
+        next[i] = 0;
+        if ((e = pthread_create (&p[i].t, NULL, producer_thread, &p[i])))
+            BAIL_OUT ("pthread_create: %s", strerror (e));
+    }
+    while (count < NTHREADS * NITEMS) {
+        int *item;
+        if (poll_readable (q, 5000) != 1) {
+            diag ("timed out waiting for pollfd");
+            break;
+        }
+        if (!(mpscq_pollevents (q) & POLLIN))
+            continue;
+        while ((item = mpscq_pop (q))) {
+            if (item[0] < 0 || item[0] >= NTHREADS)
+                errors++;
+            else if (item[1] != next[item[0]]++)
+                order_errors++;
+            free (item);
+            count++;
+        }
+    }
+    for (i = 0; i < NTHREADS; i++) {
+        pthread_join (p[i].t, NULL);
+        errors += p[i].errors;
+    }
+    ok (count == NTHREADS * NITEMS && errors == 0,
+        "consumed %d items from %d producers", count, NTHREADS);
+    ok (order_errors == 0,
+        "items from each producer were received in order");
+    ok (mpscq_pollevents (q) == POLLOUT && poll_readable (q, 0) == 0,
+        "queue is empty and pollfd is not ready");
+    mpscq_destroy (q);
+}
+
+int main (int argc, char *argv[])
+{
+    mpscq_t *q;
+    char *item;
+    int e;
+
+    plan (NO_PLAN);
+
+    ok ((q = mpscq_create (free)) != NULL,
+        "mpscq_create works");
+    ok (mpscq_pollfd (q) >= 0,
+        "mpscq_pollfd works");
+    ok ((e = mpscq_pollevents (q)) == POLLOUT,
+        "mpscq_pollevents on empty queue returns POLLOUT");
+    ok (poll_readable (q, 0) == 0,
+        "pollfd is not ready");
+    ok (mpscq_pop (q) == NULL,
+        "mpscq_pop on empty queue returns NULL");
+
+    errno = 0;
+    ok (mpscq_push (q, NULL) < 0 && errno == EINVAL,
+        "mpscq_push item=NULL fails with EINVAL");
+
+    ok (mpscq_push (q, xstrdup ("foo")) == 0,
+        "mpscq_push 'foo' works");
+    ok (poll_readable (q, 0) == 1,
+        "pollfd is ready");
+    ok (mpscq_push (q, xstrdup ("bar")) == 0,
+        "mpscq_push 'bar' works");
+    ok ((e = mpscq_pollevents (q)) == (POLLIN | POLLOUT),
+        "mpscq_pollevents returns POLLIN | POLLOUT");
+    ok (poll_readable (q, 0) == 1,
+        "pollfd is still ready");
+    ok ((item = mpscq_pop (q)) != NULL && !strcmp (item, "foo"),
+        "mpscq_pop returns 'foo'");
+    free (item);
+    ok ((e = mpscq_pollevents (q)) == (POLLIN | POLLOUT),
+        "mpscq_pollevents returns POLLIN | POLLOUT");
+    ok (poll_readable (q, 0) == 1,
+        "pollfd is ready while items remain");
+    ok ((item = mpscq_pop (q)) != NULL && !strcmp (item, "bar"),
+        "mpscq_pop returns 'bar'");
+    free (item);
+    ok (mpscq_pop (q) == NULL,
+        "mpscq_pop returns NULL");
+    ok ((e = mpscq_pollevents (q)) == POLLOUT,
+        "mpscq_pollevents returns POLLOUT");
+    ok (poll_readable (q, 0) == 0,
+        "pollfd is no longer ready");
+
+    ok (mpscq_push (q, xstrdup ("baz")) == 0,
+        "mpscq_push 'baz' works");
+    ok (poll_readable (q, 0) == 1,
+        "pollfd is ready");
+    mpscq_destroy (q);
+    pass ("mpscq_destroy freed the remaining item");
+
+    test_threads ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
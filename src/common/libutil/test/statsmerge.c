@@ -0,0 +1,218 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <jansson.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libutil/hist.h"
+#include "src/common/libutil/statsmerge.h"
+
+static json_t *hist_of (uint64_t v1, uint64_t v2)
+{
+    struct hist *h;
+    json_t *o;
+
+    if (!(h = hist_create ())
+        || hist_record (h, v1) < 0
+        || hist_record (h, v2) < 0
+        || !(o = hist_encode (h)))
+        BAIL_OUT ("could not create histogram");
+    hist_destroy (h);
+    return o;
+}
+
+static json_t *stats_create (int count, double load, uint64_t v1, uint64_t v2)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{s:i s:f s:{s:i s:o}}",
+                         "count", count,
+                         "load", load,
+                         "sub",
+                           "count", count,
+                           "latency", hist_of (v1, v2))))
+        BAIL_OUT ("could not create stats object");
+    return o;
+}
+
+static uint64_t hist_count_of (json_t *o)
+{
+    struct hist *h;
+    uint64_t count;
+
+    if (!(h = hist_decode (o)))
+        BAIL_OUT ("could not decode histogram");
+    count = hist_count (h);
+    hist_destroy (h);
+    return count;
+}
+
+void add (void)
+{
+    json_t *dst = stats_create (1, 1., 10, 20);
+    json_t *src = stats_create (2, 3., 30, 40);
+    json_t *extra;
+    json_t *counts;
+    json_int_t count, subcount;
+    double load;
+    json_t *latency;
+
+    ok (statsmerge_is_hist (json_object_get (json_object_get (dst, "sub"),
+                                             "latency")) == true,
+        "statsmerge_is_hist is true for encoded histogram");
+    ok (statsmerge_is_hist (dst) == false,
+        "statsmerge_is_hist is false for other object");
+
+    if (!(extra = json_pack ("{s:s}", "name", "foo"))
+        || json_object_set_new (src, "extra", extra) < 0)
+        BAIL_OUT ("could not add extra member");
+    if (!(counts = json_object ()))
+        BAIL_OUT ("json_object failed");
+    ok (statsmerge_add (dst, src, counts) == 0,
+        "statsmerge_add works");
+    ok (json_unpack (dst, "{s:I s:F s:{s:I s:o}}",
+                     "count", &count,
+                     "load", &load,
+                     "sub",
+                       "count", &subcount,
+                       "latency", &latency) == 0
+        && count == 3 && subcount == 3,
+        "integers were summed");
+    ok (load == 2.,
+        "reals were averaged");
+    ok (hist_count_of (latency) == 4,
+        "histograms were merged");
+    ok (json_object_get (dst, "extra") != NULL,
+        "missing member was copied");
+
+    errno = 0;
+    ok (statsmerge_add (dst, NULL, counts) < 0 && errno == EINVAL,
+        "statsmerge_add src=NULL fails with EINVAL");
+    errno = 0;
+    ok (statsmerge_add (dst, src, NULL) < 0 && errno == EINVAL,
+        "statsmerge_add counts=NULL fails with EINVAL");
+
+    json_decref (counts);
+    json_decref (dst);
+    json_decref (src);
+}
+
+/* Merge three "ranks" where "late" first appears on the second one.
+ */
+void add_per_key (void)
+{
+    json_t *dst, *src1, *src2, *counts;
+    double load, late;
+    json_int_t min, max, max_topics, count;
+
+    if (!(dst = json_pack ("{s:f s:i s:i s:i s:i}",
+                           "load", 1.,
+                           "min", 5,
+                           "max", 5,
+                           "max-topics", 8,
+                           "count", 1))
+        || !(src1 = json_pack ("{s:f s:f s:i s:i s:i s:i}",
+                               "load", 2.,
+                               "late", 10.,
+                               "min", 3,
+                               "max", 4,
+                               "max-topics", 16,
+                               "count", 1))
+        || !(src2 = json_pack ("{s:f s:f s:i s:i s:i s:i}",
+                               "load", 6.,
+                               "late", 20.,
+                               "min", 4,
+                               "max", 9,
+                               "max-topics", 4,
+                               "count", 1))
+        || !(counts = json_object ()))
+        BAIL_OUT ("could not create stats objects");
+    ok (statsmerge_add (dst, src1, counts) == 0
+        && statsmerge_add (dst, src2, counts) == 0,
+        "statsmerge_add works on three objects");
+    ok (json_unpack (dst, "{s:F s:F s:I s:I s:I s:I}",
+                     "load", &load,
+                     "late", &late,
+                     "min", &min,
+                     "max", &max,
+                     "max-topics", &max_topics,
+                     "count", &count) == 0,
+        "merged object has expected members");
+    ok (load == 3.,
+        "real is averaged over all three objects");
+    ok (late == 15.,
+        "real first seen in second object is averaged over two");
+    ok (min == 3 && max == 9 && max_topics == 16,
+        "min and max members keep the minimum and maximum");
+    ok (count == 3,
+        "other integers are summed");
+
+    json_decref (counts);
+    json_decref (dst);
+    json_decref (src1);
+    json_decref (src2);
+}
+
+void subtract (void)
+{
+    json_t *snap = stats_create (1, 1., 10, 20);
+    json_t *cur = stats_create (1, 1., 10, 20);
+    json_t *more = stats_create (2, 5., 30, 40);
+    json_t *latency;
+    json_int_t count;
+    double load;
+    json_t *counts;
+
+    if (!(counts = json_object ())
+        || statsmerge_add (cur, more, counts) < 0)
+        BAIL_OUT ("statsmerge_add failed");
+    json_decref (counts);
+    ok (statsmerge_subtract (cur, snap) == 0,
+        "statsmerge_subtract works");
+    ok (json_unpack (cur, "{s:I s:F s:{s:o}}",
+                     "count", &count,
+                     "load", &load,
+                     "sub",
+                       "latency", &latency) == 0
+        && count == 2 && load == 3.,
+        "integers were subtracted and reals left alone");
+    ok (hist_count_of (latency) == 2,
+        "histograms were subtracted");
+
+    errno = 0;
+    ok (statsmerge_subtract (snap, more) < 0 && errno == EINVAL,
+        "statsmerge_subtract of a newer snapshot fails with EINVAL");
+
+    json_decref (snap);
+    json_decref (cur);
+    json_decref (more);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    add ();
+    add_per_key ();
+    subtract ();
+
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
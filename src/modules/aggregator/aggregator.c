@@ -8,12 +8,24 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
-/* aggregator.c - reduction based numerical aggreagator */
+/* aggregator.c - reduction based numerical aggreagator
+ *
+ * Entries of an aggregate are indexed by the canonical (compact, sorted)
+ * JSON encoding of their value, so each push merges its ids in constant
+ * time per entry regardless of how many distinct values there are.
+ *
+ * Ranks > 0 forward an aggregate upstream and drop it, so each forward
+ * carries only the entries pushed since the previous one.  On rank 0,
+ * aggregates completed during one pass of the reactor loop are written
+ * to the KVS in a single transaction.
+ */
 
 #if HAVE_CONFIG_H
 #include "config.h"
 #endif
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
 #include <flux/core.h>
 #include <czmq.h>
 #include <jansson.h>
@@ -26,6 +38,10 @@ struct aggregator {
     double default_timeout;
     double timer_scale;
     zhash_t *aggregates;
+    zlist_t *sinks;          /* aggregates to sink in the next transaction   */
+    flux_watcher_t *prep_w;
+    flux_watcher_t *check_w;
+    flux_watcher_t *idle_w;
 };
 
 /*
@@ -34,6 +50,7 @@ struct aggregator {
 struct aggregate_entry {
     struct idset *ids;
     json_t *value;
+    char *vkey;              /* canonical encoding of value, the hash key    */
 };
 
 
@@ -51,7 +68,8 @@ struct aggregate {
     char *key;               /* KVS key into which to sink the aggregate     */
     uint32_t count;          /* count of current total entries               */
     uint32_t total;          /* expected total entries (used for sink)       */
-    zlist_t *entries;        /* list of individual entries                   */
+    bool sinking;            /* queued for or in a sink to the kvs           */
+    zhashx_t *entries;       /* individual entries, by value encoding        */
     json_t *summary;         /* optional summary stats for this aggregate    */
 };
 
@@ -60,6 +78,8 @@ static void aggregate_entry_destroy (struct aggregate_entry *ae)
     if (ae) {
         int saved_errno = errno;
         idset_destroy (ae->ids);
+        json_decref (ae->value);
+        free (ae->vkey);
         free (ae);
         errno = saved_errno;
     }
@@ -78,18 +98,20 @@ static struct aggregate_entry * aggregate_entry_create (void)
 }
 
 
-/*  Search this aggregates entries for a value. Return entry if found
- */
-static struct aggregate_entry *
-    aggregate_entry_find (struct aggregate *ag, json_t *value)
+static void aggregate_entry_free (void **item)
 {
-    struct aggregate_entry *ae = zlist_first (ag->entries);
-    while (ae) {
-        if (json_equal (ae->value, value))
-            return (ae);
-        ae = zlist_next (ag->entries);
+    if (item) {
+        aggregate_entry_destroy (*item);
+        *item = NULL;
     }
-    return (NULL);
+}
+
+/*  Return the canonical encoding of an entry value. Values that are
+ *   json_equal() encode to the same string.
+ */
+static char *value_encode (json_t *value)
+{
+    return json_dumps (value, JSON_COMPACT | JSON_SORT_KEYS | JSON_ENCODE_ANY);
 }
 
 static int summarize_real (struct aggregate *ag, json_t *value)
@@ -152,43 +174,62 @@ static int aggregate_update_summary (struct aggregate *ag, json_t *value)
     return (0);
 }
 
-/*  Add a new aggregate entry to this aggregate.
- *   Update summary stats if update == true.
+/*  Add a new aggregate entry to this aggregate, taking ownership of
+ *   value encoding `vkey`.
  */
 static struct aggregate_entry *
-    aggregate_entry_add (struct aggregate *ag, json_t *value)
+    aggregate_entry_add (struct aggregate *ag, json_t *value, char *vkey)
 {
     struct aggregate_entry *ae = aggregate_entry_create ();
-    if (ae) {
-        json_incref (value);
-        ae->value = value;
-
-        /* Update aggregate summary statistics on rank 0 only */
-        if (ag->ctx->rank == 0 && aggregate_update_summary (ag, value) < 0)
-            flux_log_error (ag->ctx->h, "aggregate_update_summary");
-        zlist_push (ag->entries, ae);
+    if (!ae)
+        return (NULL);
+    ae->vkey = vkey;
+    if (zhashx_insert (ag->entries, ae->vkey, ae) < 0) {
+        aggregate_entry_destroy (ae);
+        errno = EEXIST;
+        return (NULL);
     }
+    json_incref (value);
+    ae->value = value;
+
+    /* Update aggregate summary statistics on rank 0 only */
+    if (ag->ctx->rank == 0 && aggregate_update_summary (ag, value) < 0)
+        flux_log_error (ag->ctx->h, "aggregate_update_summary");
     return (ae);
 }
 
+/*  Add ids encoded in `s`, e.g. "[0-3,7]", to `idset` a range at a time,
+ *   without decoding them into a temporary idset.
+ */
 int add_string_to_idset (struct idset *idset, const char *s)
 {
-    struct idset *nids;
-    unsigned int id;
-    int rc = -1;
-
-    if (!(nids = idset_decode (s)))
-        return (-1);
-    id = idset_first (nids);
-    while (id != IDSET_INVALID_ID) {
-        if (idset_set (idset, id) < 0)
-            goto done;
-        id = idset_next (nids, id);
+    unsigned long lo, hi;
+    char *endptr;
+
+    if (*s == '[')
+        s++;
+    while (*s != '\0' && *s != ']') {
+        lo = hi = strtoul (s, &endptr, 10);
+        if (endptr == s || lo >= UINT_MAX)
+            goto inval;
+        s = endptr;
+        if (*s == '-') {
+            hi = strtoul (++s, &endptr, 10);
+            if (endptr == s || hi >= UINT_MAX)
+                goto inval;
+            s = endptr;
+        }
+        if (idset_range_set (idset, lo, hi) < 0)
+            return (-1);
+        if (*s == ',')
+            s++;
+        else if (*s != '\0' && *s != ']')
+            goto inval;
     }
-    rc = 0;
-done:
-    idset_destroy (nids);
-    return rc;
+    return (0);
+inval:
+    errno = EINVAL;
+    return (-1);
 }
 
 /*  Push a new (ids, value) pair onto aggregate `ag`.
@@ -199,8 +240,16 @@ done:
 static int aggregate_push (struct aggregate *ag, json_t *value, const char *ids)
 {
     int count;
-    struct aggregate_entry *ae = aggregate_entry_find (ag, value);
-    if ((ae == NULL) && !(ae = aggregate_entry_add (ag, value)))
+    struct aggregate_entry *ae;
+    char *vkey;
+
+    if (!(vkey = value_encode (value))) {
+        errno = EINVAL;
+        return (-1);
+    }
+    if ((ae = zhashx_lookup (ag->entries, vkey)))
+        free (vkey);
+    else if (!(ae = aggregate_entry_add (ag, value, vkey)))
         return (-1);
 
     count = idset_count (ae->ids);
@@ -254,11 +303,12 @@ static json_t *aggregate_entries_tojson (struct aggregate *ag)
     if (!(entries = json_object ()))
         return NULL;
 
-    ae = zlist_first (ag->entries);
+    ae = zhashx_first (ag->entries);
     while (ae) {
-        if (set_json_object_new_idset_key (entries, ae->ids, ae->value) < 0)
+        if (set_json_object_new_idset_key (entries, ae->ids,
+                                           json_incref (ae->value)) < 0)
             goto error;
-        ae = zlist_next (ag->entries);
+        ae = zhashx_next (ag->entries);
     }
     return (entries);
 error:
@@ -361,23 +411,32 @@ static int sink_retry (flux_t *h, struct aggregate *ag)
     return (0);
 }
 
+/*  Schedule a retry of a failed sink. If that fails, abort the
+ *   aggregate and remove it.
+ */
+static void sink_failed (flux_t *h, struct aggregate *ag)
+{
+    if (sink_retry (h, ag) == 0)
+        return;
+    aggregate_sink_abort (h, ag);
+    zhash_delete (ag->ctx->aggregates, ag->key);
+}
+
 static void sink_continuation (flux_future_t *f, void *arg)
 {
     flux_t *h = flux_future_get_flux (f);
-    struct aggregate *ag = arg;
+    zlist_t *batch = arg;
+    struct aggregate *ag;
 
     int rc = flux_future_get (f, NULL);
     flux_future_destroy (f);
-    if (rc < 0) {
-        /*  Schedule a retry, if  succesful return immediately, otherwise
-         *   abort the current aggregate and remove it.
-         */
-        if (sink_retry (h, ag) == 0)
-            return;
-        aggregate_sink_abort (h, ag);
+    while ((ag = zlist_pop (batch))) {
+        if (rc < 0)
+            sink_failed (h, ag);
+        else
+            zhash_delete (ag->ctx->aggregates, ag->key);
     }
-    zhash_delete (ag->ctx->aggregates, ag->key);
-    return;
+    zlist_destroy (&batch);
 }
 
 static char *aggregate_to_string (struct aggregate *ag)
@@ -410,47 +469,115 @@ static char *aggregate_to_string (struct aggregate *ag)
 }
 
 
+/*  Queue aggregate `ag` to be written to the kvs. Aggregates queued
+ *   during one pass of the reactor loop are committed together by
+ *   aggregator_sink().
+ */
 static void aggregate_sink (flux_t *h, struct aggregate *ag)
 {
-    int rc = -1;
-    char *agstr = NULL;
-    flux_kvs_txn_t *txn = NULL;
-    flux_future_t *f = NULL;
-
     flux_log (h, LOG_DEBUG, "sink: %s: count=%d total=%d",
                 ag->key, ag->count, ag->total);
+    ag->sinking = true;
+    if (zlist_append (ag->ctx->sinks, ag) < 0) {
+        flux_log (h, LOG_ERR, "sink: %s: out of memory", ag->key);
+        aggregate_sink_abort (h, ag);
+        zhash_delete (ag->ctx->aggregates, ag->key);
+    }
+}
+
+/*  Add aggregate `ag` to kvs transaction `txn`.
+ */
+static int aggregate_sink_put (flux_t *h, struct aggregate *ag,
+                               flux_kvs_txn_t *txn)
+{
+    char *agstr;
+    int rc = -1;
 
     /* Fail on key == "." */
     if (strcmp (ag->key, ".") == 0) {
         flux_log (h, LOG_ERR, "sink: refusing to sink to rootdir");
-        goto out;
+        return (-1);
     }
     if (!(agstr = aggregate_to_string (ag))) {
         flux_log (h, LOG_ERR, "sink: aggregate_to_string failed");
-        goto out;
+        return (-1);
     }
+    if (flux_kvs_txn_put (txn, 0, ag->key, agstr) < 0)
+        flux_log_error (h, "sink: flux_kvs_txn_put");
+    else
+        rc = 0;
+    free (agstr);
+    return (rc);
+}
+
+/*  Commit all queued aggregates in a single kvs transaction.
+ */
+static void aggregator_sink (struct aggregator *ctx)
+{
+    flux_t *h = ctx->h;
+    flux_kvs_txn_t *txn = NULL;
+    flux_future_t *f = NULL;
+    zlist_t *batch = NULL;
+    struct aggregate *ag;
+
     if (!(txn = flux_kvs_txn_create ())) {
         flux_log_error (h, "sink: flux_kvs_txn_create");
-        goto out;
+        goto error;
     }
-    if (flux_kvs_txn_put (txn, 0, ag->key, agstr) < 0) {
-        flux_log_error (h, "sink: flux_kvs_txn_put");
-        goto out;
+    if (!(batch = zlist_new ())) {
+        errno = ENOMEM;
+        flux_log_error (h, "sink: zlist_new");
+        goto error;
     }
+    while ((ag = zlist_pop (ctx->sinks))) {
+        if (aggregate_sink_put (h, ag, txn) < 0)
+            sink_failed (h, ag);
+        else if (zlist_append (batch, ag) < 0) {
+            flux_log (h, LOG_ERR, "sink: %s: out of memory", ag->key);
+            sink_failed (h, ag);
+        }
+    }
+    if (zlist_size (batch) == 0)
+        goto done;
+    flux_log (h, LOG_DEBUG, "sink: committing %zu aggregates",
+              zlist_size (batch));
     if (!(f = flux_kvs_commit (h, NULL, 0, txn))
-        || flux_future_then (f, -1., sink_continuation, (void *)ag) < 0) {
+        || flux_future_then (f, -1., sink_continuation, batch) < 0) {
         flux_log_error (h, "sink: flux_kvs_commit");
         flux_future_destroy (f);
-        goto out;
+        goto error;
     }
-    rc = 0;
-out:
     flux_kvs_txn_destroy (txn);
-    free (agstr);
-    if ((rc < 0) && (sink_retry (h, ag) < 0)) {
-        aggregate_sink_abort (h, ag);
-        zhash_delete (ag->ctx->aggregates, ag->key);
+    return;
+error:
+    if (batch) {
+        while ((ag = zlist_pop (batch)))
+            sink_failed (h, ag);
     }
+    while ((ag = zlist_pop (ctx->sinks)))
+        sink_failed (h, ag);
+done:
+    zlist_destroy (&batch);
+    flux_kvs_txn_destroy (txn);
+}
+
+static void prep_cb (flux_reactor_t *r, flux_watcher_t *w,
+                     int revents, void *arg)
+{
+    struct aggregator *ctx = arg;
+
+    if (zlist_size (ctx->sinks) > 0)
+        flux_watcher_start (ctx->idle_w);
+}
+
+static void check_cb (flux_reactor_t *r, flux_watcher_t *w,
+                      int revents, void *arg)
+{
+    struct aggregator *ctx = arg;
+
+    flux_watcher_stop (ctx->idle_w);
+    if (zlist_size (ctx->sinks) > 0)
+        aggregator_sink (ctx);
 }
 
 /*
@@ -468,12 +595,7 @@ static int aggregate_flush (struct aggregate *ag)
 
 static void aggregate_destroy (struct aggregate *ag)
 {
-    struct aggregate_entry *ae = zlist_first (ag->entries);
-    while (ae) {
-        aggregate_entry_destroy (ae);
-        ae = zlist_next (ag->entries);
-    }
-    zlist_destroy (&ag->entries);
+    zhashx_destroy (&ag->entries);
     json_decref (ag->summary);
     flux_watcher_destroy (ag->tw);
     free (ag->key);
@@ -517,11 +639,14 @@ static struct aggregate *
         return NULL;
 
     ag->ctx = ctx;
-    if (!(ag->key = strdup (key)) || !(ag->entries = zlist_new ())) {
+    if (!(ag->key = strdup (key)) || !(ag->entries = zhashx_new ())) {
         flux_log_error (h, "aggregate_create: memory allocation error");
         aggregate_destroy (ag);
         return (NULL);
     }
+    zhashx_set_key_duplicator (ag->entries, NULL);
+    zhashx_set_key_destructor (ag->entries, NULL);
+    zhashx_set_destructor (ag->entries, aggregate_entry_free);
     ag->sink_retries = 2;
     return (ag);
 }
@@ -529,6 +654,10 @@ static struct aggregate *
 static void aggregator_destroy (struct aggregator *ctx)
 {
     if (ctx) {
+        flux_watcher_destroy (ctx->prep_w);
+        flux_watcher_destroy (ctx->check_w);
+        flux_watcher_destroy (ctx->idle_w);
+        zlist_destroy (&ctx->sinks);
         zhash_destroy (&ctx->aggregates);
         free (ctx);
     }
@@ -572,10 +701,21 @@ static struct aggregator * aggregator_create (flux_t *h)
     }
     ctx->default_timeout = 0.01;
     ctx->timer_scale = timer_scale (h);
-    if (!(ctx->aggregates = zhash_new ())) {
+    if (!(ctx->aggregates = zhash_new ()) || !(ctx->sinks = zlist_new ())) {
         flux_log_error (h, "zhash_new");
         goto error;
     }
+    if (ctx->rank == 0) {
+        flux_reactor_t *r = flux_get_reactor (h);
+        if (!(ctx->prep_w = flux_prepare_watcher_create (r, prep_cb, ctx))
+            || !(ctx->check_w = flux_check_watcher_create (r, check_cb, ctx))
+            || !(ctx->idle_w = flux_idle_watcher_create (r, NULL, NULL))) {
+            flux_log_error (h, "flux_watcher_create");
+            goto error;
+        }
+        flux_watcher_start (ctx->prep_w);
+        flux_watcher_start (ctx->check_w);
+    }
     return (ctx);
 error:
     aggregator_destroy (ctx);
@@ -651,7 +791,7 @@ static void push_cb (flux_t *h, flux_msg_handler_t *mh,
             if (aggregate_flush (ag) < 0)
                 goto error;
     }
-    else if (ag->count == ag->total)
+    else if (ag->count == ag->total && !ag->sinking)
         aggregate_sink (h, ag);
     if (flux_respond (h, msg, NULL) < 0)
         flux_log_error (h, "aggregator.push: flux_respond");
@@ -8,12 +8,29 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
+/* barrier.c - hierarchical barrier
+ *
+ * Clients enter a barrier on their local broker.  Each broker sums the
+ * entries from its TBON subtree and passes the sum upstream, and rank 0
+ * publishes barrier.exit once all 'nprocs' have entered.
+ *
+ * Entries are passed upstream after a short delay, batching those
+ * arriving together.  When 'nprocs' is a multiple of the session size,
+ * processes are assumed to be spread evenly over brokers, so a broker
+ * expects nprocs / size entries per broker in its subtree, and passes
+ * the sum upstream without waiting once its subtree is complete.
+ *
+ * For each client waiting on the barrier, only the request matchtag and
+ * route are kept, enough to rebuild its response.
+ */
+
 #if HAVE_CONFIG_H
 #include "config.h"
 #endif
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
@@ -33,19 +50,33 @@ typedef struct {
     bool timer_armed;
     flux_watcher_t *timer;
     uint32_t rank;
+    uint32_t size;
+    int subtree;            /* number of brokers in this broker's subtree */
 } barrier_ctx_t;
 
+struct waiter {
+    uint32_t matchtag;
+    char *route;            /* route ids, first to last, each \0 terminated,
+                             * followed by an empty id */
+};
+
 typedef struct _barrier_struct {
     char *name;
     int nprocs;
-    int count;
-    zhash_t *clients;
+    int count;              /* entries not yet passed upstream */
+    int total;              /* entries from this subtree */
+    int expected;           /* entries expected from this subtree, or 0 */
+    struct waiter *waiters;
+    int nwaiters;
+    int maxwaiters;
+    zhashx_t *senders;      /* sender id => waiter index + 1 */
     barrier_ctx_t *ctx;
     int errnum;
     flux_watcher_t *debug_timer;
 } barrier_t;
 
 static int exit_event_send (flux_t *h, const char *name, int errnum);
+static void send_enter_request (barrier_ctx_t *ctx, barrier_t *b);
 static void timeout_cb (flux_reactor_t *r, flux_watcher_t *w,
                         int revents, void *arg);
 
@@ -63,6 +94,7 @@ static void freectx (void *arg)
 static barrier_ctx_t *getctx (flux_t *h)
 {
     barrier_ctx_t *ctx = (barrier_ctx_t *)flux_aux_get (h, "flux::barrier");
+    const char *s;
 
     if (!ctx) {
         ctx = xzmalloc (sizeof (*ctx));
@@ -74,6 +106,15 @@ static barrier_ctx_t *getctx (flux_t *h)
             flux_log_error (h, "flux_get_rank");
             goto error;
         }
+        if (flux_get_size (h, &ctx->size) < 0) {
+            flux_log_error (h, "flux_get_size");
+            goto error;
+        }
+        if (!(s = flux_attr_get (h, "tbon.descendants"))) {
+            flux_log_error (h, "tbon.descendants");
+            goto error;
+        }
+        ctx->subtree = strtoul (s, NULL, 10) + 1;
         if (!(ctx->timer = flux_timer_watcher_create (flux_get_reactor (h),
                        barrier_reduction_timeout_sec, 0., timeout_cb, ctx) )) {
             flux_log_error (h, "flux_timer_watacher_create");
@@ -99,18 +140,32 @@ static void debug_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
 static void barrier_destroy (void *arg)
 {
     barrier_t *b = arg;
+    int i;
 
     if (b->debug_timer) {
         flux_log (b->ctx->h, LOG_DEBUG, "destroy %s %d", b->name, b->nprocs);
         flux_watcher_stop (b->debug_timer);
         flux_watcher_destroy (b->debug_timer);
     }
-    zhash_destroy (&b->clients);
+    zhashx_destroy (&b->senders);
+    for (i = 0; i < b->nwaiters; i++)
+        free (b->waiters[i].route);
+    free (b->waiters);
     free (b->name);
     free (b);
     return;
 }
 
+/* Return the number of entries expected from this broker's subtree,
+ * or 0 if unknown.
+ */
+static int subtree_expected (barrier_ctx_t *ctx, int nprocs)
+{
+    if (ctx->rank == 0 || nprocs <= 0 || nprocs % ctx->size != 0)
+        return 0;
+    return nprocs / ctx->size * ctx->subtree;
+}
+
 static barrier_t *barrier_create (barrier_ctx_t *ctx, const char *name, int nprocs)
 {
     barrier_t *b;
@@ -118,9 +173,12 @@ static barrier_t *barrier_create (barrier_ctx_t *ctx, const char *name, int npro
     b = xzmalloc (sizeof (barrier_t));
     b->name = xstrdup (name);
     b->nprocs = nprocs;
-    if (!(b->clients = zhash_new ()))
+    if (!(b->senders = zhashx_new ()))
         oom ();
+    zhashx_set_key_duplicator (b->senders, NULL);
+    zhashx_set_key_destructor (b->senders, NULL);
     b->ctx = ctx;
+    b->expected = subtree_expected (ctx, nprocs);
     zhash_insert (ctx->barriers, b->name, b);
     zhash_freefn (ctx->barriers, b->name, barrier_destroy);
 
@@ -142,15 +200,116 @@ done:
     return b;
 }
 
-static int barrier_add_client (barrier_t *b, char *sender, const flux_msg_t *msg)
+/* Return the route stack of 'msg' as a list of ids, first (the sender)
+ * to last, each \0 terminated, followed by an empty id.
+ */
+static char *route_pack (const flux_msg_t *msg)
+{
+    flux_msg_t *cpy;
+    char **ids = NULL;
+    char *route = NULL;
+    char *cp;
+    int hops, n;
+    size_t len = 1;
+
+    if (!(cpy = flux_msg_copy (msg, false)))
+        return NULL;
+    if ((hops = flux_msg_get_route_count (cpy)) < 0)
+        goto done;
+    if (!(ids = calloc (hops + 1, sizeof (ids[0]))))
+        goto done;
+    for (n = hops - 1; n >= 0; n--) {
+        if (flux_msg_pop_route (cpy, &ids[n]) < 0 || !ids[n])
+            goto done;
+        len += strlen (ids[n]) + 1;
+    }
+    if (!(cp = route = malloc (len)))
+        goto done;
+    for (n = 0; n < hops; n++) {
+        strcpy (cp, ids[n]);
+        cp += strlen (ids[n]) + 1;
+    }
+    *cp = '\0';
+done:
+    if (ids) {
+        for (n = 0; n < hops; n++)
+            free (ids[n]);
+        free (ids);
+    }
+    flux_msg_destroy (cpy);
+    return route;
+}
+
+static int barrier_add_client (barrier_t *b, const char *sender,
+                               const flux_msg_t *msg)
 {
-    flux_msg_t *cpy = flux_msg_copy (msg, true);
-    if (!cpy || zhash_insert (b->clients, sender, cpy) < 0)
+    struct waiter *w;
+
+    if (zhashx_lookup (b->senders, sender)) {
+        errno = EEXIST;
+        return -1;
+    }
+    if (b->nwaiters == b->maxwaiters) {
+        int max = b->maxwaiters ? b->maxwaiters * 2 : 16;
+        struct waiter *new;
+        if (!(new = realloc (b->waiters, max * sizeof (*new))))
+            return -1;
+        b->waiters = new;
+        b->maxwaiters = max;
+    }
+    w = &b->waiters[b->nwaiters];
+    if (flux_msg_get_matchtag (msg, &w->matchtag) < 0
+        || !(w->route = route_pack (msg)))
+        return -1;
+    /* The sender is the first id in the route; use it as the key in place.
+     */
+    if (zhashx_insert (b->senders, w->route,
+                       (void *)(uintptr_t)(b->nwaiters + 1)) < 0) {
+        free (w->route);
+        errno = EEXIST;
         return -1;
-    zhash_freefn (b->clients, sender, (zhash_free_fn *)flux_msg_destroy);
+    }
+    b->nwaiters++;
     return 0;
 }
 
+static int respond_waiter (flux_t *h, struct waiter *w, int errnum)
+{
+    flux_msg_t *msg;
+    const char *id;
+    int rc = -1;
+
+    if (errnum)
+        msg = flux_response_encode_error ("barrier.enter", errnum, NULL);
+    else
+        msg = flux_response_encode ("barrier.enter", NULL);
+    if (!msg)
+        return -1;
+    if (flux_msg_set_matchtag (msg, w->matchtag) < 0
+        || flux_msg_enable_route (msg) < 0)
+        goto done;
+    for (id = w->route; *id != '\0'; id += strlen (id) + 1) {
+        if (flux_msg_push_route (msg, id) < 0)
+            goto done;
+    }
+    if (flux_send (h, msg, 0) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_msg_destroy (msg);
+    return rc;
+}
+
+/* Pass entries not yet counted upstream.
+ */
+static void barrier_flush (barrier_t *b)
+{
+    if (b->count > 0) {
+        send_enter_request (b->ctx, b);
+        b->count = 0;
+    }
+}
+
 static void send_enter_request (barrier_ctx_t *ctx, barrier_t *b)
 {
     flux_future_t *f;
@@ -203,6 +362,11 @@ static void enter_request_cb (flux_t *h, flux_msg_handler_t *mh,
      */
     if (internal == false) {
         if (barrier_add_client (b, sender, msg) < 0) {
+            if (errno != EEXIST) {
+                flux_log_error (ctx->h, "%s: adding client", __FUNCTION__);
+                flux_respond_error (ctx->h, msg, errno, NULL);
+                goto done;
+            }
             flux_respond_error (ctx->h, msg, EEXIST, NULL);
             flux_log (ctx->h, LOG_ERR,
                         "abort %s due to double entry by client %s",
@@ -213,13 +377,17 @@ static void enter_request_cb (flux_t *h, flux_msg_handler_t *mh,
         }
     }
 
-    /* If the count has been reached, terminate the barrier;
-     * o/w set timer to pass count upstream and zero it here.
+    /* If the count has been reached, terminate the barrier.
+     * O/w, if the subtree is now complete, pass the count upstream
+     * immediately, or set timer to pass count upstream and zero it here.
      */
     b->count += count;
+    b->total += count;
     if (b->count == b->nprocs) {
         if (exit_event_send (ctx->h, b->name, 0) < 0)
             flux_log_error (ctx->h, "exit_event_send");
+    } else if (b->expected > 0 && b->total == b->expected) {
+        barrier_flush (b);
     } else if (ctx->rank > 0 && !ctx->timer_armed) {
         flux_timer_watcher_reset (ctx->timer, barrier_reduction_timeout_sec, 0.);
         flux_watcher_start (ctx->timer);
@@ -245,7 +413,7 @@ static void disconnect_request_cb (flux_t *h, flux_msg_handler_t *mh,
     if (flux_msg_get_route_first (msg, &sender) < 0)
         return;
     FOREACH_ZHASH (ctx->barriers, key, b) {
-        if (zhash_lookup (b->clients, sender)) {
+        if (zhashx_lookup (b->senders, sender)) {
             if (exit_event_send (h, b->name, ECONNABORTED) < 0)
                 flux_log_error (h, "exit_event_send");
         }
@@ -277,8 +445,7 @@ static void exit_event_cb (flux_t *h, flux_msg_handler_t *mh,
     barrier_t *b;
     const char *name;
     int errnum;
-    const char *key;
-    flux_msg_t *req;
+    int i;
 
     if (flux_event_unpack (msg, NULL, "{s:s s:i !}",
                            "name", &name,
@@ -288,13 +455,8 @@ static void exit_event_cb (flux_t *h, flux_msg_handler_t *mh,
     }
     if ((b = zhash_lookup (ctx->barriers, name))) {
         b->errnum = errnum;
-        FOREACH_ZHASH (b->clients, key, req) {
-            int rc;
-            if (b->errnum == 0)
-                rc = flux_respond (h, req, NULL);
-            else
-                rc = flux_respond_error (h, req, b->errnum, NULL);
-            if (rc < 0)
+        for (i = 0; i < b->nwaiters; i++) {
+            if (respond_waiter (h, &b->waiters[i], b->errnum) < 0)
                 flux_log_error (h, "%s: sending enter response", __FUNCTION__);
         }
         zhash_delete (ctx->barriers, name);
@@ -311,12 +473,8 @@ static void timeout_cb (flux_reactor_t *r, flux_watcher_t *w,
     assert (ctx->rank != 0);
     ctx->timer_armed = false; /* one shot */
 
-    FOREACH_ZHASH (ctx->barriers, key, b) {
-        if (b->count > 0) {
-            send_enter_request (ctx, b);
-            b->count = 0;
-        }
-    }
+    FOREACH_ZHASH (ctx->barriers, key, b)
+        barrier_flush (b);
 }
 
 static struct flux_msg_handler_spec htab[] = {
@@ -21,6 +21,8 @@
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/cleanup.h"
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/hist.h"
 
 const size_t lzo_buf_chunksize = 1024*1024;
 const size_t compression_threshold = 256; /* compress blobs >= this size */
@@ -49,6 +51,8 @@ typedef struct {
     uint32_t blob_size_limit;
     size_t lzo_bufsize;
     void *lzo_buf;
+    struct hist *load_latency;  /* usec per load, incl. decompression */
+    struct hist *store_latency; /* usec per store, incl. compression */
 } sqlite_ctx_t;
 
 static void log_sqlite_error (sqlite_ctx_t *ctx, const char *fmt, ...)
@@ -110,6 +114,8 @@ static void freectx (void *arg)
         free (ctx->dbfile);
         free (ctx->dbdir);
         free (ctx->lzo_buf);
+        hist_destroy (ctx->load_latency);
+        hist_destroy (ctx->store_latency);
         free (ctx);
         errno = saved_errno;
     }
@@ -128,6 +134,9 @@ static sqlite_ctx_t *getctx (flux_t *h)
         if (!(ctx->lzo_buf = calloc (1, lzo_buf_chunksize)))
             goto error;
         ctx->lzo_bufsize = lzo_buf_chunksize;
+        if (!(ctx->load_latency = hist_create ())
+            || !(ctx->store_latency = hist_create ()))
+            goto error;
         ctx->h = h;
         if (!(ctx->hashfun = flux_attr_get (h, "content.hash"))) {
             flux_log_error (h, "content.hash");
@@ -229,9 +238,12 @@ void load_cb (flux_t *h, flux_msg_handler_t *mh,
     int uncompressed_size;
     int rc = -1;
     int old_state;
+    struct timespec t0;
     //delay cancellation to ensure lock-correctness in sqlite
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
 
+    monotime (&t0);
+
     if (flux_request_decode_raw (msg, NULL, (const void **)&blobref,
                                  &blobref_size) < 0) {
         flux_log_error (h, "load: request decode failed");
@@ -290,6 +302,7 @@ void load_cb (flux_t *h, flux_msg_handler_t *mh,
     }
     rc = 0;
 done:
+    (void)hist_record_since (ctx->load_latency, t0);
     if (rc < 0) {
         if (flux_respond_error (h, msg, errno, NULL) < 0)
             flux_log_error (h, "load: flux_respond_error");
@@ -313,9 +326,12 @@ void store_cb (flux_t *h, flux_msg_handler_t *mh,
     int uncompressed_size = -1;
     int rc = -1;
     int old_state;
+    struct timespec t0;
     //delay cancellation to ensure lock-correctness in sqlite
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
 
+    monotime (&t0);
+
     if (flux_request_decode_raw (msg, NULL, &data, &size) < 0) {
         flux_log_error (h, "store: request decode failed");
         goto done;
@@ -368,6 +384,7 @@ void store_cb (flux_t *h, flux_msg_handler_t *mh,
     }
     rc = 0;
 done:
+    (void)hist_record_since (ctx->store_latency, t0);
     if (rc < 0) {
         if (flux_respond_error (h, msg, errno, NULL) < 0)
             flux_log_error (h, "store: flux_respond_error");
@@ -380,6 +397,45 @@ done:
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_state);
 }
 
+/* Return load and store latency histograms.
+ */
+void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
+                   const flux_msg_t *msg, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    if (flux_request_decode (msg, NULL, NULL) < 0)
+        goto error;
+    if (flux_respond_pack (h, msg, "{ s:o s:o }",
+                           "load (us)", hist_encode (ctx->load_latency),
+                           "store (us)", hist_encode (ctx->store_latency)) < 0)
+        flux_log_error (h, "stats-get: flux_respond_pack");
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "stats-get: flux_respond_error");
+}
+
+void stats_clear_event_cb (flux_t *h, flux_msg_handler_t *mh,
+                           const flux_msg_t *msg, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    hist_clear (ctx->load_latency);
+    hist_clear (ctx->store_latency);
+}
+
+void stats_clear_request_cb (flux_t *h, flux_msg_handler_t *mh,
+                             const flux_msg_t *msg, void *arg)
+{
+    sqlite_ctx_t *ctx = arg;
+
+    hist_clear (ctx->load_latency);
+    hist_clear (ctx->store_latency);
+    if (flux_respond (h, msg, NULL) < 0)
+        flux_log_error (h, "stats-clear: flux_respond");
+}
+
 int register_backing_store (flux_t *h, bool value, const char *name)
 {
     flux_future_t *f;
@@ -512,6 +568,11 @@ static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "content-backing.load",    load_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-backing.store",   store_cb, 0 },
     { FLUX_MSGTYPE_REQUEST, "content-sqlite.shutdown", shutdown_cb, 0, },
+    { FLUX_MSGTYPE_REQUEST, "content-sqlite.stats.get", stats_get_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "content-sqlite.stats.clear",
+                                                  stats_clear_request_cb, 0 },
+    { FLUX_MSGTYPE_EVENT,   "content-sqlite.stats.clear",
+                                                  stats_clear_event_cb, 0 },
     { FLUX_MSGTYPE_EVENT,   "shutdown",                broker_shutdown_cb, 0 },
     FLUX_MSGHANDLER_TABLE_END,
 };
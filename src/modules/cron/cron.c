@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <sys/time.h>
 #include <ctype.h>
+#include <limits.h>
 #include <flux/core.h>
 #include <czmq.h>
 #include <jansson.h>
@@ -39,8 +40,22 @@
 #include "entry.h"
 #include "types.h"
 
+/*  Entries in a class share a limit on the number of their tasks
+ *   running at once.  Tasks over the limit wait in the class queue.
+ */
+struct cron_class {
+    char *                 name;
+    int                    limit;           /* 0 = unlimited                 */
+    int                    running;         /* tasks running now             */
+    zlist_t *              queue;           /* entries waiting to run        */
+};
+
 struct cron_ctx {
     flux_t *               h;
+    struct wheel *         wheel;           /* wall clock timers             */
+    struct wheel *         delay_wheel;     /* monotonic timers for delays   */
+    zhashx_t *             classes;         /* name => struct cron_class     */
+    unsigned int           seed;            /* for jitter                    */
     uint64_t               next_id;         /* Id for next cron entry        */
     char *                 sync_event;      /* If set, sync entries to event */
     flux_msg_handler_t *   mh;              /* sync event message handler    */
@@ -65,6 +80,7 @@ static void cron_entry_io_cb (flux_t *h, cron_task_t *t, void *arg,
     bool is_stderr, const char *data, int datalen);
 static int cron_entry_run_task (cron_entry_t *e);
 static int cron_entry_defer (cron_entry_t *e);
+static struct cron_class *cron_ctx_class (cron_ctx_t *ctx, const char *name);
 
 /**************************************************************************/
 /* Public apis
@@ -74,6 +90,16 @@ void *cron_entry_type_data (cron_entry_t *e)
     return e->data;
 }
 
+struct wheel *cron_entry_wheel (cron_entry_t *e)
+{
+    return e->ctx->wheel;
+}
+
+struct wheel *cron_entry_delay_wheel (cron_entry_t *e)
+{
+    return e->ctx->delay_wheel;
+}
+
 double get_timestamp (void)
 {
     struct timespec tm;
@@ -92,6 +118,18 @@ static void timeout_cb (flux_t *h, cron_task_t *t, void *arg)
 static int cron_entry_run_task (cron_entry_t *e)
 {
     flux_t *h = e->ctx->h;
+    struct cron_class *c = e->class;
+
+    if (c) {
+        if (c->limit > 0 && c->running >= c->limit
+            && zlist_append (c->queue, e) == 0) {
+            flux_log (h, LOG_DEBUG, "cron-%ju: waiting for class %s",
+                      e->id, c->name);
+            return (0);
+        }
+        /* Released in cron_entry_finished_handler() */
+        c->running++;
+    }
     if (cron_task_run (e->task, e->rank, e->command, e->cwd, e->env) < 0) {
         flux_log_error (h, "cron-%ju: cron_task_run", e->id);
         /* Run "finished" handler since this task is done */
@@ -134,9 +172,23 @@ int cron_entry_schedule_task (cron_entry_t *e)
     if (cron_entry_increment (e) == e->repeat)
         cron_entry_stop (e);
 
+    /*   Spread out tasks of entries that fire at the same time by
+     *     delaying each by a random amount up to the entry's jitter.
+     */
+    if (e->jitter_timer) {
+        double delay = e->jitter * rand_r (&e->ctx->seed) / RAND_MAX;
+        double now = wheel_now (e->ctx->delay_wheel);
+        wheel_timer_start (e->jitter_timer, now + delay);
+        return (0);
+    }
     return cron_entry_defer (e);
 }
 
+static void jitter_cb (struct wheel_timer *t, void *arg)
+{
+    cron_entry_defer (arg);
+}
+
 
 /**************************************************************************/
 
@@ -179,6 +231,19 @@ static void cron_entry_failure (cron_entry_t *e)
     }
 }
 
+/*  Release the class slot held by a finished task, and run the next
+ *   waiting entry, if any.
+ */
+static void cron_class_release (struct cron_class *c)
+{
+    cron_entry_t *e;
+
+    c->running--;
+    if ((c->limit == 0 || c->running < c->limit)
+        && (e = zlist_pop (c->queue)))
+        cron_entry_run_task (e);
+}
+
 static void cron_entry_finished_handler (flux_t *h, cron_task_t *t, void *arg)
 {
     cron_entry_t *e = arg;
@@ -208,6 +273,9 @@ static void cron_entry_finished_handler (flux_t *h, cron_task_t *t, void *arg)
         return;
     e->task = NULL;
 
+    if (e->class)
+        cron_class_release (e->class);
+
     /*
      *   If destruction of this cron entry has been requested, complete
      *    the destroy here.
@@ -216,8 +284,35 @@ static void cron_entry_finished_handler (flux_t *h, cron_task_t *t, void *arg)
         cron_entry_destroy (e);
 }
 
+/*  Drop a task of entry `e` that is scheduled but has not yet run,
+ *   i.e. one waiting on the jitter timer, the class queue, or the
+ *   deferred list.  A task that is already running is left alone.
+ */
+static void cron_entry_cancel_pending (cron_entry_t *e)
+{
+    bool pending = false;
+
+    if (wheel_timer_active (e->jitter_timer)) {
+        wheel_timer_stop (e->jitter_timer);
+        pending = true;
+    }
+    if (e->class && zlist_exists (e->class->queue, e)) {
+        zlist_remove (e->class->queue, e);
+        pending = true;
+    }
+    if (e->ctx && e->ctx->deferred && zlist_exists (e->ctx->deferred, e)) {
+        zlist_remove (e->ctx->deferred, e);
+        pending = true;
+    }
+    if (pending && e->task) {
+        cron_task_destroy (e->task);
+        e->task = NULL;
+    }
+}
+
 static int cron_entry_stop (cron_entry_t *e)
 {
+    cron_entry_cancel_pending (e);
     if (!e->data || e->stopped) {
         errno = EINVAL;
         return (-1);
@@ -297,6 +392,7 @@ static void cron_entry_destroy (cron_entry_t *e)
         e->ops.destroy (e->data);
         e->data = NULL;
     }
+    wheel_timer_destroy (e->jitter_timer);
 
     free (e->name);
     free (e->command);
@@ -373,6 +469,7 @@ static cron_entry_t *cron_entry_create (cron_ctx_t *ctx, const flux_msg_t *msg)
     const char *command;
     const char *type;
     const char *cwd = NULL;
+    const char *class = NULL;
     int saved_errno = EPROTO;
 
     /* Get required fields "type", "name" and "command" */
@@ -416,11 +513,30 @@ static cron_entry_t *cron_entry_create (cron_ctx_t *ctx, const flux_msg_t *msg)
             "rank",               &e->rank,
             "task-history-count", &e->task_history_count,
             "stop-on-failure",    &e->stop_on_failure,
-            "timeout",            &e->timeout) < 0) {
+            "timeout",            &e->timeout) < 0
+        || flux_msg_unpack (msg, "{ s?F, s?s }",
+            "jitter",             &e->jitter,
+            "class",              &class) < 0) {
         saved_errno = EPROTO;
         flux_log_error (h, "cron.create: flux_msg_unpack");
         goto out_err;
     }
+    if (e->jitter < 0.) {
+        saved_errno = EINVAL;
+        goto out_err;
+    }
+    if (e->jitter > 0.
+        && !(e->jitter_timer = wheel_timer_create (ctx->delay_wheel,
+                                                   jitter_cb, e))) {
+        saved_errno = errno;
+        flux_log_error (h, "cron.create: wheel_timer_create");
+        goto out_err;
+    }
+    if (class && !(e->class = cron_ctx_class (ctx, class))) {
+        saved_errno = errno;
+        flux_log_error (h, "cron.create: class %s", class);
+        goto out_err;
+    }
 
     if (!cwd)
         cwd = ctx->cwd;
@@ -481,6 +597,71 @@ static void cron_ctx_sync_event_stop (cron_ctx_t *ctx)
     }
 }
 
+static void cron_class_destroy (void **item)
+{
+    if (item) {
+        struct cron_class *c = *item;
+        zlist_destroy (&c->queue);
+        free (c->name);
+        free (c);
+        *item = NULL;
+    }
+}
+
+/*  Return the class named `name`, creating it with no limit if needed.
+ */
+static struct cron_class *cron_ctx_class (cron_ctx_t *ctx, const char *name)
+{
+    struct cron_class *c;
+
+    if ((c = zhashx_lookup (ctx->classes, name)))
+        return c;
+    if (!(c = calloc (1, sizeof (*c))))
+        return NULL;
+    if (!(c->name = strdup (name)) || !(c->queue = zlist_new ())) {
+        cron_class_destroy ((void **) &c);
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (zhashx_insert (ctx->classes, name, c) < 0) {
+        cron_class_destroy ((void **) &c);
+        errno = EEXIST;
+        return NULL;
+    }
+    return c;
+}
+
+static int cron_ctx_class_limit (cron_ctx_t *ctx, const char *arg)
+{
+    struct cron_class *c;
+    char *name, *p;
+    char *endptr;
+    long limit;
+    int rc = -1;
+
+    if (!(name = strdup (arg)))
+        return -1;
+    if (!(p = strchr (name, ':'))) {
+        errno = EINVAL;
+        goto done;
+    }
+    *p++ = '\0';
+    errno = 0;
+    limit = strtol (p, &endptr, 10);
+    if (errno != 0 || *endptr != '\0' || endptr == p
+        || limit < 0 || limit > INT_MAX) {
+        errno = EINVAL;
+        goto done;
+    }
+    if (!(c = cron_ctx_class (ctx, name)))
+        goto done;
+    c->limit = limit;
+    rc = 0;
+done:
+    free (name);
+    return rc;
+}
+
 static void cron_ctx_destroy (cron_ctx_t *ctx)
 {
     if (ctx == NULL)
@@ -496,6 +677,9 @@ static void cron_ctx_destroy (cron_ctx_t *ctx)
     }
     if (ctx->deferred)
         zlist_destroy (&ctx->deferred);
+    zhashx_destroy (&ctx->classes);
+    wheel_destroy (ctx->wheel);
+    wheel_destroy (ctx->delay_wheel);
     free (ctx->cwd);
     free (ctx);
 }
@@ -547,6 +731,18 @@ static cron_ctx_t * cron_ctx_create (flux_t *h)
         flux_log_error (h, "cron_ctx_create: zlist_new");
         goto error;
     }
+    if (!(ctx->classes = zhashx_new ())) {
+        flux_log_error (h, "cron_ctx_create: zhashx_new");
+        goto error;
+    }
+    zhashx_set_destructor (ctx->classes, cron_class_destroy);
+    if (!(ctx->wheel = wheel_create (flux_get_reactor (h), 0))
+        || !(ctx->delay_wheel = wheel_create (flux_get_reactor (h),
+                                              WHEEL_MONOTONIC))) {
+        flux_log_error (h, "cron_ctx_create: wheel_create");
+        goto error;
+    }
+    ctx->seed = (unsigned int) getpid () ^ (unsigned int) time (NULL);
 
     if (!(ctx->cwd = get_current_dir_name ())) {
         flux_log_error (h, "cron_ctx_create: get_get_current_dir_name");
@@ -597,6 +793,10 @@ static json_t *cron_entry_to_json (cron_entry_t *e)
 
     if (e->timeout >= 0.0)
         json_object_set_new (o, "timeout", json_real (e->timeout));
+    if (e->jitter > 0.0)
+        json_object_set_new (o, "jitter", json_real (e->jitter));
+    if (e->class)
+        json_object_set_new (o, "class", json_string (e->class->name));
 
     if ((to = cron_stats_to_json (&e->stats)))
         json_object_set_new (o, "stats", to);
@@ -883,6 +1083,10 @@ static void process_args (cron_ctx_t *ctx, int ac, char **av)
             if (fsd_parse_duration (s, &ctx->sync_epsilon) < 0)
                 flux_log_error (ctx->h, "option %s ignored", av[i]);
         }
+        else if (strncmp (av[i], "class-limit=", 12) == 0) {
+            if (cron_ctx_class_limit (ctx, (av[i])+12) < 0)
+                flux_log_error (ctx->h, "option %s ignored", av[i]);
+        }
         else
             flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
     }
@@ -23,14 +23,15 @@
 
 struct datetime_entry {
     flux_t *h;
-    flux_watcher_t *w;
+    cron_entry_t *e;
+    struct wheel_timer *t;
     cronodate_t *d;
 };
 
 void datetime_entry_destroy (struct datetime_entry *dt)
 {
     dt->h = NULL;
-    flux_watcher_destroy (dt->w);
+    wheel_timer_destroy (dt->t);
     cronodate_destroy (dt->d);
     free (dt);
 }
@@ -77,43 +78,52 @@ static struct datetime_entry * datetime_entry_from_json (json_t *o)
     return (dt);
 }
 
-static void cron_datetime_start (void *arg)
+/* Start the timer for the next matching date-time after `now`.
+ */
+static void datetime_schedule (cron_entry_t *e, struct datetime_entry *dt,
+                               double now)
 {
-    struct datetime_entry *dt = arg;
-    flux_watcher_start (dt->w);
+    double next = now + cronodate_remaining (dt->d, now);
+    /* If we failed to get next timestamp, stop the cron entry in an
+     *  ev_prepare callback, since we may be called from start.
+     */
+    if (next < now) {
+        /*  Only issue an error if this entry has more than one repeat:
+         */
+        if (e->repeat == 0 || e->repeat < e->stats.count + 1) {
+            flux_log_error (dt->h,
+                    "cron-%ju: Unable to get next wakeup. Stopping.", e->id);
+        }
+        cron_entry_stop_safe (e);
+        return;
+    }
+    wheel_timer_start (dt->t, next);
 }
 
-static void cron_datetime_stop (void *arg)
+static void cron_datetime_start (void *arg)
 {
     struct datetime_entry *dt = arg;
-    flux_watcher_stop (dt->w);
+    flux_reactor_t *r = flux_get_reactor (dt->h);
+    datetime_schedule (dt->e, dt, flux_reactor_now (r));
 }
 
-void datetime_cb (flux_reactor_t *r, flux_watcher_t *w, int revents, void *arg)
+static void cron_datetime_stop (void *arg)
 {
-    cron_entry_t *e = arg;
-    cron_entry_schedule_task (e);
+    struct datetime_entry *dt = arg;
+    wheel_timer_stop (dt->t);
 }
 
-static double reschedule_cb (flux_watcher_t *w, double now, void *arg)
+static void datetime_cb (struct wheel_timer *t, void *arg)
 {
     cron_entry_t *e = arg;
     struct datetime_entry *dt = cron_entry_type_data (e);
-    double next = now + cronodate_remaining (dt->d, now);
-    /* If we failed to get next timestamp, push timeout far into the future
-     *  and stop the cron entry in an ev_prepare callback. See ev(7).
+    double now = flux_reactor_now (flux_get_reactor (dt->h));
+    double expires = wheel_timer_expires (t);
+
+    /* Rearm first, since scheduling the task may stop the entry.
      */
-    if (next < now) {
-        /*  Only issue an error if this entry has more than one repeat:
-         */
-        if (e->repeat == 0 || e->repeat < e->stats.count + 1) {
-            flux_log_error (dt->h,
-                    "cron-%ju: Unable to get next wakeup. Stopping.", e->id);
-        }
-        cron_entry_stop_safe (e);
-        return now + 1.e19;
-    }
-    return (next);
+    datetime_schedule (e, dt, expires > now ? expires : now);
+    cron_entry_schedule_task (e);
 }
 
 static void *cron_datetime_create (flux_t *h, cron_entry_t *e, json_t *arg)
@@ -122,12 +132,10 @@ static void *cron_datetime_create (flux_t *h, cron_entry_t *e, json_t *arg)
     if (dt == NULL)
         return (NULL);
     dt->h = h;
-    dt->w = flux_periodic_watcher_create (flux_get_reactor (h),
-                                         0., 0.,
-                                         reschedule_cb,
-                                         datetime_cb, (void *) e);
-    if (dt->w == NULL) {
-        flux_log_error (h, "periodic_watcher_create");
+    dt->e = e;
+    dt->t = wheel_timer_create (cron_entry_wheel (e), datetime_cb, (void *) e);
+    if (dt->t == NULL) {
+        flux_log_error (h, "wheel_timer_create");
         datetime_entry_destroy (dt);
         return (NULL);
     }
@@ -139,8 +147,8 @@ static json_t *cron_datetime_to_json (void *arg)
     int i;
     struct datetime_entry *dt = arg;
     json_t *o = json_object ();
-    if (dt->w) {
-        json_t *x = json_real (flux_watcher_next_wakeup (dt->w));
+    if (dt->t) {
+        json_t *x = json_real (wheel_timer_expires (dt->t));
         if (x)
             json_object_set_new (o, "next_wakeup", x);
     }
@@ -15,6 +15,8 @@
 #include <jansson.h>
 #include <flux/core.h>
 
+#include "wheel.h"
+
 typedef struct cron_ctx cron_ctx_t;
 typedef struct cron_entry cron_entry_t;
 
@@ -79,12 +81,23 @@ struct cron_entry {
     int                 stop_on_failure;    /* Stop cron entry after failure */
 
     double              timeout;            /* Max secs to allow task to run */
+
+    double              jitter;             /* Max random delay before task  */
+    struct wheel_timer *jitter_timer;
+    struct cron_class * class;              /* Concurrency limit class       */
 };
 
 /* Return type data ptr for cron_entry `e`
  */
 void *cron_entry_type_data (cron_entry_t *e);
 
+/* Return the timer wheels shared by all entries, for type-specific timers:
+ * one on the wall clock for times of day, and one on the monotonic clock
+ * for delays, which must not be affected by wall clock steps.
+ */
+struct wheel *cron_entry_wheel (cron_entry_t *e);
+struct wheel *cron_entry_delay_wheel (cron_entry_t *e);
+
 /* Schedule the task corresponding to cron entry `e` to run as soon as allowed
  */
 int cron_entry_schedule_task (cron_entry_t *e);
@@ -18,6 +18,7 @@
 struct cron_event {
     flux_t *h;
     flux_msg_handler_t *mh;
+    struct wheel_timer *t;      /* min_interval delay */
     int paused;
     double min_interval;
     int nth;
@@ -26,14 +27,11 @@ struct cron_event {
     char *event;
 };
 
-static void ev_timer_cb (flux_reactor_t *r, flux_watcher_t *w,
-                         int revents, void *arg)
+static void ev_timer_cb (struct wheel_timer *t, void *arg)
 {
     cron_entry_t *e = arg;
     struct cron_event *ev = cron_entry_type_data (e);
     cron_entry_schedule_task (e);
-    flux_watcher_stop (w);
-    flux_watcher_destroy (w);
     ev->paused = 0;
 }
 
@@ -61,21 +59,15 @@ static void event_handler (flux_t *h, flux_msg_handler_t *w,
         double now = get_timestamp ();
         double remaining = ev->min_interval - (now - e->stats.lastrun);
         if (remaining > 1e-5) {
-            flux_reactor_t *r = flux_get_reactor (h);
-            flux_watcher_t *w;
-            if (!(w = flux_timer_watcher_create (r, remaining, 0.,
-                                                 ev_timer_cb, (void *) e)))
-                flux_log_error (h, "timer_watcher_create");
-            else {
-                /* Pause the event watcher. Continue to count events but
-                 *  don't run anything until we unpause.
-                 */
-                ev->paused = 1;
-                flux_watcher_start (w);
-                flux_log (h, LOG_DEBUG,
-                          "cron-%ju: delaying %4.03fs due to min interval",
-                          e->id, remaining);
-            }
+            struct wheel *w = cron_entry_delay_wheel (e);
+            /* Pause the event watcher. Continue to count events but
+             *  don't run anything until we unpause.
+             */
+            ev->paused = 1;
+            wheel_timer_start (ev->t, wheel_now (w) + remaining);
+            flux_log (h, LOG_DEBUG,
+                      "cron-%ju: delaying %4.03fs due to min interval",
+                      e->id, remaining);
             return;
         }
     }
@@ -90,6 +82,7 @@ static void cron_event_destroy (void *arg)
 
     if (ev->mh)
         flux_msg_handler_destroy (ev->mh);
+    wheel_timer_destroy (ev->t);
     if (ev->h && ev->event)
         (void) flux_event_unsubscribe (ev->h, ev->event);
     free (ev->event);
@@ -140,6 +133,12 @@ static void *cron_event_create (flux_t *h, cron_entry_t *e, json_t *arg)
         goto fail;
     }
 
+    if (!(ev->t = wheel_timer_create (cron_entry_delay_wheel (e), ev_timer_cb,
+                                      (void *) e))) {
+        flux_log_error (h, "cron_event: wheel_timer_create");
+        goto fail;
+    }
+
     match.topic_glob = ev->event;
     ev->mh = flux_msg_handler_create (h, match, event_handler, (void *)e);
     if (!ev->mh) {
@@ -20,16 +20,30 @@
 #include "entry.h"
 
 struct cron_interval {
-    flux_watcher_t *w;
-    double          after;   /* initial timeout */
-    double          seconds; /* repeat interval */
+    flux_reactor_t     *r;
+    struct wheel       *w;
+    struct wheel_timer *t;
+    double              after;   /* initial timeout */
+    double              seconds; /* repeat interval */
 };
 
 
-static void interval_handler (flux_reactor_t *r, flux_watcher_t *w,
-                              int revents, void *arg)
+static void interval_handler (struct wheel_timer *t, void *arg)
 {
-    cron_entry_schedule_task ((cron_entry_t *)arg);
+    cron_entry_t *e = arg;
+    struct cron_interval *iv = cron_entry_type_data (e);
+
+    /*  Rearm first, since scheduling the task may stop the entry.
+     *   Keep to the original schedule unless we've fallen behind.
+     */
+    if (iv->seconds > 0.) {
+        double now = wheel_now (iv->w);
+        double next = wheel_timer_expires (t) + iv->seconds;
+        if (next <= now)
+            next = now + iv->seconds;
+        wheel_timer_start (t, next);
+    }
+    cron_entry_schedule_task (e);
 }
 
 static void *cron_interval_create (flux_t *h, cron_entry_t *e, json_t *arg)
@@ -54,11 +68,11 @@ static void *cron_interval_create (flux_t *h, cron_entry_t *e, json_t *arg)
     }
     iv->seconds = i;
     iv->after = after;
-    iv->w = flux_timer_watcher_create (flux_get_reactor (h),
-                                       after, i, interval_handler,
-                                       (void *) e);
-    if (!iv->w) {
-        flux_log_error (h, "cron_interval: flux_timer_watcher_create");
+    iv->r = flux_get_reactor (h);
+    iv->w = cron_entry_delay_wheel (e);
+    iv->t = wheel_timer_create (iv->w, interval_handler, (void *) e);
+    if (!iv->t) {
+        flux_log_error (h, "cron_interval: wheel_timer_create");
         free (iv);
         return (NULL);
     }
@@ -69,27 +83,33 @@ static void *cron_interval_create (flux_t *h, cron_entry_t *e, json_t *arg)
 static void cron_interval_destroy (void *arg)
 {
     struct cron_interval *iv = arg;
-    flux_watcher_destroy (iv->w);
+    wheel_timer_destroy (iv->t);
     free (iv);
 }
 
 static void cron_interval_start (void *arg)
 {
-    flux_watcher_start (((struct cron_interval *)arg)->w);
+    struct cron_interval *iv = arg;
+    wheel_timer_start (iv->t, wheel_now (iv->w) + iv->after);
 }
 
 static void cron_interval_stop (void *arg)
 {
-    flux_watcher_stop (((struct cron_interval *)arg)->w);
+    wheel_timer_stop (((struct cron_interval *)arg)->t);
 }
 
+/*  Report next wakeup as wall clock time, converted from the wheel's
+ *   monotonic clock.
+ */
 static json_t *cron_interval_to_json (void *arg)
 {
     struct cron_interval *iv = arg;
+    double next = flux_reactor_now (iv->r)
+                  + wheel_timer_expires (iv->t) - wheel_now (iv->w);
     return json_pack ("{ s:f, s:f, s:f }",
                       "interval",    iv->seconds,
                       "after",       iv->after,
-                      "next_wakeup", flux_watcher_next_wakeup (iv->w));
+                      "next_wakeup", next);
 }
 
 struct cron_entry_ops cron_interval_operations = {
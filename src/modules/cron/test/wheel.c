@@ -0,0 +1,321 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <flux/core.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/modules/cron/wheel.h"
+
+struct tstate {
+    struct wheel_timer *t;
+    double fired;       /* time of the run in which the timer fired */
+    int count;
+};
+
+static double run_now;
+
+static void fire_cb (struct wheel_timer *t, void *arg)
+{
+    struct tstate *ts = arg;
+    ts->fired = run_now;
+    ts->count++;
+}
+
+static void run (struct wheel *w, double now)
+{
+    run_now = now;
+    wheel_run (w, now);
+}
+
+void basic (void)
+{
+    struct wheel *w;
+    struct tstate ts = { .fired = -1 };
+
+    ok ((w = wheel_create (NULL, 0)) != NULL,
+        "wheel_create with no reactor works");
+    errno = 0;
+    ok (wheel_timer_create (w, NULL, NULL) == NULL && errno == EINVAL,
+        "wheel_timer_create cb=NULL fails with EINVAL");
+    ok ((ts.t = wheel_timer_create (w, fire_cb, &ts)) != NULL,
+        "wheel_timer_create works");
+    ok (!wheel_timer_active (ts.t) && wheel_count (w) == 0,
+        "new timer is not active");
+
+    run (w, 1000.);
+    wheel_timer_start (ts.t, 1000.5);
+    ok (wheel_timer_active (ts.t) && wheel_count (w) == 1
+        && wheel_timer_expires (ts.t) == 1000.5,
+        "wheel_timer_start works");
+    run (w, 1000.499);
+    ok (ts.count == 0,
+        "timer did not fire early");
+    run (w, 1000.5);
+    ok (ts.count == 1 && !wheel_timer_active (ts.t) && wheel_count (w) == 0,
+        "timer fired when due");
+    run (w, 1002.);
+    ok (ts.count == 1,
+        "timer fired only once");
+
+    wheel_timer_start (ts.t, 1003.);
+    wheel_timer_stop (ts.t);
+    ok (!wheel_timer_active (ts.t) && wheel_count (w) == 0,
+        "wheel_timer_stop works");
+    run (w, 1004.);
+    ok (ts.count == 1,
+        "stopped timer did not fire");
+
+    wheel_timer_start (ts.t, 1000.);
+    run (w, 1004.001);
+    ok (ts.count == 2,
+        "timer started in the past fires on next run");
+
+    wheel_timer_destroy (ts.t);
+    wheel_destroy (w);
+}
+
+/* Start timers over a range of magnitudes (ms to a year), then run the
+ * wheel in irregular steps, checking that each fires exactly once, in
+ * the first run at or after it expires.
+ */
+void cascade (void)
+{
+    struct wheel *w;
+    int n = 2000;
+    struct tstate *ts;
+    double t0 = 1560000000.;
+    double end = t0 + 366 * 24 * 3600.;
+    double now, last;
+    bool early = false;
+    bool late = false;
+    bool once = true;
+    int fired = 0;
+    int i;
+
+    if (!(w = wheel_create (NULL, 0)) || !(ts = calloc (n, sizeof (*ts))))
+        BAIL_OUT ("out of memory");
+    run (w, t0);
+    srand (42);
+    for (i = 0; i < n; i++) {
+        double scale = (i % 5 == 0) ? 0.1 : (i % 5 == 1) ? 100.
+                     : (i % 5 == 2) ? 10000. : (i % 5 == 3) ? 1e6 : 3e7;
+        ts[i].fired = -1;
+        if (!(ts[i].t = wheel_timer_create (w, fire_cb, &ts[i])))
+            BAIL_OUT ("wheel_timer_create failed");
+        wheel_timer_start (ts[i].t, t0 + scale * rand () / RAND_MAX);
+    }
+    ok (wheel_count (w) == n,
+        "started %d timers", n);
+
+    last = t0;
+    now = t0;
+    while (now < end) {
+        now += 0.001 * (rand () % 5000) * (1 + (now - t0) / 100);
+        run (w, now);
+        for (i = 0; i < n; i++) {
+            if (ts[i].count == 1 && ts[i].fired == now) {
+                double expires = wheel_timer_expires (ts[i].t);
+                if (expires > now)
+                    early = true;
+                if (expires <= last)
+                    late = true;
+                fired++;
+            }
+            if (ts[i].count > 1)
+                once = false;
+        }
+        last = now;
+    }
+    ok (fired == n && wheel_count (w) == 0,
+        "all timers fired");
+    ok (once,
+        "each timer fired once");
+    ok (!early,
+        "no timer fired early");
+    ok (!late,
+        "each timer fired in the first run after it expired");
+
+    for (i = 0; i < n; i++)
+        wheel_timer_destroy (ts[i].t);
+    free (ts);
+    wheel_destroy (w);
+}
+
+/* A timer more than the wheel range out (about two years) is placed at
+ * the end of the range and put back until it is due.
+ */
+void far (void)
+{
+    struct wheel *w;
+    struct tstate ts = { .fired = -1 };
+    double t0 = 1560000000.;
+    double year = 365 * 24 * 3600.;
+    double when = t0 + 5 * year;
+    double now;
+
+    if (!(w = wheel_create (NULL, 0))
+        || !(ts.t = wheel_timer_create (w, fire_cb, &ts)))
+        BAIL_OUT ("out of memory");
+    run (w, t0);
+    wheel_timer_start (ts.t, when);
+    for (now = t0; now < when - 1; now += year / 3)
+        run (w, now);
+    ok (ts.count == 0 && wheel_timer_active (ts.t),
+        "far timer was not run early");
+    run (w, when - 0.001);
+    ok (ts.count == 0,
+        "far timer was not run 1ms early");
+    run (w, when);
+    ok (ts.count == 1,
+        "far timer fired when due");
+    wheel_timer_destroy (ts.t);
+    wheel_destroy (w);
+}
+
+static struct wheel_timer *victim;
+
+static void restart_cb (struct wheel_timer *t, void *arg)
+{
+    int *count = arg;
+    if (++(*count) < 3)
+        wheel_timer_start (t, run_now + 1.);
+    wheel_timer_destroy (victim);
+    victim = NULL;
+}
+
+void callbacks (void)
+{
+    struct wheel *w;
+    struct tstate ts = { .fired = -1 };
+    int count = 0;
+    struct wheel_timer *t;
+
+    if (!(w = wheel_create (NULL, 0))
+        || !(t = wheel_timer_create (w, restart_cb, &count))
+        || !(victim = wheel_timer_create (w, fire_cb, &ts)))
+        BAIL_OUT ("out of memory");
+    run (w, 100.);
+    wheel_timer_start (t, 101.);
+    wheel_timer_start (victim, 101.);
+    run (w, 101.);
+    ok (count == 1 && ts.count == 0 && wheel_count (w) == 1,
+        "timer destroyed by callback of timer in the same run did not fire");
+    run (w, 102.);
+    run (w, 103.);
+    run (w, 104.);
+    ok (count == 3 && wheel_count (w) == 0,
+        "timer restarted from its own callback fired again");
+    wheel_timer_destroy (t);
+    wheel_destroy (w);
+}
+
+/* If the clock steps back, timers are placed again relative to the new
+ * time: they still expire at their absolute time, and timers started
+ * after the step expire without waiting for the clock to catch up.
+ */
+void backwards (void)
+{
+    struct wheel *w;
+    struct tstate ts1 = { .fired = -1 };
+    struct tstate ts2 = { .fired = -1 };
+
+    if (!(w = wheel_create (NULL, 0))
+        || !(ts1.t = wheel_timer_create (w, fire_cb, &ts1))
+        || !(ts2.t = wheel_timer_create (w, fire_cb, &ts2)))
+        BAIL_OUT ("out of memory");
+    run (w, 1000.);
+    wheel_timer_start (ts1.t, 1000.5);
+    run (w, 900.);
+    ok (wheel_now (w) == 900. && ts1.count == 0 && wheel_count (w) == 1,
+        "wheel moved back with the clock");
+    wheel_timer_start (ts2.t, 900.1);
+    run (w, 900.1);
+    ok (ts2.count == 1 && ts1.count == 0,
+        "timer started after the step fired when due");
+    run (w, 1000.499);
+    ok (ts1.count == 0,
+        "timer started before the step was not run early");
+    run (w, 1000.5);
+    ok (ts1.count == 1,
+        "timer started before the step fired when due");
+    wheel_timer_destroy (ts1.t);
+    wheel_timer_destroy (ts2.t);
+    wheel_destroy (w);
+}
+
+static void reactor_cb (struct wheel_timer *t, void *arg)
+{
+    int *count = arg;
+    (*count)++;
+}
+
+static void stop_cb (struct wheel_timer *t, void *arg)
+{
+    flux_reactor_stop (arg);
+}
+
+void reactor (int flags)
+{
+    flux_reactor_t *r;
+    struct wheel *w;
+    struct wheel_timer *t[100];
+    struct wheel_timer *stop;
+    int count = 0;
+    double t0;
+    int i;
+
+    if (!(r = flux_reactor_create (0)))
+        BAIL_OUT ("flux_reactor_create failed");
+    ok ((w = wheel_create (r, flags)) != NULL,
+        "wheel_create flags=0x%x with reactor works", flags);
+    t0 = wheel_now (w);
+    for (i = 0; i < 100; i++) {
+        if (!(t[i] = wheel_timer_create (w, reactor_cb, &count)))
+            BAIL_OUT ("wheel_timer_create failed");
+        wheel_timer_start (t[i], t0 + 0.001 * (i % 20));
+    }
+    if (!(stop = wheel_timer_create (w, stop_cb, r)))
+        BAIL_OUT ("wheel_timer_create failed");
+    wheel_timer_start (stop, t0 + 0.1);
+    ok (flux_reactor_run (r, 0) >= 0,
+        "reactor ran until the last timer stopped it");
+    ok (count == 100 && wheel_count (w) == 0,
+        "all timers fired");
+    ok (wheel_now (w) >= t0 + 0.1,
+        "the last timer did not fire early");
+
+    for (i = 0; i < 100; i++)
+        wheel_timer_destroy (t[i]);
+    wheel_timer_destroy (stop);
+    wheel_destroy (w);
+    flux_reactor_destroy (r);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    basic ();
+    cascade ();
+    far ();
+    callbacks ();
+    backwards ();
+    reactor (0);
+    reactor (WHEEL_MONOTONIC);
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
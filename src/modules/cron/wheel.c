@@ -0,0 +1,386 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* wheel.c - hierarchical timer wheel
+ *
+ * Time is counted in ticks of one millisecond.  Level 0 has one slot per
+ * tick for the next WHEEL_SLOTS ticks, and each level above has slots
+ * WHEEL_SLOTS times as wide as the one below, so WHEEL_LEVELS levels of
+ * 64 slots cover 2^36 ms (about two years).  Timers further out than
+ * that are placed in the last slot and put back when it comes due.
+ *
+ * A timer is placed at the lowest level whose range covers it.  As time
+ * advances, the slots passed over at each level are emptied: timers that
+ * have expired are run, and the rest are placed again, now at a lower
+ * level.  The reactor watcher is set for the first non-empty slot: a
+ * periodic watcher at that absolute time on the wall clock, or with
+ * WHEEL_MONOTONIC, a timer watcher for the delay until then.
+ *
+ * If the wall clock steps backwards, the wheel is moved back with it,
+ * otherwise the ticks between the new time and the old one would pass
+ * with nothing due, and new timers would wait for the clock to catch up.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/monotime.h"
+
+#include "wheel.h"
+
+#define WHEEL_BITS      6
+#define WHEEL_SLOTS     (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS    6
+#define WHEEL_RANGE     (UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS))
+#define TICKS_PER_SEC   1000.
+
+struct link {
+    struct link *next;
+    struct link *prev;
+};
+
+struct wheel_timer {
+    struct link link;           /* must be first */
+    struct wheel *w;
+    double when;
+    uint64_t expires;           /* tick */
+    bool active;
+    wheel_timer_f cb;
+    void *arg;
+};
+
+struct wheel {
+    flux_reactor_t *r;
+    int flags;
+    flux_watcher_t *watcher;
+    uint64_t now;               /* tick up to which the wheel has run */
+    uint64_t armed;             /* tick the watcher is set for */
+    int count;
+    struct link slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    struct link pending;        /* timers taken from slots by wheel_run() */
+};
+
+static void list_init (struct link *head)
+{
+    head->next = head->prev = head;
+}
+
+static bool list_empty (struct link *head)
+{
+    return head->next == head;
+}
+
+static void list_add (struct link *head, struct link *l)
+{
+    l->prev = head->prev;
+    l->next = head;
+    head->prev->next = l;
+    head->prev = l;
+}
+
+static void list_del (struct link *l)
+{
+    l->prev->next = l->next;
+    l->next->prev = l->prev;
+    l->next = l->prev = l;
+}
+
+/* Move all of 'from' to the end of 'to'.
+ */
+static void list_splice (struct link *to, struct link *from)
+{
+    if (!list_empty (from)) {
+        from->next->prev = to->prev;
+        to->prev->next = from->next;
+        from->prev->next = to;
+        to->prev = from->prev;
+        list_init (from);
+    }
+}
+
+static uint64_t now_tick (double t)
+{
+    return t > 0. ? (uint64_t)(t * TICKS_PER_SEC) : 0;
+}
+
+static uint64_t expires_tick (double t)
+{
+    uint64_t tick = now_tick (t);
+    if (tick < t * TICKS_PER_SEC)
+        tick++;
+    return tick;
+}
+
+/* Place timer in its slot and return the tick at which the slot comes due.
+ */
+static uint64_t wheel_place (struct wheel *w, struct wheel_timer *t)
+{
+    uint64_t expires = t->expires;
+    uint64_t delta;
+    int level = 0;
+
+    if (expires <= w->now)
+        expires = w->now + 1;
+    delta = expires - w->now;
+    if (delta >= WHEEL_RANGE) {
+        expires = w->now + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
+    while (delta >= (UINT64_C(1) << (WHEEL_BITS * (level + 1))))
+        level++;
+    expires >>= WHEEL_BITS * level;
+    list_add (&w->slots[level][expires & WHEEL_MASK], &t->link);
+    return expires << (WHEEL_BITS * level);
+}
+
+/* Return the tick at which the first non-empty slot comes due,
+ * or UINT64_MAX if the wheel is empty.
+ */
+static uint64_t wheel_next (struct wheel *w)
+{
+    uint64_t next = UINT64_MAX;
+    int level, i;
+
+    if (w->count == 0)
+        return next;
+    for (level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        uint64_t base = w->now >> shift;
+        for (i = 1; i <= WHEEL_SLOTS; i++) {
+            if (!list_empty (&w->slots[level][(base + i) & WHEEL_MASK])) {
+                uint64_t due = (base + i) << shift;
+                if (due < next)
+                    next = due;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+double wheel_now (struct wheel *w)
+{
+    struct timespec ts;
+
+    if (!w->r)
+        return w->now / TICKS_PER_SEC;
+    if ((w->flags & WHEEL_MONOTONIC)) {
+        monotime (&ts);
+        return ts.tv_sec + ts.tv_nsec * 1E-9;
+    }
+    return flux_reactor_now (w->r);
+}
+
+static void wheel_arm (struct wheel *w, uint64_t next)
+{
+    if (!w->watcher)
+        return;
+    w->armed = next;
+    if (next == UINT64_MAX)
+        flux_watcher_stop (w->watcher);
+    else if ((w->flags & WHEEL_MONOTONIC)) {
+        double after = next / TICKS_PER_SEC - wheel_now (w);
+
+        flux_watcher_stop (w->watcher);
+        flux_timer_watcher_reset (w->watcher, after > 0. ? after : 0., 0.);
+        flux_watcher_start (w->watcher);
+    }
+    else {
+        flux_periodic_watcher_reset (w->watcher, next / TICKS_PER_SEC,
+                                     0., NULL);
+        flux_watcher_start (w->watcher);
+    }
+}
+
+/* The clock stepped back to 'tick': move the wheel back with it and
+ * place all timers again.  No timer can have expired.
+ */
+static void wheel_resync (struct wheel *w, uint64_t tick)
+{
+    int level, i;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (i = 0; i < WHEEL_SLOTS; i++)
+            list_splice (&w->pending, &w->slots[level][i]);
+    w->now = tick;
+    while (!list_empty (&w->pending)) {
+        struct wheel_timer *t = (struct wheel_timer *)w->pending.next;
+
+        list_del (&t->link);
+        (void)wheel_place (w, t);
+    }
+    wheel_arm (w, wheel_next (w));
+}
+
+void wheel_run (struct wheel *w, double now)
+{
+    uint64_t tick = now_tick (now);
+    int level;
+
+    if (tick < w->now)
+        wheel_resync (w, tick);
+    if (tick <= w->now)
+        goto done;
+    for (level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        uint64_t from = w->now >> shift;
+        uint64_t to = tick >> shift;
+        uint64_t i;
+
+        if (from == to)
+            break;
+        for (i = from + 1; i <= to && i <= from + WHEEL_SLOTS; i++)
+            list_splice (&w->pending, &w->slots[level][i & WHEEL_MASK]);
+    }
+    w->now = tick;
+    while (!list_empty (&w->pending)) {
+        struct wheel_timer *t = (struct wheel_timer *)w->pending.next;
+
+        list_del (&t->link);
+        if (t->expires <= tick) {
+            t->active = false;
+            w->count--;
+            t->cb (t, t->arg);
+        }
+        else
+            (void)wheel_place (w, t);
+    }
+done:
+    wheel_arm (w, wheel_next (w));
+}
+
+static void wheel_cb (flux_reactor_t *r, flux_watcher_t *watcher,
+                      int revents, void *arg)
+{
+    struct wheel *w = arg;
+    wheel_run (w, wheel_now (w));
+}
+
+int wheel_count (struct wheel *w)
+{
+    return w ? w->count : 0;
+}
+
+void wheel_destroy (struct wheel *w)
+{
+    if (w) {
+        flux_watcher_destroy (w->watcher);
+        free (w);
+    }
+}
+
+struct wheel *wheel_create (flux_reactor_t *r, int flags)
+{
+    struct wheel *w;
+    int level, i;
+
+    if (!(w = calloc (1, sizeof (*w))))
+        return NULL;
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (i = 0; i < WHEEL_SLOTS; i++)
+            list_init (&w->slots[level][i]);
+    list_init (&w->pending);
+    w->armed = UINT64_MAX;
+    w->flags = flags;
+    if (r) {
+        w->r = r;
+        w->now = now_tick (wheel_now (w));
+        if ((flags & WHEEL_MONOTONIC))
+            w->watcher = flux_timer_watcher_create (r, 0., 0., wheel_cb, w);
+        else
+            w->watcher = flux_periodic_watcher_create (r, 0., 0., NULL,
+                                                       wheel_cb, w);
+        if (!w->watcher) {
+            wheel_destroy (w);
+            return NULL;
+        }
+    }
+    return w;
+}
+
+void wheel_timer_stop (struct wheel_timer *t)
+{
+    if (t && t->active) {
+        list_del (&t->link);
+        t->active = false;
+        t->w->count--;
+    }
+}
+
+void wheel_timer_start (struct wheel_timer *t, double when)
+{
+    struct wheel *w;
+    uint64_t due;
+
+    if (!t)
+        return;
+    w = t->w;
+    wheel_timer_stop (t);
+    if (w->r) {
+        uint64_t tick = now_tick (wheel_now (w));
+        if (tick < w->now)
+            wheel_resync (w, tick);
+        else if (w->count == 0)
+            w->now = tick;
+    }
+    t->when = when;
+    t->expires = expires_tick (when);
+    t->active = true;
+    w->count++;
+    if ((due = wheel_place (w, t)) < w->armed)
+        wheel_arm (w, due);
+}
+
+bool wheel_timer_active (struct wheel_timer *t)
+{
+    return t ? t->active : false;
+}
+
+double wheel_timer_expires (struct wheel_timer *t)
+{
+    return t ? t->when : 0.;
+}
+
+void wheel_timer_destroy (struct wheel_timer *t)
+{
+    if (t) {
+        wheel_timer_stop (t);
+        free (t);
+    }
+}
+
+struct wheel_timer *wheel_timer_create (struct wheel *w,
+                                        wheel_timer_f cb, void *arg)
+{
+    struct wheel_timer *t;
+
+    if (!w || !cb) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(t = calloc (1, sizeof (*t))))
+        return NULL;
+    list_init (&t->link);
+    t->w = w;
+    t->cb = cb;
+    t->arg = arg;
+    return t;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
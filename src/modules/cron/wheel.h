@@ -0,0 +1,83 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef HAVE_CRON_WHEEL_H
+#define HAVE_CRON_WHEEL_H
+
+#include <stdbool.h>
+#include <flux/core.h>
+
+/* Hierarchical timer wheel.
+ *
+ * All timers in a wheel share a single reactor watcher, so the cost of
+ * starting or stopping a timer is O(1) regardless of how many are active.
+ * Expiration times are absolute times on the wheel's clock (see
+ * wheel_now()), with millisecond resolution.  Timers never fire early.
+ *
+ * By default the clock is the wall clock of flux_reactor_now(), for
+ * timers that must expire at a given time of day.  If the wall clock
+ * steps backwards, timers are placed again relative to the new time,
+ * and still expire at their wall clock time.  With WHEEL_MONOTONIC the
+ * clock is CLOCK_MONOTONIC, for timers that expire after a delay
+ * regardless of wall clock steps.
+ */
+
+enum {
+    WHEEL_MONOTONIC = 1,
+};
+
+struct wheel;
+struct wheel_timer;
+
+typedef void (*wheel_timer_f) (struct wheel_timer *t, void *arg);
+
+struct wheel *wheel_create (flux_reactor_t *r, int flags);
+void wheel_destroy (struct wheel *w);
+
+/* Return the current time on the wheel's clock, or with no reactor,
+ * the time up to which the wheel has run.
+ */
+double wheel_now (struct wheel *w);
+
+/* Run callbacks of timers expiring at or before 'now', and cascade
+ * timers that are now close enough to be placed at a finer level.
+ * If 'now' is earlier than the last run, the clock has stepped back,
+ * and all timers are placed again relative to 'now'.
+ * This is called by the wheel's reactor watcher, but may be called
+ * directly to drive the wheel without a reactor, e.g. for testing.
+ */
+void wheel_run (struct wheel *w, double now);
+
+/* Return the number of active timers.
+ */
+int wheel_count (struct wheel *w);
+
+struct wheel_timer *wheel_timer_create (struct wheel *w,
+                                        wheel_timer_f cb, void *arg);
+void wheel_timer_destroy (struct wheel_timer *t);
+
+/* Start timer to expire at absolute time 'when', restarting it if it is
+ * already active.  Timers may be started, stopped, or destroyed from
+ * within any timer callback.
+ */
+void wheel_timer_start (struct wheel_timer *t, double when);
+void wheel_timer_stop (struct wheel_timer *t);
+
+bool wheel_timer_active (struct wheel_timer *t);
+
+/* Return the time the timer is set to expire.
+ */
+double wheel_timer_expires (struct wheel_timer *t);
+
+#endif /* !HAVE_CRON_WHEEL_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
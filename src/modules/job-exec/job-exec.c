@@ -38,11 +38,21 @@
  *
  * JOB STARTING/RUNNING:
  *
- * The current exec service fakes a running job by initiating a timer for
- * the configured duration of the job, or 10us by default. The "start"
+ * By default, the exec service fakes a running job by initiating a timer
+ * for the configured duration of the job, or 10us by default. The "start"
  * response to the job manager is sent just before the timer is started,
  * to simulate the condition when all job shells have been launched.
  *
+ * If the module is loaded on all ranks with the "mode=tree" option, jobs
+ * without a TEST CONFIGURATION are run for real: one job shell is started
+ * on each rank of R, with the launch fanned out down the TBON as described
+ * in launch.c.  The "start" response is sent once all shells are running,
+ * and "finish" once all have exited, with the largest wait status of any
+ * shell.  The job shell is the command given by the "job-shell=PATH"
+ * option, run with the jobid as its only argument, or if unset, the
+ * command of the first jobspec task.  On exception, shells are sent
+ * SIGKILL and the job is finalized once they have exited.
+ *
  * JOB FINISH/CLEANUP:
  *
  * When the timer callback fires, then a "finish" response is sent to
@@ -81,6 +91,9 @@
 #if HAVE_CONFIG_H
 #include "config.h"
 #endif
+#include <unistd.h>
+#include <limits.h>
+#include <signal.h>
 #include <czmq.h>
 #include <jansson.h>
 #include <flux/core.h>
@@ -88,13 +101,18 @@
 
 #include "src/common/libutil/fluid.h"
 #include "src/common/libutil/fsd.h"
+#include "src/common/libutil/macros.h"
 #include "src/common/libeventlog/eventlog.h"
 #include "rset.h"
+#include "launch.h"
 
 struct job_exec_ctx {
     flux_t *              h;
     flux_msg_handler_t ** handlers;
     zhashx_t *            jobs;
+    struct launch *       launch;
+    bool                  tree;             /* run jobs via launch.c     */
+    char *                job_shell;        /* job shell path, if any    */
 };
 
 
@@ -102,6 +120,7 @@ struct job_exec_ctx {
  *  Set from jobspec attributes.system.exec.test object, if any.
  */
 struct testconf {
+    int                   enabled;          /* exec.test object present */
     double                run_duration;     /* duration of fake job in sec  */
     double                cleanup_duration; /* if > 0., duration of epilog  */
     int                   wait_status;      /* reported status for "finish" */
@@ -131,6 +150,7 @@ struct jobinfo {
 
     struct testconf       testconf;
     flux_watcher_t *      timer;
+    flux_future_t *       launch;           /* tree launch, if not simulated */
 
     zhashx_t *            cleanup;
     struct job_exec_ctx * ctx;
@@ -154,6 +174,7 @@ static void jobinfo_decref (struct jobinfo *job)
         resource_set_destroy (job->R);
         json_decref (job->jobspec);
         flux_watcher_destroy (job->timer);
+        flux_future_destroy (job->launch);
         zhashx_destroy (&job->cleanup);
         free (job);
         errno = saved_errno;
@@ -344,6 +365,13 @@ static void jobinfo_started (struct jobinfo *job)
 
 static void jobinfo_kill (struct jobinfo *job)
 {
+    if (job->launch) {
+        /*  Killed shells report "finish" through the launch RPC.
+         */
+        if (launch_kill (job->ctx->h, job->id, SIGKILL) < 0)
+            flux_log_error (job->ctx->h, "jobinfo_kill: launch_kill");
+        return;
+    }
     flux_watcher_stop (job->timer);
     job->running = 0;
     job->wait_status = 0x9; /* Killed */
@@ -382,8 +410,13 @@ static void jobinfo_fatal_verror (struct jobinfo *job, int errnum,
         if (jobinfo_respond_error (job, errnum, msg) < 0)
             flux_log_error (h, "jobinfo_fatal_verror: jobinfo_respond_error");
     }
-    if (job->running)
+    if (job->running) {
         jobinfo_kill (job);
+        /*  Real job shells are finalized once they have exited.
+         */
+        if (job->launch)
+            return;
+    }
     if (jobinfo_finalize (job) < 0) {
         flux_log_error (h, "jobinfo_fatal_verror: jobinfo_finalize");
         jobinfo_decref (job);
@@ -432,6 +465,7 @@ static int init_testconf (flux_t *h, struct testconf *conf, json_t *jobspec)
                      "attributes", "system", "exec",
                      "test", &test) < 0)
         return 0;
+    conf->enabled = 1;
     if (json_unpack_ex (test, &err, 0,
                         "{s?s s?s s?i s?s}",
                         "run_duration", &trun,
@@ -742,9 +776,90 @@ static flux_future_t * ersatz_epilog (struct jobinfo *job)
     return f;
 }
 
+static void launch_continuation (flux_future_t *f, void *arg)
+{
+    struct jobinfo *job = arg;
+    const char *type;
+    int status;
+
+    if (launch_job_get (f, &type, &status) < 0) {
+        const char *errstr = flux_future_error_string (f);
+        job->running = 0;
+        jobinfo_fatal_error (job, 0, "launch: %s",
+                             errstr ? errstr : flux_strerror (errno));
+        return;
+    }
+    if (!strcmp (type, "start")) {
+        jobinfo_emit_event_pack_nowait (job, "running", NULL);
+        jobinfo_started (job);
+        flux_future_reset (f);
+    }
+    else if (!strcmp (type, "finish")) {
+        job->running = 0;
+        job->wait_status = status;
+        jobinfo_complete (job);
+        if (jobinfo_finalize (job) < 0)
+            flux_log_error (job->ctx->h, "jobinfo_finalize");
+    }
+}
+
+/*  Return the job shell command for 'job' as a JSON array.
+ */
+static json_t *jobinfo_shell_cmd (struct jobinfo *job)
+{
+    json_t *cmd = NULL;
+    char id[32];
+
+    if (job->ctx->job_shell) {
+        snprintf (id, sizeof (id), "%ju", (uintmax_t)job->id);
+        return json_pack ("[s s]", job->ctx->job_shell, id);
+    }
+    if (json_unpack (job->jobspec, "{s:[{s:O}]}",
+                                   "tasks",
+                                   "command", &cmd) < 0) {
+        errno = EPROTO;
+        return NULL;
+    }
+    return cmd;
+}
+
+/*  Launch job shells on all ranks of R via the TBON.  The job is
+ *   considered running from here, so an exception kills the shells.
+ */
+static int jobinfo_start_launch (struct jobinfo *job)
+{
+    flux_t *h = job->ctx->h;
+    char cwd[PATH_MAX];
+    json_t *cmd;
+
+    if (job->userid != getuid ()) {
+        errno = EPERM;
+        return -1;
+    }
+    if (!getcwd (cwd, sizeof (cwd)))
+        return -1;
+    if (!(cmd = jobinfo_shell_cmd (job)))
+        return -1;
+    job->launch = launch_job (h, job->id, resource_set_ranks (job->R),
+                              cmd, cwd);
+    json_decref (cmd);
+    if (!job->launch
+        || flux_future_then (job->launch, -1., launch_continuation, job) < 0)
+        return -1;
+    job->running = 1;
+    return 0;
+}
+
 static int jobinfo_start_execution (struct jobinfo *job)
 {
     jobinfo_emit_event_pack_nowait (job, "starting", NULL);
+    if (job->ctx->tree && !job->testconf.enabled) {
+        if (jobinfo_start_launch (job) < 0) {
+            jobinfo_fatal_error (job, errno, "job shell launch failed");
+            return -1;
+        }
+        return 0;
+    }
     if (jobinfo_start_timer (job) < 0) {
         jobinfo_fatal_error (job, errno, "start timer failed");
         return -1;
@@ -1039,8 +1154,6 @@ static size_t job_hash_fn (const void *key)
     return *id;
 }
 
-#define NUMCMP(a,b) ((a)==(b)?0:((a)<(b)?-1:1))
-
 static int job_hash_key_cmp (const void *x, const void *y)
 {
     const flux_jobid_t *id1 = x;
@@ -1053,6 +1166,8 @@ static void job_exec_ctx_destroy (struct job_exec_ctx *ctx)
 {
     if (ctx == NULL)
         return;
+    launch_destroy (ctx->launch);
+    free (ctx->job_shell);
     zhashx_destroy (&ctx->jobs);
     flux_msg_handler_delvec (ctx->handlers);
     free (ctx);
@@ -1089,6 +1204,29 @@ static int exec_hello (flux_t *h, const char *service)
     return rc;
 }
 
+static int process_args (struct job_exec_ctx *ctx, int argc, char **argv)
+{
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        if (!strcmp (argv[i], "mode=tree"))
+            ctx->tree = true;
+        else if (!strcmp (argv[i], "mode=simulated"))
+            ctx->tree = false;
+        else if (!strncmp (argv[i], "job-shell=", 10)) {
+            free (ctx->job_shell);
+            if (!(ctx->job_shell = strdup (argv[i] + 10)))
+                return -1;
+        }
+        else {
+            flux_log (ctx->h, LOG_ERR, "unknown option: %s", argv[i]);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
 static const struct flux_msg_handler_spec htab[]  = {
     { FLUX_MSGTYPE_REQUEST, "job-exec.start", start_cb,     0 },
     { FLUX_MSGTYPE_EVENT,   "job-exception",  exception_cb, 0 },
@@ -1098,22 +1236,37 @@ static const struct flux_msg_handler_spec htab[]  = {
 int mod_main (flux_t *h, int argc, char **argv)
 {
     int rc = -1;
+    uint32_t rank = FLUX_NODEID_ANY;
     struct job_exec_ctx *ctx = job_exec_ctx_create (h);
 
-    if (flux_msg_handler_addvec (h, htab, ctx, &ctx->handlers) < 0) {
-        flux_log_error (h, "flux_msg_handler_addvec");
+    if (process_args (ctx, argc, argv) < 0)
         goto out;
-    }
-    if (flux_event_subscribe (h, "job-exception") < 0) {
-        flux_log_error (h, "flux_event_subscribe");
+    if (flux_get_rank (h, &rank) < 0) {
+        flux_log_error (h, "flux_get_rank");
         goto out;
     }
-    if (exec_hello (h, "job-exec") < 0)
+    if (!(ctx->launch = launch_create (h))) {
+        flux_log_error (h, "launch_create");
         goto out;
+    }
+    /*  Ranks other than 0 only launch job shells on behalf of rank 0.
+     */
+    if (rank == 0) {
+        if (flux_msg_handler_addvec (h, htab, ctx, &ctx->handlers) < 0) {
+            flux_log_error (h, "flux_msg_handler_addvec");
+            goto out;
+        }
+        if (flux_event_subscribe (h, "job-exception") < 0) {
+            flux_log_error (h, "flux_event_subscribe");
+            goto out;
+        }
+        if (exec_hello (h, "job-exec") < 0)
+            goto out;
+    }
 
     rc = flux_reactor_run (flux_get_reactor (h), 0);
 out:
-    if (flux_event_unsubscribe (h, "job-exception") < 0)
+    if (rank == 0 && flux_event_unsubscribe (h, "job-exception") < 0)
         flux_log_error (h, "flux_event_unsubscribe ('job-exception')");
     job_exec_ctx_destroy (ctx);
     return rc;
@@ -0,0 +1,742 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* launch.c - start job shells by fanning out over the TBON
+ *
+ * A job-exec.launch request carries the set of ranks that should run
+ * a shell.  The receiving rank partitions that set by TBON subtree,
+ * starts its own shell if it is a member, and forwards one launch
+ * request to each child whose subtree contains members.  Children do
+ * the same recursively.
+ *
+ * Each local shell and each child subtree is a "member" of the launch.
+ * A rank responds upstream with "start" once all of its members have
+ * started, and with "finish" (carrying the largest wait status seen)
+ * once all have exited, so every rank, including the job-exec instance
+ * on rank 0, handles O(k) messages per job for a tree of fanout k.
+ *
+ * If a member fails, the error is held and the remaining members are
+ * sent SIGKILL.  Once all members have finished, the error is returned
+ * upstream in place of "finish", so that a final response always means
+ * no shells remain in that subtree.
+ *
+ * job-exec.kill is a no-response request that follows the same tree,
+ * signaling local shells and forwarding to child subtrees that have
+ * not yet finished.
+ *
+ * A job is finished from within the callback of one of its members'
+ * subprocesses or RPCs, so once the final response is sent, the job is
+ * only moved to a list of zombies, which are destroyed from a prepare
+ * watcher on the next reactor loop iteration.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <unistd.h>
+#include <signal.h>
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+#include <flux/idset.h>
+
+#include "src/common/libutil/macros.h"
+
+#include "launch.h"
+
+extern char **environ;
+
+struct launch {
+    flux_t *h;
+    flux_msg_handler_t **handlers;
+    uint32_t rank;
+    uint32_t size;
+    int k;
+    zhashx_t *jobs;
+    zlist_t *zombies;       /* finished jobs, to be destroyed */
+    flux_watcher_t *prep;   /* destroys zombies */
+};
+
+struct ljob;
+
+struct member {
+    struct ljob *job;
+    uint32_t rank;
+    flux_subprocess_t *p;   /* local shell, or */
+    flux_future_t *f;       /* launch request to child subtree */
+    uint8_t started:1;
+    uint8_t finished:1;
+    uint8_t failed:1;
+};
+
+struct ljob {
+    struct launch *l;
+    flux_jobid_t id;
+    flux_msg_t *req;
+    json_t *cmd;            /* borrowed from req */
+    const char *cwd;        /* borrowed from req */
+    zlist_t *members;
+    int starting;           /* members not yet started */
+    int pending;            /* members not yet finished */
+    int status;             /* largest wait status of finished members */
+    int signum;             /* last signal delivered, for late starters */
+    int errnum;
+    char errbuf[160];
+    uint8_t start_sent:1;
+};
+
+static void member_started (struct member *m);
+static void member_finished (struct member *m, int status);
+static void member_failed (struct member *m, int errnum, const char *errstr);
+
+int launch_route (int k, uint32_t rank, uint32_t target)
+{
+    if (k < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (target == rank)
+        return rank;
+    while (target > rank) {
+        uint32_t parent = (target - 1) / k;
+        if (parent == rank)
+            return target;
+        target = parent;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+static flux_future_t *launch_rpc (flux_t *h, uint32_t nodeid,
+                                  flux_jobid_t id, const char *ranks,
+                                  json_t *cmd, const char *cwd)
+{
+    return flux_rpc_pack (h, "job-exec.launch", nodeid, FLUX_RPC_STREAMING,
+                          "{s:I s:s s:O s:s}",
+                          "id", id,
+                          "ranks", ranks,
+                          "cmd", cmd,
+                          "cwd", cwd);
+}
+
+flux_future_t *launch_job (flux_t *h, flux_jobid_t id,
+                           const struct idset *ranks,
+                           json_t *cmd, const char *cwd)
+{
+    flux_future_t *f;
+    char *s;
+
+    if (!h || !ranks || !json_is_array (cmd) || !cwd) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(s = idset_encode (ranks, IDSET_FLAG_RANGE)))
+        return NULL;
+    f = launch_rpc (h, FLUX_NODEID_ANY, id, s, cmd, cwd);
+    free (s);
+    return f;
+}
+
+int launch_job_get (flux_future_t *f, const char **type, int *status)
+{
+    const char *t;
+    int s = 0;
+
+    if (flux_rpc_get_unpack (f, "{s:s s?i}", "type", &t, "status", &s) < 0)
+        return -1;
+    if (type)
+        *type = t;
+    if (status)
+        *status = s;
+    return 0;
+}
+
+static int send_kill (flux_t *h, uint32_t nodeid, flux_jobid_t id, int signum)
+{
+    flux_future_t *f;
+
+    if (!(f = flux_rpc_pack (h, "job-exec.kill", nodeid, FLUX_RPC_NORESPONSE,
+                             "{s:I s:i}",
+                             "id", id,
+                             "signal", signum)))
+        return -1;
+    flux_future_destroy (f);
+    return 0;
+}
+
+int launch_kill (flux_t *h, flux_jobid_t id, int signum)
+{
+    return send_kill (h, FLUX_NODEID_ANY, id, signum);
+}
+
+static void member_signal (struct member *m, int signum)
+{
+    flux_t *h = m->job->l->h;
+
+    if (m->finished || m->failed)
+        return;
+    if (m->p) {
+        flux_future_t *f;
+        if (flux_subprocess_state (m->p) != FLUX_SUBPROCESS_RUNNING)
+            return; // signaled from member_started()
+        if (!(f = flux_subprocess_kill (m->p, signum)))
+            flux_log_error (h, "%ju: flux_subprocess_kill", m->job->id);
+        /* ignore response */
+        flux_future_destroy (f);
+    }
+    else if (send_kill (h, m->rank, m->job->id, signum) < 0)
+        flux_log_error (h, "%ju: kill rank %u", m->job->id, m->rank);
+}
+
+static void ljob_signal (struct ljob *job, int signum)
+{
+    struct member *m;
+
+    job->signum = signum;
+    m = zlist_first (job->members);
+    while (m) {
+        member_signal (m, signum);
+        m = zlist_next (job->members);
+    }
+}
+
+static void member_destroy (struct member *m)
+{
+    if (m) {
+        int saved_errno = errno;
+        if (m->p && !m->finished && !m->failed)
+            member_signal (m, SIGKILL);
+        flux_subprocess_destroy (m->p);
+        flux_future_destroy (m->f);
+        free (m);
+        errno = saved_errno;
+    }
+}
+
+static void ljob_destroy (struct ljob *job)
+{
+    if (job) {
+        int saved_errno = errno;
+        if (job->members) {
+            struct member *m;
+            while ((m = zlist_pop (job->members)))
+                member_destroy (m);
+            zlist_destroy (&job->members);
+        }
+        flux_msg_destroy (job->req);
+        free (job);
+        errno = saved_errno;
+    }
+}
+
+static struct ljob *ljob_create (struct launch *l, const flux_msg_t *msg,
+                                 const char **ranks)
+{
+    struct ljob *job;
+    size_t index;
+    json_t *arg;
+
+    if (!(job = calloc (1, sizeof (*job))))
+        return NULL;
+    job->l = l;
+    if (!(job->req = flux_msg_copy (msg, true)))
+        goto error;
+    if (flux_request_unpack (job->req, NULL, "{s:I s:s s:o s:s}",
+                                             "id", &job->id,
+                                             "ranks", ranks,
+                                             "cmd", &job->cmd,
+                                             "cwd", &job->cwd) < 0)
+        goto error;
+    if (!json_is_array (job->cmd) || json_array_size (job->cmd) == 0)
+        goto eproto;
+    json_array_foreach (job->cmd, index, arg) {
+        if (!json_is_string (arg))
+            goto eproto;
+    }
+    if (!(job->members = zlist_new ()))
+        goto nomem;
+    return job;
+eproto:
+    errno = EPROTO;
+    goto error;
+nomem:
+    errno = ENOMEM;
+error:
+    ljob_destroy (job);
+    return NULL;
+}
+
+/* Forget a finished job.  Defer destroying it, since a member callback
+ * that finished it may still be on the stack.
+ */
+static void ljob_retire (struct ljob *job)
+{
+    struct launch *l = job->l;
+
+    zhashx_delete (l->jobs, &job->id);
+    if (zlist_append (l->zombies, job) < 0) {
+        flux_log (l->h, LOG_ERR, "%ju: out of memory, leaking job", job->id);
+        return;
+    }
+    flux_watcher_start (l->prep);
+}
+
+static void prep_cb (flux_reactor_t *r, flux_watcher_t *w,
+                     int revents, void *arg)
+{
+    struct launch *l = arg;
+    struct ljob *job;
+
+    while ((job = zlist_pop (l->zombies)))
+        ljob_destroy (job);
+    flux_watcher_stop (w);
+}
+
+/* Send "start" once all members have started, and the final response
+ * once all have finished, then forget the job.
+ */
+static void ljob_check (struct ljob *job)
+{
+    struct launch *l = job->l;
+
+    if (job->starting == 0 && !job->start_sent && job->errnum == 0) {
+        if (flux_respond_pack (l->h, job->req, "{s:s}", "type", "start") < 0)
+            flux_log_error (l->h, "%ju: error responding to launch", job->id);
+        job->start_sent = 1;
+    }
+    if (job->pending == 0) {
+        if (job->errnum) {
+            if (flux_respond_error (l->h, job->req, job->errnum,
+                                    job->errbuf) < 0)
+                flux_log_error (l->h, "%ju: error responding to launch",
+                                job->id);
+        }
+        else {
+            if (flux_respond_pack (l->h, job->req, "{s:s s:i}",
+                                   "type", "finish",
+                                   "status", job->status) < 0)
+                flux_log_error (l->h, "%ju: error responding to launch",
+                                job->id);
+        }
+        ljob_retire (job);
+    }
+}
+
+static void member_started (struct member *m)
+{
+    struct ljob *job = m->job;
+
+    if (m->started)
+        return;
+    m->started = 1;
+    if (m->p && job->signum != 0)
+        member_signal (m, job->signum);
+    job->starting--;
+    ljob_check (job);
+}
+
+static void member_finished (struct member *m, int status)
+{
+    struct ljob *job = m->job;
+
+    if (m->finished)
+        return;
+    m->finished = 1;
+    if (!m->started) {
+        m->started = 1;
+        job->starting--;
+    }
+    if (status > job->status)
+        job->status = status;
+    job->pending--;
+    ljob_check (job);
+}
+
+static void member_failed (struct member *m, int errnum, const char *errstr)
+{
+    struct ljob *job = m->job;
+
+    if (job->errnum == 0) {
+        job->errnum = errnum ? errnum : EPROTO;
+        snprintf (job->errbuf, sizeof (job->errbuf), "%s", errstr);
+    }
+    m->failed = 1;
+    ljob_signal (job, SIGKILL);
+    member_finished (m, 0);
+}
+
+static void shell_state_cb (flux_subprocess_t *p,
+                            flux_subprocess_state_t state)
+{
+    struct member *m = flux_subprocess_aux_get (p, "member");
+    char buf[128];
+
+    if (state == FLUX_SUBPROCESS_RUNNING)
+        member_started (m);
+    else if (state == FLUX_SUBPROCESS_EXEC_FAILED
+             || state == FLUX_SUBPROCESS_FAILED) {
+        int errnum = flux_subprocess_fail_errno (p);
+        snprintf (buf, sizeof (buf), "rank %u: %s: %s",
+                  m->rank,
+                  state == FLUX_SUBPROCESS_FAILED ? "rexec" : "exec",
+                  flux_strerror (errnum));
+        member_failed (m, errnum, buf);
+    }
+}
+
+static void shell_completion_cb (flux_subprocess_t *p)
+{
+    struct member *m = flux_subprocess_aux_get (p, "member");
+
+    member_finished (m, flux_subprocess_status (p));
+}
+
+/* Until the job shell has somewhere better to send it, shell output
+ * goes to the broker log.
+ */
+static void shell_output_cb (flux_subprocess_t *p, const char *stream)
+{
+    struct member *m = flux_subprocess_aux_get (p, "member");
+    flux_t *h = m->job->l->h;
+    const char *ptr;
+    int len;
+
+    if (!(ptr = flux_subprocess_read_trimmed_line (p, stream, &len))) {
+        flux_log_error (h, "%ju: flux_subprocess_read_trimmed_line",
+                        m->job->id);
+        return;
+    }
+    if (len == 0) {
+        if (!(ptr = flux_subprocess_read (p, stream, -1, &len))) {
+            flux_log_error (h, "%ju: flux_subprocess_read", m->job->id);
+            return;
+        }
+    }
+    if (len > 0)
+        flux_log (h, !strcmp (stream, "STDERR") ? LOG_ERR : LOG_INFO,
+                  "%ju: %.*s", m->job->id, len, ptr);
+}
+
+static flux_cmd_t *shell_cmd_create (struct ljob *job)
+{
+    flux_cmd_t *cmd;
+    size_t index;
+    json_t *arg;
+
+    if (!(cmd = flux_cmd_create (0, NULL, environ)))
+        return NULL;
+    json_array_foreach (job->cmd, index, arg) {
+        if (flux_cmd_argv_append (cmd, "%s", json_string_value (arg)) < 0)
+            goto error;
+    }
+    if (flux_cmd_setcwd (cmd, job->cwd) < 0
+        || flux_cmd_setenvf (cmd, 1, "FLUX_JOB_ID", "%ju", job->id) < 0)
+        goto error;
+    return cmd;
+error:
+    flux_cmd_destroy (cmd);
+    return NULL;
+}
+
+static int member_start_local (struct member *m)
+{
+    struct ljob *job = m->job;
+    flux_subprocess_ops_t ops = {
+        .on_completion = shell_completion_cb,
+        .on_state_change = shell_state_cb,
+        .on_channel_out = NULL,
+        .on_stdout = shell_output_cb,
+        .on_stderr = shell_output_cb,
+    };
+    flux_cmd_t *cmd;
+    int rc = -1;
+
+    if (!(cmd = shell_cmd_create (job)))
+        return -1;
+    if (!(m->p = flux_rexec (job->l->h, m->rank, 0, cmd, &ops)))
+        goto done;
+    if (flux_subprocess_aux_set (m->p, "member", m, NULL) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_cmd_destroy (cmd);
+    return rc;
+}
+
+static void child_continuation (flux_future_t *f, void *arg)
+{
+    struct member *m = arg;
+    const char *type;
+    int status;
+
+    if (launch_job_get (f, &type, &status) < 0) {
+        const char *errstr = flux_future_error_string (f);
+        char buf[128];
+        if (!errstr) {
+            snprintf (buf, sizeof (buf), "rank %u: %s",
+                      m->rank, flux_strerror (errno));
+            errstr = buf;
+        }
+        member_failed (m, errno, errstr);
+        return;
+    }
+    if (!strcmp (type, "start")) {
+        flux_future_reset (f);
+        member_started (m);
+    }
+    else if (!strcmp (type, "finish"))
+        member_finished (m, status);
+    else {
+        char buf[64];
+        snprintf (buf, sizeof (buf), "rank %u: unknown response type",
+                  m->rank);
+        member_failed (m, EPROTO, buf);
+    }
+}
+
+static int member_start_child (struct member *m, const struct idset *ranks)
+{
+    struct ljob *job = m->job;
+    char *s;
+
+    if (!(s = idset_encode (ranks, IDSET_FLAG_RANGE)))
+        return -1;
+    m->f = launch_rpc (job->l->h, m->rank, job->id, s, job->cmd, job->cwd);
+    free (s);
+    if (!m->f || flux_future_then (m->f, -1., child_continuation, m) < 0)
+        return -1;
+    return 0;
+}
+
+/* Add a member for 'rank' and start it.  A member that cannot be
+ * started is failed immediately, which kills any that were.
+ */
+static void ljob_add_member (struct ljob *job, uint32_t rank,
+                             const struct idset *ranks)
+{
+    struct member *m;
+    char buf[128];
+    int rc;
+
+    if (!(m = calloc (1, sizeof (*m)))
+        || zlist_append (job->members, m) < 0) {
+        free (m);
+        if (job->errnum == 0) {
+            job->errnum = ENOMEM;
+            snprintf (job->errbuf, sizeof (job->errbuf), "out of memory");
+        }
+        ljob_signal (job, SIGKILL);
+        return;
+    }
+    m->job = job;
+    m->rank = rank;
+    job->starting++;
+    job->pending++;
+    if (ranks)
+        rc = member_start_child (m, ranks);
+    else
+        rc = member_start_local (m);
+    if (rc < 0) {
+        snprintf (buf, sizeof (buf), "rank %u: launch: %s",
+                  rank, flux_strerror (errno));
+        member_failed (m, errno, buf);
+    }
+}
+
+/* Partition 'ranks' into the subtrees of this rank's children.
+ * sub[i] is set to the ranks under child k*rank+1+i, or NULL if none.
+ * '*local' is set true if this rank is itself a member.
+ */
+static int split_ranks (struct launch *l, const struct idset *ranks,
+                        bool *local, struct idset **sub)
+{
+    unsigned int id;
+    int r;
+
+    *local = false;
+    id = idset_first (ranks);
+    while (id != IDSET_INVALID_ID) {
+        if (id >= l->size || (r = launch_route (l->k, l->rank, id)) < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        if ((uint32_t)r == l->rank)
+            *local = true;
+        else {
+            int i = r - (l->k * l->rank + 1);
+            if (!sub[i] && !(sub[i] = idset_create (0, IDSET_FLAG_AUTOGROW)))
+                return -1;
+            if (idset_set (sub[i], id) < 0)
+                return -1;
+        }
+        id = idset_next (ranks, id);
+    }
+    return 0;
+}
+
+static void launch_cb (flux_t *h, flux_msg_handler_t *mh,
+                       const flux_msg_t *msg, void *arg)
+{
+    struct launch *l = arg;
+    struct ljob *job = NULL;
+    struct idset *ranks = NULL;
+    struct idset **sub = NULL;
+    const char *s;
+    const char *errstr = NULL;
+    bool local;
+    int i;
+
+    if (!(job = ljob_create (l, msg, &s)))
+        goto error;
+    if (!(ranks = idset_decode (s)) || idset_count (ranks) == 0) {
+        errno = EINVAL;
+        errstr = "invalid ranks";
+        goto error;
+    }
+    if (!(sub = calloc (l->k, sizeof (*sub))))
+        goto error;
+    if (split_ranks (l, ranks, &local, sub) < 0) {
+        errstr = "ranks are not in this subtree";
+        goto error;
+    }
+    if (zhashx_insert (l->jobs, &job->id, job) < 0) {
+        errno = EEXIST;
+        errstr = "job is already being launched on this rank";
+        goto error;
+    }
+    /* Hold a reference on both counts while members are added so that
+     * an early failure cannot complete the job out from under us.
+     */
+    job->starting++;
+    job->pending++;
+    if (local)
+        ljob_add_member (job, l->rank, NULL);
+    for (i = 0; i < l->k; i++) {
+        if (sub[i])
+            ljob_add_member (job, l->k * l->rank + 1 + i, sub[i]);
+    }
+    job->starting--;
+    job->pending--;
+    ljob_check (job);
+    goto done;
+error:
+    if (flux_respond_error (h, msg, errno, errstr) < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+    ljob_destroy (job);
+done:
+    if (sub) {
+        for (i = 0; i < l->k; i++)
+            idset_destroy (sub[i]);
+        free (sub);
+    }
+    idset_destroy (ranks);
+}
+
+static void kill_cb (flux_t *h, flux_msg_handler_t *mh,
+                     const flux_msg_t *msg, void *arg)
+{
+    struct launch *l = arg;
+    struct ljob *job;
+    flux_jobid_t id;
+    int signum;
+
+    if (flux_request_unpack (msg, NULL, "{s:I s:i}",
+                                        "id", &id,
+                                        "signal", &signum) < 0) {
+        flux_log_error (h, "%s: flux_request_unpack", __FUNCTION__);
+        return;
+    }
+    if ((job = zhashx_lookup (l->jobs, &id)))
+        ljob_signal (job, signum);
+}
+
+static size_t ljob_hash_fn (const void *key)
+{
+    const flux_jobid_t *id = key;
+    return *id;
+}
+
+static int ljob_hash_key_cmp (const void *x, const void *y)
+{
+    const flux_jobid_t *id1 = x;
+    const flux_jobid_t *id2 = y;
+
+    return NUMCMP (*id1, *id2);
+}
+
+static const struct flux_msg_handler_spec htab[] = {
+    { FLUX_MSGTYPE_REQUEST, "job-exec.launch", launch_cb, 0 },
+    { FLUX_MSGTYPE_REQUEST, "job-exec.kill",   kill_cb,   0 },
+    FLUX_MSGHANDLER_TABLE_END
+};
+
+void launch_destroy (struct launch *l)
+{
+    if (l) {
+        int saved_errno = errno;
+        struct ljob *job;
+        flux_msg_handler_delvec (l->handlers);
+        if (l->jobs) {
+            job = zhashx_first (l->jobs);
+            while (job) {
+                ljob_destroy (job);
+                job = zhashx_next (l->jobs);
+            }
+            zhashx_destroy (&l->jobs);
+        }
+        if (l->zombies) {
+            while ((job = zlist_pop (l->zombies)))
+                ljob_destroy (job);
+            zlist_destroy (&l->zombies);
+        }
+        flux_watcher_destroy (l->prep);
+        free (l);
+        errno = saved_errno;
+    }
+}
+
+struct launch *launch_create (flux_t *h)
+{
+    struct launch *l;
+    const char *s;
+
+    if (!(l = calloc (1, sizeof (*l))))
+        return NULL;
+    l->h = h;
+    if (flux_get_rank (h, &l->rank) < 0
+        || flux_get_size (h, &l->size) < 0)
+        goto error;
+    if (!(s = flux_attr_get (h, "tbon.arity"))
+        || (l->k = strtol (s, NULL, 10)) < 1) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (!(l->jobs = zhashx_new ()) || !(l->zombies = zlist_new ()))
+        goto nomem;
+    zhashx_set_key_hasher (l->jobs, ljob_hash_fn);
+    zhashx_set_key_comparator (l->jobs, ljob_hash_key_cmp);
+    zhashx_set_key_duplicator (l->jobs, NULL);
+    zhashx_set_key_destructor (l->jobs, NULL);
+    if (!(l->prep = flux_prepare_watcher_create (flux_get_reactor (h),
+                                                 prep_cb, l)))
+        goto error;
+    if (flux_msg_handler_addvec (h, htab, l, &l->handlers) < 0)
+        goto error;
+    return l;
+nomem:
+    errno = ENOMEM;
+error:
+    launch_destroy (l);
+    return NULL;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
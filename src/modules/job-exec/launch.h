@@ -0,0 +1,60 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef HAVE_JOB_EXEC_LAUNCH_H
+#define HAVE_JOB_EXEC_LAUNCH_H 1
+
+#include <flux/core.h>
+#include <flux/idset.h>
+#include <jansson.h>
+
+struct launch;
+
+/* Register job-exec.launch and job-exec.kill handlers on 'h'.
+ * Every rank that may run job shells must have one of these.
+ */
+struct launch *launch_create (flux_t *h);
+void launch_destroy (struct launch *l);
+
+/* Launch 'cmd' (a JSON array of strings) once on each rank of 'ranks'
+ * in working directory 'cwd'.  The request is sent to the local rank,
+ * which starts its own shell if it is a member of 'ranks', and forwards
+ * the remainder down the TBON, each child receiving only the ranks in
+ * its subtree.  Each level aggregates replies from its subtree so that
+ * the caller receives exactly two responses regardless of size:
+ * {"type":"start"} once all shells are running, then
+ * {"type":"finish","status":i} with the largest wait status once all
+ * have exited.  If any shell fails to start, the remaining shells are
+ * killed and the final response is an error.  Call flux_future_reset()
+ * after consuming the "start" response.
+ */
+flux_future_t *launch_job (flux_t *h, flux_jobid_t id,
+                           const struct idset *ranks,
+                           json_t *cmd, const char *cwd);
+
+/* Get type of current response, and if "finish", the aggregate status.
+ */
+int launch_job_get (flux_future_t *f, const char **type, int *status);
+
+/* Deliver signal 'signum' to all shells of job 'id' (no response).
+ */
+int launch_kill (flux_t *h, flux_jobid_t id, int signum);
+
+/* Return the rank on the path from 'rank' down to 'target' in a tree of
+ * fanout 'k', i.e. 'rank' itself or one of its children.
+ * Fail with EINVAL if 'target' is not in the subtree rooted at 'rank'.
+ */
+int launch_route (int k, uint32_t rank, uint32_t target);
+
+#endif /* !HAVE_JOB_EXEC_LAUNCH_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
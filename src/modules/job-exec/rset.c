@@ -32,17 +32,11 @@ void resource_set_destroy (struct resource_set *r)
 
 static int idset_add_set (struct idset *set, struct idset *new)
 {
-    unsigned int i = idset_first (new);
-    while (i != IDSET_INVALID_ID) {
-        if (idset_test (set, i)) {
-            errno = EEXIST;
-            return -1;
-        }
-        if (idset_set (set, i) < 0)
-            return -1;
-        i = idset_next (new, i);
+    if (idset_has_intersection (set, new)) {
+        errno = EEXIST;
+        return -1;
     }
-    return 0;
+    return idset_union (set, new);
 }
 
 static int idset_set_string (struct idset *idset, const char *ids)
@@ -0,0 +1,265 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <jansson.h>
+#include <flux/core.h>
+#include <flux/idset.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libflux/test/util.h"
+#include "launch.h"
+
+struct route_test {
+    int k;
+    uint32_t rank;
+    uint32_t target;
+    int expected;
+};
+
+static struct route_test route_tests[] = {
+    /* binary tree: 0 -> 1,2; 1 -> 3,4; 2 -> 5,6; 3 -> 7,8 */
+    { 2, 0, 0,  0 },
+    { 2, 0, 1,  1 },
+    { 2, 0, 2,  2 },
+    { 2, 0, 4,  1 },
+    { 2, 0, 5,  2 },
+    { 2, 0, 8,  1 },
+    { 2, 1, 8,  3 },
+    { 2, 3, 8,  8 },
+    { 2, 1, 5, -1 },
+    { 2, 2, 0, -1 },
+    { 2, 4, 2, -1 },
+    /* flat tree */
+    { 1024, 0, 1000, 1000 },
+    { 1024, 5, 1000, -1 },
+    /* chain */
+    { 1, 0, 7,  1 },
+    { 1, 6, 7,  7 },
+    { 1, 7, 6, -1 },
+    { -1, 0, 0, 0 },
+};
+
+void test_route (void)
+{
+    int i;
+    int n = sizeof (route_tests) / sizeof (route_tests[0]);
+
+    for (i = 0; i < n; i++) {
+        struct route_test *t = &route_tests[i];
+        int rc;
+
+        errno = 0;
+        rc = launch_route (t->k, t->rank, t->target);
+        if (t->expected < 0 || t->k < 1)
+            ok (rc < 0 && errno == EINVAL,
+                "launch_route k=%d rank=%u target=%u fails with EINVAL",
+                t->k, t->rank, t->target);
+        else
+            ok (rc == t->expected,
+                "launch_route k=%d rank=%u target=%u returns %d",
+                t->k, t->rank, t->target, t->expected);
+    }
+}
+
+/* Stand-in for the job-exec.launch and job-exec.kill services on
+ * ranks 1 and 2, the children of rank 0 in a binary tree of size 3.
+ * Rank 1 responds "start" and then either "finish" with 'status[1]'
+ * or, if 'hold' is set, waits for job-exec.kill before finishing.
+ * Rank 2 responds "start" and then "finish" with 'status[2]', or fails
+ * with 'errnum' if it is nonzero.
+ */
+struct child_srv {
+    int status[3];
+    int hold;
+    int errnum;
+    flux_msg_t *held;
+    int kills;
+    int killsig;
+};
+
+static void child_launch_cb (flux_t *h, flux_msg_handler_t *mh,
+                             const flux_msg_t *msg, void *arg)
+{
+    struct child_srv *srv = arg;
+    uint32_t nodeid;
+
+    if (flux_msg_get_nodeid (msg, &nodeid) < 0 || nodeid < 1 || nodeid > 2)
+        BAIL_OUT ("child launch request has unexpected nodeid");
+    if (flux_respond_pack (h, msg, "{s:s}", "type", "start") < 0)
+        BAIL_OUT ("flux_respond_pack failed");
+    if (nodeid == 1 && srv->hold) {
+        if (!(srv->held = flux_msg_copy (msg, true)))
+            BAIL_OUT ("flux_msg_copy failed");
+        return;
+    }
+    if (nodeid == 2 && srv->errnum) {
+        if (flux_respond_error (h, msg, srv->errnum, NULL) < 0)
+            BAIL_OUT ("flux_respond_error failed");
+        return;
+    }
+    if (flux_respond_pack (h, msg, "{s:s s:i}",
+                                   "type", "finish",
+                                   "status", srv->status[nodeid]) < 0)
+        BAIL_OUT ("flux_respond_pack failed");
+}
+
+static void child_kill_cb (flux_t *h, flux_msg_handler_t *mh,
+                           const flux_msg_t *msg, void *arg)
+{
+    struct child_srv *srv = arg;
+
+    if (flux_request_unpack (msg, NULL, "{s:i}", "signal", &srv->killsig) < 0)
+        BAIL_OUT ("could not decode job-exec.kill request");
+    srv->kills++;
+    if (srv->held) {
+        if (flux_respond_pack (h, srv->held, "{s:s s:i}",
+                                             "type", "finish",
+                                             "status", srv->status[1]) < 0)
+            BAIL_OUT ("flux_respond_pack failed");
+        flux_msg_destroy (srv->held);
+        srv->held = NULL;
+    }
+}
+
+static void launch_continuation (flux_future_t *f, void *arg)
+{
+    char *seq = arg;
+    const char *type;
+    int status;
+    char buf[64];
+
+    if (launch_job_get (f, &type, &status) < 0) {
+        snprintf (buf, sizeof (buf), "error=%d", errno);
+        flux_reactor_stop (flux_future_get_reactor (f));
+    }
+    else if (!strcmp (type, "start")) {
+        snprintf (buf, sizeof (buf), "start");
+        flux_future_reset (f);
+    }
+    else {
+        snprintf (buf, sizeof (buf), "%s=%d", type, status);
+        flux_reactor_stop (flux_future_get_reactor (f));
+    }
+    if (strlen (seq) > 0)
+        strcat (seq, ",");
+    strcat (seq, buf);
+}
+
+/* Launch job 'id' on ranks 1-2 from rank 0 and return the sequence of
+ * responses in 'seq'.  The rank 0 launch service must see the request
+ * before the stand-in child service is started, since the latter,
+ * having been registered last, would otherwise match it first.
+ */
+static void run_launch (flux_t *h, flux_msg_handler_t *child,
+                        flux_jobid_t id, char *seq)
+{
+    flux_reactor_t *r = flux_get_reactor (h);
+    struct idset *ranks;
+    json_t *cmd;
+    flux_future_t *f;
+
+    seq[0] = '\0';
+    if (!(ranks = idset_decode ("1-2")) || !(cmd = json_pack ("[s]", "true")))
+        BAIL_OUT ("could not create launch arguments");
+    if (!(f = launch_job (h, id, ranks, cmd, "/"))
+        || flux_future_then (f, -1., launch_continuation, seq) < 0)
+        BAIL_OUT ("launch_job failed");
+    if (flux_reactor_run (r, FLUX_REACTOR_ONCE) < 0)
+        BAIL_OUT ("flux_reactor_run ONCE failed");
+    flux_msg_handler_start (child);
+    if (flux_reactor_run (r, 0) < 0)
+        BAIL_OUT ("flux_reactor_run failed");
+    flux_msg_handler_stop (child);
+    flux_future_destroy (f);
+    json_decref (cmd);
+    idset_destroy (ranks);
+}
+
+void test_responses (void)
+{
+    struct flux_match match = FLUX_MATCH_REQUEST;
+    struct child_srv srv;
+    flux_msg_handler_t *child;
+    flux_msg_handler_t *kill;
+    struct launch *l;
+    flux_t *h;
+    char seq[256];
+    char exp[64];
+
+    if (!(h = loopback_create (0)))
+        BAIL_OUT ("could not create loopback handle");
+    if (flux_attr_set_cacheonly (h, "rank", "0") < 0
+        || flux_attr_set_cacheonly (h, "size", "3") < 0
+        || flux_attr_set_cacheonly (h, "tbon.arity", "2") < 0)
+        BAIL_OUT ("could not set broker attributes");
+    ok ((l = launch_create (h)) != NULL,
+        "launch_create works");
+
+    memset (&srv, 0, sizeof (srv));
+    match.topic_glob = "job-exec.launch";
+    if (!(child = flux_msg_handler_create (h, match, child_launch_cb, &srv)))
+        BAIL_OUT ("flux_msg_handler_create failed");
+    match.topic_glob = "job-exec.kill";
+    if (!(kill = flux_msg_handler_create (h, match, child_kill_cb, &srv)))
+        BAIL_OUT ("flux_msg_handler_create failed");
+    flux_msg_handler_start (kill);
+
+    srv.status[1] = 0;
+    srv.status[2] = 256;
+    run_launch (h, child, 1, seq);
+    ok (!strcmp (seq, "start,finish=256"),
+        "launch responds start, then finish with largest status");
+    diag ("%s", seq);
+    ok (srv.kills == 0,
+        "no kill was sent");
+
+    /* A finished job is forgotten as soon as it responds, even though
+     * it is destroyed later, so its id may be reused right away.
+     */
+    srv.status[1] = 0;
+    srv.status[2] = 0;
+    run_launch (h, child, 1, seq);
+    ok (!strcmp (seq, "start,finish=0"),
+        "finished job id may be launched again");
+    diag ("%s", seq);
+
+    srv.status[1] = SIGKILL;
+    srv.hold = 1;
+    srv.errnum = EPERM;
+    run_launch (h, child, 2, seq);
+    snprintf (exp, sizeof (exp), "start,error=%d", EPERM);
+    ok (!strcmp (seq, exp),
+        "launch responds start, then error after a member fails");
+    diag ("%s", seq);
+    ok (srv.kills == 1 && srv.killsig == SIGKILL && srv.held == NULL,
+        "SIGKILL was sent to the remaining member before responding");
+
+    flux_msg_handler_destroy (kill);
+    flux_msg_handler_destroy (child);
+    launch_destroy (l);
+    flux_close (h);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_route ();
+    test_responses ();
+
+    done_testing ();
+}
+
+/*
+ * vi:ts=4 sw=4 expandtab
+ */
@@ -22,6 +22,7 @@
 #include "src/common/libutil/fluid.h"
 #include "src/common/libjob/sign_none.h"
 #include "src/common/libeventlog/eventlog.h"
+#include "src/common/libkvs/treeobj.h"
 
 #include "validate.h"
 
@@ -41,6 +42,13 @@
  * The jobid is returned to the user in response to the job-ingest.submit RPC.
  * Responses are sent after the job has been successfully ingested.
  *
+ * To keep per-job copying to a minimum, J is borrowed from the request's
+ * decoded payload rather than copying the message, the unwrapped jobspec
+ * is a single buffer that is passed to the validator without re-encoding
+ * (unless it contains newlines), and both are released as soon as they
+ * have been added to the KVS transaction.  Bytes copied from J/jobspec are
+ * counted and reported by job-ingest.stats.get for debugging.
+ *
  * Currently all KVS data is committed under job.<fluid-dothex>,
  * where <fluid-dothex> is the jobid converted to 16-bit, 0-padded hex
  * strings delimited by periods, e.g.
@@ -51,6 +59,14 @@
  * independent and KVS commit scalability will ultimately limit the max
  * ingest rate for an instance.
  *
+ * With the 'sharded' module option, each rank stores the bulky job data
+ * (J and jobspec) to the content store itself, then commits only a small
+ * directory object per job, referencing the stored blobs, to job.<id>.
+ * Hashing and storing job data is thus spread across ingest ranks, and
+ * the primary namespace commit carries pointers rather than data.
+ * The directory is an ordinary KVS directory once committed, so readers
+ * and later writers of job.<id> are unaffected.
+ *
  * Security: any user with FLUX_ROLE_USER may submit jobs.  The jobspec
  * must be signed, but this module (running as the instance owner) doesn't
  * need to authenticate the signature.  It merely unwraps the contents,
@@ -79,20 +95,28 @@ struct job_ingest_ctx {
 
     struct batch *batch;
     flux_watcher_t *timer;
+    bool sharded;
+
+    struct {
+        uint64_t jobs;          // jobs added to a batch
+        uint64_t bytes_copied;  // bytes of J/jobspec copied (excl. validate)
+    } stats;
 };
 
 struct job {
     fluid_t id;         // jobid
 
-    flux_msg_t *msg;    // copy of submit request message
+    flux_msg_t *msg;    // copy of submit request message (no payload)
+    json_t *J_obj;      // reference on J in request payload
     const char *J;      // signed jobspec
     uint32_t userid;    // submitting userid
     uint32_t rolemask;  // submitting rolemask
     int priority;       // requested job priority
     int flags;          // submit flags
 
-    char *jobspec;      // jobspec, not \0 terminated (unwrapped from signed)
-    int jobspecsz;      // jobspec string length
+    char *jobspec;      // jobspec, unwrapped from signed, followed by \n
+    int jobspecsz;      // jobspec string length, excluding the \n
+    char *eventlog;     // initial eventlog (sharded mode only)
 
     struct job_ingest_ctx *ctx;
 };
@@ -111,7 +135,10 @@ static void job_clean (struct job *job)
     if (job) {
         free (job->jobspec);
         job->jobspec = NULL;
-        (void)flux_msg_set_payload (job->msg, NULL, 0);
+        free (job->eventlog);
+        job->eventlog = NULL;
+        json_decref (job->J_obj);
+        job->J_obj = NULL;
         job->J = NULL;
     }
 }
@@ -121,6 +148,8 @@ static void job_destroy (struct job *job)
     if (job) {
         int saved_errno = errno;
         free (job->jobspec);
+        free (job->eventlog);
+        json_decref (job->J_obj);
         flux_msg_destroy (job->msg);
         free (job);
         errno = saved_errno;
@@ -134,13 +163,22 @@ static struct job *job_create (const flux_msg_t *msg,
 
     if (!(job = calloc (1, sizeof (*job))))
         return NULL;
-    if (!(job->msg = flux_msg_copy (msg, true)))
+    /* Keep a reference on J in the decoded request payload instead of
+     * copying the payload with the message.  The copy is only needed
+     * to respond later.
+     */
+    if (!(job->msg = flux_msg_copy (msg, false)))
         goto error;
-    if (flux_request_unpack (job->msg, NULL, "{s:s s:i s:i}",
-                             "J", &job->J,
+    if (flux_request_unpack (msg, NULL, "{s:o s:i s:i}",
+                             "J", &job->J_obj,
                              "priority", &job->priority,
                              "flags", &job->flags) < 0)
         goto error;
+    json_incref (job->J_obj); // unpack returns a borrowed reference
+    if (!(job->J = json_string_value (job->J_obj))) {
+        errno = EPROTO;
+        goto error;
+    }
     if (flux_msg_get_userid (job->msg, &job->userid) < 0)
         goto error;
     if (flux_msg_get_rolemask (job->msg, &job->rolemask) < 0)
@@ -322,21 +360,14 @@ static void batch_flush_continuation (flux_future_t *f, void *arg)
     flux_future_destroy (f);
 }
 
-/* batch timer - expires 'batch_timeout' seconds after batch was created.
- * Replace ctx->batch with a NULL, and pass 'batch' off to a chain of
- * continuations that commit its data to the KVS, respond to requestors,
- * and announce the new jobids.
+/* Commit batch->txn to the KVS, then respond to requestors and
+ * announce the new jobids.
  */
-static void batch_flush (flux_reactor_t *r, flux_watcher_t *w,
-                         int revents, void *arg)
+static void batch_commit (struct batch *batch)
 {
-    struct job_ingest_ctx *ctx = arg;
-    struct batch *batch;
+    struct job_ingest_ctx *ctx = batch->ctx;
     flux_future_t *f;
 
-    batch = ctx->batch;
-    ctx->batch = NULL;
-
     if (!(f = flux_kvs_commit (ctx->h, NULL, 0, batch->txn))) {
         batch_respond_error (batch, errno, "flux_kvs_commit failed");
         goto error;
@@ -353,6 +384,166 @@ error:
     batch_destroy (batch);
 }
 
+/* Size of 'len' bytes once base64 encoded in a KVS val treeobj.
+ */
+static size_t base64_size (size_t len)
+{
+    return 4 * ((len + 2) / 3);
+}
+
+/* Create a treeobj referencing stored content, or if the content was
+ * too large to store (EFBIG), an inline value that the KVS will store
+ * on commit.  Any other store error is returned to the caller.
+ */
+static json_t *stored_treeobj (flux_future_t *f, const void *data, int len)
+{
+    const char *blobref;
+
+    if (flux_content_store_get (f, &blobref) < 0) {
+        if (errno != EFBIG)
+            return NULL;
+        return treeobj_create_val (data, len);
+    }
+    return treeobj_create_valref (blobref);
+}
+
+/* Build the KVS directory for 'job' from its stored content,
+ * and add it to batch->txn.
+ */
+static int batch_put_jobdir (struct batch *batch,
+                             struct job *job,
+                             flux_future_t *fJ,
+                             flux_future_t *fjobspec)
+{
+    char key[64];
+    json_t *dir;
+    json_t *o;
+    char *s = NULL;
+    int rc = -1;
+
+    if (!(dir = treeobj_create_dir ()))
+        return -1;
+    if (!(o = stored_treeobj (fJ, job->J, strlen (job->J)))
+        || treeobj_insert_entry (dir, "J", o) < 0)
+        goto done;
+    json_decref (o);
+    if (!(o = stored_treeobj (fjobspec, job->jobspec, job->jobspecsz))
+        || treeobj_insert_entry (dir, "jobspec", o) < 0)
+        goto done;
+    json_decref (o);
+    if (!(o = treeobj_create_val (job->eventlog, strlen (job->eventlog)))
+        || treeobj_insert_entry (dir, "eventlog", o) < 0)
+        goto done;
+    if (!(s = treeobj_encode (dir))) {
+        errno = ENOMEM;
+        goto done;
+    }
+    if (make_key (key, sizeof (key), job, NULL) < 0)
+        goto done;
+    if (flux_kvs_txn_put_treeobj (batch->txn, 0, key, s) < 0)
+        goto done;
+    rc = 0;
+done:
+    json_decref (o);
+    json_decref (dir);
+    free (s);
+    return rc;
+}
+
+/* Get result of storing job content (sharded mode).
+ * Add a directory object per job to the batch txn, and commit it.
+ */
+static void batch_store_continuation (flux_future_t *f, void *arg)
+{
+    struct batch *batch = arg;
+    struct job *job;
+    char name[32];
+    int i = 0;
+
+    job = zlist_first (batch->jobs);
+    while (job) {
+        flux_future_t *fJ, *fjobspec;
+
+        snprintf (name, sizeof (name), "%d.J", i);
+        fJ = flux_future_get_child (f, name);
+        snprintf (name, sizeof (name), "%d.jobspec", i);
+        fjobspec = flux_future_get_child (f, name);
+        if (batch_put_jobdir (batch, job, fJ, fjobspec) < 0) {
+            batch_respond_error (batch, errno, "error building job directory");
+            batch_destroy (batch);
+            goto done;
+        }
+        job_clean (job); // batch->txn now holds this info
+        job = zlist_next (batch->jobs);
+        i++;
+    }
+    batch_commit (batch);
+done:
+    flux_future_destroy (f);
+}
+
+/* Store J and jobspec of each job in batch to the content store
+ * (sharded mode).  Continue in batch_store_continuation().
+ */
+static void batch_store (struct batch *batch)
+{
+    flux_t *h = batch->ctx->h;
+    flux_future_t *f;
+    flux_future_t *cf = NULL;
+    struct job *job;
+    char name[32];
+    int i = 0;
+
+    if (!(f = flux_future_wait_all_create ()))
+        goto error;
+    flux_future_set_flux (f, h);
+    job = zlist_first (batch->jobs);
+    while (job) {
+        if (!(cf = flux_content_store (h, job->J, strlen (job->J), 0)))
+            goto error;
+        batch->ctx->stats.bytes_copied += strlen (job->J) + job->jobspecsz;
+        snprintf (name, sizeof (name), "%d.J", i);
+        if (flux_future_push (f, name, cf) < 0)
+            goto error;
+        if (!(cf = flux_content_store (h, job->jobspec, job->jobspecsz, 0)))
+            goto error;
+        snprintf (name, sizeof (name), "%d.jobspec", i);
+        if (flux_future_push (f, name, cf) < 0)
+            goto error;
+        cf = NULL;
+        job = zlist_next (batch->jobs);
+        i++;
+    }
+    if (flux_future_then (f, -1., batch_store_continuation, batch) < 0)
+        goto error;
+    return;
+error:
+    batch_respond_error (batch, errno, "error storing job content");
+    flux_future_destroy (cf);
+    flux_future_destroy (f);
+    batch_destroy (batch);
+}
+
+/* batch timer - expires 'batch_timeout' seconds after batch was created.
+ * Replace ctx->batch with a NULL, and pass 'batch' off to a chain of
+ * continuations that commit its data to the KVS, respond to requestors,
+ * and announce the new jobids.
+ */
+static void batch_flush (flux_reactor_t *r, flux_watcher_t *w,
+                         int revents, void *arg)
+{
+    struct job_ingest_ctx *ctx = arg;
+    struct batch *batch;
+
+    batch = ctx->batch;
+    ctx->batch = NULL;
+
+    if (ctx->sharded)
+        batch_store (batch);
+    else
+        batch_commit (batch);
+}
+
 /* Format key within the KVS directory of 'job'.
  */
 static int make_key (char *buf, int bufsz, struct job *job, const char *name)
@@ -380,15 +571,19 @@ static int batch_add_job (struct batch *batch, struct job *job)
         errno = ENOMEM;
         return -1;
     }
-    if (make_key (key, sizeof (key), job, "J") < 0)
-        goto error;
-    if (flux_kvs_txn_put (batch->txn, 0, key, job->J) < 0)
-        goto error;
-    if (make_key (key, sizeof (key), job, "jobspec") < 0)
-        goto error;
-    if (flux_kvs_txn_put_raw (batch->txn, 0, key,
-                              job->jobspec, job->jobspecsz) < 0)
-        goto error;
+    if (!batch->ctx->sharded) {
+        if (make_key (key, sizeof (key), job, "J") < 0)
+            goto error;
+        if (flux_kvs_txn_put (batch->txn, 0, key, job->J) < 0)
+            goto error;
+        if (make_key (key, sizeof (key), job, "jobspec") < 0)
+            goto error;
+        if (flux_kvs_txn_put_raw (batch->txn, 0, key,
+                                  job->jobspec, job->jobspecsz) < 0)
+            goto error;
+        batch->ctx->stats.bytes_copied += base64_size (strlen (job->J))
+                                          + base64_size (job->jobspecsz);
+    }
     entry = eventlog_entry_pack (0., "submit",
                                  "{ s:i s:i s:i }",
                                  "userid", job->userid,
@@ -398,10 +593,12 @@ static int batch_add_job (struct batch *batch, struct job *job)
         goto error;
     if (!(entrystr = eventlog_entry_encode (entry)))
         goto error;
-    if (make_key (key, sizeof (key), job, "eventlog") < 0)
-        goto error;
-    if (flux_kvs_txn_put (batch->txn, FLUX_KVS_APPEND, key, entrystr) < 0)
-        goto error;
+    if (!batch->ctx->sharded) {
+        if (make_key (key, sizeof (key), job, "eventlog") < 0)
+            goto error;
+        if (flux_kvs_txn_put (batch->txn, FLUX_KVS_APPEND, key, entrystr) < 0)
+            goto error;
+    }
     /* get created timestamp in eventlog entry for job */
     if (eventlog_entry_parse (entry, &t, NULL, NULL) < 0)
         goto error;
@@ -416,9 +613,14 @@ static int batch_add_job (struct batch *batch, struct job *job)
         json_decref (jobentry);
         goto nomem;
     }
-    free (entrystr);
     json_decref (entry);
-    job_clean (job); // batch->txn now holds this info
+    batch->ctx->stats.jobs++;
+    if (batch->ctx->sharded)
+        job->eventlog = entrystr; // added to batch->txn after content store
+    else {
+        free (entrystr);
+        job_clean (job); // batch->txn now holds this info
+    }
     return 0;
 nomem:
     errno = ENOMEM;
@@ -523,9 +725,12 @@ static void submit_cb (flux_t *h, flux_msg_handler_t *mh,
         errmsg = flux_security_last_error (ctx->sec);
         goto error;
     }
-    if (!(job->jobspec = malloc (job->jobspecsz)))
+    /* The security context reuses its buffer, so take one copy here.
+     */
+    if (!(job->jobspec = malloc (job->jobspecsz + 1)))
         goto error;
     memcpy (job->jobspec, jobspec, job->jobspecsz);
+    ctx->stats.bytes_copied += job->jobspecsz;
 #else
     uint32_t userid_signer_u32;
     /* Simplified unwrap only understands mech=none.
@@ -537,9 +742,14 @@ static void submit_cb (flux_t *h, flux_msg_handler_t *mh,
         errmsg = "could not unwrap jobspec";
         goto error;
     }
+    ctx->stats.bytes_copied += job->jobspecsz;
     mech_type = "none";
     userid_signer = userid_signer_u32;
 #endif
+    /* Both unwrap paths leave room for one byte after the jobspec.
+     * Terminate it there for the validator's line protocol.
+     */
+    job->jobspec[job->jobspecsz] = '\n';
     if (userid_signer != job->userid) {
         snprintf (errbuf, sizeof (errbuf),
                   "signer=%lu != requestor=%lu",
@@ -570,11 +780,50 @@ error:
     flux_future_destroy (f);
 }
 
+/* Handle "job-ingest.stats.get" request for debugging.
+ */
+static void stats_cb (flux_t *h, flux_msg_handler_t *mh,
+                      const flux_msg_t *msg, void *arg)
+{
+    struct job_ingest_ctx *ctx = arg;
+    uint64_t validate_copied = validate_bytes_copied (ctx->validate);
+    uint64_t copied = ctx->stats.bytes_copied + validate_copied;
+    double per_job = 0.;
+
+    if (ctx->stats.jobs > 0)
+        per_job = (double)copied / ctx->stats.jobs;
+    if (flux_respond_pack (h, msg, "{s:I s:I s:I s:f}",
+                           "jobs", (json_int_t)ctx->stats.jobs,
+                           "bytes_copied", (json_int_t)copied,
+                           "validate_bytes_copied",
+                           (json_int_t)validate_copied,
+                           "bytes_copied_per_job", per_job) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+}
+
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST,  "job-ingest.submit", submit_cb, FLUX_ROLE_USER },
+    { FLUX_MSGTYPE_REQUEST,  "job-ingest.stats.get", stats_cb, 0 },
     FLUX_MSGHANDLER_TABLE_END,
 };
 
+static int process_args (flux_t *h, int argc, char **argv,
+                         struct job_ingest_ctx *ctx)
+{
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        if (!strcmp (argv[i], "sharded"))
+            ctx->sharded = true;
+        else {
+            flux_log (h, LOG_ERR, "Unknown module option: '%s'", argv[i]);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int mod_main (flux_t *h, int argc, char **argv)
 {
     flux_reactor_t *r = flux_get_reactor (h);
@@ -584,6 +833,8 @@ int mod_main (flux_t *h, int argc, char **argv)
 
     memset (&ctx, 0, sizeof (ctx));
     ctx.h = h;
+    if (process_args (h, argc, argv, &ctx) < 0)
+        goto done;
 #if HAVE_FLUX_SECURITY
     if (!(ctx.sec = flux_security_create (0))) {
         flux_log_error (h, "flux_security_create");
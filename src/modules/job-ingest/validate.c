@@ -31,6 +31,7 @@
 #include "config.h"
 #endif
 #include <unistd.h>
+#include <string.h>
 #include <czmq.h>
 #include <jansson.h>
 #include <flux/core.h>
@@ -58,6 +59,7 @@ const double worker_inactivity_timeout = 5.0;
 struct validate {
     flux_t *h;
     struct worker *worker[MAX_WORKER_COUNT];
+    uint64_t bytes_copied;
 };
 
 void validate_destroy (struct validate *v)
@@ -131,13 +133,14 @@ flux_future_t *validate_jobspec (struct validate *v, const char *buf, int len)
     flux_future_t *f;
     json_t *o;
     json_error_t error;
-    char *s;
+    char *s = NULL;
     int saved_errno;
     struct worker *w;
 
     /* Make sure jobspec decodes as JSON (no YAML allowed here).
      * Capture any JSON parsing errors by returning them in a future.
-     * Then re-encode in compact form to eliminate any white space (esp \n).
+     * Then, only if it contains newlines, which would break the line
+     * oriented worker protocol, re-encode it in compact form.
      */
     if (!(o = json_loadb (buf, len, 0, &error))) {
         char errbuf[256];
@@ -149,12 +152,23 @@ flux_future_t *validate_jobspec (struct validate *v, const char *buf, int len)
         flux_future_fulfill_error (f, EINVAL, errbuf);
         return f;
     }
-    if (!(s = json_dumps (o, JSON_COMPACT)))
-        goto error;
+    if (memchr (buf, '\n', len)) {
+        char *cpy;
+        if (!(s = json_dumps (o, JSON_COMPACT)))
+            goto error;
+        len = strlen (s);
+        if (!(cpy = realloc (s, len + 1)))
+            goto error;
+        s = cpy;
+        s[len] = '\n';
+        buf = s;
+        v->bytes_copied += len;
+    }
     w = select_best_worker (v);
     assert (w != NULL);
-    if (!(f = worker_request (w, s)))
+    if (!(f = worker_request (w, buf, len + 1)))
         goto error;
+    v->bytes_copied += len;
     free (s);
     json_decref (o);
     return f;
@@ -166,6 +180,11 @@ error:
     return NULL;
 }
 
+uint64_t validate_bytes_copied (struct validate *v)
+{
+    return v->bytes_copied;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
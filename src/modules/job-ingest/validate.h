@@ -11,15 +11,22 @@
 #ifndef _JOB_INGEST_VALIDATE_H
 #define _JOB_INGEST_VALIDATE_H
 
+#include <stdint.h>
 #include <flux/core.h>
 
 struct validate *v;
 
-/* Submit jobspec ('buf, 'len') for validation.
+/* Submit jobspec ('buf, 'len') for validation.  buf[len] must be a
+ * newline, which is not part of the jobspec but terminates the request
+ * line sent to a validator worker.
  * Future is fulfilled once validation is complete.
  */
 flux_future_t *validate_jobspec (struct validate *v, const char *buf, int len);
 
+/* Number of jobspec bytes copied by validate_jobspec() so far.
+ */
+uint64_t validate_bytes_copied (struct validate *v);
+
 struct validate *validate_create (flux_t *h);
 
 void validate_destroy (struct validate *v);
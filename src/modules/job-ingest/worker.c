@@ -225,37 +225,29 @@ flux_subprocess_ops_t worker_ops = {
     .on_stderr          = worker_output_cb,
 };
 
-flux_future_t *worker_request (struct worker *w, const char *s)
+flux_future_t *worker_request (struct worker *w, const char *s, int len)
 {
-    int bufsz = strlen (s) + 1;
-    char *buf;
     flux_future_t *f;
-    int saved_errno;
 
-    if (strchr (s, '\n')) {
+    if (len < 1 || s[len - 1] != '\n' || memchr (s, '\n', len - 1)) {
         errno = EINVAL;
         return NULL;
     }
     if (!(f = flux_future_create (NULL, NULL)))
         return NULL;
     flux_future_set_flux (f, w->h);
-    if (!(buf = malloc (bufsz)))
-        goto error;
-    memcpy (buf, s, bufsz - 1);
-    buf[bufsz - 1] = '\n';
     worker_active (w);
-    if (flux_subprocess_write (w->p, "STDIN", buf, bufsz) != bufsz)
+    /* Write the request with its terminating newline in one call, so a
+     * failure cannot leave a partial line in the worker's input.
+     */
+    if (flux_subprocess_write (w->p, "STDIN", s, len) != len)
         goto error;
     if (zlist_append (w->queue, f) < 0)
         goto error;
     flux_future_incref (f); // queue takes a reference on the future
-    free (buf);
     return f;
 error:
-    saved_errno = errno;
-    free (buf);
     flux_future_destroy (f);
-    errno = saved_errno;
     return NULL;
 }
 
@@ -15,7 +15,11 @@
 
 struct worker;
 
-flux_future_t *worker_request (struct worker *w, const char *s);
+/* Send 'len' bytes of 's' to the worker as one request.  The last byte
+ * must be the newline that terminates the request, and there must be
+ * no other newline.
+ */
+flux_future_t *worker_request (struct worker *w, const char *s, int len);
 
 int worker_queue_depth (struct worker *w);
 bool worker_is_running (struct worker *w);
@@ -0,0 +1,630 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* index.c - in-memory job index
+ *
+ * Jobs are owned by a hash keyed by jobid.  Secondary indexes are
+ * maintained as lists holding borrowed references:
+ * - all jobs with known submit info, sorted by t_submit
+ * - per-userid lists of jobs, sorted by t_submit
+ * - per-state lists of jobs, in order of arrival in the state, except
+ *   the inactive list, which is sorted by t_inactive
+ *
+ * Since jobs are normally added in submit order, sorted inserts search
+ * from the tail and are O(1) in the common case.  Each job holds handles
+ * to its list entries so state transitions and purges are also O(1).
+ *
+ * Memory is bounded by purging the jobs that became inactive first
+ * once the inactive count exceeds 'max_inactive'.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/macros.h"
+
+#include "index.h"
+
+#define NUM_STATES 6
+
+struct user_entry {
+    uint32_t userid;
+    zlistx_t *jobs;
+};
+
+struct job_index {
+    int max_inactive;
+    int purged;
+    zhashx_t *jobs;
+    zhashx_t *users;
+    zlistx_t *all;
+    zlistx_t *state[NUM_STATES];
+};
+
+/* Map flux_job_state_t bit to array index.
+ */
+static int state_index (flux_job_state_t state)
+{
+    switch (state) {
+        case FLUX_JOB_NEW:
+            return 0;
+        case FLUX_JOB_DEPEND:
+            return 1;
+        case FLUX_JOB_SCHED:
+            return 2;
+        case FLUX_JOB_RUN:
+            return 3;
+        case FLUX_JOB_CLEANUP:
+            return 4;
+        case FLUX_JOB_INACTIVE:
+            return 5;
+    }
+    return -1;
+}
+
+/* N.B. zhashx_hash_fn signature
+ */
+static size_t job_hasher (const void *key)
+{
+    const flux_jobid_t *id = key;
+    return *id;
+}
+
+/* N.B. zhashx_comparator_fn signature
+ */
+static int job_hash_key_cmp (const void *key1, const void *key2)
+{
+    const flux_jobid_t *id1 = key1;
+    const flux_jobid_t *id2 = key2;
+
+    return NUMCMP (*id1, *id2);
+}
+
+/* N.B. zhashx_hash_fn signature
+ */
+static size_t user_hasher (const void *key)
+{
+    const uint32_t *userid = key;
+    return *userid;
+}
+
+/* N.B. zhashx_comparator_fn signature
+ */
+static int user_hash_key_cmp (const void *key1, const void *key2)
+{
+    const uint32_t *u1 = key1;
+    const uint32_t *u2 = key2;
+
+    return NUMCMP (*u1, *u2);
+}
+
+/* Sort by t_submit, then jobid.
+ * N.B. zlistx_comparator_fn signature
+ */
+static int job_submit_cmp (const void *a1, const void *a2)
+{
+    const struct job_entry *j1 = a1;
+    const struct job_entry *j2 = a2;
+    int rc;
+
+    if ((rc = NUMCMP (j1->t_submit, j2->t_submit)) == 0)
+        rc = NUMCMP (j1->id, j2->id);
+    return rc;
+}
+
+/* Sort by t_inactive, then jobid.
+ * N.B. zlistx_comparator_fn signature
+ */
+static int job_inactive_cmp (const void *a1, const void *a2)
+{
+    const struct job_entry *j1 = a1;
+    const struct job_entry *j2 = a2;
+    int rc;
+
+    if ((rc = NUMCMP (j1->t_inactive, j2->t_inactive)) == 0)
+        rc = NUMCMP (j1->id, j2->id);
+    return rc;
+}
+
+/* N.B. zhashx_destructor_fn signature
+ */
+static void job_destructor (void **item)
+{
+    if (item) {
+        free (*item);
+        *item = NULL;
+    }
+}
+
+/* N.B. zhashx_destructor_fn signature
+ */
+static void user_destructor (void **item)
+{
+    if (item) {
+        struct user_entry *user = *item;
+        if (user) {
+            zlistx_destroy (&user->jobs);
+            free (user);
+        }
+        *item = NULL;
+    }
+}
+
+static struct user_entry *user_get (struct job_index *index,
+                                    uint32_t userid,
+                                    bool create)
+{
+    struct user_entry *user;
+
+    if (!(user = zhashx_lookup (index->users, &userid)) && create) {
+        if (!(user = calloc (1, sizeof (*user))))
+            return NULL;
+        user->userid = userid;
+        if (!(user->jobs = zlistx_new ())) {
+            free (user);
+            errno = ENOMEM;
+            return NULL;
+        }
+        zlistx_set_comparator (user->jobs, job_submit_cmp);
+        if (zhashx_insert (index->users, &user->userid, user) < 0) {
+            zlistx_destroy (&user->jobs);
+            free (user);
+            errno = EEXIST;
+            return NULL;
+        }
+    }
+    return user;
+}
+
+/* Remove job from sorted (all, per-user) lists.
+ */
+static void unlink_submit (struct job_index *index, struct job_entry *job)
+{
+    if (job->all_handle) {
+        zlistx_delete (index->all, job->all_handle);
+        job->all_handle = NULL;
+    }
+    if (job->user_handle) {
+        struct user_entry *user = user_get (index, job->userid, false);
+        if (user) {
+            zlistx_delete (user->jobs, job->user_handle);
+            if (zlistx_size (user->jobs) == 0)
+                zhashx_delete (index->users, &job->userid);
+        }
+        job->user_handle = NULL;
+    }
+}
+
+static void job_remove (struct job_index *index, struct job_entry *job)
+{
+    int i = state_index (job->state);
+
+    unlink_submit (index, job);
+    if (job->state_handle) {
+        zlistx_delete (index->state[i], job->state_handle);
+        job->state_handle = NULL;
+    }
+    zhashx_delete (index->jobs, &job->id); // calls job_destructor ()
+}
+
+/* Add job to the list for its current state.  Inactive jobs normally
+ * arrive in t_inactive order, so the sorted insert searches from the tail.
+ */
+static void *state_list_add (struct job_index *index, struct job_entry *job)
+{
+    int i = state_index (job->state);
+
+    if (job->state == FLUX_JOB_INACTIVE)
+        return zlistx_insert (index->state[i], job, false);
+    return zlistx_add_end (index->state[i], job);
+}
+
+/* Purge jobs that became inactive first until max_inactive is satisfied,
+ * sparing 'keep' if non-NULL.
+ */
+static void purge_inactive (struct job_index *index, struct job_entry *keep)
+{
+    int i = state_index (FLUX_JOB_INACTIVE);
+
+    if (index->max_inactive == 0)
+        return;
+    while (zlistx_size (index->state[i]) > index->max_inactive) {
+        struct job_entry *job = zlistx_first (index->state[i]);
+        if (job == keep)
+            job = zlistx_next (index->state[i]);
+        job_remove (index, job);
+        index->purged++;
+    }
+}
+
+struct job_entry *job_index_lookup (struct job_index *index, flux_jobid_t id)
+{
+    struct job_entry *job;
+
+    if (!(job = zhashx_lookup (index->jobs, &id))) {
+        errno = ENOENT;
+        return NULL;
+    }
+    return job;
+}
+
+struct job_entry *job_index_add (struct job_index *index,
+                                 flux_jobid_t id,
+                                 flux_job_state_t state,
+                                 double timestamp)
+{
+    struct job_entry *job;
+
+    if (state_index (state) < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (zhashx_lookup (index->jobs, &id)) {
+        errno = EEXIST;
+        return NULL;
+    }
+    if (!(job = calloc (1, sizeof (*job))))
+        return NULL;
+    job->id = id;
+    job->state = state;
+    job->userid = FLUX_USERID_UNKNOWN;
+    if (state == FLUX_JOB_INACTIVE)
+        job->t_inactive = timestamp;
+    if (zhashx_insert (index->jobs, &job->id, job) < 0) {
+        free (job);
+        errno = EEXIST;
+        return NULL;
+    }
+    if (!(job->state_handle = state_list_add (index, job))) {
+        zhashx_delete (index->jobs, &id);
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (state == FLUX_JOB_INACTIVE)
+        purge_inactive (index, job);
+    return job;
+}
+
+int job_index_set_submit (struct job_index *index,
+                          struct job_entry *job,
+                          uint32_t userid,
+                          int priority,
+                          double t_submit)
+{
+    struct user_entry *user;
+
+    if (job->complete)
+        unlink_submit (index, job);
+    job->userid = userid;
+    job->priority = priority;
+    job->t_submit = t_submit;
+    job->complete = true;
+    if (!(user = user_get (index, userid, true)))
+        goto error;
+    if (!(job->all_handle = zlistx_insert (index->all, job, false)))
+        goto nomem;
+    if (!(job->user_handle = zlistx_insert (user->jobs, job, false)))
+        goto nomem;
+    return 0;
+nomem:
+    errno = ENOMEM;
+error:
+    unlink_submit (index, job);
+    job->complete = false;
+    return -1;
+}
+
+int job_index_set_state (struct job_index *index,
+                         struct job_entry *job,
+                         flux_job_state_t state,
+                         double timestamp)
+{
+    int i_old = state_index (job->state);
+    int i_new = state_index (state);
+
+    if (i_new < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (i_new == i_old)
+        return 0;
+    zlistx_delete (index->state[i_old], job->state_handle);
+    job->state = state;
+    if (state == FLUX_JOB_INACTIVE)
+        job->t_inactive = timestamp;
+    if (!(job->state_handle = state_list_add (index, job))) {
+        job_remove (index, job);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (state == FLUX_JOB_INACTIVE)
+        purge_inactive (index, NULL);
+    return 0;
+}
+
+int job_index_count (struct job_index *index, flux_job_state_t state)
+{
+    int i;
+
+    if (state == 0)
+        return zhashx_size (index->jobs);
+    if ((i = state_index (state)) < 0)
+        return 0;
+    return zlistx_size (index->state[i]);
+}
+
+int job_index_purged (struct job_index *index)
+{
+    return index->purged;
+}
+
+static json_t *job_entry_tojson (struct job_entry *job)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{s:I s:i s:i s:f s:i s:f}",
+                         "id", job->id,
+                         "userid", job->userid,
+                         "priority", job->priority,
+                         "t_submit", job->t_submit,
+                         "state", job->state,
+                         "t_inactive", job->t_inactive))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return o;
+}
+
+static int append_job (json_t *jobs, struct job_entry *job)
+{
+    json_t *o;
+
+    if (!(o = job_entry_tojson (job)))
+        return -1;
+    if (json_array_append_new (jobs, o) < 0) {
+        json_decref (o);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+/* N.B. qsort comparator, most recently submitted first.
+ */
+static int job_ptr_cmp_desc (const void *a1, const void *a2)
+{
+    struct job_entry *const *j1 = a1;
+    struct job_entry *const *j2 = a2;
+    return job_submit_cmp (*j2, *j1);
+}
+
+/* Answer a query filtered only by state from the per-state lists,
+ * which are in order of arrival in the state, so the matches are
+ * gathered and then sorted by submit time.
+ */
+static json_t *query_states (struct job_index *index,
+                             const struct job_query *query)
+{
+    struct job_entry **match;
+    struct job_entry *job;
+    size_t count = 0;
+    size_t n = 0;
+    size_t i;
+    json_t *jobs;
+    int s;
+
+    for (s = 0; s < NUM_STATES; s++) {
+        if ((query->states & (1 << s)))
+            count += zlistx_size (index->state[s]);
+    }
+    if (!(jobs = json_array ()))
+        goto nomem;
+    if (count == 0)
+        return jobs;
+    if (!(match = calloc (count, sizeof (match[0]))))
+        goto nomem;
+    for (s = 0; s < NUM_STATES; s++) {
+        if (!(query->states & (1 << s)))
+            continue;
+        job = zlistx_first (index->state[s]);
+        while (job) {
+            if (job->complete && job->t_submit >= query->since)
+                match[n++] = job;
+            job = zlistx_next (index->state[s]);
+        }
+    }
+    qsort (match, n, sizeof (match[0]), job_ptr_cmp_desc);
+    for (i = 0; i < n; i++) {
+        if (append_job (jobs, match[i]) < 0) {
+            free (match);
+            json_decref (jobs);
+            return NULL;
+        }
+        if (json_array_size (jobs) == query->max_entries)
+            break;
+    }
+    free (match);
+    return jobs;
+nomem:
+    json_decref (jobs);
+    errno = ENOMEM;
+    return NULL;
+}
+
+json_t *job_index_query (struct job_index *index,
+                         const struct job_query *query)
+{
+    zlistx_t *l = index->all;
+    struct job_entry *job;
+    json_t *jobs;
+
+    if (query->max_entries < 0) {
+        errno = EPROTO;
+        return NULL;
+    }
+    if (query->states != 0 && query->userid == FLUX_USERID_UNKNOWN)
+        return query_states (index, query);
+    if (!(jobs = json_array ())) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (query->userid != FLUX_USERID_UNKNOWN) {
+        struct user_entry *user = user_get (index, query->userid, false);
+        if (!user)
+            return jobs;
+        l = user->jobs;
+    }
+    job = zlistx_last (l);
+    while (job && job->t_submit >= query->since) {
+        if (query->states == 0 || (query->states & job->state)) {
+            if (append_job (jobs, job) < 0)
+                goto error;
+            if (json_array_size (jobs) == query->max_entries)
+                break;
+        }
+        job = zlistx_prev (l);
+    }
+    return jobs;
+error:
+    json_decref (jobs);
+    return NULL;
+}
+
+json_t *job_index_encode (struct job_index *index)
+{
+    struct job_entry *job;
+    json_t *a;
+
+    if (!(a = json_array ()))
+        goto nomem;
+    job = zlistx_first (index->all);
+    while (job) {
+        json_t *o;
+        if (!(o = json_pack ("[I,i,i,f,i,f]", job->id,
+                                              job->userid,
+                                              job->priority,
+                                              job->t_submit,
+                                              job->state,
+                                              job->t_inactive)))
+            goto nomem;
+        if (json_array_append_new (a, o) < 0) {
+            json_decref (o);
+            goto nomem;
+        }
+        job = zlistx_next (index->all);
+    }
+    return a;
+nomem:
+    json_decref (a);
+    errno = ENOMEM;
+    return NULL;
+}
+
+int job_index_decode (struct job_index *index, json_t *o)
+{
+    size_t i;
+    json_t *entry;
+
+    if (!json_is_array (o)) {
+        errno = EPROTO;
+        return -1;
+    }
+    json_array_foreach (o, i, entry) {
+        flux_jobid_t id;
+        int userid;
+        int priority;
+        double t_submit;
+        int state;
+        double t_inactive;
+        struct job_entry *job;
+
+        if (json_unpack (entry, "[I,i,i,F,i,F]", &id,
+                                                 &userid,
+                                                 &priority,
+                                                 &t_submit,
+                                                 &state,
+                                                 &t_inactive) < 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (!(job = job_index_add (index, id, FLUX_JOB_NEW, 0.)))
+            return -1;
+        if (job_index_set_submit (index, job, userid, priority, t_submit) < 0)
+            return -1;
+        if (job_index_set_state (index, job, state, t_inactive) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+void job_index_destroy (struct job_index *index)
+{
+    if (index) {
+        int saved_errno = errno;
+        int i;
+        zlistx_destroy (&index->all);
+        for (i = 0; i < NUM_STATES; i++)
+            zlistx_destroy (&index->state[i]);
+        zhashx_destroy (&index->users);
+        zhashx_destroy (&index->jobs);
+        free (index);
+        errno = saved_errno;
+    }
+}
+
+struct job_index *job_index_create (int max_inactive)
+{
+    struct job_index *index;
+    int i;
+
+    if (max_inactive < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(index = calloc (1, sizeof (*index))))
+        return NULL;
+    index->max_inactive = max_inactive;
+    if (!(index->jobs = zhashx_new ()))
+        goto nomem;
+    zhashx_set_key_hasher (index->jobs, job_hasher);
+    zhashx_set_key_comparator (index->jobs, job_hash_key_cmp);
+    zhashx_set_key_duplicator (index->jobs, NULL);
+    zhashx_set_key_destructor (index->jobs, NULL);
+    zhashx_set_destructor (index->jobs, job_destructor);
+    if (!(index->users = zhashx_new ()))
+        goto nomem;
+    zhashx_set_key_hasher (index->users, user_hasher);
+    zhashx_set_key_comparator (index->users, user_hash_key_cmp);
+    zhashx_set_key_duplicator (index->users, NULL);
+    zhashx_set_key_destructor (index->users, NULL);
+    zhashx_set_destructor (index->users, user_destructor);
+    if (!(index->all = zlistx_new ()))
+        goto nomem;
+    zlistx_set_comparator (index->all, job_submit_cmp);
+    for (i = 0; i < NUM_STATES; i++) {
+        if (!(index->state[i] = zlistx_new ()))
+            goto nomem;
+    }
+    zlistx_set_comparator (index->state[state_index (FLUX_JOB_INACTIVE)],
+                           job_inactive_cmp);
+    return index;
+nomem:
+    job_index_destroy (index);
+    errno = ENOMEM;
+    return NULL;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,106 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_JOB_LIST_INDEX_H
+#define _FLUX_JOB_LIST_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+struct job_entry {
+    flux_jobid_t id;
+    uint32_t userid;
+    int priority;
+    double t_submit;
+    double t_inactive;
+    flux_job_state_t state;
+    bool complete;          // userid, priority, t_submit are valid
+
+    void *all_handle;       // private to index.c
+    void *state_handle;
+    void *user_handle;
+};
+
+struct job_query {
+    int max_entries;        // 0 = unlimited
+    int states;             // mask of flux_job_state_t, 0 = any
+    uint32_t userid;        // FLUX_USERID_UNKNOWN = any
+    double since;           // only jobs with t_submit >= since
+};
+
+/* Create an index that retains at most 'max_inactive' inactive jobs
+ * (0 = unlimited).  Jobs with the oldest t_inactive are purged first.
+ */
+struct job_index *job_index_create (int max_inactive);
+void job_index_destroy (struct job_index *index);
+
+/* Add a job in 'state' with unknown submit info.  If the job is inactive,
+ * 'timestamp' is recorded as t_inactive and other inactive jobs may be
+ * purged.  Returns entry on success, NULL on failure with errno set
+ * (EEXIST, ENOMEM).
+ */
+struct job_entry *job_index_add (struct job_index *index,
+                                 flux_jobid_t id,
+                                 flux_job_state_t state,
+                                 double timestamp);
+
+/* Find a job by id.
+ * Returns entry on success, NULL on failure with errno set (ENOENT).
+ */
+struct job_entry *job_index_lookup (struct job_index *index, flux_jobid_t id);
+
+/* Record submit info for job.  The job becomes visible to queries.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int job_index_set_submit (struct job_index *index,
+                          struct job_entry *job,
+                          uint32_t userid,
+                          int priority,
+                          double t_submit);
+
+/* Move job to 'state'.  If the job becomes inactive, 'timestamp' is
+ * recorded as t_inactive and the oldest inactive jobs may be purged,
+ * possibly including 'job' itself, so the caller must not reference
+ * 'job' after this call.  Returns 0 on success, -1 on failure with errno set.
+ */
+int job_index_set_state (struct job_index *index,
+                         struct job_entry *job,
+                         flux_job_state_t state,
+                         double timestamp);
+
+/* Number of jobs in 'state', or all jobs if state=0.
+ */
+int job_index_count (struct job_index *index, flux_job_state_t state);
+
+/* Number of jobs purged since the index was created.
+ */
+int job_index_purged (struct job_index *index);
+
+/* Return an array of job objects matching 'query', most recently
+ * submitted first.  Jobs with unknown submit info are not included.
+ * Returns array on success, NULL on failure with errno set.
+ */
+json_t *job_index_query (struct job_index *index,
+                         const struct job_query *query);
+
+/* Encode/decode the index as a compact JSON array of arrays,
+ * one per job, for persisting across module reloads.  Decoded inactive
+ * jobs are ordered (and purged) by t_inactive, not by array order.
+ */
+json_t *job_index_encode (struct job_index *index);
+int job_index_decode (struct job_index *index, json_t *o);
+
+#endif /* !_FLUX_JOB_LIST_INDEX_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,469 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* job-list - index of active and inactive jobs
+ *
+ * The job-manager only keeps active jobs, so listing inactive jobs
+ * otherwise requires walking the KVS.  This module subscribes to the
+ * job-manager's batched "job-state" events and maintains an in-memory
+ * index of jobs by state, userid, and submit time (see index.c).
+ *
+ * The first time a job is seen, its submit info (userid, priority,
+ * t_submit) is fetched once from the "submit" event at the head of
+ * its eventlog.  Subsequent transitions are taken from events only.
+ *
+ * If the broker has a persist-directory, the index is saved there on
+ * module unload and restored on load.  The eventlogs of restored jobs
+ * that were not inactive are read again, so jobs that became inactive
+ * while the module was not loaded are updated.  Other state changes
+ * are picked up when the job's next event arrives.
+ *
+ * Module options:
+ *   max-inactive=N    retain at most N inactive jobs (default 10000)
+ *
+ * Requests:
+ *   job-list.list {?max_entries, ?states, ?userid, ?since}
+ *     returns {"jobs":[...]}, most recently submitted first
+ *   job-list.stats.get
+ *     returns {"jobs":i, "inactive":i, "purged":i, "lookups":i}
+ *
+ * Guest users may only list their own jobs.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <unistd.h>
+#include <czmq.h>
+#include <jansson.h>
+#include <flux/core.h>
+
+#include "src/common/libeventlog/eventlog.h"
+
+#include "index.h"
+
+struct list_ctx {
+    flux_t *h;
+    flux_msg_handler_t **handlers;
+    struct job_index *index;
+    zlist_t *lookups;
+    char *snapshot_path;
+};
+
+static const int default_max_inactive = 10000;
+
+/* Parse submit info from the first eventlog entry.
+ */
+static int eventlog_get_submit (const char *s, uint32_t *userid,
+                                int *priority, double *t_submit)
+{
+    json_t *a;
+    json_t *entry;
+    const char *name;
+    json_t *context;
+    int rc = -1;
+
+    if (!(a = eventlog_decode (s)))
+        return -1;
+    if (!(entry = json_array_get (a, 0))
+            || eventlog_entry_parse (entry, t_submit, &name, &context) < 0
+            || strcmp (name, "submit") != 0
+            || !context
+            || json_unpack (context, "{s:i s:i}",
+                                     "userid", userid,
+                                     "priority", priority) < 0) {
+        errno = EPROTO;
+        goto done;
+    }
+    rc = 0;
+done:
+    json_decref (a);
+    return rc;
+}
+
+/* If the job has been cleaned up, i.e. the last eventlog entry is
+ * "clean", set 't_clean' to its timestamp and return true.
+ */
+static bool eventlog_get_clean (const char *s, double *t_clean)
+{
+    json_t *a;
+    json_t *entry;
+    const char *name;
+    bool clean = false;
+
+    if (!(a = eventlog_decode (s)))
+        return false;
+    if ((entry = json_array_get (a, json_array_size (a) - 1))
+            && eventlog_entry_parse (entry, t_clean, &name, NULL) == 0
+            && !strcmp (name, "clean"))
+        clean = true;
+    json_decref (a);
+    return clean;
+}
+
+static void submit_lookup_continuation (flux_future_t *f, void *arg)
+{
+    struct list_ctx *ctx = arg;
+    flux_jobid_t *id = flux_future_aux_get (f, "id");
+    struct job_entry *job;
+    const char *s;
+    uint32_t userid;
+    int priority;
+    double t_submit;
+    double t_clean;
+
+    if (flux_kvs_lookup_get (f, &s) < 0
+            || eventlog_get_submit (s, &userid, &priority, &t_submit) < 0) {
+        flux_log_error (ctx->h, "%s: job %llu eventlog", __FUNCTION__,
+                        (unsigned long long)*id);
+        goto done;
+    }
+    if (!(job = job_index_lookup (ctx->index, *id)))
+        goto done; // purged while lookup was in progress
+    if (job_index_set_submit (ctx->index, job, userid, priority, t_submit) < 0)
+        flux_log_error (ctx->h, "%s: job_index_set_submit", __FUNCTION__);
+    else if (eventlog_get_clean (s, &t_clean)
+            && job_index_set_state (ctx->index,
+                                    job,
+                                    FLUX_JOB_INACTIVE,
+                                    t_clean) < 0)
+        flux_log_error (ctx->h, "%s: job_index_set_state", __FUNCTION__);
+done:
+    zlist_remove (ctx->lookups, f);
+    flux_future_destroy (f);
+}
+
+static int submit_lookup (struct list_ctx *ctx, flux_jobid_t id)
+{
+    flux_future_t *f = NULL;
+    flux_jobid_t *cpy = NULL;
+    char key[64];
+
+    if (flux_job_kvs_key (key, sizeof (key), id, "eventlog") < 0)
+        return -1;
+    if (!(f = flux_kvs_lookup (ctx->h, NULL, 0, key)))
+        return -1;
+    if (!(cpy = malloc (sizeof (*cpy))))
+        goto error;
+    *cpy = id;
+    if (flux_future_aux_set (f, "id", cpy, free) < 0) {
+        free (cpy);
+        goto error;
+    }
+    if (flux_future_then (f, -1., submit_lookup_continuation, ctx) < 0)
+        goto error;
+    if (zlist_append (ctx->lookups, f) < 0) {
+        errno = ENOMEM;
+        goto error;
+    }
+    return 0;
+error:
+    flux_future_destroy (f);
+    return -1;
+}
+
+static void job_state_cb (flux_t *h, flux_msg_handler_t *mh,
+                          const flux_msg_t *msg, void *arg)
+{
+    struct list_ctx *ctx = arg;
+    double now = flux_reactor_now (flux_get_reactor (h));
+    json_t *transitions;
+    size_t index;
+    json_t *entry;
+
+    if (flux_event_unpack (msg, NULL, "{s:o}",
+                                      "transitions", &transitions) < 0
+            || !json_is_array (transitions)) {
+        flux_log (h, LOG_ERR, "%s: malformed event", __FUNCTION__);
+        return;
+    }
+    json_array_foreach (transitions, index, entry) {
+        flux_jobid_t id;
+        const char *s;
+        flux_job_state_t state;
+        struct job_entry *job;
+
+        if (json_unpack (entry, "[I,s]", &id, &s) < 0
+                || flux_job_strtostate (s, &state) < 0) {
+            flux_log (h, LOG_ERR, "%s: malformed transition", __FUNCTION__);
+            continue;
+        }
+        if (!(job = job_index_lookup (ctx->index, id))) {
+            if (!(job = job_index_add (ctx->index, id, state, now))) {
+                flux_log_error (h, "%s: job_index_add", __FUNCTION__);
+                continue;
+            }
+            if (submit_lookup (ctx, id) < 0)
+                flux_log_error (h, "%s: submit_lookup", __FUNCTION__);
+        }
+        else if (job_index_set_state (ctx->index, job, state, now) < 0)
+            flux_log_error (h, "%s: job_index_set_state", __FUNCTION__);
+    }
+}
+
+static void list_cb (flux_t *h, flux_msg_handler_t *mh,
+                     const flux_msg_t *msg, void *arg)
+{
+    struct list_ctx *ctx = arg;
+    struct job_query query = {
+        .max_entries = 0,
+        .states = 0,
+        .userid = FLUX_USERID_UNKNOWN,
+        .since = 0.,
+    };
+    int userid = FLUX_USERID_UNKNOWN;
+    uint32_t rolemask;
+    uint32_t cred_userid;
+    json_t *jobs;
+
+    if (flux_request_unpack (msg, NULL, "{s?:i s?:i s?:i s?:F}",
+                                        "max_entries", &query.max_entries,
+                                        "states", &query.states,
+                                        "userid", &userid,
+                                        "since", &query.since) < 0)
+        goto error;
+    query.userid = userid;
+    if (flux_msg_get_rolemask (msg, &rolemask) < 0
+            || flux_msg_get_userid (msg, &cred_userid) < 0)
+        goto error;
+    if (!(rolemask & FLUX_ROLE_OWNER)) {
+        if (query.userid == FLUX_USERID_UNKNOWN)
+            query.userid = cred_userid;
+        else if (query.userid != cred_userid) {
+            errno = EPERM;
+            goto error;
+        }
+    }
+    if (!(jobs = job_index_query (ctx->index, &query)))
+        goto error;
+    if (flux_respond_pack (h, msg, "{s:o}", "jobs", jobs) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    return;
+error:
+    if (flux_respond_error (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+}
+
+static void stats_cb (flux_t *h, flux_msg_handler_t *mh,
+                      const flux_msg_t *msg, void *arg)
+{
+    struct list_ctx *ctx = arg;
+
+    if (flux_respond_pack (h, msg, "{s:i s:i s:i s:i}",
+                           "jobs", job_index_count (ctx->index, 0),
+                           "inactive", job_index_count (ctx->index,
+                                                        FLUX_JOB_INACTIVE),
+                           "purged", job_index_purged (ctx->index),
+                           "lookups", zlist_size (ctx->lookups)) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+}
+
+static const struct flux_msg_handler_spec htab[] = {
+    { .typemask     = FLUX_MSGTYPE_EVENT,
+      .topic_glob   = "job-state",
+      .cb           = job_state_cb,
+      .rolemask     = 0
+    },
+    { .typemask     = FLUX_MSGTYPE_REQUEST,
+      .topic_glob   = "job-list.list",
+      .cb           = list_cb,
+      .rolemask     = FLUX_ROLE_USER
+    },
+    { .typemask     = FLUX_MSGTYPE_REQUEST,
+      .topic_glob   = "job-list.stats.get",
+      .cb           = stats_cb,
+      .rolemask     = 0
+    },
+    FLUX_MSGHANDLER_TABLE_END,
+};
+
+static int snapshot_load (struct list_ctx *ctx)
+{
+    json_t *o;
+    json_error_t error;
+    int rc;
+
+    if (!ctx->snapshot_path || access (ctx->snapshot_path, R_OK) < 0)
+        return 0;
+    if (!(o = json_load_file (ctx->snapshot_path, 0, &error))) {
+        flux_log (ctx->h, LOG_ERR, "%s: %s", ctx->snapshot_path, error.text);
+        errno = EPROTO;
+        return -1;
+    }
+    rc = job_index_decode (ctx->index, o);
+    json_decref (o);
+    if (rc == 0)
+        flux_log (ctx->h, LOG_DEBUG, "restored %d jobs from %s",
+                  job_index_count (ctx->index, 0), ctx->snapshot_path);
+    return rc;
+}
+
+/* Read the eventlogs of restored jobs that are not inactive, since
+ * their job-state events may have been missed while unloaded.
+ */
+static int snapshot_refresh (struct list_ctx *ctx)
+{
+    struct job_query query = {
+        .max_entries = 0,
+        .states = FLUX_JOB_NEW | FLUX_JOB_DEPEND | FLUX_JOB_SCHED
+                | FLUX_JOB_RUN | FLUX_JOB_CLEANUP,
+        .userid = FLUX_USERID_UNKNOWN,
+        .since = 0.,
+    };
+    json_t *jobs;
+    size_t index;
+    json_t *entry;
+    int rc = -1;
+
+    if (!(jobs = job_index_query (ctx->index, &query)))
+        return -1;
+    json_array_foreach (jobs, index, entry) {
+        flux_jobid_t id;
+
+        if (json_unpack (entry, "{s:I}", "id", &id) < 0) {
+            errno = EPROTO;
+            goto done;
+        }
+        if (submit_lookup (ctx, id) < 0)
+            goto done;
+    }
+    rc = 0;
+done:
+    json_decref (jobs);
+    return rc;
+}
+
+static int snapshot_save (struct list_ctx *ctx)
+{
+    json_t *o;
+    int rc;
+
+    if (!ctx->snapshot_path)
+        return 0;
+    if (!(o = job_index_encode (ctx->index)))
+        return -1;
+    rc = json_dump_file (o, ctx->snapshot_path, JSON_COMPACT);
+    json_decref (o);
+    if (rc < 0) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+static int process_args (flux_t *h, int argc, char **argv, int *max_inactive)
+{
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        if (strncmp ("max-inactive=", argv[i], 13) == 0) {
+            char *endptr;
+            errno = 0;
+            *max_inactive = strtol (argv[i] + 13, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || *max_inactive < 0) {
+                flux_log (h, LOG_ERR, "Invalid module option: '%s'", argv[i]);
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        else {
+            flux_log (h, LOG_ERR, "Unknown module option: '%s'", argv[i]);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void list_ctx_destroy (struct list_ctx *ctx)
+{
+    if (ctx) {
+        int saved_errno = errno;
+        flux_msg_handler_delvec (ctx->handlers);
+        if (ctx->lookups) {
+            flux_future_t *f;
+            while ((f = zlist_pop (ctx->lookups)))
+                flux_future_destroy (f);
+            zlist_destroy (&ctx->lookups);
+        }
+        job_index_destroy (ctx->index);
+        free (ctx->snapshot_path);
+        free (ctx);
+        errno = saved_errno;
+    }
+}
+
+static struct list_ctx *list_ctx_create (flux_t *h, int argc, char **argv)
+{
+    struct list_ctx *ctx;
+    int max_inactive = default_max_inactive;
+    const char *dir;
+
+    if (!(ctx = calloc (1, sizeof (*ctx))))
+        return NULL;
+    ctx->h = h;
+    if (process_args (h, argc, argv, &max_inactive) < 0)
+        goto error;
+    if (!(ctx->index = job_index_create (max_inactive)))
+        goto error;
+    if (!(ctx->lookups = zlist_new ())) {
+        errno = ENOMEM;
+        goto error;
+    }
+    if ((dir = flux_attr_get (h, "persist-directory"))) {
+        if (asprintf (&ctx->snapshot_path, "%s/job-list.json", dir) < 0)
+            goto error;
+    }
+    if (flux_msg_handler_addvec (h, htab, ctx, &ctx->handlers) < 0)
+        goto error;
+    return ctx;
+error:
+    list_ctx_destroy (ctx);
+    return NULL;
+}
+
+int mod_main (flux_t *h, int argc, char **argv)
+{
+    struct list_ctx *ctx;
+    int rc = -1;
+
+    if (!(ctx = list_ctx_create (h, argc, argv))) {
+        flux_log_error (h, "initialization error");
+        goto done;
+    }
+    if (snapshot_load (ctx) < 0) {
+        flux_log_error (h, "error loading snapshot");
+        goto done;
+    }
+    if (flux_event_subscribe (h, "job-state") < 0) {
+        flux_log_error (h, "flux_event_subscribe");
+        goto done;
+    }
+    if (snapshot_refresh (ctx) < 0) {
+        flux_log_error (h, "error refreshing restored jobs");
+        goto done;
+    }
+    if (flux_reactor_run (flux_get_reactor (h), 0) < 0) {
+        flux_log_error (h, "flux_reactor_run");
+        goto done;
+    }
+    if (snapshot_save (ctx) < 0)
+        flux_log_error (h, "error saving snapshot");
+    rc = 0;
+done:
+    list_ctx_destroy (ctx);
+    return rc;
+}
+
+MOD_NAME ("job-list");
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,277 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <jansson.h>
+
+#include "src/common/libtap/tap.h"
+
+#include "src/modules/job-list/index.h"
+
+/* Add job 'id' submitted by 'userid' at time 'id', and move it to 'state'.
+ */
+struct job_entry *add_test_job (struct job_index *index, flux_jobid_t id,
+                                uint32_t userid, flux_job_state_t state)
+{
+    struct job_entry *job;
+
+    if (!(job = job_index_add (index, id, FLUX_JOB_DEPEND, 0.)))
+        BAIL_OUT ("job_index_add failed");
+    if (job_index_set_submit (index, job, userid, 16, (double)id) < 0)
+        BAIL_OUT ("job_index_set_submit failed");
+    if (job_index_set_state (index, job, state, (double)id + 100.) < 0)
+        BAIL_OUT ("job_index_set_state failed");
+    return job;
+}
+
+/* Check that 'jobs' array contains ids first, first-step, ...
+ */
+bool check_ids (json_t *jobs, int first, int step)
+{
+    size_t index;
+    json_t *el;
+    flux_jobid_t id;
+
+    json_array_foreach (jobs, index, el) {
+        if (json_unpack (el, "{s:I}", "id", &id) < 0)
+            return false;
+        if (id != first - index * step) {
+            diag ("jobs[%d] id=%d", (int)index, (int)id);
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_basic (void)
+{
+    struct job_index *index;
+    struct job_entry *job;
+    struct job_query query = { .userid = FLUX_USERID_UNKNOWN };
+    json_t *jobs;
+    int i;
+
+    ok ((index = job_index_create (0)) != NULL,
+        "job_index_create max_inactive=0 works");
+    errno = 0;
+    ok (job_index_create (-1) == NULL && errno == EINVAL,
+        "job_index_create max_inactive=-1 fails with EINVAL");
+
+    for (i = 1; i <= 10; i++)
+        add_test_job (index, i, i % 2,
+                      i <= 5 ? FLUX_JOB_INACTIVE : FLUX_JOB_SCHED);
+    ok (job_index_count (index, 0) == 10,
+        "job_index_count state=0 returns 10");
+    ok (job_index_count (index, FLUX_JOB_INACTIVE) == 5,
+        "job_index_count state=INACTIVE returns 5");
+    ok (job_index_count (index, FLUX_JOB_SCHED) == 5,
+        "job_index_count state=SCHED returns 5");
+    ok (job_index_count (index, FLUX_JOB_RUN) == 0,
+        "job_index_count state=RUN returns 0");
+
+    errno = 0;
+    ok (job_index_add (index, 1, FLUX_JOB_DEPEND, 0.) == NULL && errno == EEXIST,
+        "job_index_add existing id fails with EEXIST");
+    errno = 0;
+    ok (job_index_add (index, 42, 3, 0.) == NULL && errno == EINVAL,
+        "job_index_add invalid state fails with EINVAL");
+
+    job = job_index_lookup (index, 5);
+    ok (job != NULL && job->id == 5 && job->state == FLUX_JOB_INACTIVE
+        && job->t_inactive == 105.,
+        "job_index_lookup id=5 works");
+    errno = 0;
+    ok (job_index_lookup (index, 42) == NULL && errno == ENOENT,
+        "job_index_lookup unknown id fails with ENOENT");
+
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 10 && check_ids (jobs, 10, 1),
+        "job_index_query returns all jobs, newest first");
+    json_decref (jobs);
+
+    query.max_entries = 3;
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 3 && check_ids (jobs, 10, 1),
+        "job_index_query max_entries=3 returns 3 newest jobs");
+    json_decref (jobs);
+
+    query.max_entries = 0;
+    query.states = FLUX_JOB_INACTIVE;
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 5 && check_ids (jobs, 5, 1),
+        "job_index_query states=INACTIVE works");
+    json_decref (jobs);
+
+    /* per-state lists are in order of arrival, results are by submit time */
+    if (job_index_set_state (index, job_index_lookup (index, 8),
+                             FLUX_JOB_RUN, 0.) < 0
+        || job_index_set_state (index, job_index_lookup (index, 6),
+                                FLUX_JOB_RUN, 0.) < 0)
+        BAIL_OUT ("job_index_set_state failed");
+    query.states = FLUX_JOB_RUN | FLUX_JOB_INACTIVE;
+    query.max_entries = 2;
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 2 && check_ids (jobs, 8, 2),
+        "job_index_query states=RUN|INACTIVE returns newest first");
+    json_decref (jobs);
+    query.max_entries = 0;
+    query.states = FLUX_JOB_SCHED;
+    query.since = 8.;
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 2 && check_ids (jobs, 10, 1),
+        "job_index_query states=SCHED since=8 works");
+    json_decref (jobs);
+    query.since = 0.;
+
+    query.states = 0;
+    query.userid = 0;
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 5 && check_ids (jobs, 10, 2),
+        "job_index_query userid=0 works");
+    json_decref (jobs);
+
+    query.userid = 42;
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 0,
+        "job_index_query unknown userid returns no jobs");
+    json_decref (jobs);
+
+    query.userid = FLUX_USERID_UNKNOWN;
+    query.since = 8.;
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 3 && check_ids (jobs, 10, 1),
+        "job_index_query since=8 works");
+    json_decref (jobs);
+
+    /* job with unknown submit info is not listed */
+    query.since = 0.;
+    if (!(job = job_index_add (index, 11, FLUX_JOB_DEPEND, 0.)))
+        BAIL_OUT ("job_index_add failed");
+    jobs = job_index_query (index, &query);
+    ok (jobs != NULL && json_array_size (jobs) == 10,
+        "job_index_query omits job with unknown submit info");
+    json_decref (jobs);
+
+    job_index_destroy (index);
+}
+
+void test_purge (void)
+{
+    struct job_index *index;
+    struct job_entry *job;
+    int i;
+
+    if (!(index = job_index_create (3)))
+        BAIL_OUT ("job_index_create failed");
+    for (i = 1; i <= 5; i++)
+        add_test_job (index, i, 0, FLUX_JOB_INACTIVE);
+    ok (job_index_count (index, FLUX_JOB_INACTIVE) == 3,
+        "max_inactive=3 retains 3 inactive jobs");
+    ok (job_index_purged (index) == 2,
+        "job_index_purged returns 2");
+    ok (job_index_lookup (index, 1) == NULL && job_index_lookup (index, 2) == NULL
+        && job_index_lookup (index, 3) != NULL,
+        "oldest inactive jobs were purged");
+
+    job = job_index_add (index, 6, FLUX_JOB_INACTIVE, 200.);
+    ok (job != NULL && job->t_inactive == 200.
+        && job_index_count (index, FLUX_JOB_INACTIVE) == 3
+        && job_index_lookup (index, 3) == NULL,
+        "adding a job first seen inactive purges the oldest inactive job");
+    job = job_index_add (index, 7, FLUX_JOB_INACTIVE, 1.);
+    ok (job != NULL && job_index_lookup (index, 7) == job
+        && job_index_count (index, FLUX_JOB_INACTIVE) == 3
+        && job_index_lookup (index, 4) == NULL
+        && job_index_lookup (index, 5) != NULL,
+        "adding an inactive job never purges the job being added");
+    job_index_destroy (index);
+}
+
+void test_snapshot (void)
+{
+    struct job_index *index;
+    struct job_index *index2;
+    struct job_entry *job;
+    json_t *o;
+    json_t *bad;
+    int i;
+
+    if (!(index = job_index_create (0)))
+        BAIL_OUT ("job_index_create failed");
+    for (i = 1; i <= 4; i++)
+        add_test_job (index, i, i, i % 2 ? FLUX_JOB_RUN : FLUX_JOB_INACTIVE);
+
+    o = job_index_encode (index);
+    ok (o != NULL && json_array_size (o) == 4,
+        "job_index_encode works");
+
+    if (!(index2 = job_index_create (0)))
+        BAIL_OUT ("job_index_create failed");
+    ok (job_index_decode (index2, o) == 0,
+        "job_index_decode works");
+    ok (job_index_count (index2, 0) == 4
+        && job_index_count (index2, FLUX_JOB_INACTIVE) == 2,
+        "decoded index has expected jobs");
+    job = job_index_lookup (index2, 2);
+    ok (job != NULL && job->userid == 2 && job->t_submit == 2.
+        && job->state == FLUX_JOB_INACTIVE && job->t_inactive == 102.,
+        "decoded job has expected attributes");
+    errno = 0;
+    ok (job_index_decode (index2, o) < 0 && errno == EEXIST,
+        "job_index_decode of duplicate jobs fails with EEXIST");
+    json_decref (o);
+    job_index_destroy (index2);
+
+    if (!(index2 = job_index_create (0)))
+        BAIL_OUT ("job_index_create failed");
+    if (!(bad = json_pack ("[[s]]", "foo")))
+        BAIL_OUT ("json_pack failed");
+    errno = 0;
+    ok (job_index_decode (index2, bad) < 0 && errno == EPROTO,
+        "job_index_decode of malformed entry fails with EPROTO");
+    json_decref (bad);
+    job_index_destroy (index2);
+
+    /* Snapshot entries are in t_submit order, but jobs 1 and 2 went
+     * inactive last, so with max_inactive=2 jobs 3 and 4 are purged.
+     */
+    if (!(index2 = job_index_create (2)))
+        BAIL_OUT ("job_index_create failed");
+    if (!(bad = json_pack ("[[i,i,i,f,i,f] [i,i,i,f,i,f]"
+                           " [i,i,i,f,i,f] [i,i,i,f,i,f]]",
+                           1, 0, 16, 1., FLUX_JOB_INACTIVE, 40.,
+                           2, 0, 16, 2., FLUX_JOB_INACTIVE, 30.,
+                           3, 0, 16, 3., FLUX_JOB_INACTIVE, 20.,
+                           4, 0, 16, 4., FLUX_JOB_INACTIVE, 10.)))
+        BAIL_OUT ("json_pack failed");
+    ok (job_index_decode (index2, bad) == 0
+        && job_index_count (index2, FLUX_JOB_INACTIVE) == 2
+        && job_index_lookup (index2, 1) != NULL
+        && job_index_lookup (index2, 2) != NULL,
+        "job_index_decode purges restored jobs by t_inactive");
+    json_decref (bad);
+    job_index_destroy (index2);
+
+    job_index_destroy (index);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_basic ();
+    test_purge ();
+    test_snapshot ();
+
+    done_testing ();
+}
+
+/*
+ * vi:ts=4 sw=4 expandtab
+ */
@@ -83,6 +83,9 @@
 #include <flux/core.h>
 #include <assert.h>
 
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/hist.h"
+
 #include "queue.h"
 #include "job.h"
 #include "alloc.h"
@@ -106,6 +109,7 @@ struct alloc_ctx {
     flux_watcher_t *check;
     flux_watcher_t *idle;
     unsigned int active_alloc_count; // for mode=single, max of 1
+    struct hist *latency;   // sched.alloc request to final response (usec)
 };
 
 /* Initiate teardown.  Clear any alloc/free requests, and clear
@@ -240,6 +244,7 @@ static void alloc_response_cb (flux_t *h, flux_msg_handler_t *mh,
 
     ctx->active_alloc_count--;
     job->alloc_pending = 0;
+    (void)hist_record_since (ctx->latency, job->t_alloc);
 
     /* Handle alloc error.
      * Raise alloc exception and transition to CLEANUP state.
@@ -289,6 +294,7 @@ int alloc_request (struct alloc_ctx *ctx, struct job *job)
                             "userid", job->userid,
                             "t_submit", job->t_submit) < 0)
         goto error;
+    monotime (&job->t_alloc);
     if (flux_send (ctx->h, msg, 0) < 0)
         goto error;
     flux_msg_destroy (msg);
@@ -465,6 +471,11 @@ void alloc_dequeue_alloc_request (struct alloc_ctx *ctx, struct job *job)
     }
 }
 
+struct hist *alloc_get_latency (struct alloc_ctx *ctx)
+{
+    return ctx->latency;
+}
+
 void alloc_ctx_destroy (struct alloc_ctx *ctx)
 {
     if (ctx) {
@@ -474,6 +485,7 @@ void alloc_ctx_destroy (struct alloc_ctx *ctx)
         flux_watcher_destroy (ctx->check);
         flux_watcher_destroy (ctx->idle);
         queue_destroy (ctx->inqueue);
+        hist_destroy (ctx->latency);
         free (ctx);
         errno = saved_errno;
     }
@@ -500,6 +512,8 @@ struct alloc_ctx *alloc_ctx_create (flux_t *h, struct queue *queue,
     ctx->event_ctx = event_ctx;
     if (!(ctx->inqueue = queue_create (false)))
         goto error;
+    if (!(ctx->latency = hist_create ()))
+        goto error;
     if (flux_msg_handler_addvec (h, htab, ctx, &ctx->handlers) < 0)
         goto error;
     ctx->prep = flux_prepare_watcher_create (r, prep_cb, ctx);
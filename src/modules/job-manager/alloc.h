@@ -19,6 +19,7 @@
 
 struct alloc_ctx;
 struct event_ctx;
+struct hist;
 
 void alloc_ctx_destroy (struct alloc_ctx *ctx);
 struct alloc_ctx *alloc_ctx_create (flux_t *h, struct queue *queue,
@@ -39,6 +40,11 @@ void alloc_dequeue_alloc_request (struct alloc_ctx *ctx, struct job *job);
  */
 int alloc_send_free_request (struct alloc_ctx *ctx, struct job *job);
 
+/* Histogram of sched.alloc round trip times in microseconds, from
+ * sending the request to receiving the final response.
+ */
+struct hist *alloc_get_latency (struct alloc_ctx *ctx);
+
 #endif /* ! _FLUX_JOB_MANAGER_ALLOC_H */
 
 /*
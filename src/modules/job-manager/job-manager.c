@@ -13,6 +13,8 @@
 #endif
 #include <flux/core.h>
 
+#include "src/common/libutil/hist.h"
+
 #include "job.h"
 #include "queue.h"
 #include "submit.h"
@@ -57,10 +59,45 @@ static void priority_cb (flux_t *h, flux_msg_handler_t *mh,
     priority_handle_request (h, ctx->queue, ctx->event_ctx, msg);
 }
 
+static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
+                          const flux_msg_t *msg, void *arg)
+{
+    struct job_manager_ctx *ctx = arg;
+    struct hist *alloc_latency = alloc_get_latency (ctx->alloc_ctx);
+
+    if (flux_respond_pack (h, msg, "{s:o}",
+                           "alloc (us)", hist_encode (alloc_latency)) < 0)
+        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+}
+
+static void stats_clear (struct job_manager_ctx *ctx)
+{
+    hist_clear (alloc_get_latency (ctx->alloc_ctx));
+}
+
+static void stats_clear_event_cb (flux_t *h, flux_msg_handler_t *mh,
+                                  const flux_msg_t *msg, void *arg)
+{
+    stats_clear (arg);
+}
+
+static void stats_clear_request_cb (flux_t *h, flux_msg_handler_t *mh,
+                                    const flux_msg_t *msg, void *arg)
+{
+    stats_clear (arg);
+    if (flux_respond (h, msg, NULL) < 0)
+        flux_log_error (h, "%s: flux_respond", __FUNCTION__);
+}
+
 static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST, "job-manager.list", list_cb, FLUX_ROLE_USER},
     { FLUX_MSGTYPE_REQUEST, "job-manager.raise", raise_cb, FLUX_ROLE_USER},
     { FLUX_MSGTYPE_REQUEST, "job-manager.priority", priority_cb, FLUX_ROLE_USER},
+    { FLUX_MSGTYPE_REQUEST, "job-manager.stats.get", stats_get_cb, 0},
+    { FLUX_MSGTYPE_REQUEST, "job-manager.stats.clear",
+                                                stats_clear_request_cb, 0},
+    { FLUX_MSGTYPE_EVENT,   "job-manager.stats.clear",
+                                                stats_clear_event_cb, 0},
     FLUX_MSGHANDLER_TABLE_END,
 };
 
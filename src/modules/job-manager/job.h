@@ -12,6 +12,7 @@
 #define _FLUX_JOB_MANAGER_JOB_H
 
 #include <stdint.h>
+#include <time.h>
 #include "src/common/libjob/job.h"
 
 struct job {
@@ -28,6 +29,8 @@ struct job {
     uint8_t has_resources:1;
     uint8_t start_pending:1;
 
+    struct timespec t_alloc; // time sched.alloc was sent (for latency stats)
+
     void *aux_queue_handle;
     void *queue_handle; // primary queue handle (for listing all active jobs)
     int refcount;       // private to job.c
@@ -17,18 +17,34 @@
  *   customizable tool output.
  *
  *   The entire queue can be dumped if desired.  This is useful for testing
- *   job-manager queue management.
+ *   job-manager queue management.  Large queues may be paged through
+ *   using a cursor, and/or streamed one job per response.
  *
  * Input:
  * - set of attributes to list per job
- * - max number of jobs to return from head of queue
+ * - max number of jobs to return from head of queue (or from cursor)
+ * - optional filters: state mask, userid, priority range
+ * - optional cursor returned by a previous request
  *
  * Output:
  * - array of job objects (job objects contain the requested attributes
  *   and their values)
+ * - cursor, if max_entries was reached
+ *
+ * Streaming:
+ *   If the request has the FLUX_MSGFLAG_STREAMING flag set, each job is
+ *   returned in its own response {"job":{...}}.  If max_entries was reached,
+ *   a {"cursor":{...}} response follows.  The stream is terminated with
+ *   an ENODATA error response.
+ *
+ * Cursor:
+ *   The cursor is the queue sort key (priority, t_submit) plus jobid of
+ *   the last job returned.  Clients should treat it as opaque and pass it
+ *   back unmodified to obtain the next page.  Since the queue may change
+ *   between requests, a paged listing is not a snapshot: a job whose
+ *   priority changes between pages may be listed twice or not at all.
  *
  * Caveats:
- * - Always returns one response message regardless of number of jobs.
  * - Only a hardwired list of attributes is supported.
  * - No limits on guest access.
  */
@@ -40,91 +56,275 @@
 #include <flux/core.h>
 
 #include "src/common/libjob/job.h"
+#include "src/common/libutil/macros.h"
 
 #include "job.h"
 #include "queue.h"
+#include "list.h"
 
-/* For a given job, create a JSON object containing the requested
- * attributes and their values.  Returns JSON object which the caller
- * must free.  On error, return NULL with errno set:
+typedef json_t *(*list_attr_f)(struct job *job);
+
+struct list_attr {
+    const char *name;
+    list_attr_f get;
+};
+
+struct list_attrs {
+    int count;
+    const struct list_attr *attr[];
+};
+
+static json_t *get_id (struct job *job)
+{
+    return json_integer (job->id);
+}
+
+static json_t *get_userid (struct job *job)
+{
+    return json_integer (job->userid);
+}
+
+static json_t *get_priority (struct job *job)
+{
+    return json_integer (job->priority);
+}
+
+static json_t *get_t_submit (struct job *job)
+{
+    return json_real (job->t_submit);
+}
+
+static json_t *get_state (struct job *job)
+{
+    return json_integer (job->state);
+}
+
+static const struct list_attr attrtab[] = {
+    { "id",         get_id },
+    { "userid",     get_userid },
+    { "priority",   get_priority },
+    { "t_submit",   get_t_submit },
+    { "state",      get_state },
+    { NULL, NULL },
+};
+
+static const struct list_attr *attr_lookup (const char *name)
+{
+    int i;
+
+    for (i = 0; attrtab[i].name != NULL; i++) {
+        if (!strcmp (attrtab[i].name, name))
+            return &attrtab[i];
+    }
+    return NULL;
+}
+
+void list_attrs_destroy (struct list_attrs *attrs)
+{
+    if (attrs) {
+        int saved_errno = errno;
+        free (attrs);
+        errno = saved_errno;
+    }
+}
+
+/* Resolve 'attrs' array of attribute names to a table of extraction
+ * functions, so that names are looked up once per request rather than
+ * once per job.  On error, return NULL with errno set:
  *
- * EPROTO - malformed attrs array
+ * EPROTO - malformed or empty attrs array
+ * EINVAL - unknown attribute
  * ENOMEM - out of memory
  */
-json_t *list_one_job (struct job *job, json_t *attrs)
+struct list_attrs *list_attrs_compile (json_t *attrs)
 {
+    struct list_attrs *la;
     size_t index;
     json_t *value;
-    json_t *o;
-    int saved_errno;
 
-    if (!(o = json_object ()))
-        goto error_nomem;
+    if (!json_is_array (attrs) || json_array_size (attrs) == 0) {
+        errno = EPROTO;
+        return NULL;
+    }
+    if (!(la = calloc (1, sizeof (*la) + json_array_size (attrs)
+                                       * sizeof (la->attr[0]))))
+        return NULL;
     json_array_foreach (attrs, index, value) {
-        const char *attr = json_string_value (value);
-        json_t *val = NULL;
-        if (!attr) {
+        const char *name = json_string_value (value);
+        if (!name) {
             errno = EPROTO;
             goto error;
         }
-        if (!strcmp (attr, "id")) {
-            val = json_integer (job->id);
-        }
-        else if (!strcmp (attr, "userid")) {
-            val = json_integer (job->userid);
-        }
-        else if (!strcmp (attr, "priority")) {
-            val = json_integer (job->priority);
-        }
-        else if (!strcmp (attr, "t_submit")) {
-            val = json_real (job->t_submit);
-        }
-        else if (!strcmp (attr, "state")) {
-            val = json_integer (job->state);
-        }
-        else {
+        if (!(la->attr[la->count++] = attr_lookup (name))) {
             errno = EINVAL;
             goto error;
         }
-        if (val == NULL)
+    }
+    return la;
+error:
+    list_attrs_destroy (la);
+    return NULL;
+}
+
+/* For a given job, create a JSON object containing the requested
+ * attributes and their values.  Returns JSON object which the caller
+ * must free.  On error, return NULL with errno set:
+ *
+ * ENOMEM - out of memory
+ */
+json_t *list_one_job (struct job *job, const struct list_attrs *attrs)
+{
+    json_t *o;
+    int i;
+
+    if (!(o = json_object ()))
+        goto error_nomem;
+    for (i = 0; i < attrs->count; i++) {
+        json_t *val;
+        if (!(val = attrs->attr[i]->get (job)))
             goto error_nomem;
-        if (json_object_set_new (o, attr, val) < 0) {
+        if (json_object_set_new (o, attrs->attr[i]->name, val) < 0) {
             json_decref (val);
             goto error_nomem;
         }
     }
     return o;
 error_nomem:
-    errno = ENOMEM;
-error:
-    saved_errno = errno;
     json_decref (o);
-    errno = saved_errno;
+    errno = ENOMEM;
     return NULL;
 }
 
-/* Create a JSON array of 'job' objects, representing the head of the queue.
+void list_filter_init (struct list_filter *filter)
+{
+    filter->states = 0;
+    filter->userid = FLUX_USERID_UNKNOWN;
+    filter->priority_min = FLUX_JOB_PRIORITY_MIN;
+    filter->priority_max = FLUX_JOB_PRIORITY_MAX;
+}
+
+static bool filter_match (const struct list_filter *filter, struct job *job)
+{
+    if (filter->states != 0 && !(filter->states & job->state))
+        return false;
+    if (filter->userid != FLUX_USERID_UNKNOWN && filter->userid != job->userid)
+        return false;
+    if (job->priority < filter->priority_min
+                || job->priority > filter->priority_max)
+        return false;
+    return true;
+}
+
+static void cursor_set (struct list_cursor *cursor, struct job *job)
+{
+    cursor->priority = job->priority;
+    cursor->t_submit = job->t_submit;
+    cursor->id = job->id;
+}
+
+/* Compare job's queue sort key to cursor (cf. job_list_cmp() in queue.c).
+ */
+static int cursor_cmp (struct job *job, const struct list_cursor *cursor)
+{
+    int rc;
+
+    if ((rc = (-1)*NUMCMP (job->priority, cursor->priority)) == 0)
+        rc = NUMCMP (job->t_submit, cursor->t_submit);
+    return rc;
+}
+
+/* Return the first job in the queue after 'cursor'.
+ * If the cursor job is still present at the same sort key, skip exactly
+ * past it.  Otherwise skip all jobs that sort before the cursor key, and
+ * among jobs with an equal key, those with jobid <= the cursor jobid.
+ */
+static struct job *cursor_seek (struct queue *queue,
+                                const struct list_cursor *cursor)
+{
+    struct job *anchor;
+    struct job *job;
+    int saved_errno = errno;
+
+    if ((anchor = queue_lookup_by_id (queue, cursor->id))
+                && cursor_cmp (anchor, cursor) != 0)
+        anchor = NULL;
+    errno = saved_errno;
+
+    job = queue_first (queue);
+    while (job) {
+        int rc = cursor_cmp (job, cursor);
+        if (rc > 0)
+            break;
+        if (rc == 0) {
+            if (anchor) {
+                if (job == anchor)
+                    return queue_next (queue);
+            }
+            else if (job->id > cursor->id)
+                break;
+        }
+        job = queue_next (queue);
+    }
+    return job;
+}
+
+struct job *list_first (struct queue *queue, const struct list_filter *filter,
+                        const struct list_cursor *cursor)
+{
+    struct job *job;
+
+    if (cursor)
+        job = cursor_seek (queue, cursor);
+    else
+        job = queue_first (queue);
+    while (job && !filter_match (filter, job))
+        job = queue_next (queue);
+    return job;
+}
+
+struct job *list_next (struct queue *queue, const struct list_filter *filter)
+{
+    struct job *job;
+
+    do {
+        job = queue_next (queue);
+    } while (job && !filter_match (filter, job));
+    return job;
+}
+
+/* Create a JSON array of 'job' objects, representing the head of the queue,
+ * or the portion of the queue following 'cursor' if non-NULL.
+ * Only jobs matching 'filter' are included.
  * 'max_entries' determines the max number of jobs to return, 0=unlimited.
+ * If 'max_entries' is reached, 'next' (if non-NULL) is set to the position
+ * of the last job returned and '*truncated' is set to true.
  * Returns JSON object which the caller must free.  On error, return NULL
  * with errno set:
  *
- * EPROTO - malformed or empty attrs array, max_entries out of range
+ * EPROTO - max_entries out of range
  * ENOMEM - out of memory
  */
-json_t *list_job_array (struct queue *queue, int max_entries, json_t *attrs)
+json_t *list_job_array (struct queue *queue,
+                        int max_entries,
+                        const struct list_attrs *attrs,
+                        const struct list_filter *filter,
+                        const struct list_cursor *cursor,
+                        struct list_cursor *next,
+                        bool *truncated)
 {
     json_t *jobs = NULL;
     struct job *job;
     int saved_errno;
 
-    if (max_entries < 0 || !json_is_array (attrs)
-                        || json_array_size (attrs) == 0) {
+    if (max_entries < 0 || !attrs || !filter) {
         errno = EPROTO;
         goto error;
     }
+    if (truncated)
+        *truncated = false;
     if (!(jobs = json_array ()))
         goto error_nomem;
-    job = queue_first (queue);
+    job = list_first (queue, filter, cursor);
     while (job) {
         json_t *o;
         if (!(o = list_one_job (job, attrs)))
@@ -133,9 +333,14 @@ json_t *list_job_array (struct queue *queue, int max_entries, json_t *attrs)
             json_decref (o);
             goto error_nomem;
         }
-        if (json_array_size (jobs) == max_entries)
+        if (json_array_size (jobs) == max_entries) {
+            if (next)
+                cursor_set (next, job);
+            if (truncated)
+                *truncated = true;
             break;
-        job = queue_next (queue);
+        }
+        job = list_next (queue, filter);
     }
     return jobs;
 error_nomem:
@@ -147,26 +352,139 @@ error:
     return NULL;
 }
 
+json_t *list_cursor_encode (const struct list_cursor *cursor)
+{
+    json_t *o;
+
+    if (!(o = json_pack ("{s:i s:f s:I}",
+                         "priority", cursor->priority,
+                         "t_submit", cursor->t_submit,
+                         "id", cursor->id))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return o;
+}
+
+int list_cursor_decode (json_t *o, struct list_cursor *cursor)
+{
+    if (json_unpack (o, "{s:i s:F s:I}",
+                        "priority", &cursor->priority,
+                        "t_submit", &cursor->t_submit,
+                        "id", &cursor->id) < 0) {
+        errno = EPROTO;
+        return -1;
+    }
+    return 0;
+}
+
+/* Send one response per job, followed by a cursor response if
+ * max_entries was reached, then terminate the stream with ENODATA.
+ */
+static int list_stream (flux_t *h,
+                        struct queue *queue,
+                        const flux_msg_t *msg,
+                        int max_entries,
+                        const struct list_attrs *attrs,
+                        const struct list_filter *filter,
+                        const struct list_cursor *cursor)
+{
+    struct job *job;
+    int count = 0;
+
+    job = list_first (queue, filter, cursor);
+    while (job) {
+        json_t *o;
+        if (!(o = list_one_job (job, attrs)))
+            return -1;
+        if (flux_respond_pack (h, msg, "{s:o}", "job", o) < 0) {
+            flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+            return 0; // don't try to respond again
+        }
+        if (++count == max_entries) {
+            struct list_cursor next;
+            json_t *c;
+
+            cursor_set (&next, job);
+            if (!(c = list_cursor_encode (&next)))
+                return -1;
+            if (flux_respond_pack (h, msg, "{s:o}", "cursor", c) < 0) {
+                flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+                return 0;
+            }
+            break;
+        }
+        job = list_next (queue, filter);
+    }
+    errno = ENODATA;
+    return -1;
+}
+
 void list_handle_request (flux_t *h, struct queue *queue,
                           const flux_msg_t *msg)
 {
     int max_entries;
     json_t *jobs;
     json_t *attrs;
+    json_t *cursor_o = NULL;
+    int userid = FLUX_USERID_UNKNOWN;
+    struct list_attrs *la = NULL;
+    struct list_filter filter;
+    struct list_cursor cursor;
+    struct list_cursor next;
+    bool truncated;
 
-    if (flux_request_unpack (msg, NULL, "{s:i s:o}",
+    list_filter_init (&filter);
+    if (flux_request_unpack (msg, NULL, "{s:i s:o s?:i s?:i s?:i s?:i s?:o}",
                                         "max_entries", &max_entries,
-                                        "attrs", &attrs) < 0)
+                                        "attrs", &attrs,
+                                        "states", &filter.states,
+                                        "userid", &userid,
+                                        "priority_min", &filter.priority_min,
+                                        "priority_max", &filter.priority_max,
+                                        "cursor", &cursor_o) < 0)
+        goto error;
+    filter.userid = userid;
+    if (max_entries < 0) {
+        errno = EPROTO;
         goto error;
-    if (!(jobs = list_job_array (queue, max_entries, attrs)))
+    }
+    if (cursor_o && list_cursor_decode (cursor_o, &cursor) < 0)
+        goto error;
+    if (!(la = list_attrs_compile (attrs)))
+        goto error;
+    if (flux_msg_is_streaming (msg)) {
+        if (list_stream (h, queue, msg, max_entries, la, &filter,
+                         cursor_o ? &cursor : NULL) < 0)
+            goto error;
+        list_attrs_destroy (la);
+        return;
+    }
+    if (!(jobs = list_job_array (queue, max_entries, la, &filter,
+                                 cursor_o ? &cursor : NULL,
+                                 &next, &truncated)))
         goto error;
-    if (flux_respond_pack (h, msg, "{s:O}", "jobs", jobs) < 0)
-        flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    if (truncated) {
+        json_t *c;
+        if (!(c = list_cursor_encode (&next))) {
+            json_decref (jobs);
+            goto error;
+        }
+        if (flux_respond_pack (h, msg, "{s:O s:o}", "jobs", jobs,
+                                                    "cursor", c) < 0)
+            flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    }
+    else {
+        if (flux_respond_pack (h, msg, "{s:O}", "jobs", jobs) < 0)
+            flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
+    }
     json_decref (jobs);
+    list_attrs_destroy (la);
     return;
 error:
     if (flux_respond_error (h, msg, errno, NULL) < 0)
         flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
+    list_attrs_destroy (la);
 }
 
 /*
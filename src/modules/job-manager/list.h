@@ -11,17 +11,57 @@
 #ifndef _FLUX_JOB_MANAGER_LIST_H
 #define _FLUX_JOB_MANAGER_LIST_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <jansson.h>
 #include "queue.h"
 
+/* Select jobs by state, userid, and priority.
+ * states=0 matches any state; userid=FLUX_USERID_UNKNOWN matches any user.
+ */
+struct list_filter {
+    int states;             // mask of flux_job_state_t
+    uint32_t userid;
+    int priority_min;
+    int priority_max;
+};
+
+/* Position in queue for resuming a listing.
+ */
+struct list_cursor {
+    int priority;
+    double t_submit;
+    flux_jobid_t id;
+};
+
+struct list_attrs;
+
 /* Handle a 'list' request - to list the queue.
  */
 void list_handle_request (flux_t *h, struct queue *queue,
                           const flux_msg_t *msg);
 
 /* exposed for unit testing only */
-json_t *list_one_job (struct job *job, json_t *attrs);
-json_t *list_job_array (struct queue *queue, int max_entries, json_t *attrs);
+struct list_attrs *list_attrs_compile (json_t *attrs);
+void list_attrs_destroy (struct list_attrs *attrs);
+
+void list_filter_init (struct list_filter *filter);
+
+json_t *list_cursor_encode (const struct list_cursor *cursor);
+int list_cursor_decode (json_t *o, struct list_cursor *cursor);
+
+struct job *list_first (struct queue *queue, const struct list_filter *filter,
+                        const struct list_cursor *cursor);
+struct job *list_next (struct queue *queue, const struct list_filter *filter);
+
+json_t *list_one_job (struct job *job, const struct list_attrs *attrs);
+json_t *list_job_array (struct queue *queue,
+                        int max_entries,
+                        const struct list_attrs *attrs,
+                        const struct list_filter *filter,
+                        const struct list_cursor *cursor,
+                        struct list_cursor *next,
+                        bool *truncated);
 
 #endif /* ! _FLUX_JOB_MANAGER_LIST_H */
 /*
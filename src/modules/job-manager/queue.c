@@ -19,6 +19,7 @@
 #include <stdbool.h>
 
 #include "src/common/libjob/job.h"
+#include "src/common/libutil/macros.h"
 #include "job.h"
 #include "queue.h"
 
@@ -29,9 +30,6 @@ struct queue {
     void *empty_arg;
 };
 
-#define NUMCMP(a,b) ((a)==(b)?0:((a)<(b)?-1:1))
-
-
 /* Hash numerical jobid in 'key'.
  * N.B. zhashx_hash_fn signature
  */
@@ -18,6 +18,8 @@
 
 /* Create queue of size jobs
  *   id: [0:size-1]
+ *   userid: id % 2
+ *   state: NEW for even id, SCHED for odd id
  */
 struct queue *make_test_queue (int size)
 {
@@ -33,12 +35,134 @@ struct queue *make_test_queue (int size)
         if (!(j = job_create ()))
             BAIL_OUT ("job_create failed");
         j->id = id;
+        j->userid = id % 2;
+        j->state = (id % 2) ? FLUX_JOB_SCHED : FLUX_JOB_NEW;
         if (queue_insert (q, j, &j->queue_handle) < 0)
             BAIL_OUT ("queue_insert failed");
     }
     return q;
 }
 
+/* Check that array 'o' contains jobs with ids first, first+step, ...
+ */
+bool check_ids (json_t *o, int first, int step)
+{
+    size_t index;
+    json_t *el;
+    flux_jobid_t id;
+
+    json_array_foreach (o, index, el) {
+        if (json_unpack (el, "{s:I}", "id", &id) < 0)
+            return false;
+        if (id != first + index * step) {
+            diag ("array[%d] id=%d", (int)index, (int)id);
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_filter (struct queue *q, struct list_attrs *la, int q_size)
+{
+    struct list_filter filter;
+    json_t *o;
+
+    list_filter_init (&filter);
+    filter.states = FLUX_JOB_SCHED;
+    o = list_job_array (q, 0, la, &filter, NULL, NULL, NULL);
+    ok (o != NULL && json_array_size (o) == q_size / 2 && check_ids (o, 1, 2),
+        "list_job_array states=SCHED returns odd jobs");
+    json_decref (o);
+
+    filter.states = FLUX_JOB_SCHED | FLUX_JOB_NEW;
+    o = list_job_array (q, 0, la, &filter, NULL, NULL, NULL);
+    ok (o != NULL && json_array_size (o) == q_size,
+        "list_job_array states=SCHED|NEW returns all jobs");
+    json_decref (o);
+
+    filter.states = FLUX_JOB_RUN;
+    o = list_job_array (q, 0, la, &filter, NULL, NULL, NULL);
+    ok (o != NULL && json_array_size (o) == 0,
+        "list_job_array states=RUN returns empty array");
+    json_decref (o);
+
+    list_filter_init (&filter);
+    filter.userid = 0;
+    o = list_job_array (q, 0, la, &filter, NULL, NULL, NULL);
+    ok (o != NULL && json_array_size (o) == q_size / 2 && check_ids (o, 0, 2),
+        "list_job_array userid=0 returns even jobs");
+    json_decref (o);
+
+    list_filter_init (&filter);
+    filter.priority_min = FLUX_JOB_PRIORITY_DEFAULT + 1;
+    o = list_job_array (q, 0, la, &filter, NULL, NULL, NULL);
+    ok (o != NULL && json_array_size (o) == 0,
+        "list_job_array priority_min=default+1 returns empty array");
+    json_decref (o);
+}
+
+void test_cursor (struct queue *q, struct list_attrs *la, int q_size)
+{
+    struct list_filter filter;
+    struct list_cursor cursor;
+    struct list_cursor next;
+    bool truncated;
+    json_t *o;
+    json_t *c;
+    struct job *j;
+    int count = 0;
+    int pages = 0;
+
+    list_filter_init (&filter);
+    o = list_job_array (q, 5, la, &filter, NULL, &cursor, &truncated);
+    ok (o != NULL && json_array_size (o) == 5 && truncated == true,
+        "list_job_array max_entries=5 sets truncated");
+    ok (cursor.id == 4,
+        "cursor is positioned at last job returned");
+    count += json_array_size (o);
+    pages++;
+    json_decref (o);
+
+    while (truncated) {
+        o = list_job_array (q, 5, la, &filter, &cursor, &next, &truncated);
+        if (!o)
+            BAIL_OUT ("list_job_array with cursor failed");
+        if (!check_ids (o, count, 1))
+            break;
+        count += json_array_size (o);
+        pages++;
+        json_decref (o);
+        cursor = next;
+    }
+    ok (count == q_size && pages == (q_size + 4) / 5,
+        "paging with cursor visits every job once");
+
+    /* cursor survives JSON round trip */
+    cursor.priority = FLUX_JOB_PRIORITY_DEFAULT;
+    cursor.t_submit = 0.;
+    cursor.id = 7;
+    ok ((c = list_cursor_encode (&cursor)) != NULL,
+        "list_cursor_encode works");
+    memset (&next, 0, sizeof (next));
+    ok (list_cursor_decode (c, &next) == 0
+        && next.id == 7 && next.priority == FLUX_JOB_PRIORITY_DEFAULT
+        && next.t_submit == 0.,
+        "list_cursor_decode works");
+    json_decref (c);
+
+    errno = 0;
+    ok (list_cursor_decode (NULL, &next) < 0 && errno == EPROTO,
+        "list_cursor_decode NULL fails with EPROTO");
+
+    /* cursor job has left the queue */
+    if (!(j = queue_lookup_by_id (q, 7)))
+        BAIL_OUT ("queue_lookup_by_id 7 failed");
+    queue_delete (q, j, j->queue_handle);
+    j = list_first (q, &filter, &cursor);
+    ok (j != NULL && j->id == 8,
+        "list_first resumes after missing cursor job");
+}
+
 int main (int argc, char *argv[])
 {
     const int q_size = 16;
@@ -46,6 +170,8 @@ int main (int argc, char *argv[])
     struct job *j;
     json_t *attrs;
     json_t *badattrs;
+    struct list_attrs *la;
+    struct list_filter filter;
     json_t *o;
     json_t *el;
     json_t *id_o;
@@ -56,17 +182,20 @@ int main (int argc, char *argv[])
     q = make_test_queue (q_size);
     if (!(attrs = json_pack ("[s]", "id")))
         BAIL_OUT ("json_pack failed");
+    if (!(la = list_attrs_compile (attrs)))
+        BAIL_OUT ("list_attrs_compile failed");
+    list_filter_init (&filter);
 
     /* list_job_array */
 
-    o = list_job_array (q, 0, attrs);
+    o = list_job_array (q, 0, la, &filter, NULL, NULL, NULL);
     ok (o != NULL && json_is_array (o),
         "list_job_array returns array");
     ok (json_array_size (o) == q_size,
         "array has expected size");
     json_decref (o);
 
-    o = list_job_array (q, 4, attrs);
+    o = list_job_array (q, 4, la, &filter, NULL, NULL, NULL);
     ok (o != NULL && json_is_array (o),
         "list_job_array max_entries=4 returns array");
     ok (json_array_size (o) == 4,
@@ -86,32 +215,66 @@ int main (int argc, char *argv[])
     json_decref (o);
 
     errno = 0;
-    ok (list_job_array (q, -1, attrs) == NULL && errno == EPROTO,
+    ok (list_job_array (q, -1, la, &filter, NULL, NULL, NULL) == NULL
+        && errno == EPROTO,
         "list_job_array max_entries < 0 fails with EPROTO");
 
     errno = 0;
-    ok (list_job_array (q, -1, NULL) == NULL && errno == EPROTO,
+    ok (list_job_array (q, 0, NULL, &filter, NULL, NULL, NULL) == NULL
+        && errno == EPROTO,
         "list_job_array attrs=NULL fails with EPROTO");
 
-    /* list_one_job */
+    test_filter (q, la, q_size);
+
+    /* list_attrs_compile */
+
+    errno = 0;
+    ok (list_attrs_compile (NULL) == NULL && errno == EPROTO,
+        "list_attrs_compile attrs=NULL fails with EPROTO");
+
+    if (!(badattrs = json_array ()))
+        BAIL_OUT ("json_array failed");
+    errno = 0;
+    ok (list_attrs_compile (badattrs) == NULL && errno == EPROTO,
+        "list_attrs_compile attrs=[] fails with EPROTO");
+    json_decref (badattrs);
 
-    if (!(j = queue_lookup_by_id (q, 0)))
-        BAIL_OUT ("queue_lookup_by_id 0 failed");
     if (!(badattrs = json_pack ("[s]", "foo")))
         BAIL_OUT ("json_pack failed");
     errno = 0;
-    ok (list_one_job (j, badattrs) == NULL && errno == EINVAL,
-        "list_one_job attrs=[\"foo\"] fails with EINVAL");
+    ok (list_attrs_compile (badattrs) == NULL && errno == EINVAL,
+        "list_attrs_compile attrs=[\"foo\"] fails with EINVAL");
     json_decref (badattrs);
 
     if (!(badattrs = json_pack ("[i]", 42)))
         BAIL_OUT ("json_pack failed");
     errno = 0;
-    ok (list_one_job (j, badattrs) == NULL && errno == EPROTO,
-        "list_one_job attrs=[42] fails with EPROTO");
+    ok (list_attrs_compile (badattrs) == NULL && errno == EPROTO,
+        "list_attrs_compile attrs=[42] fails with EPROTO");
     json_decref (badattrs);
 
+    /* list_one_job */
+
+    if (!(j = queue_lookup_by_id (q, 3)))
+        BAIL_OUT ("queue_lookup_by_id 3 failed");
+    list_attrs_destroy (la);
+    json_decref (attrs);
+    if (!(attrs = json_pack ("[s,s,s,s,s]", "id", "userid", "priority",
+                                            "t_submit", "state")))
+        BAIL_OUT ("json_pack failed");
+    if (!(la = list_attrs_compile (attrs)))
+        BAIL_OUT ("list_attrs_compile failed");
+    o = list_one_job (j, la);
+    ok (o != NULL && json_object_size (o) == 5,
+        "list_one_job returns all requested attributes");
+    ok (json_integer_value (json_object_get (o, "state")) == FLUX_JOB_SCHED
+        && json_integer_value (json_object_get (o, "userid")) == 1,
+        "list_one_job attribute values are correct");
+    json_decref (o);
+
+    test_cursor (q, la, q_size);
 
+    list_attrs_destroy (la);
     json_decref (attrs);
     queue_destroy (q);
 
@@ -36,6 +36,12 @@
 #include "waitqueue.h"
 #include "cache.h"
 
+/* Entries may be read by lookup threads (see lookup_shared()).
+ * Once valid, 'data' and 'len' never change, and 'o' is only set once,
+ * so readers need no lock.  'valid' and 'o' are published with atomics,
+ * and 'refcount' keeps an entry alive while a reader holds it, even if
+ * the main thread removes it from the cache.
+ */
 struct cache_entry {
     waitqueue_t *waitlist_notdirty;
     waitqueue_t *waitlist_valid;
@@ -48,11 +54,17 @@ struct cache_entry {
                              * zero length data can be valid */
     bool dirty;
     int errnum;
+    int refcount;
     char *blobref;
 };
 
+/* Only the main thread adds or removes entries, but lookup threads
+ * search the hash, and zhashx_lookup() is not a pure read, so every
+ * access to 'zhx' holds 'lock'.
+ */
 struct cache {
     zhashx_t *zhx;
+    pthread_mutex_t lock;
 };
 
 struct cache_entry *cache_entry_create (const char *ref)
@@ -68,6 +80,7 @@ struct cache_entry *cache_entry_create (const char *ref)
         errno = ENOMEM;
         return NULL;
     }
+    entry->refcount = 1;
 
     if (!(entry->blobref = strdup (ref))) {
         cache_entry_destroy (entry);
@@ -80,7 +93,7 @@ struct cache_entry *cache_entry_create (const char *ref)
 
 bool cache_entry_get_valid (struct cache_entry *entry)
 {
-    return (entry && entry->valid);
+    return (entry && __atomic_load_n (&entry->valid, __ATOMIC_ACQUIRE));
 }
 
 bool cache_entry_get_dirty (struct cache_entry *entry)
@@ -140,7 +153,7 @@ int cache_entry_force_clear_dirty (struct cache_entry *entry)
 int cache_entry_get_raw (struct cache_entry *entry, const void **data,
                          int *len)
 {
-    if (!entry || !entry->valid)
+    if (!cache_entry_get_valid (entry))
         return -1;
     if (data)
         (*data) = entry->data;
@@ -174,18 +187,16 @@ int cache_entry_set_raw (struct cache_entry *entry, const void *data, int len)
     }
     entry->data = cpy;
     entry->len = len;
-    entry->valid = true;
+    /* Once valid is published, lookup threads may be reading data,
+     * so it must not be freed or reset here, even if running the
+     * wait queue fails.
+     */
+    __atomic_store_n (&entry->valid, true, __ATOMIC_RELEASE);
     if (entry->waitlist_valid) {
         if (wait_runqueue (entry->waitlist_valid) < 0)
-            goto reset_invalid;
+            return -1;
     }
     return 0;
-reset_invalid:
-    free (entry->data);
-    entry->data = NULL;
-    entry->len = 0;
-    entry->valid = false;
-    return -1;
 }
 
 static void set_wait_errnum (wait_t *w, void *arg)
@@ -236,19 +247,37 @@ int cache_entry_set_errnum_on_notdirty (struct cache_entry *entry, int errnum)
 
 const json_t *cache_entry_get_treeobj (struct cache_entry *entry)
 {
-    if (!entry || !entry->valid || !entry->data)
+    json_t *o;
+    json_t *expected = NULL;
+
+    if (!cache_entry_get_valid (entry) || !entry->data)
         return NULL;
-    if (!entry->o) {
-        if (!(entry->o = treeobj_decodeb (entry->data, entry->len)))
+    if (!(o = __atomic_load_n (&entry->o, __ATOMIC_ACQUIRE))) {
+        /* Lookup threads may race to decode, keep whichever copy wins.
+         */
+        if (!(o = treeobj_decodeb (entry->data, entry->len)))
             return NULL;
+        if (!__atomic_compare_exchange_n (&entry->o, &expected, o, false,
+                                          __ATOMIC_ACQ_REL,
+                                          __ATOMIC_ACQUIRE)) {
+            json_decref (o);
+            o = expected;
+        }
     }
-    return entry->o;
+    return o;
 }
 
-void cache_entry_destroy (void *arg)
+struct cache_entry *cache_entry_incref (struct cache_entry *entry)
 {
-    struct cache_entry *entry = arg;
-    if (entry) {
+    if (entry)
+        __atomic_fetch_add (&entry->refcount, 1, __ATOMIC_RELAXED);
+    return entry;
+}
+
+void cache_entry_decref (struct cache_entry *entry)
+{
+    if (entry
+        && __atomic_sub_fetch (&entry->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
         free (entry->data);
         json_decref (entry->o);
         if (entry->waitlist_notdirty)
@@ -260,6 +289,11 @@ void cache_entry_destroy (void *arg)
     }
 }
 
+void cache_entry_destroy (void *arg)
+{
+    cache_entry_decref (arg);
+}
+
 int cache_entry_wait_notdirty (struct cache_entry *entry, wait_t *wait)
 {
     if (wait) {
@@ -286,8 +320,9 @@ int cache_entry_wait_valid (struct cache_entry *entry, wait_t *wait)
     return 0;
 }
 
-struct cache_entry *cache_lookup (struct cache *cache, const char *ref,
-                                  int current_epoch)
+static struct cache_entry *lookup_locked (struct cache *cache,
+                                          const char *ref,
+                                          int current_epoch)
 {
     struct cache_entry *entry = zhashx_lookup (cache->zhx, ref);
     if (entry && current_epoch > entry->lastuse_epoch)
@@ -295,12 +330,36 @@ struct cache_entry *cache_lookup (struct cache *cache, const char *ref,
     return entry;
 }
 
+struct cache_entry *cache_lookup (struct cache *cache, const char *ref,
+                                  int current_epoch)
+{
+    struct cache_entry *entry;
+
+    pthread_mutex_lock (&cache->lock);
+    entry = lookup_locked (cache, ref, current_epoch);
+    pthread_mutex_unlock (&cache->lock);
+    return entry;
+}
+
+struct cache_entry *cache_lookup_shared (struct cache *cache, const char *ref,
+                                         int current_epoch)
+{
+    struct cache_entry *entry;
+
+    pthread_mutex_lock (&cache->lock);
+    entry = cache_entry_incref (lookup_locked (cache, ref, current_epoch));
+    pthread_mutex_unlock (&cache->lock);
+    return entry;
+}
+
 int cache_insert (struct cache *cache, struct cache_entry *entry)
 {
     int rc;
 
     if (cache && entry) {
+        pthread_mutex_lock (&cache->lock);
         rc = zhashx_insert (cache->zhx, entry->blobref, entry);
+        pthread_mutex_unlock (&cache->lock);
         assert (rc == 0);
     }
     return 0;
@@ -308,8 +367,11 @@ int cache_insert (struct cache *cache, struct cache_entry *entry)
 
 int cache_remove_entry (struct cache *cache, const char *ref)
 {
-    struct cache_entry *entry = zhashx_lookup (cache->zhx, ref);
+    struct cache_entry *entry;
+    int rc = 0;
 
+    pthread_mutex_lock (&cache->lock);
+    entry = zhashx_lookup (cache->zhx, ref);
     if (entry
         && !entry->dirty
         && (!entry->waitlist_notdirty
@@ -317,14 +379,20 @@ int cache_remove_entry (struct cache *cache, const char *ref)
         && (!entry->waitlist_valid
             || !wait_queue_length (entry->waitlist_valid))) {
         zhashx_delete (cache->zhx, ref);
-        return 1;
+        rc = 1;
     }
-    return 0;
+    pthread_mutex_unlock (&cache->lock);
+    return rc;
 }
 
 int cache_count_entries (struct cache *cache)
 {
-    return zhashx_size (cache->zhx);
+    int count;
+
+    pthread_mutex_lock (&cache->lock);
+    count = zhashx_size (cache->zhx);
+    pthread_mutex_unlock (&cache->lock);
+    return count;
 }
 
 static int cache_entry_age (struct cache_entry *entry, int current_epoch)
@@ -343,9 +411,11 @@ int cache_expire_entries (struct cache *cache, int current_epoch, int thresh)
     struct cache_entry *entry;
     int count = 0;
 
+    pthread_mutex_lock (&cache->lock);
     /* Do not use zhashx_first()/zhashx_next() or FOREACH_ZHASHX, as
      * zhashx_delete() call below modifies hash */
     if (!(keys = zhashx_keys (cache->zhx))) {
+        pthread_mutex_unlock (&cache->lock);
         errno = ENOMEM;
         return -1;
     }
@@ -361,6 +431,7 @@ int cache_expire_entries (struct cache *cache, int current_epoch, int thresh)
         }
         ref = zlistx_next (keys);
     }
+    pthread_mutex_unlock (&cache->lock);
     zlistx_destroy (&keys);
     return count;
 }
@@ -374,6 +445,7 @@ int cache_get_stats (struct cache *cache, tstat_t *ts, int *sizep,
     int incomplete = 0;
     int dirty = 0;
 
+    pthread_mutex_lock (&cache->lock);
     FOREACH_ZHASHX (cache->zhx, key, entry) {
         if (cache_entry_get_valid (entry)) {
             int obj_size = 0;
@@ -388,6 +460,7 @@ int cache_get_stats (struct cache *cache, tstat_t *ts, int *sizep,
         if (cache_entry_get_dirty (entry))
             dirty++;
     }
+    pthread_mutex_unlock (&cache->lock);
     if (sizep)
         *sizep = size;
     if (incompletep)
@@ -404,6 +477,10 @@ int cache_wait_destroy_msg (struct cache *cache, wait_test_msg_f cb, void *arg)
     int n, count = 0;
     int rc = -1;
 
+    /* Unlocked: destroying a wait_t may run arbitrary aux destructors.
+     * Iteration doesn't race with lookups from other threads, which
+     * leave the cursor alone, and only this thread modifies the hash.
+     */
     FOREACH_ZHASHX (cache->zhx, key, entry) {
         if (entry->waitlist_valid) {
             if ((n = wait_destroy_msg (entry->waitlist_valid, cb, arg)) < 0)
@@ -445,6 +522,7 @@ struct cache *cache_create (void)
         errno = ENOMEM;
         return NULL;
     }
+    pthread_mutex_init (&cache->lock, NULL);
     /* do not duplicate hash keys, use blobrefs stored in cache entry */
     zhashx_set_key_destructor (cache->zhx, NULL);
     zhashx_set_key_duplicator (cache->zhx, NULL);
@@ -456,6 +534,7 @@ void cache_destroy (struct cache *cache)
 {
     if (cache) {
         zhashx_destroy (&cache->zhx);
+        pthread_mutex_destroy (&cache->lock);
         free (cache);
     }
 }
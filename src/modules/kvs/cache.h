@@ -24,10 +24,16 @@ struct cache;
  *
  * cache_entry_create() creates an empty cache entry.  Data can be set
  * in an entry via cache_entry_set_raw().
+ *
+ * Entries are reference counted.  cache_entry_destroy() is the same as
+ * cache_entry_decref(), and the entry is freed with its last reference.
  */
 struct cache_entry *cache_entry_create (const char *ref);
 void cache_entry_destroy (void *arg);
 
+struct cache_entry *cache_entry_incref (struct cache_entry *entry);
+void cache_entry_decref (struct cache_entry *entry);
+
 /* Return true if cache entry contains valid data.  False would
  * indicate that a load RPC is in progress.
  */
@@ -71,7 +77,8 @@ int cache_entry_force_clear_dirty (struct cache_entry *entry);
  * formatted or zero length), an error will be result.
  *
  * An invalid->valid transition runs the entry's wait queue, if any in
- * both set accessors.
+ * both set accessors.  If running the wait queue fails, the entry is
+ * left valid and -1 is returned.
  *
  * Generally speaking, a cache entry can only be set once.  An attempt
  * to set new data in a cache entry will silently succeed.
@@ -114,6 +121,15 @@ void cache_destroy (struct cache *cache);
 struct cache_entry *cache_lookup (struct cache *cache,
                                   const char *ref, int current_epoch);
 
+/* Like cache_lookup(), but for use from lookup threads.  A reference is
+ * taken on the returned entry, so it survives removal from the cache.
+ * Drop it with cache_entry_decref().  Besides these two, lookup threads
+ * may only call cache_entry_get_valid(), cache_entry_get_raw(), and
+ * cache_entry_get_treeobj().  Everything else is for the main thread.
+ */
+struct cache_entry *cache_lookup_shared (struct cache *cache,
+                                         const char *ref, int current_epoch);
+
 /* Insert entry in the cache.  Reference for entry created during
  * cache_entry_create() time.  Ownership of the cache entry is
  * transferred to the cache.
@@ -27,6 +27,7 @@
 #include "src/common/libutil/blobref.h"
 #include "src/common/libutil/monotime.h"
 #include "src/common/libutil/tstat.h"
+#include "src/common/libutil/hist.h"
 #include "src/common/libkvs/treeobj.h"
 #include "src/common/libkvs/kvs_txn_private.h"
 #include "src/common/libkvs/kvs_util_private.h"
@@ -35,11 +36,17 @@
 #include "cache.h"
 
 #include "lookup.h"
+#include "lookup_pool.h"
+#include "pathcache.h"
 #include "treq.h"
 #include "kvstxn.h"
 #include "kvsroot.h"
 #include "kvssync.h"
 
+/* Default maximum number of path cache entries.
+ */
+const int default_pathcache_size = 16384;
+
 /* Expire cache_entry after 'max_lastuse_age' heartbeats.
  */
 const int max_lastuse_age = 5;
@@ -69,6 +76,12 @@ typedef struct {
     bool events_init;            /* flag */
     const char *hash_name;
     unsigned int seq;           /* for commit transactions */
+    int lookup_threads;
+    struct lookup_pool *lookup_pool;    /* NULL if lookup_threads == 0 */
+    int pathcache_size;
+    struct pathcache *pathcache;        /* NULL if pathcache_size == 0 */
+    struct hist *txn_latency;   /* commit/fence request to response (usec) */
+    struct hist *load_latency;  /* content.load request to response (usec) */
 } kvs_ctx_t;
 
 struct kvs_cb_data {
@@ -94,6 +107,9 @@ static void freectx (void *arg)
     kvs_ctx_t *ctx = arg;
     if (ctx) {
         cache_destroy (ctx->cache);
+        pathcache_destroy (ctx->pathcache);
+        hist_destroy (ctx->txn_latency);
+        hist_destroy (ctx->load_latency);
         kvsroot_mgr_destroy (ctx->krm);
         flux_watcher_destroy (ctx->prep_w);
         flux_watcher_destroy (ctx->check_w);
@@ -131,6 +147,11 @@ static kvs_ctx_t *getctx (flux_t *h)
             saved_errno = ENOMEM;
             goto error;
         }
+        if (!(ctx->txn_latency = hist_create ())
+            || !(ctx->load_latency = hist_create ())) {
+            saved_errno = ENOMEM;
+            goto error;
+        }
         ctx->h = h;
         if (flux_get_rank (h, &ctx->rank) < 0) {
             saved_errno = errno;
@@ -156,6 +177,7 @@ static kvs_ctx_t *getctx (flux_t *h)
             flux_watcher_start (ctx->check_w);
         }
         ctx->transaction_merge = 1;
+        ctx->pathcache_size = default_pathcache_size;
         if (flux_aux_set (h, "kvssrv", ctx, freectx) < 0) {
             saved_errno = errno;
             goto error;
@@ -315,10 +337,18 @@ static int check_user (kvs_ctx_t *ctx, struct kvsroot *root,
  * set/get root
  */
 
+/* 'keys' lists the keys changed since the previous root, if known,
+ * and may be NULL.
+ */
 static void setroot (kvs_ctx_t *ctx, struct kvsroot *root,
-                     const char *rootref, int rootseq)
+                     const char *rootref, int rootseq, json_t *keys)
 {
     if (rootseq == 0 || rootseq > root->seq) {
+        /* keys of any roots skipped over are unknown */
+        if (rootseq != root->seq + 1)
+            keys = NULL;
+        pathcache_setroot (ctx->pathcache, root->ns_name, root->ref,
+                           rootref, keys);
         kvsroot_setroot (ctx->krm, root, rootref, rootseq);
         kvssync_process (root, false);
         root->last_update_epoch = ctx->epoch;
@@ -383,7 +413,7 @@ static void getroot_completion (flux_future_t *f, void *arg)
      * the original callback
      */
     if (!root->remove)
-        setroot (ctx, root, ref, rootseq);
+        setroot (ctx, root, ref, rootseq, NULL);
 
     /* flux_requeue_nocopy takes ownership of 'msg', no need to destroy */
     if (flux_requeue_nocopy (ctx->h, msg, FLUX_RQ_HEAD) < 0) {
@@ -505,8 +535,11 @@ static void content_load_completion (flux_future_t *f, void *arg)
     int size;
     const char *blobref;
     struct cache_entry *entry;
+    struct timespec *t0;
 
     blobref = flux_future_aux_get (f, "ref");
+    if ((t0 = flux_future_aux_get (f, "t0")))
+        (void)hist_record_since (ctx->load_latency, *t0);
 
     /* should be impossible for lookup to fail, cache entry created
      * earlier, and cache_expire_entries() could not have removed it
@@ -544,8 +577,11 @@ static int content_load_request_send (kvs_ctx_t *ctx, const char *ref)
 {
     flux_future_t *f = NULL;
     char *refcpy;
+    struct timespec t0;
+    struct timespec *t0cpy;
     int saved_errno;
 
+    monotime (&t0);
     if (!(f = flux_content_load (ctx->h, ref, 0))) {
         flux_log_error (ctx->h, "%s: flux_content_load", __FUNCTION__);
         goto error;
@@ -559,6 +595,16 @@ static int content_load_request_send (kvs_ctx_t *ctx, const char *ref)
         free (refcpy);
         goto error;
     }
+    if (!(t0cpy = malloc (sizeof (*t0cpy)))) {
+        errno = ENOMEM;
+        goto error;
+    }
+    *t0cpy = t0;
+    if (flux_future_aux_set (f, "t0", t0cpy, free) < 0) {
+        flux_log_error (ctx->h, "%s: flux_future_aux_set", __FUNCTION__);
+        free (t0cpy);
+        goto error;
+    }
     if (flux_future_then (f, -1., content_load_completion, ctx) < 0) {
         flux_log_error (ctx->h, "%s: flux_future_then", __FUNCTION__);
         goto error;
@@ -819,8 +865,25 @@ static void flux_msg_destroy_wrapper (void *arg)
     flux_msg_destroy (msg);
 }
 
+/* Combine the keys and link keys of a setroot into a new array,
+ * or return NULL if either is unknown.
+ */
+static json_t *setroot_keys (json_t *keys, json_t *link_keys)
+{
+    json_t *all;
+
+    if (!keys || !link_keys || !(all = json_copy (keys)))
+        return NULL;
+    if (json_array_extend (all, link_keys) < 0) {
+        json_decref (all);
+        return NULL;
+    }
+    return all;
+}
+
 static int setroot_event_send (kvs_ctx_t *ctx, struct kvsroot *root,
-                               json_t *names, json_t *keys)
+                               json_t *names, json_t *keys,
+                               json_t *link_keys)
 {
     const json_t *root_dir = NULL;
     json_t *nullobj = NULL;
@@ -853,13 +916,14 @@ static int setroot_event_send (kvs_ctx_t *ctx, struct kvsroot *root,
     }
 
     if (!(msg = flux_event_pack (setroot_topic,
-                                 "{ s:s s:i s:s s:O s:O s:O s:i}",
+                                 "{ s:s s:i s:s s:O s:O s:O s:O s:i}",
                                  "namespace", root->ns_name,
                                  "rootseq", root->seq,
                                  "rootref", root->ref,
                                  "names", names,
                                  "rootdir", root_dir,
                                  "keys", keys,
+                                 "link-keys", link_keys,
                                  "owner", root->owner))) {
         saved_errno = errno;
         flux_log_error (ctx->h, "%s: flux_event_pack", __FUNCTION__);
@@ -1067,8 +1131,12 @@ done:
             flux_log (ctx->h, LOG_DEBUG, "aggregated %d transactions (%d ops)",
                       count, opcount);
         }
-        setroot (ctx, root, kvstxn_get_newroot_ref (kt), root->seq + 1);
-        setroot_event_send (ctx, root, names, kvstxn_get_keys (kt));
+        json_t *keys = setroot_keys (kvstxn_get_keys (kt),
+                                     kvstxn_get_link_keys (kt));
+        setroot (ctx, root, kvstxn_get_newroot_ref (kt), root->seq + 1, keys);
+        json_decref (keys);
+        setroot_event_send (ctx, root, names, kvstxn_get_keys (kt),
+                            kvstxn_get_link_keys (kt));
     } else {
         fallback = kvstxn_fallback_mergeable (kt);
 
@@ -1232,6 +1300,7 @@ static int heartbeat_root_cb (struct kvsroot *root, void *arg)
                 flux_log_error (ctx->h, "%s: event_unsubscribe",
                                 __FUNCTION__);
 
+            pathcache_remove_namespace (ctx->pathcache, root->ns_name);
             if (kvsroot_mgr_remove_root (ctx->krm, root->ns_name) < 0)
                 flux_log_error (ctx->h, "%s: kvsroot_mgr_remove_root",
                                 __FUNCTION__);
@@ -1272,6 +1341,8 @@ static void heartbeat_cb (flux_t *h, flux_msg_handler_t *mh,
 
     if (cache_expire_entries (ctx->cache, ctx->epoch, max_lastuse_age) < 0)
         flux_log_error (ctx->h, "%s: cache_expire_entries", __FUNCTION__);
+    (void)pathcache_expire_entries (ctx->pathcache, ctx->epoch,
+                                    max_lastuse_age);
 }
 
 static int lookup_load_cb (lookup_t *lh, const char *ref, void *data)
@@ -1295,22 +1366,103 @@ static void lookup_wait_error_cb (wait_t *w, int errnum, void *arg)
     lookup_set_aux_errnum (lh, errnum);
 }
 
+/* Respond to a lookup request.  'lh' is NULL on error, with errno set.
+ * Destroys 'lh'.
+ */
+typedef void (*lookup_respond_f)(flux_t *h, const flux_msg_t *msg,
+                                 lookup_t *lh);
+
+/* A lookup running in the lookup pool.
+ */
+struct lookup_job {
+    kvs_ctx_t *ctx;
+    flux_msg_handler_t *mh;
+    flux_msg_t *msg;
+    flux_msg_handler_f replay_cb;
+    lookup_respond_f respond;
+};
+
+static lookup_t *lookup_continue (kvs_ctx_t *ctx, flux_msg_handler_t *mh,
+                                  const flux_msg_t *msg, lookup_t *lh,
+                                  lookup_process_t lret,
+                                  flux_msg_handler_f replay_cb,
+                                  bool *stall);
+
+static void lookup_job_destroy (struct lookup_job *job)
+{
+    if (job) {
+        int saved_errno = errno;
+        flux_msg_destroy (job->msg);
+        free (job);
+        errno = saved_errno;
+    }
+}
+
+static void lookup_job_cb (lookup_t *lh, lookup_process_t lret, void *arg)
+{
+    struct lookup_job *job = arg;
+    kvs_ctx_t *ctx = job->ctx;
+    bool stall = false;
+
+    lookup_flush_log (lh);
+    /* module is unloading */
+    if (!ctx->lookup_pool) {
+        lookup_destroy (lh);
+        errno = ENOSYS;
+        job->respond (ctx->h, job->msg, NULL);
+        goto done;
+    }
+    /* the lookup needs the kvsroot_mgr_t, finish it here */
+    if (lret == LOOKUP_PROCESS_YIELD)
+        lret = lookup (lh);
+    if (!(lh = lookup_continue (ctx, job->mh, job->msg, lh, lret,
+                                job->replay_cb, &stall))) {
+        if (stall)
+            goto done;
+    }
+    job->respond (ctx->h, job->msg, lh);
+done:
+    lookup_job_destroy (job);
+}
+
+static int lookup_submit (kvs_ctx_t *ctx, flux_msg_handler_t *mh,
+                          const flux_msg_t *msg, lookup_t *lh,
+                          flux_msg_handler_f replay_cb,
+                          lookup_respond_f respond)
+{
+    struct lookup_job *job;
+
+    if (!(job = calloc (1, sizeof (*job))))
+        return -1;
+    job->ctx = ctx;
+    job->mh = mh;
+    job->replay_cb = replay_cb;
+    job->respond = respond;
+    if (!(job->msg = flux_msg_copy (msg, true))
+        || lookup_pool_submit (ctx->lookup_pool, lh, lookup_job_cb, job) < 0) {
+        lookup_job_destroy (job);
+        return -1;
+    }
+    return 0;
+}
+
+/* Returns the lookup handle if the lookup finished, else NULL with
+ * (*stall) set if the request will be responded to later, and
+ * errno set otherwise.
+ */
 static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
                                 const flux_msg_t *msg, void *arg,
                                 flux_msg_handler_f replay_cb,
+                                lookup_respond_f respond,
                                 bool *stall)
 {
     kvs_ctx_t *ctx = arg;
     int flags;
     const char *ns = NULL;
     const char *key;
-    json_t *val = NULL;
     json_t *root_dirent = NULL;
     lookup_t *lh = NULL;
     const char *root_ref = NULL;
-    wait_t *wait = NULL;
-    lookup_process_t lret;
-    int rc = -1;
     int ret;
 
     /* if lookup_handle exists in msg as aux data, is a replay */
@@ -1371,6 +1523,8 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
                                   flags,
                                   h)))
             goto done;
+        if (lookup_set_pathcache (lh, ctx->pathcache) < 0)
+            goto done;
     }
     else {
         int err;
@@ -1385,7 +1539,29 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
         assert (ret == 0);
     }
 
-    lret = lookup (lh);
+    if (ctx->lookup_pool && lookup_prepare (lh) == 0) {
+        if (lookup_submit (ctx, mh, msg, lh, replay_cb, respond) < 0)
+            goto done;
+        (*stall) = true;
+        return NULL;
+    }
+    return lookup_continue (ctx, mh, msg, lh, lookup (lh), replay_cb, stall);
+done:
+    lookup_destroy (lh);
+    (*stall) = false;
+    return NULL;
+}
+
+static lookup_t *lookup_continue (kvs_ctx_t *ctx, flux_msg_handler_t *mh,
+                                  const flux_msg_t *msg, lookup_t *lh,
+                                  lookup_process_t lret,
+                                  flux_msg_handler_f replay_cb,
+                                  bool *stall)
+{
+    flux_t *h = ctx->h;
+    const char *ns;
+    wait_t *wait = NULL;
+    int rc = -1;
 
     if (lret == LOOKUP_PROCESS_ERROR) {
         errno = lookup_get_errnum (lh);
@@ -1443,10 +1619,8 @@ static lookup_t *lookup_common (flux_t *h, flux_msg_handler_t *mh,
     rc = 0;
 done:
     wait_destroy (wait);
-    if (rc < 0) {
+    if (rc < 0)
         lookup_destroy (lh);
-        json_decref (val);
-    }
     (*stall) = false;
     return (rc == 0) ? lh : NULL;
 
@@ -1455,25 +1629,22 @@ stall:
     return NULL;
 }
 
-static void lookup_request_cb (flux_t *h, flux_msg_handler_t *mh,
-                               const flux_msg_t *msg, void *arg)
+static void lookup_respond (flux_t *h, const flux_msg_t *msg, lookup_t *lh)
 {
-    lookup_t *lh;
     json_t *val;
-    bool stall = false;
 
-    if (!(lh = lookup_common (h, mh, msg, arg, lookup_request_cb,
-                              &stall))) {
-        if (stall)
-            return;
+    if (!lh)
         goto error;
-    }
-
     if (!(val = lookup_get_value (lh))) {
         errno = ENOENT;
         goto error;
     }
-    if (flux_respond_pack (h, msg, "{ s:O }", "val", val) < 0)
+    /* rootseq and symlink let clients decide whether the result
+     * can be cached, see libkvs/kvs_cache.c */
+    if (flux_respond_pack (h, msg, "{ s:O s:i s:b }",
+                           "val", val,
+                           "rootseq", lookup_get_root_seq (lh),
+                           "symlink", lookup_get_walked_symlink (lh)) < 0)
         flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
     lookup_destroy (lh);
     json_decref (val);
@@ -1484,6 +1655,20 @@ error:
     lookup_destroy (lh);
 }
 
+static void lookup_request_cb (flux_t *h, flux_msg_handler_t *mh,
+                               const flux_msg_t *msg, void *arg)
+{
+    lookup_t *lh;
+    bool stall = false;
+
+    if (!(lh = lookup_common (h, mh, msg, arg, lookup_request_cb,
+                              lookup_respond, &stall))) {
+        if (stall)
+            return;
+    }
+    lookup_respond (h, msg, lh);
+}
+
 /* similar to kvs.lookup, but root_ref / root_seq returned to caller.
  * Also, ENOENT handle special case, returned as error number to
  * caller.  This request is a special rpc predominantly used by the
@@ -1491,21 +1676,15 @@ error:
  * on lookups (including ENOENT failed lookups) to determine what
  * lookups can be considered to be read-your-writes consistency safe.
  */
-static void lookup_plus_request_cb (flux_t *h, flux_msg_handler_t *mh,
-                                    const flux_msg_t *msg, void *arg)
+static void lookup_plus_respond (flux_t *h, const flux_msg_t *msg,
+                                 lookup_t *lh)
 {
-    lookup_t *lh;
     json_t *val = NULL;
     const char *root_ref;
     int root_seq;
-    bool stall = false;
 
-    if (!(lh = lookup_common (h, mh, msg, arg, lookup_plus_request_cb,
-                              &stall))) {
-        if (stall)
-            return;
+    if (!lh)
         goto error;
-    }
 
     root_ref = lookup_get_root_ref (lh);
     assert (root_ref);
@@ -1534,6 +1713,20 @@ error:
         flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
 }
 
+static void lookup_plus_request_cb (flux_t *h, flux_msg_handler_t *mh,
+                                    const flux_msg_t *msg, void *arg)
+{
+    lookup_t *lh;
+    bool stall = false;
+
+    if (!(lh = lookup_common (h, mh, msg, arg, lookup_plus_request_cb,
+                              lookup_plus_respond, &stall))) {
+        if (stall)
+            return;
+    }
+    lookup_plus_respond (h, msg, lh);
+}
+
 
 static int finalize_transaction_req (treq_t *tr,
                                      const flux_msg_t *req,
@@ -1575,6 +1768,8 @@ static void finalize_transaction_bynames (kvs_ctx_t *ctx, struct kvsroot *root,
         }
         nameval = json_string_value (name);
         if ((tr = treq_mgr_lookup_transaction (root->trm, nameval))) {
+            (void)hist_record_since (ctx->txn_latency,
+                                     treq_get_create_time (tr));
             treq_iter_request_copies (tr, finalize_transaction_req, &cbd);
             if (treq_mgr_remove_transaction (root->trm, nameval) < 0)
                 flux_log_error (ctx->h, "%s: treq_mgr_remove_transaction",
@@ -2100,7 +2295,8 @@ done:
  */
 static void setroot_event_process (kvs_ctx_t *ctx, struct kvsroot *root,
                                    json_t *names, json_t *rootdir,
-                                   const char *rootref, int rootseq)
+                                   const char *rootref, int rootseq,
+                                   json_t *keys)
 {
     int errnum = 0;
 
@@ -2122,7 +2318,7 @@ static void setroot_event_process (kvs_ctx_t *ctx, struct kvsroot *root,
     if (!json_is_null (rootdir))
         prime_cache_with_rootdir (ctx, rootdir);
 
-    setroot (ctx, root, rootref, rootseq);
+    setroot (ctx, root, rootref, rootseq, keys);
 }
 
 static void setroot_event_cb (flux_t *h, flux_msg_handler_t *mh,
@@ -2135,13 +2331,17 @@ static void setroot_event_cb (flux_t *h, flux_msg_handler_t *mh,
     const char *rootref;
     json_t *rootdir = NULL;
     json_t *names = NULL;
+    json_t *keys = NULL;
+    json_t *link_keys = NULL;
 
-    if (flux_event_unpack (msg, NULL, "{ s:s s:i s:s s:o s:o }",
+    if (flux_event_unpack (msg, NULL, "{ s:s s:i s:s s:o s:o s?o s?o }",
                            "namespace", &ns,
                            "rootseq", &rootseq,
                            "rootref", &rootref,
                            "names", &names,
-                           "rootdir", &rootdir) < 0) {
+                           "rootdir", &rootdir,
+                           "keys", &keys,
+                           "link-keys", &link_keys) < 0) {
         flux_log_error (ctx->h, "%s: flux_event_unpack", __FUNCTION__);
         return;
     }
@@ -2180,7 +2380,9 @@ static void setroot_event_cb (flux_t *h, flux_msg_handler_t *mh,
         return;
     }
 
-    setroot_event_process (ctx, root, names, rootdir, rootref, rootseq);
+    keys = setroot_keys (keys, link_keys);
+    setroot_event_process (ctx, root, names, rootdir, rootref, rootseq, keys);
+    json_decref (keys);
 }
 
 static bool disconnect_cmp (const flux_msg_t *msg, void *arg)
@@ -2258,10 +2460,13 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
     kvs_ctx_t *ctx = arg;
     json_t *tstats = NULL;
     json_t *cstats = NULL;
+    json_t *pstats = NULL;
     json_t *nsstats = NULL;
+    json_t *lstats = NULL;
     tstat_t ts = { .min = 0.0, .max = 0.0, .M = 0.0, .S = 0.0, .newM = 0.0,
                    .newS = 0.0, .n = 0 };
     int size = 0, incomplete = 0, dirty = 0;
+    int pentries, phits, pmisses;
     double scale = 1E-3;
 
     if (flux_request_decode (msg, NULL, NULL) < 0)
@@ -2289,6 +2494,21 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
                               "#faults", ctx->faults)))
         goto nomem;
 
+    pathcache_get_stats (ctx->pathcache, &pentries, &phits, &pmisses);
+    if (!(pstats = json_pack ("{ s:i s:i s:i s:f }",
+                              "#entries", pentries,
+                              "#hits", phits,
+                              "#misses", pmisses,
+                              "hit ratio", phits + pmisses > 0 ?
+                              (double)phits / (phits + pmisses) : 0.)))
+        goto nomem;
+
+    if (!(lstats = json_pack ("{ s:o s:o }",
+                              "transaction", hist_encode (ctx->txn_latency),
+                              "content load",
+                              hist_encode (ctx->load_latency))))
+        goto nomem;
+
     if (!(nsstats = json_object ()))
         goto nomem;
 
@@ -2316,12 +2536,16 @@ static void stats_get_cb (flux_t *h, flux_msg_handler_t *mh,
     }
 
     if (flux_respond_pack (h, msg,
-                           "{ s:O s:O }",
+                           "{ s:O s:O s:O s:O }",
                            "cache", cstats,
+                           "pathcache", pstats,
+                           "latency (us)", lstats,
                            "namespace", nsstats) < 0)
         flux_log_error (h, "%s: flux_respond_pack", __FUNCTION__);
     json_decref (tstats);
     json_decref (cstats);
+    json_decref (pstats);
+    json_decref (lstats);
     json_decref (nsstats);
     return;
 nomem:
@@ -2331,6 +2555,8 @@ error:
         flux_log_error (h, "%s: flux_respond_error", __FUNCTION__);
     json_decref (tstats);
     json_decref (cstats);
+    json_decref (pstats);
+    json_decref (lstats);
     json_decref (nsstats);
 }
 
@@ -2343,6 +2569,9 @@ static int stats_clear_root_cb (struct kvsroot *root, void *arg)
 static void stats_clear (kvs_ctx_t *ctx)
 {
     ctx->faults = 0;
+    pathcache_clear_stats (ctx->pathcache);
+    hist_clear (ctx->txn_latency);
+    hist_clear (ctx->load_latency);
 
     if (kvsroot_mgr_iter_roots (ctx->krm, stats_clear_root_cb, NULL) < 0)
         flux_log_error (ctx->h, "%s: kvsroot_mgr_iter_roots", __FUNCTION__);
@@ -2412,7 +2641,7 @@ static int namespace_create (kvs_ctx_t *ctx, const char *ns,
         goto cleanup;
     }
 
-    setroot (ctx, root, ref, 0);
+    setroot (ctx, root, ref, 0, NULL);
 
     if (event_subscribe (ctx, ns) < 0) {
         flux_log_error (ctx->h, "%s: event_subscribe", __FUNCTION__);
@@ -2745,18 +2974,24 @@ static void setroot_unpause_process_msg (kvs_ctx_t *ctx, struct kvsroot *root,
     const char *rootref;
     json_t *rootdir = NULL;
     json_t *names = NULL;
+    json_t *keys = NULL;
+    json_t *link_keys = NULL;
 
-    if (flux_event_unpack (msg, NULL, "{ s:s s:i s:s s:o s:o }",
+    if (flux_event_unpack (msg, NULL, "{ s:s s:i s:s s:o s:o s?o s?o }",
                            "namespace", &ns,
                            "rootseq", &rootseq,
                            "rootref", &rootref,
                            "names", &names,
-                           "rootdir", &rootdir) < 0) {
+                           "rootdir", &rootdir,
+                           "keys", &keys,
+                           "link-keys", &link_keys) < 0) {
         flux_log_error (ctx->h, "%s: flux_event_unpack", __FUNCTION__);
         return;
     }
 
-    setroot_event_process (ctx, root, names, rootdir, rootref, rootseq);
+    keys = setroot_keys (keys, link_keys);
+    setroot_event_process (ctx, root, names, rootdir, rootref, rootseq, keys);
+    json_decref (keys);
     return;
 }
 
@@ -2855,6 +3090,10 @@ static void process_args (kvs_ctx_t *ctx, int ac, char **av)
     for (i = 0; i < ac; i++) {
         if (strncmp (av[i], "transaction-merge=", 13) == 0)
             ctx->transaction_merge = strtoul (av[i]+13, NULL, 10);
+        else if (strncmp (av[i], "lookup-threads=", 15) == 0)
+            ctx->lookup_threads = strtoul (av[i]+15, NULL, 10);
+        else if (strncmp (av[i], "pathcache-size=", 15) == 0)
+            ctx->pathcache_size = strtoul (av[i]+15, NULL, 10);
         else
             flux_log (ctx->h, LOG_ERR, "Unknown option `%s'", av[i]);
     }
@@ -2943,6 +3182,12 @@ int mod_main (flux_t *h, int argc, char **argv)
         goto done;
     }
     process_args (ctx, argc, argv);
+    if (ctx->pathcache_size > 0) {
+        if (!(ctx->pathcache = pathcache_create (ctx->pathcache_size))) {
+            flux_log_error (h, "pathcache_create");
+            goto done;
+        }
+    }
     if (ctx->rank == 0) {
         struct kvsroot *root;
         char rootref[BLOBREF_MAX_STRING_SIZE];
@@ -2970,13 +3215,20 @@ int mod_main (flux_t *h, int argc, char **argv)
             }
         }
 
-        setroot (ctx, root, rootref, 0);
+        setroot (ctx, root, rootref, 0, NULL);
 
         if (event_subscribe (ctx, KVS_PRIMARY_NAMESPACE) < 0) {
             flux_log_error (h, "event_subscribe");
             goto done;
         }
     }
+    if (ctx->lookup_threads > 0) {
+        if (!(ctx->lookup_pool = lookup_pool_create (flux_get_reactor (h),
+                                                     ctx->lookup_threads))) {
+            flux_log_error (h, "lookup_pool_create");
+            goto done;
+        }
+    }
     if (flux_msg_handler_addvec (h, htab, ctx, &handlers) < 0) {
         flux_log_error (h, "flux_msg_handler_addvec");
         goto done;
@@ -2987,6 +3239,11 @@ int mod_main (flux_t *h, int argc, char **argv)
     }
     rc = 0;
 done:
+    if (ctx && ctx->lookup_pool) {
+        struct lookup_pool *lp = ctx->lookup_pool;
+        ctx->lookup_pool = NULL;
+        lookup_pool_destroy (lp);
+    }
     flux_msg_handler_delvec (handlers);
     return rc;
 }
@@ -51,6 +51,7 @@ struct kvstxn {
     int blocked:1;
     json_t *ops;
     json_t *keys;
+    json_t *link_keys;  /* keys written through symlinks, as resolved */
     json_t *names;
     int flags;
     json_t *rootcpy;   /* working copy of root dir */
@@ -74,6 +75,7 @@ static void kvstxn_destroy (kvstxn_t *kt)
     if (kt) {
         json_decref (kt->ops);
         json_decref (kt->keys);
+        json_decref (kt->link_keys);
         json_decref (kt->names);
         json_decref (kt->rootcpy);
         if (kt->missing_refs_list)
@@ -103,6 +105,8 @@ static kvstxn_t *kvstxn_create (kvstxn_mgr_t *ktm,
     }
     if (!(kt->names = json_array ()))
         goto error_enomem;
+    if (!(kt->link_keys = json_array ()))
+        goto error_enomem;
     if (name) {
         json_t *s;
         if (!(s = json_string (name)))
@@ -188,6 +192,13 @@ json_t *kvstxn_get_keys (kvstxn_t *kt)
     return NULL;
 }
 
+json_t *kvstxn_get_link_keys (kvstxn_t *kt)
+{
+    if (kt->state == KVSTXN_STATE_FINISHED)
+        return kt->link_keys;
+    return NULL;
+}
+
 /* On error we should cleanup anything on the dirty cache list
  * that has not yet been passed to the user.  Because this has not
  * been passed to the user, there should be no waiters and the
@@ -537,6 +548,39 @@ static int kvstxn_append (kvstxn_t *kt, int current_epoch, json_t *dirent,
     return 0;
 }
 
+/* normalize key for setroot, and add it to keys array, if unique */
+static int normalize_and_append_unique (json_t *keys, const char *key)
+{
+    char *key_norm;
+    size_t index;
+    json_t *value;
+    bool unique = true;
+
+    if ((key_norm = kvs_util_normalize_key (key, NULL)) == NULL)
+        return -1;
+    json_array_foreach (keys, index, value) {
+        const char *s = json_string_value (value);
+        if (s && !strcmp (s, key_norm)) {
+            unique = false;
+            break;
+        }
+    }
+    if (unique) {
+        json_t *o;
+        if (!(o = json_string (key_norm)))
+            goto error;
+        if (json_array_append_new (keys, o) < 0) {
+            json_decref (o);
+            goto error;
+        }
+    }
+    free (key_norm);
+    return 0;
+error:
+    free (key_norm);
+    return -1;
+}
+
 /* link (key, dirent) into directory 'dir'.
  */
 static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
@@ -658,6 +702,11 @@ static int kvstxn_link_dirent (kvstxn_t *kt, int current_epoch,
                 saved_errno = ENOMEM;
                 goto done;
             }
+            if (normalize_and_append_unique (kt->link_keys, nkey) < 0) {
+                saved_errno = ENOMEM;
+                free (nkey);
+                goto done;
+            }
             if (kvstxn_link_dirent (kt,
                                     current_epoch,
                                     rootdir,
@@ -749,39 +798,6 @@ err:
     return -1;
 }
 
-/* normalize key for setroot, and add it to keys array, if unique */
-static int normalize_and_append_unique (json_t *keys, const char *key)
-{
-    char *key_norm;
-    size_t index;
-    json_t *value;
-    bool unique = true;
-
-    if ((key_norm = kvs_util_normalize_key (key, NULL)) == NULL)
-        return -1;
-    json_array_foreach (keys, index, value) {
-        const char *s = json_string_value (value);
-        if (s && !strcmp (s, key_norm)) {
-            unique = false;
-            break;
-        }
-    }
-    if (unique) {
-        json_t *o;
-        if (!(o = json_string (key_norm)))
-            goto error;
-        if (json_array_append_new (keys, o) < 0) {
-            json_decref (o);
-            goto error;
-        }
-    }
-    free (key_norm);
-    return 0;
-error:
-    free (key_norm);
-    return -1;
-}
-
 /* Create array of keys (strings) from array of operations ({ "key":s ... })
  * The keys array is for inclusion in the kvs.setroot event, so we can
  * notify watchers of keys that their key may have changed.
@@ -74,6 +74,12 @@ const char *kvstxn_get_newroot_ref (kvstxn_t *kt);
  * (i.e. kvstxn_process() returns KVSTXN_PROCESS_FINISHED) */
 json_t *kvstxn_get_keys (kvstxn_t *kt);
 
+/* Keys written through symlinks, as resolved, e.g. "a.b" for a write
+ * to "link.b" where "link" points to "a".  Normalized, may be empty.
+ * returns non-NULL only if process state complete
+ * (i.e. kvstxn_process() returns KVSTXN_PROCESS_FINISHED) */
+json_t *kvstxn_get_link_keys (kvstxn_t *kt);
+
 /* Primary transaction processing function.
  *
  * Pass in a kvstxn_t that was obtained via
@@ -12,6 +12,7 @@
 #include "config.h"
 #endif
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -28,6 +29,7 @@
 
 #include "cache.h"
 #include "kvsroot.h"
+#include "pathcache.h"
 
 #include "lookup.h"
 
@@ -65,16 +67,19 @@ struct lookup {
 
     int flags;
 
+    struct pathcache *pathcache;
+
     void *aux;
 
     /* potential return values from lookup */
     json_t *val;           /* value of lookup */
 
     /* if valref_missing_refs is true, iterate on refs, else
-     * return missing_ref string.
+     * return missing_ref string.  Both are copies, as the cache entries
+     * they were found in may expire before the caller gets to them.
      */
-    const json_t *valref_missing_refs;
-    const char *missing_ref;
+    json_t *valref_missing_refs;
+    char *missing_ref;
 
     /* for namespace callback */
 
@@ -83,9 +88,20 @@ struct lookup {
     int errnum;                 /* errnum if error */
     int aux_errnum;
 
+    /* lookup_prepare() / lookup_shared() */
+    bool prepared;              /* namespace checked for this pass */
+    bool shared;                /* running in a lookup thread */
+    struct cache_entry **held;  /* entries referenced in this pass */
+    int held_count;
+    int held_size;
+    char *deferred_log;         /* error to log from the main thread */
+
     /* API internal */
     zlist_t *levels;
     const json_t *wdirent;       /* result after walk() */
+    json_t *cached_wdirent;      /* wdirent from pathcache */
+    bool walk_cached;            /* walk result came from pathcache */
+    bool walk_symlink;           /* walk traversed a symlink */
     enum {
         LOOKUP_STATE_INIT,
         LOOKUP_STATE_CHECK_NAMESPACE,
@@ -102,6 +118,82 @@ static bool last_pathcomp (zlist_t *pathcomps, const void *data)
     return (zlist_tail (pathcomps) == data);
 }
 
+/* flux_t handles are not thread safe, so in a lookup thread, hold the
+ * (first) error message for lookup_flush_log().
+ */
+static void lookup_log_err (lookup_t *lh, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start (ap, fmt);
+    if (!lh->shared)
+        flux_vlog (lh->h, LOG_ERR, fmt, ap);
+    else if (!lh->deferred_log) {
+        if (vasprintf (&lh->deferred_log, fmt, ap) < 0)
+            lh->deferred_log = NULL;
+    }
+    va_end (ap);
+}
+
+/* Look up 'ref' in the cache, setting (*entryp) to NULL if not found.
+ * In a lookup thread, take a reference on the entry until the end of
+ * lookup_shared(), as the main thread may expire it meanwhile.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+static int lookup_cache_entry (lookup_t *lh, const char *ref,
+                               struct cache_entry **entryp)
+{
+    struct cache_entry *entry;
+
+    if (!lh->shared) {
+        (*entryp) = cache_lookup (lh->cache, ref, lh->current_epoch);
+        return 0;
+    }
+    if (lh->held_count == lh->held_size) {
+        int new_size = lh->held_size ? lh->held_size * 2 : 8;
+        struct cache_entry **new_held;
+
+        if (!(new_held = realloc (lh->held, new_size * sizeof (*new_held))))
+            return -1;
+        lh->held = new_held;
+        lh->held_size = new_size;
+    }
+    if ((entry = cache_lookup_shared (lh->cache, ref, lh->current_epoch)))
+        lh->held[lh->held_count++] = entry;
+    (*entryp) = entry;
+    return 0;
+}
+
+static void lookup_release_entries (lookup_t *lh)
+{
+    while (lh->held_count > 0)
+        cache_entry_decref (lh->held[--lh->held_count]);
+}
+
+static int set_missing_ref (lookup_t *lh, const char *ref)
+{
+    char *cpy;
+
+    if (!(cpy = strdup (ref)))
+        return -1;
+    free (lh->missing_ref);
+    lh->missing_ref = cpy;
+    json_decref (lh->valref_missing_refs);
+    lh->valref_missing_refs = NULL;
+    return 0;
+}
+
+static int set_valref_missing_refs (lookup_t *lh, const json_t *valref)
+{
+    json_t *cpy;
+
+    if (!(cpy = treeobj_deep_copy (valref)))
+        return -1;
+    json_decref (lh->valref_missing_refs);
+    lh->valref_missing_refs = cpy;
+    return 0;
+}
+
 /* Create list of path components, i.e. in path "a.b.c", create list
  * of "a", "b", and "c".
  */
@@ -223,6 +315,10 @@ static lookup_process_t symlink_check_namespace (lookup_t *lh,
     struct kvsroot *root = NULL;
     lookup_process_t ret = LOOKUP_PROCESS_ERROR;
 
+    /* namespaces may change under a lookup thread */
+    if (lh->shared)
+        return LOOKUP_PROCESS_YIELD;
+
     root = kvsroot_mgr_lookup_root (lh->krm, ns);
 
     if (!root) {
@@ -370,7 +466,7 @@ static lookup_process_t walk (lookup_t *lh)
             }
 
             if (refcount != 1) {
-                flux_log (lh->h, LOG_ERR, "invalid dirref count: %d", refcount);
+                lookup_log_err (lh, "invalid dirref count: %d", refcount);
                 lh->errnum = ENOTRECOVERABLE;
                 goto error;
             }
@@ -380,16 +476,22 @@ static lookup_process_t walk (lookup_t *lh)
                 goto error;
             }
 
-            if (!(entry = cache_lookup (lh->cache, refstr, lh->current_epoch))
-                || !cache_entry_get_valid (entry)) {
-                lh->missing_ref = refstr;
+            if (lookup_cache_entry (lh, refstr, &entry) < 0) {
+                lh->errnum = errno;
+                goto error;
+            }
+            if (!cache_entry_get_valid (entry)) {
+                if (set_missing_ref (lh, refstr) < 0) {
+                    lh->errnum = errno;
+                    goto error;
+                }
                 return LOOKUP_PROCESS_LOAD_MISSING_REFS;
             }
             if (!(dir = cache_entry_get_treeobj (entry))) {
                 /* dirref pointed to non treeobj error, special case when
                  * root_dirent is bad, is EINVAL from user.
                  */
-                flux_log (lh->h, LOG_ERR, "dirref points to non-treeobj");
+                lookup_log_err (lh, "dirref points to non-treeobj");
                 if (wl->depth == 0 && wl->dirent == wl->root_dirent)
                     lh->errnum = EINVAL;
                 else
@@ -416,11 +518,12 @@ static lookup_process_t walk (lookup_t *lh)
             }
             else {
                 char *s = json_dumps (wl->dirent, JSON_ENCODE_ANY);
-                flux_log (lh->h, LOG_ERR,
-                          "%s: unknown/unexpected dirent type: "
-                          "lh->path=%s pathcomp=%s wl->dirent(ptr)=%p "
-                          "wl->dirent(str)=%s",
-                          __FUNCTION__, lh->path, pathcomp, wl->dirent, s);
+                lookup_log_err (lh,
+                                "%s: unknown/unexpected dirent type: "
+                                "lh->path=%s pathcomp=%s wl->dirent(ptr)=%p "
+                                "wl->dirent(str)=%s",
+                                __FUNCTION__, lh->path, pathcomp, wl->dirent,
+                                s);
                 free (s);
                 lh->errnum = ENOTRECOVERABLE;
                 goto error;
@@ -447,11 +550,15 @@ static lookup_process_t walk (lookup_t *lh)
             walk_level_t *wltmp = NULL;
             lookup_process_t sret;
 
+            lh->walk_symlink = true;
+
             sret = walk_symlink (lh, wl, dirent_tmp, pathcomp, &wltmp);
             if (sret == LOOKUP_PROCESS_ERROR)
                 goto error;
             else if (sret == LOOKUP_PROCESS_LOAD_MISSING_NAMESPACE)
                 return LOOKUP_PROCESS_LOAD_MISSING_NAMESPACE;
+            else if (sret == LOOKUP_PROCESS_YIELD)
+                return LOOKUP_PROCESS_YIELD;
             /* else sret == LOOKUP_PROCESS_FINISHED */
 
             if (wltmp) {
@@ -588,7 +695,13 @@ void lookup_destroy (lookup_t *lh)
         free (lh->root_ref);
         free (lh->path);
         json_decref (lh->val);
+        json_decref (lh->valref_missing_refs);
+        json_decref (lh->cached_wdirent);
+        free (lh->missing_ref);
         free (lh->missing_namespace);
+        lookup_release_entries (lh);
+        free (lh->held);
+        free (lh->deferred_log);
         zlist_destroy (&lh->levels);
         free (lh);
     }
@@ -716,6 +829,13 @@ int lookup_get_root_seq (lookup_t *lh)
     return -1;
 }
 
+bool lookup_get_walked_symlink (lookup_t *lh)
+{
+    if (lh && lh->state == LOOKUP_STATE_FINISHED)
+        return lh->walk_symlink;
+    return false;
+}
+
 int lookup_set_current_epoch (lookup_t *lh, int epoch)
 {
     if (lh) {
@@ -725,12 +845,22 @@ int lookup_set_current_epoch (lookup_t *lh, int epoch)
     return -1;
 }
 
+int lookup_set_pathcache (lookup_t *lh, struct pathcache *pc)
+{
+    if (lh) {
+        lh->pathcache = pc;
+        return 0;
+    }
+    return -1;
+}
+
 static int namespace_still_valid (lookup_t *lh)
 {
     struct kvsroot *root;
 
-    /* If user set root_ref, no need to do this check */
-    if (lh->root_ref_set_by_user)
+    /* If user set root_ref, or lookup_prepare() already checked,
+     * no need to do this check */
+    if (lh->root_ref_set_by_user || lh->prepared)
         return 0;
 
     if (!(root = kvsroot_mgr_lookup_root_safe (lh->krm, lh->ns_name))) {
@@ -765,14 +895,20 @@ static int get_single_blobref_valref_value (lookup_t *lh, bool *stall)
         lh->errnum = errno;
         return -1;
     }
-    if (!(entry = cache_lookup (lh->cache, reftmp, lh->current_epoch))
-        || !cache_entry_get_valid (entry)) {
-        lh->valref_missing_refs = lh->wdirent;
+    if (lookup_cache_entry (lh, reftmp, &entry) < 0) {
+        lh->errnum = errno;
+        return -1;
+    }
+    if (!cache_entry_get_valid (entry)) {
+        if (set_valref_missing_refs (lh, lh->wdirent) < 0) {
+            lh->errnum = errno;
+            return -1;
+        }
         (*stall) = true;
         return 0;
     }
     if (cache_entry_get_raw (entry, &valdata, &len) < 0) {
-        flux_log (lh->h, LOG_ERR, "cache_entry_get_raw");
+        lookup_log_err (lh, "cache_entry_get_raw");
         lh->errnum = ENOTRECOVERABLE;
         return -1;
     }
@@ -798,15 +934,21 @@ static int get_multi_blobref_valref_length (lookup_t *lh, int refcount,
             lh->errnum = errno;
             return -1;
         }
-        if (!(entry = cache_lookup (lh->cache, reftmp, lh->current_epoch))
-            || !cache_entry_get_valid (entry)) {
-            lh->valref_missing_refs = lh->wdirent;
+        if (lookup_cache_entry (lh, reftmp, &entry) < 0) {
+            lh->errnum = errno;
+            return -1;
+        }
+        if (!cache_entry_get_valid (entry)) {
+            if (set_valref_missing_refs (lh, lh->wdirent) < 0) {
+                lh->errnum = errno;
+                return -1;
+            }
             (*stall) = true;
             return 0;
         }
 
         if (cache_entry_get_raw (entry, NULL, &len) < 0) {
-            flux_log (lh->h, LOG_ERR, "cache_entry_get_raw");
+            lookup_log_err (lh, "cache_entry_get_raw");
             lh->errnum = ENOTRECOVERABLE;
             return -1;
         }
@@ -849,7 +991,11 @@ static char *get_multi_blobref_valref_data (lookup_t *lh, int refcount,
         reftmp = treeobj_get_blobref (lh->wdirent, i);
         assert (reftmp);
 
-        entry = cache_lookup (lh->cache, reftmp, lh->current_epoch);
+        if (lookup_cache_entry (lh, reftmp, &entry) < 0) {
+            lh->errnum = errno;
+            free (valbuf);
+            return NULL;
+        }
         assert (entry);
         assert (cache_entry_get_valid (entry));
 
@@ -896,7 +1042,7 @@ done:
     return rc;
 }
 
-lookup_process_t lookup (lookup_t *lh)
+static lookup_process_t lookup_process (lookup_t *lh)
 {
     const json_t *valtmp = NULL;
     const char *reftmp;
@@ -977,16 +1123,19 @@ lookup_process_t lookup (lookup_t *lh)
                         lh->errnum = EISDIR;
                         goto error;
                     }
-                    if (!(entry = cache_lookup (lh->cache,
-                                                lh->root_ref,
-                                                lh->current_epoch))
-                        || !cache_entry_get_valid (entry)) {
-                        lh->missing_ref = lh->root_ref;
+                    if (lookup_cache_entry (lh, lh->root_ref, &entry) < 0) {
+                        lh->errnum = errno;
+                        goto error;
+                    }
+                    if (!cache_entry_get_valid (entry)) {
+                        if (set_missing_ref (lh, lh->root_ref) < 0) {
+                            lh->errnum = errno;
+                            goto error;
+                        }
                         return LOOKUP_PROCESS_LOAD_MISSING_REFS;
                     }
                     if (!(valtmp = cache_entry_get_treeobj (entry))) {
-                        flux_log (lh->h, LOG_ERR,
-                                  "root_ref points to non-treeobj");
+                        lookup_log_err (lh, "root_ref points to non-treeobj");
                         lh->errnum = EINVAL;
                         goto error;
                     }
@@ -1006,9 +1155,19 @@ lookup_process_t lookup (lookup_t *lh)
             lh->state = LOOKUP_STATE_WALK_INIT;
             /* fallthrough */
         case LOOKUP_STATE_WALK_INIT:
+            /* skip the walk if the path was resolved from this root
+             * before */
+            if (pathcache_lookup (lh->pathcache,
+                                  lh->ns_name,
+                                  lh->root_ref,
+                                  lh->path,
+                                  lh->current_epoch,
+                                  &lh->cached_wdirent)) {
+                lh->wdirent = lh->cached_wdirent;
+                lh->walk_cached = true;
+            }
             /* initialize walk - first depth is level 0 */
-
-            if (!walk_levels_push (lh, lh->root_ref, lh->path, 0)) {
+            else if (!walk_levels_push (lh, lh->root_ref, lh->path, 0)) {
                 lh->errnum = errno;
                 goto error;
             }
@@ -1024,7 +1183,16 @@ lookup_process_t lookup (lookup_t *lh)
                     goto error;
             }
 
-            lret = walk (lh);
+            if (lh->walk_cached)
+                lret = LOOKUP_PROCESS_FINISHED;
+            else if ((lret = walk (lh)) == LOOKUP_PROCESS_FINISHED
+                     && !lh->walk_symlink)
+                pathcache_insert (lh->pathcache,
+                                  lh->ns_name,
+                                  lh->root_ref,
+                                  lh->path,
+                                  lh->current_epoch,
+                                  lh->wdirent);
 
             if (lret == LOOKUP_PROCESS_ERROR)
                 goto error;
@@ -1032,6 +1200,8 @@ lookup_process_t lookup (lookup_t *lh)
                 return LOOKUP_PROCESS_LOAD_MISSING_NAMESPACE;
             else if (lret == LOOKUP_PROCESS_LOAD_MISSING_REFS)
                 return LOOKUP_PROCESS_LOAD_MISSING_REFS;
+            else if (lret == LOOKUP_PROCESS_YIELD)
+                return LOOKUP_PROCESS_YIELD;
             else if (!lh->wdirent) {
                 //lh->errnum = ENOENT;
                 goto done; /* a NULL response is not necessarily an error */
@@ -1068,8 +1238,7 @@ lookup_process_t lookup (lookup_t *lh)
                     goto error;
                 }
                 if (refcount != 1) {
-                    flux_log (lh->h, LOG_ERR, "invalid dirref count: %d",
-                              refcount);
+                    lookup_log_err (lh, "invalid dirref count: %d", refcount);
                     lh->errnum = ENOTRECOVERABLE;
                     goto error;
                 }
@@ -1077,14 +1246,19 @@ lookup_process_t lookup (lookup_t *lh)
                     lh->errnum = errno;
                     goto error;
                 }
-                if (!(entry = cache_lookup (lh->cache, reftmp,
-                                            lh->current_epoch))
-                    || !cache_entry_get_valid (entry)) {
-                    lh->missing_ref = reftmp;
+                if (lookup_cache_entry (lh, reftmp, &entry) < 0) {
+                    lh->errnum = errno;
+                    goto error;
+                }
+                if (!cache_entry_get_valid (entry)) {
+                    if (set_missing_ref (lh, reftmp) < 0) {
+                        lh->errnum = errno;
+                        goto error;
+                    }
                     return LOOKUP_PROCESS_LOAD_MISSING_REFS;
                 }
                 if (!(valtmp = cache_entry_get_treeobj (entry))) {
-                    flux_log (lh->h, LOG_ERR, "dirref points to non-treeobj");
+                    lookup_log_err (lh, "dirref points to non-treeobj");
                     lh->errnum = ENOTRECOVERABLE;
                     goto error;
                 }
@@ -1113,8 +1287,7 @@ lookup_process_t lookup (lookup_t *lh)
                     goto error;
                 }
                 if (!refcount) {
-                    flux_log (lh->h, LOG_ERR, "invalid valref count: %d",
-                              refcount);
+                    lookup_log_err (lh, "invalid valref count: %d", refcount);
                     lh->errnum = ENOTRECOVERABLE;
                     goto error;
                 }
@@ -1174,8 +1347,8 @@ lookup_process_t lookup (lookup_t *lh)
                 }
             } else {
                 char *s = json_dumps (lh->wdirent, JSON_ENCODE_ANY);
-                flux_log (lh->h, LOG_ERR, "%s: corrupt dirent: %p, %s",
-                          __FUNCTION__, lh->wdirent, s);
+                lookup_log_err (lh, "%s: corrupt dirent: %p, %s",
+                                __FUNCTION__, lh->wdirent, s);
                 free (s);
                 lh->errnum = ENOTRECOVERABLE;
                 goto error;
@@ -1185,8 +1358,8 @@ lookup_process_t lookup (lookup_t *lh)
         case LOOKUP_STATE_FINISHED:
             break;
         default:
-            flux_log (lh->h, LOG_ERR, "%s: invalid state %d",
-                      __FUNCTION__, lh->state);
+            lookup_log_err (lh, "%s: invalid state %d",
+                            __FUNCTION__, lh->state);
             lh->errnum = ENOTRECOVERABLE;
             goto error;
     }
@@ -1200,6 +1373,87 @@ error:
     return LOOKUP_PROCESS_ERROR;
 }
 
+lookup_process_t lookup (lookup_t *lh)
+{
+    lookup_process_t ret;
+
+    if (!lh) {
+        errno = EINVAL;
+        return LOOKUP_PROCESS_ERROR;
+    }
+    ret = lookup_process (lh);
+    lh->prepared = false;
+    return ret;
+}
+
+int lookup_prepare (lookup_t *lh)
+{
+    struct kvsroot *root;
+
+    if (!lh) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (lh->errnum)
+        return -1;
+    switch (lh->state) {
+        case LOOKUP_STATE_INIT:
+        case LOOKUP_STATE_CHECK_NAMESPACE:
+        case LOOKUP_STATE_CHECK_ROOT:
+        case LOOKUP_STATE_WALK:
+        case LOOKUP_STATE_VALUE:
+            break;
+        default:
+            return -1;
+    }
+    /* Leave missing namespaces and permission errors to lookup(),
+     * which knows how to report them.
+     */
+    if (!lh->root_ref_set_by_user) {
+        if (!(root = kvsroot_mgr_lookup_root_safe (lh->krm, lh->ns_name))
+            || kvsroot_check_user (lh->krm,
+                                   root,
+                                   lh->rolemask,
+                                   lh->userid) < 0)
+            return -1;
+        if (!lh->root_ref) {
+            if (!(lh->root_ref = strdup (root->ref)))
+                return -1;
+            lh->root_seq = root->seq;
+        }
+    }
+    if (lh->state == LOOKUP_STATE_INIT
+        || lh->state == LOOKUP_STATE_CHECK_NAMESPACE)
+        lh->state = LOOKUP_STATE_CHECK_ROOT;
+    lh->prepared = true;
+    return 0;
+}
+
+lookup_process_t lookup_shared (lookup_t *lh)
+{
+    lookup_process_t ret;
+
+    if (!lh || !lh->prepared) {
+        errno = EINVAL;
+        return LOOKUP_PROCESS_ERROR;
+    }
+    lh->shared = true;
+    ret = lookup_process (lh);
+    lh->shared = false;
+    lh->prepared = false;
+    lookup_release_entries (lh);
+    return ret;
+}
+
+void lookup_flush_log (lookup_t *lh)
+{
+    if (lh && lh->deferred_log) {
+        flux_log (lh->h, LOG_ERR, "%s", lh->deferred_log);
+        free (lh->deferred_log);
+        lh->deferred_log = NULL;
+    }
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
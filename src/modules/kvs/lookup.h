@@ -14,6 +14,7 @@
 #include <flux/core.h>
 #include "cache.h"
 #include "kvsroot.h"
+#include "pathcache.h"
 
 typedef struct lookup lookup_t;
 
@@ -22,6 +23,7 @@ typedef enum {
     LOOKUP_PROCESS_LOAD_MISSING_NAMESPACE = 2,
     LOOKUP_PROCESS_LOAD_MISSING_REFS = 3,
     LOOKUP_PROCESS_FINISHED = 4,
+    LOOKUP_PROCESS_YIELD = 5,
 } lookup_process_t;
 
 /* ref - missing reference
@@ -103,10 +105,21 @@ const char *lookup_get_namespace (lookup_t *lh);
 const char *lookup_get_root_ref (lookup_t *lh);
 int lookup_get_root_seq (lookup_t *lh);
 
+/* Returns true if the lookup walked through a symlink, i.e. the
+ * result may change without the looked up key being written.  Not
+ * valid unless the lookup completes (LOOKUP_PROCESS_FINISHED).
+ */
+bool lookup_get_walked_symlink (lookup_t *lh);
+
 /* Set a new current epoch.  Convenience on RPC replays and epoch may
  * be new */
 int lookup_set_current_epoch (lookup_t *lh, int epoch);
 
+/* Resolve paths through 'pc', and add new resolutions to it.
+ * Optional, NULL by default.
+ */
+int lookup_set_pathcache (lookup_t *lh, struct pathcache *pc);
+
 /* Lookup the key path in the KVS cache starting at root.
  *
  * Returns LOOKUP_PROCESS_ERROR on error,
@@ -132,6 +145,22 @@ int lookup_set_current_epoch (lookup_t *lh, int epoch);
  */
 lookup_process_t lookup (lookup_t *lh);
 
+/* Lookups may be run in a thread other than the one that owns the
+ * cache and kvsroot_mgr_t, but only after lookup_prepare() has checked
+ * the namespace from the owning thread.  lookup_prepare() returns 0 if
+ * lookup_shared() may be called next, or -1 if the lookup should be
+ * run with lookup() instead, e.g. so it can report a missing namespace.
+ *
+ * lookup_shared() returns the same values as lookup(), plus
+ * LOOKUP_PROCESS_YIELD if the lookup needs another namespace, in which
+ * case it should be continued with lookup() in the owning thread.
+ * Errors are not logged by lookup_shared().  The owning thread should
+ * call lookup_flush_log() afterwards to log them.
+ */
+int lookup_prepare (lookup_t *lh);
+lookup_process_t lookup_shared (lookup_t *lh);
+void lookup_flush_log (lookup_t *lh);
+
 #endif /* !_FLUX_KVS_LOOKUP_H */
 
 /*
@@ -0,0 +1,182 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* Pool threads take jobs from a FIFO under 'lock', run them, and
+ * hand them back to the reactor thread on a lock-free queue whose
+ * eventfd is watched by the reactor.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/mpscq.h"
+
+#include "lookup_pool.h"
+
+struct lookup_job {
+    lookup_t *lh;
+    lookup_process_t ret;
+    lookup_pool_f cb;
+    void *arg;
+    struct lookup_job *next;
+};
+
+struct lookup_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct lookup_job *head;
+    struct lookup_job *tail;
+    bool shutdown;
+    pthread_t *threads;
+    int nthreads;               /* threads successfully started */
+    mpscq_t *done;
+    flux_watcher_t *w;
+};
+
+static void *lookup_thread (void *arg)
+{
+    struct lookup_pool *lp = arg;
+    struct lookup_job *job;
+
+    for (;;) {
+        pthread_mutex_lock (&lp->lock);
+        while (!lp->head && !lp->shutdown)
+            pthread_cond_wait (&lp->cond, &lp->lock);
+        if (!(job = lp->head)) {
+            pthread_mutex_unlock (&lp->lock);
+            break;
+        }
+        if (!(lp->head = job->next))
+            lp->tail = NULL;
+        pthread_mutex_unlock (&lp->lock);
+
+        job->ret = lookup_shared (job->lh);
+
+        /* mpscq_push() only fails if out of memory, so keep trying */
+        while (mpscq_push (lp->done, job) < 0)
+            sched_yield ();
+    }
+    return NULL;
+}
+
+static void deliver_completions (struct lookup_pool *lp)
+{
+    struct lookup_job *job;
+
+    while ((job = mpscq_pop (lp->done))) {
+        job->cb (job->lh, job->ret, job->arg);
+        free (job);
+    }
+}
+
+static void done_cb (flux_reactor_t *r, flux_watcher_t *w,
+                     int revents, void *arg)
+{
+    struct lookup_pool *lp = arg;
+
+    deliver_completions (lp);
+    (void)mpscq_pollevents (lp->done);
+}
+
+void lookup_pool_destroy (struct lookup_pool *lp)
+{
+    if (lp) {
+        int saved_errno = errno;
+        int i;
+
+        pthread_mutex_lock (&lp->lock);
+        lp->shutdown = true;
+        pthread_cond_broadcast (&lp->cond);
+        pthread_mutex_unlock (&lp->lock);
+        for (i = 0; i < lp->nthreads; i++)
+            pthread_join (lp->threads[i], NULL);
+        free (lp->threads);
+        flux_watcher_destroy (lp->w);
+        if (lp->done) {
+            deliver_completions (lp);
+            mpscq_destroy (lp->done);
+        }
+        pthread_cond_destroy (&lp->cond);
+        pthread_mutex_destroy (&lp->lock);
+        free (lp);
+        errno = saved_errno;
+    }
+}
+
+struct lookup_pool *lookup_pool_create (flux_reactor_t *r, int nthreads)
+{
+    struct lookup_pool *lp;
+    int e;
+
+    if (!r || nthreads <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(lp = calloc (1, sizeof (*lp))))
+        return NULL;
+    pthread_mutex_init (&lp->lock, NULL);
+    pthread_cond_init (&lp->cond, NULL);
+    if (!(lp->done = mpscq_create (NULL)))
+        goto error;
+    if (!(lp->w = flux_fd_watcher_create (r, mpscq_pollfd (lp->done),
+                                          FLUX_POLLIN, done_cb, lp)))
+        goto error;
+    flux_watcher_start (lp->w);
+    if (!(lp->threads = calloc (nthreads, sizeof (lp->threads[0]))))
+        goto error;
+    while (lp->nthreads < nthreads) {
+        if ((e = pthread_create (&lp->threads[lp->nthreads], NULL,
+                                 lookup_thread, lp))) {
+            errno = e;
+            goto error;
+        }
+        lp->nthreads++;
+    }
+    return lp;
+error:
+    lookup_pool_destroy (lp);
+    return NULL;
+}
+
+int lookup_pool_submit (struct lookup_pool *lp, lookup_t *lh,
+                        lookup_pool_f cb, void *arg)
+{
+    struct lookup_job *job;
+
+    if (!lp || !lh || !cb) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(job = calloc (1, sizeof (*job))))
+        return -1;
+    job->lh = lh;
+    job->cb = cb;
+    job->arg = arg;
+    pthread_mutex_lock (&lp->lock);
+    if (lp->tail)
+        lp->tail->next = job;
+    else
+        lp->head = job;
+    lp->tail = job;
+    pthread_cond_signal (&lp->cond);
+    pthread_mutex_unlock (&lp->lock);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
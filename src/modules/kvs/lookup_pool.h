@@ -0,0 +1,52 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_KVS_LOOKUP_POOL_H
+#define _FLUX_KVS_LOOKUP_POOL_H
+
+#include <flux/core.h>
+#include "lookup.h"
+
+/* A pool of threads that run lookup_shared() against the cache, so
+ * lookups of cached data proceed in parallel with each other and with
+ * the reactor.  The pool is created, fed, and destroyed by the thread
+ * that owns the cache, and completions are delivered to that thread
+ * through a reactor watcher.
+ */
+
+struct lookup_pool;
+
+/* Called in the reactor thread with the result of lookup_shared().
+ */
+typedef void (*lookup_pool_f)(lookup_t *lh, lookup_process_t ret, void *arg);
+
+/* Create pool of 'nthreads' threads, delivering completions via 'r'.
+ * Returns pool on success, NULL on error with errno set.
+ */
+struct lookup_pool *lookup_pool_create (flux_reactor_t *r, int nthreads);
+
+/* Stop the threads after they finish queued lookups, and call
+ * the callbacks of any completed lookups not yet delivered.
+ */
+void lookup_pool_destroy (struct lookup_pool *lp);
+
+/* Run lookup_shared() on 'lh' in a pool thread, then call 'cb'.
+ * lookup_prepare() must have returned 0 for 'lh'.  'lh' should not
+ * be touched until 'cb' is called.
+ * Returns 0 on success, -1 on error with errno set.
+ */
+int lookup_pool_submit (struct lookup_pool *lp, lookup_t *lh,
+                        lookup_pool_f cb, void *arg);
+
+#endif /* !_FLUX_KVS_LOOKUP_POOL_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,336 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <errno.h>
+#include <czmq.h>
+#include <jansson.h>
+
+#include "src/common/libkvs/treeobj.h"
+#include "src/common/libkvs/kvs_util_private.h"
+
+#include "pathcache.h"
+
+struct pathcache_entry {
+    json_t *dirent;             /* NULL if key does not exist */
+    int lastuse_epoch;
+};
+
+struct pathcache_ns {
+    char *root_ref;             /* entries are valid for this root only */
+    zhashx_t *entries;          /* key => struct pathcache_entry */
+};
+
+struct pathcache {
+    pthread_mutex_t lock;
+    zhashx_t *namespaces;       /* ns name => struct pathcache_ns */
+    int max_entries;
+    int count;
+    int hits;
+    int misses;
+};
+
+static void entry_destroy (void **item)
+{
+    if (item) {
+        struct pathcache_entry *e = *item;
+        if (e) {
+            json_decref (e->dirent);
+            free (e);
+        }
+        *item = NULL;
+    }
+}
+
+static void ns_destroy (void **item)
+{
+    if (item) {
+        struct pathcache_ns *pns = *item;
+        if (pns) {
+            zhashx_destroy (&pns->entries);
+            free (pns->root_ref);
+            free (pns);
+        }
+        *item = NULL;
+    }
+}
+
+static struct pathcache_ns *ns_create (void)
+{
+    struct pathcache_ns *pns;
+
+    if (!(pns = calloc (1, sizeof (*pns))))
+        return NULL;
+    if (!(pns->entries = zhashx_new ())) {
+        free (pns);
+        errno = ENOMEM;
+        return NULL;
+    }
+    zhashx_set_destructor (pns->entries, entry_destroy);
+    return pns;
+}
+
+/* Drop entries of 'pns' that conflict with 'keys', or all if NULL.
+ */
+static void ns_invalidate (struct pathcache *pc, struct pathcache_ns *pns,
+                           json_t *keys)
+{
+    zlistx_t *list;
+    const char *key;
+
+    if (keys && (list = zhashx_keys (pns->entries))) {
+        key = zlistx_first (list);
+        while (key) {
+            if (kvs_util_keys_conflict (key, keys)) {
+                zhashx_delete (pns->entries, key);
+                pc->count--;
+            }
+            key = zlistx_next (list);
+        }
+        zlistx_destroy (&list);
+    }
+    else {
+        pc->count -= zhashx_size (pns->entries);
+        zhashx_purge (pns->entries);
+    }
+}
+
+void pathcache_destroy (struct pathcache *pc)
+{
+    if (pc) {
+        int saved_errno = errno;
+        zhashx_destroy (&pc->namespaces);
+        pthread_mutex_destroy (&pc->lock);
+        free (pc);
+        errno = saved_errno;
+    }
+}
+
+struct pathcache *pathcache_create (int max_entries)
+{
+    struct pathcache *pc;
+
+    if (max_entries < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(pc = calloc (1, sizeof (*pc))))
+        return NULL;
+    pthread_mutex_init (&pc->lock, NULL);
+    if (!(pc->namespaces = zhashx_new ())) {
+        pathcache_destroy (pc);
+        errno = ENOMEM;
+        return NULL;
+    }
+    zhashx_set_destructor (pc->namespaces, ns_destroy);
+    pc->max_entries = max_entries;
+    return pc;
+}
+
+static struct pathcache_ns *ns_current (struct pathcache *pc,
+                                        const char *ns,
+                                        const char *root_ref)
+{
+    struct pathcache_ns *pns;
+
+    if (!ns || !root_ref
+        || !(pns = zhashx_lookup (pc->namespaces, ns))
+        || !pns->root_ref
+        || strcmp (pns->root_ref, root_ref) != 0)
+        return NULL;
+    return pns;
+}
+
+int pathcache_lookup (struct pathcache *pc,
+                      const char *ns,
+                      const char *root_ref,
+                      const char *key,
+                      int current_epoch,
+                      json_t **dirent)
+{
+    struct pathcache_ns *pns;
+    struct pathcache_entry *e = NULL;
+    json_t *cpy = NULL;
+
+    if (!pc || !key || !dirent)
+        return 0;
+    pthread_mutex_lock (&pc->lock);
+    if ((pns = ns_current (pc, ns, root_ref))
+        && (e = zhashx_lookup (pns->entries, key))) {
+        /* on failure to copy, treat as a miss */
+        if (e->dirent && !(cpy = treeobj_deep_copy (e->dirent)))
+            e = NULL;
+    }
+    if (e) {
+        e->lastuse_epoch = current_epoch;
+        pc->hits++;
+    }
+    else
+        pc->misses++;
+    pthread_mutex_unlock (&pc->lock);
+    if (!e)
+        return 0;
+    (*dirent) = cpy;
+    return 1;
+}
+
+void pathcache_insert (struct pathcache *pc,
+                       const char *ns,
+                       const char *root_ref,
+                       const char *key,
+                       int current_epoch,
+                       const json_t *dirent)
+{
+    struct pathcache_ns *pns;
+    struct pathcache_entry *e;
+
+    if (!pc || !key)
+        return;
+    if (!(e = calloc (1, sizeof (*e))))
+        return;
+    if (dirent && !(e->dirent = treeobj_deep_copy (dirent))) {
+        free (e);
+        return;
+    }
+    e->lastuse_epoch = current_epoch;
+    pthread_mutex_lock (&pc->lock);
+    if (!(pns = ns_current (pc, ns, root_ref))
+        || pc->count >= pc->max_entries
+        || zhashx_insert (pns->entries, key, e) < 0) {
+        pthread_mutex_unlock (&pc->lock);
+        json_decref (e->dirent);
+        free (e);
+        return;
+    }
+    pc->count++;
+    pthread_mutex_unlock (&pc->lock);
+}
+
+void pathcache_setroot (struct pathcache *pc,
+                        const char *ns,
+                        const char *prev_ref,
+                        const char *root_ref,
+                        json_t *keys)
+{
+    struct pathcache_ns *pns;
+    char *cpy;
+
+    if (!pc || !ns || !root_ref)
+        return;
+    pthread_mutex_lock (&pc->lock);
+    if (!(pns = zhashx_lookup (pc->namespaces, ns))) {
+        if (!(pns = ns_create ()))
+            goto done;
+        (void)zhashx_insert (pc->namespaces, ns, pns);
+    }
+    if (pns->root_ref && !strcmp (pns->root_ref, root_ref))
+        goto done;
+    if (!(cpy = strdup (root_ref))) {
+        zhashx_delete (pc->namespaces, ns);
+        goto done;
+    }
+    if (!pns->root_ref || !prev_ref || strcmp (pns->root_ref, prev_ref) != 0)
+        keys = NULL;
+    ns_invalidate (pc, pns, keys);
+    free (pns->root_ref);
+    pns->root_ref = cpy;
+done:
+    pthread_mutex_unlock (&pc->lock);
+}
+
+void pathcache_remove_namespace (struct pathcache *pc, const char *ns)
+{
+    struct pathcache_ns *pns;
+
+    if (!pc || !ns)
+        return;
+    pthread_mutex_lock (&pc->lock);
+    if ((pns = zhashx_lookup (pc->namespaces, ns))) {
+        pc->count -= zhashx_size (pns->entries);
+        zhashx_delete (pc->namespaces, ns);
+    }
+    pthread_mutex_unlock (&pc->lock);
+}
+
+int pathcache_expire_entries (struct pathcache *pc, int current_epoch,
+                              int thresh)
+{
+    struct pathcache_ns *pns;
+    int count = 0;
+
+    if (!pc)
+        return 0;
+    pthread_mutex_lock (&pc->lock);
+    pns = zhashx_first (pc->namespaces);
+    while (pns) {
+        zlistx_t *keys;
+        const char *key;
+
+        /* Do not use zhashx_first()/zhashx_next() on entries, as
+         * zhashx_delete() call below modifies hash */
+        if ((keys = zhashx_keys (pns->entries))) {
+            key = zlistx_first (keys);
+            while (key) {
+                struct pathcache_entry *e = zhashx_lookup (pns->entries, key);
+                if (e && (thresh == 0
+                          || current_epoch - e->lastuse_epoch > thresh)) {
+                    zhashx_delete (pns->entries, key);
+                    count++;
+                }
+                key = zlistx_next (keys);
+            }
+            zlistx_destroy (&keys);
+        }
+        pns = zhashx_next (pc->namespaces);
+    }
+    pc->count -= count;
+    pthread_mutex_unlock (&pc->lock);
+    return count;
+}
+
+void pathcache_get_stats (struct pathcache *pc, int *entries,
+                          int *hits, int *misses)
+{
+    int e = 0, h = 0, m = 0;
+
+    if (pc) {
+        pthread_mutex_lock (&pc->lock);
+        e = pc->count;
+        h = pc->hits;
+        m = pc->misses;
+        pthread_mutex_unlock (&pc->lock);
+    }
+    if (entries)
+        *entries = e;
+    if (hits)
+        *hits = h;
+    if (misses)
+        *misses = m;
+}
+
+void pathcache_clear_stats (struct pathcache *pc)
+{
+    if (pc) {
+        pthread_mutex_lock (&pc->lock);
+        pc->hits = 0;
+        pc->misses = 0;
+        pthread_mutex_unlock (&pc->lock);
+    }
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
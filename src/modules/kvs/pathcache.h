@@ -0,0 +1,89 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _FLUX_KVS_PATHCACHE_H
+#define _FLUX_KVS_PATHCACHE_H
+
+#include <jansson.h>
+
+/* Cache of path resolutions: (namespace, root ref, normalized key)
+ * to the dirent that walking the key from the root arrives at, or to
+ * "does not exist".  Each namespace holds entries for its current root
+ * only.  When the root moves, entries for keys that the change could
+ * not have affected are carried over to the new root.
+ *
+ * Only walks that do not traverse a symlink may be cached, since
+ * their result depends on keys other than the path itself.
+ *
+ * All functions are safe to call from lookup threads.
+ */
+
+struct pathcache;
+
+/* Create a path cache holding at most 'max_entries' entries.
+ * Returns cache on success, NULL on error with errno set.
+ */
+struct pathcache *pathcache_create (int max_entries);
+void pathcache_destroy (struct pathcache *pc);
+
+/* Look up 'key' walked from 'root_ref' in namespace 'ns'.
+ * Returns 1 on hit, with (*dirent) set to a copy of the resolved
+ * dirent that the caller must json_decref(), or NULL if the key does
+ * not exist.  Returns 0 on miss.
+ */
+int pathcache_lookup (struct pathcache *pc,
+                      const char *ns,
+                      const char *root_ref,
+                      const char *key,
+                      int current_epoch,
+                      json_t **dirent);
+
+/* Store the resolution of 'key' walked from 'root_ref' in namespace
+ * 'ns'.  'dirent' is copied, or NULL if the key does not exist.
+ * The entry is dropped if 'root_ref' is not the namespace's current
+ * root, or if the cache is full.
+ */
+void pathcache_insert (struct pathcache *pc,
+                       const char *ns,
+                       const char *root_ref,
+                       const char *key,
+                       int current_epoch,
+                       const json_t *dirent);
+
+/* Set the current root of namespace 'ns'.  'keys' is the array of
+ * normalized keys changed between 'prev_ref' and 'root_ref'.  If it
+ * is NULL, or 'prev_ref' is not the root the namespace's entries were
+ * stored for, all entries for the namespace are dropped.
+ */
+void pathcache_setroot (struct pathcache *pc,
+                        const char *ns,
+                        const char *prev_ref,
+                        const char *root_ref,
+                        json_t *keys);
+
+/* Drop all entries for namespace 'ns'.
+ */
+void pathcache_remove_namespace (struct pathcache *pc, const char *ns);
+
+/* Drop entries not used within the last 'thresh' epochs.
+ * Returns the number of entries dropped.
+ */
+int pathcache_expire_entries (struct pathcache *pc, int current_epoch,
+                              int thresh);
+
+void pathcache_get_stats (struct pathcache *pc, int *entries,
+                          int *hits, int *misses);
+void pathcache_clear_stats (struct pathcache *pc);
+
+#endif /* !_FLUX_KVS_PATHCACHE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
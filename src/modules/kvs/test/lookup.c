@@ -23,6 +23,7 @@
 #include "src/common/libkvs/kvs_util_private.h"
 #include "src/modules/kvs/cache.h"
 #include "src/modules/kvs/lookup.h"
+#include "src/modules/kvs/pathcache.h"
 #include "src/common/libutil/blobref.h"
 
 struct lookup_ref_data
@@ -3416,6 +3417,100 @@ void lookup_stall_namespace_removed (void) {
     json_decref (root);
 }
 
+static lookup_t *create_pathcache_lookup (struct cache *cache,
+                                          kvsroot_mgr_t *krm,
+                                          struct pathcache *pc,
+                                          const char *path)
+{
+    lookup_t *lh;
+
+    lh = lookup_create (cache,
+                        krm,
+                        1,
+                        KVS_PRIMARY_NAMESPACE,
+                        NULL,
+                        0,
+                        path,
+                        FLUX_ROLE_OWNER,
+                        0,
+                        0,
+                        NULL);
+    if (lh && lookup_set_pathcache (lh, pc) < 0) {
+        lookup_destroy (lh);
+        return NULL;
+    }
+    return lh;
+}
+
+/* lookups through a path cache return the same results as without */
+void lookup_pathcache (void)
+{
+    json_t *root;
+    json_t *dir;
+    json_t *test;
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    struct pathcache *pc;
+    lookup_t *lh;
+    char root_ref[BLOBREF_MAX_STRING_SIZE];
+    int entries, hits, misses;
+    int i;
+
+    ok ((cache = cache_create ()) != NULL,
+        "cache_create works");
+    ok ((krm = kvsroot_mgr_create (NULL, NULL)) != NULL,
+        "kvsroot_mgr_create works");
+    ok ((pc = pathcache_create (100)) != NULL,
+        "pathcache_create works");
+
+    /* This cache is
+     *
+     * root_ref
+     * "dir" : dir w/ "val" : val to "foo"
+     * "symlink" : symlink to "dir"
+     */
+
+    dir = treeobj_create_dir ();
+    _treeobj_insert_entry_val (dir, "val", "foo", 3);
+
+    root = treeobj_create_dir ();
+    treeobj_insert_entry (root, "dir", dir);
+    _treeobj_insert_entry_symlink (root, "symlink", NULL, "dir");
+    treeobj_hash ("sha1", root, root_ref, sizeof (root_ref));
+    (void)cache_insert (cache, create_cache_entry_treeobj (root_ref, root));
+
+    setup_kvsroot (krm, KVS_PRIMARY_NAMESPACE, cache, root_ref, 0);
+    pathcache_setroot (pc, KVS_PRIMARY_NAMESPACE, NULL, root_ref, NULL);
+
+    test = treeobj_create_val ("foo", 3);
+    for (i = 0; i < 2; i++) {
+        ok ((lh = create_pathcache_lookup (cache, krm, pc, "dir.val")) != NULL,
+            "lookup_create on path dir.val");
+        check_value (lh, test, "lookup dir.val");
+
+        ok ((lh = create_pathcache_lookup (cache, krm, pc, "dir.noexist")) != NULL,
+            "lookup_create on path dir.noexist");
+        check_value (lh, NULL, "lookup dir.noexist");
+
+        ok ((lh = create_pathcache_lookup (cache, krm, pc, "symlink.val")) != NULL,
+            "lookup_create on path symlink.val");
+        check_value (lh, test, "lookup symlink.val");
+    }
+    json_decref (test);
+
+    pathcache_get_stats (pc, &entries, &hits, &misses);
+    ok (entries == 2,
+        "path cache stored dir.val and dir.noexist but not symlink.val");
+    ok (hits == 2 && misses == 4,
+        "repeat lookups of dir.val and dir.noexist hit the path cache");
+
+    pathcache_destroy (pc);
+    cache_destroy (cache);
+    kvsroot_mgr_destroy (krm);
+    json_decref (dir);
+    json_decref (root);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -3437,6 +3532,7 @@ int main (int argc, char *argv[])
     lookup_stall_ref_root ();
     lookup_stall_ref ();
     lookup_stall_namespace_removed ();
+    lookup_pathcache ();
 
     done_testing ();
     return (0);
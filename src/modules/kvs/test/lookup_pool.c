@@ -0,0 +1,354 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdbool.h>
+#include <jansson.h>
+#include <assert.h>
+#include <flux/core.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libkvs/treeobj.h"
+#include "src/common/libkvs/kvs_util_private.h"
+#include "src/common/libutil/blobref.h"
+#include "src/common/libutil/monotime.h"
+#include "src/modules/kvs/cache.h"
+#include "src/modules/kvs/lookup.h"
+#include "src/modules/kvs/lookup_pool.h"
+
+/* number of keys in the benchmark directory */
+#define BENCH_KEYS 64
+
+/* number of lookups per benchmark run */
+#define BENCH_LOOKUPS 20000
+
+struct completion {
+    flux_reactor_t *r;
+    int pending;
+    lookup_process_t last_ret;
+    json_t *last_val;
+    int finished;
+};
+
+static int treeobj_hash (json_t *obj, char *blobref, int blobref_len)
+{
+    char *tmp;
+    int rc;
+
+    if (!(tmp = treeobj_encode (obj)))
+        return -1;
+    rc = blobref_hash ("sha1", (uint8_t *)tmp, strlen (tmp),
+                       blobref, blobref_len);
+    free (tmp);
+    return rc;
+}
+
+/* convenience function */
+static void cache_insert_treeobj (struct cache *cache, const char *ref,
+                                  json_t *o)
+{
+    struct cache_entry *entry;
+    char *s;
+    int ret;
+
+    s = treeobj_encode (o);
+    assert (s);
+    entry = cache_entry_create (ref);
+    assert (entry);
+    ret = cache_entry_set_raw (entry, s, strlen (s));
+    assert (ret == 0);
+    ret = cache_insert (cache, entry);
+    assert (ret == 0);
+    free (s);
+}
+
+static void insert_entry_val (json_t *dir, const char *name, const char *s)
+{
+    json_t *val = treeobj_create_val (s, strlen (s));
+    assert (val);
+    treeobj_insert_entry (dir, name, val);
+    json_decref (val);
+}
+
+static void insert_entry (json_t *dir, const char *name, json_t *o)
+{
+    assert (o);
+    treeobj_insert_entry (dir, name, o);
+    json_decref (o);
+}
+
+/* This cache is
+ *
+ * root-refA
+ * "k0" .. "k63" : val to "v0" .. "v63"
+ * "missing" : dirref to a ref not in the cache
+ * "symlinkNS2B" : symlinkNS to "val" in namespace=B
+ *
+ * root-refB
+ * "val" : val to "2"
+ */
+static void setup (struct cache *cache, kvsroot_mgr_t *krm)
+{
+    json_t *rootA, *rootB;
+    char refA[BLOBREF_MAX_STRING_SIZE];
+    char refB[BLOBREF_MAX_STRING_SIZE];
+    struct kvsroot *root;
+    char key[16], val[16];
+    int i;
+
+    rootA = treeobj_create_dir ();
+    for (i = 0; i < BENCH_KEYS; i++) {
+        snprintf (key, sizeof (key), "k%d", i);
+        snprintf (val, sizeof (val), "v%d", i);
+        insert_entry_val (rootA, key, val);
+    }
+    insert_entry (rootA, "missing",
+                  treeobj_create_dirref ("sha1-0000000000000000000000000000000000000000"));
+    insert_entry (rootA, "symlinkNS2B", treeobj_create_symlink ("B", "val"));
+    treeobj_hash (rootA, refA, sizeof (refA));
+    cache_insert_treeobj (cache, refA, rootA);
+
+    rootB = treeobj_create_dir ();
+    insert_entry_val (rootB, "val", "2");
+    treeobj_hash (rootB, refB, sizeof (refB));
+    cache_insert_treeobj (cache, refB, rootB);
+
+    root = kvsroot_mgr_create_root (krm, cache, "sha1", "A", 0, 0);
+    assert (root);
+    kvsroot_setroot (krm, root, refA, 0);
+    root = kvsroot_mgr_create_root (krm, cache, "sha1", "B", 0, 0);
+    assert (root);
+    kvsroot_setroot (krm, root, refB, 0);
+
+    json_decref (rootA);
+    json_decref (rootB);
+}
+
+static lookup_t *create (struct cache *cache, kvsroot_mgr_t *krm,
+                         const char *ns, const char *key)
+{
+    return lookup_create (cache, krm, 1, ns, NULL, 0, key,
+                          FLUX_ROLE_OWNER, 0, 0, NULL);
+}
+
+static void completion_cb (lookup_t *lh, lookup_process_t ret, void *arg)
+{
+    struct completion *c = arg;
+
+    c->last_ret = ret;
+    if (ret == LOOKUP_PROCESS_FINISHED) {
+        json_decref (c->last_val);
+        c->last_val = lookup_get_value (lh);
+        c->finished++;
+    }
+    /* YIELD leaves the lookup to be finished by the caller */
+    if (ret != LOOKUP_PROCESS_YIELD)
+        lookup_destroy (lh);
+    if (--c->pending == 0)
+        flux_reactor_stop (c->r);
+}
+
+static void run_one (struct lookup_pool *lp, struct completion *c,
+                     lookup_t *lh)
+{
+    c->pending = 1;
+    c->last_ret = 0;
+    ok (lookup_pool_submit (lp, lh, completion_cb, c) == 0,
+        "lookup_pool_submit works");
+    ok (flux_reactor_run (c->r, 0) >= 0 && c->pending == 0,
+        "completion was delivered by the reactor");
+}
+
+static bool val_is (json_t *val, const char *s)
+{
+    void *data;
+    int len;
+    bool match;
+
+    if (!val || treeobj_decode_val (val, &data, &len) < 0)
+        return false;
+    match = (len == strlen (s) && !memcmp (data, s, len));
+    free (data);
+    return match;
+}
+
+void basic_api (flux_reactor_t *r)
+{
+    struct lookup_pool *lp;
+
+    errno = 0;
+    ok (lookup_pool_create (NULL, 1) == NULL && errno == EINVAL,
+        "lookup_pool_create r=NULL fails with EINVAL");
+    errno = 0;
+    ok (lookup_pool_create (r, 0) == NULL && errno == EINVAL,
+        "lookup_pool_create nthreads=0 fails with EINVAL");
+    ok ((lp = lookup_pool_create (r, 2)) != NULL,
+        "lookup_pool_create nthreads=2 works");
+    errno = 0;
+    ok (lookup_pool_submit (lp, NULL, completion_cb, NULL) < 0
+        && errno == EINVAL,
+        "lookup_pool_submit lh=NULL fails with EINVAL");
+    lookup_pool_destroy (lp);
+    lookup_pool_destroy (NULL);
+}
+
+void shared_lookups (flux_reactor_t *r)
+{
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    struct lookup_pool *lp;
+    struct completion c = { .r = r };
+    lookup_t *lh;
+
+    cache = cache_create ();
+    krm = kvsroot_mgr_create (NULL, NULL);
+    assert (cache && krm);
+    setup (cache, krm);
+
+    ok ((lp = lookup_pool_create (r, 2)) != NULL,
+        "lookup_pool_create works");
+
+    lh = create (cache, krm, "A", "k42");
+    errno = 0;
+    ok (lookup_shared (lh) == LOOKUP_PROCESS_ERROR && errno == EINVAL,
+        "lookup_shared fails with EINVAL without lookup_prepare");
+    ok (lookup_prepare (lh) == 0,
+        "lookup_prepare works");
+    run_one (lp, &c, lh);
+    ok (c.last_ret == LOOKUP_PROCESS_FINISHED && val_is (c.last_val, "v42"),
+        "shared lookup of k42 returned v42");
+
+    lh = create (cache, krm, "A", "missing.foo");
+    ok (lookup_prepare (lh) == 0,
+        "lookup_prepare works");
+    run_one (lp, &c, lh);
+    ok (c.last_ret == LOOKUP_PROCESS_LOAD_MISSING_REFS,
+        "shared lookup through missing dirref stalls on missing refs");
+
+    lh = create (cache, krm, "A", "symlinkNS2B");
+    ok (lookup_prepare (lh) == 0,
+        "lookup_prepare works");
+    run_one (lp, &c, lh);
+    ok (c.last_ret == LOOKUP_PROCESS_YIELD,
+        "shared lookup through symlink to other namespace yields");
+    ok (lookup (lh) == LOOKUP_PROCESS_FINISHED,
+        "lookup finishes yielded lookup");
+    json_decref (c.last_val);
+    c.last_val = lookup_get_value (lh);
+    ok (val_is (c.last_val, "2"),
+        "and returns the value from namespace B");
+    lookup_destroy (lh);
+
+    lh = create (cache, krm, "noexist", "k1");
+    ok (lookup_prepare (lh) < 0,
+        "lookup_prepare fails on missing namespace");
+    ok (lookup (lh) == LOOKUP_PROCESS_LOAD_MISSING_NAMESPACE,
+        "lookup reports missing namespace");
+    lookup_destroy (lh);
+
+    lookup_pool_destroy (lp);
+    json_decref (c.last_val);
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+}
+
+/* Lookups/sec for the synchronous lookup() path (nthreads == 0),
+ * and for the pool with 'nthreads' threads.
+ */
+static double bench_rate (flux_reactor_t *r, struct cache *cache,
+                          kvsroot_mgr_t *krm, int nthreads)
+{
+    struct lookup_pool *lp = NULL;
+    struct completion c = { .r = r };
+    struct timespec t0;
+    char key[16];
+    double ms;
+    int i;
+
+    if (nthreads > 0 && !(lp = lookup_pool_create (r, nthreads)))
+        BAIL_OUT ("lookup_pool_create failed");
+    monotime (&t0);
+    for (i = 0; i < BENCH_LOOKUPS; i++) {
+        lookup_t *lh;
+
+        snprintf (key, sizeof (key), "k%d", i % BENCH_KEYS);
+        if (!(lh = create (cache, krm, "A", key)))
+            BAIL_OUT ("lookup_create failed");
+        if (lp) {
+            if (lookup_prepare (lh) < 0
+                || lookup_pool_submit (lp, lh, completion_cb, &c) < 0)
+                BAIL_OUT ("lookup_pool_submit failed");
+            c.pending++;
+        }
+        else {
+            c.pending++;
+            completion_cb (lh, lookup (lh), &c);
+        }
+    }
+    if (c.pending > 0 && flux_reactor_run (r, 0) < 0)
+        BAIL_OUT ("flux_reactor_run failed");
+    ms = monotime_since (t0);
+    lookup_pool_destroy (lp);
+    json_decref (c.last_val);
+    if (c.finished != BENCH_LOOKUPS)
+        BAIL_OUT ("%d of %d lookups finished", c.finished, BENCH_LOOKUPS);
+    return BENCH_LOOKUPS / (ms / 1000.);
+}
+
+void bench (flux_reactor_t *r)
+{
+    struct cache *cache;
+    kvsroot_mgr_t *krm;
+    int nthreads[] = { 0, 1, 2, 4, 8 };
+    int i;
+
+    cache = cache_create ();
+    krm = kvsroot_mgr_create (NULL, NULL);
+    assert (cache && krm);
+    setup (cache, krm);
+
+    for (i = 0; i < sizeof (nthreads) / sizeof (nthreads[0]); i++) {
+        double rate = bench_rate (r, cache, krm, nthreads[i]);
+        if (nthreads[i] == 0)
+            diag ("lookup(): %.0f lookups/sec", rate);
+        else
+            diag ("lookup pool, %d threads: %.0f lookups/sec",
+                  nthreads[i], rate);
+    }
+    ok (true, "completed %d lookups per thread count", BENCH_LOOKUPS);
+
+    kvsroot_mgr_destroy (krm);
+    cache_destroy (cache);
+}
+
+int main (int argc, char *argv[])
+{
+    flux_reactor_t *r;
+
+    plan (NO_PLAN);
+
+    if (!(r = flux_reactor_create (0)))
+        BAIL_OUT ("flux_reactor_create failed");
+
+    basic_api (r);
+    shared_lookups (r);
+    bench (r);
+
+    flux_reactor_destroy (r);
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
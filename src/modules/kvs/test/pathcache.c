@@ -0,0 +1,196 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <jansson.h>
+
+#include "src/common/libtap/tap.h"
+#include "src/common/libkvs/treeobj.h"
+#include "src/modules/kvs/pathcache.h"
+
+static bool hit (struct pathcache *pc, const char *ns, const char *root_ref,
+                 const char *key)
+{
+    json_t *dirent = NULL;
+    int rc = pathcache_lookup (pc, ns, root_ref, key, 0, &dirent);
+    json_decref (dirent);
+    return rc == 1;
+}
+
+static void stats_is (struct pathcache *pc, int entries, int hits, int misses,
+                      const char *msg)
+{
+    int e, h, m;
+
+    pathcache_get_stats (pc, &e, &h, &m);
+    ok (e == entries && h == hits && m == misses,
+        "%s: entries=%d hits=%d misses=%d", msg, e, h, m);
+}
+
+void basic_api (void)
+{
+    struct pathcache *pc;
+    json_t *val;
+    json_t *dirent;
+
+    ok (pathcache_create (-1) == NULL && errno == EINVAL,
+        "pathcache_create max_entries=-1 fails with EINVAL");
+    ok ((pc = pathcache_create (100)) != NULL,
+        "pathcache_create works");
+    stats_is (pc, 0, 0, 0, "new cache is empty");
+
+    val = treeobj_create_val ("foo", 3);
+
+    pathcache_insert (pc, "A", "ref1", "a.b", 0, val);
+    ok (!hit (pc, "A", "ref1", "a.b"),
+        "insert is dropped before namespace root is set");
+
+    pathcache_setroot (pc, "A", NULL, "ref1", NULL);
+    pathcache_insert (pc, "A", "ref1", "a.b", 0, val);
+    pathcache_insert (pc, "A", "ref1", "a.noexist", 0, NULL);
+    pathcache_insert (pc, "A", "ref0", "a.c", 0, val);
+    stats_is (pc, 2, 0, 1, "insert for other root is dropped");
+
+    dirent = NULL;
+    ok (pathcache_lookup (pc, "A", "ref1", "a.b", 0, &dirent) == 1
+        && dirent != NULL && json_equal (dirent, val),
+        "pathcache_lookup returns copy of stored dirent");
+    json_decref (dirent);
+    dirent = val;
+    ok (pathcache_lookup (pc, "A", "ref1", "a.noexist", 0, &dirent) == 1
+        && dirent == NULL,
+        "pathcache_lookup returns NULL dirent for stored nonexistent key");
+    ok (!hit (pc, "A", "ref2", "a.b"),
+        "pathcache_lookup misses with other root");
+    ok (!hit (pc, "B", "ref1", "a.b"),
+        "pathcache_lookup misses in other namespace");
+    stats_is (pc, 2, 2, 3, "stats count hits and misses");
+
+    pathcache_clear_stats (pc);
+    stats_is (pc, 2, 0, 0, "pathcache_clear_stats works");
+
+    pathcache_remove_namespace (pc, "A");
+    stats_is (pc, 0, 0, 0, "pathcache_remove_namespace drops entries");
+
+    json_decref (val);
+    pathcache_destroy (pc);
+
+    /* NULL cache is a no-op */
+    ok (!hit (NULL, "A", "ref1", "a.b"),
+        "pathcache_lookup on NULL cache misses");
+    pathcache_insert (NULL, "A", "ref1", "a.b", 0, NULL);
+    pathcache_setroot (NULL, "A", NULL, "ref1", NULL);
+    pathcache_destroy (NULL);
+}
+
+void setroot_invalidation (void)
+{
+    struct pathcache *pc;
+    json_t *val;
+    json_t *keys;
+
+    ok ((pc = pathcache_create (100)) != NULL,
+        "pathcache_create works");
+    val = treeobj_create_val ("foo", 3);
+
+    pathcache_setroot (pc, "A", NULL, "ref1", NULL);
+    pathcache_insert (pc, "A", "ref1", "a", 0, val);
+    pathcache_insert (pc, "A", "ref1", "a.b", 0, val);
+    pathcache_insert (pc, "A", "ref1", "a.b.c", 0, val);
+    pathcache_insert (pc, "A", "ref1", "a.bc", 0, val);
+    pathcache_insert (pc, "A", "ref1", "x.y", 0, val);
+
+    keys = json_pack ("[s]", "a.b");
+    pathcache_setroot (pc, "A", "ref1", "ref2", keys);
+    json_decref (keys);
+
+    ok (!hit (pc, "A", "ref2", "a"),
+        "parent of changed key is dropped");
+    ok (!hit (pc, "A", "ref2", "a.b"),
+        "changed key is dropped");
+    ok (!hit (pc, "A", "ref2", "a.b.c"),
+        "child of changed key is dropped");
+    ok (hit (pc, "A", "ref2", "a.bc"),
+        "sibling sharing a name prefix is carried to new root");
+    ok (hit (pc, "A", "ref2", "x.y"),
+        "unrelated key is carried to new root");
+    ok (!hit (pc, "A", "ref1", "x.y"),
+        "old root no longer hits");
+
+    keys = json_pack ("[s]", "q");
+    pathcache_setroot (pc, "A", "ref1", "ref3", keys);
+    json_decref (keys);
+    ok (!hit (pc, "A", "ref3", "x.y"),
+        "setroot from an unexpected previous root drops all entries");
+
+    pathcache_insert (pc, "A", "ref3", "x.y", 0, val);
+    keys = json_pack ("[s]", ".");
+    pathcache_setroot (pc, "A", "ref3", "ref4", keys);
+    json_decref (keys);
+    ok (!hit (pc, "A", "ref4", "x.y"),
+        "change to root key drops all entries");
+
+    pathcache_insert (pc, "A", "ref4", "x.y", 0, val);
+    pathcache_setroot (pc, "A", "ref4", "ref5", NULL);
+    ok (!hit (pc, "A", "ref5", "x.y"),
+        "setroot with unknown keys drops all entries");
+
+    json_decref (val);
+    pathcache_destroy (pc);
+}
+
+void limits (void)
+{
+    struct pathcache *pc;
+    int entries;
+
+    ok ((pc = pathcache_create (2)) != NULL,
+        "pathcache_create max_entries=2 works");
+    pathcache_setroot (pc, "A", NULL, "ref1", NULL);
+    pathcache_insert (pc, "A", "ref1", "a", 1, NULL);
+    pathcache_insert (pc, "A", "ref1", "b", 5, NULL);
+    pathcache_insert (pc, "A", "ref1", "c", 5, NULL);
+    pathcache_get_stats (pc, &entries, NULL, NULL);
+    ok (entries == 2 && !hit (pc, "A", "ref1", "c"),
+        "insert is dropped when cache is full");
+
+    ok (pathcache_expire_entries (pc, 7, 3) == 1,
+        "pathcache_expire_entries expires entries older than thresh");
+    ok (!hit (pc, "A", "ref1", "a") && hit (pc, "A", "ref1", "b"),
+        "expired entry is gone, unexpired entry remains");
+    ok (pathcache_expire_entries (pc, 7, 0) == 1,
+        "pathcache_expire_entries thresh=0 expires all");
+    pathcache_get_stats (pc, &entries, NULL, NULL);
+    ok (entries == 0,
+        "cache is empty");
+
+    pathcache_destroy (pc);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    basic_api ();
+    setroot_invalidation ();
+    limits ();
+
+    done_testing ();
+    return (0);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -18,6 +18,7 @@
 #include "src/common/libkvs/kvs.h"
 #include "src/common/libflux/message.h"
 #include "src/common/libflux/request.h"
+#include "src/common/libutil/monotime.h"
 #include "src/modules/kvs/treq.h"
 
 int msg_cb (treq_t *tr, const flux_msg_t *req, void *data)
@@ -67,6 +68,9 @@ void treq_basic_tests (void)
     ok (treq_get_flags (tr) == 3,
         "treq_get_flags works");
 
+    ok (monotime_isset (treq_get_create_time (tr)),
+        "treq_get_create_time works");
+
     /* for test ops can be anything */
     ops = json_array ();
     json_array_append_new (ops, json_string ("A"));
@@ -22,6 +22,8 @@
 #include <flux/core.h>
 #include <jansson.h>
 
+#include "src/common/libutil/monotime.h"
+
 #include "treq.h"
 
 struct treq_mgr {
@@ -38,6 +40,7 @@ struct treq {
     json_t *ops;
     int flags;
     bool processed;
+    struct timespec t_create;
 };
 
 /*
@@ -199,6 +202,7 @@ static treq_t *treq_create_common (int nprocs, int flags)
     tr->nprocs = nprocs;
     tr->flags = flags;
     tr->processed = false;
+    monotime (&tr->t_create);
 
     return tr;
 error:
@@ -277,6 +281,11 @@ int treq_get_flags (treq_t *tr)
     return tr->flags;
 }
 
+struct timespec treq_get_create_time (treq_t *tr)
+{
+    return tr->t_create;
+}
+
 json_t *treq_get_ops (treq_t *tr)
 {
     return tr->ops;
@@ -13,6 +13,7 @@
 
 #include <czmq.h>
 #include <jansson.h>
+#include <time.h>
 
 typedef struct treq_mgr treq_mgr_t;
 
@@ -66,6 +67,9 @@ const char *treq_get_name (treq_t *tr);
 int treq_get_nprocs (treq_t *tr);
 int treq_get_flags (treq_t *tr);
 
+/* monotonic time the transaction was created, for latency stats */
+struct timespec treq_get_create_time (treq_t *tr);
+
 json_t *treq_get_ops (treq_t *tr);
 
 /* treq_add_request_ops() should be called with ops on each
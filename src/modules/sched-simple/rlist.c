@@ -92,32 +92,20 @@ static int idset_cmp (struct idset *set1, struct idset *set2)
 
 static int idset_add_set (struct idset *set, struct idset *new)
 {
-    unsigned int i = idset_first (new);
-    while (i != IDSET_INVALID_ID) {
-        if (idset_test (set, i)) {
-            errno = EEXIST;
-            return -1;
-        }
-        if (idset_set (set, i) < 0)
-            return -1;
-        i = idset_next (new, i);
+    if (idset_has_intersection (set, new)) {
+        errno = EEXIST;
+        return -1;
     }
-    return 0;
+    return idset_union (set, new);
 }
 
 static int idset_remove_set (struct idset *set, struct idset *remove)
 {
-    unsigned int i = idset_first (remove);
-    while (i != IDSET_INVALID_ID) {
-        if (!idset_test (set, i)) {
-            errno = ENOENT;
-            return -1;
-        }
-        if (idset_clear (set, i) < 0)
-            return -1;
-        i = idset_next (remove, i);
+    if (!idset_is_subset (remove, set)) {
+        errno = ENOENT;
+        return -1;
     }
-    return 0;
+    return idset_subtract (set, remove);
 }
 
 static int rlist_add_rnode (struct rlist *rl, struct rnode *n)
@@ -77,22 +77,13 @@ fail:
 
 int rnode_alloc (struct rnode *n, int count, struct idset **setp)
 {
-    struct idset *ids = NULL;
-    unsigned int i;
-    if (idset_count (n->avail) < count) {
-        errno = ENOSPC;
+    struct idset *ids;
+    if (!(ids = idset_alloc_first_n (n->avail, count)))
         return -1;
-    }
-    if (!(ids = idset_create (0, IDSET_FLAG_AUTOGROW)))
-        return -1;
-    i = idset_first (n->avail);
-    while (count--) {
-        idset_set (ids, i);
-        idset_clear (n->avail, i);
-        i = idset_next (n->avail, i);
-    }
     if (setp != NULL)
         *setp = ids;
+    else
+        idset_destroy (ids);
     return (0);
 }
 
@@ -102,36 +93,26 @@ int rnode_alloc (struct rnode *n, int count, struct idset **setp)
  */
 static bool alloc_ids_valid (struct rnode *n, struct idset *ids)
 {
-    unsigned int i = idset_first (ids);
-    while (i != IDSET_INVALID_ID) {
-        if (!idset_test (n->ids, i)) {
-            errno = ENOENT;
-            return false;
-        }
-        if (!idset_test (n->avail, i)) {
-            errno = EEXIST;
-            return false;
-        }
-        i = idset_next (ids, i);
+    if (!idset_is_subset (ids, n->ids)) {
+        errno = ENOENT;
+        return false;
+    }
+    if (!idset_is_subset (ids, n->avail)) {
+        errno = EEXIST;
+        return false;
     }
     return (true);
 }
 
 int rnode_alloc_idset (struct rnode *n, struct idset *ids)
 {
-    unsigned int i;
     if (!ids) {
         errno = EINVAL;
         return -1;
     }
     if (!alloc_ids_valid (n, ids))
         return -1;
-    i = idset_first (ids);
-    while (i != IDSET_INVALID_ID) {
-        idset_clear (n->avail, i);
-        i = idset_next (ids, i);
-    }
-    return 0;
+    return idset_subtract (n->avail, ids);
 }
 
 /*
@@ -140,36 +121,26 @@ int rnode_alloc_idset (struct rnode *n, struct idset *ids)
  */
 static bool free_ids_valid (struct rnode *n, struct idset *ids)
 {
-    unsigned int i = idset_first (ids);
-    while (i != IDSET_INVALID_ID) {
-        if (!idset_test (n->ids, i)) {
-            errno = ENOENT;
-            return false;
-        }
-        if (idset_test (n->avail, i)) {
-            errno = EEXIST;
-            return false;
-        }
-        i = idset_next (ids, i);
+    if (!idset_is_subset (ids, n->ids)) {
+        errno = ENOENT;
+        return false;
+    }
+    if (idset_has_intersection (ids, n->avail)) {
+        errno = EEXIST;
+        return false;
     }
     return (true);
 }
 
 int rnode_free_idset (struct rnode *n, struct idset *ids)
 {
-    unsigned int i;
     if (!ids) {
         errno = EINVAL;
         return -1;
     }
     if (!free_ids_valid (n, ids))
         return -1;
-    i = idset_first (ids);
-    while (i != IDSET_INVALID_ID) {
-        idset_set (n->avail, i);
-        i = idset_next (ids, i);
-    }
-    return 0;
+    return idset_union (n->avail, ids);
 }
 
 int rnode_free (struct rnode *n, const char *s)
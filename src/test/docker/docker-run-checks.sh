@@ -102,6 +102,7 @@ echo "mounting $TOP as /usr/src"
 export JOBS
 export DISTCHECK
 export chain_lint
+export BENCH
 
 docker run --rm \
     --workdir=/usr/src \
@@ -120,6 +121,7 @@ docker run --rm \
     -e CPPCHECK \
     -e DISTCHECK \
     -e chain_lint \
+    -e BENCH \
     -e JOBS \
     -e USER \
     -e TRAVIS \
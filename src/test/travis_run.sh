@@ -14,6 +14,7 @@
 #  CPPCHECK      Run cppcheck if set to "t"
 #  DISTCHECK     Run `make distcheck` if set
 #  chain_lint    Run sharness with --chain-lint if chain_lint=t
+#  BENCH         Run a reduced `make bench` after tests if BENCH=t
 #
 #  And, obviously, some crucial variables that configure itself cares about:
 #
@@ -110,6 +111,12 @@ fi
 echo "Starting MUNGE"
 sudo /sbin/runuser -u munge /usr/sbin/munged
 
+# Benchmarks are only a smoke test here: CI hosts vary too much to
+#  compare against a stored baseline.
+if test "$BENCH" = "t"; then
+    MAKECMDS="$MAKECMDS && ${MAKE} bench BENCH_OPTS='--scale=0.1 --repeat=1'"
+fi
+
 travis_fold "autogen.sh" "./autogen.sh..." ./autogen.sh
 travis_fold "configure"  "./configure ${ARGS}..." ./configure ${ARGS}
 travis_fold "make_clean" "make clean..." make clean
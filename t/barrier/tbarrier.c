@@ -21,12 +21,13 @@
 #include "src/common/libutil/monotime.h"
 #include "src/common/libutil/xzmalloc.h"
 
-#define OPTIONS "hqn:t:"
+#define OPTIONS "hqn:t:c:"
 static const struct option longopts[] = {
     {"help",       no_argument,        0, 'h'},
     {"quiet",      no_argument,        0, 'q'},
     {"nprocs",     required_argument,  0, 'n'},
     {"test-iterations", required_argument,  0, 't'},
+    {"clients",    required_argument,  0, 'c'},
     { 0, 0, 0, 0 },
 };
 
@@ -34,22 +35,24 @@ static const struct option longopts[] = {
 void usage (void)
 {
     fprintf (stderr,
-"Usage: tbarrier [--quiet] [--nprocs N] [--test-iterations N] [name]\n"
+"Usage: tbarrier [--quiet] [--nprocs N] [--test-iterations N]\n"
+"                [--clients N] [name]\n"
 );
     exit (1);
 }
 
 int main (int argc, char *argv[])
 {
-    flux_t *h;
-    flux_future_t *f;
+    flux_t **h;
+    flux_future_t **f;
     int ch;
     struct timespec t0;
     char *name = NULL;
     int quiet = 0;
     int nprocs = 1;
     int iter = 1;
-    int i;
+    int clients = 1;
+    int i, j;
 
     log_init ("tbarrier");
 
@@ -67,6 +70,9 @@ int main (int argc, char *argv[])
             case 't': /* --test-iterations N */
                 iter = strtoul (optarg, NULL, 10);
                 break;
+            case 'c': /* --clients N */
+                clients = strtoul (optarg, NULL, 10);
+                break;
             default:
                 usage ();
                 break;
@@ -77,30 +83,46 @@ int main (int argc, char *argv[])
     if (optind < argc)
         name = argv[optind++];
 
-    if (!(h = flux_open (NULL, 0)))
-        log_err_exit ("flux_open");
+    if (clients < 1)
+        usage ();
+    /* Each client enters the barrier on its own connection.
+     */
+    h = xzmalloc (clients * sizeof (h[0]));
+    f = xzmalloc (clients * sizeof (f[0]));
+    for (j = 0; j < clients; j++) {
+        if (!(h[j] = flux_open (NULL, 0)))
+            log_err_exit ("flux_open");
+    }
 
     for (i = 0; i < iter; i++) {
         char *tname = NULL;
         monotime (&t0);
         if (name)
             tname = xasprintf ("%s.%d", name, i);
-        if (!(f = flux_barrier (h, tname, nprocs))) {
-            if (errno == EINVAL && tname == NULL)
-                log_msg_exit ("%s", "provide barrier name if not running as LWJ");
-            else
-                log_err_exit ("flux_barrier");
+        for (j = 0; j < clients; j++) {
+            if (!(f[j] = flux_barrier (h[j], tname, nprocs))) {
+                if (errno == EINVAL && tname == NULL)
+                    log_msg_exit ("%s", "provide barrier name if not running as LWJ");
+                else
+                    log_err_exit ("flux_barrier");
+            }
+        }
+        for (j = 0; j < clients; j++) {
+            if (flux_future_get (f[j], NULL) < 0)
+                log_err_exit ("barrier completion failed");
+            flux_future_destroy (f[j]);
         }
-        if (flux_future_get (f, NULL) < 0)
-            log_err_exit ("barrier completion failed");
         if (!quiet)
-            printf ("barrier name=%s nprocs=%d time=%0.3f ms\n",
-                    tname ? tname : "NULL", nprocs, monotime_since (t0));
+            printf ("barrier name=%s nprocs=%d clients=%d time=%0.3f ms\n",
+                    tname ? tname : "NULL", nprocs, clients,
+                    monotime_since (t0));
         free (tname);
-        flux_future_destroy (f);
     }
 
-    flux_close (h);
+    for (j = 0; j < clients; j++)
+        flux_close (h[j]);
+    free (h);
+    free (f);
     log_fini ();
     return 0;
 }
@@ -0,0 +1,656 @@
+/************************************************************\
+ * Copyright 2019 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* bench.c - throughput and latency microbenchmarks for flux-bench
+ *
+ * Each subcommand runs one workload against the enclosing instance and
+ * prints its results as JSON objects, one per line:
+ *   {"name":"throughput", "value":12345.6, "unit":"ops/s"}
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <jansson.h>
+#include <flux/core.h>
+#include <flux/optparse.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/monotime.h"
+#include "src/common/libutil/hist.h"
+
+extern char **environ;
+
+/* Start operation 'i', returning a future.
+ */
+typedef flux_future_t *(*start_f)(flux_t *h, int i, void *arg);
+
+/* Check the result of a completed operation.
+ */
+typedef void (*finish_f)(flux_future_t *f, int i, void *arg);
+
+static struct optparse_option opts[] = {
+    { .name = "count", .key = 'c', .has_arg = 1, .arginfo = "N",
+      .usage = "Run N operations",
+    },
+    { .name = "size", .key = 's', .has_arg = 1, .arginfo = "N",
+      .usage = "Use N byte payloads",
+    },
+    { .name = "window", .key = 'w', .has_arg = 1, .arginfo = "N",
+      .usage = "Keep at most N operations in flight (default 64)",
+    },
+    { .name = "rank", .key = 'r', .has_arg = 1, .arginfo = "N",
+      .usage = "Target broker rank N (default: local broker)",
+    },
+    OPTPARSE_TABLE_END
+};
+
+static void report (const char *name, double value, const char *unit)
+{
+    json_t *o;
+    char *s;
+
+    if (!(o = json_pack ("{s:s s:f s:s}",
+                         "name", name,
+                         "value", value,
+                         "unit", unit))
+        || !(s = json_dumps (o, JSON_COMPACT)))
+        oom ();
+    printf ("%s\n", s);
+    fflush (stdout);
+    free (s);
+    json_decref (o);
+}
+
+static void report_rate (const char *name, int count, double elapsed_ms)
+{
+    report (name, count / (elapsed_ms * 1E-3), "ops/s");
+}
+
+static void report_latency (const char *name, struct hist *lat)
+{
+    char key[64];
+
+    snprintf (key, sizeof (key), "%s-p50", name);
+    report (key, hist_percentile (lat, 50), "us");
+    snprintf (key, sizeof (key), "%s-p99", name);
+    report (key, hist_percentile (lat, 99), "us");
+}
+
+/* Run 'count' operations with at most 'window' in flight, completing
+ * them in order.  If 'lat' is non-NULL, record the latency of each.
+ * Returns elapsed time in milliseconds.
+ */
+static double pipeline (flux_t *h, int count, int window,
+                        start_f start, finish_f finish, void *arg,
+                        struct hist *lat)
+{
+    flux_future_t **fs = xzmalloc (window * sizeof (fs[0]));
+    struct timespec *ts = xzmalloc (window * sizeof (ts[0]));
+    struct timespec t0;
+    int i;
+
+    monotime (&t0);
+    for (i = 0; i < count + window; i++) {
+        int slot = i % window;
+        if (i >= window) {
+            finish (fs[slot], i - window, arg);
+            if (lat && hist_record_since (lat, ts[slot]) < 0)
+                oom ();
+            flux_future_destroy (fs[slot]);
+        }
+        if (i < count) {
+            monotime (&ts[slot]);
+            if (!(fs[slot] = start (h, i, arg)))
+                log_err_exit ("operation %d", i);
+        }
+    }
+    free (ts);
+    free (fs);
+    return monotime_since (t0);
+}
+
+static struct hist *hist_create_or_die (void)
+{
+    struct hist *lat;
+
+    if (!(lat = hist_create ()))
+        oom ();
+    return lat;
+}
+
+static flux_t *open_or_die (void)
+{
+    flux_t *h;
+
+    if (!(h = flux_open (NULL, 0)))
+        log_err_exit ("flux_open");
+    return h;
+}
+
+static uint32_t get_rank (optparse_t *p)
+{
+    int rank = optparse_get_int (p, "rank", -1);
+
+    return rank < 0 ? FLUX_NODEID_ANY : rank;
+}
+
+/* rpc: cmb.ping round trips
+ */
+
+struct ping {
+    uint32_t nodeid;
+    char *pad;
+};
+
+static flux_future_t *ping_start (flux_t *h, int i, void *arg)
+{
+    struct ping *ping = arg;
+
+    return flux_rpc_pack (h, "cmb.ping", ping->nodeid, 0,
+                          "{s:i s:s}", "seq", i, "pad", ping->pad);
+}
+
+static void rpc_finish (flux_future_t *f, int i, void *arg)
+{
+    if (flux_rpc_get (f, NULL) < 0)
+        log_err_exit ("rpc %d", i);
+}
+
+static int cmd_rpc (optparse_t *p, int ac, char *av[])
+{
+    flux_t *h = open_or_die ();
+    int count = optparse_get_int (p, "count", 10000);
+    int window = optparse_get_int (p, "window", 64);
+    int size = optparse_get_int (p, "size", 0);
+    struct hist *lat = hist_create_or_die ();
+    struct ping ping = { .nodeid = get_rank (p) };
+    double elapsed;
+
+    ping.pad = xzmalloc (size + 1);
+    memset (ping.pad, 'p', size);
+
+    pipeline (h, count, 1, ping_start, rpc_finish, &ping, lat);
+    report_latency ("latency", lat);
+    elapsed = pipeline (h, count, window, ping_start, rpc_finish, &ping, NULL);
+    report_rate ("throughput", count, elapsed);
+
+    free (ping.pad);
+    hist_destroy (lat);
+    flux_close (h);
+    return 0;
+}
+
+/* event: publish events and receive them back.  Events are sequenced on
+ * rank 0 and distributed to all brokers, so when run on a leaf rank,
+ * this measures the full path up and back down the tree.
+ */
+
+static flux_future_t *event_start (flux_t *h, int i, void *arg)
+{
+    return flux_event_publish (h, "bench.event", 0, NULL);
+}
+
+static void event_finish (flux_future_t *f, int i, void *arg)
+{
+    flux_t *h = flux_future_get_flux (f);
+    struct flux_match match = FLUX_MATCH_EVENT;
+    flux_msg_t *msg;
+    int seq;
+
+    if (flux_event_publish_get_seq (f, &seq) < 0)
+        log_err_exit ("event publish %d", i);
+    match.topic_glob = "bench.event";
+    if (!(msg = flux_recv (h, match, 0)))
+        log_err_exit ("event receive %d", i);
+    flux_msg_destroy (msg);
+}
+
+static int cmd_event (optparse_t *p, int ac, char *av[])
+{
+    flux_t *h = open_or_die ();
+    int count = optparse_get_int (p, "count", 10000);
+    int window = optparse_get_int (p, "window", 64);
+    struct hist *lat = hist_create_or_die ();
+    double elapsed;
+
+    if (flux_event_subscribe (h, "bench.event") < 0)
+        log_err_exit ("flux_event_subscribe");
+
+    pipeline (h, count / 10, 1, event_start, event_finish, NULL, lat);
+    report_latency ("latency", lat);
+    elapsed = pipeline (h, count, window, event_start, event_finish,
+                        NULL, NULL);
+    report_rate ("throughput", count, elapsed);
+
+    hist_destroy (lat);
+    flux_close (h);
+    return 0;
+}
+
+/* kvs: commit, bulk put, lookup, and watch
+ */
+
+struct kvs {
+    char *dir;
+    char *val;
+};
+
+static char *kvs_key (struct kvs *kvs, int i)
+{
+    char *key;
+
+    if (asprintf (&key, "%s.key%d", kvs->dir, i) < 0)
+        oom ();
+    return key;
+}
+
+static flux_future_t *kvs_commit_start (flux_t *h, int i, void *arg)
+{
+    struct kvs *kvs = arg;
+    flux_kvs_txn_t *txn;
+    flux_future_t *f;
+    char *key = kvs_key (kvs, i);
+
+    if (!(txn = flux_kvs_txn_create ())
+        || flux_kvs_txn_put (txn, 0, key, kvs->val) < 0)
+        log_err_exit ("flux_kvs_txn_put");
+    f = flux_kvs_commit (h, NULL, 0, txn);
+    flux_kvs_txn_destroy (txn);
+    free (key);
+    return f;
+}
+
+static void kvs_commit_finish (flux_future_t *f, int i, void *arg)
+{
+    if (flux_future_get (f, NULL) < 0)
+        log_err_exit ("kvs commit %d", i);
+}
+
+static flux_future_t *kvs_lookup_start (flux_t *h, int i, void *arg)
+{
+    struct kvs *kvs = arg;
+    flux_future_t *f;
+    char *key = kvs_key (kvs, i);
+
+    f = flux_kvs_lookup (h, NULL, 0, key);
+    free (key);
+    return f;
+}
+
+static void kvs_lookup_finish (flux_future_t *f, int i, void *arg)
+{
+    struct kvs *kvs = arg;
+    const char *val;
+
+    if (flux_kvs_lookup_get (f, &val) < 0)
+        log_err_exit ("kvs lookup %d", i);
+    if (strcmp (val, kvs->val) != 0)
+        log_msg_exit ("kvs lookup %d: wrong value", i);
+}
+
+static void kvs_put_all (flux_t *h, struct kvs *kvs, int count)
+{
+    flux_kvs_txn_t *txn;
+    flux_future_t *f;
+    int i;
+
+    if (!(txn = flux_kvs_txn_create ()))
+        log_err_exit ("flux_kvs_txn_create");
+    for (i = 0; i < count; i++) {
+        char *key = kvs_key (kvs, i);
+        if (flux_kvs_txn_put (txn, 0, key, kvs->val) < 0)
+            log_err_exit ("flux_kvs_txn_put");
+        free (key);
+    }
+    if (!(f = flux_kvs_commit (h, NULL, 0, txn))
+        || flux_future_get (f, NULL) < 0)
+        log_err_exit ("kvs commit");
+    flux_future_destroy (f);
+    flux_kvs_txn_destroy (txn);
+}
+
+/* Commit 'count' updates to one key, recording the time from the start
+ * of each commit until the watcher sees the new value.
+ */
+static void kvs_watch (flux_t *h, struct kvs *kvs, int count,
+                       struct hist *lat)
+{
+    char *key = kvs_key (kvs, 0);
+    flux_future_t *fw;
+    const char *val;
+    int i;
+
+    if (!(fw = flux_kvs_lookup (h, NULL, FLUX_KVS_WATCH, key))
+        || flux_kvs_lookup_get (fw, &val) < 0)
+        log_err_exit ("kvs watch");
+    flux_future_reset (fw);
+    for (i = 0; i < count; i++) {
+        struct timespec t0;
+        flux_future_t *f;
+
+        monotime (&t0);
+        if (!(f = kvs_commit_start (h, 0, kvs)))
+            log_err_exit ("kvs commit");
+        kvs_commit_finish (f, 0, kvs);
+        flux_future_destroy (f);
+        if (flux_kvs_lookup_get (fw, &val) < 0)
+            log_err_exit ("kvs watch %d", i);
+        if (hist_record_since (lat, t0) < 0)
+            oom ();
+        flux_future_reset (fw);
+    }
+    if (flux_kvs_lookup_cancel (fw) < 0)
+        log_err_exit ("flux_kvs_lookup_cancel");
+    while (flux_kvs_lookup_get (fw, &val) == 0)
+        flux_future_reset (fw);
+    flux_future_destroy (fw);
+    free (key);
+}
+
+static void kvs_unlink_dir (flux_t *h, struct kvs *kvs)
+{
+    flux_kvs_txn_t *txn;
+    flux_future_t *f;
+
+    if (!(txn = flux_kvs_txn_create ())
+        || flux_kvs_txn_unlink (txn, 0, kvs->dir) < 0
+        || !(f = flux_kvs_commit (h, NULL, 0, txn))
+        || flux_future_get (f, NULL) < 0)
+        log_err_exit ("kvs unlink %s", kvs->dir);
+    flux_future_destroy (f);
+    flux_kvs_txn_destroy (txn);
+}
+
+static int cmd_kvs (optparse_t *p, int ac, char *av[])
+{
+    flux_t *h = open_or_die ();
+    int count = optparse_get_int (p, "count", 1000);
+    int window = optparse_get_int (p, "window", 64);
+    int size = optparse_get_int (p, "size", 64);
+    struct hist *lat = hist_create_or_die ();
+    struct kvs kvs;
+    struct timespec t0;
+    double elapsed;
+
+    if (asprintf (&kvs.dir, "bench.kvs-%d", (int)getpid ()) < 0)
+        oom ();
+    kvs.val = xzmalloc (size + 1);
+    memset (kvs.val, 'v', size);
+
+    pipeline (h, count, 1, kvs_commit_start, kvs_commit_finish, &kvs, lat);
+    report_latency ("commit-latency", lat);
+
+    monotime (&t0);
+    kvs_put_all (h, &kvs, count);
+    report_rate ("put-throughput", count, monotime_since (t0));
+
+    elapsed = pipeline (h, count, window, kvs_lookup_start,
+                        kvs_lookup_finish, &kvs, NULL);
+    report_rate ("lookup-throughput", count, elapsed);
+
+    hist_clear (lat);
+    kvs_watch (h, &kvs, count / 10, lat);
+    report_latency ("watch-latency", lat);
+
+    kvs_unlink_dir (h, &kvs);
+    free (kvs.val);
+    free (kvs.dir);
+    hist_destroy (lat);
+    flux_close (h);
+    return 0;
+}
+
+/* content: store and load blobs
+ */
+
+struct content {
+    char *buf;
+    int size;
+    char **refs;
+};
+
+static flux_future_t *content_store_start (flux_t *h, int i, void *arg)
+{
+    struct content *c = arg;
+
+    /* Make each blob unique so none are deduplicated.
+     */
+    memcpy (c->buf, &i, sizeof (i));
+    return flux_content_store (h, c->buf, c->size, 0);
+}
+
+static void content_store_finish (flux_future_t *f, int i, void *arg)
+{
+    struct content *c = arg;
+    const char *ref;
+
+    if (flux_content_store_get (f, &ref) < 0)
+        log_err_exit ("content store %d", i);
+    c->refs[i] = xstrdup (ref);
+}
+
+static flux_future_t *content_load_start (flux_t *h, int i, void *arg)
+{
+    struct content *c = arg;
+
+    return flux_content_load (h, c->refs[i], 0);
+}
+
+static void content_load_finish (flux_future_t *f, int i, void *arg)
+{
+    struct content *c = arg;
+    const void *buf;
+    int len;
+
+    if (flux_content_load_get (f, &buf, &len) < 0)
+        log_err_exit ("content load %d", i);
+    if (len != c->size)
+        log_msg_exit ("content load %d: wrong size", i);
+}
+
+static int cmd_content (optparse_t *p, int ac, char *av[])
+{
+    flux_t *h = open_or_die ();
+    int count = optparse_get_int (p, "count", 10000);
+    int window = optparse_get_int (p, "window", 64);
+    struct content c;
+    pid_t pid = getpid ();
+    double elapsed;
+    int i;
+
+    c.size = optparse_get_int (p, "size", 4096);
+    if (c.size < sizeof (int) + sizeof (pid))
+        log_msg_exit ("size must be at least %zu",
+                      sizeof (int) + sizeof (pid));
+    c.buf = xzmalloc (c.size);
+    c.refs = xzmalloc (count * sizeof (c.refs[0]));
+    /* Blobs stored by a previous run would already be cached.
+     */
+    memcpy (c.buf + sizeof (int), &pid, sizeof (pid));
+
+    elapsed = pipeline (h, count, window, content_store_start,
+                        content_store_finish, &c, NULL);
+    report_rate ("store-throughput", count, elapsed);
+    elapsed = pipeline (h, count, window, content_load_start,
+                        content_load_finish, &c, NULL);
+    report_rate ("load-throughput", count, elapsed);
+
+    for (i = 0; i < count; i++)
+        free (c.refs[i]);
+    free (c.refs);
+    free (c.buf);
+    flux_close (h);
+    return 0;
+}
+
+/* spawn: run /bin/true with the broker subprocess server
+ */
+
+struct spawn {
+    flux_t *h;
+    flux_cmd_t *cmd;
+    int rank;
+    int count;
+    int started;
+    int finished;
+    struct timespec t0;
+    struct hist *lat;
+};
+
+static void spawn_next (struct spawn *s);
+
+static void spawn_completion_cb (flux_subprocess_t *p)
+{
+    struct spawn *s = flux_subprocess_aux_get (p, "spawn");
+
+    if (flux_subprocess_exit_code (p) != 0)
+        log_msg_exit ("spawn %d: nonzero exit", s->finished);
+    if (hist_record_since (s->lat, s->t0) < 0)
+        oom ();
+    s->finished++;
+    flux_subprocess_destroy (p);
+    spawn_next (s);
+}
+
+static void spawn_state_cb (flux_subprocess_t *p,
+                            flux_subprocess_state_t state)
+{
+    if (state == FLUX_SUBPROCESS_EXEC_FAILED
+        || state == FLUX_SUBPROCESS_FAILED)
+        log_msg_exit ("spawn: %s", flux_subprocess_state_string (state));
+}
+
+static void spawn_next (struct spawn *s)
+{
+    flux_subprocess_ops_t ops = {
+        .on_completion = spawn_completion_cb,
+        .on_state_change = spawn_state_cb,
+    };
+    flux_subprocess_t *p;
+
+    if (s->started == s->count)
+        return;
+    monotime (&s->t0);
+    if (!(p = flux_rexec (s->h, s->rank, 0, s->cmd, &ops))
+        || flux_subprocess_aux_set (p, "spawn", s, NULL) < 0)
+        log_err_exit ("flux_rexec");
+    s->started++;
+}
+
+static int cmd_spawn (optparse_t *p, int ac, char *av[])
+{
+    char *argv[] = { "/bin/true", NULL };
+    struct spawn s;
+    struct timespec t0;
+    char *cwd;
+
+    memset (&s, 0, sizeof (s));
+    s.h = open_or_die ();
+    s.count = optparse_get_int (p, "count", 100);
+    s.rank = get_rank (p);
+    s.lat = hist_create_or_die ();
+    if (!(s.cmd = flux_cmd_create (1, argv, environ)))
+        log_err_exit ("flux_cmd_create");
+    if (!(cwd = get_current_dir_name ())
+        || flux_cmd_setcwd (s.cmd, cwd) < 0)
+        log_err_exit ("flux_cmd_setcwd");
+
+    monotime (&t0);
+    spawn_next (&s);
+    if (flux_reactor_run (flux_get_reactor (s.h), 0) < 0)
+        log_err_exit ("flux_reactor_run");
+    if (s.finished != s.count)
+        log_msg_exit ("spawn: only %d of %d completed", s.finished, s.count);
+    report_rate ("throughput", s.count, monotime_since (t0));
+    report_latency ("latency", s.lat);
+
+    free (cwd);
+    flux_cmd_destroy (s.cmd);
+    hist_destroy (s.lat);
+    flux_close (s.h);
+    return 0;
+}
+
+static struct optparse_subcommand subcommands[] = {
+    { "rpc",
+      "[-c N] [-s N] [-w N] [-r N]",
+      "Round trip cmb.ping RPCs",
+      cmd_rpc,
+      0,
+      opts,
+    },
+    { "event",
+      "[-c N] [-w N]",
+      "Publish events and receive them back",
+      cmd_event,
+      0,
+      opts,
+    },
+    { "kvs",
+      "[-c N] [-s N] [-w N]",
+      "KVS commit, put, lookup, and watch",
+      cmd_kvs,
+      0,
+      opts,
+    },
+    { "content",
+      "[-c N] [-s N] [-w N]",
+      "Store and load content blobs",
+      cmd_content,
+      0,
+      opts,
+    },
+    { "spawn",
+      "[-c N] [-r N]",
+      "Spawn /bin/true with the broker subprocess server",
+      cmd_spawn,
+      0,
+      opts,
+    },
+    OPTPARSE_SUBCMD_END
+};
+
+int main (int argc, char *argv[])
+{
+    optparse_t *p;
+    int optindex;
+    int exitval;
+
+    log_init ("bench");
+
+    if (!(p = optparse_create ("bench"))
+        || optparse_set (p, OPTPARSE_USAGE, "[OPTIONS] BENCHMARK")
+                != OPTPARSE_SUCCESS
+        || optparse_reg_subcommands (p, subcommands) != OPTPARSE_SUCCESS)
+        log_msg_exit ("optparse setup failed");
+    if ((optindex = optparse_parse_args (p, argc, argv)) < 0)
+        exit (1);
+    if (optindex == argc || !optparse_get_subcommand (p, argv[optindex])) {
+        optparse_print_usage (p);
+        exit (1);
+    }
+    if ((exitval = optparse_run_subcommand (p, argc, argv)) < 0)
+        exit (1);
+    optparse_destroy (p);
+    log_fini ();
+    return exitval;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
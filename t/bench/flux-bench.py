@@ -0,0 +1,258 @@
+#!/usr/bin/env python
+
+###############################################################
+# Copyright 2019 Lawrence Livermore National Security, LLC
+# (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+#
+# This file is part of the Flux resource manager framework.
+# For details, see https://github.com/flux-framework.
+#
+# SPDX-License-Identifier: LGPL-3.0
+###############################################################
+
+# Usage: flux-bench.py [OPTIONS]
+#
+# Start a local instance of --size brokers, run the benchmark matrix in
+# it, and print the results as JSON.  With --baseline, compare against
+# results saved by an earlier run, and exit with status 1 if any result
+# is worse by more than --threshold percent.
+#
+# Each benchmark is run --repeat times and the best value is kept, so
+# a regression has to show up in every run to be reported.
+#
+# Throughput results are in ops/s (higher is better), latencies in
+# microseconds (lower is better).
+#
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+# name, command, default count (scaled by --scale)
+# {bench}, {flux}, and {last} (highest rank) are substituted.
+MATRIX = [
+    ("rpc-local", "{bench} rpc", 10000),
+    ("rpc-remote", "{bench} rpc --rank {last}", 10000),
+    ("event", "{flux} exec -r {last} {bench} event", 10000),
+    ("kvs", "{bench} kvs", 1000),
+    ("kvs-remote", "{flux} exec -r {last} {bench} kvs", 1000),
+    ("content", "{bench} content", 10000),
+    ("spawn-local", "{bench} spawn", 100),
+    ("spawn-remote", "{bench} spawn --rank {last}", 100),
+    ("job", None, 200),
+]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        prog="flux-bench", description="Run the flux-core benchmark suite"
+    )
+    parser.add_argument(
+        "--size", type=int, default=4, help="Number of brokers (default 4)"
+    )
+    parser.add_argument(
+        "--repeat", type=int, default=3, help="Runs per benchmark (default 3)"
+    )
+    parser.add_argument(
+        "--scale",
+        type=float,
+        default=1.0,
+        help="Multiply operation counts by SCALE (default 1.0)",
+    )
+    parser.add_argument(
+        "--filter", metavar="NAME", action="append", help="Only run NAME"
+    )
+    parser.add_argument("--output", metavar="FILE", help="Save results to FILE")
+    parser.add_argument(
+        "--baseline", metavar="FILE", help="Compare with results in FILE"
+    )
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=20.0,
+        help="Fail if a result is worse than baseline by PCT (default 20)",
+    )
+    parser.add_argument("--flux", default="flux", help="Path to flux(1)")
+    parser.add_argument("--bench", default="bench", help="Path to bench")
+    parser.add_argument(
+        "--submitbench", default="submitbench", help="Path to submitbench"
+    )
+    parser.add_argument("--list", action="store_true", help="List benchmarks")
+    parser.add_argument("--inner", action="store_true", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    for name in ("flux", "bench", "submitbench"):
+        path = getattr(args, name)
+        if os.path.sep in path:
+            setattr(args, name, os.path.abspath(path))
+    return args
+
+
+def selected(args):
+    names = [name for name, _, _ in MATRIX]
+    for name in args.filter or []:
+        if name not in names:
+            sys.exit("flux-bench: unknown benchmark: " + name)
+    return [entry for entry in MATRIX if not args.filter or entry[0] in args.filter]
+
+
+def run_job(args, count):
+    """Submit 'count' jobs and wait for all of them to finish.
+    """
+    jobspec = subprocess.check_output(
+        [args.flux, "jobspec", "srun", "-n1", "/bin/true"]
+    )
+    with tempfile.NamedTemporaryFile(suffix=".json") as tmp:
+        tmp.write(jobspec)
+        tmp.flush()
+        t0 = time.time()
+        subprocess.check_call(
+            [args.submitbench, "--repeat", str(count), tmp.name],
+            stdout=open(os.devnull, "w"),
+        )
+        subprocess.check_call([args.flux, "job", "drain"])
+        elapsed = time.time() - t0
+    subprocess.check_call([args.flux, "job", "undrain"])
+    return [{"name": "throughput", "value": count / elapsed, "unit": "ops/s"}]
+
+
+def run_one(args, command, count):
+    if command is None:
+        return run_job(args, count)
+    argv = command.format(
+        bench=args.bench, flux=args.flux, last=args.size - 1
+    ).split()
+    argv += ["--count", str(count)]
+    output = subprocess.check_output(argv).decode("utf-8")
+    return [json.loads(line) for line in output.splitlines() if line]
+
+
+def better(unit, a, b):
+    """Return the better of two values in 'unit'.
+    """
+    return min(a, b) if unit == "us" else max(a, b)
+
+
+def run_matrix(args):
+    results = {}
+    for name, command, count in selected(args):
+        if args.size < 2 and name.endswith("-remote"):
+            continue
+        count = max(1, int(count * args.scale))
+        for _ in range(args.repeat):
+            for res in run_one(args, command, count):
+                key = name + "." + res["name"]
+                if key in results:
+                    res["value"] = better(
+                        res["unit"], results[key]["value"], res["value"]
+                    )
+                results[key] = {"value": res["value"], "unit": res["unit"]}
+            print("flux-bench: " + name + " done", file=sys.stderr)
+    return results
+
+
+def start_instance(args):
+    """Re-run this script inside a new instance, returning its results.
+    """
+    with tempfile.NamedTemporaryFile(suffix=".json") as tmp:
+        argv = [args.flux, "start", "--size=" + str(args.size)]
+        argv += [sys.executable, os.path.abspath(__file__), "--inner"]
+        argv += ["--output", tmp.name]
+        argv += ["--repeat", str(args.repeat), "--scale", str(args.scale)]
+        argv += ["--size", str(args.size)]
+        argv += ["--flux", args.flux, "--bench", args.bench]
+        argv += ["--submitbench", args.submitbench]
+        for name in args.filter or []:
+            argv += ["--filter", name]
+        subprocess.check_call(argv)
+        return json.load(tmp)
+
+
+def compare(baseline, results, threshold):
+    """Print a comparison table and return the number of regressions.
+    """
+    regressions = 0
+    fmt = "{:<32} {:>14} {:>14} {:>8} {}"
+    print(fmt.format("NAME", "BASELINE", "CURRENT", "CHANGE", ""))
+    for key in sorted(baseline):
+        if key not in results:
+            base = "{:.1f}".format(baseline[key]["value"])
+            print(fmt.format(key, base, "-", "-", "missing"))
+            continue
+        base = baseline[key]["value"]
+        cur = results[key]["value"]
+        unit = results[key]["unit"]
+        if base == 0:
+            continue
+        change = 100.0 * (cur - base) / base
+        worse = change if unit == "us" else -change
+        status = ""
+        if worse > threshold:
+            status = "REGRESSION"
+            regressions += 1
+        print(
+            fmt.format(
+                key,
+                "{:.1f}".format(base),
+                "{:.1f}".format(cur),
+                "{:+.1f}%".format(change),
+                status,
+            )
+        )
+    return regressions
+
+
+def main():
+    args = parse_args()
+    if args.list:
+        for name, _, count in MATRIX:
+            print("{:<16} {}".format(name, count))
+        return 0
+    if args.inner:
+        results = run_matrix(args)
+        with open(args.output, "w") as out:
+            json.dump(results, out)
+        return 0
+
+    selected(args)
+    doc = {
+        "size": args.size,
+        "repeat": args.repeat,
+        "scale": args.scale,
+        "results": start_instance(args),
+    }
+    if args.output:
+        with open(args.output, "w") as out:
+            json.dump(doc, out, indent=2, sort_keys=True)
+            out.write("\n")
+    else:
+        print(json.dumps(doc, indent=2, sort_keys=True))
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        for key in ("size", "scale"):
+            if baseline.get(key) != doc[key]:
+                print(
+                    "flux-bench: warning: baseline {} {} differs from {}".format(
+                        key, baseline.get(key), doc[key]
+                    ),
+                    file=sys.stderr,
+                )
+        names = [name for name, _, _ in selected(args)]
+        base = {
+            key: val
+            for key, val in baseline["results"].items()
+            if key.split(".")[0] in names
+        }
+        if compare(base, doc["results"], args.threshold) > 0:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
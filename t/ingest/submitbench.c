@@ -22,12 +22,14 @@
 #include <jansson.h>
 #include <flux/core.h>
 #include <flux/optparse.h>
+#include <flux/idset.h>
 #if HAVE_FLUX_SECURITY
 #include <flux/security/sign.h>
 #endif
 #include "src/common/libutil/log.h"
 #include "src/common/libutil/fluid.h"
 #include "src/common/libjob/job.h"
+#include "src/common/libjob/sign_none.h"
 #include "src/common/libutil/read_all.h"
 
 int cmd_submitbench (optparse_t *p, int argc, char **argv);
@@ -43,6 +45,9 @@ static struct optparse_option opts[] =  {
     { .name = "priority", .key = 'p', .has_arg = 1, .arginfo = "N",
       .usage = "Set job priority (0-31, default=16)",
     },
+    { .name = "ranks", .key = 'N', .has_arg = 1, .arginfo = "IDSET",
+      .usage = "Submit to job-ingest on IDSET ranks, round-robin",
+    },
     { .name = "flags", .key = 'F', .has_arg = 3,
       .flags = OPTPARSE_OPT_AUTOSPLIT,
       .usage = "Set comma-separated flags (e.g. debug)",
@@ -102,7 +107,10 @@ struct submitbench_ctx {
     void *jobspec;
     int jobspecsz;
     const char *J;
+    char *J_none;
     int priority;
+    struct idset *ranks;
+    unsigned int rank;
 };
 
 /* Read entire file 'name' ("-" for stdin).  Exit program on error.
@@ -148,6 +156,38 @@ void submitbench_continuation (flux_future_t *f, void *arg)
     ctx->rxcount++;
 }
 
+/* Send a job-ingest.submit request for the jobspec directly to the next
+ * rank in ctx->ranks.  Unlike flux_job_submit(), which always goes to the
+ * local job-ingest module, this spreads load across ingest ranks.
+ */
+flux_future_t *submit_rank (struct submitbench_ctx *ctx, int flags)
+{
+    const char *J;
+
+    if (ctx->rank != IDSET_INVALID_ID)
+        ctx->rank = idset_next (ctx->ranks, ctx->rank);
+    if (ctx->rank == IDSET_INVALID_ID)
+        ctx->rank = idset_first (ctx->ranks);
+    if ((flags & FLUX_JOB_PRE_SIGNED)) {
+        J = ctx->J;
+        flags &= ~FLUX_JOB_PRE_SIGNED;
+    }
+    else {
+        if (!ctx->J_none) {
+            if (!(ctx->J_none = sign_none_wrap (ctx->jobspec,
+                                                ctx->jobspecsz,
+                                                geteuid ())))
+                return NULL;
+        }
+        J = ctx->J_none;
+    }
+    return flux_rpc_pack (ctx->h, "job-ingest.submit", ctx->rank, 0,
+                          "{s:s s:i s:i}",
+                          "J", J,
+                          "priority", ctx->priority,
+                          "flags", flags);
+}
+
 /* prep - called before event loop would block
  * Prevent loop from blocking if 'check' could send RPCs.
  * Stop the prep/check watchers if RPCs have all been sent,
@@ -191,8 +231,13 @@ void submitbench_check (flux_reactor_t *r, flux_watcher_t *w,
             flags |= FLUX_JOB_PRE_SIGNED;
         }
 #endif
-        if (!(f = flux_job_submit (ctx->h, ctx->J ? ctx->J : ctx->jobspec,
-                                   ctx->priority, flags)))
+        if (ctx->ranks) {
+            if (!(f = submit_rank (ctx, flags)))
+                log_err_exit ("job-ingest.submit rank %u", ctx->rank);
+        }
+        else if (!(f = flux_job_submit (ctx->h,
+                                        ctx->J ? ctx->J : ctx->jobspec,
+                                        ctx->priority, flags)))
             log_err_exit ("flux_job_submit");
         if (flux_future_then (f, -1., submitbench_continuation, ctx) < 0)
             log_err_exit ("flux_future_then");
@@ -235,7 +280,23 @@ int cmd_submitbench (optparse_t *p, int argc, char **argv)
             log_err_exit ("security config %s", flux_security_last_error (ctx.sec));
         ctx.sign_type = optparse_get_str (p, "sign-type", NULL);
     }
+    /* With --ranks, requests are sent directly rather than through
+     * flux_job_submit(), so J must always be signed here.
+     */
+    if (optparse_hasopt (p, "ranks") && !ctx.sec) {
+        if (!(ctx.sec = flux_security_create (0)))
+            log_err_exit ("security");
+        if (flux_security_configure (ctx.sec, NULL) < 0)
+            log_err_exit ("security config %s",
+                          flux_security_last_error (ctx.sec));
+    }
 #endif
+    if (optparse_hasopt (p, "ranks")) {
+        const char *s = optparse_get_str (p, "ranks", NULL);
+        if (!(ctx.ranks = idset_decode (s)) || idset_count (ctx.ranks) == 0)
+            log_msg_exit ("invalid --ranks idset: %s", s);
+        ctx.rank = IDSET_INVALID_ID;
+    }
     if (!(ctx.h = flux_open (NULL, 0)))
         log_err_exit ("flux_open");
     r = flux_get_reactor (ctx.h);
@@ -262,6 +323,8 @@ int cmd_submitbench (optparse_t *p, int argc, char **argv)
     flux_security_destroy (ctx.sec); // invalidates ctx.J
 #endif
     flux_close (ctx.h);
+    idset_destroy (ctx.ranks);
+    free (ctx.J_none);
     free (ctx.jobspec);
     return 0;
 }
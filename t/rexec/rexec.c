@@ -30,6 +30,8 @@ static struct optparse_option cmdopts[] = {
       .usage = "Output state changes as they occur" },
     { .name = "stdin2stream", .key = 'i', .has_arg = 1, .arginfo = "CHANNEL",
       .usage = "Read in stdin and forward to subprocess channel" },
+    { .name = "setopt", .key = 'o', .has_arg = 1, .arginfo = "NAME=VAL",
+      .usage = "Set subprocess command option NAME to VAL" },
     OPTPARSE_TABLE_END
 };
 
@@ -132,6 +134,19 @@ int main (int argc, char *argv[])
     if (flux_cmd_setcwd (cmd, cwd) < 0)
         log_err_exit ("flux_cmd_setcwd");
 
+    while ((optargp = optparse_getopt_next (opts, "setopt"))) {
+        char *var, *val;
+
+        if (!(var = strdup (optargp)))
+            log_err_exit ("strdup");
+        if (!(val = strchr (var, '=')))
+            log_msg_exit ("--setopt: expected NAME=VAL");
+        *val++ = '\0';
+        if (flux_cmd_setopt (cmd, var, val) < 0)
+            log_err_exit ("flux_cmd_setopt");
+        free (var);
+    }
+
     if (optparse_getopt (opts, "stdin2stream", &optargp) > 0) {
         if (strcmp (optargp, "STDIN")
             && strcmp (optargp, "STDOUT")
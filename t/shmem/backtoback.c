@@ -13,13 +13,20 @@
 #include <flux/core.h>
 
 #include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/monotime.h"
 #include "src/common/libtap/tap.h"
 
+#define STREAM_COUNT 100000
+
 int main (int argc, char *argv[])
 {
     flux_t *h_cli, *h_srv;
     flux_msg_t *msg;
     int type;
+    struct timespec t0;
+    uint32_t matchtag;
+    int i, errors;
+    double elapsed;
 
     plan (NO_PLAN);
 
@@ -56,6 +63,31 @@ int main (int argc, char *argv[])
         "message is correct type");
     flux_msg_destroy (msg);
 
+    /* Baseline for comparison with the broker's modpipe transport
+     * (src/broker/test/modpipe.c).
+     */
+    if (!(msg = flux_request_encode ("test.stream", NULL)))
+        BAIL_OUT ("flux_request_encode failed");
+    errors = 0;
+    monotime (&t0);
+    for (i = 0; i < STREAM_COUNT; i++) {
+        flux_msg_t *rmsg;
+        if (flux_msg_set_matchtag (msg, i) < 0
+                || flux_send (h_cli, msg, 0) < 0
+                || !(rmsg = flux_recv (h_srv, FLUX_MATCH_ANY, 0))) {
+            errors++;
+            break;
+        }
+        if (flux_msg_get_matchtag (rmsg, &matchtag) < 0 || matchtag != i)
+            errors++;
+        flux_msg_destroy (rmsg);
+    }
+    elapsed = monotime_since (t0) / 1000;
+    flux_msg_destroy (msg);
+    ok (i == STREAM_COUNT && errors == 0,
+        "streamed %d requests in order", i);
+    diag ("%.0f msg/s", elapsed > 0 ? i / elapsed : 0);
+
     flux_close (h_cli);
     flux_close (h_srv);
 
@@ -176,6 +176,22 @@ test_expect_success 'tbon.parent-endpoint can be read on not rank 0' '
        NUM=`flux start --size 4 flux exec -n flux getattr tbon.parent-endpoint | grep ipc | wc -l` &&
        test $NUM -eq 3
 '
+test_expect_success 'flux-start sets boot.pmi-barrier=0 on brokers' '
+	NUM=`flux start --size 4 flux exec flux getattr boot.pmi-barrier | grep "^0" | wc -l` &&
+	test $NUM -eq 4
+'
+test_expect_success 'instance wires up with boot.pmi-barrier=1' '
+	flux start --size 4 -o,--setattr=boot.pmi-barrier=1 \
+		flux getattr boot.pmi-barrier >pmi-barrier.out &&
+	echo 1 >pmi-barrier.exp &&
+	test_cmp pmi-barrier.exp pmi-barrier.out
+'
+test_expect_success 'boot.pmi-time and boot.wireup-time can be read' '
+	flux start --size 4 bash -c \
+		"flux getattr boot.pmi-time && flux getattr boot.wireup-time" \
+		>boot-time.out &&
+	test $(wc -l <boot-time.out) -eq 2
+'
 test_expect_success 'flux start --bootstrap=pmi (singlton) cleans up rundir' '
 	flux start ${ARGS} --bootstrap=pmi \
 		flux getattr rundir >rundir_pmi.out &&
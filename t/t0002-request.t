@@ -76,6 +76,22 @@ test_expect_success 'request: 10K responses received in order, with deferrals' '
 	${FLUX_BUILD_DIR}/t/request/treq putmsg 
 '
 
+test_expect_success 'request: modules use queue transport by default' '
+	test "$(flux getattr broker.module-transport)" = "queue"
+'
+
+test_expect_success 'request: 10K responses received in order over inproc transport' '
+	flux start -o,-Sbroker.module-transport=inproc \
+		"flux module load ${FLUX_BUILD_DIR}/t/request/.libs/req.so && \
+		 ${FLUX_BUILD_DIR}/t/request/treq nsrc && \
+		 flux getattr broker.module-transport" >inproc.out &&
+	test "$(tail -1 inproc.out)" = "inproc"
+'
+
+test_expect_success 'request: invalid module transport fails broker startup' '
+	test_must_fail flux start -o,-Sbroker.module-transport=foo /bin/true
+'
+
 test_expect_success 'request: proxy ping 0 from 1 is 4 hops' '
 	${FLUX_BUILD_DIR}/t/request/treq --rank 1 pingzero | grep hops=4
 '
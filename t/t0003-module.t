@@ -271,6 +271,21 @@ test_expect_success 'flux module stats --rusage works' '
 	grep -q nivcsw rusage.stats
 '
 
+test_expect_success 'flux module stats includes rpc latency histogram' '
+	flux module stats --parse "rpc latency (us)" $TESTMOD >rpc.stats &&
+	grep -q "\"count\"" rpc.stats &&
+	grep -q "\"p99\"" rpc.stats
+'
+
+test_expect_success 'flux module stats --all merges stats over ranks' '
+	flux event pub xyz &&
+	EVENT_TX=$(flux module stats --rank 0 --parse "#event (tx)" $TESTMOD) &&
+	EVENT_TX_ALL=$(flux module stats --all --parse "#event (tx)" $TESTMOD) &&
+	test "$EVENT_TX_ALL" -ge "$EVENT_TX" &&
+	flux module stats --all --parse "rpc latency (us)" $TESTMOD >rpc.all &&
+	grep -q "\"buckets\"" rpc.all
+'
+
 test_expect_success 'flux module stats --rusage --parse maxrss works' '
 	RSS=$(flux module stats --rusage --parse maxrss $TESTMOD) &&
 	test "$RSS" -gt 0
@@ -115,6 +115,44 @@ test_expect_success 'basic rexec stdin / stdout long lines' '
         test_cmp expected output
 '
 
+test_expect_success 'rexec binary output is passed through intact' '
+        dd if=/dev/urandom of=random.bin bs=4096 count=256 &&
+        ${FLUX_BUILD_DIR}/t/rexec/rexec -r 1 cat random.bin > output.bin &&
+        cmp random.bin output.bin
+'
+
+test_expect_success 'rexec large output is flow controlled' '
+        seq 1 500000 > expected &&
+        ${FLUX_BUILD_DIR}/t/rexec/rexec -r 1 -o STDOUT_BUFSIZE=4096 \
+                cat expected > output &&
+        test_cmp expected output
+'
+
+test_expect_success 'rexec output coalescing works' '
+        seq 1 10000 > expected &&
+        ${FLUX_BUILD_DIR}/t/rexec/rexec -r 1 -o STDOUT_COALESCE=0.01 \
+                cat expected > output &&
+        test_cmp expected output
+'
+
+test_expect_success 'rexec output coalescing flushes partial line' '
+        printf "foo\nbar" > expected &&
+        ${FLUX_BUILD_DIR}/t/rexec/rexec -r 1 -o STDOUT_COALESCE=0.01 \
+                cat expected > output &&
+        test_cmp expected output
+'
+
+test_expect_success 'rexec invalid coalescing option fails' '
+        test_must_fail ${FLUX_BUILD_DIR}/t/rexec/rexec \
+                -o STDOUT_COALESCE=foo /bin/true
+'
+
+test_expect_success 'flux exec large output works' '
+        seq 1 1000000 > expected &&
+        flux exec -r 1 cat expected > output &&
+        test_cmp expected output
+'
+
 # pipe in /dev/null, we don't care about stdin for this test
 test_expect_success 'rexec check channel FD created' '
 	${FLUX_BUILD_DIR}/t/rexec/rexec -i TEST_CHANNEL /usr/bin/env < /dev/null > output 2>&1 &&
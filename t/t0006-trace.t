@@ -0,0 +1,59 @@
+#!/bin/sh
+#
+
+test_description='Test the sampling message tracer
+
+Verify cmb.trace.sample, cmb.trace.drain, and the flux-trace command.
+'
+
+. `dirname $0`/sharness.sh
+SIZE=4
+test_under_flux ${SIZE} minimal
+
+test_expect_success 'flux trace shows nothing when tracing is disabled' '
+	flux ping --count 2 --interval 0 cmb &&
+	flux trace --raw >raw.out &&
+	test $(wc -l <raw.out) -eq 1
+'
+
+test_expect_success 'flux trace --sample enables tracing on all ranks' '
+	flux trace --sample 1 &&
+	flux ping --count 5 --interval 0 cmb &&
+	flux ping --rank 1 --count 5 --interval 0 cmb &&
+	flux trace >spans.out &&
+	head -1 spans.out | grep -q "^TIME.*TOPIC.*CLIENT.*SERVER.*RTT"
+'
+
+test_expect_success 'flux trace shows local cmb.ping spans with timing' '
+	awk "\$2 == \"cmb.ping\" && \$4 ~ /^0\\./ && \$5 != \"-\" && \$6 != \"-\"" \
+		spans.out >local.out &&
+	test $(wc -l <local.out) -ge 5
+'
+
+test_expect_success 'flux trace links spans across brokers' '
+	awk "\$2 == \"cmb.ping\" && \$3 ~ /^0\\./ && \$4 ~ /^1\\./" \
+		spans.out >remote.out &&
+	test $(wc -l <remote.out) -ge 5
+'
+
+test_expect_success 'flux trace drained the records' '
+	flux trace --sample 0 &&
+	flux trace --raw >raw.out &&
+	test $(wc -l <raw.out) -eq 1
+'
+
+test_expect_success 'flux trace --rank drains only one rank' '
+	flux trace --sample 1 &&
+	flux ping --rank 1 --count 3 --interval 0 cmb &&
+	flux trace --sample 0 &&
+	flux trace --rank 1 --raw >raw.out &&
+	tail -n +2 raw.out | awk "{print \$2}" | grep -v "^1\\." >other.out;
+	test_must_be_empty other.out &&
+	grep -q "recv.*request.*cmb.ping" raw.out
+'
+
+test_expect_success 'flux trace --sample fails with negative sample' '
+	test_must_fail flux trace --sample -1
+'
+
+test_done
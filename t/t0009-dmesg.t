@@ -94,5 +94,32 @@ test_expect_success 'dmesg request with empty payload fails with EPROTO(71)' '
 test_expect_success 'clear request with empty payload fails with EPROTO(71)' '
 	${RPC} log.clear 71 </dev/null
 '
+test_expect_success 'non-streaming dmesg request fails with EPROTO(71)' '
+	echo "{\"seq\":-1, \"follow\":false}" | ${RPC} log.dmesg 71
+'
+test_expect_success 'flux dmesg --follow prints new entries' '
+	flux dmesg --follow >follow.out &
+	pid=$! &&
+	flux logger hello_follow &&
+	count=0 &&
+	while ! grep -q hello_follow follow.out && test $count -lt 50; do
+		sleep 0.1
+		count=$(($count+1))
+	done &&
+	kill $pid &&
+	grep -q hello_follow follow.out
+'
+test_expect_success 'log-forward-rate rejects negative rate' '
+	test_must_fail flux setattr log-forward-rate -1
+'
+test_expect_success 'log-forward-rate limits entries forwarded upstream' '
+	OLD_RATE=$(flux exec -r 1 flux getattr log-forward-rate) &&
+	flux exec -r 1 flux setattr log-forward-rate 10 &&
+	flux exec -r 1 sh -c "for i in \$(seq 1 200); do \
+		flux logger --appname=ratetest \$i; done" &&
+	flux exec -r 1 flux setattr log-forward-rate $OLD_RATE &&
+	test $(flux exec -r 1 flux getattr log-forward-dropped) -gt 0 &&
+	flux exec -r 1 flux dmesg | grep "log-forward-rate exceeded"
+'
 
 test_done
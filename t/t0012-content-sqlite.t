@@ -37,6 +37,14 @@ test_expect_success 'store 100 blobs on rank 0' '
         test $TOTAL -ge 100
 '
 
+test_expect_success 'backing store latency is reported' '
+	flux content flush &&
+	STORES=`flux module stats --parse "store (us).count" content-sqlite` &&
+	test $STORES -ge 100 &&
+	STORES=`flux module stats --parse "store (us).count" content` &&
+	test $STORES -ge 100
+'
+
 # Store directly to content service
 # Verify directly from content service
 
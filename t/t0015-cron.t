@@ -327,6 +327,36 @@ test_expect_success 'sync request with empty payload fails with EPROTO(71)' '
 	${RPC} cron.sync 71 </dev/null
 '
 
+test_expect_success 'cron interval --jitter --class sets entry options' '
+    id=$(flux_cron interval -j 2s -C slow 1h true) &&
+    flux cron dump ${id} | grep "^jitter = 2" &&
+    cron_entry_check ${id} class slow &&
+    flux cron delete ${id}
+'
+test_expect_success 'cron interval with negative --jitter fails' '
+    test_must_fail flux cron interval -j -1s 1h true
+'
+test_expect_success 'reload cron module with class-limit=serial:1' '
+    flux module remove cron &&
+    flux module load cron class-limit=serial:1
+'
+test_expect_success 'tasks of a class at its limit do not run concurrently' '
+    lock=$(pwd)/serial.lock &&
+    cmd="mkdir $lock && sleep 0.1 && rmdir $lock" &&
+    id1=$(flux_cron interval -C serial -c 3 0.05s "$cmd") &&
+    id2=$(flux_cron interval -C serial -c 3 0.05s "$cmd") &&
+    for i in $(seq 1 50); do
+        test "$(flux cron dump --key=stats.success ${id1})" = "3" &&
+        test "$(flux cron dump --key=stats.success ${id2})" = "3" && break
+        sleep 0.1
+    done &&
+    cron_entry_check ${id1} stats.failure 0 &&
+    cron_entry_check ${id2} stats.failure 0 &&
+    cron_entry_check ${id1} stats.success 3 &&
+    cron_entry_check ${id2} stats.success 3 &&
+    flux cron delete ${id1} &&
+    flux cron delete ${id2}
+'
 test_expect_success 'flux module remove cron' '
     flux module remove cron
 '
@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+
+test_description='Test broker per-topic message statistics
+
+Verify cmb.stats and the flux-stats command.
+'
+
+. `dirname $0`/sharness.sh
+SIZE=4
+test_under_flux ${SIZE} minimal
+
+# Usage: column TOPIC N [FILE]
+# Print column N of the flux-stats table row for TOPIC.
+column() {
+	awk -v topic=$1 -v n=$2 '$1 == topic { print $n }' ${3:-stats.out}
+}
+
+test_expect_success 'flux stats works' '
+	flux stats >stats.out &&
+	head -1 stats.out | grep -q "^TOPIC.*REQUEST.*RESPONSE.*EVENT"
+'
+
+test_expect_success 'flux stats --json works' '
+	flux stats --json >stats.json &&
+	grep -q "\"max-topics\"" stats.json &&
+	grep -q "\"sources\"" stats.json &&
+	grep -q "\"cmb.stats\"" stats.json
+'
+
+test_expect_success 'flux stats --diff counts exactly the messages sent' '
+	flux stats --json >before.json &&
+	flux ping --count 10 --interval 0 cmb &&
+	flux stats --diff before.json >stats.out &&
+	test $(column cmb.ping 2) -eq 10 &&
+	test $(column cmb.ping 3) -eq 10
+'
+
+test_expect_success 'flux stats shows queueing delay of messages from modules' '
+	test "$(column cmb.ping 6)" != "-"
+'
+
+test_expect_success 'flux stats --rank works' '
+	flux ping --rank 1 --count 5 --interval 0 cmb &&
+	flux stats --rank 1 >stats.rank1 &&
+	test $(column cmb.ping 2 stats.rank1) -ge 5
+'
+
+test_expect_success 'flux stats --all sums over ranks' '
+	flux stats --rank 0 >stats.rank0 &&
+	flux stats --all >stats.all &&
+	test $(column cmb.ping 2 stats.all) -ge \
+		$(($(column cmb.ping 2 stats.rank0) + 5))
+'
+
+test_expect_success 'flux stats --sort topic --limit 2 works' '
+	flux stats --sort topic --limit 2 >stats.out &&
+	test $(wc -l <stats.out) -eq 3 &&
+	tail -2 stats.out | cut -d" " -f1 >topics.out &&
+	sort topics.out | test_cmp topics.out -
+'
+
+test_expect_success 'flux stats --sort fails with unknown key' '
+	test_must_fail flux stats --sort nokey
+'
+
+test_expect_success 'flux stats --rank and --all are mutually exclusive' '
+	test_must_fail flux stats --rank 0 --all
+'
+
+test_expect_success 'flux stats --diff fails with a newer snapshot' '
+	flux stats --json >after.json &&
+	flux stats --rank 1 --json >rank1.json &&
+	test_must_fail flux stats --rank 1 --diff after.json
+'
+
+test_done
@@ -495,6 +495,53 @@ test_expect_success 'kvs: clear stats globally' '
         flux exec -n sh -c "flux module stats --parse \"namespace.primary.#no-op stores\" kvs | grep -q 0"
 '
 
+test_expect_success 'kvs: stats include transaction latency histogram' '
+        flux module stats -c kvs &&
+        flux kvs put $DIR.latency=1 &&
+        COUNT=$(flux module stats --parse "latency (us).transaction.count" kvs) &&
+        test $COUNT -eq 1 &&
+        flux module stats --parse "latency (us).transaction" kvs >txn.latency &&
+        grep -q "\"p99\"" txn.latency &&
+        grep -q "\"buckets\"" txn.latency
+'
+
+test_expect_success 'kvs: stats --all merges latency from all ranks' '
+        flux module stats -C kvs &&
+        for i in `seq 0 $((${SIZE} - 1))`; do
+            flux exec -n -r $i flux kvs put $DIR.latency$i=1
+        done &&
+        COUNT=$(flux module stats --all --parse "latency (us).transaction.count" kvs) &&
+        test $COUNT -ge ${SIZE}
+'
+
+#
+# test path cache
+#
+
+test_expect_success 'kvs: repeated lookups hit the path cache' '
+        flux kvs put $DIR.pathcache.a=1 &&
+        flux module stats -c kvs &&
+        flux kvs get $DIR.pathcache.a &&
+        flux kvs get $DIR.pathcache.a &&
+        ! flux module stats --parse "pathcache.#hits" kvs | grep -q "^0$"
+'
+
+test_expect_success 'kvs: path cache is invalidated by writes' '
+        flux kvs put $DIR.pathcache.a=2 &&
+        test $(flux kvs get $DIR.pathcache.a) = 2 &&
+        flux kvs put $DIR.pathcache=3 &&
+        test_must_fail flux kvs get $DIR.pathcache.a &&
+        test $(flux kvs get $DIR.pathcache) = 3
+'
+
+test_expect_success 'kvs: path cache is invalidated by writes through symlinks' '
+        flux kvs put $DIR.pathcache-dir.a=1 &&
+        flux kvs link $DIR.pathcache-dir $DIR.pathcache-link &&
+        test $(flux kvs get $DIR.pathcache-dir.a) = 1 &&
+        flux kvs put $DIR.pathcache-link.a=2 &&
+        test $(flux kvs get $DIR.pathcache-dir.a) = 2
+'
+
 #
 # test fence api
 #
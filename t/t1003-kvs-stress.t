@@ -130,4 +130,22 @@ test_expect_success 'kvs: transaction-merge disabling works' '
 	test "$OUTPUT" = "${THREADS}"
 '
 
+# lookup-threads option test
+test_expect_success 'kvs: lookups work with lookup-threads=4' '
+        flux module remove -r 0 kvs &&
+        flux module load -r 0 kvs lookup-threads=4 &&
+        ${FLUX_BUILD_DIR}/t/kvs/dtree -h3 -w16 --prefix $DIR.lookupthreads &&
+        test $(flux kvs dir -R $DIR.lookupthreads | wc -l) = 4096 &&
+        flux kvs namespace create lookupthreads-ns &&
+        flux kvs put --namespace=lookupthreads-ns val=42 &&
+        flux kvs link --target-namespace=lookupthreads-ns val $DIR.nslink &&
+        test $(flux kvs get $DIR.nslink) = 42 &&
+        flux kvs namespace remove lookupthreads-ns
+'
+
+test_expect_success 'kvs: lookup errors work with lookup-threads=4' '
+        test_must_fail flux kvs get $DIR.lookupthreads.noexist &&
+        test_must_fail flux kvs get --namespace=noexist $DIR.lookupthreads
+'
+
 test_done
@@ -50,6 +50,21 @@ test_expect_success 'barrier: succeeds with name=NULL inside SLURM step' '
         SLURM_STEPID=1 && export SLURM_STEPID &&
 	flux exec -n ${tbarrier} --nprocs ${SIZE}
 '
+test_expect_success 'barrier: multiple clients per broker (all ranks)' '
+	flux exec -n ${tbarrier} --clients 4 --nprocs $((${SIZE}*4)) multi
+'
+
+test_expect_success 'barrier: clients spread unevenly over brokers' '
+	flux exec -n -r 2 ${tbarrier} --clients 3 --nprocs 4 uneven &
+	pid=$! &&
+	flux exec -n -r 1 ${tbarrier} --nprocs 4 uneven &&
+	wait $pid
+'
+
+test_expect_success 'barrier: nprocs not a multiple of size' '
+	flux exec -n -r 0-2 ${tbarrier} --nprocs 3 nodiv
+'
+
 test_expect_success 'enter request with empty payload fails with EPROTO(71)' '
 	${RPC} barrier.enter 71 </dev/null
 '
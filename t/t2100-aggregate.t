@@ -81,6 +81,26 @@ test_expect_success 'flux-aggregate: --fwd-count works' '
         ".count == 8 and .total == 8 and .min == 1 and .max == 1"
 '
 
+test_expect_success 'flux-aggregate: equal objects share one entry' '
+    run_timeout 5 flux exec -n -r 0-3 flux aggregate test \
+                  "{\"a\":1, \"b\":[1,2]}" &
+    pid=$! &&
+    run_timeout 5 flux exec -n -r 4-7 flux aggregate test \
+                  "{\"b\":[1,2], \"a\":1}" &&
+    wait $pid &&
+    kvs_json_check test ".count == 8" &&
+    kvs_json_check test "(.entries | length) == 1" &&
+    kvs_json_check test ".entries.\"[0-7]\".a == 1"
+'
+
+test_expect_success 'flux-aggregate: many concurrent aggregates all sink' '
+    run_timeout 10 flux exec -n -r 0-7 bash -c \
+     "for k in a b c d e f g h; do flux aggregate multi.\$k 1 & done; wait" &&
+    for k in a b c d e f g h; do
+        kvs_json_check multi.$k ".count == 8 and .total == 8" || return 1
+    done
+'
+
 test_expect_success 'push request with empty payload fails with EPROTO(71)' '
 	${RPC} aggregator.push 71 </dev/null
 '
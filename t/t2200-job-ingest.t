@@ -137,6 +137,46 @@ test_expect_success 'submit request with empty payload fails with EPROTO(71)' '
 	${RPC} job-ingest.submit 71 </dev/null
 '
 
+test_expect_success 'job-ingest: submit job 100 times to all ranks' '
+	${SUBMITBENCH} -r 100 --ranks=0-3 use_case_2.6.json >allranks.out &&
+	test $(sort -u allranks.out | wc -l) -eq 100
+'
+
+test_expect_success 'job-ingest: stats.get reports bytes copied per job' '
+	${RPC} job-ingest.stats.get </dev/null >stats.out &&
+	grep -q "\"bytes_copied_per_job\"" stats.out &&
+	! grep -qE "\"jobs\": ?0," stats.out
+'
+
+test_expect_success 'job-ingest: reload job-ingest in sharded mode' '
+	flux module remove -r all job-ingest &&
+	flux module load -r all job-ingest sharded
+'
+
+test_expect_success 'job-ingest: sharded jobspec stored accurately in KVS' '
+	jobid=$(flux exec -r 3 flux job submit basic.json) &&
+	kvsdir=$(flux job id --to=kvs $jobid) &&
+	flux kvs get --raw ${kvsdir}.jobspec >jobspec.sharded.out &&
+	test_cmp basic.json jobspec.sharded.out
+'
+
+test_expect_success 'job-ingest: sharded submit event logged' '
+	jobid=$(flux exec -r 2 flux job submit --priority=12 basic.json) &&
+	flux job eventlog $jobid |grep submit >eventlog.sharded.out &&
+	grep -q priority=12 eventlog.sharded.out
+'
+
+test_expect_success 'job-ingest: sharded submit job 100 times to all ranks' '
+	${SUBMITBENCH} -r 100 --ranks=0-3 use_case_2.6.json >sharded.out &&
+	test $(sort -u sharded.out | wc -l) -eq 100
+'
+
+test_expect_success 'job-ingest: unknown module option fails' '
+	flux module remove -r 0 job-ingest &&
+	test_must_fail flux module load -r 0 job-ingest badopt &&
+	flux module load -r 0 job-ingest sharded
+'
+
 test_expect_success 'job-ingest: remove modules' '
 	flux module remove -r 0 job-manager &&
 	flux module remove -r all job-info &&
@@ -121,6 +121,25 @@ test_expect_success 'job-manager: flux job list --count shows highest priority j
 	test_cmp list3_lim2.exp list3_lim2.out
 '
 
+test_expect_success 'job-manager: flux job list --states=SCHED lists all jobs' '
+	flux job list -s --states=SCHED >list3_sched.out &&
+	test_cmp list3.out list3_sched.out
+'
+
+test_expect_success 'job-manager: flux job list --states=RUN,CLEANUP lists no jobs' '
+	test $(flux job list -s --states=RUN,CLEANUP | wc -l) -eq 0
+'
+
+test_expect_success 'job-manager: flux job list --states=badstate fails' '
+	test_must_fail flux job list --states=badstate
+'
+
+test_expect_success 'job-manager: flux job list --user filters by userid' '
+	flux job list -s --user=$(id -u) >list3_user.out &&
+	test_cmp list3.out list3_user.out &&
+	test $(flux job list -s --user=$(($(id -u)+1)) | wc -l) -eq 0
+'
+
 test_expect_success 'job-manager: cancel jobs' '
 	for jobid in $(cut -f1 <list3.out); do \
 		flux job cancel ${jobid}; \
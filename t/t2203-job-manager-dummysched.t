@@ -140,6 +140,14 @@ test_expect_success 'job-manager: simulate alloc failure' '
 	grep -q DEBUG_FAIL_ALLOC ev6.out
 '
 
+test_expect_success 'job-manager: stats report alloc latency' '
+	ALLOCS=$(flux module stats --parse "alloc (us).count" job-manager) &&
+	test $ALLOCS -ge 5 &&
+	flux module stats -c job-manager &&
+	ALLOCS=$(flux module stats --parse "alloc (us).count" job-manager) &&
+	test $ALLOCS -eq 0
+'
+
 test_expect_success 'job-manager: remove sched-dummy' '
 	flux module remove -r 0 sched-dummy
 '
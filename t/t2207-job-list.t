@@ -0,0 +1,106 @@
+#!/bin/sh
+
+test_description='Test flux job list service'
+
+. $(dirname $0)/sharness.sh
+
+test_under_flux 4 job
+
+RPC=${FLUX_BUILD_DIR}/t/request/rpc
+
+#  Set path to jq
+#
+jq=$(which jq 2>/dev/null)
+if test -z "$jq"; then
+    skip_all='jq not found. Skipping all tests'
+    test_done
+fi
+
+# Usage: list_jobs payload
+list_jobs() {
+	echo "$1" | ${RPC} job-list.list
+}
+
+# Usage: wait_inactive N
+# Poll job-list stats until N jobs are inactive
+wait_inactive() {
+	i=0
+	while [ "$(${RPC} job-list.stats.get </dev/null | $jq .inactive)" != "$1" ] \
+	      && [ $i -lt 50 ]
+	do
+		sleep 0.1
+		i=$((i + 1))
+	done
+	test "$i" -lt 50
+}
+
+test_expect_success 'job-list: generate jobspec for simple test job' '
+	flux jobspec --format json srun -N1 hostname > test.json
+'
+
+test_expect_success 'job-list: submit 4 jobs, cancel 2' '
+	for i in $(seq 1 4); do \
+		flux job submit test.json >>submit.out; \
+	done &&
+	for jobid in $(head -2 submit.out); do \
+		flux job cancel ${jobid} && \
+		flux job wait-event ${jobid} clean; \
+	done
+'
+
+test_expect_success 'job-list: stats show 2 inactive jobs' '
+	wait_inactive 2 &&
+	${RPC} job-list.stats.get </dev/null | $jq -e ".jobs == 4"
+'
+
+test_expect_success 'job-list: list returns all jobs, newest first' '
+	list_jobs "{}" | $jq -r ".jobs[].id" >list_all.out &&
+	tac submit.out >list_all.exp &&
+	test_cmp list_all.exp list_all.out
+'
+
+test_expect_success 'job-list: list states=INACTIVE returns canceled jobs' '
+	list_jobs "{\"states\":32}" | $jq -r ".jobs[].id" >list_inactive.out &&
+	head -2 submit.out | tac >list_inactive.exp &&
+	test_cmp list_inactive.exp list_inactive.out
+'
+
+test_expect_success 'job-list: list max_entries=1 returns newest job' '
+	list_jobs "{\"max_entries\":1}" | $jq -r ".jobs[].id" >list_max.out &&
+	tail -1 submit.out >list_max.exp &&
+	test_cmp list_max.exp list_max.out
+'
+
+test_expect_success 'job-list: list userid filters by owner' '
+	list_jobs "{\"userid\":$(id -u)}" | $jq -e ".jobs | length == 4" &&
+	list_jobs "{\"userid\":$(($(id -u)+1))}" | $jq -e ".jobs | length == 0"
+'
+
+test_expect_success 'job-list: list with malformed payload fails with EPROTO(71)' '
+	echo "{\"max_entries\":\"foo\"}" | ${RPC} job-list.list 71
+'
+
+test_expect_success 'job-list: cancel remaining jobs' '
+	for jobid in $(tail -2 submit.out); do \
+		flux job cancel ${jobid} && \
+		flux job wait-event ${jobid} clean; \
+	done &&
+	wait_inactive 4
+'
+
+test_expect_success 'job-list: reload with max-inactive=1 purges old jobs' '
+	flux module remove job-list &&
+	flux module load job-list max-inactive=1 &&
+	for i in $(seq 1 2); do \
+		jobid=$(flux job submit test.json) && \
+		flux job cancel ${jobid} && \
+		flux job wait-event ${jobid} clean && \
+		echo ${jobid} >submit2.out; \
+	done &&
+	wait_inactive 1 &&
+	${RPC} job-list.stats.get </dev/null | $jq -e ".purged == 1" &&
+	list_jobs "{}" | $jq -r ".jobs[].id" >list_purged.out &&
+	test_cmp submit2.out list_purged.out
+'
+
+test_done
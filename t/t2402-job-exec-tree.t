@@ -0,0 +1,82 @@
+#!/bin/sh
+
+test_description='Test flux job execution service with tree-based launch'
+
+. $(dirname $0)/sharness.sh
+
+test_under_flux 4 job
+
+flux setattr log-stderr-level 1
+
+hwloc_fake_config='{"0-3":{"Core":2,"cpuset":"0-1"}}'
+
+job_kvsdir()    { flux job id --to=kvs $1; }
+exec_eventlog() { flux kvs get -r $(job_kvsdir $1).guest.exec.eventlog; }
+
+test_expect_success 'job-exec: load job-exec in tree mode on all ranks' '
+	flux kvs put resource.hwloc.by_rank="$hwloc_fake_config" &&
+	flux module load -r 0 sched-simple &&
+	flux module load -r all job-exec mode=tree
+'
+test_expect_success 'job-exec: job on all ranks runs and finishes' '
+	jobid=$(flux jobspec srun -N4 -n4 true | flux job submit) &&
+	flux job wait-event -t 10 ${jobid} start &&
+	flux job wait-event -t 10 ${jobid} finish | grep status=0 &&
+	flux job wait-event -t 10 ${jobid} clean &&
+	exec_eventlog ${jobid} | grep running
+'
+test_expect_success 'job-exec: one shell is started on each rank' '
+	cat >rank.sh <<-EOT &&
+	#!/bin/sh
+	flux getattr rank >>ranks.out
+	EOT
+	chmod +x rank.sh &&
+	jobid=$(flux jobspec srun -N4 -n4 $(pwd)/rank.sh | flux job submit) &&
+	flux job wait-event -t 10 ${jobid} clean &&
+	sort -n ranks.out >ranks.sorted &&
+	test_debug "cat ranks.sorted" &&
+	printf "0\n1\n2\n3\n" >ranks.expected &&
+	test_cmp ranks.expected ranks.sorted
+'
+test_expect_success 'job-exec: nonzero exit status is reported' '
+	jobid=$(flux jobspec srun -N4 -n4 false | flux job submit) &&
+	flux job wait-event -t 10 ${jobid} finish | grep status=256 &&
+	flux job wait-event -t 10 ${jobid} clean
+'
+test_expect_success 'job-exec: canceling job kills shells on all ranks' '
+	jobid=$(flux jobspec srun -N4 -n4 sleep 300 | flux job submit) &&
+	flux job wait-event -t 10 ${jobid} start &&
+	flux job cancel ${jobid} &&
+	flux job wait-event -t 10 ${jobid} exception &&
+	flux job wait-event -t 10 ${jobid} finish | grep status=9 &&
+	flux job wait-event -t 10 ${jobid} clean
+'
+test_expect_success 'job-exec: exec failure raises exec exception' '
+	jobid=$(flux jobspec srun -N4 -n4 /nonexistent/cmd | flux job submit) &&
+	flux job wait-event -t 10 ${jobid} exception >exception.out &&
+	grep "type=\"exec\"" exception.out &&
+	flux job wait-event -t 10 ${jobid} clean
+'
+test_expect_success 'job-exec: job-shell option runs shell with jobid' '
+	cat >shell.sh <<-EOT &&
+	#!/bin/sh
+	echo \$1 >>shell.out
+	EOT
+	chmod +x shell.sh &&
+	flux module remove -r all job-exec &&
+	flux module load -r all job-exec mode=tree job-shell=$(pwd)/shell.sh &&
+	jobid=$(flux jobspec srun -N2 -n2 hostname | flux job submit) &&
+	flux job wait-event -t 10 ${jobid} clean &&
+	test $(grep -c ${jobid} shell.out) -eq 2
+'
+test_expect_success 'job-exec: invalid module option fails' '
+	flux module remove -r 0 job-exec &&
+	test_must_fail flux module load -r 0 job-exec badopt &&
+	flux module load -r 0 job-exec mode=tree
+'
+test_expect_success 'job-exec: remove job-exec, sched-simple modules' '
+	flux module remove -r all job-exec &&
+	flux module remove -r 0 sched-simple
+'
+
+test_done